@@ -0,0 +1,124 @@
+/*
+ * Benchmarks for the Block I/O Read Cache
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-block-cache.h"
+#include "bench.h"
+
+#define BENCH_BLOCK_SIZE 512
+#define BENCH_DISK_SIZE (8 * 1024 * 1024)
+#define BENCH_CHUNK 4096
+#define BENCH_CACHE_SIZE (2 * 1024 * 1024)
+
+/*
+ * Firmware block drivers pay a fixed cost per command: request setup,
+ * doorbells, interrupts or polling. Model it as 10us, plus a copy.
+ */
+#define BENCH_COMMAND_NS 10000
+
+static CEfiU8 *bench_disk;
+
+static CEfiStatus CEFICALL bench_read_blocks(CEfiBlockIoProtocol *this_,
+                                             CEfiU32 media_id,
+                                             CEfiLba lba,
+                                             CEfiUSize buffer_size,
+                                             void *buffer) {
+        uint64_t end = bench_now_ns() + BENCH_COMMAND_NS;
+
+        memcpy(buffer, bench_disk + lba * BENCH_BLOCK_SIZE, buffer_size);
+        while (bench_now_ns() < end)
+                /* spin */ ;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBlockIoMedia bench_media = {
+        .media_id = 1,
+        .media_present = 1,
+        .block_size = BENCH_BLOCK_SIZE,
+        .io_align = 8,
+        .last_block = BENCH_DISK_SIZE / BENCH_BLOCK_SIZE - 1,
+};
+
+static CEfiBlockIoProtocol bench_bio = {
+        .revision = C_EFI_BLOCK_IO_PROTOCOL_REVISION3,
+        .media = &bench_media,
+        .read_blocks = bench_read_blocks,
+};
+
+typedef struct BenchCache {
+        CEfiBlockCache cache;
+        CEfiBlockCacheExtent extents[BENCH_CACHE_SIZE / C_EFI_BLOCK_CACHE_EXTENT_SIZE];
+        CEfiU8 *data;
+        CEfiU8 buf[BENCH_CHUNK];
+        CEfiU64 offset;
+} BenchCache;
+
+/* read the disk sequentially in 4k chunks, without a cache */
+static void bench_uncached(void *userdata, size_t n) {
+        BenchCache *b = userdata;
+
+        while (n--) {
+                bench_bio.read_blocks(&bench_bio, 1, b->offset / BENCH_BLOCK_SIZE, BENCH_CHUNK, b->buf);
+                b->offset = (b->offset + BENCH_CHUNK) % BENCH_DISK_SIZE;
+                bench_sink += b->buf[0];
+        }
+}
+
+/* read the disk sequentially in 4k chunks, through the cache */
+static void bench_sequential(void *userdata, size_t n) {
+        BenchCache *b = userdata;
+
+        while (n--) {
+                c_efi_block_cache_read(&b->cache, b->offset, BENCH_CHUNK, b->buf);
+                b->offset = (b->offset + BENCH_CHUNK) % BENCH_DISK_SIZE;
+                bench_sink += b->buf[0];
+        }
+}
+
+/* read random 4k chunks of a hot set that fits the cache */
+static void bench_hot(void *userdata, size_t n) {
+        BenchCache *b = userdata;
+
+        while (n--) {
+                b->offset = (b->offset * 6364136223846793005ULL + 1442695040888963407ULL);
+                c_efi_block_cache_read(&b->cache, (b->offset >> 33) % (BENCH_CACHE_SIZE / 2), BENCH_CHUNK, b->buf);
+                bench_sink += b->buf[0];
+        }
+}
+
+int main(int argc, char **argv) {
+        BenchCache *b;
+        size_t i;
+
+        b = calloc(1, sizeof(*b));
+        bench_disk = malloc(BENCH_DISK_SIZE);
+        if (!b || !bench_disk)
+                return 1;
+        b->data = malloc(BENCH_CACHE_SIZE);
+        if (!b->data)
+                return 1;
+
+        for (i = 0; i < BENCH_DISK_SIZE; ++i)
+                bench_disk[i] = i * 31;
+
+        if (c_efi_block_cache_init(&b->cache, &bench_bio,
+                                   b->extents, sizeof(b->extents) / sizeof(*b->extents),
+                                   b->data, BENCH_CACHE_SIZE, 0))
+                return 1;
+
+        bench_run("block-cache/uncached-seq-4k", BENCH_CHUNK, bench_uncached, b);
+        b->offset = 0;
+        bench_run("block-cache/seq-4k", BENCH_CHUNK, bench_sequential, b);
+        b->offset = 0;
+        c_efi_block_cache_invalidate(&b->cache);
+        bench_run("block-cache/hot-random-4k", BENCH_CHUNK, bench_hot, b);
+
+        free(b->data);
+        free(bench_disk);
+        free(b);
+        return 0;
+}
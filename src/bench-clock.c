@@ -0,0 +1,35 @@
+/*
+ * Benchmarks for the Calibrated Monotonic Clock
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-clock.h"
+#include "bench.h"
+
+static void bench_ticks(void *userdata, size_t n) {
+        while (n--)
+                bench_sink += c_efi_clock_ticks();
+}
+
+static void bench_ns(void *userdata, size_t n) {
+        while (n--)
+                bench_sink += c_efi_clock_ns(userdata);
+}
+
+static void bench_ns_to_ticks(void *userdata, size_t n) {
+        while (n--)
+                bench_sink += c_efi_clock_ns_to_ticks(userdata, n);
+}
+
+int main(int argc, char **argv) {
+        CEfiClock clock;
+
+        c_efi_clock_init(&clock, 3000000000);
+
+        bench_run("clock/ticks", 0, bench_ticks, NULL);
+        bench_run("clock/ns", 0, bench_ns, &clock);
+        bench_run("clock/ns-to-ticks", 0, bench_ns_to_ticks, &clock);
+        return 0;
+}
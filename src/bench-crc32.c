@@ -0,0 +1,43 @@
+/*
+ * Benchmarks for CRC32 Checksums
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-crc32.h"
+#include "bench.h"
+
+typedef struct BenchCrc32 {
+        CEfiU8 *data;
+        CEfiUSize size;
+} BenchCrc32;
+
+static void bench_crc32(void *userdata, size_t n) {
+        BenchCrc32 *b = userdata;
+
+        while (n--)
+                bench_sink += c_efi_crc32(0, b->data, b->size);
+}
+
+int main(int argc, char **argv) {
+        BenchCrc32 b;
+        CEfiUSize i;
+
+        b.data = malloc(1024 * 1024);
+        if (!b.data)
+                return 1;
+        for (i = 0; i < 1024 * 1024; ++i)
+                b.data[i] = (CEfiU8)(i * 31);
+
+        /* GPT header, GPT partition array, large capsule */
+        b.size = 92;
+        bench_run("crc32/92", b.size, bench_crc32, &b);
+        b.size = 16 * 1024;
+        bench_run("crc32/16k", b.size, bench_crc32, &b);
+        b.size = 1024 * 1024;
+        bench_run("crc32/1m", b.size, bench_crc32, &b);
+
+        free(b.data);
+        return 0;
+}
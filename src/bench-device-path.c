@@ -0,0 +1,176 @@
+/*
+ * Benchmarks for Device Path Walks
+ *
+ * A boot entry refers to its loader with a path like firmware builds for a
+ * file on an NVMe or SATA disk: the ACPI root bridge, two PCI nodes, a GPT
+ * hard drive node, the file path, and the end node. Nodes have variable
+ * length and no alignment, so every walk reads the length from each node
+ * header. Comparing a boot entry against the path of a loaded image is the
+ * most common use, which the compare benchmarks model: an equal path, one
+ * differing only in the last character of the file name, and one on another
+ * partition behind the same controller.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-mem.h"
+#include "bench.h"
+
+#define BENCH_PATH_MAX 256
+
+typedef struct BenchDevicePath {
+        CEfiU8 path[BENCH_PATH_MAX];
+        /* odd offsets, to cover the unaligned accesses of real paths */
+        CEfiU8 equal[BENCH_PATH_MAX + 1];
+        CEfiU8 other_file[BENCH_PATH_MAX + 1];
+        CEfiU8 other_disk[BENCH_PATH_MAX + 1];
+        CEfiUSize size;
+} BenchDevicePath;
+
+static CEfiUSize bench_node_length(const CEfiDevicePathProtocol *node) {
+        return node->length[0] | (CEfiUSize)node->length[1] << 8;
+}
+
+static CEfiBool bench_node_is_end(const CEfiDevicePathProtocol *node) {
+        return node->type == C_EFI_DEVICE_PATH_TYPE_END && node->subtype == C_EFI_DEVICE_PATH_SUBTYPE_END_ALL;
+}
+
+static CEfiU8 *bench_put_node(CEfiU8 *p, CEfiU8 type, CEfiU8 subtype, const void *data, CEfiUSize n) {
+        CEfiDevicePathProtocol node = {
+                .type = type,
+                .subtype = subtype,
+                .length = { (CEfiU8)(sizeof(node) + n), (CEfiU8)((sizeof(node) + n) >> 8) },
+        };
+
+        memcpy(p, &node, sizeof(node));
+        if (n)
+                memcpy(p + sizeof(node), data, n);
+        return p + sizeof(node) + n;
+}
+
+static CEfiUSize bench_build(CEfiU8 *path, const char *file, CEfiU8 disk) {
+        static const CEfiU8 acpi[] = { 0xd0, 0x41, 0x03, 0x0a, 0, 0, 0, 0 };
+        static const CEfiU8 root_port[] = { 0, 0x1c };
+        static const CEfiU8 nvme[] = { 0, 0 };
+        CEfiDevicePathHardDrive hd = {
+                .partition_number = { 1 },
+                .partition_start = { 0x00, 0x08 },
+                .partition_size = { 0x00, 0x00, 0x10 },
+                .partition_signature = { 0x28, 0x73, 0x2a, 0xc1, 0x1f, 0xf8, 0xd2, 0x11,
+                                         0xba, 0x4b, 0x00, 0xa0, 0xc9, 0x3e, 0xc9, disk },
+                .partition_format = C_EFI_HARD_DRIVE_PARTITION_FORMAT_GPT,
+                .signature_type = C_EFI_HARD_DRIVE_SIGNATURE_TYPE_GUID,
+        };
+        CEfiU8 name[2 * 64], *p = path;
+        CEfiUSize i;
+
+        for (i = 0; file[i]; ++i) {
+                name[2 * i] = file[i];
+                name[2 * i + 1] = 0;
+        }
+        name[2 * i] = 0;
+        name[2 * i + 1] = 0;
+
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_ACPI, 0x01, acpi, sizeof(acpi));
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_HARDWARE, C_EFI_DEVICE_PATH_SUBTYPE_HARDWARE_PCI,
+                           root_port, sizeof(root_port));
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_HARDWARE, C_EFI_DEVICE_PATH_SUBTYPE_HARDWARE_PCI,
+                           nvme, sizeof(nvme));
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_MEDIA, C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_HARD_DRIVE,
+                           (CEfiU8 *)&hd + sizeof(hd.header), sizeof(hd) - sizeof(hd.header));
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_MEDIA, C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_FILE_PATH,
+                           name, 2 * i + 2);
+        p = bench_put_node(p, C_EFI_DEVICE_PATH_TYPE_END, C_EFI_DEVICE_PATH_SUBTYPE_END_ALL, NULL, 0);
+        return p - path;
+}
+
+/* count nodes, stopping at the end node or a malformed length */
+static CEfiUSize bench_walk_path(const CEfiU8 *path) {
+        const CEfiDevicePathProtocol *node = (const void *)path;
+        CEfiUSize n = 0, length;
+
+        while (!bench_node_is_end(node)) {
+                length = bench_node_length(node);
+                if (length < sizeof(*node))
+                        break;
+                node = (const void *)((const CEfiU8 *)node + length);
+                ++n;
+        }
+
+        return n;
+}
+
+/* the number of leading nodes both paths share */
+static CEfiUSize bench_compare_paths(const CEfiU8 *a, const CEfiU8 *b) {
+        const CEfiDevicePathProtocol *x = (const void *)a, *y = (const void *)b;
+        CEfiUSize n = 0, length;
+
+        for (;;) {
+                length = bench_node_length(x);
+                if (length < sizeof(*x) || length != bench_node_length(y) ||
+                    c_efi_memcmp(x, y, length) || bench_node_is_end(x))
+                        return n;
+
+                x = (const void *)((const CEfiU8 *)x + length);
+                y = (const void *)((const CEfiU8 *)y + length);
+                ++n;
+        }
+}
+
+static void bench_walk(void *userdata, size_t n) {
+        BenchDevicePath *b = userdata;
+
+        while (n--)
+                bench_sink += bench_walk_path(b->path);
+}
+
+static void bench_compare_equal(void *userdata, size_t n) {
+        BenchDevicePath *b = userdata;
+
+        while (n--)
+                bench_sink += bench_compare_paths(b->path, b->equal + 1);
+}
+
+static void bench_compare_file(void *userdata, size_t n) {
+        BenchDevicePath *b = userdata;
+
+        while (n--)
+                bench_sink += bench_compare_paths(b->path, b->other_file + 1);
+}
+
+static void bench_compare_disk(void *userdata, size_t n) {
+        BenchDevicePath *b = userdata;
+
+        while (n--)
+                bench_sink += bench_compare_paths(b->path, b->other_disk + 1);
+}
+
+int main(int argc, char **argv) {
+        BenchDevicePath *b;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+
+        b->size = bench_build(b->path, "\\EFI\\BOOT\\BOOTX64.EFI", 0x3b);
+        bench_build(b->equal + 1, "\\EFI\\BOOT\\BOOTX64.EFI", 0x3b);
+        bench_build(b->other_file + 1, "\\EFI\\BOOT\\BOOTX64.EFJ", 0x3b);
+        bench_build(b->other_disk + 1, "\\EFI\\BOOT\\BOOTX64.EFI", 0x3c);
+
+        /* the walks must see all five nodes, and stop where the paths differ */
+        if (bench_walk_path(b->path) != 5 ||
+            bench_compare_paths(b->path, b->equal + 1) != 5 ||
+            bench_compare_paths(b->path, b->other_file + 1) != 4 ||
+            bench_compare_paths(b->path, b->other_disk + 1) != 3)
+                return 1;
+
+        bench_run("device-path/walk", b->size, bench_walk, b);
+        bench_run("device-path/compare-equal", b->size, bench_compare_equal, b);
+        bench_run("device-path/compare-other-file", b->size, bench_compare_file, b);
+        bench_run("device-path/compare-other-disk", b->size, bench_compare_disk, b);
+
+        free(b);
+        return 0;
+}
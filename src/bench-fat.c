@@ -0,0 +1,168 @@
+/*
+ * Benchmarks for the Read-Only FAT File System
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-fat.h"
+#include "bench.h"
+
+#define BENCH_SECTOR 512
+#define BENCH_PER_CLUSTER 8
+#define BENCH_CLUSTER (BENCH_SECTOR * BENCH_PER_CLUSTER)
+#define BENCH_N_SECTORS (64 * 1024 * 1024 / BENCH_SECTOR)
+#define BENCH_FAT_SECTORS 64
+#define BENCH_FILE_SIZE (8 * 1024 * 1024)
+
+/*
+ * Firmware block drivers pay a fixed cost per command: request setup,
+ * doorbells, interrupts or polling. Model it as 10us, plus a copy.
+ */
+#define BENCH_COMMAND_NS 10000
+
+static CEfiU8 *bench_disk;
+
+static CEfiStatus CEFICALL bench_read_blocks(CEfiBlockIoProtocol *this_,
+                                             CEfiU32 media_id,
+                                             CEfiLba lba,
+                                             CEfiUSize buffer_size,
+                                             void *buffer) {
+        uint64_t end = bench_now_ns() + BENCH_COMMAND_NS;
+
+        memcpy(buffer, bench_disk + lba * BENCH_SECTOR, buffer_size);
+        while (bench_now_ns() < end)
+                /* spin */ ;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBlockIoMedia bench_media = {
+        .media_id = 1,
+        .media_present = 1,
+        .block_size = BENCH_SECTOR,
+        .io_align = 8,
+        .last_block = BENCH_N_SECTORS - 1,
+};
+
+static CEfiBlockIoProtocol bench_bio = {
+        .revision = C_EFI_BLOCK_IO_PROTOCOL_REVISION3,
+        .media = &bench_media,
+        .read_blocks = bench_read_blocks,
+};
+
+static CEfiStatus CEFICALL bench_allocate_pages(CEfiAllocateType type,
+                                                CEfiMemoryType memory_type,
+                                                CEfiUSize pages,
+                                                CEfiPhysicalAddress *memory) {
+        void *p = aligned_alloc(4096, pages * 4096);
+
+        if (!p)
+                return C_EFI_OUT_OF_RESOURCES;
+        *memory = (uintptr_t)p;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        free((void *)(uintptr_t)memory);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices bench_bs = {
+        .allocate_pages = bench_allocate_pages,
+        .free_pages = bench_free_pages,
+};
+
+typedef struct BenchFat {
+        CEfiFat fat;
+        CEfiU8 *buf;
+} BenchFat;
+
+static void bench_put16(CEfiU8 *p, CEfiU32 v) {
+        p[0] = v;
+        p[1] = v >> 8;
+}
+
+/* a FAT16 volume with 4k clusters, holding a single contiguous file */
+static void bench_format(void) {
+        CEfiU8 *b = bench_disk, *fat = bench_disk + BENCH_SECTOR, *root;
+        CEfiU32 i, n = BENCH_FILE_SIZE / BENCH_CLUSTER;
+
+        b[0] = 0xeb;
+        bench_put16(b + 11, BENCH_SECTOR);
+        b[13] = BENCH_PER_CLUSTER;
+        bench_put16(b + 14, 1);
+        b[16] = 1;
+        bench_put16(b + 17, 512);
+        bench_put16(b + 32, BENCH_N_SECTORS & 0xffff);
+        bench_put16(b + 34, BENCH_N_SECTORS >> 16);
+        bench_put16(b + 22, BENCH_FAT_SECTORS);
+        b[510] = 0x55;
+        b[511] = 0xaa;
+
+        bench_put16(fat, 0xfff8);
+        bench_put16(fat + 2, 0xffff);
+        for (i = 0; i < n; ++i)
+                bench_put16(fat + (2 + i) * 2, i + 1 == n ? 0xffff : 3 + i);
+
+        root = fat + BENCH_FAT_SECTORS * BENCH_SECTOR;
+        memcpy(root, "KERNEL     ", 11);
+        root[11] = C_EFI_FAT_ATTRIBUTE_ARCHIVE;
+        bench_put16(root + 26, 2);
+        bench_put16(root + 28, BENCH_FILE_SIZE & 0xffff);
+        bench_put16(root + 30, BENCH_FILE_SIZE >> 16);
+
+        for (i = 0; i < BENCH_FILE_SIZE; ++i)
+                root[512 * 32 + i] = i * 31;
+}
+
+/* load the file one cluster per command, like slow firmware drivers do */
+static void bench_per_cluster(void *userdata, size_t n) {
+        BenchFat *b = userdata;
+        CEfiU64 offset = b->fat.data_offset;
+        CEfiUSize i;
+
+        while (n--) {
+                for (i = 0; i < BENCH_FILE_SIZE; i += BENCH_CLUSTER)
+                        bench_read_blocks(&bench_bio, 1, (offset + i) / BENCH_SECTOR, BENCH_CLUSTER, b->buf + i);
+                bench_sink += b->buf[0];
+        }
+}
+
+/* open and load the file, with coalesced reads */
+static void bench_load(void *userdata, size_t n) {
+        BenchFat *b = userdata;
+        CEfiFatFile file;
+        CEfiUSize n_read = 0;
+
+        while (n--) {
+                if (!c_efi_fat_open(&b->fat, C_EFI_NULL, u"\\KERNEL", &file))
+                        c_efi_fat_read(&b->fat, &file, b->buf, BENCH_FILE_SIZE, &n_read);
+                bench_sink += n_read + b->buf[0];
+        }
+}
+
+int main(int argc, char **argv) {
+        BenchFat *b;
+
+        b = calloc(1, sizeof(*b));
+        bench_disk = calloc(1, (CEfiUSize)BENCH_N_SECTORS * BENCH_SECTOR);
+        if (!b || !bench_disk)
+                return 1;
+        b->buf = aligned_alloc(4096, BENCH_FILE_SIZE);
+        if (!b->buf)
+                return 1;
+
+        bench_format();
+        if (c_efi_fat_init(&b->fat, &bench_bs, &bench_bio, 0, 0))
+                return 1;
+
+        bench_run("fat/per-cluster-8m", BENCH_FILE_SIZE, bench_per_cluster, b);
+        bench_run("fat/load-8m", BENCH_FILE_SIZE, bench_load, b);
+
+        c_efi_fat_deinit(&b->fat);
+        free(b->buf);
+        free(bench_disk);
+        free(b);
+        return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Benchmarks for the Framebuffer Text Console
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-fbcon.h"
+#include "bench.h"
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+
+static CEfiU32 *bench_screen;
+
+static CEfiStatus CEFICALL bench_blt(CEfiGraphicsOutputProtocol *this_,
+                                     CEfiGraphicsOutputBltPixel *blt_buffer,
+                                     CEfiGraphicsOutputBltOperation blt_operation,
+                                     CEfiUSize source_x,
+                                     CEfiUSize source_y,
+                                     CEfiUSize destination_x,
+                                     CEfiUSize destination_y,
+                                     CEfiUSize width,
+                                     CEfiUSize height,
+                                     CEfiUSize delta) {
+        CEfiU32 *buf = (CEfiU32 *)blt_buffer;
+        CEfiUSize x, y;
+
+        switch (blt_operation) {
+        case C_EFI_BLT_VIDEO_FILL:
+                for (y = 0; y < height; ++y)
+                        for (x = 0; x < width; ++x)
+                                bench_screen[(destination_y + y) * BENCH_WIDTH + destination_x + x] = *buf;
+                break;
+        case C_EFI_BLT_VIDEO_TO_BLT_BUFFER:
+                for (y = 0; y < height; ++y)
+                        memcpy(&buf[(destination_y + y) * (delta / 4) + destination_x],
+                               &bench_screen[(source_y + y) * BENCH_WIDTH + source_x],
+                               width * 4);
+                break;
+        case C_EFI_BLT_BUFFER_TO_VIDEO:
+                for (y = 0; y < height; ++y)
+                        memcpy(&bench_screen[(destination_y + y) * BENCH_WIDTH + destination_x],
+                               &buf[(source_y + y) * (delta / 4) + source_x],
+                               width * 4);
+                break;
+        case C_EFI_BLT_VIDEO_TO_VIDEO:
+                memmove(&bench_screen[destination_y * BENCH_WIDTH],
+                        &bench_screen[source_y * BENCH_WIDTH],
+                        height * BENCH_WIDTH * 4);
+                break;
+        default:
+                return C_EFI_UNSUPPORTED;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static CEfiGraphicsOutputModeInformation bench_info = {
+        .horizontal_resolution = BENCH_WIDTH,
+        .vertical_resolution = BENCH_HEIGHT,
+        .pixel_format = C_EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR,
+        .pixels_per_scan_line = BENCH_WIDTH,
+};
+
+static CEfiGraphicsOutputProtocolMode bench_mode = {
+        .info = &bench_info,
+        .size_of_info = sizeof(bench_info),
+};
+
+static CEfiGraphicsOutputProtocol bench_gop = {
+        .blt = bench_blt,
+        .mode = &bench_mode,
+};
+
+static const CEfiChar8 bench_line[] =
+        "[    0.000000] Linux version 6.8.0 (build@host) (gcc 13.2.0) #1 SMP PREEMPT_DYNAMIC\n";
+
+static void bench_write(void *userdata, size_t n) {
+        while (n--)
+                c_efi_fbcon_write8(userdata, bench_line, sizeof(bench_line) - 1);
+}
+
+/* rendering only, by wrapping to the top instead of scrolling */
+static void bench_write_noscroll(void *userdata, size_t n) {
+        CEfiFbcon *fbcon = userdata;
+
+        while (n--) {
+                if (fbcon->row + 1 >= fbcon->rows)
+                        c_efi_fbcon_set_cursor(fbcon, 0, 0);
+                c_efi_fbcon_write8(fbcon, bench_line, sizeof(bench_line) - 1);
+        }
+}
+
+int main(int argc, char **argv) {
+        static CEfiU32 shadow[BENCH_WIDTH * 8 * C_EFI_FBCON_SCALE_MAX];
+        CEfiFbcon fbcon;
+
+        bench_screen = calloc(BENCH_WIDTH * BENCH_HEIGHT, sizeof(CEfiU32));
+        if (!bench_screen)
+                return 1;
+
+        bench_mode.frame_buffer_base = (CEfiUSize)bench_screen;
+        if (c_efi_fbcon_init(&fbcon, &bench_gop, C_EFI_NULL, 0, 1))
+                return 1;
+        bench_run("fbcon/linear-scale-1", sizeof(bench_line) - 1, bench_write, &fbcon);
+        bench_run("fbcon/linear-scale-1-noscroll", sizeof(bench_line) - 1, bench_write_noscroll, &fbcon);
+
+        if (c_efi_fbcon_init(&fbcon, &bench_gop, C_EFI_NULL, 0, 2))
+                return 1;
+        bench_run("fbcon/linear-scale-2", sizeof(bench_line) - 1, bench_write, &fbcon);
+
+        bench_info.pixel_format = C_EFI_PIXEL_BLT_ONLY;
+        if (c_efi_fbcon_init(&fbcon, &bench_gop, shadow, sizeof(shadow) / sizeof(*shadow), 2))
+                return 1;
+        bench_run("fbcon/blt-scale-2", sizeof(bench_line) - 1, bench_write, &fbcon);
+        bench_run("fbcon/blt-scale-2-noscroll", sizeof(bench_line) - 1, bench_write_noscroll, &fbcon);
+
+        free(bench_screen);
+        return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Benchmarks for the Buffered File Reader
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-file-reader.h"
+#include "bench.h"
+
+#define BENCH_SIZE (16 * 1024 * 1024)
+#define BENCH_CHUNK 4096
+
+/* model a fixed cost of 10us per `read` call, like firmware FAT drivers */
+#define BENCH_CALL_NS 10000
+
+static CEfiU8 *bench_data;
+static CEfiU64 bench_position;
+
+static CEfiStatus CEFICALL bench_read(CEfiFileProtocol *this_, CEfiUSize *buffer_size, void *buffer) {
+        uint64_t end = bench_now_ns() + BENCH_CALL_NS;
+        CEfiUSize n = *buffer_size;
+
+        if (n > BENCH_SIZE - bench_position)
+                n = BENCH_SIZE - bench_position;
+        memcpy(buffer, bench_data + bench_position, n);
+        bench_position += n;
+        *buffer_size = n;
+
+        while (bench_now_ns() < end)
+                /* spin */ ;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_get_position(CEfiFileProtocol *this_, CEfiU64 *position) {
+        *position = bench_position;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_get_info(CEfiFileProtocol *this_,
+                                          CEfiGuid *information_type,
+                                          CEfiUSize *buffer_size,
+                                          void *buffer) {
+        CEfiFileInfo *info = buffer;
+
+        memset(info, 0, sizeof(*info) + 2);
+        info->size = sizeof(*info) + 2;
+        info->file_size = BENCH_SIZE;
+        *buffer_size = sizeof(*info) + 2;
+        return C_EFI_SUCCESS;
+}
+
+/*
+ * Firmware memory is always mapped, so recycle freed pages instead of
+ * paying for page faults of fresh host memory on every iteration.
+ */
+static void *bench_free_list[2];
+static CEfiUSize bench_free_list_pages[2];
+
+static CEfiStatus CEFICALL bench_allocate_pages(CEfiAllocateType type,
+                                                CEfiMemoryType memory_type,
+                                                CEfiUSize pages,
+                                                CEfiPhysicalAddress *memory) {
+        size_t i;
+        void *p;
+
+        for (i = 0; i < 2; ++i) {
+                if (bench_free_list[i] && bench_free_list_pages[i] == pages) {
+                        *memory = (uintptr_t)bench_free_list[i];
+                        bench_free_list[i] = NULL;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        p = aligned_alloc(4096, pages * 4096);
+        if (!p)
+                return C_EFI_OUT_OF_RESOURCES;
+        *memory = (uintptr_t)p;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        size_t i;
+
+        for (i = 0; i < 2; ++i) {
+                if (!bench_free_list[i]) {
+                        bench_free_list[i] = (void *)(uintptr_t)memory;
+                        bench_free_list_pages[i] = pages;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        free((void *)(uintptr_t)memory);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices bench_bs = {
+        .allocate_pages = bench_allocate_pages,
+        .free_pages = bench_free_pages,
+};
+
+static CEfiFileProtocol bench_file = {
+        .read = bench_read,
+        .get_position = bench_get_position,
+        .get_info = bench_get_info,
+};
+
+/* read the file in 4k pieces straight from the firmware */
+static void bench_unbuffered(void *userdata, size_t n) {
+        CEfiU8 *buf = userdata;
+        CEfiUSize size;
+
+        while (n--) {
+                bench_position = 0;
+                do {
+                        size = BENCH_CHUNK;
+                        bench_file.read(&bench_file, &size, buf);
+                } while (size);
+                bench_sink += buf[0];
+        }
+}
+
+/* read the file in 4k pieces through the reader */
+static void bench_buffered(void *userdata, size_t n) {
+        CEfiU8 *buf = userdata;
+        CEfiFileReader reader;
+        CEfiUSize size = 0;
+
+        while (n--) {
+                bench_position = 0;
+                c_efi_file_reader_init(&reader, &bench_bs, &bench_file, NULL, 0);
+                do {
+                        c_efi_file_reader_read(&reader, buf, BENCH_CHUNK, &size);
+                } while (size);
+                c_efi_file_reader_deinit(&reader);
+                bench_sink += buf[0];
+        }
+}
+
+/* load the file into fresh pages */
+static void bench_load(void *userdata, size_t n) {
+        CEfiPhysicalAddress address = 0;
+        CEfiFileReader reader;
+        CEfiUSize size = 0;
+
+        while (n--) {
+                bench_position = 0;
+                c_efi_file_reader_init(&reader, &bench_bs, &bench_file, NULL, 0);
+                c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size);
+                c_efi_file_reader_deinit(&reader);
+                bench_sink += *(CEfiU8 *)(uintptr_t)address;
+                bench_free_pages(address, (size + 4095) / 4096);
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiU8 *buf;
+        size_t i;
+
+        bench_data = malloc(BENCH_SIZE);
+        buf = malloc(BENCH_CHUNK);
+        if (!bench_data || !buf)
+                return 1;
+        for (i = 0; i < BENCH_SIZE; ++i)
+                bench_data[i] = i * 7;
+
+        bench_run("file-reader/unbuffered-4k-16m", BENCH_SIZE, bench_unbuffered, buf);
+        bench_run("file-reader/buffered-4k-16m", BENCH_SIZE, bench_buffered, buf);
+        bench_run("file-reader/load-16m", BENCH_SIZE, bench_load, buf);
+
+        free(bench_free_list[0]);
+        free(bench_free_list[1]);
+        free(buf);
+        free(bench_data);
+        return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Benchmarks for the GUID Partition Table Parser
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-gpt.h"
+#include "bench.h"
+
+#define BENCH_N_ENTRIES 128
+
+typedef struct BenchGpt {
+        _Alignas(8) CEfiU8 header[512];
+        CEfiGptEntry entries[BENCH_N_ENTRIES];
+        CEfiU32 slots[4 * BENCH_N_ENTRIES];
+        CEfiGpt gpt;
+        CEfiGptIndex index;
+        CEfiU64 seed;
+} BenchGpt;
+
+static void bench_guid(CEfiGuid *guid, CEfiU32 i) {
+        guid->u64[0] = (i + 1) * 0x9e3779b97f4a7c15ULL;
+        guid->u64[1] = (i + 1) * 0xc2b2ae3d27d4eb4fULL;
+}
+
+/* validate the header and the entry array */
+static void bench_check(void *userdata, size_t n) {
+        BenchGpt *b = userdata;
+
+        while (n--)
+                bench_sink += c_efi_gpt_header_check(b->header, 512, 1, 4095) +
+                              c_efi_gpt_entries_check(b->gpt.header, b->entries);
+}
+
+/* find a random partition by unique GUID, scanning all entries */
+static void bench_scan(void *userdata, size_t n) {
+        BenchGpt *b = userdata;
+        CEfiGuid guid;
+        CEfiU32 i;
+
+        while (n--) {
+                b->seed = b->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                bench_guid(&guid, (b->seed >> 33) % BENCH_N_ENTRIES);
+                for (i = 0; i < b->gpt.n_entries; ++i)
+                        if (c_efi_guid_equal(&c_efi_gpt_entry(&b->gpt, i)->unique_partition_guid, &guid))
+                                break;
+                bench_sink += i;
+        }
+}
+
+/* find a random partition by unique GUID, via the index */
+static void bench_find(void *userdata, size_t n) {
+        BenchGpt *b = userdata;
+        CEfiGuid guid;
+
+        while (n--) {
+                b->seed = b->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                bench_guid(&guid, (b->seed >> 33) % BENCH_N_ENTRIES);
+                bench_sink += c_efi_gpt_index_find_unique(&b->index, &guid);
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiGptHeader *h;
+        BenchGpt *b;
+        CEfiU32 i;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+
+        for (i = 0; i < BENCH_N_ENTRIES; ++i) {
+                b->entries[i].partition_type_guid = C_EFI_GPT_TYPE_EFI_SYSTEM_GUID;
+                bench_guid(&b->entries[i].unique_partition_guid, i);
+                b->entries[i].starting_lba = 34 + i;
+                b->entries[i].ending_lba = 34 + i;
+        }
+
+        h = (CEfiGptHeader *)b->header;
+        *h = (CEfiGptHeader){
+                .signature = C_EFI_GPT_HEADER_SIGNATURE,
+                .revision = C_EFI_GPT_HEADER_REVISION,
+                .header_size = C_EFI_GPT_HEADER_SIZE_MIN,
+                .my_lba = 1,
+                .alternate_lba = 4095,
+                .first_usable_lba = 34,
+                .last_usable_lba = 4062,
+                .partition_entry_lba = 2,
+                .number_of_partition_entries = BENCH_N_ENTRIES,
+                .size_of_partition_entry = sizeof(CEfiGptEntry),
+                .partition_entry_array_crc32 = c_efi_crc32(0, b->entries, sizeof(b->entries)),
+        };
+        h->header_crc32 = c_efi_crc32(0, h, h->header_size);
+
+        c_efi_gpt_use(&b->gpt, h, b->entries);
+        if (c_efi_gpt_header_check(h, 512, 1, 4095) ||
+            c_efi_gpt_entries_check(h, b->entries) ||
+            c_efi_gpt_index_init(&b->index, &b->gpt, b->slots, sizeof(b->slots) / sizeof(*b->slots)))
+                return 1;
+
+        bench_run("gpt/check-128", sizeof(b->entries), bench_check, b);
+        bench_run("gpt/scan-unique-128", 0, bench_scan, b);
+        bench_run("gpt/find-unique-128", 0, bench_find, b);
+
+        free(b);
+        return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Benchmarks for LZ4 Streaming Decompression
+ *
+ * The payload is compressed at startup with the system liblz4, into 64KiB
+ * blocks as ring buffers need them. The library is loaded at runtime, so the
+ * benchmarks build without its headers. Without the library, there is
+ * nothing to decode and the benchmarks are skipped. The reference decoder
+ * runs on the same payload, as baseline.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-lz4.h"
+#include "bench.h"
+
+#define BENCH_SIZE (8 * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_RING (256 * 1024)
+
+typedef struct BenchLz4Prefs {
+        int block_size_id;
+        int block_mode;
+        int content_checksum;
+        int frame_type;
+        unsigned long long content_size;
+        unsigned int dict_id;
+        int block_checksum;
+        int level;
+        unsigned int auto_flush;
+        unsigned int favor_dec_speed;
+        unsigned int reserved[3];
+} BenchLz4Prefs;
+
+typedef struct BenchLz4 {
+        CEfiLz4 dec;
+        CEfiU8 *payload;
+        CEfiU8 *frame;
+        size_t n_frame;
+        CEfiU8 *window;
+        CEfiU8 *staging;
+        void *ref;
+        size_t (*ref_create)(void **ctx, unsigned int version);
+        size_t (*ref_free)(void *ctx);
+        size_t (*ref_decompress)(void *ctx, void *dst, size_t *n_dst, const void *src, size_t *n_src,
+                                 const void *options);
+} BenchLz4;
+
+/*
+ * Boot payload stand-in: executable code is modeled as a small alphabet of
+ * instruction-like words, mixed with tables, strings and incompressible data.
+ */
+static void bench_payload(CEfiU8 *p, size_t n) {
+        static const char *const words[] = {
+                "\x48\x89\xe5", "\x48\x83\xec\x20", "\xe8\x00\x00", "\x41\x57", "\xc3",
+                "\x0f\x1f\x44\x00\x00", "\x48\x8b\x45", "\x89\x45\xfc", "\xff\x15",
+                "kernel", "initrd", "console=ttyS0", "\x00\x00\x00\x00",
+        };
+        uint64_t x = 1;
+        size_t i = 0, l;
+        const char *w;
+
+        while (i < n) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                if ((x >> 60) == 0) {
+                        for (l = 0; l < 256 && i < n; ++l, ++i)
+                                p[i] = (x >> (l % 56)) ^ l;
+                        continue;
+                }
+                w = words[(x >> 33) % (sizeof(words) / sizeof(*words))];
+                l = strlen(w);
+                if (!l)
+                        l = 1;
+                for ( ; l-- && i < n; )
+                        p[i++] = *w++;
+                if (i < n)
+                        p[i++] = x >> 52;
+        }
+}
+
+static int bench_setup(BenchLz4 *b) {
+        size_t (*bound)(size_t n, const BenchLz4Prefs *prefs);
+        size_t (*compress)(void *dst, size_t n_dst, const void *src, size_t n_src, const BenchLz4Prefs *prefs);
+        BenchLz4Prefs prefs = { .block_size_id = 4, .content_checksum = 1, .content_size = BENCH_SIZE };
+        size_t cap;
+
+        b->ref = dlopen("liblz4.so.1", RTLD_NOW);
+        if (!b->ref)
+                return -1;
+
+        bound = (size_t (*)(size_t, const BenchLz4Prefs *))dlsym(b->ref, "LZ4F_compressFrameBound");
+        compress = (size_t (*)(void *, size_t, const void *, size_t, const BenchLz4Prefs *))dlsym(b->ref, "LZ4F_compressFrame");
+        b->ref_create = (size_t (*)(void **, unsigned int))dlsym(b->ref, "LZ4F_createDecompressionContext");
+        b->ref_free = (size_t (*)(void *))dlsym(b->ref, "LZ4F_freeDecompressionContext");
+        b->ref_decompress = (size_t (*)(void *, void *, size_t *, const void *, size_t *, const void *))
+                dlsym(b->ref, "LZ4F_decompress");
+        if (!bound || !compress || !b->ref_create || !b->ref_free || !b->ref_decompress)
+                return -1;
+
+        cap = bound(BENCH_SIZE, &prefs);
+        b->frame = malloc(cap);
+        if (!b->frame)
+                return -1;
+        b->n_frame = compress(b->frame, cap, b->payload, BENCH_SIZE, &prefs);
+        return b->n_frame > cap ? -1 : 0;
+}
+
+/* the whole frame at once, decoded in place into its final destination */
+static void bench_in_place(void *userdata, size_t n) {
+        BenchLz4 *b = userdata;
+        CEfiUSize used;
+
+        while (n--) {
+                c_efi_lz4_init(&b->dec, 0, b->window, BENCH_SIZE, C_EFI_NULL, 0);
+                c_efi_lz4_decode(&b->dec, b->frame, b->n_frame, &used);
+                bench_sink += b->dec.pos + b->window[b->dec.pos - 1];
+        }
+}
+
+/* input arriving in 64KiB chunks, decoded through a 256KiB ring */
+static void bench_ring(void *userdata, size_t n) {
+        BenchLz4 *b = userdata;
+        size_t off, k, total;
+        CEfiUSize used;
+        const CEfiU8 *p;
+        CEfiStatus r;
+
+        while (n--) {
+                c_efi_lz4_init(&b->dec, 0, b->window, BENCH_RING, b->staging, C_EFI_LZ4_STAGING_MAX);
+                for (off = 0, total = 0; off < b->n_frame; ) {
+                        k = b->n_frame - off < BENCH_CHUNK ? b->n_frame - off : BENCH_CHUNK;
+                        r = c_efi_lz4_decode(&b->dec, b->frame + off, k, &used);
+                        off += used;
+                        k = c_efi_lz4_pending(&b->dec, &p);
+                        total += k;
+                        c_efi_lz4_release(&b->dec, k);
+                        if (r && r != C_EFI_BUFFER_TOO_SMALL)
+                                break;
+                }
+                bench_sink += total;
+        }
+}
+
+static void bench_reference(void *userdata, size_t n) {
+        BenchLz4 *b = userdata;
+        size_t n_dst, n_src;
+        void *ctx;
+
+        if (b->ref_create(&ctx, 100))
+                return;
+
+        while (n--) {
+                n_dst = BENCH_SIZE;
+                n_src = b->n_frame;
+                b->ref_decompress(ctx, b->window, &n_dst, b->frame, &n_src, C_EFI_NULL);
+                bench_sink += n_dst + b->window[n_dst - 1];
+        }
+
+        b->ref_free(ctx);
+}
+
+int main(int argc, char **argv) {
+        BenchLz4 *b;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+        b->payload = malloc(BENCH_SIZE);
+        b->window = malloc(BENCH_SIZE);
+        b->staging = malloc(C_EFI_LZ4_STAGING_MAX);
+        if (!b->payload || !b->window || !b->staging)
+                return 1;
+
+        bench_payload(b->payload, BENCH_SIZE);
+        if (bench_setup(b) < 0)
+                return 0;
+
+        bench_run("lz4/in-place-8m", BENCH_SIZE, bench_in_place, b);
+        if (memcmp(b->window, b->payload, BENCH_SIZE))
+                return 1;
+        bench_run("lz4/ring-8m-64k-chunks", BENCH_SIZE, bench_ring, b);
+        bench_run("lz4/reference-8m", BENCH_SIZE, bench_reference, b);
+
+        dlclose(b->ref);
+        free(b->staging);
+        free(b->window);
+        free(b->frame);
+        free(b->payload);
+        free(b);
+        return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Benchmarks for Memory Primitives and GUID Helpers
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-guid.h"
+#include "c-efi-mem.h"
+#include "bench.h"
+
+#define BENCH_LARGE (64 * 1024)
+#define BENCH_N_TABLES 32
+
+typedef struct BenchMem {
+        CEfiU8 *dst;
+        CEfiU8 *src;
+        CEfiUSize size;
+} BenchMem;
+
+static void bench_memcpy(void *userdata, size_t n) {
+        BenchMem *b = userdata;
+
+        while (n--)
+                c_efi_memcpy(b->dst, b->src, b->size);
+}
+
+static void bench_memmove(void *userdata, size_t n) {
+        BenchMem *b = userdata;
+
+        /* overlapping, backwards */
+        while (n--)
+                c_efi_memmove(b->src + 8, b->src, b->size);
+}
+
+static void bench_memset(void *userdata, size_t n) {
+        BenchMem *b = userdata;
+
+        while (n--)
+                c_efi_memset(b->dst, (CEfiU8)n, b->size);
+}
+
+static void bench_memcmp(void *userdata, size_t n) {
+        BenchMem *b = userdata;
+
+        while (n--)
+                bench_sink += c_efi_memcmp(b->dst, b->src, b->size);
+}
+
+static void bench_guid_hash(void *userdata, size_t n) {
+        CEfiConfigurationTable *tables = userdata;
+
+        while (n--)
+                bench_sink += c_efi_guid_hash(&tables[n % BENCH_N_TABLES].vendor_guid);
+}
+
+static void bench_table_find(void *userdata, size_t n) {
+        CEfiSystemTable *st = userdata;
+
+        while (n--)
+                bench_sink += !!c_efi_configuration_table_find(st, &st->configuration_table[n % BENCH_N_TABLES].vendor_guid);
+}
+
+int main(int argc, char **argv) {
+        CEfiConfigurationTable tables[BENCH_N_TABLES];
+        CEfiSystemTable st = { 0 };
+        BenchMem b;
+        CEfiUSize i;
+
+        b.dst = calloc(1, BENCH_LARGE + 64);
+        b.src = calloc(1, BENCH_LARGE + 64);
+        if (!b.dst || !b.src)
+                return 1;
+
+        b.size = 64;
+        bench_run("mem/memcpy-64", b.size, bench_memcpy, &b);
+        bench_run("mem/memset-64", b.size, bench_memset, &b);
+        bench_run("mem/memcmp-64", b.size, bench_memcmp, &b);
+        b.size = BENCH_LARGE;
+        bench_run("mem/memcpy-64k", b.size, bench_memcpy, &b);
+        bench_run("mem/memmove-64k", b.size, bench_memmove, &b);
+        bench_run("mem/memset-64k", b.size, bench_memset, &b);
+        c_efi_memset(b.dst, 0, BENCH_LARGE);
+        c_efi_memset(b.src, 0, BENCH_LARGE);
+        bench_run("mem/memcmp-64k", b.size, bench_memcmp, &b);
+
+        /* vendor GUIDs often differ only in their first word */
+        for (i = 0; i < BENCH_N_TABLES; ++i) {
+                tables[i].vendor_guid = (CEfiGuid)C_EFI_LOADED_IMAGE_PROTOCOL_GUID;
+                tables[i].vendor_guid.ms1 += i;
+                tables[i].vendor_table = &tables[i];
+        }
+        st.number_of_table_entries = BENCH_N_TABLES;
+        st.configuration_table = tables;
+
+        bench_run("guid/hash", 0, bench_guid_hash, tables);
+        bench_run("guid/table-find-32", 0, bench_table_find, &st);
+
+        free(b.src);
+        free(b.dst);
+        return 0;
+}
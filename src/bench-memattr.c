@@ -0,0 +1,101 @@
+/*
+ * Benchmarks for the Memory Attributes Table Parser
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-memattr.h"
+#include "bench.h"
+
+#define BENCH_N_MAP 1024
+#define BENCH_N_ATTRS 128
+
+typedef struct BenchMemattr {
+        CEfiMemoryDescriptor sorted[BENCH_N_MAP];
+        CEfiMemoryDescriptor reversed[BENCH_N_ATTRS];
+        CEfiMemoryRange map[BENCH_N_MAP];
+        CEfiMemoryRange attrs[BENCH_N_ATTRS];
+        CEfiMemoryRange out[BENCH_N_MAP + 2 * BENCH_N_ATTRS];
+} BenchMemattr;
+
+static void bench_index_sorted(void *userdata, size_t n) {
+        BenchMemattr *b = userdata;
+        CEfiUSize n_ranges = 0;
+
+        while (n--) {
+                c_efi_memory_ranges_index(b->sorted, BENCH_N_MAP, sizeof(*b->sorted), b->map, &n_ranges);
+                bench_sink += n_ranges;
+        }
+}
+
+static void bench_index_reversed(void *userdata, size_t n) {
+        BenchMemattr *b = userdata;
+        CEfiUSize n_ranges = 0;
+
+        while (n--) {
+                c_efi_memory_ranges_index(b->reversed, BENCH_N_ATTRS, sizeof(*b->reversed), b->attrs, &n_ranges);
+                bench_sink += n_ranges;
+        }
+}
+
+static void bench_find(void *userdata, size_t n) {
+        BenchMemattr *b = userdata;
+        CEfiU64 addr = 0;
+
+        while (n--) {
+                addr = (addr + 0x5a5a5000) % ((CEfiU64)BENCH_N_MAP * 0x4000);
+                bench_sink += !!c_efi_memory_ranges_find(b->map, BENCH_N_MAP, addr);
+        }
+}
+
+static void bench_merge(void *userdata, size_t n) {
+        BenchMemattr *b = userdata;
+        CEfiUSize n_out = 0;
+
+        while (n--) {
+                c_efi_memattr_merge(b->map, BENCH_N_MAP,
+                                    b->attrs, BENCH_N_ATTRS,
+                                    b->out, sizeof(b->out) / sizeof(*b->out),
+                                    &n_out);
+                bench_sink += n_out;
+        }
+}
+
+int main(int argc, char **argv) {
+        BenchMemattr *b;
+        CEfiUSize i, n;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+
+        /* 1024 ranges of 4 pages, every 8th one runtime code split by MAT */
+        for (i = 0; i < BENCH_N_MAP; ++i)
+                b->sorted[i] = (CEfiMemoryDescriptor){
+                        .type = (i % 8) ? C_EFI_CONVENTIONAL_MEMORY : C_EFI_RUNTIME_SERVICES_CODE,
+                        .physical_start = i * 0x4000,
+                        .number_of_pages = 4,
+                        .attribute = C_EFI_MEMORY_WB,
+                };
+        for (i = 0; i < BENCH_N_ATTRS; ++i)
+                b->reversed[BENCH_N_ATTRS - 1 - i] = (CEfiMemoryDescriptor){
+                        .type = C_EFI_RUNTIME_SERVICES_CODE,
+                        .physical_start = i * 8 * 0x4000 + 0x1000,
+                        .number_of_pages = 2,
+                        .attribute = C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_RO,
+                };
+
+        if (c_efi_memory_ranges_index(b->sorted, BENCH_N_MAP, sizeof(*b->sorted), b->map, &n) ||
+            c_efi_memory_ranges_index(b->reversed, BENCH_N_ATTRS, sizeof(*b->reversed), b->attrs, &n))
+                return 1;
+
+        bench_run("memattr/index-sorted-1024", sizeof(b->sorted), bench_index_sorted, b);
+        bench_run("memattr/index-reversed-128", sizeof(b->reversed), bench_index_reversed, b);
+        bench_run("memattr/find-1024", 0, bench_find, b);
+        bench_run("memattr/merge-1024x128", 0, bench_merge, b);
+
+        free(b);
+        return 0;
+}
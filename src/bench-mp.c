@@ -0,0 +1,215 @@
+/*
+ * Benchmarks for the Parallel Work Dispatcher
+ *
+ * The MP services are modeled with one thread per AP, as many as the host
+ * has processors besides the BSP. Each job is timed on the BSP alone and
+ * dispatched to all processors, so the scaling and the cost of starting the
+ * APs show. Thread creation is more expensive than waking a parked AP, so
+ * the dispatched numbers are a lower bound.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-efi.h"
+#include "c-efi-mp.h"
+#include "bench.h"
+
+#define BENCH_MAX_APS 63
+#define BENCH_SIZE (64 * 1024 * 1024)
+#define BENCH_PIECE (64 * 1024)
+
+typedef struct BenchEvent {
+        int signaled;
+} BenchEvent;
+
+typedef struct BenchAps {
+        pthread_t threads[BENCH_MAX_APS];
+        CEfiApProcedure procedure;
+        void *argument;
+        CEfiEvent event;
+} BenchAps;
+
+static BenchEvent bench_events[BENCH_MAX_APS + 2];
+static BenchAps bench_aps;
+static size_t bench_n_events, bench_n_aps;
+
+static CEfiStatus CEFICALL bench_create_event(CEfiU32 type,
+                                              CEfiTpl notify_tpl,
+                                              CEfiEventNotify notify_function,
+                                              void *notify_context,
+                                              CEfiEvent *event) {
+        if (bench_n_events >= sizeof(bench_events) / sizeof(*bench_events))
+                return C_EFI_OUT_OF_RESOURCES;
+
+        *event = &bench_events[bench_n_events++];
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_close_event(CEfiEvent event) {
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_wait_for_event(CEfiUSize number_of_events, CEfiEvent *event, CEfiUSize *index) {
+        BenchEvent *e = event[0];
+
+        while (!__atomic_exchange_n(&e->signaled, 0, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+        *index = 0;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices bench_bs = {
+        .create_event = bench_create_event,
+        .wait_for_event = bench_wait_for_event,
+        .close_event = bench_close_event,
+};
+
+static CEfiStatus CEFICALL bench_get_number_of_processors(CEfiMpServicesProtocol *this_,
+                                                          CEfiUSize *number_of_processors,
+                                                          CEfiUSize *number_of_enabled_processors) {
+        *number_of_processors = bench_n_aps + 1;
+        *number_of_enabled_processors = bench_n_aps + 1;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_get_processor_info(CEfiMpServicesProtocol *this_,
+                                                    CEfiUSize processor_number,
+                                                    CEfiProcessorInformation *processor_info_buffer) {
+        *processor_info_buffer = (CEfiProcessorInformation){
+                .processor_id = processor_number,
+                .status_flag = C_EFI_PROCESSOR_ENABLED_BIT | C_EFI_PROCESSOR_HEALTH_STATUS_BIT,
+        };
+        if (!processor_number)
+                processor_info_buffer->status_flag |= C_EFI_PROCESSOR_AS_BSP_BIT;
+        return C_EFI_SUCCESS;
+}
+
+static void *bench_ap_thread(void *userdata) {
+        bench_aps.procedure(bench_aps.argument);
+        return NULL;
+}
+
+static void *bench_all_thread(void *userdata) {
+        size_t i;
+
+        for (i = 0; i < bench_n_aps; ++i)
+                pthread_join(bench_aps.threads[i], NULL);
+        __atomic_store_n(&((BenchEvent *)bench_aps.event)->signaled, 1, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+static CEfiStatus CEFICALL bench_startup_all_aps(CEfiMpServicesProtocol *this_,
+                                                 CEfiApProcedure procedure,
+                                                 CEfiBool single_thread,
+                                                 CEfiEvent wait_event,
+                                                 CEfiUSize timeout_in_micro_seconds,
+                                                 void *procedure_argument,
+                                                 CEfiUSize **failed_cpu_list) {
+        pthread_t thread;
+        size_t i;
+
+        bench_aps.procedure = procedure;
+        bench_aps.argument = procedure_argument;
+        bench_aps.event = wait_event;
+        for (i = 0; i < bench_n_aps; ++i)
+                if (pthread_create(&bench_aps.threads[i], NULL, bench_ap_thread, NULL))
+                        exit(1);
+        if (pthread_create(&thread, NULL, bench_all_thread, NULL) || pthread_detach(thread))
+                exit(1);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiMpServicesProtocol bench_mp = {
+        .get_number_of_processors = bench_get_number_of_processors,
+        .get_processor_info = bench_get_processor_info,
+        .startup_all_aps = bench_startup_all_aps,
+};
+
+typedef struct BenchMp {
+        CEfiMp bsp;
+        CEfiMp all;
+        CEfiMpWorker bsp_workers[1];
+        CEfiMpWorker all_workers[BENCH_MAX_APS + 1];
+        CEfiU8 *data;
+        CEfiU8 (*digests)[C_EFI_SHA256_DIGEST_SIZE];
+} BenchMp;
+
+static void bench_memset(CEfiMp *mp, BenchMp *b, size_t n) {
+        while (n--)
+                if (c_efi_mp_memset(mp, b->data, (CEfiU8)n, BENCH_SIZE))
+                        exit(1);
+        bench_sink += b->data[BENCH_SIZE - 1];
+}
+
+static void bench_memset_bsp(void *userdata, size_t n) {
+        BenchMp *b = userdata;
+
+        bench_memset(&b->bsp, b, n);
+}
+
+static void bench_memset_all(void *userdata, size_t n) {
+        BenchMp *b = userdata;
+
+        bench_memset(&b->all, b, n);
+}
+
+static void bench_sha256(CEfiMp *mp, BenchMp *b, size_t n) {
+        while (n--)
+                if (c_efi_mp_sha256_pieces(mp, b->data, BENCH_SIZE, BENCH_PIECE, b->digests))
+                        exit(1);
+        bench_sink += b->digests[0][0];
+}
+
+static void bench_sha256_bsp(void *userdata, size_t n) {
+        BenchMp *b = userdata;
+
+        bench_sha256(&b->bsp, b, n);
+}
+
+static void bench_sha256_all(void *userdata, size_t n) {
+        BenchMp *b = userdata;
+
+        bench_sha256(&b->all, b, n);
+}
+
+int main(int argc, char **argv) {
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        BenchMp *b;
+        size_t i;
+
+        bench_n_aps = n_cpus > 1 ? (size_t)n_cpus - 1 : 0;
+        if (bench_n_aps > BENCH_MAX_APS)
+                bench_n_aps = BENCH_MAX_APS;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+        b->data = malloc(BENCH_SIZE);
+        b->digests = calloc(BENCH_SIZE / BENCH_PIECE, sizeof(*b->digests));
+        if (!b->data || !b->digests)
+                return 1;
+        for (i = 0; i < BENCH_SIZE; ++i)
+                b->data[i] = (CEfiU8)(i * 31 + (i >> 13));
+
+        if (c_efi_mp_init(&b->bsp, &bench_bs, C_EFI_NULL, b->bsp_workers, 1))
+                return 1;
+        if (c_efi_mp_init(&b->all, &bench_bs, &bench_mp, b->all_workers, BENCH_MAX_APS + 1))
+                return 1;
+
+        bench_run("mp/memset-bsp-64m", BENCH_SIZE, bench_memset_bsp, b);
+        bench_run("mp/memset-all-64m", BENCH_SIZE, bench_memset_all, b);
+        bench_run("mp/sha256-bsp-64m", BENCH_SIZE, bench_sha256_bsp, b);
+        bench_run("mp/sha256-all-64m", BENCH_SIZE, bench_sha256_all, b);
+
+        c_efi_mp_deinit(&b->all);
+        c_efi_mp_deinit(&b->bsp);
+        free(b->digests);
+        free(b->data);
+        free(b);
+        return 0;
+}
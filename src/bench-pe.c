@@ -0,0 +1,89 @@
+/*
+ * Benchmarks for PE/COFF Image Introspection
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-pe.h"
+#include "bench.h"
+
+#define BENCH_N_SECTIONS 16
+#define BENCH_SIZE 0x20000
+
+static const char *bench_names[BENCH_N_SECTIONS] = {
+        ".text", ".rdata", ".data", ".pdata", ".xdata", ".reloc", ".sbat", ".sdmagic",
+        ".osrel", ".cmdline", ".dtb", ".uname", ".splash", ".pcrsig", ".linux", ".initrd",
+};
+
+static void bench_parse(void *userdata, size_t n) {
+        CEfiPeImage image;
+
+        while (n--) {
+                c_efi_pe_image_parse(&image, userdata, BENCH_SIZE, C_EFI_TRUE);
+                bench_sink += image.n_sections;
+        }
+}
+
+static void bench_find(void *userdata, size_t n) {
+        const CEfiPeImage *image = userdata;
+        size_t i = 0;
+
+        while (n--)
+                bench_sink += !!c_efi_pe_section_find(image, bench_names[i++ % BENCH_N_SECTIONS]);
+}
+
+static void bench_find_missing(void *userdata, size_t n) {
+        const CEfiPeImage *image = userdata;
+
+        while (n--)
+                bench_sink += !!c_efi_pe_section_find(image, ".missing");
+}
+
+int main(int argc, char **argv) {
+        CEfiPeOptionalHeader64 *oh;
+        CEfiPeSectionHeader *sh;
+        CEfiPeFileHeader *fh;
+        CEfiPeImage image;
+        CEfiU8 *mem;
+        size_t i;
+
+        mem = calloc(1, BENCH_SIZE);
+        if (!mem)
+                return 1;
+
+        mem[0] = 'M';
+        mem[1] = 'Z';
+        *(CEfiU32 *)(mem + 0x3c) = 0x80;
+        memcpy(mem + 0x80, "PE\0\0", 4);
+
+        fh = (void *)(mem + 0x84);
+        fh->machine = C_EFI_PE_MACHINE_X64;
+        fh->number_of_sections = BENCH_N_SECTIONS;
+        fh->size_of_optional_header = sizeof(*oh) + 16 * sizeof(CEfiPeDataDirectory);
+
+        oh = (void *)(fh + 1);
+        oh->magic = C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS;
+        oh->size_of_image = BENCH_SIZE;
+        oh->size_of_headers = 0x1000;
+        oh->number_of_rva_and_sizes = 16;
+
+        sh = (void *)((CEfiU8 *)oh + fh->size_of_optional_header);
+        for (i = 0; i < BENCH_N_SECTIONS; ++i) {
+                strncpy((char *)sh[i].name, bench_names[i], sizeof(sh[i].name));
+                sh[i].virtual_address = 0x1000 * (i + 1);
+                sh[i].virtual_size = 0x1000;
+        }
+
+        if (c_efi_pe_image_parse(&image, mem, BENCH_SIZE, C_EFI_TRUE))
+                return 1;
+
+        bench_run("pe/parse-16-sections", 0, bench_parse, mem);
+        bench_run("pe/section-find-16", 0, bench_find, &image);
+        bench_run("pe/section-find-missing", 0, bench_find_missing, &image);
+
+        free(mem);
+        return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * Benchmarks for the Streaming Pipeline
+ *
+ * A payload is read from a modeled Block I/O 2 device, hashed with SHA-256
+ * and copied to its destination. The naive way runs the steps one after
+ * another for each chunk, the pipeline overlaps device time with hashing.
+ * The device completes requests on the wall clock, at a fixed bandwidth
+ * after a fixed latency, one request at a time.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-pipeline.h"
+#include "bench.h"
+
+#define BENCH_BLOCK_SIZE 4096
+#define BENCH_SIZE (16 * 1024 * 1024)
+#define BENCH_CHUNK (256 * 1024)
+#define BENCH_LATENCY_NS 20000
+#define BENCH_N_REQUESTS 16
+
+typedef struct BenchEvent {
+        CEfiEventNotify notify;
+        void *context;
+        int signaled;
+} BenchEvent;
+
+typedef struct BenchRequest {
+        CEfiBlockIo2Token *token;
+        CEfiLba lba;
+        CEfiUSize size;
+        void *buffer;
+        uint64_t done_at;
+} BenchRequest;
+
+static BenchEvent bench_events[BENCH_N_REQUESTS + 1];
+static BenchRequest bench_requests[BENCH_N_REQUESTS];
+static size_t bench_n_events, bench_n_requests;
+static uint64_t bench_busy_until;
+static CEfiU8 *bench_disk;
+
+/* complete all requests that are due */
+static void bench_tick(void) {
+        uint64_t now = bench_now_ns();
+        BenchRequest *req;
+        BenchEvent *e;
+
+        while (bench_n_requests && bench_requests[0].done_at <= now) {
+                req = &bench_requests[0];
+                memcpy(req->buffer, bench_disk + req->lba * BENCH_BLOCK_SIZE, req->size);
+                req->token->transaction_status = C_EFI_SUCCESS;
+                e = req->token->event;
+                e->notify(e, e->context);
+                memmove(bench_requests, bench_requests + 1, --bench_n_requests * sizeof(*bench_requests));
+        }
+}
+
+static CEfiStatus CEFICALL bench_allocate_pages(CEfiAllocateType type,
+                                                CEfiMemoryType memory_type,
+                                                CEfiUSize pages,
+                                                CEfiPhysicalAddress *memory) {
+        void *p = aligned_alloc(4096, pages * 4096);
+
+        if (!p)
+                return C_EFI_OUT_OF_RESOURCES;
+        *memory = (uintptr_t)p;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        free((void *)(uintptr_t)memory);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_create_event(CEfiU32 type,
+                                              CEfiTpl notify_tpl,
+                                              CEfiEventNotify notify_function,
+                                              void *notify_context,
+                                              CEfiEvent *event) {
+        if (bench_n_events >= sizeof(bench_events) / sizeof(*bench_events))
+                return C_EFI_OUT_OF_RESOURCES;
+
+        bench_events[bench_n_events] = (BenchEvent){ .notify = notify_function, .context = notify_context };
+        *event = &bench_events[bench_n_events++];
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_close_event(CEfiEvent event) {
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_signal_event(CEfiEvent event) {
+        ((BenchEvent *)event)->signaled = 1;
+        return C_EFI_SUCCESS;
+}
+
+/* the CPU idles in firmware until the device completes something */
+static CEfiStatus CEFICALL bench_wait_for_event(CEfiUSize number_of_events, CEfiEvent *event, CEfiUSize *index) {
+        BenchEvent *e = event[0];
+
+        while (!e->signaled)
+                bench_tick();
+
+        e->signaled = 0;
+        *index = 0;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices bench_bs = {
+        .allocate_pages = bench_allocate_pages,
+        .free_pages = bench_free_pages,
+        .create_event = bench_create_event,
+        .wait_for_event = bench_wait_for_event,
+        .signal_event = bench_signal_event,
+        .close_event = bench_close_event,
+};
+
+/* 1 byte per nanosecond, after a fixed latency, one request at a time */
+static CEfiStatus CEFICALL bench_read_blocks_ex(CEfiBlockIo2Protocol *this_,
+                                                CEfiU32 media_id,
+                                                CEfiLba lba,
+                                                CEfiBlockIo2Token *token,
+                                                CEfiUSize buffer_size,
+                                                void *buffer) {
+        uint64_t now = bench_now_ns();
+
+        if (bench_n_requests >= BENCH_N_REQUESTS)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        if (bench_busy_until < now)
+                bench_busy_until = now;
+        bench_busy_until += BENCH_LATENCY_NS + buffer_size;
+        bench_requests[bench_n_requests++] = (BenchRequest){
+                .token = token,
+                .lba = lba,
+                .size = buffer_size,
+                .buffer = buffer,
+                .done_at = bench_busy_until,
+        };
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBlockIoMedia bench_media = {
+        .media_id = 1,
+        .media_present = 1,
+        .block_size = BENCH_BLOCK_SIZE,
+        .io_align = 8,
+        .last_block = BENCH_SIZE / BENCH_BLOCK_SIZE - 1,
+};
+
+static CEfiBlockIo2Protocol bench_bio = {
+        .media = &bench_media,
+        .read_blocks_ex = bench_read_blocks_ex,
+};
+
+typedef struct BenchPipeline {
+        CEfiPipeline pipeline;
+        CEfiPipelineBuffer buffers[8];
+        CEfiPipelineBlockReader reader;
+        CEfiBlockQueueSlot slots[4];
+        CEfiPipelineStage stages[3];
+        CEfiPipelineSha256 sha;
+        CEfiPipelineCopy copy;
+        CEfiU8 *dst;
+} BenchPipeline;
+
+/* firmware would complete requests from its timer interrupt */
+static CEfiStatus bench_reader_poll(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        bench_tick();
+        return c_efi_pipeline_block_reader_poll(stage, buffer);
+}
+
+static void CEFICALL bench_notify(CEfiEvent event, void *context) {
+        ((BenchEvent *)context)->signaled = 1;
+}
+
+/* read, hash and copy one chunk after another */
+static void bench_serial(void *userdata, size_t n) {
+        BenchPipeline *b = userdata;
+        CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE];
+        BenchEvent done = { .notify = bench_notify, .context = &done };
+        CEfiBlockIo2Token token = { .event = &done };
+        CEfiSha256 sha;
+        CEfiUSize off;
+
+        while (n--) {
+                c_efi_sha256_init(&sha);
+                for (off = 0; off < BENCH_SIZE; off += BENCH_CHUNK) {
+                        bench_bio.read_blocks_ex(&bench_bio, 1, off / BENCH_BLOCK_SIZE, &token, BENCH_CHUNK,
+                                                 b->buffers[0].data);
+                        while (!done.signaled)
+                                bench_tick();
+                        done.signaled = 0;
+                        c_efi_sha256_update(&sha, b->buffers[0].data, BENCH_CHUNK);
+                        memcpy(b->dst + off, b->buffers[0].data, BENCH_CHUNK);
+                }
+                c_efi_sha256_final(&sha, digest);
+                bench_sink += digest[0];
+        }
+}
+
+static void bench_pipelined(void *userdata, size_t n) {
+        BenchPipeline *b = userdata;
+
+        while (n--) {
+                b->stages[0] = c_efi_pipeline_block_reader_stage(&b->reader);
+                b->stages[0].poll = bench_reader_poll;
+                b->stages[1] = c_efi_pipeline_sha256_stage(&b->sha, C_EFI_NULL);
+                b->stages[2] = c_efi_pipeline_copy_stage(&b->copy);
+                c_efi_pipeline_start(&b->pipeline, b->stages, 3);
+                if (c_efi_pipeline_run(&b->pipeline))
+                        exit(1);
+                bench_sink += b->sha.digest[0];
+        }
+}
+
+int main(int argc, char **argv) {
+        BenchPipeline *b;
+        size_t i;
+
+        b = calloc(1, sizeof(*b));
+        bench_disk = malloc(BENCH_SIZE);
+        if (!b || !bench_disk)
+                return 1;
+        b->dst = malloc(BENCH_SIZE);
+        if (!b->dst)
+                return 1;
+        for (i = 0; i < BENCH_SIZE; ++i)
+                bench_disk[i] = (CEfiU8)(i * 13 + (i >> 12));
+
+        if (c_efi_pipeline_init(&b->pipeline, &bench_bs, C_EFI_NULL, b->buffers, 8, BENCH_CHUNK))
+                return 1;
+        if (c_efi_pipeline_block_reader_init(&b->reader, &b->pipeline, &bench_bio, b->slots, 4, 0, BENCH_SIZE))
+                return 1;
+        b->copy = (CEfiPipelineCopy){ .dst = b->dst, .n_dst = BENCH_SIZE };
+
+        bench_run("pipeline/serial-16m", BENCH_SIZE, bench_serial, b);
+        bench_run("pipeline/pipelined-16m", BENCH_SIZE, bench_pipelined, b);
+        if (memcmp(b->dst, bench_disk, BENCH_SIZE))
+                return 1;
+
+        c_efi_pipeline_deinit(&b->pipeline);
+        c_efi_pipeline_block_reader_deinit(&b->reader, &b->pipeline);
+        free(b->dst);
+        free(bench_disk);
+        free(b);
+        return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Benchmarks for Runtime Pointer Relocation
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-reloc.h"
+#include "bench.h"
+
+#define BENCH_N_DESCRIPTORS 128
+#define BENCH_N_SLOTS 4096
+
+static CEfiMemoryDescriptor bench_map[BENCH_N_DESCRIPTORS];
+static void *bench_template[BENCH_N_SLOTS];
+static void *bench_pointers[BENCH_N_SLOTS];
+
+/* a linear search over the map, like common firmware implementations */
+static CEfiStatus CEFICALL bench_convert_pointer(CEfiUSize debug_disposition, void **address) {
+        CEfiPhysicalAddress p = (uintptr_t)*address;
+        CEfiUSize i;
+
+        for (i = 0; i < BENCH_N_DESCRIPTORS; ++i) {
+                if (!(bench_map[i].attribute & C_EFI_MEMORY_RUNTIME))
+                        continue;
+                if (p >= bench_map[i].physical_start &&
+                    p - bench_map[i].physical_start < bench_map[i].number_of_pages << 12) {
+                        *address = (void *)(uintptr_t)(p - bench_map[i].physical_start + bench_map[i].virtual_start);
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        return C_EFI_NOT_FOUND;
+}
+
+static CEfiRuntimeServices bench_rt = {
+        .convert_pointer = bench_convert_pointer,
+};
+
+static void bench_convert(void *userdata, size_t n) {
+        CEfiUSize i;
+
+        while (n--) {
+                memcpy(bench_pointers, bench_template, sizeof(bench_pointers));
+                for (i = 0; i < BENCH_N_SLOTS; ++i)
+                        bench_rt.convert_pointer(0, &bench_pointers[i]);
+                bench_sink += (uintptr_t)bench_pointers[0];
+        }
+}
+
+static void bench_apply(void *userdata, size_t n) {
+        static CEfiMemoryRange ranges[BENCH_N_DESCRIPTORS];
+        static CEfiU64 deltas[BENCH_N_DESCRIPTORS];
+        static void **slots[BENCH_N_SLOTS];
+        CEfiRelocRegistry registry;
+        CEfiUSize i;
+
+        c_efi_reloc_init(&registry, &bench_rt, slots, BENCH_N_SLOTS, ranges, deltas, BENCH_N_DESCRIPTORS);
+
+        while (n--) {
+                memcpy(bench_pointers, bench_template, sizeof(bench_pointers));
+                for (i = 0; i < BENCH_N_SLOTS; ++i)
+                        c_efi_reloc_register(&registry, &bench_pointers[i]);
+                c_efi_reloc_set_map(&registry, sizeof(bench_map), sizeof(*bench_map), bench_map);
+                c_efi_reloc_apply(&registry);
+                bench_sink += (uintptr_t)bench_pointers[0];
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiUSize i;
+
+        /* every other descriptor is runtime, each 16 pages */
+        for (i = 0; i < BENCH_N_DESCRIPTORS; ++i)
+                bench_map[i] = (CEfiMemoryDescriptor){
+                        .type = (i & 1) ? C_EFI_RUNTIME_SERVICES_DATA : C_EFI_BOOT_SERVICES_DATA,
+                        .physical_start = 0x100000 + i * 0x10000,
+                        .virtual_start = C_EFI_U64_C(0xffffffff80000000) + i * 0x10000,
+                        .number_of_pages = 16,
+                        .attribute = (i & 1) ? C_EFI_MEMORY_RUNTIME : 0,
+                };
+
+        /* pointers into random runtime regions, in runs of 4 */
+        srand(1);
+        for (i = 0; i < BENCH_N_SLOTS; ++i)
+                bench_template[i] = (void *)(uintptr_t)(0x100000 +
+                                                        ((i / 4 * 7919) % (BENCH_N_DESCRIPTORS / 2) * 2 + 1) * 0x10000 +
+                                                        rand() % 0x10000);
+
+        bench_run("reloc/convert-pointer-4096", 0, bench_convert, NULL);
+        bench_run("reloc/apply-4096", 0, bench_apply, NULL);
+        return 0;
+}
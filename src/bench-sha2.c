@@ -0,0 +1,148 @@
+/*
+ * Benchmarks for SHA-256 and SHA-384 Hashes
+ *
+ * Each kernel is timed on its own, next to the dispatched entry points, so
+ * the gain of each path shows on any machine.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-sha2.h"
+#include "bench.h"
+
+#define BENCH_SIZE (1024 * 1024)
+#define BENCH_LANES 8
+
+typedef struct BenchSha2 {
+        CEfiU8 *data[BENCH_LANES];
+        CEfiSha256 s256[BENCH_LANES];
+        CEfiSha384 s384[BENCH_LANES];
+} BenchSha2;
+
+static void bench_sha256_scalar(void *userdata, size_t n) {
+        BenchSha2 *b = userdata;
+        CEfiU32 s[8] = { 0 };
+
+        while (n--)
+                c_efi_sha256_blocks_scalar(s, b->data[0], BENCH_SIZE / C_EFI_SHA256_BLOCK_SIZE);
+        bench_sink += s[0];
+}
+
+static void bench_sha256(void *userdata, size_t n) {
+        BenchSha2 *b = userdata;
+        CEfiU8 d[C_EFI_SHA256_DIGEST_SIZE];
+
+        while (n--) {
+                c_efi_sha256(b->data[0], BENCH_SIZE, d);
+                bench_sink += d[0];
+        }
+}
+
+static void bench_sha384(void *userdata, size_t n) {
+        BenchSha2 *b = userdata;
+        CEfiU8 d[C_EFI_SHA384_DIGEST_SIZE];
+
+        while (n--) {
+                c_efi_sha384(b->data[0], BENCH_SIZE, d);
+                bench_sink += d[0];
+        }
+}
+
+static void bench_sha256_multi(void *userdata, size_t n) {
+        BenchSha2 *b = userdata;
+        CEfiSha256 *shas[BENCH_LANES];
+        CEfiUSize i, sizes[BENCH_LANES];
+
+        for (i = 0; i < BENCH_LANES; ++i) {
+                shas[i] = &b->s256[i];
+                sizes[i] = BENCH_SIZE;
+        }
+
+        while (n--) {
+                for (i = 0; i < BENCH_LANES; ++i)
+                        c_efi_sha256_init(shas[i]);
+                c_efi_sha256_update_multi(shas, (const void *const *)b->data, sizes, BENCH_LANES);
+                bench_sink += b->s256[BENCH_LANES - 1].h[0];
+        }
+}
+
+static void bench_sha384_multi(void *userdata, size_t n) {
+        BenchSha2 *b = userdata;
+        CEfiSha384 *shas[BENCH_LANES];
+        CEfiUSize i, sizes[BENCH_LANES];
+
+        for (i = 0; i < BENCH_LANES; ++i) {
+                shas[i] = &b->s384[i];
+                sizes[i] = BENCH_SIZE;
+        }
+
+        while (n--) {
+                for (i = 0; i < BENCH_LANES; ++i)
+                        c_efi_sha384_init(shas[i]);
+                c_efi_sha384_update_multi(shas, (const void *const *)b->data, sizes, BENCH_LANES);
+                bench_sink += b->s384[BENCH_LANES - 1].h[0];
+        }
+}
+
+#if defined(__x86_64__) && defined(__SSE2__)
+
+static void bench_sha256_lanes(BenchSha2 *b, size_t n, CEfiBool avx2) {
+        CEfiU32 s[BENCH_LANES][8] = { { 0 } }, *h[BENCH_LANES];
+        CEfiUSize i;
+
+        for (i = 0; i < BENCH_LANES; ++i)
+                h[i] = s[i];
+
+        while (n--) {
+                if (avx2) {
+                        c_efi_sha256_x8_avx2(h, (const CEfiU8 *const *)b->data, BENCH_SIZE / C_EFI_SHA256_BLOCK_SIZE);
+                } else {
+                        c_efi_sha256_x4_sse2(h, (const CEfiU8 *const *)b->data, BENCH_SIZE / C_EFI_SHA256_BLOCK_SIZE);
+                        c_efi_sha256_x4_sse2(h + 4, (const CEfiU8 *const *)b->data + 4, BENCH_SIZE / C_EFI_SHA256_BLOCK_SIZE);
+                }
+        }
+        bench_sink += s[BENCH_LANES - 1][0];
+}
+
+static void bench_sha256_sse2(void *userdata, size_t n) {
+        bench_sha256_lanes(userdata, n, 0);
+}
+
+static void bench_sha256_avx2(void *userdata, size_t n) {
+        bench_sha256_lanes(userdata, n, 1);
+}
+
+#endif
+
+int main(int argc, char **argv) {
+        BenchSha2 *b;
+        CEfiUSize i, j;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+        for (i = 0; i < BENCH_LANES; ++i) {
+                b->data[i] = malloc(BENCH_SIZE);
+                if (!b->data[i])
+                        return 1;
+                for (j = 0; j < BENCH_SIZE; ++j)
+                        b->data[i][j] = (CEfiU8)(j * 31 + i);
+        }
+
+        bench_run("sha256/scalar-1m", BENCH_SIZE, bench_sha256_scalar, b);
+        bench_run("sha256/1m", BENCH_SIZE, bench_sha256, b);
+        bench_run("sha256/multi-8x1m", BENCH_LANES * BENCH_SIZE, bench_sha256_multi, b);
+#if defined(__x86_64__) && defined(__SSE2__)
+        bench_run("sha256/lanes-sse2-8x1m", BENCH_LANES * BENCH_SIZE, bench_sha256_sse2, b);
+        if (c_efi_sha2_has_avx2())
+                bench_run("sha256/lanes-avx2-8x1m", BENCH_LANES * BENCH_SIZE, bench_sha256_avx2, b);
+#endif
+        bench_run("sha384/1m", BENCH_SIZE, bench_sha384, b);
+        bench_run("sha384/multi-8x1m", BENCH_LANES * BENCH_SIZE, bench_sha384_multi, b);
+
+        for (i = 0; i < BENCH_LANES; ++i)
+                free(b->data[i]);
+        free(b);
+        return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Benchmarks for Cross-Processor Synchronization
+ *
+ * The uncontended paths are timed on a single thread, which is the cost
+ * every user pays. The transfers run a producer and a consumer thread, so
+ * they show the cost of cache line transfers between processors, if the
+ * host has more than one.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-sync.h"
+#include "bench.h"
+
+#define BENCH_N_SLOTS 256
+#define BENCH_N_TRANSFER 4096
+
+typedef struct BenchSync {
+        CEfiSpinLock lock;
+        CEfiSpscQueue spsc;
+        CEfiMpscQueue mpsc;
+        CEfiUSize slots[BENCH_N_SLOTS];
+        CEfiMpscCell cells[BENCH_N_SLOTS];
+        size_t n_transfer;
+} BenchSync;
+
+static void bench_lock(void *userdata, size_t n) {
+        BenchSync *b = userdata;
+
+        while (n--) {
+                c_efi_spin_lock(&b->lock);
+                c_efi_spin_unlock(&b->lock);
+        }
+        bench_sink += b->lock.n_acquired;
+}
+
+static void bench_spsc(void *userdata, size_t n) {
+        BenchSync *b = userdata;
+        CEfiUSize v = 0;
+
+        while (n--) {
+                c_efi_spsc_push(&b->spsc, n);
+                c_efi_spsc_pop(&b->spsc, &v);
+        }
+        bench_sink += v;
+}
+
+static void bench_mpsc(void *userdata, size_t n) {
+        BenchSync *b = userdata;
+        CEfiUSize v = 0;
+
+        while (n--) {
+                c_efi_mpsc_push(&b->mpsc, n);
+                c_efi_mpsc_pop(&b->mpsc, &v);
+        }
+        bench_sink += v;
+}
+
+static void *bench_spsc_producer(void *userdata) {
+        BenchSync *b = userdata;
+        size_t i;
+
+        for (i = 0; i < b->n_transfer; ++i)
+                while (c_efi_spsc_push(&b->spsc, i))
+                        sched_yield();
+        return NULL;
+}
+
+static void *bench_mpsc_producer(void *userdata) {
+        BenchSync *b = userdata;
+        size_t i;
+
+        for (i = 0; i < b->n_transfer; ++i)
+                while (c_efi_mpsc_push(&b->mpsc, i))
+                        sched_yield();
+        return NULL;
+}
+
+static void bench_transfer(BenchSync *b, size_t n, CEfiBool mpsc) {
+        pthread_t thread;
+        CEfiUSize v = 0;
+        size_t i;
+
+        b->n_transfer = n * BENCH_N_TRANSFER;
+        if (pthread_create(&thread, NULL, mpsc ? bench_mpsc_producer : bench_spsc_producer, b))
+                exit(1);
+        for (i = 0; i < b->n_transfer; ++i)
+                while (mpsc ? c_efi_mpsc_pop(&b->mpsc, &v) : c_efi_spsc_pop(&b->spsc, &v))
+                        sched_yield();
+        pthread_join(thread, NULL);
+        bench_sink += v;
+}
+
+static void bench_spsc_transfer(void *userdata, size_t n) {
+        bench_transfer(userdata, n, 0);
+}
+
+static void bench_mpsc_transfer(void *userdata, size_t n) {
+        bench_transfer(userdata, n, 1);
+}
+
+int main(int argc, char **argv) {
+        BenchSync *b;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+        if (c_efi_spsc_init(&b->spsc, b->slots, BENCH_N_SLOTS) ||
+            c_efi_mpsc_init(&b->mpsc, b->cells, BENCH_N_SLOTS))
+                return 1;
+
+        bench_run("sync/spin-lock-unlock", 0, bench_lock, b);
+        bench_run("sync/spsc-push-pop", 0, bench_spsc, b);
+        bench_run("sync/mpsc-push-pop", 0, bench_mpsc, b);
+        bench_run("sync/spsc-transfer-4k", 0, bench_spsc_transfer, b);
+        bench_run("sync/mpsc-transfer-4k", 0, bench_mpsc_transfer, b);
+
+        free(b);
+        return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Benchmarks for Time Conversion and Cached Wall-Clock
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-time.h"
+#include "bench.h"
+
+static CEfiStatus CEFICALL bench_get_time(CEfiTime *time, CEfiTimeCapabilities *capabilities) {
+        *time = (CEfiTime){ .year = 2024, .month = 5, .day = 17, .hour = 10, .timezone = 60 };
+        return C_EFI_SUCCESS;
+}
+
+static CEfiRuntimeServices bench_rt = {
+        .get_time = bench_get_time,
+};
+
+static void bench_to_epoch(void *userdata, size_t n) {
+        CEfiTime t = { .year = 2024, .month = 5, .day = 17, .timezone = 60 };
+        CEfiI64 ns = 0;
+
+        while (n--) {
+                t.second = n % 60;
+                c_efi_time_to_epoch_ns(&t, &ns);
+                bench_sink += ns;
+        }
+}
+
+static void bench_from_epoch(void *userdata, size_t n) {
+        CEfiTime t = { 0 };
+
+        while (n--) {
+                c_efi_time_from_epoch_ns(C_EFI_I64_C(1715940000000000000) + n * 1000000007, 60, 0, &t);
+                bench_sink += t.second;
+        }
+}
+
+static void bench_now(void *userdata, size_t n) {
+        CEfiI64 ns = 0;
+
+        while (n--) {
+                c_efi_wall_clock_now(userdata, &ns);
+                bench_sink += ns;
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiWallClock clock;
+
+        if (c_efi_wall_clock_init(&clock, &bench_rt, 1000000000))
+                return 1;
+
+        bench_run("time/to-epoch-ns", 0, bench_to_epoch, NULL);
+        bench_run("time/from-epoch-ns", 0, bench_from_epoch, NULL);
+        bench_run("time/wall-clock-now", 0, bench_now, &clock);
+        return 0;
+}
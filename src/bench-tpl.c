@@ -0,0 +1,90 @@
+/*
+ * Benchmarks for Lazy TPL Critical Sections
+ *
+ * A critical section nests three helpers that protect their own state, as
+ * is common for allocators and queues called from locked code. The naive
+ * way raises and restores the TPL in every helper, the guard only in the
+ * outermost section. The modeled firmware checks for pending notifications
+ * on every restore, like EDK2 does.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-tpl.h"
+#include "bench.h"
+
+static CEfiTpl bench_tpl = C_EFI_TPL_APPLICATION;
+static volatile CEfiU64 bench_pending[4];
+
+static CEfiTpl CEFICALL bench_raise_tpl(CEfiTpl new_tpl) {
+        CEfiTpl old = bench_tpl;
+
+        bench_tpl = new_tpl;
+        return old;
+}
+
+static void CEFICALL bench_restore_tpl(CEfiTpl old_tpl) {
+        size_t i;
+
+        for (i = 0; i < 4; ++i)
+                if (bench_pending[i] >> old_tpl)
+                        bench_pending[i] = 0;
+        bench_tpl = old_tpl;
+}
+
+static CEfiBootServices bench_bs_storage = {
+        .raise_tpl = bench_raise_tpl,
+        .restore_tpl = bench_restore_tpl,
+};
+
+/* keep the compiler from resolving the indirect calls */
+static CEfiBootServices *volatile bench_bs = &bench_bs_storage;
+
+static void bench_naive(void *userdata, size_t n) {
+        CEfiBootServices *bs = bench_bs;
+        CEfiTpl a, b, c, d;
+
+        while (n--) {
+                a = bs->raise_tpl(C_EFI_TPL_NOTIFY);
+                b = bs->raise_tpl(C_EFI_TPL_NOTIFY);
+                bench_sink += b;
+                c = bs->raise_tpl(C_EFI_TPL_NOTIFY);
+                d = bs->raise_tpl(C_EFI_TPL_NOTIFY);
+                bench_sink += d;
+                bs->restore_tpl(d);
+                bs->restore_tpl(c);
+                bs->restore_tpl(b);
+                bs->restore_tpl(a);
+        }
+}
+
+static void bench_guard(void *userdata, size_t n) {
+        CEfiTplGuard *g = userdata;
+        CEfiTpl a, b, c, d;
+
+        while (n--) {
+                a = c_efi_tpl_enter(g, C_EFI_TPL_NOTIFY);
+                b = c_efi_tpl_enter(g, C_EFI_TPL_NOTIFY);
+                bench_sink += b;
+                c = c_efi_tpl_enter(g, C_EFI_TPL_NOTIFY);
+                d = c_efi_tpl_enter(g, C_EFI_TPL_NOTIFY);
+                bench_sink += d;
+                c_efi_tpl_leave(g, d);
+                c_efi_tpl_leave(g, c);
+                c_efi_tpl_leave(g, b);
+                c_efi_tpl_leave(g, a);
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiTplGuard guard;
+
+        c_efi_tpl_guard_init(&guard, bench_bs, C_EFI_TPL_APPLICATION);
+
+        bench_run("tpl/naive-4-nested", 0, bench_naive, C_EFI_NULL);
+        bench_run("tpl/guard-4-nested", 0, bench_guard, &guard);
+
+        /* each set of sections calls once in each direction, and elides the rest */
+        return guard.n_elided != 3 * (guard.n_raises + guard.n_restores);
+}
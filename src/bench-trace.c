@@ -0,0 +1,31 @@
+/*
+ * Benchmarks for the Boot Trace Ring Buffer
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-trace.h"
+#include "bench.h"
+
+static void bench_record(void *userdata, size_t n) {
+        CEfiTraceTable *table = userdata;
+
+        while (n--)
+                c_efi_trace_begin(table, C_EFI_TRACE_CATEGORY_USER, (CEfiU32)n, n);
+}
+
+int main(int argc, char **argv) {
+        CEfiTraceTable *table;
+        CEfiUSize size;
+
+        size = c_efi_trace_table_size(4096);
+        table = malloc(size);
+        if (!table || c_efi_trace_table_init(table, size, 0))
+                return 1;
+
+        bench_run("trace/record", sizeof(CEfiTraceEvent), bench_record, table);
+
+        free(table);
+        return 0;
+}
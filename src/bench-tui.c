@@ -0,0 +1,153 @@
+/*
+ * Benchmarks for the Shadow-Buffer Text UI Renderer
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-tui.h"
+#include "bench.h"
+
+#define BENCH_COLUMNS 80
+#define BENCH_ROWS 25
+#define BENCH_ENTRIES 16
+
+/*
+ * The console translates every call into terminal escape sequences, like
+ * firmware consoles on a serial port do, so the cost follows the bytes sent.
+ */
+static char bench_wire[4096];
+static size_t bench_n_wire;
+
+static void bench_send(const char *s, size_t n) {
+        while (n--) {
+                bench_wire[bench_n_wire++ % sizeof(bench_wire)] = *s++;
+                ++bench_sink;
+        }
+}
+
+static CEfiStatus CEFICALL bench_output_string(CEfiSimpleTextOutputProtocol *this_, CEfiChar16 *string) {
+        char c;
+
+        for ( ; *string; ++string) {
+                c = *string;
+                bench_send(&c, 1);
+        }
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_query_mode(CEfiSimpleTextOutputProtocol *this_,
+                                            CEfiUSize mode_number,
+                                            CEfiUSize *columns,
+                                            CEfiUSize *rows) {
+        *columns = BENCH_COLUMNS;
+        *rows = BENCH_ROWS;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_set_attribute(CEfiSimpleTextOutputProtocol *this_, CEfiUSize attribute) {
+        char buf[32];
+
+        bench_send(buf, snprintf(buf, sizeof(buf), "\033[0;%d;%dm", 30 + (int)(attribute & 7), 40 + (int)((attribute >> 4) & 7)));
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_clear_screen(CEfiSimpleTextOutputProtocol *this_) {
+        bench_send("\033[2J\033[1;1H", 10);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL bench_set_cursor_position(CEfiSimpleTextOutputProtocol *this_, CEfiUSize column, CEfiUSize row) {
+        char buf[32];
+
+        bench_send(buf, snprintf(buf, sizeof(buf), "\033[%d;%dH", (int)row + 1, (int)column + 1));
+        return C_EFI_SUCCESS;
+}
+
+static CEfiSimpleTextOutputMode bench_mode;
+
+static CEfiSimpleTextOutputProtocol bench_con = {
+        .output_string = bench_output_string,
+        .query_mode = bench_query_mode,
+        .set_attribute = bench_set_attribute,
+        .clear_screen = bench_clear_screen,
+        .set_cursor_position = bench_set_cursor_position,
+        .mode = &bench_mode,
+};
+
+static char bench_entries[BENCH_ENTRIES][64];
+
+/* the boot menu, with entry @selected highlighted */
+static void bench_draw(CEfiTui *tui, size_t selected) {
+        size_t i;
+
+        c_efi_tui_put8(tui, 2, 1, C_EFI_WHITE, "Boot Menu");
+        for (i = 0; i < BENCH_ENTRIES; ++i)
+                c_efi_tui_put8(tui, 4, 3 + i,
+                               i == selected ? (C_EFI_BLACK | C_EFI_BACKGROUND_LIGHTGRAY) : C_EFI_LIGHTGRAY,
+                               bench_entries[i]);
+        c_efi_tui_put8(tui, 2, BENCH_ROWS - 2, C_EFI_DARKGRAY, "Use arrow keys to select an entry, Enter to boot.");
+}
+
+/* redraw via clear_screen and output_string on every keypress */
+static void bench_full_redraw(void *userdata, size_t n) {
+        CEfiChar16 line[BENCH_COLUMNS + 1];
+        CEfiTui *tui = userdata;
+        size_t i, x;
+
+        while (n--) {
+                bench_draw(tui, n % BENCH_ENTRIES);
+                bench_con.set_attribute(&bench_con, C_EFI_LIGHTGRAY);
+                bench_con.clear_screen(&bench_con);
+                for (i = 0; i < BENCH_ROWS - 1; ++i) {
+                        for (x = 0; x < BENCH_COLUMNS; ++x)
+                                line[x] = tui->back[i * BENCH_COLUMNS + x].c;
+                        line[BENCH_COLUMNS] = 0;
+                        bench_con.set_cursor_position(&bench_con, 0, i);
+                        bench_con.set_attribute(&bench_con, tui->back[i * BENCH_COLUMNS + 4].attribute);
+                        bench_con.output_string(&bench_con, line);
+                }
+        }
+}
+
+/* redraw via the renderer */
+static void bench_present(void *userdata, size_t n) {
+        CEfiTui *tui = userdata;
+
+        while (n--) {
+                bench_draw(tui, n % BENCH_ENTRIES);
+                c_efi_tui_present(tui);
+        }
+}
+
+/* redraw a frame drawn from scratch, which is mostly unchanged */
+static void bench_present_clear(void *userdata, size_t n) {
+        CEfiTui *tui = userdata;
+
+        while (n--) {
+                c_efi_tui_clear(tui, C_EFI_LIGHTGRAY);
+                bench_draw(tui, n % BENCH_ENTRIES);
+                c_efi_tui_present(tui);
+        }
+}
+
+int main(int argc, char **argv) {
+        CEfiTuiCell *cells;
+        CEfiTui tui;
+        size_t i;
+
+        cells = calloc(2 * BENCH_COLUMNS * BENCH_ROWS, sizeof(*cells));
+        if (!cells || c_efi_tui_init(&tui, &bench_con, cells, 2 * BENCH_COLUMNS * BENCH_ROWS))
+                return 1;
+
+        for (i = 0; i < BENCH_ENTRIES; ++i)
+                snprintf(bench_entries[i], sizeof(bench_entries[i]), "Linux %zu.%zu (vmlinuz-%zu) on /dev/nvme0n1p%zu", 6 + i / 8, i, i, 2 + i % 3);
+
+        bench_run("tui/full-redraw-80x25", 0, bench_full_redraw, &tui);
+        bench_run("tui/present-80x25", 0, bench_present, &tui);
+        bench_run("tui/present-cleared-80x25", 0, bench_present_clear, &tui);
+
+        free(cells);
+        return 0;
+}
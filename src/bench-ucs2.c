@@ -0,0 +1,69 @@
+/*
+ * Benchmarks for UCS-2 Transcoding
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-ucs2.h"
+#include "bench.h"
+
+#define BENCH_N 4096
+
+typedef struct BenchUcs2 {
+        CEfiChar8 utf8[BENCH_N];
+        CEfiChar16 ucs2[BENCH_N];
+        CEfiUSize n_utf8;
+        CEfiUSize n_ucs2;
+} BenchUcs2;
+
+static void bench_to_ucs2(void *userdata, size_t n) {
+        BenchUcs2 *b = userdata;
+        CEfiUSize n_out = 0;
+
+        while (n--) {
+                c_efi_utf8_to_ucs2(b->ucs2, BENCH_N, b->utf8, b->n_utf8, &n_out);
+                bench_sink += n_out;
+        }
+}
+
+static void bench_to_utf8(void *userdata, size_t n) {
+        BenchUcs2 *b = userdata;
+        CEfiUSize n_out = 0;
+
+        while (n--) {
+                c_efi_ucs2_to_utf8(b->utf8, BENCH_N, b->ucs2, b->n_ucs2, &n_out);
+                bench_sink += n_out;
+        }
+}
+
+static void bench_setup(BenchUcs2 *b, const char *pattern) {
+        CEfiUSize l = strlen(pattern), n = 0;
+
+        while (n + l <= BENCH_N) {
+                memcpy(b->utf8 + n, pattern, l);
+                n += l;
+        }
+        b->n_utf8 = n;
+        c_efi_utf8_to_ucs2(b->ucs2, BENCH_N, b->utf8, n, &b->n_ucs2);
+}
+
+int main(int argc, char **argv) {
+        BenchUcs2 *b;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+
+        bench_setup(b, "root=/dev/sda1 ro quiet splash console=ttyS0,115200 ");
+        bench_run("ucs2/from-utf8-ascii-4k", b->n_utf8, bench_to_ucs2, b);
+        bench_run("ucs2/to-utf8-ascii-4k", b->n_utf8, bench_to_utf8, b);
+
+        bench_setup(b, "Gr\xc3\xbc\xc3\x9f" "e aus M\xc3\xbcnchen \xe2\x82\xac ");
+        bench_run("ucs2/from-utf8-mixed-4k", b->n_utf8, bench_to_ucs2, b);
+        bench_run("ucs2/to-utf8-mixed-4k", b->n_utf8, bench_to_utf8, b);
+
+        free(b);
+        return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Benchmarks for Zstandard Streaming Decompression
+ *
+ * The payload is compressed at startup with the system libzstd, with a 1MiB
+ * window. The library is loaded at runtime, so the benchmarks build without
+ * its headers. Without the library, there is nothing to decode and the
+ * benchmarks are skipped. The reference decoder runs on the same payload, as
+ * baseline.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-zstd.h"
+#include "bench.h"
+
+#define BENCH_SIZE (8 * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_WINDOW_LOG 20
+#define BENCH_RING ((1 << BENCH_WINDOW_LOG) + C_EFI_ZSTD_BLOCK_MAX)
+#define BENCH_LEVEL 19
+
+typedef struct BenchZstd {
+        CEfiZstd dec;
+        CEfiU8 *payload;
+        CEfiU8 *frame;
+        size_t n_frame;
+        CEfiU8 *window;
+        CEfiU8 *workspace;
+        void *ref;
+        size_t (*ref_decompress)(void *dst, size_t n_dst, const void *src, size_t n_src);
+} BenchZstd;
+
+/*
+ * Boot payload stand-in: executable code is modeled as a small alphabet of
+ * instruction-like words, mixed with tables, strings and incompressible data.
+ */
+static void bench_payload(CEfiU8 *p, size_t n) {
+        static const char *const words[] = {
+                "\x48\x89\xe5", "\x48\x83\xec\x20", "\xe8\x00\x00", "\x41\x57", "\xc3",
+                "\x0f\x1f\x44\x00\x00", "\x48\x8b\x45", "\x89\x45\xfc", "\xff\x15",
+                "kernel", "initrd", "console=ttyS0", "\x00\x00\x00\x00",
+        };
+        uint64_t x = 1;
+        size_t i = 0, l;
+        const char *w;
+
+        while (i < n) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                if ((x >> 60) == 0) {
+                        for (l = 0; l < 256 && i < n; ++l, ++i)
+                                p[i] = (x >> (l % 56)) ^ l;
+                        continue;
+                }
+                w = words[(x >> 33) % (sizeof(words) / sizeof(*words))];
+                l = strlen(w);
+                if (!l)
+                        l = 1;
+                for ( ; l-- && i < n; )
+                        p[i++] = *w++;
+                if (i < n)
+                        p[i++] = x >> 52;
+        }
+}
+
+/* parameters of ZSTD_CCtx_setParameter() */
+#define BENCH_ZSTD_C_LEVEL 100
+#define BENCH_ZSTD_C_WINDOW_LOG 101
+#define BENCH_ZSTD_C_CHECKSUM 201
+
+static int bench_setup(BenchZstd *b) {
+        size_t (*compress)(void *cctx, void *dst, size_t n_dst, const void *src, size_t n_src);
+        size_t (*set)(void *cctx, int param, int value);
+        size_t (*bound)(size_t n);
+        unsigned int (*is_error)(size_t r);
+        void *(*create)(void);
+        size_t (*release)(void *cctx);
+        size_t cap;
+        void *cctx;
+
+        b->ref = dlopen("libzstd.so.1", RTLD_NOW);
+        if (!b->ref)
+                return -1;
+
+        bound = (size_t (*)(size_t))dlsym(b->ref, "ZSTD_compressBound");
+        is_error = (unsigned int (*)(size_t))dlsym(b->ref, "ZSTD_isError");
+        create = (void *(*)(void))dlsym(b->ref, "ZSTD_createCCtx");
+        release = (size_t (*)(void *))dlsym(b->ref, "ZSTD_freeCCtx");
+        set = (size_t (*)(void *, int, int))dlsym(b->ref, "ZSTD_CCtx_setParameter");
+        compress = (size_t (*)(void *, void *, size_t, const void *, size_t))dlsym(b->ref, "ZSTD_compress2");
+        b->ref_decompress = (size_t (*)(void *, size_t, const void *, size_t))dlsym(b->ref, "ZSTD_decompress");
+        if (!bound || !is_error || !create || !release || !set || !compress || !b->ref_decompress)
+                return -1;
+
+        cap = bound(BENCH_SIZE);
+        b->frame = malloc(cap);
+        cctx = create();
+        if (!b->frame || !cctx)
+                return -1;
+        set(cctx, BENCH_ZSTD_C_LEVEL, BENCH_LEVEL);
+        set(cctx, BENCH_ZSTD_C_WINDOW_LOG, BENCH_WINDOW_LOG);
+        set(cctx, BENCH_ZSTD_C_CHECKSUM, 1);
+        b->n_frame = compress(cctx, b->frame, cap, b->payload, BENCH_SIZE);
+        release(cctx);
+        return is_error(b->n_frame) ? -1 : 0;
+}
+
+/* the whole frame at once, decoded in place into its final destination */
+static void bench_in_place(void *userdata, size_t n) {
+        BenchZstd *b = userdata;
+        CEfiUSize used;
+
+        while (n--) {
+                c_efi_zstd_init(&b->dec, 0, b->window, BENCH_SIZE, b->workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+                c_efi_zstd_decode(&b->dec, b->frame, b->n_frame, &used);
+                bench_sink += b->dec.pos + b->window[b->dec.pos - 1];
+        }
+}
+
+/* input arriving in 64KiB chunks, decoded through a ring of window plus block */
+static void bench_ring(void *userdata, size_t n) {
+        BenchZstd *b = userdata;
+        size_t off, k, total;
+        CEfiUSize used;
+        const CEfiU8 *p;
+        CEfiStatus r;
+
+        while (n--) {
+                c_efi_zstd_init(&b->dec, 0, b->window, BENCH_RING, b->workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+                for (off = 0, total = 0; off < b->n_frame; ) {
+                        k = b->n_frame - off < BENCH_CHUNK ? b->n_frame - off : BENCH_CHUNK;
+                        r = c_efi_zstd_decode(&b->dec, b->frame + off, k, &used);
+                        off += used;
+                        k = c_efi_zstd_pending(&b->dec, &p);
+                        total += k;
+                        c_efi_zstd_release(&b->dec, k);
+                        if (r && r != C_EFI_BUFFER_TOO_SMALL)
+                                break;
+                }
+                bench_sink += total;
+        }
+}
+
+static void bench_reference(void *userdata, size_t n) {
+        BenchZstd *b = userdata;
+        size_t n_dst;
+
+        while (n--) {
+                n_dst = b->ref_decompress(b->window, BENCH_SIZE, b->frame, b->n_frame);
+                bench_sink += n_dst + b->window[0];
+        }
+}
+
+int main(int argc, char **argv) {
+        BenchZstd *b;
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return 1;
+        b->payload = malloc(BENCH_SIZE);
+        b->window = malloc(BENCH_SIZE);
+        b->workspace = malloc(C_EFI_ZSTD_WORKSPACE_SIZE);
+        if (!b->payload || !b->window || !b->workspace)
+                return 1;
+
+        bench_payload(b->payload, BENCH_SIZE);
+        if (bench_setup(b) < 0)
+                return 0;
+
+        bench_run("zstd/in-place-8m", BENCH_SIZE, bench_in_place, b);
+        if (memcmp(b->window, b->payload, BENCH_SIZE))
+                return 1;
+        bench_run("zstd/ring-8m-64k-chunks", BENCH_SIZE, bench_ring, b);
+        bench_run("zstd/reference-8m", BENCH_SIZE, bench_reference, b);
+
+        dlclose(b->ref);
+        free(b->workspace);
+        free(b->window);
+        free(b->frame);
+        free(b->payload);
+        free(b);
+        return 0;
+}
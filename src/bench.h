@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ * Benchmark Harness
+ *
+ * This is a tiny harness shared by the native `bench-*` executables. Each
+ * benchmark is a callback that runs a given number of iterations of the
+ * operation under test. The harness doubles the iteration count until a run
+ * takes at least the minimum duration (200ms by default, override via the
+ * `C_EFI_BENCH_MIN_MS` environment variable), then reports that run.
+ *
+ * Results are written to standard output as one JSON object per line, with a
+ * stable set of keys, so they can be collected and compared across releases:
+ *
+ *     {"name":"...","iterations":N,"ns_per_op":X,"bytes_per_sec":Y}
+ *
+ * `bytes_per_sec` is 0 for benchmarks that do not process a byte stream.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef void (*BenchFn)(void *userdata, size_t n_iterations);
+
+static volatile uint64_t bench_sink;
+
+static inline uint64_t bench_now_ns(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void bench_run(const char *name, size_t bytes_per_op, BenchFn fn, void *userdata) {
+        uint64_t min_ns = 200ULL * 1000000ULL, start, duration;
+        size_t n = 1;
+        const char *e;
+        double ns_op;
+
+        e = getenv("C_EFI_BENCH_MIN_MS");
+        if (e)
+                min_ns = strtoull(e, NULL, 10) * 1000000ULL;
+
+        /* warm up caches and branch predictors */
+        fn(userdata, 1);
+
+        for (;;) {
+                start = bench_now_ns();
+                fn(userdata, n);
+                duration = bench_now_ns() - start;
+
+                if (duration >= min_ns || n >= ((size_t)-1) / 2)
+                        break;
+
+                n *= 2;
+        }
+
+        ns_op = (double)duration / (double)n;
+        printf("{\"name\":\"%s\",\"iterations\":%zu,\"ns_per_op\":%.3f,\"bytes_per_sec\":%.0f}\n",
+               name,
+               n,
+               ns_op,
+               bytes_per_op && ns_op > 0 ? (double)bytes_per_op * 1e9 / ns_op : 0.0);
+        fflush(stdout);
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+/**
+ * Block I/O Read Cache
+ *
+ * Firmware block devices pay a fixed cost per `read_blocks` call, which
+ * dominates when a loader reads files in small pieces. This header puts a
+ * read cache in front of a Block I/O protocol, addressed by byte offset like
+ * Disk I/O:
+ *
+ *  - The cache holds extents of a fixed number of blocks, aligned to that
+ *    number, in caller-provided memory. A hash table maps LBAs to extents,
+ *    and the least recently used extent is evicted on a miss.
+ *
+ *  - Sequential access is detected, and grows a read-ahead window on every
+ *    miss. The window is read with a single `read_blocks` call into a group
+ *    of adjacent extents, doubling up to C_EFI_BLOCK_CACHE_WINDOW_MAX.
+ *
+ *  - Requests of at least one extent into a suitably aligned buffer bypass
+ *    the cache and are read directly, so bulk loads neither pay an extra
+ *    copy nor flush the cache.
+ *
+ * All buffers passed to `read_blocks` honor the `io_align` of the media.
+ * The cache is read-only. Writing to the device through other means
+ * requires c_efi_block_cache_invalidate(). A media change reported by
+ * `read_blocks` invalidates the cache, which then follows the new media if
+ * it has the same block size and no stricter alignment. Other media need
+ * c_efi_block_cache_init() again.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-block-io.h>
+
+#define C_EFI_BLOCK_CACHE_EXTENT_SIZE (64 * 1024)
+#define C_EFI_BLOCK_CACHE_WINDOW_MAX 8
+#define C_EFI_BLOCK_CACHE_BUCKETS 64
+#define C_EFI_BLOCK_CACHE_NONE C_EFI_U32_C(0xffffffff)
+
+/**
+ * CEfiBlockCacheExtent: Cached Extent
+ * @lba:                first block of the extent
+ * @stamp:              time of the last access, 0 if the extent is empty
+ * @n_blocks:           number of valid blocks, less than a full extent only
+ *                      at the end of the media
+ * @next:               next extent in the hash bucket, or
+ *                      C_EFI_BLOCK_CACHE_NONE
+ */
+typedef struct CEfiBlockCacheExtent {
+        CEfiLba lba;
+        CEfiU64 stamp;
+        CEfiU32 n_blocks;
+        CEfiU32 next;
+} CEfiBlockCacheExtent;
+
+/**
+ * CEfiBlockCache: Block I/O Read Cache
+ * @bio:                block device
+ * @media_id:           media ID of the cached media
+ * @block_size:         block size of the media
+ * @align:              buffer alignment required by the media, at least 1
+ * @last_block:         last block of the media
+ * @extent_blocks:      number of blocks per extent
+ * @extent_size:        number of bytes per extent
+ * @stride:             distance of extents in @data
+ * @data:               extent data, aligned to @align
+ * @extents:            extent table
+ * @n_extents:          number of extents
+ * @group:              maximum read-ahead window, in extents
+ * @window:             current read-ahead window, in extents
+ * @next_lba:           block following the previous request
+ * @clock:              last access time
+ * @buckets:            hash table of extents, keyed by extent number
+ * @n_hits:             number of extent accesses served from the cache
+ * @n_misses:           number of extent accesses that read the device
+ * @n_reads:            number of `read_blocks` calls
+ * @n_read_bytes:       number of bytes read from the device
+ */
+typedef struct CEfiBlockCache {
+        CEfiBlockIoProtocol *bio;
+        CEfiU32 media_id;
+        CEfiU32 block_size;
+        CEfiUSize align;
+        CEfiLba last_block;
+        CEfiU32 extent_blocks;
+        CEfiUSize extent_size;
+        CEfiUSize stride;
+        CEfiU8 *data;
+        CEfiBlockCacheExtent *extents;
+        CEfiU32 n_extents;
+        CEfiU32 group;
+        CEfiU32 window;
+        CEfiLba next_lba;
+        CEfiU64 clock;
+        CEfiU32 buckets[C_EFI_BLOCK_CACHE_BUCKETS];
+        CEfiU64 n_hits;
+        CEfiU64 n_misses;
+        CEfiU64 n_reads;
+        CEfiU64 n_read_bytes;
+} CEfiBlockCache;
+
+static inline CEfiU32 c_efi_block_cache_bucket(CEfiLba key) {
+        return (CEfiU32)((key * C_EFI_U64_C(0x9e3779b97f4a7c15)) >> 58);
+}
+
+static inline void c_efi_block_cache_drop(CEfiBlockCache *cache) {
+        CEfiU32 i;
+
+        for (i = 0; i < C_EFI_BLOCK_CACHE_BUCKETS; ++i)
+                cache->buckets[i] = C_EFI_BLOCK_CACHE_NONE;
+        for (i = 0; i < cache->n_extents; ++i)
+                cache->extents[i] = (CEfiBlockCacheExtent){ .next = C_EFI_BLOCK_CACHE_NONE };
+
+        cache->window = 1;
+        cache->next_lba = 0;
+}
+
+/**
+ * c_efi_block_cache_invalidate() - Drop all cached data
+ * @cache:              cache to invalidate
+ *
+ * This drops all cached extents, and picks up the media currently present
+ * in the device. The extent layout depends on the block size and alignment
+ * of the media, so media that differ in either are rejected, and the cache
+ * keeps the old media ID. Reads then fail until c_efi_block_cache_init()
+ * is called again.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NO_MEDIA if no media is present,
+ *         C_EFI_UNSUPPORTED if the media is incompatible with the cache.
+ */
+static inline CEfiStatus c_efi_block_cache_invalidate(CEfiBlockCache *cache) {
+        CEfiBlockIoMedia *media = cache->bio->media;
+        CEfiUSize align;
+
+        c_efi_block_cache_drop(cache);
+
+        if (!media->media_present)
+                return C_EFI_NO_MEDIA;
+
+        align = media->io_align > 1 ? media->io_align : 1;
+        if (media->block_size != cache->block_size || align > cache->align || (align & (align - 1)))
+                return C_EFI_UNSUPPORTED;
+
+        cache->media_id = media->media_id;
+        cache->last_block = media->last_block;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_cache_init() - Initialize cache
+ * @cache:              cache to initialize
+ * @bio:                block device to cache
+ * @extents:            storage for the extent table
+ * @n_extents:          number of entries in @extents
+ * @data:               storage for the extent data
+ * @n_data:             size of @data in bytes
+ * @extent_size:        size of an extent in bytes, or 0 for the default
+ *
+ * This caches the media currently present in @bio. @extent_size is rounded
+ * up to a multiple of the block size. The number of extents is limited by
+ * both @n_extents and @n_data, after aligning @data to the `io_align` of the
+ * media.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NO_MEDIA if no media is present,
+ *         C_EFI_UNSUPPORTED if the media reports an invalid geometry,
+ *         C_EFI_BUFFER_TOO_SMALL if not a single extent fits.
+ */
+static inline CEfiStatus c_efi_block_cache_init(CEfiBlockCache *cache,
+                                                CEfiBlockIoProtocol *bio,
+                                                CEfiBlockCacheExtent *extents,
+                                                CEfiUSize n_extents,
+                                                void *data,
+                                                CEfiUSize n_data,
+                                                CEfiUSize extent_size) {
+        CEfiBlockIoMedia *media = bio->media;
+        CEfiUSize align, skip, n;
+
+        *cache = (CEfiBlockCache){ .bio = bio, .extents = extents };
+
+        if (!media->media_present)
+                return C_EFI_NO_MEDIA;
+
+        align = media->io_align > 1 ? media->io_align : 1;
+        if (!media->block_size || (align & (align - 1)))
+                return C_EFI_UNSUPPORTED;
+
+        if (!extent_size)
+                extent_size = C_EFI_BLOCK_CACHE_EXTENT_SIZE;
+        extent_size = (extent_size + media->block_size - 1) / media->block_size * media->block_size;
+
+        cache->media_id = media->media_id;
+        cache->block_size = media->block_size;
+        cache->align = align;
+        cache->last_block = media->last_block;
+        cache->extent_blocks = extent_size / media->block_size;
+        cache->extent_size = extent_size;
+        cache->stride = (extent_size + align - 1) & ~(align - 1);
+
+        skip = (align - ((CEfiUSize)data & (align - 1))) & (align - 1);
+        if (n_data < skip)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        n = (n_data - skip) / cache->stride;
+        if (n > n_extents)
+                n = n_extents;
+        if (n > C_EFI_BLOCK_CACHE_NONE - 1)
+                n = C_EFI_BLOCK_CACHE_NONE - 1;
+        if (!n)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        /*
+         * Read-ahead fills a group of adjacent extents with one read, so
+         * groups must be contiguous, and must tile the extent table. Only
+         * use up to half of the cache, so a window never evicts all of it.
+         */
+        cache->group = 1;
+        if (cache->stride == extent_size)
+                while (cache->group < C_EFI_BLOCK_CACHE_WINDOW_MAX && cache->group * 4 <= n)
+                        cache->group *= 2;
+
+        cache->data = (CEfiU8 *)data + skip;
+        cache->n_extents = n / cache->group * cache->group;
+        c_efi_block_cache_drop(cache);
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiU32 c_efi_block_cache_lookup(CEfiBlockCache *cache, CEfiLba key) {
+        CEfiLba lba = key * cache->extent_blocks;
+        CEfiU32 i;
+
+        for (i = cache->buckets[c_efi_block_cache_bucket(key)]; i != C_EFI_BLOCK_CACHE_NONE; i = cache->extents[i].next)
+                if (cache->extents[i].lba == lba)
+                        return i;
+
+        return C_EFI_BLOCK_CACHE_NONE;
+}
+
+static inline void c_efi_block_cache_evict(CEfiBlockCache *cache, CEfiU32 index) {
+        CEfiBlockCacheExtent *extent = &cache->extents[index];
+        CEfiU32 *p;
+
+        if (!extent->stamp)
+                return;
+
+        for (p = &cache->buckets[c_efi_block_cache_bucket(extent->lba / cache->extent_blocks)];
+             *p != index;
+             p = &cache->extents[*p].next)
+                /* empty */ ;
+
+        *p = extent->next;
+        *extent = (CEfiBlockCacheExtent){ .next = C_EFI_BLOCK_CACHE_NONE };
+}
+
+static inline CEfiStatus c_efi_block_cache_read_blocks(CEfiBlockCache *cache, CEfiLba lba, CEfiUSize size, void *buffer) {
+        CEfiStatus r;
+
+        ++cache->n_reads;
+        cache->n_read_bytes += size;
+
+        r = cache->bio->read_blocks(cache->bio, cache->media_id, lba, size, buffer);
+        if (r == C_EFI_MEDIA_CHANGED || r == C_EFI_NO_MEDIA)
+                c_efi_block_cache_invalidate(cache);
+
+        return r;
+}
+
+/* read the extent @key, and the read-ahead window following it */
+static inline CEfiStatus c_efi_block_cache_fill(CEfiBlockCache *cache, CEfiLba key, CEfiBool sequential, CEfiU32 *indexp) {
+        CEfiU64 age, victim_age = (CEfiU64)-1;
+        CEfiU32 i, k, w, victim = 0;
+        CEfiLba lba, n_blocks;
+        CEfiStatus r;
+
+        /* stop the window at the end of the media, or at cached data */
+        w = sequential ? cache->window : 1;
+        for (k = 1; k < w; ++k)
+                if ((key + k) * cache->extent_blocks > cache->last_block ||
+                    c_efi_block_cache_lookup(cache, key + k) != C_EFI_BLOCK_CACHE_NONE)
+                        break;
+        while (w > k)
+                w /= 2;
+
+        /* evict the group of @w extents, whose newest access is oldest */
+        for (i = 0; i < cache->n_extents; i += w) {
+                age = 0;
+                for (k = 0; k < w; ++k)
+                        if (cache->extents[i + k].stamp > age)
+                                age = cache->extents[i + k].stamp;
+                if (age < victim_age) {
+                        victim_age = age;
+                        victim = i;
+                }
+        }
+
+        for (k = 0; k < w; ++k)
+                c_efi_block_cache_evict(cache, victim + k);
+
+        lba = key * cache->extent_blocks;
+        n_blocks = cache->last_block + 1 - lba;
+        if (n_blocks > (CEfiLba)w * cache->extent_blocks)
+                n_blocks = (CEfiLba)w * cache->extent_blocks;
+
+        r = c_efi_block_cache_read_blocks(cache,
+                                          lba,
+                                          n_blocks * cache->block_size,
+                                          cache->data + victim * cache->stride);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        for (k = 0; k < w; ++k) {
+                CEfiBlockCacheExtent *extent = &cache->extents[victim + k];
+                CEfiU32 *bucket = &cache->buckets[c_efi_block_cache_bucket(key + k)];
+
+                *extent = (CEfiBlockCacheExtent){
+                        .lba = lba + k * cache->extent_blocks,
+                        .stamp = ++cache->clock,
+                        .n_blocks = n_blocks < cache->extent_blocks ? n_blocks : cache->extent_blocks,
+                        .next = *bucket,
+                };
+                *bucket = victim + k;
+                n_blocks -= extent->n_blocks;
+        }
+
+        if (sequential && cache->window < cache->group)
+                cache->window *= 2;
+
+        *indexp = victim;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_cache_read() - Read through the cache
+ * @cache:              cache to read through
+ * @offset:             byte offset on the media
+ * @size:               number of bytes to read
+ * @buffer:             output buffer, without alignment requirements
+ *
+ * This reads @size bytes at @offset, like `read_disk` of Disk I/O does.
+ * Cached extents are served from memory. Missing extents are read from the
+ * device, along with the read-ahead window if this request continues the
+ * previous one.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if the range is
+ *         beyond the end of the media, or the error of `read_blocks`. On
+ *         C_EFI_MEDIA_CHANGED and C_EFI_NO_MEDIA, the cache is invalidated
+ *         and follows the new media, if compatible, so that a retry reads
+ *         from it. The offset range is checked against the new media then.
+ */
+static inline CEfiStatus c_efi_block_cache_read(CEfiBlockCache *cache, CEfiU64 offset, CEfiUSize size, void *buffer) {
+        CEfiU64 disk_size = (cache->last_block + 1) * cache->block_size;
+        CEfiU8 *p = buffer;
+        CEfiBlockCacheExtent *extent;
+        CEfiBool sequential;
+        CEfiLba lba;
+        CEfiUSize n;
+        CEfiU32 i;
+        CEfiStatus r;
+
+        if (offset > disk_size || size > disk_size - offset)
+                return C_EFI_INVALID_PARAMETER;
+        if (!size)
+                return C_EFI_SUCCESS;
+
+        /* a request may start within the last block of the previous one */
+        lba = offset / cache->block_size;
+        sequential = lba == cache->next_lba || lba + 1 == cache->next_lba;
+        if (!sequential)
+                cache->window = 1;
+        cache->next_lba = (offset + size - 1) / cache->block_size + 1;
+
+        while (size) {
+                lba = offset / cache->block_size;
+
+                if (!(offset % cache->block_size) && size >= cache->extent_size && !((CEfiUSize)p & (cache->align - 1))) {
+                        n = size / cache->block_size * cache->block_size;
+                        r = c_efi_block_cache_read_blocks(cache, lba, n, p);
+                        if (C_EFI_ERROR(r))
+                                return r;
+                } else {
+                        i = c_efi_block_cache_lookup(cache, lba / cache->extent_blocks);
+                        if (i == C_EFI_BLOCK_CACHE_NONE) {
+                                ++cache->n_misses;
+                                r = c_efi_block_cache_fill(cache, lba / cache->extent_blocks, sequential, &i);
+                                if (C_EFI_ERROR(r))
+                                        return r;
+                        } else {
+                                ++cache->n_hits;
+                        }
+
+                        extent = &cache->extents[i];
+                        extent->stamp = ++cache->clock;
+
+                        n = (extent->lba + extent->n_blocks) * cache->block_size - offset;
+                        if (n > size)
+                                n = size;
+                        c_efi_memcpy(p, cache->data + i * cache->stride + (offset - extent->lba * cache->block_size), n);
+                }
+
+                p += n;
+                offset += n;
+                size -= n;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
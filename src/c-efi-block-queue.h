@@ -0,0 +1,472 @@
+#pragma once
+
+/**
+ * Block I/O 2 Request Queue
+ *
+ * Synchronous `read_blocks` leaves fast devices idle while the caller
+ * processes the data it just read. This header streams a list of extents
+ * through Block I/O 2 instead, keeping a fixed number of token-based reads
+ * in flight:
+ *
+ *  - Each extent is split into chunks, which are read directly into
+ *    consecutive parts of a caller-provided destination buffer.
+ *
+ *  - Every slot of the queue owns a token, whose event is a notify-signal
+ *    event. Its notification marks the slot complete, and signals a wake
+ *    event, which the consumer waits on via `wait_for_event`. Hence, the
+ *    consumer sleeps in firmware while nothing completed.
+ *
+ *  - Chunks are handed to the consumer in order, while later chunks are
+ *    still in flight. The freed slot is refilled before the chunk is
+ *    returned, so device latency overlaps with hashing or decompressing
+ *    the returned chunk.
+ *
+ * Tokens must not be released while the device may still complete them, so
+ * c_efi_block_queue_deinit() waits for all outstanding requests, even after
+ * errors.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-protocol-block-io.h>
+#include <c-efi-protocol-block-io2.h>
+
+#define C_EFI_BLOCK_QUEUE_CHUNK_SIZE (1024 * 1024)
+
+typedef struct CEfiBlockQueue CEfiBlockQueue;
+
+/**
+ * CEfiBlockQueueExtent: Extent to Read
+ * @lba:                first block
+ * @size:               size in bytes, a multiple of the block size
+ */
+typedef struct CEfiBlockQueueExtent {
+        CEfiLba lba;
+        CEfiUSize size;
+} CEfiBlockQueueExtent;
+
+/**
+ * CEfiBlockQueueSlot: Request Slot
+ * @token:              token of the request
+ * @bs:                 boot services
+ * @wake:               event to signal on completion
+ * @buffer:             destination of the request
+ * @size:               size of the request in bytes
+ * @done:               whether the request completed
+ *
+ * A slot owns a token and its notify-signal event, and may be reused once
+ * @done is set. Besides the queue, the block reader of c-efi-pipeline.h
+ * uses slots as well.
+ */
+typedef struct CEfiBlockQueueSlot {
+        CEfiBlockIo2Token token;
+        CEfiBootServices *bs;
+        CEfiEvent wake;
+        CEfiU8 *buffer;
+        CEfiUSize size;
+        volatile CEfiBool done;
+} CEfiBlockQueueSlot;
+
+static inline void CEFICALL c_efi_block_queue_notify(CEfiEvent event, void *context) {
+        CEfiBlockQueueSlot *slot = context;
+
+        slot->done = 1;
+        slot->bs->signal_event(slot->wake);
+}
+
+/**
+ * c_efi_block_queue_slots_deinit() - Deinitialize request slots
+ * @slots:              slots to deinitialize
+ * @n_slots:            number of entries in @slots
+ *
+ * This closes the events of all slots. None may have a request in flight.
+ */
+static inline void c_efi_block_queue_slots_deinit(CEfiBlockQueueSlot *slots, CEfiUSize n_slots) {
+        CEfiUSize i;
+
+        for (i = 0; i < n_slots; ++i)
+                slots[i].bs->close_event(slots[i].token.event);
+}
+
+/**
+ * c_efi_block_queue_slots_init() - Initialize request slots
+ * @slots:              slots to initialize
+ * @n_slots:            number of entries in @slots
+ * @bs:                 boot services
+ * @wake:               event to signal whenever a request completes
+ *
+ * This creates one event per slot, whose notification refers to the slot,
+ * so @slots must not move until deinitialized. On failure, no event is left
+ * open.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `create_event`.
+ */
+static inline CEfiStatus c_efi_block_queue_slots_init(CEfiBlockQueueSlot *slots,
+                                                      CEfiUSize n_slots,
+                                                      CEfiBootServices *bs,
+                                                      CEfiEvent wake) {
+        CEfiStatus r;
+        CEfiUSize i;
+
+        for (i = 0; i < n_slots; ++i) {
+                slots[i] = (CEfiBlockQueueSlot){ .bs = bs, .wake = wake };
+                r = bs->create_event(C_EFI_EVT_NOTIFY_SIGNAL,
+                                     C_EFI_TPL_CALLBACK,
+                                     c_efi_block_queue_notify,
+                                     &slots[i],
+                                     &slots[i].token.event);
+                if (C_EFI_ERROR(r)) {
+                        c_efi_block_queue_slots_deinit(slots, i);
+                        return r;
+                }
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_queue_slot_submit() - Submit a request on a slot
+ * @slot:               idle slot to use
+ * @bio:                block device to read from
+ * @media_id:           media ID the request is for
+ * @lba:                first block to read
+ * @buffer:             destination of the request
+ * @size:               size of the request in bytes
+ *
+ * The device may complete the request before this returns, so @done of
+ * @slot is cleared first. If the submission fails, the slot is marked done
+ * with the error as transaction status, since no completion will follow.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `read_blocks_ex`.
+ */
+static inline CEfiStatus c_efi_block_queue_slot_submit(CEfiBlockQueueSlot *slot,
+                                                       CEfiBlockIo2Protocol *bio,
+                                                       CEfiU32 media_id,
+                                                       CEfiLba lba,
+                                                       void *buffer,
+                                                       CEfiUSize size) {
+        CEfiStatus r;
+
+        slot->buffer = buffer;
+        slot->size = size;
+        slot->done = 0;
+        slot->token.transaction_status = C_EFI_SUCCESS;
+
+        r = bio->read_blocks_ex(bio, media_id, lba, &slot->token, size, buffer);
+        if (C_EFI_ERROR(r)) {
+                slot->token.transaction_status = r;
+                slot->done = 1;
+        }
+
+        return r;
+}
+
+/**
+ * CEfiBlockQueue: Block I/O 2 Request Queue
+ * @bs:                 boot services
+ * @bio:                block device
+ * @media_id:           media ID at initialization
+ * @block_size:         block size of the media
+ * @align:              buffer alignment required by the media, at least 1
+ * @chunk_size:         maximum size of a request
+ * @wake:               event signaled on every completion
+ * @slots:              request slots, used as ring in submission order
+ * @n_slots:            number of request slots
+ * @extents:            extents of the current stream
+ * @n_extents:          number of extents of the current stream
+ * @extent:             extent to submit next
+ * @extent_offset:      offset in @extent to submit next
+ * @pos:                destination of the next submission
+ * @head:               slot of the oldest pending request
+ * @n_pending:          number of requests not yet returned
+ * @status:             first error of the current stream
+ * @n_submitted:        number of requests submitted
+ * @n_waits:            number of waits for completions
+ */
+struct CEfiBlockQueue {
+        CEfiBootServices *bs;
+        CEfiBlockIo2Protocol *bio;
+        CEfiU32 media_id;
+        CEfiU32 block_size;
+        CEfiUSize align;
+        CEfiUSize chunk_size;
+        CEfiEvent wake;
+        CEfiBlockQueueSlot *slots;
+        CEfiUSize n_slots;
+        const CEfiBlockQueueExtent *extents;
+        CEfiUSize n_extents;
+        CEfiUSize extent;
+        CEfiUSize extent_offset;
+        CEfiU8 *pos;
+        CEfiUSize head;
+        CEfiUSize n_pending;
+        CEfiStatus status;
+        CEfiU64 n_submitted;
+        CEfiU64 n_waits;
+};
+
+/**
+ * c_efi_block_queue_init() - Initialize request queue
+ * @q:                  queue to initialize
+ * @bs:                 boot services
+ * @bio:                block device to read from
+ * @slots:              storage for the request slots
+ * @n_slots:            number of entries in @slots, the queue depth
+ * @chunk_size:         maximum size of a request, or 0 for the default
+ *
+ * @chunk_size is rounded up to a multiple of both the block size and the
+ * `io_align` of the media. This initializes @slots, which must not move
+ * until @q is deinitialized.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_slots is
+ *         0, C_EFI_NO_MEDIA if no media is present, C_EFI_UNSUPPORTED if the
+ *         media reports an invalid geometry, or the error of
+ *         `create_event`.
+ */
+static inline CEfiStatus c_efi_block_queue_init(CEfiBlockQueue *q,
+                                                CEfiBootServices *bs,
+                                                CEfiBlockIo2Protocol *bio,
+                                                CEfiBlockQueueSlot *slots,
+                                                CEfiUSize n_slots,
+                                                CEfiUSize chunk_size) {
+        CEfiBlockIoMedia *media = bio->media;
+        CEfiStatus r;
+
+        *q = (CEfiBlockQueue){ .bs = bs, .bio = bio, .slots = slots };
+
+        if (!n_slots)
+                return C_EFI_INVALID_PARAMETER;
+        if (!media->media_present)
+                return C_EFI_NO_MEDIA;
+
+        q->align = media->io_align > 1 ? media->io_align : 1;
+        if (!media->block_size || (q->align & (q->align - 1)))
+                return C_EFI_UNSUPPORTED;
+
+        if (!chunk_size)
+                chunk_size = C_EFI_BLOCK_QUEUE_CHUNK_SIZE;
+        chunk_size = (chunk_size + media->block_size - 1) / media->block_size * media->block_size;
+        while (chunk_size & (q->align - 1))
+                chunk_size += media->block_size;
+
+        q->media_id = media->media_id;
+        q->block_size = media->block_size;
+        q->chunk_size = chunk_size;
+
+        r = bs->create_event(0, 0, C_EFI_NULL, C_EFI_NULL, &q->wake);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = c_efi_block_queue_slots_init(slots, n_slots, bs, q->wake);
+        if (C_EFI_ERROR(r)) {
+                bs->close_event(q->wake);
+                return r;
+        }
+
+        q->n_slots = n_slots;
+        return C_EFI_SUCCESS;
+}
+
+/* wait for the oldest pending request, and remove it */
+static inline CEfiStatus c_efi_block_queue_wait(CEfiBlockQueue *q, CEfiBlockQueueSlot **slotp) {
+        CEfiBlockQueueSlot *slot = &q->slots[q->head];
+        CEfiUSize index = 0;
+        CEfiStatus r;
+
+        while (!slot->done) {
+                ++q->n_waits;
+                r = q->bs->wait_for_event(1, &q->wake, &index);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        q->head = (q->head + 1) % q->n_slots;
+        --q->n_pending;
+        *slotp = slot;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_queue_drain() - Wait for all outstanding requests
+ * @q:                  queue to drain
+ *
+ * This waits for all requests of the current stream, and ends it.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `wait_for_event`.
+ */
+static inline CEfiStatus c_efi_block_queue_drain(CEfiBlockQueue *q) {
+        CEfiBlockQueueSlot *slot;
+        CEfiStatus r;
+
+        while (q->n_pending) {
+                r = c_efi_block_queue_wait(q, &slot);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        q->extent = q->n_extents;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_queue_deinit() - Deinitialize request queue
+ * @q:                  queue to deinitialize
+ *
+ * This waits for all outstanding requests, and closes all events.
+ */
+static inline void c_efi_block_queue_deinit(CEfiBlockQueue *q) {
+        if (!q->n_slots)
+                return;
+
+        c_efi_block_queue_drain(q);
+        c_efi_block_queue_slots_deinit(q->slots, q->n_slots);
+        q->bs->close_event(q->wake);
+        q->n_slots = 0;
+}
+
+/* submit requests until all slots are busy */
+static inline void c_efi_block_queue_submit(CEfiBlockQueue *q) {
+        const CEfiBlockQueueExtent *extent;
+        CEfiBlockQueueSlot *slot;
+        CEfiUSize n;
+
+        while (q->n_pending < q->n_slots && q->extent < q->n_extents && !C_EFI_ERROR(q->status)) {
+                extent = &q->extents[q->extent];
+                if (q->extent_offset == extent->size) {
+                        ++q->extent;
+                        q->extent_offset = 0;
+                        continue;
+                }
+
+                n = extent->size - q->extent_offset;
+                if (n > q->chunk_size)
+                        n = q->chunk_size;
+
+                /* failed submissions complete right away, and fail the stream in order */
+                slot = &q->slots[(q->head + q->n_pending) % q->n_slots];
+                ++q->n_pending;
+                ++q->n_submitted;
+                c_efi_block_queue_slot_submit(slot,
+                                              q->bio,
+                                              q->media_id,
+                                              extent->lba + q->extent_offset / q->block_size,
+                                              q->pos,
+                                              n);
+
+                q->pos += n;
+                q->extent_offset += n;
+        }
+}
+
+/**
+ * c_efi_block_queue_start() - Start streaming an extent list
+ * @q:                  queue to use
+ * @extents:            extents to read, must stay valid until the stream ends
+ * @n_extents:          number of entries in @extents
+ * @buffer:             destination of all extents, one after another
+ *
+ * This ends the previous stream, if any, and submits the first requests.
+ * Both @buffer and the start of every extent within it must honor the
+ * `io_align` of the media.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if an extent
+ *         is not a multiple of the block size, or misaligned.
+ */
+static inline CEfiStatus c_efi_block_queue_start(CEfiBlockQueue *q,
+                                                 const CEfiBlockQueueExtent *extents,
+                                                 CEfiUSize n_extents,
+                                                 void *buffer) {
+        CEfiUSize i, pos = (CEfiUSize)buffer;
+        CEfiStatus r;
+
+        r = c_efi_block_queue_drain(q);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        for (i = 0; i < n_extents; ++i) {
+                if ((extents[i].size % q->block_size) || (pos & (q->align - 1)))
+                        return C_EFI_INVALID_PARAMETER;
+                pos += extents[i].size;
+        }
+
+        q->extents = extents;
+        q->n_extents = n_extents;
+        q->extent = 0;
+        q->extent_offset = 0;
+        q->pos = buffer;
+        q->status = C_EFI_SUCCESS;
+
+        c_efi_block_queue_submit(q);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_queue_next() - Fetch the next chunk of the stream
+ * @q:                  queue to use
+ * @datap:              output for the chunk, pointing into the destination
+ * @sizep:              output for the size of the chunk
+ *
+ * This waits for the oldest request of the stream, and submits the next
+ * one before returning it. Chunks are returned in order of the extent list.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_FOUND at the end of the
+ *         stream, or the error of the failed request. Errors end the stream.
+ */
+static inline CEfiStatus c_efi_block_queue_next(CEfiBlockQueue *q, void **datap, CEfiUSize *sizep) {
+        CEfiBlockQueueSlot *slot;
+        CEfiStatus r;
+
+        if (C_EFI_ERROR(q->status))
+                return q->status;
+        if (!q->n_pending)
+                return C_EFI_NOT_FOUND;
+
+        r = c_efi_block_queue_wait(q, &slot);
+        if (!C_EFI_ERROR(r))
+                r = slot->token.transaction_status;
+        if (C_EFI_ERROR(r)) {
+                q->status = r;
+                return r;
+        }
+
+        /* the slot is reused by the refill */
+        *datap = slot->buffer;
+        *sizep = slot->size;
+        c_efi_block_queue_submit(q);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_block_queue_read() - Read an extent list
+ * @q:                  queue to use
+ * @extents:            extents to read
+ * @n_extents:          number of entries in @extents
+ * @buffer:             destination of all extents, one after another
+ *
+ * This is c_efi_block_queue_start() followed by c_efi_block_queue_next()
+ * until the end of the stream, for callers that do not process chunks.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of the stream.
+ */
+static inline CEfiStatus c_efi_block_queue_read(CEfiBlockQueue *q,
+                                                const CEfiBlockQueueExtent *extents,
+                                                CEfiUSize n_extents,
+                                                void *buffer) {
+        CEfiUSize size = 0;
+        void *data = C_EFI_NULL;
+        CEfiStatus r;
+
+        r = c_efi_block_queue_start(q, extents, n_extents, buffer);
+        while (!C_EFI_ERROR(r))
+                r = c_efi_block_queue_next(q, &data, &size);
+
+        return r == C_EFI_NOT_FOUND ? C_EFI_SUCCESS : r;
+}
+
+#ifdef __cplusplus
+}
+#endif
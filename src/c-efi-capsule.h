@@ -0,0 +1,313 @@
+#pragma once
+
+/**
+ * Capsule Scatter-Gather Builder
+ *
+ * UpdateCapsule() takes the capsule headers as virtual pointers, plus a
+ * physical scatter-gather list describing where the capsule data lives. The
+ * scatter-gather list is a chain of CEfiCapsuleBlockDescriptor arrays. Each
+ * array is terminated either by a continuation entry (length 0, pointing to
+ * the next array) or by a null entry (length 0, address 0).
+ *
+ * This header provides a builder that emits such a chain over existing
+ * caller buffers, without copying the payload. A capsule can be spread over
+ * any number of buffers of any alignment and size. Buffers may straddle page
+ * boundaries, since boot services run identity-mapped and a virtually
+ * contiguous buffer is thus physically contiguous as well. The first buffer
+ * of each capsule must start with its CEfiCapsuleHeader.
+ *
+ * Descriptor arrays are allocated one page at a time via AllocatePages(),
+ * so a chain of 255 data blocks costs a single page.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+#define C_EFI_CAPSULE_BUILDER_N_CAPSULES 16
+#define C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS (4096 / sizeof(CEfiCapsuleBlockDescriptor))
+
+/**
+ * CEfiCapsuleSegment: Capsule Segment
+ * @data:               pointer to the segment data
+ * @size:               size of the segment in bytes
+ *
+ * A contiguous piece of a capsule. Segments are concatenated in order to
+ * form the capsule image.
+ */
+typedef struct CEfiCapsuleSegment {
+        const void *data;
+        CEfiUSize size;
+} CEfiCapsuleSegment;
+
+/**
+ * CEfiCapsuleBuilder: Capsule Scatter-Gather Builder
+ * @st:                 system table
+ * @head:               first descriptor array, or NULL
+ * @block:              current descriptor array, or NULL
+ * @spare:              unused descriptor arrays, or NULL
+ * @n_pages:            number of descriptor arrays in the chain
+ * @spare_pages:        number of descriptor arrays in @spare
+ * @n_used:             number of used entries in @block
+ * @n_capsules:         number of capsules in @capsules
+ * @total_size:         sum of all capsule image sizes
+ * @capsules:           capsule headers, in order of addition
+ *
+ * The builder must be initialized with c_efi_capsule_builder_init() and
+ * released with c_efi_capsule_builder_deinit(). All members are read-only to
+ * the caller.
+ */
+typedef struct CEfiCapsuleBuilder {
+        CEfiSystemTable *st;
+        CEfiCapsuleBlockDescriptor *head;
+        CEfiCapsuleBlockDescriptor *block;
+        CEfiCapsuleBlockDescriptor *spare;
+        CEfiUSize n_pages;
+        CEfiUSize spare_pages;
+        CEfiUSize n_used;
+        CEfiUSize n_capsules;
+        CEfiU64 total_size;
+        CEfiCapsuleHeader *capsules[C_EFI_CAPSULE_BUILDER_N_CAPSULES];
+} CEfiCapsuleBuilder;
+
+/**
+ * c_efi_capsule_builder_init() - Initialize capsule builder
+ * @b:                  builder to initialize
+ * @st:                 system table
+ */
+static inline void c_efi_capsule_builder_init(CEfiCapsuleBuilder *b, CEfiSystemTable *st) {
+        *b = (CEfiCapsuleBuilder){
+                .st = st,
+        };
+}
+
+static inline void c_efi_capsule_builder_free(CEfiCapsuleBuilder *b, CEfiCapsuleBlockDescriptor *block) {
+        CEfiCapsuleBlockDescriptor *next;
+
+        while (block) {
+                next = (void *)(CEfiUSize)block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1].continuation_pointer;
+                b->st->boot_services->free_pages((CEfiPhysicalAddress)(CEfiUSize)block, 1);
+                block = next;
+        }
+}
+
+/**
+ * c_efi_capsule_builder_deinit() - Release capsule builder
+ * @b:                  builder to release
+ *
+ * This frees all descriptor arrays. Note that capsules flagged with
+ * C_EFI_CAPSULE_FLAGS_PERSIST_ACROSS_RESET need the descriptor chain (and
+ * the payload) to stay untouched until the reset. Do not release the builder
+ * in that case.
+ */
+static inline void c_efi_capsule_builder_deinit(CEfiCapsuleBuilder *b) {
+        c_efi_capsule_builder_free(b, b->head);
+        c_efi_capsule_builder_free(b, b->spare);
+        c_efi_capsule_builder_init(b, b->st);
+}
+
+static inline CEfiStatus c_efi_capsule_builder_reserve(CEfiCapsuleBuilder *b, CEfiUSize n_blocks) {
+        CEfiCapsuleBlockDescriptor *list = C_EFI_NULL, *block;
+        CEfiUSize i, n_free, n_pages;
+        CEfiPhysicalAddress page;
+        CEfiStatus r;
+
+        /*
+         * Allocate all descriptor arrays needed for @n_blocks more data blocks
+         * upfront, so adding a capsule either fully succeeds or leaves the
+         * chain untouched. Spare arrays are linked through their last entry.
+         */
+        n_free = b->spare_pages * (C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1);
+        if (b->block)
+                n_free += C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1 - b->n_used;
+        if (n_blocks <= n_free)
+                return C_EFI_SUCCESS;
+
+        n_pages = (n_blocks - n_free + C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 2) /
+                  (C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1);
+
+        for (i = 0; i < n_pages; ++i) {
+                r = b->st->boot_services->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES,
+                                                         C_EFI_LOADER_DATA,
+                                                         1,
+                                                         &page);
+                if (C_EFI_ERROR(r)) {
+                        c_efi_capsule_builder_free(b, list);
+                        return r;
+                }
+
+                block = (void *)(CEfiUSize)page;
+                block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1] = (CEfiCapsuleBlockDescriptor){
+                        .continuation_pointer = (CEfiPhysicalAddress)(CEfiUSize)list,
+                };
+                list = block;
+        }
+
+        block = list;
+        while (block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1].continuation_pointer)
+                block = (void *)(CEfiUSize)block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1].continuation_pointer;
+        block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1].continuation_pointer = (CEfiPhysicalAddress)(CEfiUSize)b->spare;
+        b->spare = list;
+        b->spare_pages += n_pages;
+
+        return C_EFI_SUCCESS;
+}
+
+static inline void c_efi_capsule_builder_push(CEfiCapsuleBuilder *b, const void *data, CEfiU64 size) {
+        CEfiCapsuleBlockDescriptor *block;
+
+        /*
+         * The last entry of each array is reserved for the continuation
+         * pointer, all other entries carry data. The entry following the last
+         * data block is always kept as null terminator, so the chain is valid
+         * at any time. Arrays are taken from the spare list, which was filled
+         * by c_efi_capsule_builder_reserve() before.
+         */
+        if (!b->block || b->n_used >= C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1) {
+                block = b->spare;
+                b->spare = (void *)(CEfiUSize)block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1].continuation_pointer;
+                --b->spare_pages;
+
+                block[0] = (CEfiCapsuleBlockDescriptor){ 0 };
+                block[C_EFI_CAPSULE_BUILDER_N_DESCRIPTORS - 1] = (CEfiCapsuleBlockDescriptor){ 0 };
+
+                if (b->block)
+                        b->block[b->n_used].continuation_pointer = (CEfiPhysicalAddress)(CEfiUSize)block;
+                else
+                        b->head = block;
+
+                b->block = block;
+                b->n_used = 0;
+                ++b->n_pages;
+        }
+
+        b->block[b->n_used].length = size;
+        b->block[b->n_used].data_block = (CEfiPhysicalAddress)(CEfiUSize)data;
+        ++b->n_used;
+        b->block[b->n_used] = (CEfiCapsuleBlockDescriptor){ 0 };
+}
+
+/**
+ * c_efi_capsule_builder_add() - Add capsule to builder
+ * @b:                  builder to operate on
+ * @segments:           array of capsule segments
+ * @n_segments:         number of entries in @segments
+ *
+ * This adds a capsule spread over the given segments to the scatter-gather
+ * chain. The first segment must start with the CEfiCapsuleHeader of the
+ * capsule, and must be large enough to contain it. The sum of all segment
+ * sizes must match the capsule image size of the header. Empty segments are
+ * skipped. Segment data is referenced, not copied, and must stay valid until
+ * the capsule was submitted.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if the capsule
+ *         header does not match the segments, C_EFI_OUT_OF_RESOURCES if the
+ *         builder cannot take more capsules, or the error of AllocatePages().
+ *         On error, the builder is left unchanged.
+ */
+static inline CEfiStatus c_efi_capsule_builder_add(CEfiCapsuleBuilder *b,
+                                                   const CEfiCapsuleSegment *segments,
+                                                   CEfiUSize n_segments) {
+        CEfiCapsuleHeader *header;
+        CEfiUSize i, n_blocks = 0;
+        CEfiU64 size = 0;
+        CEfiStatus r;
+
+        if (!n_segments || segments[0].size < sizeof(CEfiCapsuleHeader))
+                return C_EFI_INVALID_PARAMETER;
+        if (b->n_capsules >= C_EFI_CAPSULE_BUILDER_N_CAPSULES)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        header = (CEfiCapsuleHeader *)segments[0].data;
+        if (header->header_size < sizeof(CEfiCapsuleHeader) ||
+            header->header_size > header->capsule_image_size)
+                return C_EFI_INVALID_PARAMETER;
+
+        for (i = 0; i < n_segments; ++i) {
+                size += segments[i].size;
+                if (size < segments[i].size || size > header->capsule_image_size)
+                        return C_EFI_INVALID_PARAMETER;
+                n_blocks += !!segments[i].size;
+        }
+        if (size != header->capsule_image_size)
+                return C_EFI_INVALID_PARAMETER;
+
+        r = c_efi_capsule_builder_reserve(b, n_blocks);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        for (i = 0; i < n_segments; ++i)
+                if (segments[i].size)
+                        c_efi_capsule_builder_push(b, segments[i].data, segments[i].size);
+
+        b->capsules[b->n_capsules++] = header;
+        b->total_size += size;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_capsule_builder_query() - Query capsule capabilities
+ * @b:                  builder to operate on
+ * @reset_typep:        output argument for the required reset type, or NULL
+ *
+ * This calls QueryCapsuleCapabilities() for all added capsules and verifies
+ * that their total size does not exceed the maximum capsule size reported by
+ * the firmware.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_READY if no capsule was added,
+ *         C_EFI_BAD_BUFFER_SIZE if the capsules are too big, or the error of
+ *         QueryCapsuleCapabilities().
+ */
+static inline CEfiStatus c_efi_capsule_builder_query(CEfiCapsuleBuilder *b, CEfiResetType *reset_typep) {
+        CEfiResetType reset_type;
+        CEfiU64 max_size;
+        CEfiStatus r;
+
+        if (!b->n_capsules)
+                return C_EFI_NOT_READY;
+
+        r = b->st->runtime_services->query_capsule_capabilities(b->capsules,
+                                                                b->n_capsules,
+                                                                &max_size,
+                                                                &reset_type);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (b->total_size > max_size)
+                return C_EFI_BAD_BUFFER_SIZE;
+
+        if (reset_typep)
+                *reset_typep = reset_type;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_capsule_builder_submit() - Submit capsules to the firmware
+ * @b:                  builder to operate on
+ * @reset_typep:        output argument for the required reset type, or NULL
+ *
+ * This queries the capsule capabilities via c_efi_capsule_builder_query()
+ * and then passes all added capsules together with the scatter-gather chain
+ * to UpdateCapsule(). If the capsules require a reset, the caller must
+ * perform it via ResetSystem() with the returned reset type.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of the query or of
+ *         UpdateCapsule().
+ */
+static inline CEfiStatus c_efi_capsule_builder_submit(CEfiCapsuleBuilder *b, CEfiResetType *reset_typep) {
+        CEfiStatus r;
+
+        r = c_efi_capsule_builder_query(b, reset_typep);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        return b->st->runtime_services->update_capsule(b->capsules,
+                                                       b->n_capsules,
+                                                       (CEfiPhysicalAddress)(CEfiUSize)b->head);
+}
+
+#ifdef __cplusplus
+}
+#endif
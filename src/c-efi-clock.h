@@ -0,0 +1,330 @@
+#pragma once
+
+/**
+ * CPU Counter Clock
+ *
+ * UEFI provides no high-resolution clock. The `get_time` runtime service reads
+ * the RTC, often through slow I/O ports, and `get_next_monotonic_count` has an
+ * unspecified resolution. This header provides access to the free-running CPU
+ * counter instead: the TSC on x86, the virtual counter on ARMv8 and the time
+ * CSR on RISC-V. Reading it costs a single instruction.
+ *
+ * The counter frequency is only architecturally defined on some platforms.
+ * c_efi_clock_frequency() reports it where it is, and 0 otherwise. Where it is
+ * not, c_efi_clock_calibrate() measures it against the `stall` boot service.
+ * Nominal frequencies, like the base frequency of x86 processors, are only
+ * hints, see c_efi_clock_frequency_hint(), which a measurement must confirm.
+ *
+ * CEfiClock turns counter values into nanoseconds. The conversion factors are
+ * precomputed as 32.32 fixed-point values, so a read is the counter
+ * instruction followed by a single widening multiplication, without division.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-simd.h>
+
+#define C_EFI_CLOCK_CALIBRATE_US C_EFI_U64_C(10000)
+
+/**
+ * CEfiClock: Calibrated Monotonic Clock
+ * @ticks_per_second:   frequency of the CPU counter, 0 if unknown
+ * @base_ticks:         CPU counter value at initialization
+ * @ns_mult:            nanoseconds per tick, 32.32 fixed-point
+ * @ticks_mult:         ticks per nanosecond, 32.32 fixed-point
+ *
+ * A clock counts nanoseconds since its initialization. It is read-only after
+ * c_efi_clock_init() and can be shared freely, including across processors,
+ * as long as their counters are synchronized.
+ */
+typedef struct CEfiClock {
+        CEfiU64 ticks_per_second;
+        CEfiU64 base_ticks;
+        CEfiU64 ns_mult;
+        CEfiU64 ticks_mult;
+} CEfiClock;
+
+/**
+ * c_efi_clock_ticks() - Read the CPU counter
+ *
+ * This is the counter reader of all headers, so timestamps of the boot trace
+ * and clock readings come from the same source. On ARMv8, an ISB keeps the
+ * read from being executed ahead of preceding instructions.
+ *
+ * Return: The current counter value, or 0 if the architecture has none.
+ */
+static inline CEfiU64 c_efi_clock_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        CEfiU32 lo, hi;
+
+        __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+        return ((CEfiU64)hi << 32) | lo;
+#elif defined(__aarch64__)
+        CEfiU64 v;
+
+        __asm__ __volatile__ ("isb\n\tmrs %0, cntvct_el0" : "=r" (v) : : "memory");
+        return v;
+#elif defined(__riscv) && __riscv_xlen == 64
+        CEfiU64 v;
+
+        __asm__ __volatile__ ("rdtime %0" : "=r" (v));
+        return v;
+#else
+        return 0;
+#endif
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* whether the TSC runs at a constant rate in all P-, C- and T-states */
+static inline CEfiBool c_efi_clock_tsc_invariant(void) {
+        CEfiU32 regs[4];
+
+        c_efi_simd_cpuid(0x80000000, 0, regs);
+        if (regs[0] < 0x80000007)
+                return 0;
+
+        c_efi_simd_cpuid(0x80000007, 0, regs);
+        return !!(regs[3] & (C_EFI_U32_C(1) << 8));
+}
+
+#endif
+
+/**
+ * c_efi_clock_frequency() - Query the architectural counter frequency
+ *
+ * This reports the frequency of c_efi_clock_ticks() where the architecture
+ * defines it: CNTFRQ_EL0 on ARMv8, and the TSC/crystal ratio of CPUID leaf
+ * 0x15 on x86. The latter is only used if the TSC is invariant and the leaf
+ * enumerates the crystal frequency, since many processors report the ratio
+ * alone. No attempt at measuring is made.
+ *
+ * Return: Counter frequency in Hz, or 0 if unknown.
+ */
+static inline CEfiU64 c_efi_clock_frequency(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        CEfiU32 regs[4];
+
+        if (!c_efi_clock_tsc_invariant())
+                return 0;
+
+        c_efi_simd_cpuid(0, 0, regs);
+        if (regs[0] < 0x15)
+                return 0;
+
+        /* EAX and EBX are the TSC/crystal ratio, ECX the crystal in Hz */
+        c_efi_simd_cpuid(0x15, 0, regs);
+        if (!regs[0] || !regs[1] || !regs[2])
+                return 0;
+
+        return (CEfiU64)regs[2] * regs[1] / regs[0];
+#elif defined(__aarch64__)
+        CEfiU64 v;
+
+        __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (v));
+        return v;
+#else
+        return 0;
+#endif
+}
+
+/**
+ * c_efi_clock_frequency_hint() - Query the nominal counter frequency
+ *
+ * This reports the base frequency of CPUID leaf 0x16 on x86 processors with
+ * an invariant TSC. The TSC usually runs at that frequency, but it is
+ * rounded to MHz and not guaranteed to match, so it must be confirmed by a
+ * measurement before use.
+ *
+ * Return: Nominal counter frequency in Hz, or 0 if unknown.
+ */
+static inline CEfiU64 c_efi_clock_frequency_hint(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        CEfiU32 regs[4];
+
+        if (!c_efi_clock_tsc_invariant())
+                return 0;
+
+        c_efi_simd_cpuid(0, 0, regs);
+        if (regs[0] < 0x16)
+                return 0;
+
+        c_efi_simd_cpuid(0x16, 0, regs);
+        return (CEfiU64)(regs[0] & 0xffff) * 1000000;
+#else
+        return 0;
+#endif
+}
+
+/* (@v * @mult) >> 32, without losing the upper bits of the product */
+static inline CEfiU64 c_efi_clock_scale(CEfiU64 v, CEfiU64 mult) {
+#if defined(__SIZEOF_INT128__)
+        return (CEfiU64)(((unsigned __int128)v * mult) >> 32);
+#else
+        CEfiU64 vl = (CEfiU32)v, vh = v >> 32, ml = (CEfiU32)mult, mh = mult >> 32;
+
+        return ((vh * mh) << 32) + vh * ml + vl * mh + ((vl * ml) >> 32);
+#endif
+}
+
+/* counter ticks spent in `stall(@us)`, including the call overhead */
+static inline CEfiU64 c_efi_clock_measure_stall(CEfiBootServices *bs, CEfiUSize us) {
+        CEfiU64 t;
+
+        t = c_efi_clock_ticks();
+        bs->stall(us);
+        return c_efi_clock_ticks() - t;
+}
+
+/**
+ * c_efi_clock_calibrate() - Measure the CPU counter frequency
+ * @bs:                 boot services
+ * @window_us:          length of the measurement, or 0 for the default
+ * @ticks_per_secondp:  output for the counter frequency in Hz
+ *
+ * This measures the counter against the `stall` boot service, which firmware
+ * implements as a busy-wait on its own calibrated timer. Timer events of
+ * `set_timer` are not used, since they only fire on the firmware timer tick,
+ * which is commonly 10ms and thus coarser than the window itself.
+ *
+ * Each round stalls for @window_us and for a tenth of it, and uses the
+ * difference, so the call overhead cancels out. The median of three rounds is
+ * returned. The default window of C_EFI_CLOCK_CALIBRATE_US gives an error well
+ * below 0.1% and delays boot by about 35ms.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_UNSUPPORTED if there is no CPU
+ *         counter, or if it did not advance.
+ */
+static inline CEfiStatus c_efi_clock_calibrate(CEfiBootServices *bs,
+                                               CEfiUSize window_us,
+                                               CEfiU64 *ticks_per_secondp) {
+        CEfiU64 f[3], t, d_short, d_long;
+        CEfiUSize i, short_us;
+
+        if (!window_us)
+                window_us = C_EFI_CLOCK_CALIBRATE_US;
+        short_us = window_us / 10;
+
+        /* fault in the code paths of the firmware */
+        bs->stall(1);
+
+        for (i = 0; i < 3; ++i) {
+                d_short = c_efi_clock_measure_stall(bs, short_us);
+                d_long = c_efi_clock_measure_stall(bs, window_us);
+                if (d_long <= d_short)
+                        return C_EFI_UNSUPPORTED;
+
+                f[i] = (d_long - d_short) * C_EFI_U64_C(1000000) / (window_us - short_us);
+        }
+
+        /* median of three */
+        if (f[0] > f[1]) {
+                t = f[0];
+                f[0] = f[1];
+                f[1] = t;
+        }
+        if (f[1] > f[2])
+                f[1] = f[0] > f[2] ? f[0] : f[2];
+
+        *ticks_per_secondp = f[1];
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_clock_init() - Initialize a clock
+ * @clock:              clock to initialize
+ * @ticks_per_second:   frequency of the CPU counter, 0 if unknown
+ *
+ * This precomputes the conversion factors for @ticks_per_second and starts
+ * the clock at 0. If @ticks_per_second is 0, the clock always reads 0.
+ */
+static inline void c_efi_clock_init(CEfiClock *clock, CEfiU64 ticks_per_second) {
+        CEfiU64 ns = C_EFI_U64_C(1000000000);
+
+        *clock = (CEfiClock){
+                .ticks_per_second = ticks_per_second,
+                .base_ticks = c_efi_clock_ticks(),
+        };
+
+        if (ticks_per_second) {
+                clock->ns_mult = (ns << 32) / ticks_per_second;
+                clock->ticks_mult = ((ticks_per_second / ns) << 32) +
+                                    ((ticks_per_second % ns) << 32) / ns;
+        }
+}
+
+/**
+ * c_efi_clock_setup() - Initialize a clock from the best available frequency
+ * @clock:              clock to initialize
+ * @bs:                 boot services
+ *
+ * This uses the architectural frequency of c_efi_clock_frequency() if known,
+ * and calibrates with the default window otherwise. If the measurement is
+ * within 1% of c_efi_clock_frequency_hint(), the exact nominal frequency is
+ * used instead.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of c_efi_clock_calibrate().
+ *         On error, @clock is initialized but always reads 0.
+ */
+static inline CEfiStatus c_efi_clock_setup(CEfiClock *clock, CEfiBootServices *bs) {
+        CEfiU64 f, hint;
+        CEfiStatus r = C_EFI_SUCCESS;
+
+        f = c_efi_clock_frequency();
+        if (!f) {
+                r = c_efi_clock_calibrate(bs, 0, &f);
+                if (C_EFI_ERROR(r)) {
+                        f = 0;
+                } else {
+                        hint = c_efi_clock_frequency_hint();
+                        if (f > hint - hint / 100 && f < hint + hint / 100)
+                                f = hint;
+                }
+        }
+
+        c_efi_clock_init(clock, f);
+        return r;
+}
+
+/**
+ * c_efi_clock_ticks_to_ns() - Convert counter ticks to nanoseconds
+ * @clock:              clock to use
+ * @ticks:              number of ticks
+ *
+ * Return: The duration of @ticks in nanoseconds.
+ */
+static inline CEfiU64 c_efi_clock_ticks_to_ns(const CEfiClock *clock, CEfiU64 ticks) {
+        return c_efi_clock_scale(ticks, clock->ns_mult);
+}
+
+/**
+ * c_efi_clock_ns_to_ticks() - Convert nanoseconds to counter ticks
+ * @clock:              clock to use
+ * @ns:                 number of nanoseconds
+ *
+ * This is meant for timeouts: a deadline is computed once as counter value,
+ * and then compared against c_efi_clock_ticks() without conversion.
+ *
+ * Return: The number of ticks in @ns nanoseconds.
+ */
+static inline CEfiU64 c_efi_clock_ns_to_ticks(const CEfiClock *clock, CEfiU64 ns) {
+        return c_efi_clock_scale(ns, clock->ticks_mult);
+}
+
+/**
+ * c_efi_clock_ns() - Read a clock
+ * @clock:              clock to read
+ *
+ * Return: Nanoseconds since @clock was initialized.
+ */
+static inline CEfiU64 c_efi_clock_ns(const CEfiClock *clock) {
+        return c_efi_clock_ticks_to_ns(clock, c_efi_clock_ticks() - clock->base_ticks);
+}
+
+#ifdef __cplusplus
+}
+#endif
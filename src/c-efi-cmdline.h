@@ -0,0 +1,506 @@
+#pragma once
+
+/**
+ * Load Options Command-Line Parser
+ *
+ * The `load_options` of CEfiLoadedImageProtocol carry the command line of an
+ * image when started from the shell or a boot entry. They are UCS-2, but
+ * neither NUL-termination nor textual content is guaranteed: boot entries can
+ * pass arbitrary binary data.
+ *
+ * This header splits the command line into arguments, following the quoting
+ * rules of the UEFI Shell: arguments are separated by whitespace, double
+ * quotes group whitespace into an argument, and `^` escapes the following
+ * character. Arguments are unescaped in place and returned as slices of the
+ * original buffer, hence no allocations are performed, but the load options
+ * are modified.
+ *
+ * Accessors convert arguments to integers, sizes, booleans, GUIDs and device
+ * paths. The shell passes the image path as first argument, while boot
+ * entries usually do not, so skipping it is up to the caller.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-protocol-device-path.h>
+#include <c-efi-protocol-device-path-from-text.h>
+
+/**
+ * CEfiCmdline: Command-Line Iterator
+ * @pos:                next character to parse
+ * @end:                end of the command line
+ */
+typedef struct CEfiCmdline {
+        CEfiChar16 *pos;
+        CEfiChar16 *end;
+} CEfiCmdline;
+
+/**
+ * CEfiCmdlineArg: Command-Line Argument
+ * @s:                  start of the unescaped argument, not NUL-terminated
+ * @n:                  length of the argument in characters
+ *
+ * An argument is a slice of the load options. @s is NULL for absent values,
+ * see c_efi_cmdline_arg_option().
+ */
+typedef struct CEfiCmdlineArg {
+        CEfiChar16 *s;
+        CEfiUSize n;
+} CEfiCmdlineArg;
+
+static inline CEfiBool c_efi_cmdline_is_space(CEfiChar16 c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* value of a hexadecimal digit, or 0xff */
+static inline CEfiU8 c_efi_cmdline_hex(CEfiChar16 c) {
+        if (c >= '0' && c <= '9')
+                return c - '0';
+        if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+        return 0xff;
+}
+
+static inline CEfiChar16 c_efi_cmdline_lower(CEfiChar16 c) {
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/**
+ * c_efi_cmdline_init() - Initialize command-line iterator
+ * @cmdline:            iterator to initialize
+ * @load_options:       load options of the image, or NULL
+ * @load_options_size:  size of @load_options in bytes
+ *
+ * This checks that @load_options is a UCS-2 string, and prepares @cmdline to
+ * iterate its arguments. The string ends at the first NUL character, or at
+ * the end of the buffer. Anything other than trailing NUL characters after
+ * it, control characters other than whitespace, an odd size and a misaligned
+ * buffer are taken as signs of binary data.
+ *
+ * On error, @cmdline is initialized as empty.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_UNSUPPORTED if @load_options are
+ *         not a UCS-2 string.
+ */
+static inline CEfiStatus c_efi_cmdline_init(CEfiCmdline *cmdline, void *load_options, CEfiUSize load_options_size) {
+        CEfiChar16 *s = load_options, c;
+        CEfiUSize i, j, n = load_options_size / sizeof(CEfiChar16);
+
+        *cmdline = (CEfiCmdline){ 0 };
+
+        if (!s || !load_options_size)
+                return C_EFI_SUCCESS;
+        if ((load_options_size & 1) || ((CEfiUSize)s & 1))
+                return C_EFI_UNSUPPORTED;
+
+        for (i = 0; i < n && s[i]; ++i) {
+                c = s[i];
+                if ((c < 0x20 && !c_efi_cmdline_is_space(c)) || c == 0x7f || c >= 0xfffe)
+                        return C_EFI_UNSUPPORTED;
+        }
+
+        for (j = i; j < n; ++j)
+                if (s[j])
+                        return C_EFI_UNSUPPORTED;
+
+        cmdline->pos = s;
+        cmdline->end = s + i;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_next() - Get next argument
+ * @cmdline:            iterator to use
+ * @argp:               output for the argument
+ *
+ * This parses the next argument of @cmdline, removes quotes and escapes in
+ * place, and returns it as slice in @argp. Quoted empty strings produce empty
+ * arguments.
+ *
+ * The argument is validated before it is unescaped, so on error neither the
+ * load options nor @cmdline are modified, and the same error is returned
+ * again on the next call.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_FOUND if no arguments are
+ *         left, C_EFI_INVALID_PARAMETER on unterminated quotes or a trailing
+ *         escape character.
+ */
+static inline CEfiStatus c_efi_cmdline_next(CEfiCmdline *cmdline, CEfiCmdlineArg *argp) {
+        CEfiChar16 *pos = cmdline->pos, *end = cmdline->end, *start, *stop, *w, c;
+        CEfiBool quoted = C_EFI_FALSE;
+
+        while (pos < end && c_efi_cmdline_is_space(*pos))
+                ++pos;
+        if (pos >= end) {
+                cmdline->pos = end;
+                return C_EFI_NOT_FOUND;
+        }
+
+        /* find the end of the argument, before anything is rewritten */
+        for (start = pos; pos < end; ++pos) {
+                c = *pos;
+                if (!quoted && c_efi_cmdline_is_space(c))
+                        break;
+                if (c == '"') {
+                        quoted = !quoted;
+                } else if (c == '^') {
+                        if (++pos >= end)
+                                return C_EFI_INVALID_PARAMETER;
+                }
+        }
+
+        if (quoted)
+                return C_EFI_INVALID_PARAMETER;
+
+        stop = pos;
+        for (pos = w = start; pos < stop; ) {
+                c = *pos++;
+                if (c == '"')
+                        continue;
+                if (c == '^')
+                        c = *pos++;
+                *w++ = c;
+        }
+
+        cmdline->pos = stop;
+        *argp = (CEfiCmdlineArg){ .s = start, .n = w - start };
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_arg_equal() - Compare argument to ASCII string
+ * @arg:                argument to compare
+ * @str:                NUL-terminated ASCII string
+ *
+ * Return: True if @arg equals @str, false otherwise.
+ */
+static inline CEfiBool c_efi_cmdline_arg_equal(const CEfiCmdlineArg *arg, const char *str) {
+        CEfiUSize i;
+
+        for (i = 0; i < arg->n; ++i)
+                if (!str[i] || arg->s[i] != (CEfiU8)str[i])
+                        return C_EFI_FALSE;
+
+        return !str[i];
+}
+
+static inline CEfiBool c_efi_cmdline_arg_equal_ci(const CEfiCmdlineArg *arg, const char *str) {
+        CEfiUSize i;
+
+        for (i = 0; i < arg->n; ++i)
+                if (!str[i] || c_efi_cmdline_lower(arg->s[i]) != c_efi_cmdline_lower((CEfiU8)str[i]))
+                        return C_EFI_FALSE;
+
+        return !str[i];
+}
+
+/**
+ * c_efi_cmdline_arg_option() - Match option argument
+ * @arg:                argument to match
+ * @name:               NUL-terminated ASCII option name, including dashes
+ * @valuep:             output for the value, or NULL
+ *
+ * This matches @arg against `name` and `name=value`. On match, the value is
+ * returned in @valuep, with @s set to NULL if there is no `=`.
+ *
+ * Return: True if @arg matches @name, false otherwise.
+ */
+static inline CEfiBool c_efi_cmdline_arg_option(const CEfiCmdlineArg *arg, const char *name, CEfiCmdlineArg *valuep) {
+        CEfiUSize i;
+
+        for (i = 0; name[i]; ++i)
+                if (i >= arg->n || arg->s[i] != (CEfiU8)name[i])
+                        return C_EFI_FALSE;
+
+        if (i < arg->n && arg->s[i] != '=')
+                return C_EFI_FALSE;
+
+        if (valuep) {
+                if (i < arg->n)
+                        *valuep = (CEfiCmdlineArg){ .s = arg->s + i + 1, .n = arg->n - i - 1 };
+                else
+                        *valuep = (CEfiCmdlineArg){ 0 };
+        }
+        return C_EFI_TRUE;
+}
+
+/* parse an unsigned decimal or `0x` hexadecimal prefix of @arg at @ip */
+static inline CEfiStatus c_efi_cmdline_scan_u64(const CEfiCmdlineArg *arg, CEfiUSize *ip, CEfiU64 *vp) {
+        CEfiUSize i = *ip, start;
+        CEfiU64 v = 0, base = 10;
+        CEfiU8 d;
+
+        if (arg->n - i > 2 && arg->s[i] == '0' && (arg->s[i + 1] == 'x' || arg->s[i + 1] == 'X')) {
+                base = 16;
+                i += 2;
+        }
+
+        for (start = i; i < arg->n; ++i) {
+                d = c_efi_cmdline_hex(arg->s[i]);
+                if (d >= base)
+                        break;
+                if (v > (C_EFI_U64_C(0xffffffffffffffff) - d) / base)
+                        return C_EFI_UNSUPPORTED;
+                v = v * base + d;
+        }
+
+        if (i == start)
+                return C_EFI_INVALID_PARAMETER;
+
+        *ip = i;
+        *vp = v;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_parse_u64() - Parse unsigned integer argument
+ * @arg:                argument to parse
+ * @vp:                 output for the value
+ *
+ * This accepts decimal numbers, and hexadecimal numbers prefixed with `0x`.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @arg is not a
+ *         number, C_EFI_UNSUPPORTED if it does not fit into 64 bits.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_u64(const CEfiCmdlineArg *arg, CEfiU64 *vp) {
+        CEfiUSize i = 0;
+        CEfiStatus r;
+        CEfiU64 v;
+
+        r = c_efi_cmdline_scan_u64(arg, &i, &v);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (i != arg->n)
+                return C_EFI_INVALID_PARAMETER;
+
+        *vp = v;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_parse_i64() - Parse signed integer argument
+ * @arg:                argument to parse
+ * @vp:                 output for the value
+ *
+ * This is like c_efi_cmdline_parse_u64(), but accepts a leading sign.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @arg is not a
+ *         number, C_EFI_UNSUPPORTED if it does not fit into 64 bits.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_i64(const CEfiCmdlineArg *arg, CEfiI64 *vp) {
+        CEfiCmdlineArg a = *arg;
+        CEfiBool negative;
+        CEfiStatus r;
+        CEfiU64 v;
+
+        negative = a.n && a.s[0] == '-';
+        if (a.n && (a.s[0] == '-' || a.s[0] == '+')) {
+                ++a.s;
+                --a.n;
+        }
+
+        r = c_efi_cmdline_parse_u64(&a, &v);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (v > C_EFI_U64_C(0x7fffffffffffffff) + negative)
+                return C_EFI_UNSUPPORTED;
+
+        *vp = negative ? (CEfiI64)(C_EFI_U64_C(0) - v) : (CEfiI64)v;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_parse_size() - Parse size argument
+ * @arg:                argument to parse
+ * @vp:                 output for the size in bytes
+ *
+ * This accepts a number as c_efi_cmdline_parse_u64() does, optionally
+ * followed by one of the binary suffixes `K`, `M`, `G` and `T`, in any case,
+ * and an optional `B`. Hexadecimal digits take precedence, so `0x1B` is 27.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @arg is not a
+ *         size, C_EFI_UNSUPPORTED if it does not fit into 64 bits.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_size(const CEfiCmdlineArg *arg, CEfiU64 *vp) {
+        CEfiUSize i = 0, shift = 0;
+        CEfiStatus r;
+        CEfiU64 v;
+
+        r = c_efi_cmdline_scan_u64(arg, &i, &v);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (i < arg->n) {
+                switch (c_efi_cmdline_lower(arg->s[i])) {
+                case 'k':
+                        shift = 10;
+                        ++i;
+                        break;
+                case 'm':
+                        shift = 20;
+                        ++i;
+                        break;
+                case 'g':
+                        shift = 30;
+                        ++i;
+                        break;
+                case 't':
+                        shift = 40;
+                        ++i;
+                        break;
+                }
+        }
+        if (i < arg->n && c_efi_cmdline_lower(arg->s[i]) == 'b')
+                ++i;
+        if (i != arg->n)
+                return C_EFI_INVALID_PARAMETER;
+        if (v > (C_EFI_U64_C(0xffffffffffffffff) >> shift))
+                return C_EFI_UNSUPPORTED;
+
+        *vp = v << shift;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_parse_bool() - Parse boolean argument
+ * @arg:                argument to parse
+ * @vp:                 output for the value
+ *
+ * This accepts `1`, `yes`, `y`, `true` and `on` as true, and `0`, `no`, `n`,
+ * `false` and `off` as false, in any case.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @arg is not a
+ *         boolean.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_bool(const CEfiCmdlineArg *arg, CEfiBool *vp) {
+        static const char *const values[] = {
+                "0", "1", "n", "y", "no", "yes", "false", "true", "off", "on",
+        };
+        CEfiUSize i;
+
+        for (i = 0; i < sizeof(values) / sizeof(*values); ++i) {
+                if (c_efi_cmdline_arg_equal_ci(arg, values[i])) {
+                        *vp = i & 1;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        return C_EFI_INVALID_PARAMETER;
+}
+
+/**
+ * c_efi_cmdline_parse_guid() - Parse GUID argument
+ * @arg:                argument to parse
+ * @guidp:              output for the GUID
+ *
+ * This accepts the registry format `xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx`,
+ * optionally enclosed in braces.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @arg is not a
+ *         GUID.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_guid(const CEfiCmdlineArg *arg, CEfiGuid *guidp) {
+        CEfiU8 b[16], d;
+        const CEfiChar16 *s = arg->s;
+        CEfiUSize i, j = 0, n = arg->n;
+
+        if (n == 38 && s[0] == '{' && s[37] == '}') {
+                ++s;
+                n -= 2;
+        }
+        if (n != 36)
+                return C_EFI_INVALID_PARAMETER;
+
+        for (i = 0; i < 36; ++i) {
+                if (i == 8 || i == 13 || i == 18 || i == 23) {
+                        if (s[i] != '-')
+                                return C_EFI_INVALID_PARAMETER;
+                        continue;
+                }
+
+                d = c_efi_cmdline_hex(s[i]);
+                if (d > 15)
+                        return C_EFI_INVALID_PARAMETER;
+                if (j & 1)
+                        b[j / 2] |= d;
+                else
+                        b[j / 2] = d << 4;
+                ++j;
+        }
+
+        /* the first three groups are little-endian */
+        *guidp = C_EFI_GUID((CEfiU32)b[0] << 24 | (CEfiU32)b[1] << 16 | (CEfiU32)b[2] << 8 | b[3],
+                            b[4] << 8 | b[5],
+                            b[6] << 8 | b[7],
+                            b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_arg_copy() - Copy argument as NUL-terminated string
+ * @arg:                argument to copy
+ * @buf:                destination buffer
+ * @n_buf:              size of @buf in characters
+ *
+ * Arguments are not NUL-terminated, but most protocols expect strings to be.
+ * This copies @arg into a caller-provided buffer, usually on the stack.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @buf has less
+ *         than `n + 1` characters.
+ */
+static inline CEfiStatus c_efi_cmdline_arg_copy(const CEfiCmdlineArg *arg, CEfiChar16 *buf, CEfiUSize n_buf) {
+        CEfiUSize i;
+
+        if (n_buf <= arg->n)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        for (i = 0; i < arg->n; ++i)
+                buf[i] = arg->s[i];
+        buf[i] = 0;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_cmdline_parse_device_path() - Parse device path argument
+ * @arg:                argument to parse
+ * @from_text:          device path from text protocol
+ * @buf:                scratch buffer for the NUL-terminated text
+ * @n_buf:              size of @buf in characters
+ * @pathp:              output for the device path
+ *
+ * This converts the textual device path @arg via @from_text. The conversion
+ * itself is done by the firmware, which allocates the result from pool
+ * memory. It must be released with `free_pool` by the caller.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @buf is too
+ *         small, C_EFI_INVALID_PARAMETER if the firmware rejects @arg.
+ */
+static inline CEfiStatus c_efi_cmdline_parse_device_path(const CEfiCmdlineArg *arg,
+                                                         CEfiDevicePathFromTextProtocol *from_text,
+                                                         CEfiChar16 *buf,
+                                                         CEfiUSize n_buf,
+                                                         CEfiDevicePathProtocol **pathp) {
+        CEfiDevicePathProtocol *path;
+        CEfiStatus r;
+
+        r = c_efi_cmdline_arg_copy(arg, buf, n_buf);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        path = from_text->convert_text_to_device_path(buf);
+        if (!path)
+                return C_EFI_INVALID_PARAMETER;
+
+        *pathp = path;
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
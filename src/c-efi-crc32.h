@@ -0,0 +1,273 @@
+#pragma once
+
+/**
+ * CRC32 Checksums
+ *
+ * UEFI uses the IEEE 802.3 CRC32 (reflected polynomial 0xedb88320) for table
+ * headers, GPT headers and partition arrays, and capsules. The
+ * `calculate_crc32` boot service is unavailable after ExitBootServices() and
+ * often implemented bytewise. This header provides an inline implementation
+ * with per-architecture kernels:
+ *
+ *  - AArch64 uses the CRC32 instructions, if ID_AA64ISAR0_EL1 reports them.
+ *
+ *  - x86-64 folds 64 bytes per iteration with PCLMULQDQ, if CPUID reports it
+ *    and SSE is enabled, either at compile time or by c_efi_simd_enable() (see
+ *    'c-efi-simd.h'). SSE4.2 `crc32` is not used, since it implements the
+ *    Castagnoli polynomial.
+ *
+ *  - All other configurations, including RISC-V, use a 1KiB lookup table.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#if defined(__x86_64__)
+#  include <c-efi-simd.h>
+#endif
+
+static inline CEfiU32 c_efi_crc32_table(CEfiU32 crc, const CEfiU8 *p, CEfiUSize n) {
+        static const CEfiU32 table[256] = {
+                C_EFI_U32_C(0x00000000), C_EFI_U32_C(0x77073096), C_EFI_U32_C(0xee0e612c), C_EFI_U32_C(0x990951ba),
+                C_EFI_U32_C(0x076dc419), C_EFI_U32_C(0x706af48f), C_EFI_U32_C(0xe963a535), C_EFI_U32_C(0x9e6495a3),
+                C_EFI_U32_C(0x0edb8832), C_EFI_U32_C(0x79dcb8a4), C_EFI_U32_C(0xe0d5e91e), C_EFI_U32_C(0x97d2d988),
+                C_EFI_U32_C(0x09b64c2b), C_EFI_U32_C(0x7eb17cbd), C_EFI_U32_C(0xe7b82d07), C_EFI_U32_C(0x90bf1d91),
+                C_EFI_U32_C(0x1db71064), C_EFI_U32_C(0x6ab020f2), C_EFI_U32_C(0xf3b97148), C_EFI_U32_C(0x84be41de),
+                C_EFI_U32_C(0x1adad47d), C_EFI_U32_C(0x6ddde4eb), C_EFI_U32_C(0xf4d4b551), C_EFI_U32_C(0x83d385c7),
+                C_EFI_U32_C(0x136c9856), C_EFI_U32_C(0x646ba8c0), C_EFI_U32_C(0xfd62f97a), C_EFI_U32_C(0x8a65c9ec),
+                C_EFI_U32_C(0x14015c4f), C_EFI_U32_C(0x63066cd9), C_EFI_U32_C(0xfa0f3d63), C_EFI_U32_C(0x8d080df5),
+                C_EFI_U32_C(0x3b6e20c8), C_EFI_U32_C(0x4c69105e), C_EFI_U32_C(0xd56041e4), C_EFI_U32_C(0xa2677172),
+                C_EFI_U32_C(0x3c03e4d1), C_EFI_U32_C(0x4b04d447), C_EFI_U32_C(0xd20d85fd), C_EFI_U32_C(0xa50ab56b),
+                C_EFI_U32_C(0x35b5a8fa), C_EFI_U32_C(0x42b2986c), C_EFI_U32_C(0xdbbbc9d6), C_EFI_U32_C(0xacbcf940),
+                C_EFI_U32_C(0x32d86ce3), C_EFI_U32_C(0x45df5c75), C_EFI_U32_C(0xdcd60dcf), C_EFI_U32_C(0xabd13d59),
+                C_EFI_U32_C(0x26d930ac), C_EFI_U32_C(0x51de003a), C_EFI_U32_C(0xc8d75180), C_EFI_U32_C(0xbfd06116),
+                C_EFI_U32_C(0x21b4f4b5), C_EFI_U32_C(0x56b3c423), C_EFI_U32_C(0xcfba9599), C_EFI_U32_C(0xb8bda50f),
+                C_EFI_U32_C(0x2802b89e), C_EFI_U32_C(0x5f058808), C_EFI_U32_C(0xc60cd9b2), C_EFI_U32_C(0xb10be924),
+                C_EFI_U32_C(0x2f6f7c87), C_EFI_U32_C(0x58684c11), C_EFI_U32_C(0xc1611dab), C_EFI_U32_C(0xb6662d3d),
+                C_EFI_U32_C(0x76dc4190), C_EFI_U32_C(0x01db7106), C_EFI_U32_C(0x98d220bc), C_EFI_U32_C(0xefd5102a),
+                C_EFI_U32_C(0x71b18589), C_EFI_U32_C(0x06b6b51f), C_EFI_U32_C(0x9fbfe4a5), C_EFI_U32_C(0xe8b8d433),
+                C_EFI_U32_C(0x7807c9a2), C_EFI_U32_C(0x0f00f934), C_EFI_U32_C(0x9609a88e), C_EFI_U32_C(0xe10e9818),
+                C_EFI_U32_C(0x7f6a0dbb), C_EFI_U32_C(0x086d3d2d), C_EFI_U32_C(0x91646c97), C_EFI_U32_C(0xe6635c01),
+                C_EFI_U32_C(0x6b6b51f4), C_EFI_U32_C(0x1c6c6162), C_EFI_U32_C(0x856530d8), C_EFI_U32_C(0xf262004e),
+                C_EFI_U32_C(0x6c0695ed), C_EFI_U32_C(0x1b01a57b), C_EFI_U32_C(0x8208f4c1), C_EFI_U32_C(0xf50fc457),
+                C_EFI_U32_C(0x65b0d9c6), C_EFI_U32_C(0x12b7e950), C_EFI_U32_C(0x8bbeb8ea), C_EFI_U32_C(0xfcb9887c),
+                C_EFI_U32_C(0x62dd1ddf), C_EFI_U32_C(0x15da2d49), C_EFI_U32_C(0x8cd37cf3), C_EFI_U32_C(0xfbd44c65),
+                C_EFI_U32_C(0x4db26158), C_EFI_U32_C(0x3ab551ce), C_EFI_U32_C(0xa3bc0074), C_EFI_U32_C(0xd4bb30e2),
+                C_EFI_U32_C(0x4adfa541), C_EFI_U32_C(0x3dd895d7), C_EFI_U32_C(0xa4d1c46d), C_EFI_U32_C(0xd3d6f4fb),
+                C_EFI_U32_C(0x4369e96a), C_EFI_U32_C(0x346ed9fc), C_EFI_U32_C(0xad678846), C_EFI_U32_C(0xda60b8d0),
+                C_EFI_U32_C(0x44042d73), C_EFI_U32_C(0x33031de5), C_EFI_U32_C(0xaa0a4c5f), C_EFI_U32_C(0xdd0d7cc9),
+                C_EFI_U32_C(0x5005713c), C_EFI_U32_C(0x270241aa), C_EFI_U32_C(0xbe0b1010), C_EFI_U32_C(0xc90c2086),
+                C_EFI_U32_C(0x5768b525), C_EFI_U32_C(0x206f85b3), C_EFI_U32_C(0xb966d409), C_EFI_U32_C(0xce61e49f),
+                C_EFI_U32_C(0x5edef90e), C_EFI_U32_C(0x29d9c998), C_EFI_U32_C(0xb0d09822), C_EFI_U32_C(0xc7d7a8b4),
+                C_EFI_U32_C(0x59b33d17), C_EFI_U32_C(0x2eb40d81), C_EFI_U32_C(0xb7bd5c3b), C_EFI_U32_C(0xc0ba6cad),
+                C_EFI_U32_C(0xedb88320), C_EFI_U32_C(0x9abfb3b6), C_EFI_U32_C(0x03b6e20c), C_EFI_U32_C(0x74b1d29a),
+                C_EFI_U32_C(0xead54739), C_EFI_U32_C(0x9dd277af), C_EFI_U32_C(0x04db2615), C_EFI_U32_C(0x73dc1683),
+                C_EFI_U32_C(0xe3630b12), C_EFI_U32_C(0x94643b84), C_EFI_U32_C(0x0d6d6a3e), C_EFI_U32_C(0x7a6a5aa8),
+                C_EFI_U32_C(0xe40ecf0b), C_EFI_U32_C(0x9309ff9d), C_EFI_U32_C(0x0a00ae27), C_EFI_U32_C(0x7d079eb1),
+                C_EFI_U32_C(0xf00f9344), C_EFI_U32_C(0x8708a3d2), C_EFI_U32_C(0x1e01f268), C_EFI_U32_C(0x6906c2fe),
+                C_EFI_U32_C(0xf762575d), C_EFI_U32_C(0x806567cb), C_EFI_U32_C(0x196c3671), C_EFI_U32_C(0x6e6b06e7),
+                C_EFI_U32_C(0xfed41b76), C_EFI_U32_C(0x89d32be0), C_EFI_U32_C(0x10da7a5a), C_EFI_U32_C(0x67dd4acc),
+                C_EFI_U32_C(0xf9b9df6f), C_EFI_U32_C(0x8ebeeff9), C_EFI_U32_C(0x17b7be43), C_EFI_U32_C(0x60b08ed5),
+                C_EFI_U32_C(0xd6d6a3e8), C_EFI_U32_C(0xa1d1937e), C_EFI_U32_C(0x38d8c2c4), C_EFI_U32_C(0x4fdff252),
+                C_EFI_U32_C(0xd1bb67f1), C_EFI_U32_C(0xa6bc5767), C_EFI_U32_C(0x3fb506dd), C_EFI_U32_C(0x48b2364b),
+                C_EFI_U32_C(0xd80d2bda), C_EFI_U32_C(0xaf0a1b4c), C_EFI_U32_C(0x36034af6), C_EFI_U32_C(0x41047a60),
+                C_EFI_U32_C(0xdf60efc3), C_EFI_U32_C(0xa867df55), C_EFI_U32_C(0x316e8eef), C_EFI_U32_C(0x4669be79),
+                C_EFI_U32_C(0xcb61b38c), C_EFI_U32_C(0xbc66831a), C_EFI_U32_C(0x256fd2a0), C_EFI_U32_C(0x5268e236),
+                C_EFI_U32_C(0xcc0c7795), C_EFI_U32_C(0xbb0b4703), C_EFI_U32_C(0x220216b9), C_EFI_U32_C(0x5505262f),
+                C_EFI_U32_C(0xc5ba3bbe), C_EFI_U32_C(0xb2bd0b28), C_EFI_U32_C(0x2bb45a92), C_EFI_U32_C(0x5cb36a04),
+                C_EFI_U32_C(0xc2d7ffa7), C_EFI_U32_C(0xb5d0cf31), C_EFI_U32_C(0x2cd99e8b), C_EFI_U32_C(0x5bdeae1d),
+                C_EFI_U32_C(0x9b64c2b0), C_EFI_U32_C(0xec63f226), C_EFI_U32_C(0x756aa39c), C_EFI_U32_C(0x026d930a),
+                C_EFI_U32_C(0x9c0906a9), C_EFI_U32_C(0xeb0e363f), C_EFI_U32_C(0x72076785), C_EFI_U32_C(0x05005713),
+                C_EFI_U32_C(0x95bf4a82), C_EFI_U32_C(0xe2b87a14), C_EFI_U32_C(0x7bb12bae), C_EFI_U32_C(0x0cb61b38),
+                C_EFI_U32_C(0x92d28e9b), C_EFI_U32_C(0xe5d5be0d), C_EFI_U32_C(0x7cdcefb7), C_EFI_U32_C(0x0bdbdf21),
+                C_EFI_U32_C(0x86d3d2d4), C_EFI_U32_C(0xf1d4e242), C_EFI_U32_C(0x68ddb3f8), C_EFI_U32_C(0x1fda836e),
+                C_EFI_U32_C(0x81be16cd), C_EFI_U32_C(0xf6b9265b), C_EFI_U32_C(0x6fb077e1), C_EFI_U32_C(0x18b74777),
+                C_EFI_U32_C(0x88085ae6), C_EFI_U32_C(0xff0f6a70), C_EFI_U32_C(0x66063bca), C_EFI_U32_C(0x11010b5c),
+                C_EFI_U32_C(0x8f659eff), C_EFI_U32_C(0xf862ae69), C_EFI_U32_C(0x616bffd3), C_EFI_U32_C(0x166ccf45),
+                C_EFI_U32_C(0xa00ae278), C_EFI_U32_C(0xd70dd2ee), C_EFI_U32_C(0x4e048354), C_EFI_U32_C(0x3903b3c2),
+                C_EFI_U32_C(0xa7672661), C_EFI_U32_C(0xd06016f7), C_EFI_U32_C(0x4969474d), C_EFI_U32_C(0x3e6e77db),
+                C_EFI_U32_C(0xaed16a4a), C_EFI_U32_C(0xd9d65adc), C_EFI_U32_C(0x40df0b66), C_EFI_U32_C(0x37d83bf0),
+                C_EFI_U32_C(0xa9bcae53), C_EFI_U32_C(0xdebb9ec5), C_EFI_U32_C(0x47b2cf7f), C_EFI_U32_C(0x30b5ffe9),
+                C_EFI_U32_C(0xbdbdf21c), C_EFI_U32_C(0xcabac28a), C_EFI_U32_C(0x53b39330), C_EFI_U32_C(0x24b4a3a6),
+                C_EFI_U32_C(0xbad03605), C_EFI_U32_C(0xcdd70693), C_EFI_U32_C(0x54de5729), C_EFI_U32_C(0x23d967bf),
+                C_EFI_U32_C(0xb3667a2e), C_EFI_U32_C(0xc4614ab8), C_EFI_U32_C(0x5d681b02), C_EFI_U32_C(0x2a6f2b94),
+                C_EFI_U32_C(0xb40bbe37), C_EFI_U32_C(0xc30c8ea1), C_EFI_U32_C(0x5a05df1b), C_EFI_U32_C(0x2d02ef8d),
+        };
+
+        for ( ; n; --n)
+                crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+        return crc;
+}
+
+#if defined(__aarch64__)
+
+static inline CEfiBool c_efi_crc32_has_insn(void) {
+        static CEfiU32 cache;
+        CEfiU64 isar0;
+        CEfiU32 v;
+
+        /* bit 1 marks the cache as valid, bit 0 is the result */
+        v = __atomic_load_n(&cache, __ATOMIC_RELAXED);
+        if (!v) {
+                __asm__ ("mrs %0, ID_AA64ISAR0_EL1" : "=r" (isar0));
+                v = 2 | !!((isar0 >> 16) & 0xf);
+                __atomic_store_n(&cache, v, __ATOMIC_RELAXED);
+        }
+
+        return v & 1;
+}
+
+static inline CEfiU32 c_efi_crc32_insn(CEfiU32 crc, const CEfiU8 *p, CEfiUSize n) {
+        CEfiU64 v;
+
+        for ( ; n >= 8; n -= 8, p += 8) {
+                __builtin_memcpy(&v, p, sizeof(v));
+                __asm__ (
+                        ".arch_extension crc\n\t"
+                        "crc32x %w0, %w0, %x1"
+                        : "+r" (crc)
+                        : "r" (v)
+                );
+        }
+        for ( ; n; --n, ++p) {
+                __asm__ (
+                        ".arch_extension crc\n\t"
+                        "crc32b %w0, %w0, %w1"
+                        : "+r" (crc)
+                        : "r" ((CEfiU32)*p)
+                );
+        }
+
+        return crc;
+}
+
+#elif defined(__x86_64__)
+
+typedef long long CEfiCrc32Vec __attribute__((__vector_size__(16)));
+typedef long long CEfiCrc32VecU __attribute__((__vector_size__(16), __may_alias__, __aligned__(1)));
+
+/*
+ * Builds with SSE assume it is enabled. Others check CR0 and CR4, like
+ * c_efi_sha2_has_sse() does, so they must run at ring 0, as UEFI images do.
+ */
+static inline CEfiBool c_efi_crc32_has_pclmul(void) {
+        if (!(c_efi_simd_cpu_features_cached() & C_EFI_SIMD_PCLMULQDQ))
+                return 0;
+#if defined(__SSE2__)
+        return 1;
+#else
+        return !(c_efi_simd_read_cr0() & (C_EFI_SIMD_CR0_EM | C_EFI_SIMD_CR0_TS)) &&
+               (c_efi_simd_read_cr4() & C_EFI_SIMD_CR4_OSFXSR);
+#endif
+}
+
+/*
+ * Fold 64 bytes per iteration into four 128-bit accumulators, then fold those
+ * into one, reduce to 64 bits and finish with a Barrett reduction. See Intel's
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ * @n must be at least 64 and a multiple of 16.
+ */
+__attribute__((__target__("sse2,pclmul")))
+static inline CEfiU32 c_efi_crc32_pclmul(CEfiU32 crc, const CEfiU8 *p, CEfiUSize n) {
+        const CEfiCrc32Vec k1k2 = { 0x0154442bd4, 0x01c6e41596 };
+        const CEfiCrc32Vec k3k4 = { 0x01751997d0, 0x00ccaa009e };
+        const CEfiCrc32Vec k5k0 = { 0x0163cd6124, 0x0000000000 };
+        const CEfiCrc32Vec poly = { 0x01db710641, 0x01f7011641 };
+        const CEfiCrc32Vec mask = { 0xffffffff, 0xffffffff };
+        CEfiCrc32Vec x1, x2, x3, x4, x5, x6, x7, x8;
+
+        x1 = *(const CEfiCrc32VecU *)(p + 0x00);
+        x2 = *(const CEfiCrc32VecU *)(p + 0x10);
+        x3 = *(const CEfiCrc32VecU *)(p + 0x20);
+        x4 = *(const CEfiCrc32VecU *)(p + 0x30);
+        x1 ^= (CEfiCrc32Vec){ crc, 0 };
+        p += 64;
+        n -= 64;
+
+        while (n >= 64) {
+                x5 = __builtin_ia32_pclmulqdq128(x1, k1k2, 0x00);
+                x6 = __builtin_ia32_pclmulqdq128(x2, k1k2, 0x00);
+                x7 = __builtin_ia32_pclmulqdq128(x3, k1k2, 0x00);
+                x8 = __builtin_ia32_pclmulqdq128(x4, k1k2, 0x00);
+                x1 = __builtin_ia32_pclmulqdq128(x1, k1k2, 0x11);
+                x2 = __builtin_ia32_pclmulqdq128(x2, k1k2, 0x11);
+                x3 = __builtin_ia32_pclmulqdq128(x3, k1k2, 0x11);
+                x4 = __builtin_ia32_pclmulqdq128(x4, k1k2, 0x11);
+                x1 ^= x5 ^ *(const CEfiCrc32VecU *)(p + 0x00);
+                x2 ^= x6 ^ *(const CEfiCrc32VecU *)(p + 0x10);
+                x3 ^= x7 ^ *(const CEfiCrc32VecU *)(p + 0x20);
+                x4 ^= x8 ^ *(const CEfiCrc32VecU *)(p + 0x30);
+                p += 64;
+                n -= 64;
+        }
+
+        x5 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x00);
+        x1 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x11) ^ x2 ^ x5;
+        x5 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x00);
+        x1 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x11) ^ x3 ^ x5;
+        x5 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x00);
+        x1 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x11) ^ x4 ^ x5;
+
+        while (n >= 16) {
+                x5 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x00);
+                x1 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x11) ^ *(const CEfiCrc32VecU *)p ^ x5;
+                p += 16;
+                n -= 16;
+        }
+
+        /* 128 to 64 bits */
+        x2 = __builtin_ia32_pclmulqdq128(x1, k3k4, 0x10);
+        x1 = (CEfiCrc32Vec){ x1[1], 0 } ^ x2;
+        x2 = (CEfiCrc32Vec){
+                (long long)(((unsigned long long)x1[0] >> 32) | ((unsigned long long)x1[1] << 32)),
+                (long long)((unsigned long long)x1[1] >> 32),
+        };
+        x1 = __builtin_ia32_pclmulqdq128(x1 & mask, k5k0, 0x00) ^ x2;
+
+        /* Barrett reduction to 32 bits */
+        x2 = __builtin_ia32_pclmulqdq128(x1 & mask, poly, 0x10);
+        x2 = __builtin_ia32_pclmulqdq128(x2 & mask, poly, 0x00);
+        x1 ^= x2;
+
+        return (CEfiU32)((unsigned long long)x1[0] >> 32);
+}
+
+#endif
+
+/**
+ * c_efi_crc32() - Calculate CRC32
+ * @crc:                CRC32 of preceding data, or 0
+ * @data:               data to checksum
+ * @n:                  size of @data in bytes
+ *
+ * This calculates the IEEE 802.3 CRC32 of @data, continuing from @crc. Pass 0
+ * for @crc to start a new checksum. The result matches the `calculate_crc32`
+ * boot service, as well as crc32() of zlib.
+ *
+ * Return: The updated CRC32.
+ */
+static inline CEfiU32 c_efi_crc32(CEfiU32 crc, const void *data, CEfiUSize n) {
+        const CEfiU8 *p = data;
+
+        crc = ~crc;
+
+#if defined(__aarch64__)
+        if (c_efi_crc32_has_insn())
+                return ~c_efi_crc32_insn(crc, p, n);
+#elif defined(__x86_64__)
+        if (n >= 64 && c_efi_crc32_has_pclmul()) {
+                crc = c_efi_crc32_pclmul(crc, p, n & ~(CEfiUSize)15);
+                p += n & ~(CEfiUSize)15;
+                n &= 15;
+        }
+#endif
+
+        return ~c_efi_crc32_table(crc, p, n);
+}
+
+#ifdef __cplusplus
+}
+#endif
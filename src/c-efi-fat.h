@@ -0,0 +1,853 @@
+#pragma once
+
+/**
+ * Read-Only FAT File System
+ *
+ * Firmware file system drivers often issue one `read_blocks` call per
+ * cluster, which makes loading large files slow. This header reads FAT12,
+ * FAT16 and FAT32 volumes directly via Block I/O:
+ *
+ *  - The active FAT is read with a single call at mount time, and kept in
+ *    memory, so walking cluster chains never does I/O.
+ *
+ *  - Reads are split into runs of contiguous clusters, and each run is read
+ *    with a single `read_blocks` call straight into the caller's buffer, if
+ *    that is suitably aligned. Unaligned pieces go through a one-cluster
+ *    window, which also serves directory scans.
+ *
+ *  - Path lookups are cached per directory and name, so repeated opens of
+ *    files in the same directories do not rescan them. Each name can go to
+ *    one of two slots, and the least recently used one is replaced.
+ *
+ * Names are compared case-insensitively for ASCII letters only. Long file
+ * names are used if present and valid, short names otherwise.
+ *
+ * The volume is not written to. Writing to it through other means, or a
+ * media change, requires a new c_efi_fat_init().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-block-io.h>
+
+#define C_EFI_FAT_ATTRIBUTE_READ_ONLY           C_EFI_U8_C(0x01)
+#define C_EFI_FAT_ATTRIBUTE_HIDDEN              C_EFI_U8_C(0x02)
+#define C_EFI_FAT_ATTRIBUTE_SYSTEM              C_EFI_U8_C(0x04)
+#define C_EFI_FAT_ATTRIBUTE_VOLUME_ID           C_EFI_U8_C(0x08)
+#define C_EFI_FAT_ATTRIBUTE_DIRECTORY           C_EFI_U8_C(0x10)
+#define C_EFI_FAT_ATTRIBUTE_ARCHIVE             C_EFI_U8_C(0x20)
+#define C_EFI_FAT_ATTRIBUTE_LONG_NAME           C_EFI_U8_C(0x0f)
+
+#define C_EFI_FAT_NAME_MAX 255
+#define C_EFI_FAT_LOOKUP_SIZE 64
+#define C_EFI_FAT_LOOKUP_NAME_MAX 32
+#define C_EFI_FAT_NONE ((CEfiU64)-1)
+
+/**
+ * CEfiFatEntry: Directory Entry
+ * @name:               long name if present, short name otherwise
+ * @attributes:         C_EFI_FAT_ATTRIBUTE_* flags
+ * @cluster:            first cluster, 0 for empty files and the root
+ * @size:               file size in bytes, 0 for directories
+ */
+typedef struct CEfiFatEntry {
+        CEfiChar16 name[C_EFI_FAT_NAME_MAX + 1];
+        CEfiU8 attributes;
+        CEfiU32 cluster;
+        CEfiU32 size;
+} CEfiFatEntry;
+
+/**
+ * CEfiFatFile: Open File or Directory
+ * @first_cluster:      first cluster, 0 for empty files and the FAT12/16
+ *                      root directory
+ * @attributes:         C_EFI_FAT_ATTRIBUTE_* flags
+ * @size:               file size, or the size of the cluster chain or root
+ *                      region for directories
+ * @position:           offset of the next read
+ * @cluster:            cluster number @cluster_index of the chain, or 0 if
+ *                      not yet known
+ * @cluster_index:      index of @cluster in the chain
+ *
+ * Files hold no references, so they are closed by forgetting them.
+ */
+typedef struct CEfiFatFile {
+        CEfiU32 first_cluster;
+        CEfiU8 attributes;
+        CEfiU64 size;
+        CEfiU64 position;
+        CEfiU32 cluster;
+        CEfiU32 cluster_index;
+} CEfiFatFile;
+
+/**
+ * CEfiFatLookup: Cached Path Lookup
+ * @stamp:              number of lookups at the last use of this slot
+ * @directory:          first cluster of the directory searched
+ * @cluster:            first cluster of the entry found
+ * @size:               size of the entry found
+ * @attributes:         attributes of the entry found
+ * @n_name:             length of @name, 0 if the slot is empty
+ * @name:               upper-cased name looked up
+ */
+typedef struct CEfiFatLookup {
+        CEfiU64 stamp;
+        CEfiU32 directory;
+        CEfiU32 cluster;
+        CEfiU32 size;
+        CEfiU8 attributes;
+        CEfiU8 n_name;
+        CEfiChar16 name[C_EFI_FAT_LOOKUP_NAME_MAX];
+} CEfiFatLookup;
+
+/**
+ * CEfiFat: Mounted FAT Volume
+ * @bs:                 boot services, used for allocations
+ * @bio:                block device holding the volume
+ * @media_id:           media ID at mount time
+ * @block_size:         block size of the media
+ * @align:              buffer alignment required by the media, at least 1
+ * @start:              first block of the volume
+ * @type:               12, 16 or 32
+ * @cluster_size:       bytes per cluster
+ * @n_clusters:         number of data clusters, numbered from 2
+ * @root_cluster:       first cluster of the FAT32 root directory, or 0
+ * @root_offset:        byte offset of the FAT12/16 root directory
+ * @root_size:          size of the FAT12/16 root directory in bytes
+ * @data_offset:        byte offset of cluster 2
+ * @table:              the active FAT
+ * @table_pages:        number of pages at @table
+ * @scratch:            window buffer, followed by @lookups
+ * @scratch_pages:      number of pages at @scratch
+ * @window:             byte offset of the data in @scratch, or
+ *                      C_EFI_FAT_NONE
+ * @window_size:        number of valid bytes in @scratch
+ * @lookups:            path lookup cache, C_EFI_FAT_LOOKUP_SIZE slots
+ * @n_reads:            number of `read_blocks` calls
+ * @n_read_bytes:       number of bytes read by `read_blocks`
+ * @n_lookup_hits:      number of path components found in @lookups
+ * @n_lookup_misses:    number of path components searched on disk
+ *
+ * All byte offsets are relative to the start of the volume.
+ */
+typedef struct CEfiFat {
+        CEfiBootServices *bs;
+        CEfiBlockIoProtocol *bio;
+        CEfiU32 media_id;
+        CEfiU32 block_size;
+        CEfiUSize align;
+        CEfiLba start;
+        CEfiU32 type;
+        CEfiU32 cluster_size;
+        CEfiU32 n_clusters;
+        CEfiU32 root_cluster;
+        CEfiU64 root_offset;
+        CEfiU32 root_size;
+        CEfiU64 data_offset;
+        CEfiU8 *table;
+        CEfiUSize table_pages;
+        CEfiU8 *scratch;
+        CEfiUSize scratch_pages;
+        CEfiU64 window;
+        CEfiUSize window_size;
+        CEfiFatLookup *lookups;
+        CEfiU64 n_reads;
+        CEfiU64 n_read_bytes;
+        CEfiU64 n_lookup_hits;
+        CEfiU64 n_lookup_misses;
+} CEfiFat;
+
+static inline CEfiU32 c_efi_fat_le16(const CEfiU8 *p) {
+        return p[0] | ((CEfiU32)p[1] << 8);
+}
+
+static inline CEfiU32 c_efi_fat_le32(const CEfiU8 *p) {
+        return c_efi_fat_le16(p) | (c_efi_fat_le16(p + 2) << 16);
+}
+
+static inline CEfiStatus c_efi_fat_io(CEfiFat *fat, CEfiU64 offset, CEfiUSize size, void *buffer) {
+        ++fat->n_reads;
+        fat->n_read_bytes += size;
+
+        return fat->bio->read_blocks(fat->bio,
+                                     fat->media_id,
+                                     fat->start + offset / fat->block_size,
+                                     size,
+                                     buffer);
+}
+
+/**
+ * c_efi_fat_deinit() - Unmount a volume
+ * @fat:                volume to unmount
+ *
+ * This frees the cached FAT and the window. Files of the volume must not be
+ * used afterwards.
+ */
+static inline void c_efi_fat_deinit(CEfiFat *fat) {
+        if (fat->table)
+                fat->bs->free_pages((CEfiUSize)fat->table, fat->table_pages);
+        if (fat->scratch)
+                fat->bs->free_pages((CEfiUSize)fat->scratch, fat->scratch_pages);
+
+        fat->table = C_EFI_NULL;
+        fat->scratch = C_EFI_NULL;
+        fat->lookups = C_EFI_NULL;
+}
+
+/* parse the boot sector, and return the location and size of the active FAT */
+static inline CEfiStatus c_efi_fat_parse(CEfiFat *fat,
+                                         const CEfiU8 *boot,
+                                         CEfiLba n_blocks,
+                                         CEfiU64 *table_offsetp,
+                                         CEfiUSize *table_sizep) {
+        CEfiU32 sector_size, per_cluster, n_reserved, n_fats, n_root, fat_sectors, active = 0;
+        CEfiU64 n_sectors, n_meta, need;
+
+        if ((boot[0] != 0xeb && boot[0] != 0xe9) || boot[510] != 0x55 || boot[511] != 0xaa)
+                return C_EFI_NOT_FOUND;
+
+        sector_size = c_efi_fat_le16(boot + 11);
+        per_cluster = boot[13];
+        n_reserved = c_efi_fat_le16(boot + 14);
+        n_fats = boot[16];
+        n_root = c_efi_fat_le16(boot + 17);
+        n_sectors = c_efi_fat_le16(boot + 19);
+        if (!n_sectors)
+                n_sectors = c_efi_fat_le32(boot + 32);
+        fat_sectors = c_efi_fat_le16(boot + 22);
+        if (!fat_sectors)
+                fat_sectors = c_efi_fat_le32(boot + 36);
+
+        if (sector_size < 512 || sector_size > 4096 || (sector_size & (sector_size - 1)) ||
+            !per_cluster || (per_cluster & (per_cluster - 1)) || sector_size * per_cluster > 64 * 1024 ||
+            !n_reserved || !n_fats || !n_sectors || !fat_sectors)
+                return C_EFI_VOLUME_CORRUPTED;
+        if (sector_size % fat->block_size)
+                return C_EFI_UNSUPPORTED;
+        if (n_sectors > n_blocks * fat->block_size / sector_size)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        n_meta = n_reserved + (CEfiU64)n_fats * fat_sectors + ((CEfiU64)n_root * 32 + sector_size - 1) / sector_size;
+        if (n_meta >= n_sectors)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        fat->cluster_size = sector_size * per_cluster;
+        fat->n_clusters = (n_sectors - n_meta) / per_cluster;
+        fat->root_offset = (n_reserved + (CEfiU64)n_fats * fat_sectors) * sector_size;
+        fat->data_offset = n_meta * sector_size;
+
+        /* the cluster count alone determines the FAT type */
+        if (fat->n_clusters < 4085) {
+                fat->type = 12;
+                need = ((CEfiU64)fat->n_clusters + 2) * 3 / 2 + 1;
+        } else if (fat->n_clusters < 65525) {
+                fat->type = 16;
+                need = ((CEfiU64)fat->n_clusters + 2) * 2;
+        } else {
+                fat->type = 32;
+                need = ((CEfiU64)fat->n_clusters + 2) * 4;
+        }
+
+        if (fat->type == 32) {
+                if (c_efi_fat_le16(boot + 22) || n_root || fat->n_clusters > 0x0ffffff5)
+                        return C_EFI_VOLUME_CORRUPTED;
+
+                /* mirroring may be disabled, with a single active FAT */
+                if (c_efi_fat_le16(boot + 40) & 0x80)
+                        active = c_efi_fat_le16(boot + 40) & 0xf;
+
+                fat->root_cluster = c_efi_fat_le32(boot + 44);
+                if (active >= n_fats || fat->root_cluster < 2 || fat->root_cluster >= fat->n_clusters + 2)
+                        return C_EFI_VOLUME_CORRUPTED;
+        } else {
+                if (!n_root)
+                        return C_EFI_VOLUME_CORRUPTED;
+                fat->root_size = n_root * 32;
+        }
+
+        if (need > (CEfiU64)fat_sectors * sector_size)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        *table_offsetp = (n_reserved + (CEfiU64)active * fat_sectors) * sector_size;
+        *table_sizep = (need + sector_size - 1) / sector_size * sector_size;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_fat_init() - Mount a volume
+ * @fat:                volume to initialize
+ * @bs:                 boot services
+ * @bio:                block device holding the volume
+ * @start:              first block of the volume
+ * @n_blocks:           number of blocks of the volume, or 0 for the rest of
+ *                      the media
+ *
+ * For a partition, pass either the Block I/O protocol of the partition and
+ * a @start of 0, or that of the whole disk and the range of the partition.
+ * This reads the boot sector and the active FAT, and allocates pages for
+ * the FAT, a window of one cluster and the lookup cache. On failure,
+ * nothing needs to be freed.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NO_MEDIA if no media is present,
+ *         C_EFI_NOT_FOUND if there is no FAT boot sector,
+ *         C_EFI_VOLUME_CORRUPTED if the boot sector is invalid,
+ *         C_EFI_UNSUPPORTED if the geometry is not supported, or the error
+ *         of `read_blocks` or `allocate_pages`.
+ */
+static inline CEfiStatus c_efi_fat_init(CEfiFat *fat,
+                                        CEfiBootServices *bs,
+                                        CEfiBlockIoProtocol *bio,
+                                        CEfiLba start,
+                                        CEfiLba n_blocks) {
+        CEfiBlockIoMedia *media = bio->media;
+        CEfiPhysicalAddress address = 0;
+        CEfiU64 table_offset = 0;
+        CEfiUSize table_size = 0, n;
+        CEfiStatus r;
+
+        *fat = (CEfiFat){
+                .bs = bs,
+                .bio = bio,
+                .media_id = media->media_id,
+                .block_size = media->block_size,
+                .align = media->io_align > 1 ? media->io_align : 1,
+                .start = start,
+                .window = C_EFI_FAT_NONE,
+        };
+
+        if (!media->media_present)
+                return C_EFI_NO_MEDIA;
+        if (media->block_size < 512 || media->block_size > 4096 ||
+            (media->block_size & (media->block_size - 1)) ||
+            fat->align > 4096 || (fat->align & (fat->align - 1)))
+                return C_EFI_UNSUPPORTED;
+        if (start > media->last_block)
+                return C_EFI_INVALID_PARAMETER;
+        if (!n_blocks || n_blocks > media->last_block + 1 - start)
+                n_blocks = media->last_block + 1 - start;
+
+        r = bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES, C_EFI_LOADER_DATA, 1, &address);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = c_efi_fat_io(fat, 0, fat->block_size, (void *)(CEfiUSize)address);
+        if (!C_EFI_ERROR(r))
+                r = c_efi_fat_parse(fat, (const CEfiU8 *)(CEfiUSize)address, n_blocks, &table_offset, &table_size);
+        bs->free_pages(address, 1);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        fat->table_pages = (table_size + 4095) / 4096;
+        r = bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES, C_EFI_LOADER_DATA, fat->table_pages, &address);
+        if (C_EFI_ERROR(r))
+                return r;
+        fat->table = (CEfiU8 *)(CEfiUSize)address;
+
+        n = fat->cluster_size + C_EFI_FAT_LOOKUP_SIZE * sizeof(CEfiFatLookup);
+        fat->scratch_pages = (n + 4095) / 4096;
+        r = bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES, C_EFI_LOADER_DATA, fat->scratch_pages, &address);
+        if (C_EFI_ERROR(r))
+                goto error;
+        fat->scratch = (CEfiU8 *)(CEfiUSize)address;
+        fat->lookups = (CEfiFatLookup *)(fat->scratch + fat->cluster_size);
+        c_efi_memset(fat->lookups, 0, C_EFI_FAT_LOOKUP_SIZE * sizeof(CEfiFatLookup));
+
+        r = c_efi_fat_io(fat, table_offset, table_size, fat->table);
+        if (C_EFI_ERROR(r))
+                goto error;
+
+        return C_EFI_SUCCESS;
+
+error:
+        c_efi_fat_deinit(fat);
+        return r;
+}
+
+/**
+ * c_efi_fat_next() - Look up the FAT
+ * @fat:                mounted volume
+ * @cluster:            cluster number, from 2 to `n_clusters + 1`
+ *
+ * Return: The raw FAT entry of @cluster, usually the next cluster of its
+ *         chain.
+ */
+static inline CEfiU32 c_efi_fat_next(const CEfiFat *fat, CEfiU32 cluster) {
+        CEfiU32 v;
+
+        switch (fat->type) {
+        case 12:
+                v = c_efi_fat_le16(fat->table + cluster + cluster / 2);
+                return (cluster & 1) ? v >> 4 : v & 0xfff;
+        case 16:
+                return c_efi_fat_le16(fat->table + (CEfiUSize)cluster * 2);
+        default:
+                return c_efi_fat_le32(fat->table + (CEfiUSize)cluster * 4) & 0x0fffffff;
+        }
+}
+
+static inline CEfiBool c_efi_fat_valid(const CEfiFat *fat, CEfiU32 cluster) {
+        return cluster >= 2 && cluster - 2 < fat->n_clusters;
+}
+
+/* prepare @file for the entry at @cluster, sizing directories by their chain */
+static inline CEfiStatus c_efi_fat_file(CEfiFat *fat, CEfiU32 cluster, CEfiU8 attributes, CEfiU32 size, CEfiFatFile *file) {
+        CEfiU32 eoc, n = 1, next;
+
+        *file = (CEfiFatFile){ .first_cluster = cluster, .attributes = attributes, .size = size };
+
+        if (!(attributes & C_EFI_FAT_ATTRIBUTE_DIRECTORY)) {
+                if (size && !c_efi_fat_valid(fat, cluster))
+                        return C_EFI_VOLUME_CORRUPTED;
+                return C_EFI_SUCCESS;
+        }
+
+        /* ".." entries refer to the root directory by cluster 0 */
+        if (!cluster) {
+                file->first_cluster = fat->root_cluster;
+                file->size = fat->root_size;
+                if (!fat->root_cluster)
+                        return C_EFI_SUCCESS;
+                cluster = fat->root_cluster;
+        }
+        if (!c_efi_fat_valid(fat, cluster))
+                return C_EFI_VOLUME_CORRUPTED;
+
+        eoc = fat->type == 12 ? 0xff8 : fat->type == 16 ? 0xfff8 : 0x0ffffff8;
+        while (c_efi_fat_valid(fat, (next = c_efi_fat_next(fat, cluster)))) {
+                if (++n > fat->n_clusters)
+                        return C_EFI_VOLUME_CORRUPTED;
+                cluster = next;
+        }
+        if (next < eoc)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        file->size = (CEfiU64)n * fat->cluster_size;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_fat_root() - Open the root directory
+ * @fat:                mounted volume
+ * @file:               output for the root directory
+ *
+ * Return: C_EFI_SUCCESS on success, or C_EFI_VOLUME_CORRUPTED if the FAT32
+ *         root directory chain is invalid.
+ */
+static inline CEfiStatus c_efi_fat_root(CEfiFat *fat, CEfiFatFile *file) {
+        return c_efi_fat_file(fat, 0, C_EFI_FAT_ATTRIBUTE_DIRECTORY, 0, file);
+}
+
+/*
+ * Locate the data at the position of @file: its byte offset, and the number
+ * of contiguous bytes there, up to @wanted. Without @coalesce, this stops at
+ * the end of the current cluster. Also return the cluster-sized region of
+ * the volume holding the offset, to be read into the window.
+ */
+static inline CEfiStatus c_efi_fat_extent(CEfiFat *fat,
+                                          CEfiFatFile *file,
+                                          CEfiU64 wanted,
+                                          CEfiBool coalesce,
+                                          CEfiU64 *offsetp,
+                                          CEfiU64 *sizep,
+                                          CEfiU64 *regionp,
+                                          CEfiUSize *region_sizep) {
+        CEfiU64 chunk, in, size;
+        CEfiU32 index, next;
+
+        in = file->position % fat->cluster_size;
+        chunk = file->position - in;
+
+        if (!file->first_cluster) {
+                *offsetp = fat->root_offset + file->position;
+                *sizep = coalesce ? wanted : fat->cluster_size - in;
+                *regionp = fat->root_offset + chunk;
+                *region_sizep = file->size - chunk < fat->cluster_size ? file->size - chunk : fat->cluster_size;
+                *region_sizep = (*region_sizep + fat->block_size - 1) / fat->block_size * fat->block_size;
+        } else {
+                index = file->position / fat->cluster_size;
+                if (!file->cluster || index < file->cluster_index) {
+                        file->cluster = file->first_cluster;
+                        file->cluster_index = 0;
+                }
+                while (file->cluster_index < index) {
+                        next = c_efi_fat_next(fat, file->cluster);
+                        if (!c_efi_fat_valid(fat, next))
+                                return C_EFI_VOLUME_CORRUPTED;
+                        file->cluster = next;
+                        ++file->cluster_index;
+                }
+
+                *regionp = fat->data_offset + (CEfiU64)(file->cluster - 2) * fat->cluster_size;
+                *region_sizep = fat->cluster_size;
+                *offsetp = *regionp + in;
+
+                size = fat->cluster_size - in;
+                while (coalesce && size < wanted && c_efi_fat_next(fat, file->cluster) == file->cluster + 1 &&
+                       c_efi_fat_valid(fat, file->cluster + 1)) {
+                        ++file->cluster;
+                        ++file->cluster_index;
+                        size += fat->cluster_size;
+                }
+                *sizep = size;
+        }
+
+        if (*sizep > wanted)
+                *sizep = wanted;
+        return C_EFI_SUCCESS;
+}
+
+/* make the window hold @size bytes at @region */
+static inline CEfiStatus c_efi_fat_window(CEfiFat *fat, CEfiU64 region, CEfiUSize size) {
+        CEfiStatus r;
+
+        if (fat->window == region && fat->window_size >= size)
+                return C_EFI_SUCCESS;
+
+        fat->window = C_EFI_FAT_NONE;
+        r = c_efi_fat_io(fat, region, size, fat->scratch);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        fat->window = region;
+        fat->window_size = size;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_fat_read() - Read from a file
+ * @fat:                mounted volume
+ * @file:               file to read from
+ * @buffer:             output buffer
+ * @size:               number of bytes to read
+ * @n_readp:            output for the number of bytes read
+ *
+ * This reads up to @size bytes from the position of @file, and advances
+ * it. Fewer bytes are only returned at the end of the file. Each run of
+ * contiguous clusters is read with a single `read_blocks` call, directly
+ * into @buffer, if the position is block-aligned and @buffer honors the
+ * `io_align` of the media.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_VOLUME_CORRUPTED if the cluster
+ *         chain is shorter than the file, or the error of `read_blocks`. On
+ *         error, @n_readp is still set.
+ */
+static inline CEfiStatus c_efi_fat_read(CEfiFat *fat, CEfiFatFile *file, void *buffer, CEfiUSize size, CEfiUSize *n_readp) {
+        CEfiU64 wanted, offset, n, region;
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiU8 *p = buffer;
+        CEfiUSize region_size;
+        CEfiBool direct;
+
+        while (size && file->position < file->size) {
+                wanted = file->size - file->position;
+                if (wanted > size)
+                        wanted = size;
+
+                /* only read whole blocks into the caller's buffer */
+                direct = !(file->position % fat->block_size) &&
+                         !((CEfiUSize)p & (fat->align - 1)) &&
+                         wanted >= fat->block_size;
+                if (direct)
+                        wanted -= wanted % fat->block_size;
+
+                r = c_efi_fat_extent(fat, file, wanted, direct, &offset, &n, &region, &region_size);
+                if (C_EFI_ERROR(r))
+                        break;
+
+                if (direct) {
+                        r = c_efi_fat_io(fat, offset, n, p);
+                } else {
+                        r = c_efi_fat_window(fat, region, region_size);
+                        if (!C_EFI_ERROR(r))
+                                c_efi_memcpy(p, fat->scratch + (offset - region), n);
+                }
+                if (C_EFI_ERROR(r))
+                        break;
+
+                p += n;
+                size -= n;
+                file->position += n;
+        }
+
+        *n_readp = p - (CEfiU8 *)buffer;
+        return r;
+}
+
+static inline CEfiU8 c_efi_fat_checksum(const CEfiU8 *short_name) {
+        CEfiU8 sum = 0;
+        CEfiUSize i;
+
+        for (i = 0; i < 11; ++i)
+                sum = ((sum & 1) << 7) + (sum >> 1) + short_name[i];
+
+        return sum;
+}
+
+/* format an 8.3 name, honoring the lower-case flags set by Windows NT */
+static inline void c_efi_fat_short_name(const CEfiU8 *d, CEfiChar16 *name) {
+        CEfiUSize i, n = 0, end;
+        CEfiChar16 c;
+
+        for (end = 8; end && d[end - 1] == ' '; --end)
+                /* empty */ ;
+        for (i = 0; i < end; ++i) {
+                c = (!i && d[i] == 0x05) ? 0xe5 : d[i];
+                name[n++] = ((d[12] & 0x08) && c >= 'A' && c <= 'Z') ? c + 32 : c;
+        }
+
+        for (end = 11; end > 8 && d[end - 1] == ' '; --end)
+                /* empty */ ;
+        if (end > 8)
+                name[n++] = '.';
+        for (i = 8; i < end; ++i)
+                name[n++] = ((d[12] & 0x10) && d[i] >= 'A' && d[i] <= 'Z') ? d[i] + 32 : d[i];
+
+        name[n] = 0;
+}
+
+/**
+ * c_efi_fat_readdir() - Read a directory entry
+ * @fat:                mounted volume
+ * @dir:                directory to read from
+ * @entry:              output for the entry
+ *
+ * This returns the entry at the position of @dir, and advances it. Deleted
+ * entries and volume labels are skipped. The "." and ".." entries of
+ * subdirectories are returned like any other. Rewind a directory by
+ * setting its position to 0.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_FOUND at the end of the
+ *         directory, or the error of c_efi_fat_read().
+ */
+static inline CEfiStatus c_efi_fat_readdir(CEfiFat *fat, CEfiFatFile *dir, CEfiFatEntry *entry) {
+        static const CEfiU8 offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+        CEfiU8 checksum = 0, expected = 0, sequence;
+        CEfiBool long_name = C_EFI_FALSE;
+        CEfiU64 offset, n, region;
+        CEfiUSize region_size, i, k;
+        const CEfiU8 *d;
+        CEfiStatus r;
+
+        for (;;) {
+                if (dir->position >= dir->size)
+                        return C_EFI_NOT_FOUND;
+
+                r = c_efi_fat_extent(fat, dir, 32, C_EFI_FALSE, &offset, &n, &region, &region_size);
+                if (!C_EFI_ERROR(r))
+                        r = c_efi_fat_window(fat, region, region_size);
+                if (C_EFI_ERROR(r))
+                        return r;
+
+                d = fat->scratch + (offset - region);
+                dir->position += 32;
+
+                if (!d[0]) {
+                        dir->position = dir->size;
+                        return C_EFI_NOT_FOUND;
+                }
+                if (d[0] == 0xe5) {
+                        long_name = C_EFI_FALSE;
+                        continue;
+                }
+
+                if ((d[11] & 0x3f) == C_EFI_FAT_ATTRIBUTE_LONG_NAME) {
+                        /* long names are stored backwards, 13 characters per entry */
+                        sequence = d[0] & 0x1f;
+                        if (d[0] & 0x40) {
+                                long_name = C_EFI_TRUE;
+                                checksum = d[13];
+                                expected = sequence;
+                                k = (CEfiUSize)sequence * 13;
+                                entry->name[k < C_EFI_FAT_NAME_MAX ? k : C_EFI_FAT_NAME_MAX] = 0;
+                        }
+                        if (!long_name || !sequence || sequence > 20 || sequence != expected || d[13] != checksum) {
+                                long_name = C_EFI_FALSE;
+                                continue;
+                        }
+
+                        for (i = 0; i < 13; ++i) {
+                                k = (CEfiUSize)(sequence - 1) * 13 + i;
+                                if (k < C_EFI_FAT_NAME_MAX)
+                                        entry->name[k] = c_efi_fat_le16(d + offsets[i]);
+                        }
+                        --expected;
+                        continue;
+                }
+
+                if (d[11] & C_EFI_FAT_ATTRIBUTE_VOLUME_ID) {
+                        long_name = C_EFI_FALSE;
+                        continue;
+                }
+
+                /* the long name must be complete, and belong to this entry */
+                if (!long_name || expected || c_efi_fat_checksum(d) != checksum || !entry->name[0])
+                        c_efi_fat_short_name(d, entry->name);
+
+                entry->attributes = d[11];
+                entry->cluster = c_efi_fat_le16(d + 26);
+                if (fat->type == 32)
+                        entry->cluster |= c_efi_fat_le16(d + 20) << 16;
+                entry->size = (d[11] & C_EFI_FAT_ATTRIBUTE_DIRECTORY) ? 0 : c_efi_fat_le32(d + 28);
+                return C_EFI_SUCCESS;
+        }
+}
+
+static inline CEfiChar16 c_efi_fat_upper(CEfiChar16 c) {
+        return (c >= 'a' && c <= 'z') ? c - 32 : c;
+}
+
+/* compare the NUL-terminated @name against @component, ignoring ASCII case */
+static inline CEfiBool c_efi_fat_name_equal(const CEfiChar16 *name, const CEfiChar16 *component, CEfiUSize n) {
+        CEfiUSize i;
+
+        for (i = 0; i < n; ++i)
+                if (!name[i] || c_efi_fat_upper(name[i]) != c_efi_fat_upper(component[i]))
+                        return C_EFI_FALSE;
+
+        return !name[n];
+}
+
+/* find the cached lookup of @component, or the slot to replace with it */
+static inline CEfiFatLookup *c_efi_fat_lookup_slot(CEfiFat *fat,
+                                                  CEfiU32 directory,
+                                                  const CEfiChar16 *component,
+                                                  CEfiUSize n,
+                                                  CEfiBool *hitp) {
+        CEfiU64 h = C_EFI_U64_C(0xcbf29ce484222325) ^ directory;
+        CEfiFatLookup *slot, *victim = C_EFI_NULL;
+        CEfiUSize i, k;
+
+        for (i = 0; i < n; ++i)
+                h = (h ^ c_efi_fat_upper(component[i])) * C_EFI_U64_C(0x100000001b3);
+
+        for (k = 0; k < 2; ++k, h >>= 32) {
+                slot = &fat->lookups[(h ^ (h >> 16)) % C_EFI_FAT_LOOKUP_SIZE];
+                if (slot->n_name == n && slot->directory == directory) {
+                        for (i = 0; i < n && slot->name[i] == c_efi_fat_upper(component[i]); ++i)
+                                /* empty */ ;
+                        if (i == n) {
+                                *hitp = C_EFI_TRUE;
+                                return slot;
+                        }
+                }
+                if (!victim || slot->stamp < victim->stamp)
+                        victim = slot;
+        }
+
+        *hitp = C_EFI_FALSE;
+        return victim;
+}
+
+/* find @component in @dir, and open it into @file */
+static inline CEfiStatus c_efi_fat_lookup(CEfiFat *fat,
+                                          const CEfiFatFile *dir,
+                                          const CEfiChar16 *component,
+                                          CEfiUSize n,
+                                          CEfiFatFile *file) {
+        CEfiU32 directory = dir->first_cluster;
+        CEfiFatLookup *slot = C_EFI_NULL;
+        CEfiFatFile scan = *dir;
+        CEfiBool hit = C_EFI_FALSE;
+        CEfiFatEntry entry;
+        CEfiUSize i;
+        CEfiStatus r;
+
+        if (n <= C_EFI_FAT_LOOKUP_NAME_MAX) {
+                slot = c_efi_fat_lookup_slot(fat, directory, component, n, &hit);
+                if (hit) {
+                        slot->stamp = ++fat->n_lookup_hits + fat->n_lookup_misses;
+                        return c_efi_fat_file(fat, slot->cluster, slot->attributes, slot->size, file);
+                }
+        }
+
+        ++fat->n_lookup_misses;
+        scan.position = 0;
+        for (;;) {
+                r = c_efi_fat_readdir(fat, &scan, &entry);
+                if (C_EFI_ERROR(r))
+                        return r;
+                if (c_efi_fat_name_equal(entry.name, component, n))
+                        break;
+        }
+
+        if (slot) {
+                *slot = (CEfiFatLookup){
+                        .stamp = fat->n_lookup_hits + fat->n_lookup_misses,
+                        .directory = directory,
+                        .cluster = entry.cluster,
+                        .size = entry.size,
+                        .attributes = entry.attributes,
+                        .n_name = n,
+                };
+                for (i = 0; i < n; ++i)
+                        slot->name[i] = c_efi_fat_upper(component[i]);
+        }
+
+        return c_efi_fat_file(fat, entry.cluster, entry.attributes, entry.size, file);
+}
+
+/**
+ * c_efi_fat_open() - Open a file or directory by path
+ * @fat:                mounted volume
+ * @dir:                directory to resolve relative paths in, or NULL for
+ *                      the root directory
+ * @path:               NUL-terminated path
+ * @file:               output for the opened file or directory
+ *
+ * Components of @path are separated by backslashes or slashes. A leading
+ * separator starts at the root directory. Empty and "." components are
+ * ignored, ".." is resolved via the directory entries.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_FOUND if a component does not
+ *         exist, or a non-final component is not a directory,
+ *         C_EFI_VOLUME_CORRUPTED if a cluster chain is invalid, or the error
+ *         of `read_blocks`.
+ */
+static inline CEfiStatus c_efi_fat_open(CEfiFat *fat, const CEfiFatFile *dir, const CEfiChar16 *path, CEfiFatFile *file) {
+        CEfiFatFile current;
+        CEfiUSize n;
+        CEfiStatus r;
+
+        if (!dir || *path == '\\' || *path == '/') {
+                r = c_efi_fat_root(fat, &current);
+                if (C_EFI_ERROR(r))
+                        return r;
+        } else {
+                current = *dir;
+        }
+
+        for (;;) {
+                while (*path == '\\' || *path == '/')
+                        ++path;
+                if (!*path)
+                        break;
+
+                for (n = 0; path[n] && path[n] != '\\' && path[n] != '/'; ++n)
+                        /* empty */ ;
+
+                if (n != 1 || path[0] != '.') {
+                        if (!(current.attributes & C_EFI_FAT_ATTRIBUTE_DIRECTORY))
+                                return C_EFI_NOT_FOUND;
+
+                        r = c_efi_fat_lookup(fat, &current, path, n, &current);
+                        if (C_EFI_ERROR(r))
+                                return r;
+                }
+
+                path += n;
+        }
+
+        current.position = 0;
+        current.cluster = 0;
+        *file = current;
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
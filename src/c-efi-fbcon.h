@@ -0,0 +1,677 @@
+#pragma once
+
+/**
+ * Framebuffer Text Console
+ *
+ * Firmware text consoles render through the Simple Text Output protocol,
+ * which redraws via `blt` character by character and is slow at high
+ * resolutions. This header draws text straight into the linear framebuffer
+ * of the Graphics Output protocol instead:
+ *
+ *  - Glyphs are 8x8 bitmaps, scaled by an integer factor. Every glyph row is
+ *    expanded through a table of precomputed pixel pairs and stored two
+ *    pixels per 64-bit write.
+ *
+ *  - Scrolling is a single memmove() of the framebuffer, plus a fill of the
+ *    freed text row.
+ *
+ *  - Modes without linear framebuffer (C_EFI_PIXEL_BLT_ONLY) render into a
+ *    caller-provided shadow of the current text row, which is sent with a
+ *    single `blt` per row rather than per glyph. Scrolling uses one
+ *    video-to-video `blt`.
+ *
+ * Colors are selected with the text attributes of the Simple Text Output
+ * protocol, mapped to the VGA palette. Only the printable ASCII range has
+ * glyphs, all other characters are drawn as `?`.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-graphics-output.h>
+#include <c-efi-protocol-simple-text-output.h>
+
+#define C_EFI_FBCON_GLYPH_WIDTH 8
+#define C_EFI_FBCON_GLYPH_HEIGHT 8
+#define C_EFI_FBCON_SCALE_MAX 4
+
+/**
+ * CEfiFbcon: Framebuffer Console
+ * @gop:                graphics output protocol
+ * @fb:                 linear framebuffer, or NULL in blt mode
+ * @shadow:             shadow of the current text row in blt mode, or NULL
+ * @stride:             pixels per line of @fb, or of @shadow in blt mode
+ * @width:              horizontal resolution in pixels
+ * @height:             vertical resolution in pixels
+ * @scale:              glyph scale factor
+ * @columns:            number of text columns
+ * @rows:               number of text rows
+ * @column:             cursor column
+ * @row:                cursor row
+ * @used:               number of text rows drawn to since the last clear
+ * @dirty_start:        first column of @shadow not yet sent via `blt`
+ * @dirty_end:          end of the columns of @shadow not yet sent via `blt`
+ * @shift:              bit positions of red, green and blue in a pixel
+ * @width_bits:         bit widths of red, green and blue in a pixel
+ * @fg:                 foreground pixel value
+ * @bg:                 background pixel value
+ * @lut:                pixel pairs for all 2-bit glyph patterns
+ */
+typedef struct CEfiFbcon {
+        CEfiGraphicsOutputProtocol *gop;
+        CEfiU32 *fb;
+        CEfiU32 *shadow;
+        CEfiUSize stride;
+        CEfiU32 width;
+        CEfiU32 height;
+        CEfiU32 scale;
+        CEfiU32 columns;
+        CEfiU32 rows;
+        CEfiU32 column;
+        CEfiU32 row;
+        CEfiU32 used;
+        CEfiU32 dirty_start;
+        CEfiU32 dirty_end;
+        CEfiU8 shift[3];
+        CEfiU8 width_bits[3];
+        CEfiU32 fg;
+        CEfiU32 bg;
+        CEfiU64 lut[4];
+} CEfiFbcon;
+
+static const CEfiU8 c_efi_fbcon_font[95 * C_EFI_FBCON_GLYPH_HEIGHT] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* ' ' */
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00,  /* '!' */
+        0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00,  /* '"' */
+        0x28, 0x28, 0x7c, 0x28, 0x7c, 0x28, 0x28, 0x00,  /* '#' */
+        0x10, 0x3c, 0x50, 0x38, 0x14, 0x78, 0x10, 0x00,  /* '$' */
+        0x60, 0x64, 0x08, 0x10, 0x20, 0x4c, 0x0c, 0x00,  /* '%' */
+        0x30, 0x48, 0x50, 0x20, 0x54, 0x48, 0x34, 0x00,  /* '&' */
+        0x10, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00,  /* ''' */
+        0x08, 0x10, 0x20, 0x20, 0x20, 0x10, 0x08, 0x00,  /* '(' */
+        0x20, 0x10, 0x08, 0x08, 0x08, 0x10, 0x20, 0x00,  /* ')' */
+        0x00, 0x10, 0x54, 0x38, 0x54, 0x10, 0x00, 0x00,  /* 0x2a */
+        0x00, 0x10, 0x10, 0x7c, 0x10, 0x10, 0x00, 0x00,  /* '+' */
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x20,  /* ',' */
+        0x00, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x00, 0x00,  /* '-' */
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00,  /* '.' */
+        0x00, 0x04, 0x08, 0x10, 0x20, 0x40, 0x00, 0x00,  /* 0x2f */
+        0x38, 0x44, 0x4c, 0x54, 0x64, 0x44, 0x38, 0x00,  /* '0' */
+        0x10, 0x30, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00,  /* '1' */
+        0x38, 0x44, 0x04, 0x08, 0x10, 0x20, 0x7c, 0x00,  /* '2' */
+        0x7c, 0x08, 0x10, 0x08, 0x04, 0x44, 0x38, 0x00,  /* '3' */
+        0x08, 0x18, 0x28, 0x48, 0x7c, 0x08, 0x08, 0x00,  /* '4' */
+        0x7c, 0x40, 0x78, 0x04, 0x04, 0x44, 0x38, 0x00,  /* '5' */
+        0x18, 0x20, 0x40, 0x78, 0x44, 0x44, 0x38, 0x00,  /* '6' */
+        0x7c, 0x04, 0x08, 0x10, 0x20, 0x20, 0x20, 0x00,  /* '7' */
+        0x38, 0x44, 0x44, 0x38, 0x44, 0x44, 0x38, 0x00,  /* '8' */
+        0x38, 0x44, 0x44, 0x3c, 0x04, 0x08, 0x30, 0x00,  /* '9' */
+        0x00, 0x30, 0x30, 0x00, 0x30, 0x30, 0x00, 0x00,  /* ':' */
+        0x00, 0x30, 0x30, 0x00, 0x30, 0x10, 0x20, 0x00,  /* ';' */
+        0x08, 0x10, 0x20, 0x40, 0x20, 0x10, 0x08, 0x00,  /* '<' */
+        0x00, 0x00, 0x7c, 0x00, 0x7c, 0x00, 0x00, 0x00,  /* '=' */
+        0x20, 0x10, 0x08, 0x04, 0x08, 0x10, 0x20, 0x00,  /* '>' */
+        0x38, 0x44, 0x04, 0x08, 0x10, 0x00, 0x10, 0x00,  /* '?' */
+        0x38, 0x44, 0x04, 0x34, 0x54, 0x54, 0x38, 0x00,  /* '@' */
+        0x38, 0x44, 0x44, 0x7c, 0x44, 0x44, 0x44, 0x00,  /* 'A' */
+        0x78, 0x44, 0x44, 0x78, 0x44, 0x44, 0x78, 0x00,  /* 'B' */
+        0x38, 0x44, 0x40, 0x40, 0x40, 0x44, 0x38, 0x00,  /* 'C' */
+        0x70, 0x48, 0x44, 0x44, 0x44, 0x48, 0x70, 0x00,  /* 'D' */
+        0x7c, 0x40, 0x40, 0x78, 0x40, 0x40, 0x7c, 0x00,  /* 'E' */
+        0x7c, 0x40, 0x40, 0x78, 0x40, 0x40, 0x40, 0x00,  /* 'F' */
+        0x38, 0x44, 0x40, 0x5c, 0x44, 0x44, 0x3c, 0x00,  /* 'G' */
+        0x44, 0x44, 0x44, 0x7c, 0x44, 0x44, 0x44, 0x00,  /* 'H' */
+        0x38, 0x10, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00,  /* 'I' */
+        0x1c, 0x08, 0x08, 0x08, 0x08, 0x48, 0x30, 0x00,  /* 'J' */
+        0x44, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44, 0x00,  /* 'K' */
+        0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7c, 0x00,  /* 'L' */
+        0x44, 0x6c, 0x54, 0x54, 0x44, 0x44, 0x44, 0x00,  /* 'M' */
+        0x44, 0x44, 0x64, 0x54, 0x4c, 0x44, 0x44, 0x00,  /* 'N' */
+        0x38, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00,  /* 'O' */
+        0x78, 0x44, 0x44, 0x78, 0x40, 0x40, 0x40, 0x00,  /* 'P' */
+        0x38, 0x44, 0x44, 0x44, 0x54, 0x48, 0x34, 0x00,  /* 'Q' */
+        0x78, 0x44, 0x44, 0x78, 0x50, 0x48, 0x44, 0x00,  /* 'R' */
+        0x3c, 0x40, 0x40, 0x38, 0x04, 0x04, 0x78, 0x00,  /* 'S' */
+        0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00,  /* 'T' */
+        0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00,  /* 'U' */
+        0x44, 0x44, 0x44, 0x44, 0x44, 0x28, 0x10, 0x00,  /* 'V' */
+        0x44, 0x44, 0x44, 0x54, 0x54, 0x54, 0x28, 0x00,  /* 'W' */
+        0x44, 0x44, 0x28, 0x10, 0x28, 0x44, 0x44, 0x00,  /* 'X' */
+        0x44, 0x44, 0x28, 0x10, 0x10, 0x10, 0x10, 0x00,  /* 'Y' */
+        0x7c, 0x04, 0x08, 0x10, 0x20, 0x40, 0x7c, 0x00,  /* 'Z' */
+        0x38, 0x20, 0x20, 0x20, 0x20, 0x20, 0x38, 0x00,  /* '[' */
+        0x00, 0x40, 0x20, 0x10, 0x08, 0x04, 0x00, 0x00,  /* 0x5c */
+        0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00,  /* ']' */
+        0x10, 0x28, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00,  /* '^' */
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c,  /* '_' */
+        0x20, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,  /* '`' */
+        0x00, 0x00, 0x38, 0x04, 0x3c, 0x44, 0x3c, 0x00,  /* 'a' */
+        0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x78, 0x00,  /* 'b' */
+        0x00, 0x00, 0x38, 0x40, 0x40, 0x44, 0x38, 0x00,  /* 'c' */
+        0x04, 0x04, 0x34, 0x4c, 0x44, 0x44, 0x3c, 0x00,  /* 'd' */
+        0x00, 0x00, 0x38, 0x44, 0x7c, 0x40, 0x38, 0x00,  /* 'e' */
+        0x18, 0x24, 0x20, 0x70, 0x20, 0x20, 0x20, 0x00,  /* 'f' */
+        0x00, 0x00, 0x3c, 0x44, 0x44, 0x3c, 0x04, 0x38,  /* 'g' */
+        0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x44, 0x00,  /* 'h' */
+        0x10, 0x00, 0x30, 0x10, 0x10, 0x10, 0x38, 0x00,  /* 'i' */
+        0x08, 0x00, 0x18, 0x08, 0x08, 0x08, 0x48, 0x30,  /* 'j' */
+        0x40, 0x40, 0x48, 0x50, 0x60, 0x50, 0x48, 0x00,  /* 'k' */
+        0x30, 0x10, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00,  /* 'l' */
+        0x00, 0x00, 0x68, 0x54, 0x54, 0x44, 0x44, 0x00,  /* 'm' */
+        0x00, 0x00, 0x58, 0x64, 0x44, 0x44, 0x44, 0x00,  /* 'n' */
+        0x00, 0x00, 0x38, 0x44, 0x44, 0x44, 0x38, 0x00,  /* 'o' */
+        0x00, 0x00, 0x78, 0x44, 0x44, 0x78, 0x40, 0x40,  /* 'p' */
+        0x00, 0x00, 0x3c, 0x44, 0x44, 0x3c, 0x04, 0x04,  /* 'q' */
+        0x00, 0x00, 0x58, 0x64, 0x40, 0x40, 0x40, 0x00,  /* 'r' */
+        0x00, 0x00, 0x38, 0x40, 0x38, 0x04, 0x78, 0x00,  /* 's' */
+        0x20, 0x20, 0x70, 0x20, 0x20, 0x24, 0x18, 0x00,  /* 't' */
+        0x00, 0x00, 0x44, 0x44, 0x44, 0x4c, 0x34, 0x00,  /* 'u' */
+        0x00, 0x00, 0x44, 0x44, 0x44, 0x28, 0x10, 0x00,  /* 'v' */
+        0x00, 0x00, 0x44, 0x44, 0x54, 0x54, 0x28, 0x00,  /* 'w' */
+        0x00, 0x00, 0x44, 0x28, 0x10, 0x28, 0x44, 0x00,  /* 'x' */
+        0x00, 0x00, 0x44, 0x44, 0x44, 0x3c, 0x04, 0x38,  /* 'y' */
+        0x00, 0x00, 0x7c, 0x08, 0x10, 0x20, 0x7c, 0x00,  /* 'z' */
+        0x08, 0x10, 0x10, 0x20, 0x10, 0x10, 0x08, 0x00,  /* '{' */
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00,  /* '|' */
+        0x20, 0x10, 0x10, 0x08, 0x10, 0x10, 0x20, 0x00,  /* '}' */
+        0x00, 0x00, 0x20, 0x54, 0x08, 0x00, 0x00, 0x00,  /* '~' */
+};
+
+/* VGA palette of the C_EFI_BLACK to C_EFI_WHITE text colors, as 0xRRGGBB */
+static const CEfiU32 c_efi_fbcon_palette[16] = {
+        0x000000, 0x0000aa, 0x00aa00, 0x00aaaa, 0xaa0000, 0xaa00aa, 0xaa5500, 0xaaaaaa,
+        0x555555, 0x5555ff, 0x55ff55, 0x55ffff, 0xff5555, 0xff55ff, 0xffff55, 0xffffff,
+};
+
+static inline CEfiU32 c_efi_fbcon_pixel(CEfiFbcon *fbcon, CEfiU32 rgb) {
+        CEfiU32 v = 0, c;
+        CEfiUSize i;
+
+        for (i = 0; i < 3; ++i) {
+                c = (rgb >> (16 - 8 * i)) & 0xff;
+                v |= (c >> (8 - fbcon->width_bits[i])) << fbcon->shift[i];
+        }
+
+        return v;
+}
+
+/* position and width of the contiguous bits of @mask, false if invalid */
+static inline CEfiBool c_efi_fbcon_mask(CEfiU32 mask, CEfiU8 *shiftp, CEfiU8 *widthp) {
+        CEfiU8 shift = 0, width = 0;
+
+        if (!mask)
+                return C_EFI_FALSE;
+        while (!(mask & 1)) {
+                mask >>= 1;
+                ++shift;
+        }
+        while (mask & 1) {
+                mask >>= 1;
+                ++width;
+        }
+        if (mask || width > 8)
+                return C_EFI_FALSE;
+
+        *shiftp = shift;
+        *widthp = width;
+        return C_EFI_TRUE;
+}
+
+/**
+ * c_efi_fbcon_auto_scale() - Choose glyph scale for a mode
+ * @info:               mode to choose for
+ *
+ * This picks a scale factor that gives roughly 60 rows of text, between 1
+ * and C_EFI_FBCON_SCALE_MAX.
+ *
+ * Return: The glyph scale factor.
+ */
+static inline CEfiU32 c_efi_fbcon_auto_scale(const CEfiGraphicsOutputModeInformation *info) {
+        CEfiU32 scale = info->vertical_resolution / 480;
+
+        if (scale < 1)
+                return 1;
+        if (scale > C_EFI_FBCON_SCALE_MAX)
+                return C_EFI_FBCON_SCALE_MAX;
+        return scale;
+}
+
+/**
+ * c_efi_fbcon_shadow_size() - Calculate the size of a shadow buffer
+ * @info:               mode to calculate for
+ * @scale:              glyph scale factor, or 0 to choose automatically
+ *
+ * Return: The number of pixels the shadow row buffer needs, 0 if the mode
+ *         has a linear framebuffer and needs none.
+ */
+static inline CEfiUSize c_efi_fbcon_shadow_size(const CEfiGraphicsOutputModeInformation *info, CEfiU32 scale) {
+        if (info->pixel_format != C_EFI_PIXEL_BLT_ONLY)
+                return 0;
+        if (!scale)
+                scale = c_efi_fbcon_auto_scale(info);
+
+        return (CEfiUSize)info->horizontal_resolution * C_EFI_FBCON_GLYPH_HEIGHT * scale;
+}
+
+/**
+ * c_efi_fbcon_set_attribute() - Set text colors
+ * @fbcon:              console to use
+ * @attribute:          foreground and background color, see C_EFI_WHITE and
+ *                      C_EFI_BACKGROUND_BLACK
+ *
+ * This selects the colors for following output, like `set_attribute` of
+ * the Simple Text Output protocol.
+ */
+static inline void c_efi_fbcon_set_attribute(CEfiFbcon *fbcon, CEfiUSize attribute) {
+        CEfiUSize i;
+
+        fbcon->fg = c_efi_fbcon_pixel(fbcon, c_efi_fbcon_palette[attribute & 0x0f]);
+        fbcon->bg = c_efi_fbcon_pixel(fbcon, c_efi_fbcon_palette[(attribute >> 4) & 0x07]);
+
+        /* the left pixel of a pair is at the lower address */
+        for (i = 0; i < 4; ++i)
+                fbcon->lut[i] = ((i & 2) ? fbcon->fg : fbcon->bg) |
+                                ((CEfiU64)((i & 1) ? fbcon->fg : fbcon->bg) << 32);
+}
+
+/* fill @n pixels at @p with @v, two at a time */
+static inline void c_efi_fbcon_fill(CEfiU32 *p, CEfiU32 v, CEfiUSize n) {
+        CEfiU64 pair = v | ((CEfiU64)v << 32);
+
+        for ( ; n >= 2; n -= 2, p += 2) {
+                C_EFI_MEM_BARRIER(p);
+                __builtin_memcpy(p, &pair, sizeof(pair));
+        }
+        if (n)
+                *p = v;
+}
+
+/* fill the pixel rectangle of text rows [@row, @row + @n) with the background */
+static inline void c_efi_fbcon_fill_rows(CEfiFbcon *fbcon, CEfiU32 *base, CEfiU32 row, CEfiU32 n) {
+        CEfiUSize y, cell = C_EFI_FBCON_GLYPH_HEIGHT * fbcon->scale;
+
+        for (y = row * cell; y < (row + n) * cell; ++y)
+                c_efi_fbcon_fill(base + y * fbcon->stride, fbcon->bg, fbcon->width);
+}
+
+static inline void c_efi_fbcon_draw(CEfiFbcon *fbcon, CEfiU32 *dst, CEfiChar16 c) {
+        CEfiU32 line[C_EFI_FBCON_GLYPH_WIDTH * C_EFI_FBCON_SCALE_MAX];
+        CEfiUSize x, y, i, scale = fbcon->scale;
+        const CEfiU8 *glyph;
+        CEfiU64 pair;
+        CEfiU8 bits;
+
+        if (c < 0x20 || c > 0x7e)
+                c = '?';
+        glyph = &c_efi_fbcon_font[(c - 0x20) * C_EFI_FBCON_GLYPH_HEIGHT];
+
+        for (y = 0; y < C_EFI_FBCON_GLYPH_HEIGHT; ++y) {
+                bits = glyph[y];
+
+                if (scale == 1) {
+                        for (x = 0; x < 4; ++x, dst += 2) {
+                                pair = fbcon->lut[(bits >> (6 - 2 * x)) & 3];
+                                __builtin_memcpy(dst, &pair, sizeof(pair));
+                        }
+                        dst += fbcon->stride - C_EFI_FBCON_GLYPH_WIDTH;
+                        continue;
+                }
+
+                for (x = 0; x < C_EFI_FBCON_GLYPH_WIDTH * scale; ++x)
+                        line[x] = ((bits << (x / scale)) & 0x80) ? fbcon->fg : fbcon->bg;
+
+                for (i = 0; i < scale; ++i, dst += fbcon->stride) {
+                        for (x = 0; x < C_EFI_FBCON_GLYPH_WIDTH * scale; x += 2) {
+                                C_EFI_MEM_BARRIER(dst);
+                                __builtin_memcpy(dst + x, line + x, sizeof(pair));
+                        }
+                }
+        }
+}
+
+/**
+ * c_efi_fbcon_flush() - Send pending output
+ * @fbcon:              console to flush
+ *
+ * In blt mode, this sends the changed part of the current text row to the
+ * display. With a linear framebuffer, output is immediate and this does
+ * nothing.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_flush(CEfiFbcon *fbcon) {
+        CEfiUSize cw = C_EFI_FBCON_GLYPH_WIDTH * fbcon->scale, ch = C_EFI_FBCON_GLYPH_HEIGHT * fbcon->scale;
+        CEfiU32 start = fbcon->dirty_start, end = fbcon->dirty_end;
+
+        if (fbcon->fb || start >= end)
+                return C_EFI_SUCCESS;
+
+        fbcon->dirty_start = fbcon->columns;
+        fbcon->dirty_end = 0;
+
+        return fbcon->gop->blt(fbcon->gop,
+                               (CEfiGraphicsOutputBltPixel *)fbcon->shadow,
+                               C_EFI_BLT_BUFFER_TO_VIDEO,
+                               start * cw, 0,
+                               start * cw, fbcon->row * ch,
+                               (end - start) * cw, ch,
+                               fbcon->stride * sizeof(CEfiU32));
+}
+
+/**
+ * c_efi_fbcon_clear() - Clear the screen
+ * @fbcon:              console to clear
+ *
+ * This fills the screen with the background color and moves the cursor to
+ * the top left.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_clear(CEfiFbcon *fbcon) {
+        CEfiGraphicsOutputBltPixel bg;
+        CEfiUSize y;
+
+        fbcon->column = 0;
+        fbcon->row = 0;
+        fbcon->used = 0;
+        fbcon->dirty_start = fbcon->columns;
+        fbcon->dirty_end = 0;
+
+        if (fbcon->fb) {
+                for (y = 0; y < fbcon->height; ++y)
+                        c_efi_fbcon_fill(fbcon->fb + y * fbcon->stride, fbcon->bg, fbcon->width);
+                return C_EFI_SUCCESS;
+        }
+
+        c_efi_fbcon_fill_rows(fbcon, fbcon->shadow, 0, 1);
+        __builtin_memcpy(&bg, &fbcon->bg, sizeof(bg));
+        return fbcon->gop->blt(fbcon->gop, &bg, C_EFI_BLT_VIDEO_FILL, 0, 0, 0, 0, fbcon->width, fbcon->height, 0);
+}
+
+/**
+ * c_efi_fbcon_init() - Initialize framebuffer console
+ * @fbcon:              console to initialize
+ * @gop:                graphics output protocol, with the mode already set
+ * @shadow:             shadow buffer for blt mode, or NULL
+ * @n_shadow:           size of @shadow in pixels
+ * @scale:              glyph scale factor, or 0 to choose automatically
+ *
+ * This prepares @fbcon for the current mode of @gop, and clears the screen
+ * in light gray on black. If the mode has no linear framebuffer, @shadow
+ * must have room for c_efi_fbcon_shadow_size() pixels.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_UNSUPPORTED if the pixel format is
+ *         not supported, C_EFI_INVALID_PARAMETER if @scale is too large or
+ *         the mode too small for a single character, C_EFI_BUFFER_TOO_SMALL
+ *         if @shadow is too small, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_init(CEfiFbcon *fbcon,
+                                          CEfiGraphicsOutputProtocol *gop,
+                                          CEfiU32 *shadow,
+                                          CEfiUSize n_shadow,
+                                          CEfiU32 scale) {
+        const CEfiGraphicsOutputModeInformation *info = gop->mode->info;
+        const CEfiPixelBitmask *masks = &info->pixel_information;
+        CEfiBool ok;
+
+        *fbcon = (CEfiFbcon){ .gop = gop };
+
+        if (!scale)
+                scale = c_efi_fbcon_auto_scale(info);
+        if (scale > C_EFI_FBCON_SCALE_MAX)
+                return C_EFI_INVALID_PARAMETER;
+
+        fbcon->scale = scale;
+        fbcon->width = info->horizontal_resolution;
+        fbcon->height = info->vertical_resolution;
+        fbcon->columns = fbcon->width / (C_EFI_FBCON_GLYPH_WIDTH * scale);
+        fbcon->rows = fbcon->height / (C_EFI_FBCON_GLYPH_HEIGHT * scale);
+        if (!fbcon->columns || !fbcon->rows)
+                return C_EFI_INVALID_PARAMETER;
+
+        switch (info->pixel_format) {
+        case C_EFI_PIXEL_RED_GREEN_BLUE_RESERVED_8_BIT_PER_COLOR:
+                fbcon->shift[0] = 0;
+                fbcon->shift[1] = 8;
+                fbcon->shift[2] = 16;
+                break;
+        case C_EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR:
+        case C_EFI_PIXEL_BLT_ONLY:
+                fbcon->shift[0] = 16;
+                fbcon->shift[1] = 8;
+                fbcon->shift[2] = 0;
+                break;
+        case C_EFI_PIXEL_BIT_MASK:
+                ok = c_efi_fbcon_mask(masks->red_mask, &fbcon->shift[0], &fbcon->width_bits[0]) &&
+                     c_efi_fbcon_mask(masks->green_mask, &fbcon->shift[1], &fbcon->width_bits[1]) &&
+                     c_efi_fbcon_mask(masks->blue_mask, &fbcon->shift[2], &fbcon->width_bits[2]);
+                if (!ok)
+                        return C_EFI_UNSUPPORTED;
+                break;
+        default:
+                return C_EFI_UNSUPPORTED;
+        }
+
+        if (info->pixel_format != C_EFI_PIXEL_BIT_MASK)
+                fbcon->width_bits[0] = fbcon->width_bits[1] = fbcon->width_bits[2] = 8;
+
+        if (info->pixel_format == C_EFI_PIXEL_BLT_ONLY) {
+                if (!shadow || n_shadow < c_efi_fbcon_shadow_size(info, scale))
+                        return C_EFI_BUFFER_TOO_SMALL;
+                fbcon->shadow = shadow;
+                fbcon->stride = fbcon->width;
+        } else {
+                fbcon->fb = (CEfiU32 *)(CEfiUSize)gop->mode->frame_buffer_base;
+                fbcon->stride = info->pixels_per_scan_line;
+        }
+
+        c_efi_fbcon_set_attribute(fbcon, C_EFI_LIGHTGRAY | C_EFI_BACKGROUND_BLACK);
+        return c_efi_fbcon_clear(fbcon);
+}
+
+/* make @shadow mirror text row @row, reading it back only if drawn to */
+static inline CEfiStatus c_efi_fbcon_load_row(CEfiFbcon *fbcon, CEfiU32 row) {
+        CEfiUSize ch = C_EFI_FBCON_GLYPH_HEIGHT * fbcon->scale;
+
+        if (row >= fbcon->used) {
+                c_efi_fbcon_fill_rows(fbcon, fbcon->shadow, 0, 1);
+                return C_EFI_SUCCESS;
+        }
+
+        return fbcon->gop->blt(fbcon->gop,
+                               (CEfiGraphicsOutputBltPixel *)fbcon->shadow,
+                               C_EFI_BLT_VIDEO_TO_BLT_BUFFER,
+                               0, row * ch,
+                               0, 0,
+                               fbcon->width, ch,
+                               fbcon->stride * sizeof(CEfiU32));
+}
+
+/**
+ * c_efi_fbcon_set_cursor() - Move the cursor
+ * @fbcon:              console to use
+ * @column:             new cursor column
+ * @row:                new cursor row
+ *
+ * In blt mode, this flushes pending output and reads back the target row,
+ * unless nothing was drawn to it yet.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if the position
+ *         is off-screen, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_set_cursor(CEfiFbcon *fbcon, CEfiU32 column, CEfiU32 row) {
+        CEfiStatus r;
+
+        if (column >= fbcon->columns || row >= fbcon->rows)
+                return C_EFI_INVALID_PARAMETER;
+
+        r = c_efi_fbcon_flush(fbcon);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (!fbcon->fb && row != fbcon->row) {
+                r = c_efi_fbcon_load_row(fbcon, row);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        fbcon->column = column;
+        fbcon->row = row;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_fbcon_newline(CEfiFbcon *fbcon) {
+        CEfiUSize ch = C_EFI_FBCON_GLYPH_HEIGHT * fbcon->scale;
+        CEfiGraphicsOutputBltPixel bg;
+        CEfiStatus r;
+
+        r = c_efi_fbcon_flush(fbcon);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        fbcon->column = 0;
+        if (fbcon->row + 1 < fbcon->rows) {
+                ++fbcon->row;
+                if (!fbcon->fb)
+                        return c_efi_fbcon_load_row(fbcon, fbcon->row);
+                return C_EFI_SUCCESS;
+        }
+
+        if (fbcon->fb) {
+                c_efi_memmove(fbcon->fb,
+                              fbcon->fb + ch * fbcon->stride,
+                              (fbcon->rows - 1) * ch * fbcon->stride * sizeof(CEfiU32));
+                c_efi_fbcon_fill_rows(fbcon, fbcon->fb, fbcon->rows - 1, 1);
+                return C_EFI_SUCCESS;
+        }
+
+        c_efi_fbcon_fill_rows(fbcon, fbcon->shadow, 0, 1);
+        if (fbcon->rows > 1) {
+                r = fbcon->gop->blt(fbcon->gop, C_EFI_NULL, C_EFI_BLT_VIDEO_TO_VIDEO,
+                                    0, ch, 0, 0, fbcon->width, (fbcon->rows - 1) * ch, 0);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        __builtin_memcpy(&bg, &fbcon->bg, sizeof(bg));
+        return fbcon->gop->blt(fbcon->gop, &bg, C_EFI_BLT_VIDEO_FILL,
+                               0, 0, 0, (fbcon->rows - 1) * ch, fbcon->width, ch, 0);
+}
+
+/**
+ * c_efi_fbcon_putc() - Write a character
+ * @fbcon:              console to write to
+ * @c:                  character to write
+ *
+ * This draws @c at the cursor and advances it, wrapping and scrolling as
+ * needed. `\n` starts a new line, `\r` returns to the first column, `\b`
+ * moves back one column, and `\t` advances to the next multiple of 8.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_putc(CEfiFbcon *fbcon, CEfiChar16 c) {
+        CEfiUSize cw = C_EFI_FBCON_GLYPH_WIDTH * fbcon->scale, ch = C_EFI_FBCON_GLYPH_HEIGHT * fbcon->scale;
+        CEfiStatus r;
+        CEfiU32 *dst;
+
+        switch (c) {
+        case '\n':
+                return c_efi_fbcon_newline(fbcon);
+        case '\r':
+                fbcon->column = 0;
+                return C_EFI_SUCCESS;
+        case '\b':
+                if (fbcon->column)
+                        --fbcon->column;
+                return C_EFI_SUCCESS;
+        case '\t':
+                do {
+                        r = c_efi_fbcon_putc(fbcon, ' ');
+                        if (C_EFI_ERROR(r))
+                                return r;
+                } while (fbcon->column % 8);
+                return C_EFI_SUCCESS;
+        }
+
+        if (fbcon->column >= fbcon->columns) {
+                r = c_efi_fbcon_newline(fbcon);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        if (fbcon->fb) {
+                dst = fbcon->fb + fbcon->row * ch * fbcon->stride + fbcon->column * cw;
+        } else {
+                dst = fbcon->shadow + fbcon->column * cw;
+                if (fbcon->column < fbcon->dirty_start)
+                        fbcon->dirty_start = fbcon->column;
+                if (fbcon->column >= fbcon->dirty_end)
+                        fbcon->dirty_end = fbcon->column + 1;
+        }
+
+        c_efi_fbcon_draw(fbcon, dst, c);
+        ++fbcon->column;
+        if (fbcon->row >= fbcon->used)
+                fbcon->used = fbcon->row + 1;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_fbcon_write() - Write UCS-2 text
+ * @fbcon:              console to write to
+ * @s:                  text to write
+ * @n:                  number of characters in @s
+ *
+ * This writes all characters of @s via c_efi_fbcon_putc(), and flushes the
+ * output once at the end.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_write(CEfiFbcon *fbcon, const CEfiChar16 *s, CEfiUSize n) {
+        CEfiStatus r;
+        CEfiUSize i;
+
+        for (i = 0; i < n; ++i) {
+                r = c_efi_fbcon_putc(fbcon, s[i]);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        return c_efi_fbcon_flush(fbcon);
+}
+
+/**
+ * c_efi_fbcon_write8() - Write 8-bit text
+ * @fbcon:              console to write to
+ * @s:                  text to write
+ * @n:                  number of bytes in @s
+ *
+ * This is like c_efi_fbcon_write(), but takes ASCII or UTF-8 text. Characters
+ * beyond ASCII are drawn as a single `?`.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `blt`.
+ */
+static inline CEfiStatus c_efi_fbcon_write8(CEfiFbcon *fbcon, const CEfiChar8 *s, CEfiUSize n) {
+        CEfiStatus r;
+        CEfiUSize i;
+
+        for (i = 0; i < n; ++i) {
+                /* skip UTF-8 continuation bytes */
+                if ((s[i] & 0xc0) == 0x80)
+                        continue;
+
+                r = c_efi_fbcon_putc(fbcon, s[i]);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        return c_efi_fbcon_flush(fbcon);
+}
+
+#ifdef __cplusplus
+}
+#endif
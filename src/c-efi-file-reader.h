@@ -0,0 +1,334 @@
+#pragma once
+
+/**
+ * Buffered File Reader
+ *
+ * Firmware file systems pay a large fixed cost per `read` call, so reading
+ * files in small pieces is slow. This header wraps a File protocol handle:
+ *
+ *  - Small reads are served from a page-aligned buffer, refilled with reads
+ *    of a large chunk size. Reads of at least one chunk bypass the buffer.
+ *
+ *  - c_efi_file_reader_load() reads the rest of a file into fresh
+ *    `allocate_pages` memory. If `get_info` reports the size, it reads
+ *    straight into the destination, one chunk per call, without a bounce
+ *    buffer. Otherwise, the destination grows by doubling.
+ *
+ *  - Every `read` call is counted, along with the bytes it returned. If a
+ *    CEfiClock is given, the time spent in `read` is accumulated as well,
+ *    so callers can report throughput.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-clock.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-simple-file-system.h>
+
+#define C_EFI_FILE_READER_CHUNK_SIZE (4 * 1024 * 1024)
+
+/**
+ * CEfiFileReader: Buffered File Reader
+ * @bs:                 boot services, used for allocations
+ * @file:               file to read
+ * @clock:              clock to time `read` calls with, or NULL
+ * @chunk_size:         size of buffer refills and loads, a multiple of 4096
+ * @buffer:             buffer pages, or 0 if not yet allocated
+ * @start:              offset of the first unread byte in @buffer
+ * @end:                offset of the end of valid data in @buffer
+ * @eof:                whether the end of the file was reached
+ * @n_reads:            number of `read` calls
+ * @n_bytes:            number of bytes returned by `read`
+ * @n_ns:               time spent in `read`, if @clock is set
+ */
+typedef struct CEfiFileReader {
+        CEfiBootServices *bs;
+        CEfiFileProtocol *file;
+        const CEfiClock *clock;
+        CEfiUSize chunk_size;
+        CEfiPhysicalAddress buffer;
+        CEfiUSize start;
+        CEfiUSize end;
+        CEfiBool eof;
+        CEfiU64 n_reads;
+        CEfiU64 n_bytes;
+        CEfiU64 n_ns;
+} CEfiFileReader;
+
+/**
+ * c_efi_file_reader_init() - Initialize reader
+ * @reader:             reader to initialize
+ * @bs:                 boot services
+ * @file:               file to read, from its current position
+ * @clock:              clock to time `read` calls with, or NULL
+ * @chunk_size:         size of reads, or 0 for the default
+ *
+ * @chunk_size is rounded up to a multiple of the page size. The buffer is
+ * only allocated by the first buffered read.
+ */
+static inline void c_efi_file_reader_init(CEfiFileReader *reader,
+                                          CEfiBootServices *bs,
+                                          CEfiFileProtocol *file,
+                                          const CEfiClock *clock,
+                                          CEfiUSize chunk_size) {
+        if (!chunk_size)
+                chunk_size = C_EFI_FILE_READER_CHUNK_SIZE;
+
+        *reader = (CEfiFileReader){
+                .bs = bs,
+                .file = file,
+                .clock = clock,
+                .chunk_size = (chunk_size + 4095) & ~(CEfiUSize)4095,
+        };
+}
+
+/**
+ * c_efi_file_reader_deinit() - Deinitialize reader
+ * @reader:             reader to deinitialize
+ *
+ * This frees the buffer. The file is not closed.
+ */
+static inline void c_efi_file_reader_deinit(CEfiFileReader *reader) {
+        if (reader->buffer)
+                reader->bs->free_pages(reader->buffer, reader->chunk_size / 4096);
+
+        reader->buffer = 0;
+        reader->start = 0;
+        reader->end = 0;
+}
+
+/* a single counted `read` call */
+static inline CEfiStatus c_efi_file_reader_io(CEfiFileReader *reader, void *buffer, CEfiUSize *sizep) {
+        CEfiU64 start = 0;
+        CEfiStatus r;
+
+        if (reader->clock)
+                start = c_efi_clock_ns(reader->clock);
+
+        r = reader->file->read(reader->file, sizep, buffer);
+
+        if (reader->clock)
+                reader->n_ns += c_efi_clock_ns(reader->clock) - start;
+        ++reader->n_reads;
+        if (C_EFI_ERROR(r))
+                return r;
+
+        reader->n_bytes += *sizep;
+        if (!*sizep)
+                reader->eof = C_EFI_TRUE;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_file_reader_size() - Query the remaining size
+ * @reader:             reader to query
+ * @sizep:              output for the number of unread bytes
+ *
+ * This asks the file for its size and position via `get_info` and
+ * `get_position`, and accounts for buffered data.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of a file or allocation
+ *         call.
+ */
+static inline CEfiStatus c_efi_file_reader_size(CEfiFileReader *reader, CEfiU64 *sizep) {
+        CEfiU64 storage[(sizeof(CEfiFileInfo) + 256 * sizeof(CEfiChar16)) / sizeof(CEfiU64)];
+        CEfiUSize size = sizeof(storage);
+        CEfiFileInfo *info = (CEfiFileInfo *)storage;
+        CEfiU64 position = 0, file_size = 0;
+        void *pool = C_EFI_NULL;
+        CEfiStatus r;
+
+        r = reader->file->get_info(reader->file, &C_EFI_FILE_INFO_ID, &size, info);
+        if (r == C_EFI_BUFFER_TOO_SMALL) {
+                /* the file name does not fit on the stack */
+                r = reader->bs->allocate_pool(C_EFI_LOADER_DATA, size, &pool);
+                if (C_EFI_ERROR(r))
+                        return r;
+                info = pool;
+                r = reader->file->get_info(reader->file, &C_EFI_FILE_INFO_ID, &size, info);
+        }
+        if (!C_EFI_ERROR(r))
+                file_size = info->file_size;
+        if (pool)
+                reader->bs->free_pool(pool);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = reader->file->get_position(reader->file, &position);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        *sizep = (position < file_size ? file_size - position : 0) + (reader->end - reader->start);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_file_reader_read() - Read from the file
+ * @reader:             reader to use
+ * @buffer:             output buffer
+ * @size:               number of bytes to read
+ * @n_readp:            output for the number of bytes read
+ *
+ * This reads up to @size bytes. Fewer bytes are only returned at the end
+ * of the file.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `read` or
+ *         `allocate_pages`. On error, @n_readp is still set.
+ */
+static inline CEfiStatus c_efi_file_reader_read(CEfiFileReader *reader, void *buffer, CEfiUSize size, CEfiUSize *n_readp) {
+        CEfiU8 *p = buffer;
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiUSize n;
+
+        while (size) {
+                if (reader->start < reader->end) {
+                        n = reader->end - reader->start;
+                        if (n > size)
+                                n = size;
+                        c_efi_memcpy(p, (CEfiU8 *)(CEfiUSize)reader->buffer + reader->start, n);
+                        reader->start += n;
+                } else if (reader->eof) {
+                        break;
+                } else if (size >= reader->chunk_size) {
+                        n = size - size % reader->chunk_size;
+                        r = c_efi_file_reader_io(reader, p, &n);
+                        if (C_EFI_ERROR(r))
+                                break;
+                } else {
+                        if (!reader->buffer) {
+                                r = reader->bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES,
+                                                               C_EFI_LOADER_DATA,
+                                                               reader->chunk_size / 4096,
+                                                               &reader->buffer);
+                                if (C_EFI_ERROR(r)) {
+                                        reader->buffer = 0;
+                                        break;
+                                }
+                        }
+
+                        n = reader->chunk_size;
+                        r = c_efi_file_reader_io(reader, (void *)(CEfiUSize)reader->buffer, &n);
+                        if (C_EFI_ERROR(r))
+                                break;
+                        reader->start = 0;
+                        reader->end = n;
+                        continue;
+                }
+
+                p += n;
+                size -= n;
+        }
+
+        *n_readp = p - (CEfiU8 *)buffer;
+        return r;
+}
+
+/* grow the pages at @addressp from @n_pages to @n_new pages */
+static inline CEfiStatus c_efi_file_reader_grow(CEfiFileReader *reader,
+                                                CEfiMemoryType memory_type,
+                                                CEfiPhysicalAddress *addressp,
+                                                CEfiUSize n_pages,
+                                                CEfiUSize n_used,
+                                                CEfiUSize n_new) {
+        CEfiPhysicalAddress address = 0;
+        CEfiStatus r;
+
+        r = reader->bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES, memory_type, n_new, &address);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (n_pages) {
+                c_efi_memcpy((void *)(CEfiUSize)address, (void *)(CEfiUSize)*addressp, n_used);
+                reader->bs->free_pages(*addressp, n_pages);
+        }
+
+        *addressp = address;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_file_reader_load() - Load the rest of the file
+ * @reader:             reader to use
+ * @memory_type:        memory type of the allocation
+ * @addressp:           output for the allocated pages
+ * @sizep:              output for the number of bytes loaded
+ *
+ * This allocates pages for all unread bytes, and reads them. If the size is
+ * known, the file is trusted to not grow meanwhile. Pages beyond the bytes
+ * read are freed before returning, whether the size was unknown and the
+ * allocation grew past the end, or the file was shorter than reported. The
+ * caller owns the pages, and frees them with `free_pages` of
+ * `(size + 4095) / 4096` pages, or 1 page if the file was empty.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `read` or
+ *         `allocate_pages`.
+ */
+static inline CEfiStatus c_efi_file_reader_load(CEfiFileReader *reader,
+                                                CEfiMemoryType memory_type,
+                                                CEfiPhysicalAddress *addressp,
+                                                CEfiUSize *sizep) {
+        CEfiPhysicalAddress address = 0;
+        CEfiUSize n, n_pages, used;
+        CEfiU64 size = 0;
+        CEfiBool known;
+        CEfiStatus r;
+
+        r = c_efi_file_reader_size(reader, &size);
+        known = !C_EFI_ERROR(r);
+        if (known && size > (CEfiUSize)-1 - 4095)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        n_pages = known ? ((CEfiUSize)size + 4095) / 4096 : reader->chunk_size / 4096;
+        if (!n_pages)
+                n_pages = 1;
+
+        r = c_efi_file_reader_grow(reader, memory_type, &address, 0, 0, n_pages);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        /* hand over buffered data first, then read straight into the pages */
+        used = reader->end - reader->start;
+        c_efi_memcpy((void *)(CEfiUSize)address, (CEfiU8 *)(CEfiUSize)reader->buffer + reader->start, used);
+        reader->start = reader->end = 0;
+
+        while (!reader->eof && (!known || used < size)) {
+                if (used == n_pages * 4096) {
+                        r = c_efi_file_reader_grow(reader, memory_type, &address, n_pages, used, n_pages * 2);
+                        if (C_EFI_ERROR(r))
+                                goto error;
+                        n_pages *= 2;
+                }
+
+                n = n_pages * 4096 - used;
+                if (known && n > size - used)
+                        n = size - used;
+                if (n > reader->chunk_size)
+                        n = reader->chunk_size;
+
+                r = c_efi_file_reader_io(reader, (CEfiU8 *)(CEfiUSize)address + used, &n);
+                if (C_EFI_ERROR(r))
+                        goto error;
+                used += n;
+        }
+
+        /* return the tail, so the caller can compute the page count */
+        n = used ? (used + 4095) / 4096 : 1;
+        if (n < n_pages)
+                reader->bs->free_pages(address + n * 4096, n_pages - n);
+
+        *addressp = address;
+        *sizep = used;
+        return C_EFI_SUCCESS;
+
+error:
+        reader->bs->free_pages(address, n_pages);
+        return r;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,498 @@
+#pragma once
+
+/**
+ * GUID Partition Table Parser
+ *
+ * This header validates GUID partition tables, and looks up partitions by
+ * their type or unique GUID. All structures are used in place, in buffers
+ * provided by the caller, so nothing is copied:
+ *
+ *  - Headers are validated as required by the specification: signature,
+ *    CRC32 over the header with the CRC field taken as zero, own LBA, and
+ *    sane usable range and entry array geometry. The CRC32 of the entry
+ *    array is verified, and used entries must lie in the usable range.
+ *
+ *  - c_efi_gpt_load() reads the primary header and entries, and the backup
+ *    header, via Block I/O. The backup entries are only read if the primary
+ *    table is damaged, in which case the backup is used.
+ *
+ *  - An index hashes used entries by type and unique GUID with
+ *    c_efi_guid_hash(), into caller-provided open-addressing tables.
+ *
+ *  - Hard drive media device nodes are built for entries, and matched
+ *    against entries, so boot entries can refer to partitions.
+ *
+ * All buffers must be 8-byte aligned, since headers and entries are used
+ * in place and contain GUIDs.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-crc32.h>
+#include <c-efi-guid.h>
+#include <c-efi-protocol-block-io.h>
+#include <c-efi-protocol-device-path.h>
+
+#define C_EFI_GPT_HEADER_SIGNATURE C_EFI_U64_C(0x5452415020494645) /* "EFI PART" */
+#define C_EFI_GPT_HEADER_REVISION C_EFI_U32_C(0x00010000)
+#define C_EFI_GPT_HEADER_SIZE_MIN 92
+#define C_EFI_GPT_ENTRY_SIZE_MIN 128
+#define C_EFI_GPT_ENTRIES_SIZE_MAX (1024 * 1024)
+#define C_EFI_GPT_NONE C_EFI_U32_C(0xffffffff)
+
+#define C_EFI_GPT_TYPE_UNUSED_GUID C_EFI_GUID(0x00000000, 0x0000, 0x0000, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00)
+#define C_EFI_GPT_TYPE_EFI_SYSTEM_GUID C_EFI_GUID(0xc12a7328, 0xf81f, 0x11d2, 0xba, 0x4b, 0x00, 0xa0, 0xc9, 0x3e, 0xc9, 0x3b)
+#define C_EFI_GPT_TYPE_LEGACY_MBR_GUID C_EFI_GUID(0x024dee41, 0x33e7, 0x11d3, 0x9d, 0x69, 0x00, 0x08, 0xc7, 0x81, 0xf3, 0x9f)
+
+#define C_EFI_GPT_ATTRIBUTE_REQUIRED_PARTITION          C_EFI_U64_C(0x0000000000000001)
+#define C_EFI_GPT_ATTRIBUTE_NO_BLOCK_IO_PROTOCOL        C_EFI_U64_C(0x0000000000000002)
+#define C_EFI_GPT_ATTRIBUTE_LEGACY_BIOS_BOOTABLE        C_EFI_U64_C(0x0000000000000004)
+
+typedef struct CEfiGptHeader {
+        CEfiU64 signature;
+        CEfiU32 revision;
+        CEfiU32 header_size;
+        CEfiU32 header_crc32;
+        CEfiU32 reserved;
+        CEfiLba my_lba;
+        CEfiLba alternate_lba;
+        CEfiLba first_usable_lba;
+        CEfiLba last_usable_lba;
+        CEfiGuid disk_guid;
+        CEfiLba partition_entry_lba;
+        CEfiU32 number_of_partition_entries;
+        CEfiU32 size_of_partition_entry;
+        CEfiU32 partition_entry_array_crc32;
+} CEfiGptHeader;
+
+typedef struct CEfiGptEntry {
+        CEfiGuid partition_type_guid;
+        CEfiGuid unique_partition_guid;
+        CEfiLba starting_lba;
+        CEfiLba ending_lba;
+        CEfiU64 attributes;
+        CEfiChar16 partition_name[36];
+} CEfiGptEntry;
+
+/**
+ * CEfiGpt: Parsed Partition Table
+ * @header:             header in use, primary if valid, otherwise backup
+ * @entries:            entry array of @header
+ * @n_entries:          number of entries
+ * @entry_size:         size of each entry
+ * @primary_valid:      whether the primary table is valid
+ * @backup_valid:       whether the backup header is valid, and matches the
+ *                      primary one if that is valid too
+ */
+typedef struct CEfiGpt {
+        const CEfiGptHeader *header;
+        const CEfiU8 *entries;
+        CEfiU32 n_entries;
+        CEfiU32 entry_size;
+        CEfiBool primary_valid;
+        CEfiBool backup_valid;
+} CEfiGpt;
+
+/**
+ * CEfiGptIndex: Partition Index
+ * @gpt:                indexed table
+ * @by_type:            hash table of entries by type GUID
+ * @by_unique:          hash table of entries by unique GUID
+ * @mask:               size of each hash table minus 1
+ *
+ * Hash table slots hold the entry number plus 1, or 0 if empty.
+ */
+typedef struct CEfiGptIndex {
+        const CEfiGpt *gpt;
+        CEfiU32 *by_type;
+        CEfiU32 *by_unique;
+        CEfiU32 mask;
+} CEfiGptIndex;
+
+/**
+ * c_efi_gpt_entries_size() - Size of the entry array
+ * @header:             validated header
+ *
+ * Return: The size of the entry array of @header in bytes.
+ */
+static inline CEfiUSize c_efi_gpt_entries_size(const CEfiGptHeader *header) {
+        return (CEfiUSize)header->number_of_partition_entries * header->size_of_partition_entry;
+}
+
+/**
+ * c_efi_gpt_header_check() - Validate a partition table header
+ * @block:              block holding the header
+ * @block_size:         block size of the media
+ * @lba:                LBA @block was read from
+ * @last_block:         last block of the media
+ *
+ * Return: C_EFI_SUCCESS if valid, C_EFI_NOT_FOUND if the signature is
+ *         missing, C_EFI_CRC_ERROR if the CRC32 does not match,
+ *         C_EFI_VOLUME_CORRUPTED if a field is invalid, or
+ *         C_EFI_INVALID_PARAMETER if @block is misaligned.
+ */
+static inline CEfiStatus c_efi_gpt_header_check(const void *block, CEfiUSize block_size, CEfiLba lba, CEfiLba last_block) {
+        static const CEfiU8 zero[4];
+        const CEfiGptHeader *h = block;
+        CEfiU64 n_blocks;
+        CEfiU32 crc;
+
+        if ((CEfiUSize)block & 7)
+                return C_EFI_INVALID_PARAMETER;
+        if (block_size < C_EFI_GPT_HEADER_SIZE_MIN || h->signature != C_EFI_GPT_HEADER_SIGNATURE)
+                return C_EFI_NOT_FOUND;
+        if ((h->revision >> 16) != 1 || h->header_size < C_EFI_GPT_HEADER_SIZE_MIN || h->header_size > block_size)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        crc = c_efi_crc32(0, h, 16);
+        crc = c_efi_crc32(crc, zero, 4);
+        crc = c_efi_crc32(crc, (const CEfiU8 *)h + 20, h->header_size - 20);
+        if (crc != h->header_crc32)
+                return C_EFI_CRC_ERROR;
+
+        if (h->my_lba != lba ||
+            h->alternate_lba > last_block ||
+            h->first_usable_lba > h->last_usable_lba ||
+            h->last_usable_lba > last_block ||
+            h->size_of_partition_entry < C_EFI_GPT_ENTRY_SIZE_MIN ||
+            (h->size_of_partition_entry & (h->size_of_partition_entry - 1)) ||
+            h->number_of_partition_entries > C_EFI_GPT_ENTRIES_SIZE_MAX / h->size_of_partition_entry)
+                return C_EFI_VOLUME_CORRUPTED;
+
+        /* the entry array must lie outside of the usable range */
+        n_blocks = (c_efi_gpt_entries_size(h) + block_size - 1) / block_size;
+        if (h->partition_entry_lba > last_block ||
+            n_blocks > last_block + 1 - h->partition_entry_lba ||
+            (h->partition_entry_lba + n_blocks > h->first_usable_lba &&
+             h->partition_entry_lba <= h->last_usable_lba))
+                return C_EFI_VOLUME_CORRUPTED;
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_gpt_entries_check() - Validate a partition entry array
+ * @header:             validated header of the array
+ * @entries:            entry array
+ *
+ * @entries must hold at least c_efi_gpt_entries_size() bytes.
+ *
+ * Return: C_EFI_SUCCESS if valid, C_EFI_CRC_ERROR if the CRC32 does not
+ *         match, C_EFI_VOLUME_CORRUPTED if a used entry is outside of the
+ *         usable range, or C_EFI_INVALID_PARAMETER if @entries is
+ *         misaligned.
+ */
+static inline CEfiStatus c_efi_gpt_entries_check(const CEfiGptHeader *header, const void *entries) {
+        const CEfiGptEntry *e;
+        CEfiU32 i;
+
+        if ((CEfiUSize)entries & 7)
+                return C_EFI_INVALID_PARAMETER;
+        if (c_efi_crc32(0, entries, c_efi_gpt_entries_size(header)) != header->partition_entry_array_crc32)
+                return C_EFI_CRC_ERROR;
+
+        for (i = 0; i < header->number_of_partition_entries; ++i) {
+                e = (const CEfiGptEntry *)((const CEfiU8 *)entries + (CEfiUSize)i * header->size_of_partition_entry);
+                if (c_efi_guid_equal(&e->partition_type_guid, &C_EFI_GPT_TYPE_UNUSED_GUID))
+                        continue;
+                if (e->starting_lba < header->first_usable_lba ||
+                    e->starting_lba > e->ending_lba ||
+                    e->ending_lba > header->last_usable_lba)
+                        return C_EFI_VOLUME_CORRUPTED;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/* point @gpt at a validated header and its entry array */
+static inline void c_efi_gpt_use(CEfiGpt *gpt, const CEfiGptHeader *header, const void *entries) {
+        gpt->header = header;
+        gpt->entries = entries;
+        gpt->n_entries = header->number_of_partition_entries;
+        gpt->entry_size = header->size_of_partition_entry;
+}
+
+/**
+ * c_efi_gpt_load() - Read and validate the partition table of a disk
+ * @gpt:                output for the parsed table
+ * @bio:                block device of the whole disk
+ * @buffer:             buffer to read into, aligned to 8 and `io_align`
+ * @n_buffer:           size of @buffer in bytes
+ *
+ * @gpt points into @buffer afterwards. Two blocks plus the entry array
+ * are needed, usually 16 KiB. If the primary table is damaged, the backup
+ * table is used instead.
+ *
+ * Return: C_EFI_SUCCESS if a valid table was found, C_EFI_BUFFER_TOO_SMALL
+ *         if @buffer is too small, C_EFI_INVALID_PARAMETER if it is
+ *         misaligned, the error of `read_blocks`, or the validation error
+ *         of the primary table.
+ */
+static inline CEfiStatus c_efi_gpt_load(CEfiGpt *gpt, CEfiBlockIoProtocol *bio, void *buffer, CEfiUSize n_buffer) {
+        CEfiBlockIoMedia *media = bio->media;
+        CEfiUSize bs = media->block_size, align, n;
+        CEfiU8 *primary = buffer, *backup = primary + bs, *entries = backup + bs;
+        const CEfiGptHeader *p = (const void *)primary, *b = (const void *)backup;
+        CEfiLba backup_lba = media->last_block;
+        CEfiStatus r, r_primary;
+
+        *gpt = (CEfiGpt){ 0 };
+
+        align = media->io_align > 8 ? media->io_align : 8;
+        if (((CEfiUSize)buffer & (align - 1)) || (bs & 7))
+                return C_EFI_INVALID_PARAMETER;
+        if (n_buffer / 2 < bs || media->last_block < 2)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        r = bio->read_blocks(bio, media->media_id, 1, bs, primary);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r_primary = c_efi_gpt_header_check(primary, bs, 1, media->last_block);
+        if (!C_EFI_ERROR(r_primary)) {
+                n = (c_efi_gpt_entries_size(p) + bs - 1) / bs * bs;
+                if (n > n_buffer - 2 * bs)
+                        return C_EFI_BUFFER_TOO_SMALL;
+
+                r = bio->read_blocks(bio, media->media_id, p->partition_entry_lba, n, entries);
+                if (C_EFI_ERROR(r))
+                        return r;
+
+                r_primary = c_efi_gpt_entries_check(p, entries);
+                backup_lba = p->alternate_lba;
+        }
+
+        r = bio->read_blocks(bio, media->media_id, backup_lba, bs, backup);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = c_efi_gpt_header_check(backup, bs, backup_lba, media->last_block);
+        if (!C_EFI_ERROR(r) && b->alternate_lba != 1)
+                r = C_EFI_VOLUME_CORRUPTED;
+
+        if (!C_EFI_ERROR(r_primary)) {
+                gpt->primary_valid = C_EFI_TRUE;
+                c_efi_gpt_use(gpt, p, entries);
+
+                /* the backup must describe the same table */
+                gpt->backup_valid = !C_EFI_ERROR(r) &&
+                                    c_efi_guid_equal(&b->disk_guid, &p->disk_guid) &&
+                                    b->number_of_partition_entries == p->number_of_partition_entries &&
+                                    b->size_of_partition_entry == p->size_of_partition_entry &&
+                                    b->partition_entry_array_crc32 == p->partition_entry_array_crc32;
+                return C_EFI_SUCCESS;
+        }
+
+        if (C_EFI_ERROR(r))
+                return r_primary;
+
+        n = (c_efi_gpt_entries_size(b) + bs - 1) / bs * bs;
+        if (n > n_buffer - 2 * bs)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        r = bio->read_blocks(bio, media->media_id, b->partition_entry_lba, n, entries);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (C_EFI_ERROR(c_efi_gpt_entries_check(b, entries)))
+                return r_primary;
+
+        gpt->backup_valid = C_EFI_TRUE;
+        c_efi_gpt_use(gpt, b, entries);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_gpt_entry() - Get a partition entry
+ * @gpt:                parsed table
+ * @i:                  0-based entry number, less than @gpt->n_entries
+ *
+ * Return: Pointer to the entry, within the buffer of the table.
+ */
+static inline const CEfiGptEntry *c_efi_gpt_entry(const CEfiGpt *gpt, CEfiU32 i) {
+        return (const CEfiGptEntry *)(gpt->entries + (CEfiUSize)i * gpt->entry_size);
+}
+
+static inline void c_efi_gpt_index_insert(CEfiU32 *table, CEfiU32 mask, const CEfiGuid *guid, CEfiU32 i) {
+        CEfiU64 h = c_efi_guid_hash(guid);
+
+        while (table[h & mask])
+                ++h;
+        table[h & mask] = i + 1;
+}
+
+/**
+ * c_efi_gpt_index_init() - Index a partition table
+ * @index:              index to initialize
+ * @gpt:                parsed table to index, must outlive @index
+ * @slots:              storage for the hash tables
+ * @n_slots:            number of entries in @slots
+ *
+ * Each hash table gets the largest power of two of slots that fits in half
+ * of @slots. Unused entries are not indexed.
+ *
+ * Return: C_EFI_SUCCESS on success, or C_EFI_BUFFER_TOO_SMALL if the hash
+ *         tables would not have more slots than there are used entries.
+ */
+static inline CEfiStatus c_efi_gpt_index_init(CEfiGptIndex *index, const CEfiGpt *gpt, CEfiU32 *slots, CEfiUSize n_slots) {
+        const CEfiGptEntry *e;
+        CEfiU32 i, n_used = 0, size = 1;
+
+        *index = (CEfiGptIndex){ .gpt = gpt };
+
+        for (i = 0; i < gpt->n_entries; ++i)
+                if (!c_efi_guid_equal(&c_efi_gpt_entry(gpt, i)->partition_type_guid, &C_EFI_GPT_TYPE_UNUSED_GUID))
+                        ++n_used;
+
+        while (size <= n_slots / 4)
+                size *= 2;
+        if (size * 2 > n_slots || size <= n_used)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        index->by_type = slots;
+        index->by_unique = slots + size;
+        index->mask = size - 1;
+        for (i = 0; i < 2 * size; ++i)
+                slots[i] = 0;
+
+        for (i = 0; i < gpt->n_entries; ++i) {
+                e = c_efi_gpt_entry(gpt, i);
+                if (c_efi_guid_equal(&e->partition_type_guid, &C_EFI_GPT_TYPE_UNUSED_GUID))
+                        continue;
+                c_efi_gpt_index_insert(index->by_type, index->mask, &e->partition_type_guid, i);
+                c_efi_gpt_index_insert(index->by_unique, index->mask, &e->unique_partition_guid, i);
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_gpt_index_find_unique() - Find a partition by unique GUID
+ * @index:              index to search
+ * @guid:               unique partition GUID
+ *
+ * Return: The 0-based entry number, or C_EFI_GPT_NONE if not found.
+ */
+static inline CEfiU32 c_efi_gpt_index_find_unique(const CEfiGptIndex *index, const CEfiGuid *guid) {
+        CEfiU64 h = c_efi_guid_hash(guid);
+        CEfiU32 slot;
+
+        for ( ; (slot = index->by_unique[h & index->mask]); ++h)
+                if (c_efi_guid_equal(&c_efi_gpt_entry(index->gpt, slot - 1)->unique_partition_guid, guid))
+                        return slot - 1;
+
+        return C_EFI_GPT_NONE;
+}
+
+/**
+ * c_efi_gpt_index_find_type() - Find partitions by type GUID
+ * @index:              index to search
+ * @type:               partition type GUID
+ * @iter:               iterator, initialize to 0
+ *
+ * Call repeatedly with the same @iter to get all partitions of @type. They
+ * are returned in no particular order.
+ *
+ * Return: The 0-based entry number of the next match, or C_EFI_GPT_NONE if
+ *         there are no more.
+ */
+static inline CEfiU32 c_efi_gpt_index_find_type(const CEfiGptIndex *index, const CEfiGuid *type, CEfiU32 *iter) {
+        CEfiU64 h = c_efi_guid_hash(type) + *iter;
+        CEfiU32 slot;
+
+        for ( ; (slot = index->by_type[h & index->mask]); ++h) {
+                ++*iter;
+                if (c_efi_guid_equal(&c_efi_gpt_entry(index->gpt, slot - 1)->partition_type_guid, type))
+                        return slot - 1;
+        }
+
+        return C_EFI_GPT_NONE;
+}
+
+static inline void c_efi_gpt_put_le(CEfiU8 *p, CEfiU64 v, CEfiUSize n) {
+        CEfiUSize i;
+
+        for (i = 0; i < n; ++i, v >>= 8)
+                p[i] = (CEfiU8)v;
+}
+
+static inline CEfiU64 c_efi_gpt_get_le(const CEfiU8 *p, CEfiUSize n) {
+        CEfiU64 v = 0;
+
+        while (n--)
+                v = (v << 8) | p[n];
+        return v;
+}
+
+/**
+ * c_efi_gpt_device_path() - Build a hard drive device node
+ * @gpt:                parsed table
+ * @i:                  0-based entry number
+ * @node:               output for the device node
+ */
+static inline void c_efi_gpt_device_path(const CEfiGpt *gpt, CEfiU32 i, CEfiDevicePathHardDrive *node) {
+        const CEfiGptEntry *e = c_efi_gpt_entry(gpt, i);
+        const CEfiU8 *guid = (const CEfiU8 *)&e->unique_partition_guid;
+        CEfiUSize k;
+
+        node->header = (CEfiDevicePathProtocol){
+                .type = C_EFI_DEVICE_PATH_TYPE_MEDIA,
+                .subtype = C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_HARD_DRIVE,
+                .length = { sizeof(*node), 0 },
+        };
+        c_efi_gpt_put_le(node->partition_number, i + 1, 4);
+        c_efi_gpt_put_le(node->partition_start, e->starting_lba, 8);
+        c_efi_gpt_put_le(node->partition_size, e->ending_lba - e->starting_lba + 1, 8);
+        for (k = 0; k < 16; ++k)
+                node->partition_signature[k] = guid[k];
+        node->partition_format = C_EFI_HARD_DRIVE_PARTITION_FORMAT_GPT;
+        node->signature_type = C_EFI_HARD_DRIVE_SIGNATURE_TYPE_GUID;
+}
+
+/**
+ * c_efi_gpt_index_match_device_path() - Find the partition of a device node
+ * @index:              index to search
+ * @node:               device node to match
+ *
+ * This finds the partition a GPT hard drive device node refers to. The
+ * unique GUID, start and size must all match, the entry number is ignored,
+ * like firmware does when expanding short-form device paths.
+ *
+ * Return: The 0-based entry number, or C_EFI_GPT_NONE if @node is not a GPT
+ *         hard drive node, or does not match any partition.
+ */
+static inline CEfiU32 c_efi_gpt_index_match_device_path(const CEfiGptIndex *index, const CEfiDevicePathProtocol *node) {
+        const CEfiDevicePathHardDrive *hd = (const CEfiDevicePathHardDrive *)node;
+        const CEfiGptEntry *e;
+        CEfiGuid guid;
+        CEfiUSize k;
+        CEfiU32 i;
+
+        if (node->type != C_EFI_DEVICE_PATH_TYPE_MEDIA ||
+            node->subtype != C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_HARD_DRIVE ||
+            c_efi_gpt_get_le(node->length, 2) < sizeof(*hd) ||
+            hd->partition_format != C_EFI_HARD_DRIVE_PARTITION_FORMAT_GPT ||
+            hd->signature_type != C_EFI_HARD_DRIVE_SIGNATURE_TYPE_GUID)
+                return C_EFI_GPT_NONE;
+
+        for (k = 0; k < 16; ++k)
+                guid.u8[k] = hd->partition_signature[k];
+
+        i = c_efi_gpt_index_find_unique(index, &guid);
+        if (i == C_EFI_GPT_NONE)
+                return C_EFI_GPT_NONE;
+
+        e = c_efi_gpt_entry(index->gpt, i);
+        if (c_efi_gpt_get_le(hd->partition_start, 8) != e->starting_lba ||
+            c_efi_gpt_get_le(hd->partition_size, 8) != e->ending_lba - e->starting_lba + 1)
+                return C_EFI_GPT_NONE;
+
+        return i;
+}
+
+#ifdef __cplusplus
+}
+#endif
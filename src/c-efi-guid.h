@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * GUID Helpers
+ *
+ * GUIDs identify protocols, configuration tables and variables, and are
+ * compared on almost every lookup. CEfiGuid is 64-bit aligned, so comparing
+ * and hashing is done on two 64-bit words on all architectures, which compiles
+ * to two loads and a branch-free combination. This is as fast as a vector
+ * compare, without requiring SIMD state.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+/**
+ * c_efi_guid_equal() - Compare two GUIDs
+ * @a:                  first GUID
+ * @b:                  second GUID
+ *
+ * Return: True if @a and @b are equal, false otherwise.
+ */
+static inline CEfiBool c_efi_guid_equal(const CEfiGuid *a, const CEfiGuid *b) {
+        return !((a->u64[0] ^ b->u64[0]) | (a->u64[1] ^ b->u64[1]));
+}
+
+/**
+ * c_efi_guid_hash() - Hash a GUID
+ * @guid:               GUID to hash
+ *
+ * This calculates a hash of @guid suitable for hash tables. GUIDs are mostly
+ * random already, but vendor-assigned ones often share prefixes, so both
+ * words are mixed into all bits of the result. The hash is not stable across
+ * releases.
+ *
+ * Return: The hash value of @guid.
+ */
+static inline CEfiU64 c_efi_guid_hash(const CEfiGuid *guid) {
+        CEfiU64 h;
+
+        h = guid->u64[0] ^ (guid->u64[1] * C_EFI_U64_C(0x9e3779b97f4a7c15));
+        h ^= h >> 32;
+        h *= C_EFI_U64_C(0xd6e8feb86659fd93);
+        h ^= h >> 32;
+        return h;
+}
+
+/**
+ * c_efi_configuration_table_find() - Look up a configuration table
+ * @st:                 system table
+ * @guid:               GUID of the table to find
+ *
+ * Return: Pointer to the vendor table, or NULL if not present.
+ */
+static inline void *c_efi_configuration_table_find(CEfiSystemTable *st, const CEfiGuid *guid) {
+        CEfiUSize i;
+
+        for (i = 0; i < st->number_of_table_entries; ++i)
+                if (c_efi_guid_equal(&st->configuration_table[i].vendor_guid, guid))
+                        return st->configuration_table[i].vendor_table;
+
+        return C_EFI_NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,703 @@
+#pragma once
+
+/**
+ * LZ4 Streaming Decompression
+ *
+ * This decodes LZ4 frames (the format of `lz4`) and legacy frames (`lz4 -l`,
+ * used for Linux kernels and initrds) as compressed input arrives, so a loader
+ * can decompress while the next chunk is still being read. The decoder never
+ * allocates; the caller provides all memory up front:
+ *
+ *  - The window receives the decoded output. It doubles as the history that
+ *    matches refer to. If it is large enough for the entire content, output is
+ *    decoded in place and never moved, so the window can be the final
+ *    destination of a payload. Otherwise, the caller takes decoded data out
+ *    via c_efi_lz4_pending() and c_efi_lz4_release(), and the decoder slides
+ *    the last 64KiB of history to the front of the window once it runs out of
+ *    space. Such ring operation needs a window of at least the block size of
+ *    the frame plus 64KiB.
+ *
+ *  - The staging buffer collects blocks that are split across input chunks.
+ *    Blocks that are complete in the input are decoded directly from it, so
+ *    callers that feed whole blocks can pass no staging buffer at all.
+ *    Otherwise, it must hold the largest compressed block plus its checksum;
+ *    C_EFI_LZ4_STAGING_MAX covers all frames.
+ *
+ * Concatenated frames and skippable frames are supported, dictionaries are
+ * not. Header, block and content checksums are verified unless disabled with
+ * C_EFI_LZ4_FLAG_SKIP_CHECKSUMS, for instance because the payload is verified
+ * by other means.
+ *
+ * The block decoder copies literals and matches in 8 and 16 byte strides.
+ * These strides write past the end of the data, but never past the end of the
+ * window, so the window content behind the decoded data is undefined.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-mem.h>
+#include <c-efi-xxhash.h>
+
+#define C_EFI_LZ4_MAGIC                 C_EFI_U32_C(0x184d2204)
+#define C_EFI_LZ4_MAGIC_LEGACY          C_EFI_U32_C(0x184c2102)
+#define C_EFI_LZ4_MAGIC_SKIPPABLE       C_EFI_U32_C(0x184d2a50)
+#define C_EFI_LZ4_MAGIC_SKIPPABLE_MASK  C_EFI_U32_C(0xfffffff0)
+
+#define C_EFI_LZ4_FLG_VERSION           C_EFI_U8_C(0x40)
+#define C_EFI_LZ4_FLG_VERSION_MASK      C_EFI_U8_C(0xc0)
+#define C_EFI_LZ4_FLG_BLOCK_INDEPENDENT C_EFI_U8_C(0x20)
+#define C_EFI_LZ4_FLG_BLOCK_CHECKSUM    C_EFI_U8_C(0x10)
+#define C_EFI_LZ4_FLG_CONTENT_SIZE      C_EFI_U8_C(0x08)
+#define C_EFI_LZ4_FLG_CONTENT_CHECKSUM  C_EFI_U8_C(0x04)
+#define C_EFI_LZ4_FLG_RESERVED          C_EFI_U8_C(0x02)
+#define C_EFI_LZ4_FLG_DICT_ID           C_EFI_U8_C(0x01)
+
+#define C_EFI_LZ4_BLOCK_UNCOMPRESSED    C_EFI_U32_C(0x80000000)
+
+#define C_EFI_LZ4_HISTORY               (64 * 1024)
+#define C_EFI_LZ4_BLOCK_MAX             (4 * 1024 * 1024)
+#define C_EFI_LZ4_LEGACY_BLOCK_MAX      (8 * 1024 * 1024)
+#define C_EFI_LZ4_LEGACY_COMPRESSED_MAX (C_EFI_LZ4_LEGACY_BLOCK_MAX + C_EFI_LZ4_LEGACY_BLOCK_MAX / 255 + 16)
+#define C_EFI_LZ4_STAGING_MAX           C_EFI_LZ4_LEGACY_COMPRESSED_MAX
+
+#define C_EFI_LZ4_FLAG_SKIP_CHECKSUMS   C_EFI_U32_C(0x00000001)
+
+enum {
+        C_EFI_LZ4_STATE_MAGIC,
+        C_EFI_LZ4_STATE_DESCRIPTOR,
+        C_EFI_LZ4_STATE_BLOCK_HEADER,
+        C_EFI_LZ4_STATE_BLOCK,
+        C_EFI_LZ4_STATE_RAW,
+        C_EFI_LZ4_STATE_RAW_CHECKSUM,
+        C_EFI_LZ4_STATE_CONTENT_CHECKSUM,
+        C_EFI_LZ4_STATE_SKIP_SIZE,
+        C_EFI_LZ4_STATE_SKIP,
+        C_EFI_LZ4_STATE_LEGACY_HEADER,
+        C_EFI_LZ4_STATE_LEGACY_BLOCK,
+};
+
+/**
+ * CEfiLz4: LZ4 Decoder
+ * @flags:              C_EFI_LZ4_FLAG_* as passed to c_efi_lz4_init()
+ * @status:             sticky error, once decoding failed
+ * @window:             caller-provided output window
+ * @n_window:           size of @window in bytes
+ * @pos:                end of the decoded data in @window
+ * @tail:               start of the decoded data not yet released
+ * @base:               start of the data that matches may refer to
+ * @staging:            caller-provided staging buffer for split blocks
+ * @n_staging:          size of @staging in bytes
+ * @n_staged:           number of bytes of the current block in @staging
+ * @state:              C_EFI_LZ4_STATE_* of the parser
+ * @flg:                FLG byte of the current frame
+ * @block_max:          maximum decoded block size of the current frame
+ * @block_size:         size of the current block, including its checksum
+ * @n_header:           number of bytes in @header
+ * @header:             header bytes collected so far
+ * @content_size:       content size declared by the current frame
+ * @n_content:          number of bytes decoded in the current frame
+ * @n_skip:             bytes left to skip in a skippable frame
+ * @content_xxh:        content checksum of the current frame
+ * @block_xxh:          checksum of the current uncompressed block
+ * @n_frames:           number of frames completed
+ * @n_blocks:           number of compressed blocks decoded
+ * @n_direct:           number of them decoded directly from the input
+ * @n_slides:           number of times history was moved to the front
+ * @n_slide_bytes:      number of bytes moved by those slides
+ */
+typedef struct CEfiLz4 {
+        CEfiU32 flags;
+        CEfiStatus status;
+
+        CEfiU8 *window;
+        CEfiUSize n_window;
+        CEfiUSize pos;
+        CEfiUSize tail;
+        CEfiUSize base;
+
+        CEfiU8 *staging;
+        CEfiUSize n_staging;
+        CEfiUSize n_staged;
+
+        CEfiU32 state;
+        CEfiU32 flg;
+        CEfiU32 block_max;
+        CEfiU32 block_size;
+        CEfiU32 n_header;
+        CEfiU8 header[16];
+        CEfiU64 content_size;
+        CEfiU64 n_content;
+        CEfiU64 n_skip;
+        CEfiXxh32 content_xxh;
+        CEfiXxh32 block_xxh;
+
+        CEfiU64 n_frames;
+        CEfiU64 n_blocks;
+        CEfiU64 n_direct;
+        CEfiU64 n_slides;
+        CEfiU64 n_slide_bytes;
+} CEfiLz4;
+
+static inline CEfiU32 c_efi_lz4_le32(const CEfiU8 *p) {
+        return (CEfiU32)p[0] | ((CEfiU32)p[1] << 8) | ((CEfiU32)p[2] << 16) | ((CEfiU32)p[3] << 24);
+}
+
+static inline void c_efi_lz4_copy8(CEfiU8 *d, const CEfiU8 *s) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, s, sizeof(v));
+        __builtin_memcpy(d, &v, sizeof(v));
+}
+
+static inline CEfiBool c_efi_lz4_length(const CEfiU8 **ip, const CEfiU8 *iend, CEfiUSize *lenp) {
+        CEfiU32 b;
+
+        do {
+                if (*ip >= iend)
+                        return 0;
+                b = *(*ip)++;
+                *lenp += b;
+        } while (b == 255);
+
+        return 1;
+}
+
+/**
+ * c_efi_lz4_block() - Decode an LZ4 block
+ * @base:               start of the data that matches may refer to
+ * @dst:                destination, at or after @base
+ * @n_dst:              space available at @dst
+ * @src:                compressed block
+ * @n_src:              size of @src in bytes
+ * @n_outp:             output variable for the decoded size
+ *
+ * This decodes a single block in the LZ4 block format. Matches may refer to
+ * data between @base and @dst, which is how frames with linked blocks refer
+ * to previous blocks. All input is validated, malformed blocks never cause
+ * accesses outside of @src, and outside of @base to @dst + @n_dst.
+ *
+ * Return: C_EFI_SUCCESS if successful, C_EFI_BUFFER_TOO_SMALL if the block
+ *         decodes to more than @n_dst bytes, C_EFI_COMPROMISED_DATA if the
+ *         block is malformed.
+ */
+static inline CEfiStatus c_efi_lz4_block(CEfiU8 *base,
+                                         CEfiU8 *dst,
+                                         CEfiUSize n_dst,
+                                         const void *src,
+                                         CEfiUSize n_src,
+                                         CEfiUSize *n_outp) {
+        static const CEfiU8 stride[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+        const CEfiU8 *ip = src, *iend = ip + n_src, *match;
+        CEfiU8 *op = dst, *oend = dst + n_dst, *e;
+        CEfiUSize lit, len, off, i;
+        CEfiU32 token;
+
+        for (;;) {
+                if (ip >= iend)
+                        return C_EFI_COMPROMISED_DATA;
+
+                token = *ip++;
+                lit = token >> 4;
+                if (lit == 15 && !c_efi_lz4_length(&ip, iend, &lit))
+                        return C_EFI_COMPROMISED_DATA;
+                if (lit > (CEfiUSize)(iend - ip))
+                        return C_EFI_COMPROMISED_DATA;
+                if (lit > (CEfiUSize)(oend - op))
+                        return C_EFI_BUFFER_TOO_SMALL;
+
+                if ((CEfiUSize)(iend - ip) >= lit + 16 && (CEfiUSize)(oend - op) >= lit + 16) {
+                        for (i = 0; i < lit; i += 16) {
+                                c_efi_lz4_copy8(op + i, ip + i);
+                                c_efi_lz4_copy8(op + i + 8, ip + i + 8);
+                        }
+                } else {
+                        c_efi_memcpy(op, ip, lit);
+                }
+                ip += lit;
+                op += lit;
+
+                /* the last sequence has no match */
+                if (ip == iend)
+                        break;
+                if (iend - ip < 2)
+                        return C_EFI_COMPROMISED_DATA;
+
+                off = (CEfiUSize)ip[0] | ((CEfiUSize)ip[1] << 8);
+                ip += 2;
+                if (!off || off > (CEfiUSize)(op - base))
+                        return C_EFI_COMPROMISED_DATA;
+
+                len = token & 15;
+                if (len == 15 && !c_efi_lz4_length(&ip, iend, &len))
+                        return C_EFI_COMPROMISED_DATA;
+                len += 4;
+                if (len > (CEfiUSize)(oend - op))
+                        return C_EFI_BUFFER_TOO_SMALL;
+
+                match = op - off;
+                e = op + len;
+                if ((CEfiUSize)(oend - op) < len + 8) {
+                        for ( ; op < e; ++op, ++match)
+                                *op = *match;
+                        continue;
+                }
+
+                if (off < 8) {
+                        /*
+                         * Replicate the pattern bytewise once, then continue
+                         * at the smallest multiple of its period that allows
+                         * 8 byte strides.
+                         */
+                        for (i = 0; i < 8; ++i)
+                                op[i] = match[i];
+                        match = op + 8 - stride[off];
+                        op += 8;
+                }
+                for ( ; op < e; op += 8, match += 8)
+                        c_efi_lz4_copy8(op, match);
+                op = e;
+        }
+
+        *n_outp = op - dst;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_lz4_init() - Initialize an LZ4 decoder
+ * @dec:                decoder to initialize
+ * @flags:              C_EFI_LZ4_FLAG_* to modify the decoder
+ * @window:             output window
+ * @n_window:           size of @window in bytes
+ * @staging:            staging buffer for split blocks, or NULL
+ * @n_staging:          size of @staging in bytes
+ *
+ * This prepares @dec to decode a stream of LZ4 frames into @window. The
+ * buffers are owned by the caller and must stay valid while @dec is used.
+ * A decoder can be re-initialized at any time to start a new stream.
+ */
+static inline void c_efi_lz4_init(CEfiLz4 *dec,
+                                  CEfiU32 flags,
+                                  void *window,
+                                  CEfiUSize n_window,
+                                  void *staging,
+                                  CEfiUSize n_staging) {
+        *dec = (CEfiLz4){
+                .flags = flags,
+                .window = window,
+                .n_window = n_window,
+                .staging = staging,
+                .n_staging = n_staging,
+        };
+}
+
+/**
+ * c_efi_lz4_pending() - Return decoded data not yet released
+ * @dec:                decoder to query
+ * @datap:              output variable for the decoded data
+ *
+ * Return: The number of bytes at *@datap.
+ */
+static inline CEfiUSize c_efi_lz4_pending(CEfiLz4 *dec, const CEfiU8 **datap) {
+        *datap = dec->window + dec->tail;
+        return dec->pos - dec->tail;
+}
+
+/**
+ * c_efi_lz4_release() - Release decoded data
+ * @dec:                decoder to operate on
+ * @n:                  number of bytes to release
+ *
+ * This marks the first @n bytes returned by c_efi_lz4_pending() as consumed,
+ * so the decoder can reuse their space in the window once they dropped out
+ * of the history.
+ */
+static inline void c_efi_lz4_release(CEfiLz4 *dec, CEfiUSize n) {
+        if (n > dec->pos - dec->tail)
+                n = dec->pos - dec->tail;
+        dec->tail += n;
+}
+
+/**
+ * c_efi_lz4_done() - Check for a frame boundary
+ * @dec:                decoder to query
+ *
+ * Return: True if at least one frame was decoded and the decoder is not in
+ *         the middle of another frame, false otherwise. When the input ends,
+ *         this tells whether it was complete.
+ */
+static inline CEfiBool c_efi_lz4_done(CEfiLz4 *dec) {
+        return !dec->status && dec->n_frames && !dec->n_header &&
+               (dec->state == C_EFI_LZ4_STATE_MAGIC || dec->state == C_EFI_LZ4_STATE_LEGACY_HEADER);
+}
+
+/* move history and unreleased data to the front, if that frees @need bytes */
+static inline void c_efi_lz4_make_room(CEfiLz4 *dec, CEfiUSize need) {
+        CEfiUSize keep, shift;
+
+        if (dec->n_window - dec->pos >= need)
+                return;
+
+        keep = dec->pos - dec->base;
+        if (keep > C_EFI_LZ4_HISTORY)
+                keep = C_EFI_LZ4_HISTORY;
+        shift = dec->pos - keep;
+        if (shift > dec->tail)
+                shift = dec->tail;
+        if (!shift)
+                return;
+
+        c_efi_memmove(dec->window, dec->window + shift, dec->pos - shift);
+        dec->pos -= shift;
+        dec->tail -= shift;
+        dec->base = dec->base > shift ? dec->base - shift : 0;
+        ++dec->n_slides;
+        dec->n_slide_bytes += dec->pos;
+}
+
+/* collect header bytes until @need are available */
+static inline CEfiStatus c_efi_lz4_gather(CEfiLz4 *dec, const CEfiU8 **p, CEfiUSize *n, CEfiU32 need) {
+        while (dec->n_header < need) {
+                if (!*n)
+                        return C_EFI_NOT_READY;
+                dec->header[dec->n_header++] = *(*p)++;
+                --*n;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiBool c_efi_lz4_verify(CEfiLz4 *dec) {
+        return !(dec->flags & C_EFI_LZ4_FLAG_SKIP_CHECKSUMS);
+}
+
+static inline CEfiStatus c_efi_lz4_magic(CEfiLz4 *dec) {
+        CEfiU32 magic = c_efi_lz4_le32(dec->header);
+
+        dec->n_header = 0;
+        if (magic == C_EFI_LZ4_MAGIC) {
+                dec->state = C_EFI_LZ4_STATE_DESCRIPTOR;
+        } else if (magic == C_EFI_LZ4_MAGIC_LEGACY) {
+                /* legacy frames have no end mark, each block completes them */
+                ++dec->n_frames;
+                dec->block_max = C_EFI_LZ4_LEGACY_BLOCK_MAX;
+                dec->state = C_EFI_LZ4_STATE_LEGACY_HEADER;
+        } else if ((magic & C_EFI_LZ4_MAGIC_SKIPPABLE_MASK) == C_EFI_LZ4_MAGIC_SKIPPABLE) {
+                dec->state = C_EFI_LZ4_STATE_SKIP_SIZE;
+        } else {
+                return C_EFI_COMPROMISED_DATA;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_descriptor(CEfiLz4 *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiU32 flg, bd, size;
+        CEfiStatus r;
+
+        r = c_efi_lz4_gather(dec, p, n, 2);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        flg = dec->header[0];
+        bd = dec->header[1];
+        if ((flg & C_EFI_LZ4_FLG_VERSION_MASK) != C_EFI_LZ4_FLG_VERSION ||
+            (flg & C_EFI_LZ4_FLG_RESERVED) || (bd & 0x8f) || (bd >> 4) < 4)
+                return C_EFI_COMPROMISED_DATA;
+        if (flg & C_EFI_LZ4_FLG_DICT_ID)
+                return C_EFI_UNSUPPORTED;
+
+        size = 3 + ((flg & C_EFI_LZ4_FLG_CONTENT_SIZE) ? 8 : 0);
+        r = c_efi_lz4_gather(dec, p, n, size);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (c_efi_lz4_verify(dec) &&
+            ((c_efi_xxh32(0, dec->header, size - 1) >> 8) & 0xff) != dec->header[size - 1])
+                return C_EFI_CRC_ERROR;
+
+        dec->flg = flg;
+        dec->block_max = C_EFI_U32_C(1) << (8 + 2 * (bd >> 4));
+        dec->content_size = 0;
+        if (flg & C_EFI_LZ4_FLG_CONTENT_SIZE)
+                dec->content_size = (CEfiU64)c_efi_lz4_le32(dec->header + 2) |
+                                    ((CEfiU64)c_efi_lz4_le32(dec->header + 6) << 32);
+        dec->n_content = 0;
+        dec->base = dec->pos;
+        c_efi_xxh32_init(&dec->content_xxh, 0);
+
+        dec->n_header = 0;
+        dec->state = C_EFI_LZ4_STATE_BLOCK_HEADER;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_frame_end(CEfiLz4 *dec) {
+        if ((dec->flg & C_EFI_LZ4_FLG_CONTENT_SIZE) && dec->n_content != dec->content_size)
+                return C_EFI_COMPROMISED_DATA;
+
+        ++dec->n_frames;
+        dec->state = C_EFI_LZ4_STATE_MAGIC;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_block_header(CEfiLz4 *dec) {
+        CEfiU32 v = c_efi_lz4_le32(dec->header), size;
+
+        dec->n_header = 0;
+        if (!v) {
+                if (dec->flg & C_EFI_LZ4_FLG_CONTENT_CHECKSUM)
+                        dec->state = C_EFI_LZ4_STATE_CONTENT_CHECKSUM;
+                else
+                        return c_efi_lz4_frame_end(dec);
+                return C_EFI_SUCCESS;
+        }
+
+        size = v & ~C_EFI_LZ4_BLOCK_UNCOMPRESSED;
+        if (size > dec->block_max)
+                return C_EFI_COMPROMISED_DATA;
+
+        if (v & C_EFI_LZ4_BLOCK_UNCOMPRESSED) {
+                dec->block_size = size;
+                c_efi_xxh32_init(&dec->block_xxh, 0);
+                dec->state = C_EFI_LZ4_STATE_RAW;
+        } else {
+                dec->block_size = size + ((dec->flg & C_EFI_LZ4_FLG_BLOCK_CHECKSUM) ? 4 : 0);
+                dec->state = C_EFI_LZ4_STATE_BLOCK;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_legacy_header(CEfiLz4 *dec) {
+        CEfiU32 v = c_efi_lz4_le32(dec->header);
+
+        /* a new frame of any kind may follow a legacy frame */
+        if (v == C_EFI_LZ4_MAGIC || v == C_EFI_LZ4_MAGIC_LEGACY ||
+            (v & C_EFI_LZ4_MAGIC_SKIPPABLE_MASK) == C_EFI_LZ4_MAGIC_SKIPPABLE)
+                return c_efi_lz4_magic(dec);
+
+        dec->n_header = 0;
+        if (!v || v > C_EFI_LZ4_LEGACY_COMPRESSED_MAX)
+                return C_EFI_COMPROMISED_DATA;
+
+        dec->block_size = v;
+        dec->state = C_EFI_LZ4_STATE_LEGACY_BLOCK;
+        return C_EFI_SUCCESS;
+}
+
+/* decode a complete block, leaving it for a retry if the window is full */
+static inline CEfiStatus c_efi_lz4_frame_block(CEfiLz4 *dec, const CEfiU8 *src) {
+        CEfiBool legacy = dec->state == C_EFI_LZ4_STATE_LEGACY_BLOCK;
+        CEfiUSize n_src = dec->block_size, limit, n_out;
+        CEfiStatus r;
+
+        if (!legacy && (dec->flg & C_EFI_LZ4_FLG_BLOCK_CHECKSUM)) {
+                n_src -= 4;
+                if (c_efi_lz4_verify(dec) && c_efi_xxh32(0, src, n_src) != c_efi_lz4_le32(src + n_src))
+                        return C_EFI_CRC_ERROR;
+        }
+
+        if (legacy || (dec->flg & C_EFI_LZ4_FLG_BLOCK_INDEPENDENT))
+                dec->base = dec->pos;
+
+        c_efi_lz4_make_room(dec, dec->block_max);
+        limit = dec->n_window - dec->pos;
+        if (limit > dec->block_max)
+                limit = dec->block_max;
+
+        r = c_efi_lz4_block(dec->window + dec->base, dec->window + dec->pos, limit, src, n_src, &n_out);
+        if (r == C_EFI_BUFFER_TOO_SMALL && limit == dec->block_max)
+                r = C_EFI_COMPROMISED_DATA;
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (!legacy && (dec->flg & C_EFI_LZ4_FLG_CONTENT_CHECKSUM) && c_efi_lz4_verify(dec))
+                c_efi_xxh32_update(&dec->content_xxh, dec->window + dec->pos, n_out);
+        dec->pos += n_out;
+        dec->n_content += n_out;
+        ++dec->n_blocks;
+        dec->state = legacy ? C_EFI_LZ4_STATE_LEGACY_HEADER : C_EFI_LZ4_STATE_BLOCK_HEADER;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_block_data(CEfiLz4 *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiUSize k;
+        CEfiStatus r;
+
+        if (!dec->n_staged && *n >= dec->block_size) {
+                r = c_efi_lz4_frame_block(dec, *p);
+                if (C_EFI_ERROR(r))
+                        return r;
+                *p += dec->block_size;
+                *n -= dec->block_size;
+                ++dec->n_direct;
+                return C_EFI_SUCCESS;
+        }
+
+        if (dec->block_size > dec->n_staging)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        k = dec->block_size - dec->n_staged;
+        if (k > *n)
+                k = *n;
+        c_efi_memcpy(dec->staging + dec->n_staged, *p, k);
+        dec->n_staged += k;
+        *p += k;
+        *n -= k;
+        if (dec->n_staged < dec->block_size)
+                return C_EFI_NOT_READY;
+
+        r = c_efi_lz4_frame_block(dec, dec->staging);
+        if (C_EFI_ERROR(r))
+                return r;
+        dec->n_staged = 0;
+        return C_EFI_SUCCESS;
+}
+
+/* uncompressed blocks are streamed into the window as they arrive */
+static inline CEfiStatus c_efi_lz4_raw(CEfiLz4 *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiUSize k;
+
+        if (!dec->block_size) {
+                dec->state = (dec->flg & C_EFI_LZ4_FLG_BLOCK_CHECKSUM) ?
+                             C_EFI_LZ4_STATE_RAW_CHECKSUM : C_EFI_LZ4_STATE_BLOCK_HEADER;
+                return C_EFI_SUCCESS;
+        }
+        if (!*n)
+                return C_EFI_NOT_READY;
+
+        if (dec->flg & C_EFI_LZ4_FLG_BLOCK_INDEPENDENT)
+                dec->base = dec->pos;
+        c_efi_lz4_make_room(dec, dec->block_size);
+
+        k = dec->n_window - dec->pos;
+        if (!k)
+                return C_EFI_BUFFER_TOO_SMALL;
+        if (k > dec->block_size)
+                k = dec->block_size;
+        if (k > *n)
+                k = *n;
+
+        c_efi_memcpy(dec->window + dec->pos, *p, k);
+        if (c_efi_lz4_verify(dec)) {
+                if (dec->flg & C_EFI_LZ4_FLG_BLOCK_CHECKSUM)
+                        c_efi_xxh32_update(&dec->block_xxh, *p, k);
+                if (dec->flg & C_EFI_LZ4_FLG_CONTENT_CHECKSUM)
+                        c_efi_xxh32_update(&dec->content_xxh, *p, k);
+        }
+        dec->pos += k;
+        dec->n_content += k;
+        dec->block_size -= k;
+        *p += k;
+        *n -= k;
+
+        /* keep the window base at the block start for independent blocks */
+        if (dec->flg & C_EFI_LZ4_FLG_BLOCK_INDEPENDENT)
+                dec->base = dec->pos;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_lz4_step(CEfiLz4 *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiUSize k;
+        CEfiStatus r;
+
+        switch (dec->state) {
+        case C_EFI_LZ4_STATE_MAGIC:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                return C_EFI_ERROR(r) ? r : c_efi_lz4_magic(dec);
+        case C_EFI_LZ4_STATE_DESCRIPTOR:
+                return c_efi_lz4_descriptor(dec, p, n);
+        case C_EFI_LZ4_STATE_BLOCK_HEADER:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                return C_EFI_ERROR(r) ? r : c_efi_lz4_block_header(dec);
+        case C_EFI_LZ4_STATE_BLOCK:
+        case C_EFI_LZ4_STATE_LEGACY_BLOCK:
+                return c_efi_lz4_block_data(dec, p, n);
+        case C_EFI_LZ4_STATE_RAW:
+                return c_efi_lz4_raw(dec, p, n);
+        case C_EFI_LZ4_STATE_RAW_CHECKSUM:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                if (C_EFI_ERROR(r))
+                        return r;
+                dec->n_header = 0;
+                if (c_efi_lz4_verify(dec) && c_efi_xxh32_final(&dec->block_xxh) != c_efi_lz4_le32(dec->header))
+                        return C_EFI_CRC_ERROR;
+                dec->state = C_EFI_LZ4_STATE_BLOCK_HEADER;
+                return C_EFI_SUCCESS;
+        case C_EFI_LZ4_STATE_CONTENT_CHECKSUM:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                if (C_EFI_ERROR(r))
+                        return r;
+                dec->n_header = 0;
+                if (c_efi_lz4_verify(dec) && c_efi_xxh32_final(&dec->content_xxh) != c_efi_lz4_le32(dec->header))
+                        return C_EFI_CRC_ERROR;
+                return c_efi_lz4_frame_end(dec);
+        case C_EFI_LZ4_STATE_SKIP_SIZE:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                if (C_EFI_ERROR(r))
+                        return r;
+                dec->n_header = 0;
+                dec->n_skip = c_efi_lz4_le32(dec->header);
+                dec->state = C_EFI_LZ4_STATE_SKIP;
+                return C_EFI_SUCCESS;
+        case C_EFI_LZ4_STATE_SKIP:
+                k = *n < dec->n_skip ? *n : dec->n_skip;
+                *p += k;
+                *n -= k;
+                dec->n_skip -= k;
+                if (dec->n_skip)
+                        return C_EFI_NOT_READY;
+                ++dec->n_frames;
+                dec->state = C_EFI_LZ4_STATE_MAGIC;
+                return C_EFI_SUCCESS;
+        case C_EFI_LZ4_STATE_LEGACY_HEADER:
+                r = c_efi_lz4_gather(dec, p, n, 4);
+                return C_EFI_ERROR(r) ? r : c_efi_lz4_legacy_header(dec);
+        }
+
+        return C_EFI_COMPROMISED_DATA;
+}
+
+/**
+ * c_efi_lz4_decode() - Decode more input
+ * @dec:                decoder to operate on
+ * @in:                 next chunk of the compressed stream
+ * @n_in:               size of @in in bytes
+ * @n_consumedp:        output variable for the number of bytes consumed
+ *
+ * This decodes as much of @in as possible into the window. Input can be
+ * split at arbitrary boundaries. If the window is full, this stops early and
+ * the caller has to release output, then pass the rest of the input again.
+ *
+ * Return: C_EFI_SUCCESS if all input was consumed,
+ *         C_EFI_BUFFER_TOO_SMALL if the window is full. If nothing is
+ *         pending, the window is too small for the stream,
+ *         C_EFI_OUT_OF_RESOURCES if a split block exceeds the staging buffer,
+ *         C_EFI_UNSUPPORTED if a frame needs a dictionary,
+ *         C_EFI_CRC_ERROR if a checksum does not match,
+ *         C_EFI_COMPROMISED_DATA if the stream is malformed.
+ *         Errors other than C_EFI_BUFFER_TOO_SMALL are permanent.
+ */
+static inline CEfiStatus c_efi_lz4_decode(CEfiLz4 *dec, const void *in, CEfiUSize n_in, CEfiUSize *n_consumedp) {
+        const CEfiU8 *p = in;
+        CEfiUSize n = n_in;
+        CEfiStatus r;
+
+        r = dec->status;
+        while (!r)
+                r = c_efi_lz4_step(dec, &p, &n);
+
+        if (r == C_EFI_NOT_READY)
+                r = C_EFI_SUCCESS;
+        else if (r != C_EFI_BUFFER_TOO_SMALL)
+                dec->status = r;
+
+        *n_consumedp = p - (const CEfiU8 *)in;
+        return r;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,273 @@
+#pragma once
+
+/**
+ * Memory Attributes Table Parser
+ *
+ * The UEFI Memory Attributes Table (see CEfiMemoryAttributesTable) lists the
+ * runtime regions with their final access permissions (read-only,
+ * execute-protect). Operating systems need to merge it with the memory map
+ * to know how to map runtime services.
+ *
+ * This header provides a compact range type, helpers to turn descriptor
+ * arrays of arbitrary stride into sorted range indices, and a merge operation
+ * that combines a memory map index with a memory attributes index in a single
+ * linear sweep. No allocations are performed; all output buffers are provided
+ * by the caller.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+/**
+ * C_EFI_MEMATTR_PERMISSION_MASK: Permission attributes
+ *
+ * These are the attribute bits that the memory attributes table overrides in
+ * the memory map. All other attribute bits are taken from the memory map.
+ */
+#define C_EFI_MEMATTR_PERMISSION_MASK (C_EFI_MEMORY_RP | C_EFI_MEMORY_XP | C_EFI_MEMORY_RO)
+
+/**
+ * CEfiMemoryRange: Memory Range
+ * @start:              physical start address (inclusive)
+ * @end:                physical end address (exclusive)
+ * @attribute:          C_EFI_MEMORY_* attribute bits
+ * @type:               memory type, see CEfiMemoryType
+ *
+ * This is a compact representation of a memory descriptor, used as entry of
+ * sorted range indices. Ranges of an index never overlap.
+ */
+typedef struct CEfiMemoryRange {
+        CEfiPhysicalAddress start;
+        CEfiPhysicalAddress end;
+        CEfiU64 attribute;
+        CEfiU32 type;
+} CEfiMemoryRange;
+
+/**
+ * c_efi_memory_ranges_index() - Build sorted range index from descriptors
+ * @descriptors:        array of memory descriptors
+ * @n_descriptors:      number of descriptors in @descriptors
+ * @descriptor_size:    stride of @descriptors in bytes
+ * @ranges:             output array, must have room for @n_descriptors
+ * @n_rangesp:          output argument for the number of produced ranges
+ *
+ * This converts an array of memory descriptors with the given stride into a
+ * range index sorted by start address. Firmware usually provides sorted
+ * arrays, in which case this is a linear pass. Unsorted input is sorted via
+ * insertion sort. Empty descriptors are skipped.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if
+ *         @descriptor_size is not a multiple of 8 or too small,
+ *         C_EFI_VOLUME_CORRUPTED if descriptors overflow the address space or
+ *         overlap each other.
+ */
+static inline CEfiStatus c_efi_memory_ranges_index(const void *descriptors,
+                                                   CEfiUSize n_descriptors,
+                                                   CEfiUSize descriptor_size,
+                                                   CEfiMemoryRange *ranges,
+                                                   CEfiUSize *n_rangesp) {
+        const CEfiMemoryDescriptor *d;
+        CEfiMemoryRange r;
+        CEfiUSize i, j, n = 0;
+
+        if (descriptor_size < sizeof(CEfiMemoryDescriptor) || (descriptor_size & 7))
+                return C_EFI_INVALID_PARAMETER;
+
+        for (i = 0; i < n_descriptors; ++i) {
+                d = (const void *)((const CEfiU8 *)descriptors + i * descriptor_size);
+                if (!d->number_of_pages)
+                        continue;
+                if (d->number_of_pages > (C_EFI_U64_C(0xffffffffffffffff) >> 12) ||
+                    d->physical_start > C_EFI_U64_C(0xffffffffffffffff) - (d->number_of_pages << 12))
+                        return C_EFI_VOLUME_CORRUPTED;
+
+                r.start = d->physical_start;
+                r.end = d->physical_start + (d->number_of_pages << 12);
+                r.attribute = d->attribute;
+                r.type = d->type;
+
+                for (j = n; j > 0 && ranges[j - 1].start > r.start; --j)
+                        ranges[j] = ranges[j - 1];
+                ranges[j] = r;
+                ++n;
+        }
+
+        for (i = 1; i < n; ++i)
+                if (ranges[i - 1].end > ranges[i].start)
+                        return C_EFI_VOLUME_CORRUPTED;
+
+        *n_rangesp = n;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_memory_ranges_find() - Find range containing an address
+ * @ranges:             sorted range index
+ * @n_ranges:           number of entries in @ranges
+ * @address:            address to look up
+ *
+ * Return: Pointer to the range containing @address, or NULL if none does.
+ */
+static inline const CEfiMemoryRange *c_efi_memory_ranges_find(const CEfiMemoryRange *ranges,
+                                                              CEfiUSize n_ranges,
+                                                              CEfiPhysicalAddress address) {
+        CEfiUSize lo = 0, hi = n_ranges, mid;
+
+        while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if (address < ranges[mid].start)
+                        hi = mid;
+                else if (address >= ranges[mid].end)
+                        lo = mid + 1;
+                else
+                        return &ranges[mid];
+        }
+
+        return C_EFI_NULL;
+}
+
+/**
+ * c_efi_memattr_index() - Parse memory attributes table
+ * @table:              memory attributes table
+ * @table_size:         size of @table in bytes, or 0 if unknown
+ * @ranges:             output array, must have room for all table entries
+ * @n_ranges_max:       number of entries @ranges has room for
+ * @n_rangesp:          output argument for the number of produced ranges
+ *
+ * This validates the header of a memory attributes table and builds a
+ * sorted range index of its entries. Table versions 1 and 2 share the same
+ * layout and are accepted. If @table_size is non-zero, the entries must fit
+ * into it.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INCOMPATIBLE_VERSION on unknown
+ *         table versions, C_EFI_BUFFER_TOO_SMALL if @ranges is too small,
+ *         C_EFI_VOLUME_CORRUPTED if the table is malformed.
+ */
+static inline CEfiStatus c_efi_memattr_index(const CEfiMemoryAttributesTable *table,
+                                             CEfiUSize table_size,
+                                             CEfiMemoryRange *ranges,
+                                             CEfiUSize n_ranges_max,
+                                             CEfiUSize *n_rangesp) {
+        CEfiStatus r;
+
+        if (table->version < C_EFI_MEMORY_ATTRIBUTES_TABLE_VERSION || table->version > 2)
+                return C_EFI_INCOMPATIBLE_VERSION;
+        if (table->descriptor_size < sizeof(CEfiMemoryDescriptor) || (table->descriptor_size & 7))
+                return C_EFI_VOLUME_CORRUPTED;
+        if (table_size &&
+            (table_size < sizeof(*table) ||
+             (table_size - sizeof(*table)) / table->descriptor_size < table->number_of_entries))
+                return C_EFI_VOLUME_CORRUPTED;
+        if (n_ranges_max < table->number_of_entries)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        r = c_efi_memory_ranges_index(table->entry,
+                                      table->number_of_entries,
+                                      table->descriptor_size,
+                                      ranges,
+                                      n_rangesp);
+        if (r == C_EFI_INVALID_PARAMETER)
+                r = C_EFI_VOLUME_CORRUPTED;
+        return r;
+}
+
+static inline CEfiBool c_efi_memattr_emit(CEfiMemoryRange *out,
+                                          CEfiUSize n_out_max,
+                                          CEfiUSize *n_outp,
+                                          CEfiPhysicalAddress start,
+                                          CEfiPhysicalAddress end,
+                                          CEfiU64 attribute,
+                                          CEfiU32 type) {
+        CEfiMemoryRange *last = *n_outp ? &out[*n_outp - 1] : C_EFI_NULL;
+
+        if (last && last->end == start && last->attribute == attribute && last->type == type) {
+                last->end = end;
+                return C_EFI_TRUE;
+        }
+
+        if (*n_outp >= n_out_max)
+                return C_EFI_FALSE;
+
+        out[(*n_outp)++] = (CEfiMemoryRange){
+                .start = start,
+                .end = end,
+                .attribute = attribute,
+                .type = type,
+        };
+        return C_EFI_TRUE;
+}
+
+/**
+ * c_efi_memattr_merge() - Merge memory map with memory attributes
+ * @map:                sorted range index of the memory map
+ * @n_map:              number of entries in @map
+ * @attrs:              sorted range index of the memory attributes table
+ * @n_attrs:            number of entries in @attrs
+ * @out:                output array
+ * @n_out_max:          number of entries @out has room for
+ * @n_outp:             output argument for the number of produced ranges
+ *
+ * This merges the memory map index @map with the attributes index @attrs in a
+ * single linear sweep over both. Every memory map range is split along the
+ * boundaries of the attribute ranges it overlaps. Where an attribute range
+ * applies, the permission bits (see C_EFI_MEMATTR_PERMISSION_MASK) are taken
+ * from it, otherwise the memory map attributes are kept. Adjacent output
+ * ranges with identical type and attributes are coalesced. Attribute ranges
+ * not covered by the memory map are ignored.
+ *
+ * @out never needs more than `n_map + 2 * n_attrs` entries.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @out is too
+ *         small.
+ */
+static inline CEfiStatus c_efi_memattr_merge(const CEfiMemoryRange *map,
+                                             CEfiUSize n_map,
+                                             const CEfiMemoryRange *attrs,
+                                             CEfiUSize n_attrs,
+                                             CEfiMemoryRange *out,
+                                             CEfiUSize n_out_max,
+                                             CEfiUSize *n_outp) {
+        CEfiPhysicalAddress pos, end;
+        CEfiUSize i, j = 0;
+        CEfiU64 attribute;
+        CEfiBool ok;
+
+        *n_outp = 0;
+
+        for (i = 0; i < n_map; ++i) {
+                pos = map[i].start;
+
+                while (pos < map[i].end) {
+                        while (j < n_attrs && attrs[j].end <= pos)
+                                ++j;
+
+                        if (j >= n_attrs || attrs[j].start >= map[i].end) {
+                                end = map[i].end;
+                                attribute = map[i].attribute;
+                        } else if (attrs[j].start > pos) {
+                                end = attrs[j].start;
+                                attribute = map[i].attribute;
+                        } else {
+                                end = attrs[j].end < map[i].end ? attrs[j].end : map[i].end;
+                                attribute = (map[i].attribute & ~C_EFI_MEMATTR_PERMISSION_MASK) |
+                                            (attrs[j].attribute & C_EFI_MEMATTR_PERMISSION_MASK);
+                        }
+
+                        ok = c_efi_memattr_emit(out, n_out_max, n_outp, pos, end, attribute, map[i].type);
+                        if (!ok)
+                                return C_EFI_BUFFER_TOO_SMALL;
+
+                        pos = end;
+                }
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,566 @@
+#pragma once
+
+/**
+ * Parallel Work Dispatcher
+ *
+ * UEFI applications run on the bootstrap processor (BSP), while all
+ * application processors (APs) sit idle until the operating system starts
+ * them. This header runs data-parallel jobs on the APs as well, via the MP
+ * Services Protocol:
+ *
+ *  - A job consists of `n_items` independent items, like bytes to zero,
+ *    chunks to hash or blocks to decompress. They are grouped into chunks of
+ *    consecutive items, and the callback of the job is run with one chunk at
+ *    a time.
+ *
+ *  - Every worker owns a range of chunks, initially an equal share. Workers
+ *    take chunks from the front of their own range. Once it is empty, they
+ *    steal the back half of the range of another worker. Each range is
+ *    packed into a single 64-bit word, so taking and stealing are a single
+ *    compare-and-swap, without locks.
+ *
+ *  - The BSP is worker 0 and takes part in every job. If the dispatcher
+ *    uses all enabled APs, they are started with a single `startup_all_aps`
+ *    call, otherwise each one with `startup_this_ap`. Both are non-blocking,
+ *    the BSP waits for the APs only after it ran out of work itself.
+ *
+ *  - If APs cannot be started, for instance because non-blocking calls are
+ *    rejected after ready-to-boot, or the APs are busy, the BSP steals their
+ *    share and the job completes on fewer processors.
+ *
+ * Callbacks run on APs must not call any UEFI service, and must not use
+ * CPU features the firmware might not have enabled on the APs. Helpers are
+ * provided to zero memory, hash chunks with SHA-256 and decompress
+ * independent LZ4 blocks.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-lz4.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-mp-services.h>
+#include <c-efi-sha2.h>
+#include <c-efi-sync.h>
+
+#define C_EFI_MP_CHUNKS_PER_WORKER 8
+#define C_EFI_MP_MEMSET_CHUNK (256 * 1024)
+
+typedef struct CEfiMp CEfiMp;
+
+/**
+ * CEfiMpWorkFn: Job Callback
+ * @userdata:           context of the job
+ * @begin:              index of the first item of the chunk
+ * @end:                index after the last item of the chunk
+ * @worker:             index of the calling worker, 0 for the BSP
+ *
+ * This is called with each chunk of a job exactly once, possibly on
+ * different processors at the same time. @worker is below the number of
+ * workers of the dispatcher, and can index per-worker scratch space.
+ *
+ * Return: C_EFI_SUCCESS on success, or an error, which makes all workers
+ *         stop taking new chunks.
+ */
+typedef CEfiStatus (*CEfiMpWorkFn)(void *userdata, CEfiUSize begin, CEfiUSize end, CEfiUSize worker);
+
+/**
+ * CEfiMpWorker: Worker of the Dispatcher
+ * @range:              remaining chunks, the first in the low and the end in
+ *                      the high 32 bits
+ * @processor:          processor number of the AP, unused for the BSP
+ * @event:              event signaled by `startup_this_ap`, or NULL
+ * @started:            whether the AP was started for the current job
+ * @n_chunks:           number of chunks run
+ * @n_steals:           number of successful steals
+ *
+ * Each worker occupies its own cache line, so workers taking chunks do not
+ * contend with each other.
+ */
+typedef struct CEfiMpWorker {
+        _Alignas(64) CEfiU64 range;
+        CEfiUSize processor;
+        CEfiEvent event;
+        CEfiBool started;
+        CEfiU64 n_chunks;
+        CEfiU64 n_steals;
+} CEfiMpWorker;
+
+/**
+ * CEfiMp: Parallel Work Dispatcher
+ * @bs:                 boot services
+ * @services:           MP services, or NULL to run on the BSP only
+ * @workers:            workers, the BSP first
+ * @n_workers:          number of workers
+ * @n_aps:              number of enabled APs in the system
+ * @done:               event signaled by `startup_all_aps`
+ * @fn:                 callback of the current job
+ * @userdata:           context of the current job
+ * @n_items:            number of items of the current job
+ * @chunk_size:         number of items per chunk of the current job
+ * @n_active:           number of workers of the current job
+ * @next_worker:        index of the next AP to join the current job
+ * @n_running:          number of APs started for the current job, which
+ *                      did not return yet
+ * @status:             result of the current job
+ * @n_jobs:             number of jobs run
+ * @n_fallbacks:        number of jobs some APs could not be started for
+ */
+struct CEfiMp {
+        CEfiBootServices *bs;
+        CEfiMpServicesProtocol *services;
+        CEfiMpWorker *workers;
+        CEfiUSize n_workers;
+        CEfiUSize n_aps;
+        CEfiEvent done;
+        CEfiMpWorkFn fn;
+        void *userdata;
+        CEfiUSize n_items;
+        CEfiUSize chunk_size;
+        CEfiUSize n_active;
+        CEfiUSize next_worker;
+        CEfiUSize n_running;
+        CEfiStatus status;
+        CEfiU64 n_jobs;
+        CEfiU64 n_fallbacks;
+};
+
+/**
+ * c_efi_mp_deinit() - Deinitialize dispatcher
+ * @mp:                 dispatcher to deinitialize
+ *
+ * This closes all events of the dispatcher. It must not be called while a
+ * job runs.
+ */
+static inline void c_efi_mp_deinit(CEfiMp *mp) {
+        CEfiUSize i;
+
+        for (i = 1; i < mp->n_workers; ++i)
+                if (mp->workers[i].event)
+                        mp->bs->close_event(mp->workers[i].event);
+        if (mp->done)
+                mp->bs->close_event(mp->done);
+
+        mp->n_workers = 1;
+        mp->done = C_EFI_NULL;
+}
+
+/**
+ * c_efi_mp_init() - Initialize dispatcher
+ * @mp:                 dispatcher to initialize
+ * @bs:                 boot services
+ * @services:           MP services, or NULL to run on the BSP only
+ * @workers:            storage for the workers
+ * @n_workers:          number of entries in @workers
+ *
+ * This enumerates the enabled APs, and assigns up to @n_workers - 1 of
+ * them to the dispatcher. It must be called on the BSP.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_workers
+ *         is 0, or the error of the MP services or `create_event`.
+ */
+static inline CEfiStatus c_efi_mp_init(CEfiMp *mp,
+                                       CEfiBootServices *bs,
+                                       CEfiMpServicesProtocol *services,
+                                       CEfiMpWorker *workers,
+                                       CEfiUSize n_workers) {
+        CEfiProcessorInformation info;
+        CEfiUSize i, n, n_enabled;
+        CEfiStatus r;
+
+        *mp = (CEfiMp){ .bs = bs, .services = services, .workers = workers };
+
+        if (!n_workers)
+                return C_EFI_INVALID_PARAMETER;
+
+        workers[0] = (CEfiMpWorker){ 0 };
+        mp->n_workers = 1;
+        if (!services)
+                return C_EFI_SUCCESS;
+
+        r = services->get_number_of_processors(services, &n, &n_enabled);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        mp->n_aps = n_enabled ? n_enabled - 1 : 0;
+        for (i = 0; i < n && mp->n_workers < n_workers; ++i) {
+                r = services->get_processor_info(services, i, &info);
+                if (C_EFI_ERROR(r))
+                        goto error;
+                if ((info.status_flag & C_EFI_PROCESSOR_AS_BSP_BIT) ||
+                    !(info.status_flag & C_EFI_PROCESSOR_ENABLED_BIT))
+                        continue;
+
+                workers[mp->n_workers] = (CEfiMpWorker){ .processor = i };
+                r = bs->create_event(0, 0, C_EFI_NULL, C_EFI_NULL, &workers[mp->n_workers].event);
+                if (C_EFI_ERROR(r))
+                        goto error;
+                ++mp->n_workers;
+        }
+
+        if (mp->n_workers > 1) {
+                r = bs->create_event(0, 0, C_EFI_NULL, C_EFI_NULL, &mp->done);
+                if (C_EFI_ERROR(r))
+                        goto error;
+        }
+
+        return C_EFI_SUCCESS;
+
+error:
+        c_efi_mp_deinit(mp);
+        return r;
+}
+
+/* take the first chunk of a range */
+static inline CEfiBool c_efi_mp_pop(CEfiMpWorker *w, CEfiU32 *chunkp) {
+        CEfiU64 v, n;
+        CEfiU32 lo, hi;
+
+        v = __atomic_load_n(&w->range, __ATOMIC_ACQUIRE);
+        do {
+                lo = (CEfiU32)v;
+                hi = (CEfiU32)(v >> 32);
+                if (lo >= hi)
+                        return 0;
+                n = ((CEfiU64)hi << 32) | (lo + 1);
+        } while (!__atomic_compare_exchange_n(&w->range, &v, n, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        *chunkp = lo;
+        return 1;
+}
+
+/* take the back half of a range, rounded up */
+static inline CEfiBool c_efi_mp_steal(CEfiMpWorker *victim, CEfiU32 *lop, CEfiU32 *hip) {
+        CEfiU64 v, n;
+        CEfiU32 lo, hi, mid;
+
+        v = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+        do {
+                lo = (CEfiU32)v;
+                hi = (CEfiU32)(v >> 32);
+                if (lo >= hi)
+                        return 0;
+                mid = lo + (hi - lo) / 2;
+                n = ((CEfiU64)mid << 32) | lo;
+        } while (!__atomic_compare_exchange_n(&victim->range, &v, n, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        *lop = mid;
+        *hip = hi;
+        return 1;
+}
+
+/* run chunks until none are left, or the job failed */
+static inline void c_efi_mp_work(CEfiMp *mp, CEfiUSize index) {
+        CEfiMpWorker *w = &mp->workers[index];
+        CEfiUSize i, begin, end;
+        CEfiStatus r, expected;
+        CEfiU32 chunk, lo, hi;
+
+        for (;;) {
+                while (c_efi_mp_pop(w, &chunk)) {
+                        if (__atomic_load_n(&mp->status, __ATOMIC_RELAXED) != C_EFI_SUCCESS)
+                                return;
+
+                        begin = (CEfiUSize)chunk * mp->chunk_size;
+                        end = begin + mp->chunk_size;
+                        if (end > mp->n_items)
+                                end = mp->n_items;
+
+                        ++w->n_chunks;
+                        r = mp->fn(mp->userdata, begin, end, index);
+                        if (C_EFI_ERROR(r)) {
+                                expected = C_EFI_SUCCESS;
+                                __atomic_compare_exchange_n(&mp->status, &expected, r, 0,
+                                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+                                return;
+                        }
+                }
+
+                /*
+                 * Ranges only ever shrink, or move to a thief, so once every
+                 * other range is seen empty, all remaining chunks are taken.
+                 */
+                for (i = 1; i < mp->n_active; ++i)
+                        if (c_efi_mp_steal(&mp->workers[(index + i) % mp->n_active], &lo, &hi))
+                                break;
+                if (i >= mp->n_active)
+                        return;
+
+                ++w->n_steals;
+                __atomic_store_n(&w->range, ((CEfiU64)hi << 32) | lo, __ATOMIC_RELEASE);
+        }
+}
+
+static inline void CEFICALL c_efi_mp_ap(void *context) {
+        CEfiMp *mp = context;
+        CEfiUSize index;
+
+        /* APs join in any order, and APs beyond the job just return */
+        index = __atomic_fetch_add(&mp->next_worker, 1, __ATOMIC_RELAXED);
+        if (index < mp->n_active)
+                c_efi_mp_work(mp, index);
+
+        /* this is the last access to @mp, the BSP may return right after */
+        __atomic_fetch_sub(&mp->n_running, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * c_efi_mp_run() - Run a job on all workers
+ * @mp:                 dispatcher to run the job on
+ * @fn:                 callback to run with each chunk
+ * @userdata:           context of @fn
+ * @n_items:            number of items of the job
+ * @chunk_size:         number of items per chunk, or 0 for the default
+ *
+ * This splits the items into chunks, starts the APs of the dispatcher and
+ * runs chunks on the BSP as well, until all chunks are done. The default
+ * chunk size gives every worker C_EFI_MP_CHUNKS_PER_WORKER chunks, so they
+ * can balance uneven chunks by stealing. It must be called on the BSP.
+ *
+ * This never returns while an AP might still run @fn, not even if waiting
+ * for the events of the APs fails. The BSP spins until every AP it started
+ * returned then, so @userdata may live on the stack of the caller.
+ *
+ * Return: C_EFI_SUCCESS on success, the first error of @fn, or the error of
+ *         `wait_for_event`.
+ */
+static inline CEfiStatus c_efi_mp_run(CEfiMp *mp, CEfiMpWorkFn fn, void *userdata, CEfiUSize n_items, CEfiUSize chunk_size) {
+        CEfiMpServicesProtocol *services = mp->services;
+        CEfiBool all = 0, fallback = 0;
+        CEfiUSize i, index;
+        CEfiU64 n_chunks;
+        CEfiStatus r, r_wait = C_EFI_SUCCESS;
+
+        if (!n_items)
+                return C_EFI_SUCCESS;
+
+        if (!chunk_size)
+                chunk_size = (n_items + mp->n_workers * C_EFI_MP_CHUNKS_PER_WORKER - 1) /
+                             (mp->n_workers * C_EFI_MP_CHUNKS_PER_WORKER);
+        n_chunks = ((CEfiU64)n_items + chunk_size - 1) / chunk_size;
+        if (n_chunks > C_EFI_U32_C(0xffffffff)) {
+                chunk_size = (CEfiUSize)(((CEfiU64)n_items + C_EFI_U32_C(0xfffffffe)) / C_EFI_U32_C(0xffffffff));
+                n_chunks = ((CEfiU64)n_items + chunk_size - 1) / chunk_size;
+        }
+
+        mp->fn = fn;
+        mp->userdata = userdata;
+        mp->n_items = n_items;
+        mp->chunk_size = chunk_size;
+        mp->n_active = n_chunks < mp->n_workers ? (CEfiUSize)n_chunks : mp->n_workers;
+        mp->next_worker = 1;
+        mp->n_running = 0;
+        mp->status = C_EFI_SUCCESS;
+        ++mp->n_jobs;
+
+        for (i = 0; i < mp->n_active; ++i) {
+                mp->workers[i].started = 0;
+                mp->workers[i].range = ((n_chunks * (i + 1) / mp->n_active) << 32) |
+                                       (n_chunks * i / mp->n_active);
+        }
+
+        if (mp->n_active > 1) {
+                if (mp->n_workers - 1 >= mp->n_aps) {
+                        /* every enabled AP runs c_efi_mp_ap(), even beyond the job */
+                        mp->n_running = mp->n_aps;
+                        r = services->startup_all_aps(services, c_efi_mp_ap, 0, mp->done, 0, mp, C_EFI_NULL);
+                        if (r == C_EFI_UNSUPPORTED) {
+                                /* non-blocking calls are gone after ready-to-boot */
+                                r = services->startup_all_aps(services, c_efi_mp_ap, 0, C_EFI_NULL, 0, mp, C_EFI_NULL);
+                                if (C_EFI_ERROR(r))
+                                        mp->n_running = 0;
+                                fallback = 1;
+                        } else if (C_EFI_ERROR(r)) {
+                                mp->n_running = 0;
+                                fallback = 1;
+                        } else {
+                                all = 1;
+                        }
+                } else {
+                        for (i = 1; i < mp->n_active; ++i) {
+                                __atomic_fetch_add(&mp->n_running, 1, __ATOMIC_RELAXED);
+                                r = services->startup_this_ap(services,
+                                                              c_efi_mp_ap,
+                                                              mp->workers[i].processor,
+                                                              mp->workers[i].event,
+                                                              0,
+                                                              mp,
+                                                              C_EFI_NULL);
+                                if (C_EFI_ERROR(r)) {
+                                        __atomic_fetch_sub(&mp->n_running, 1, __ATOMIC_RELAXED);
+                                        fallback = 1;
+                                } else {
+                                        mp->workers[i].started = 1;
+                                }
+                        }
+                }
+        }
+
+        c_efi_mp_work(mp, 0);
+
+        if (all)
+                r_wait = mp->bs->wait_for_event(1, &mp->done, &index);
+        for (i = 1; i < mp->n_active; ++i) {
+                if (!mp->workers[i].started)
+                        continue;
+                r = mp->bs->wait_for_event(1, &mp->workers[i].event, &index);
+                if (C_EFI_ERROR(r) && !C_EFI_ERROR(r_wait))
+                        r_wait = r;
+        }
+
+        /* the events are signaled after the APs return, unless waiting failed */
+        while (__atomic_load_n(&mp->n_running, __ATOMIC_ACQUIRE))
+                c_efi_sync_relax();
+
+        mp->n_fallbacks += fallback;
+        if (C_EFI_ERROR(r_wait))
+                return r_wait;
+        return __atomic_load_n(&mp->status, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * c_efi_mp_steals() - Count steals of the last jobs
+ * @mp:                 dispatcher to query
+ *
+ * Return: The number of successful steals of all workers.
+ */
+static inline CEfiU64 c_efi_mp_steals(CEfiMp *mp) {
+        CEfiU64 n = 0;
+        CEfiUSize i;
+
+        for (i = 0; i < mp->n_workers; ++i)
+                n += mp->workers[i].n_steals;
+        return n;
+}
+
+typedef struct CEfiMpMemset {
+        CEfiU8 *dst;
+        CEfiU8 c;
+} CEfiMpMemset;
+
+static inline CEfiStatus c_efi_mp_memset_chunk(void *userdata, CEfiUSize begin, CEfiUSize end, CEfiUSize worker) {
+        CEfiMpMemset *m = userdata;
+
+        c_efi_memset(m->dst + begin, m->c, end - begin);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_mp_memset() - Fill memory on all workers
+ * @mp:                 dispatcher to run on
+ * @dst:                memory to fill
+ * @c:                  value to fill with
+ * @n:                  size of @dst in bytes
+ *
+ * This fills @dst in chunks of C_EFI_MP_MEMSET_CHUNK bytes, which is worth
+ * it for large buffers only, since a single core rarely saturates memory
+ * bandwidth.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of c_efi_mp_run().
+ */
+static inline CEfiStatus c_efi_mp_memset(CEfiMp *mp, void *dst, CEfiU8 c, CEfiUSize n) {
+        CEfiMpMemset m = { .dst = dst, .c = c };
+
+        return c_efi_mp_run(mp, c_efi_mp_memset_chunk, &m, n, C_EFI_MP_MEMSET_CHUNK);
+}
+
+typedef struct CEfiMpSha256 {
+        const CEfiU8 *data;
+        CEfiUSize n_data;
+        CEfiUSize piece_size;
+        CEfiU8 (*digests)[C_EFI_SHA256_DIGEST_SIZE];
+} CEfiMpSha256;
+
+static inline CEfiStatus c_efi_mp_sha256_chunk(void *userdata, CEfiUSize begin, CEfiUSize end, CEfiUSize worker) {
+        CEfiMpSha256 *h = userdata;
+        CEfiUSize i, off, n;
+
+        for (i = begin; i < end; ++i) {
+                off = i * h->piece_size;
+                n = h->n_data - off < h->piece_size ? h->n_data - off : h->piece_size;
+                c_efi_sha256(h->data + off, n, h->digests[i]);
+        }
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_mp_sha256_pieces() - Hash pieces of a buffer on all workers
+ * @mp:                 dispatcher to run on
+ * @data:               data to hash
+ * @n_data:             size of @data in bytes
+ * @piece_size:         size of each piece, except for the last
+ * @digests:            output array with one digest per piece
+ *
+ * This hashes each @piece_size bytes of @data separately, as used to
+ * verify images against a list of per-piece digests. The kernels are
+ * selected by the features of the BSP, and only kernels which need no more
+ * than SSE are ever used.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if
+ *         @piece_size is 0, or the error of c_efi_mp_run().
+ */
+static inline CEfiStatus c_efi_mp_sha256_pieces(CEfiMp *mp,
+                                                const void *data,
+                                                CEfiUSize n_data,
+                                                CEfiUSize piece_size,
+                                                CEfiU8 (*digests)[C_EFI_SHA256_DIGEST_SIZE]) {
+        CEfiMpSha256 h = { .data = data, .n_data = n_data, .piece_size = piece_size, .digests = digests };
+
+        if (!piece_size)
+                return C_EFI_INVALID_PARAMETER;
+
+        return c_efi_mp_run(mp, c_efi_mp_sha256_chunk, &h, (n_data + piece_size - 1) / piece_size, 1);
+}
+
+/**
+ * CEfiMpLz4Block: Independent LZ4 Block
+ * @src:                compressed block
+ * @n_src:              size of @src in bytes
+ * @dst:                destination of the decoded block
+ * @n_dst:              space available at @dst
+ * @n_out:              decoded size, set on success
+ *
+ * Blocks must not refer to the data of other blocks, which the LZ4 frame
+ * format signals with the block independence flag.
+ */
+typedef struct CEfiMpLz4Block {
+        const void *src;
+        CEfiUSize n_src;
+        CEfiU8 *dst;
+        CEfiUSize n_dst;
+        CEfiUSize n_out;
+} CEfiMpLz4Block;
+
+static inline CEfiStatus c_efi_mp_lz4_chunk(void *userdata, CEfiUSize begin, CEfiUSize end, CEfiUSize worker) {
+        CEfiMpLz4Block *blocks = userdata, *b;
+        CEfiStatus r;
+        CEfiUSize i;
+
+        for (i = begin; i < end; ++i) {
+                b = &blocks[i];
+                r = c_efi_lz4_block(b->dst, b->dst, b->n_dst, b->src, b->n_src, &b->n_out);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_mp_lz4_blocks() - Decompress independent LZ4 blocks on all workers
+ * @mp:                 dispatcher to run on
+ * @blocks:             blocks to decompress
+ * @n_blocks:           number of entries in @blocks
+ *
+ * Return: C_EFI_SUCCESS on success, or the first error of
+ *         c_efi_lz4_block() or c_efi_mp_run().
+ */
+static inline CEfiStatus c_efi_mp_lz4_blocks(CEfiMp *mp, CEfiMpLz4Block *blocks, CEfiUSize n_blocks) {
+        return c_efi_mp_run(mp, c_efi_mp_lz4_chunk, blocks, n_blocks, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,333 @@
+#pragma once
+
+/**
+ * In-Memory PE/COFF Loader
+ *
+ * LoadImage() with a source buffer makes the firmware copy, verify, and
+ * relocate the image, which can be slow on some platforms. This header
+ * provides a minimal PE32+ loader for images that are already in memory. It
+ * maps the sections into pages allocated via AllocatePages(), applies base
+ * relocations in a single linear pass over the relocation directory, and
+ * installs a CEfiLoadedImageProtocol for the child before calling its entry
+ * point.
+ *
+ * Note that this bypasses the firmware image verification entirely. In
+ * particular, no Secure Boot policy is applied. Callers must verify images
+ * themselves before starting them. Furthermore, the firmware does not know
+ * about the child image, so the child must return from its entry point
+ * rather than calling Exit(), and it cannot be unloaded via UnloadImage().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-protocol-loaded-image.h>
+#include <c-efi-pe.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define C_EFI_PE_MACHINE_NATIVE C_EFI_PE_MACHINE_X64
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define C_EFI_PE_MACHINE_NATIVE C_EFI_PE_MACHINE_ARM64
+#elif defined(__riscv) && __riscv_xlen == 64
+#  define C_EFI_PE_MACHINE_NATIVE C_EFI_PE_MACHINE_RISCV64
+#else
+#  define C_EFI_PE_MACHINE_NATIVE C_EFI_U16_C(0x0000) /* PE32+ loading unsupported */
+#endif
+
+/**
+ * CEfiPeLoader: PE/COFF Loader
+ * @st:                 system table
+ * @file:               parsed source image (file layout)
+ * @image:              parsed mapped image (loaded layout)
+ * @pages:              physical address of the mapped image
+ * @n_pages:            number of pages at @pages
+ * @entry:              entry point of the mapped image
+ * @handle:             image handle of the child while it runs, or NULL
+ * @loaded_image:       loaded image protocol of the child
+ *
+ * A loader object is filled in by c_efi_pe_loader_load(). The caller may
+ * adjust @loaded_image (e.g., to set load options or the device path) before
+ * calling c_efi_pe_loader_start().
+ */
+typedef struct CEfiPeLoader {
+        CEfiSystemTable *st;
+        CEfiPeImage file;
+        CEfiPeImage image;
+        CEfiPhysicalAddress pages;
+        CEfiUSize n_pages;
+        CEfiImageEntryPoint entry;
+        CEfiHandle handle;
+        CEfiLoadedImageProtocol loaded_image;
+} CEfiPeLoader;
+
+/**
+ * c_efi_pe_relocate() - Apply base relocations
+ * @base:               start of the mapped image
+ * @size_of_image:      size of the mapped image
+ * @relocs:             relocation directory within the mapped image
+ * @relocs_size:        size of @relocs in bytes
+ * @delta:              difference between actual and preferred image base
+ *
+ * This applies all base relocations of the relocation directory @relocs to
+ * the image at @base, in a single linear pass. Targets need not be aligned.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_LOAD_ERROR if the relocation
+ *         directory is malformed, C_EFI_UNSUPPORTED on unknown relocation
+ *         types.
+ */
+static inline CEfiStatus c_efi_pe_relocate(CEfiU8 *base,
+                                           CEfiU32 size_of_image,
+                                           const CEfiU8 *relocs,
+                                           CEfiUSize relocs_size,
+                                           CEfiU64 delta) {
+        CEfiU32 page, block_size, off;
+        CEfiUSize pos = 0, i, n;
+        CEfiU16 entry;
+        CEfiU8 *p;
+        CEfiU64 v;
+
+        while (relocs_size - pos >= 8) {
+                page = c_efi_pe_read_u32(relocs + pos);
+                block_size = c_efi_pe_read_u32(relocs + pos + 4);
+                if (block_size < 8 || block_size > relocs_size - pos || (block_size & 1))
+                        return C_EFI_LOAD_ERROR;
+
+                n = (block_size - 8) / 2;
+                for (i = 0; i < n; ++i) {
+                        entry = c_efi_pe_read_u16(relocs + pos + 8 + i * 2);
+                        off = page + (entry & 0x0fff);
+                        if (off < page)
+                                return C_EFI_LOAD_ERROR;
+
+                        switch (entry >> 12) {
+                        case C_EFI_PE_REL_BASED_ABSOLUTE:
+                                break;
+                        case C_EFI_PE_REL_BASED_HIGHLOW:
+                                if (off > size_of_image || size_of_image - off < 4)
+                                        return C_EFI_LOAD_ERROR;
+                                p = base + off;
+                                v = c_efi_pe_read_u32(p) + delta;
+                                p[0] = v;
+                                p[1] = v >> 8;
+                                p[2] = v >> 16;
+                                p[3] = v >> 24;
+                                break;
+                        case C_EFI_PE_REL_BASED_DIR64:
+                                if (off > size_of_image || size_of_image - off < 8)
+                                        return C_EFI_LOAD_ERROR;
+                                p = base + off;
+                                v = c_efi_pe_read_u64(p) + delta;
+                                p[0] = v;
+                                p[1] = v >> 8;
+                                p[2] = v >> 16;
+                                p[3] = v >> 24;
+                                p[4] = v >> 32;
+                                p[5] = v >> 40;
+                                p[6] = v >> 48;
+                                p[7] = v >> 56;
+                                break;
+                        default:
+                                return C_EFI_UNSUPPORTED;
+                        }
+                }
+
+                pos += block_size;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_pe_loader_unload() - Release a loaded image
+ * @loader:             loader to release
+ *
+ * This frees the pages of the mapped image. The image must not be running.
+ * This is a no-op if nothing is loaded.
+ */
+static inline void c_efi_pe_loader_unload(CEfiPeLoader *loader) {
+        if (loader->n_pages)
+                loader->st->boot_services->free_pages(loader->pages, loader->n_pages);
+        loader->pages = 0;
+        loader->n_pages = 0;
+        loader->entry = C_EFI_NULL;
+}
+
+/**
+ * c_efi_pe_loader_load() - Map a PE32+ image from memory
+ * @loader:             loader object to fill in
+ * @st:                 system table
+ * @parent:             image handle of the caller
+ * @data:               image file contents
+ * @size:               size of @data in bytes
+ *
+ * This parses the image file at @data, allocates pages for it, copies the
+ * headers and sections to their RVA (zero-filling the remainder), and applies
+ * base relocations if the image could not be placed at its preferred base.
+ * Images with stripped relocations are placed at their preferred base, or
+ * fail to load. Finally, the loaded image protocol of the child is prepared.
+ *
+ * Only PE32+ images for the executing machine type, with a section alignment
+ * of at most 4KiB, are supported.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_UNSUPPORTED if the image is not
+ *         supported, C_EFI_LOAD_ERROR if it is malformed, or the error of
+ *         AllocatePages().
+ */
+static inline CEfiStatus c_efi_pe_loader_load(CEfiPeLoader *loader,
+                                              CEfiSystemTable *st,
+                                              CEfiHandle parent,
+                                              const void *data,
+                                              CEfiUSize size) {
+        CEfiBootServices *bs = st->boot_services;
+        const CEfiPeSectionHeader *s;
+        CEfiU32 pos, n, n_virtual;
+        const void *relocs;
+        CEfiU8 *base;
+        CEfiStatus r;
+        CEfiUSize i, n_relocs;
+
+        *loader = (CEfiPeLoader){
+                .st = st,
+        };
+
+        r = c_efi_pe_image_parse(&loader->file, data, size, C_EFI_FALSE);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        if (!C_EFI_PE_MACHINE_NATIVE || loader->file.machine != C_EFI_PE_MACHINE_NATIVE ||
+            loader->file.magic != C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS ||
+            loader->file.section_alignment > 4096 ||
+            !loader->file.entry_point ||
+            loader->file.entry_point >= loader->file.size_of_image)
+                return C_EFI_UNSUPPORTED;
+        if (loader->file.size_of_headers > size)
+                return C_EFI_LOAD_ERROR;
+
+        loader->n_pages = ((CEfiUSize)loader->file.size_of_image + 4095) / 4096;
+
+        if (loader->file.characteristics & C_EFI_PE_FILE_RELOCS_STRIPPED) {
+                loader->pages = loader->file.image_base;
+                r = bs->allocate_pages(C_EFI_ALLOCATE_ADDRESS, C_EFI_LOADER_CODE, loader->n_pages, &loader->pages);
+        } else {
+                r = bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES, C_EFI_LOADER_CODE, loader->n_pages, &loader->pages);
+        }
+        if (C_EFI_ERROR(r)) {
+                loader->n_pages = 0;
+                return r;
+        }
+
+        base = (CEfiU8 *)(CEfiUSize)loader->pages;
+
+        /*
+         * Sections are sorted by RVA, so a single sweep over the image copies
+         * each byte once and zeroes the gaps between them. Like the reference
+         * implementation, a virtual size of 0 means the raw size is used.
+         */
+        bs->copy_mem(base, (void *)data, loader->file.size_of_headers);
+        pos = loader->file.size_of_headers;
+
+        for (i = 0; i < loader->file.n_sections; ++i) {
+                s = &loader->file.sections[i];
+                n_virtual = s->virtual_size ? s->virtual_size : s->size_of_raw_data;
+                if (s->virtual_address < pos ||
+                    n_virtual > loader->file.size_of_image - s->virtual_address) {
+                        r = C_EFI_LOAD_ERROR;
+                        goto error;
+                }
+
+                if (s->virtual_address > pos)
+                        bs->set_mem(base + pos, s->virtual_address - pos, 0);
+
+                n = s->size_of_raw_data < n_virtual ? s->size_of_raw_data : n_virtual;
+                if (n)
+                        bs->copy_mem(base + s->virtual_address,
+                                     (CEfiU8 *)data + s->pointer_to_raw_data,
+                                     n);
+                if (n_virtual > n)
+                        bs->set_mem(base + s->virtual_address + n, n_virtual - n, 0);
+
+                pos = s->virtual_address + n_virtual;
+        }
+
+        if (loader->n_pages * 4096 > pos)
+                bs->set_mem(base + pos, loader->n_pages * 4096 - pos, 0);
+
+        r = c_efi_pe_image_parse(&loader->image, base, loader->n_pages * 4096, C_EFI_TRUE);
+        if (C_EFI_ERROR(r))
+                goto error;
+
+        if (loader->pages != loader->image.image_base) {
+                relocs = c_efi_pe_directory(&loader->image, C_EFI_PE_DIRECTORY_BASERELOC, &n_relocs);
+                if (relocs) {
+                        r = c_efi_pe_relocate(base,
+                                              loader->image.size_of_image,
+                                              relocs,
+                                              n_relocs,
+                                              loader->pages - loader->image.image_base);
+                        if (C_EFI_ERROR(r))
+                                goto error;
+                }
+        }
+
+#if defined(__aarch64__) || defined(__riscv)
+        __builtin___clear_cache((char *)base, (char *)base + loader->image.size_of_image);
+#endif
+
+        loader->entry = (CEfiImageEntryPoint)(void *)(base + loader->image.entry_point);
+        loader->loaded_image = (CEfiLoadedImageProtocol){
+                .revision = C_EFI_LOADED_IMAGE_PROTOCOL_REVISION,
+                .parent_handle = parent,
+                .system_table = st,
+                .image_base = base,
+                .image_size = loader->n_pages * 4096,
+                .image_code_type = C_EFI_LOADER_CODE,
+                .image_data_type = C_EFI_LOADER_DATA,
+        };
+
+        return C_EFI_SUCCESS;
+
+error:
+        c_efi_pe_loader_unload(loader);
+        return r;
+}
+
+/**
+ * c_efi_pe_loader_start() - Run a mapped image
+ * @loader:             loader with a mapped image
+ *
+ * This creates a new image handle carrying the loaded image protocol of the
+ * child, invokes the entry point of the child, and uninstalls the protocol
+ * again once the entry point returned.
+ *
+ * Return: The status returned by the child, C_EFI_NOT_READY if no image is
+ *         loaded, or the error of InstallProtocolInterface().
+ */
+static inline CEfiStatus c_efi_pe_loader_start(CEfiPeLoader *loader) {
+        CEfiGuid guid = C_EFI_LOADED_IMAGE_PROTOCOL_GUID;
+        CEfiBootServices *bs = loader->st->boot_services;
+        CEfiStatus r;
+
+        if (!loader->entry)
+                return C_EFI_NOT_READY;
+
+        loader->handle = C_EFI_NULL;
+        r = bs->install_protocol_interface(&loader->handle,
+                                           &guid,
+                                           C_EFI_NATIVE_INTERFACE,
+                                           &loader->loaded_image);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = loader->entry(loader->handle, loader->st);
+
+        bs->uninstall_protocol_interface(loader->handle, &guid, &loader->loaded_image);
+        loader->handle = C_EFI_NULL;
+        return r;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,522 @@
+#pragma once
+
+/**
+ * PE/COFF Image Introspection
+ *
+ * UEFI images are PE/COFF executables. Once loaded, CEfiLoadedImageProtocol
+ * describes where an image lives in memory, but not what is inside. This
+ * header provides the PE/COFF header definitions needed to interpret images,
+ * plus bounds-checked accessors for headers, sections, and data directories.
+ *
+ * All accessors work in place. Section data is returned as pointers into the
+ * image, no payload is ever copied. Both the in-memory layout of loaded
+ * images (addressed by RVA) and the on-disk file layout (addressed by file
+ * offset) are supported.
+ *
+ * Section lookup by name is O(1): c_efi_pe_image_parse() builds a small hash
+ * index over the section table in the same pass that validates it.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-protocol-loaded-image.h>
+
+#define C_EFI_PE_DOS_MAGIC C_EFI_U16_C(0x5a4d) /* "MZ" */
+#define C_EFI_PE_SIGNATURE C_EFI_U32_C(0x00004550) /* "PE\0\0" */
+
+#define C_EFI_PE_MACHINE_I386           C_EFI_U16_C(0x014c)
+#define C_EFI_PE_MACHINE_ARMNT          C_EFI_U16_C(0x01c4)
+#define C_EFI_PE_MACHINE_RISCV64        C_EFI_U16_C(0x5064)
+#define C_EFI_PE_MACHINE_X64            C_EFI_U16_C(0x8664)
+#define C_EFI_PE_MACHINE_ARM64          C_EFI_U16_C(0xaa64)
+
+#define C_EFI_PE_FILE_RELOCS_STRIPPED           C_EFI_U16_C(0x0001)
+#define C_EFI_PE_FILE_EXECUTABLE_IMAGE          C_EFI_U16_C(0x0002)
+#define C_EFI_PE_FILE_LARGE_ADDRESS_AWARE       C_EFI_U16_C(0x0020)
+
+#define C_EFI_PE_OPTIONAL_MAGIC_PE32            C_EFI_U16_C(0x010b)
+#define C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS        C_EFI_U16_C(0x020b)
+
+#define C_EFI_PE_SUBSYSTEM_EFI_APPLICATION              C_EFI_U16_C(10)
+#define C_EFI_PE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER      C_EFI_U16_C(11)
+#define C_EFI_PE_SUBSYSTEM_EFI_RUNTIME_DRIVER           C_EFI_U16_C(12)
+#define C_EFI_PE_SUBSYSTEM_EFI_ROM                      C_EFI_U16_C(13)
+
+#define C_EFI_PE_DIRECTORY_EXPORT               0
+#define C_EFI_PE_DIRECTORY_IMPORT               1
+#define C_EFI_PE_DIRECTORY_RESOURCE             2
+#define C_EFI_PE_DIRECTORY_EXCEPTION            3
+#define C_EFI_PE_DIRECTORY_SECURITY             4
+#define C_EFI_PE_DIRECTORY_BASERELOC            5
+#define C_EFI_PE_DIRECTORY_DEBUG                6
+#define _C_EFI_PE_DIRECTORY_N                   16
+
+#define C_EFI_PE_REL_BASED_ABSOLUTE             0
+#define C_EFI_PE_REL_BASED_HIGHLOW              3
+#define C_EFI_PE_REL_BASED_DIR64                10
+
+#define C_EFI_PE_SECTION_CNT_CODE               C_EFI_U32_C(0x00000020)
+#define C_EFI_PE_SECTION_CNT_INITIALIZED_DATA   C_EFI_U32_C(0x00000040)
+#define C_EFI_PE_SECTION_CNT_UNINITIALIZED_DATA C_EFI_U32_C(0x00000080)
+#define C_EFI_PE_SECTION_MEM_DISCARDABLE        C_EFI_U32_C(0x02000000)
+#define C_EFI_PE_SECTION_MEM_EXECUTE            C_EFI_U32_C(0x20000000)
+#define C_EFI_PE_SECTION_MEM_READ               C_EFI_U32_C(0x40000000)
+#define C_EFI_PE_SECTION_MEM_WRITE              C_EFI_U32_C(0x80000000)
+
+#define C_EFI_PE_SECTIONS_MAX 96
+
+typedef struct CEfiPeDosHeader {
+        CEfiU16 magic;
+        CEfiU16 unused[29];
+        CEfiU32 lfanew;
+} CEfiPeDosHeader;
+
+typedef struct CEfiPeFileHeader {
+        CEfiU16 machine;
+        CEfiU16 number_of_sections;
+        CEfiU32 time_date_stamp;
+        CEfiU32 pointer_to_symbol_table;
+        CEfiU32 number_of_symbols;
+        CEfiU16 size_of_optional_header;
+        CEfiU16 characteristics;
+} CEfiPeFileHeader;
+
+typedef struct CEfiPeDataDirectory {
+        CEfiU32 virtual_address;
+        CEfiU32 size;
+} CEfiPeDataDirectory;
+
+typedef struct CEfiPeOptionalHeader32 {
+        CEfiU16 magic;
+        CEfiU8 major_linker_version;
+        CEfiU8 minor_linker_version;
+        CEfiU32 size_of_code;
+        CEfiU32 size_of_initialized_data;
+        CEfiU32 size_of_uninitialized_data;
+        CEfiU32 address_of_entry_point;
+        CEfiU32 base_of_code;
+        CEfiU32 base_of_data;
+        CEfiU32 image_base;
+        CEfiU32 section_alignment;
+        CEfiU32 file_alignment;
+        CEfiU16 major_operating_system_version;
+        CEfiU16 minor_operating_system_version;
+        CEfiU16 major_image_version;
+        CEfiU16 minor_image_version;
+        CEfiU16 major_subsystem_version;
+        CEfiU16 minor_subsystem_version;
+        CEfiU32 win32_version_value;
+        CEfiU32 size_of_image;
+        CEfiU32 size_of_headers;
+        CEfiU32 check_sum;
+        CEfiU16 subsystem;
+        CEfiU16 dll_characteristics;
+        CEfiU32 size_of_stack_reserve;
+        CEfiU32 size_of_stack_commit;
+        CEfiU32 size_of_heap_reserve;
+        CEfiU32 size_of_heap_commit;
+        CEfiU32 loader_flags;
+        CEfiU32 number_of_rva_and_sizes;
+        CEfiPeDataDirectory data_directory[];
+} CEfiPeOptionalHeader32;
+
+typedef struct CEfiPeOptionalHeader64 {
+        CEfiU16 magic;
+        CEfiU8 major_linker_version;
+        CEfiU8 minor_linker_version;
+        CEfiU32 size_of_code;
+        CEfiU32 size_of_initialized_data;
+        CEfiU32 size_of_uninitialized_data;
+        CEfiU32 address_of_entry_point;
+        CEfiU32 base_of_code;
+        CEfiU64 image_base;
+        CEfiU32 section_alignment;
+        CEfiU32 file_alignment;
+        CEfiU16 major_operating_system_version;
+        CEfiU16 minor_operating_system_version;
+        CEfiU16 major_image_version;
+        CEfiU16 minor_image_version;
+        CEfiU16 major_subsystem_version;
+        CEfiU16 minor_subsystem_version;
+        CEfiU32 win32_version_value;
+        CEfiU32 size_of_image;
+        CEfiU32 size_of_headers;
+        CEfiU32 check_sum;
+        CEfiU16 subsystem;
+        CEfiU16 dll_characteristics;
+        CEfiU64 size_of_stack_reserve;
+        CEfiU64 size_of_stack_commit;
+        CEfiU64 size_of_heap_reserve;
+        CEfiU64 size_of_heap_commit;
+        CEfiU32 loader_flags;
+        CEfiU32 number_of_rva_and_sizes;
+        CEfiPeDataDirectory data_directory[];
+} CEfiPeOptionalHeader64;
+
+typedef struct CEfiPeSectionHeader {
+        CEfiChar8 name[8];
+        CEfiU32 virtual_size;
+        CEfiU32 virtual_address;
+        CEfiU32 size_of_raw_data;
+        CEfiU32 pointer_to_raw_data;
+        CEfiU32 pointer_to_relocations;
+        CEfiU32 pointer_to_linenumbers;
+        CEfiU16 number_of_relocations;
+        CEfiU16 number_of_linenumbers;
+        CEfiU32 characteristics;
+} CEfiPeSectionHeader;
+
+/**
+ * CEfiPeImage: Parsed PE/COFF Image
+ * @base:               start of the image
+ * @size:               number of accessible bytes at @base
+ * @loaded:             whether @base uses the loaded (RVA) layout
+ * @machine:            target machine, one of C_EFI_PE_MACHINE_*
+ * @magic:              optional header magic, one of C_EFI_PE_OPTIONAL_MAGIC_*
+ * @subsystem:          subsystem, one of C_EFI_PE_SUBSYSTEM_*
+ * @characteristics:    COFF file characteristics
+ * @image_base:         preferred load address
+ * @entry_point:        RVA of the entry point
+ * @size_of_image:      size of the loaded image
+ * @size_of_headers:    size of all headers
+ * @section_alignment:  alignment of sections in memory
+ * @file_alignment:     alignment of sections in the file
+ * @n_directories:      number of valid entries in @directories
+ * @directories:        data directories
+ * @n_sections:         number of entries in @sections
+ * @sections:           section table, pointing into the image
+ * @index:              section name hash index, 0 marks empty slots
+ *
+ * This is filled in by c_efi_pe_image_parse(). The headers are copied into
+ * this object, since the optional header is not guaranteed to be naturally
+ * aligned. The section table is referenced in place.
+ */
+typedef struct CEfiPeImage {
+        const CEfiU8 *base;
+        CEfiUSize size;
+        CEfiBool loaded;
+        CEfiU16 machine;
+        CEfiU16 magic;
+        CEfiU16 subsystem;
+        CEfiU16 characteristics;
+        CEfiU64 image_base;
+        CEfiU32 entry_point;
+        CEfiU32 size_of_image;
+        CEfiU32 size_of_headers;
+        CEfiU32 section_alignment;
+        CEfiU32 file_alignment;
+        CEfiU32 n_directories;
+        CEfiPeDataDirectory directories[_C_EFI_PE_DIRECTORY_N];
+        CEfiU16 n_sections;
+        const CEfiPeSectionHeader *sections;
+        CEfiU8 index[2 * C_EFI_PE_SECTIONS_MAX];
+} CEfiPeImage;
+
+static inline CEfiU16 c_efi_pe_read_u16(const CEfiU8 *p) {
+        return (CEfiU16)(p[0] | (p[1] << 8));
+}
+
+static inline CEfiU32 c_efi_pe_read_u32(const CEfiU8 *p) {
+        return (CEfiU32)c_efi_pe_read_u16(p) | ((CEfiU32)c_efi_pe_read_u16(p + 2) << 16);
+}
+
+static inline CEfiU64 c_efi_pe_read_u64(const CEfiU8 *p) {
+        return (CEfiU64)c_efi_pe_read_u32(p) | ((CEfiU64)c_efi_pe_read_u32(p + 4) << 32);
+}
+
+static inline CEfiU64 c_efi_pe_name_key(const CEfiU8 *name, CEfiUSize n) {
+        CEfiU64 key = 0;
+        CEfiUSize i;
+
+        for (i = 0; i < 8 && i < n && name[i]; ++i)
+                key |= (CEfiU64)name[i] << (i * 8);
+
+        return key;
+}
+
+static inline CEfiUSize c_efi_pe_name_hash(CEfiU64 key) {
+        return (CEfiUSize)((key * C_EFI_U64_C(0x9e3779b97f4a7c15)) >> 56) % (2 * C_EFI_PE_SECTIONS_MAX);
+}
+
+/**
+ * c_efi_pe_image_parse() - Parse and validate PE/COFF headers
+ * @image:              object to fill in
+ * @base:               start of the image
+ * @size:               number of accessible bytes at @base
+ * @loaded:             whether @base uses the loaded (RVA) layout
+ *
+ * This validates the DOS, PE, COFF, and optional headers of the image at
+ * @base, as well as the bounds of every section, and fills in @image. Both
+ * PE32 and PE32+ images are accepted. If @loaded is true, sections are
+ * expected at their RVA, otherwise at their file offset.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_LOAD_ERROR if the headers are
+ *         malformed or out of bounds, C_EFI_UNSUPPORTED if the image has more
+ *         than C_EFI_PE_SECTIONS_MAX sections or a misaligned section table.
+ */
+static inline CEfiStatus c_efi_pe_image_parse(CEfiPeImage *image,
+                                              const void *base,
+                                              CEfiUSize size,
+                                              CEfiBool loaded) {
+        const CEfiU8 *p = base, *opt;
+        const CEfiPeSectionHeader *s;
+        CEfiU32 lfanew, n_opt, magic, n_dirs, end, extent;
+        CEfiUSize i, slot, off_dirs, off_sections;
+        CEfiU16 n_sections;
+
+        *image = (CEfiPeImage){
+                .base = p,
+                .size = size,
+                .loaded = loaded,
+        };
+
+        if (size < sizeof(CEfiPeDosHeader) || c_efi_pe_read_u16(p) != C_EFI_PE_DOS_MAGIC)
+                return C_EFI_LOAD_ERROR;
+
+        lfanew = c_efi_pe_read_u32(p + 0x3c);
+        if (lfanew > size || size - lfanew < 4 + sizeof(CEfiPeFileHeader) ||
+            c_efi_pe_read_u32(p + lfanew) != C_EFI_PE_SIGNATURE)
+                return C_EFI_LOAD_ERROR;
+
+        image->machine = c_efi_pe_read_u16(p + lfanew + 4);
+        n_sections = c_efi_pe_read_u16(p + lfanew + 6);
+        n_opt = c_efi_pe_read_u16(p + lfanew + 20);
+        image->characteristics = c_efi_pe_read_u16(p + lfanew + 22);
+
+        opt = p + lfanew + 4 + sizeof(CEfiPeFileHeader);
+        if (n_opt < 2 || (CEfiUSize)(opt - p) + n_opt > size)
+                return C_EFI_LOAD_ERROR;
+
+        magic = c_efi_pe_read_u16(opt);
+        image->magic = magic;
+        if (magic == C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS) {
+                off_dirs = sizeof(CEfiPeOptionalHeader64);
+                if (n_opt < off_dirs)
+                        return C_EFI_LOAD_ERROR;
+                image->image_base = c_efi_pe_read_u64(opt + 24);
+        } else if (magic == C_EFI_PE_OPTIONAL_MAGIC_PE32) {
+                off_dirs = sizeof(CEfiPeOptionalHeader32);
+                if (n_opt < off_dirs)
+                        return C_EFI_LOAD_ERROR;
+                image->image_base = c_efi_pe_read_u32(opt + 28);
+        } else {
+                return C_EFI_LOAD_ERROR;
+        }
+
+        /* these fields are at the same offsets in PE32 and PE32+ */
+        image->entry_point = c_efi_pe_read_u32(opt + 16);
+        image->section_alignment = c_efi_pe_read_u32(opt + 32);
+        image->file_alignment = c_efi_pe_read_u32(opt + 36);
+        image->size_of_image = c_efi_pe_read_u32(opt + 56);
+        image->size_of_headers = c_efi_pe_read_u32(opt + 60);
+        image->subsystem = c_efi_pe_read_u16(opt + 68);
+
+        n_dirs = c_efi_pe_read_u32(opt + off_dirs - 4);
+        if (n_dirs > (n_opt - off_dirs) / sizeof(CEfiPeDataDirectory))
+                return C_EFI_LOAD_ERROR;
+        image->n_directories = n_dirs < _C_EFI_PE_DIRECTORY_N ? n_dirs : _C_EFI_PE_DIRECTORY_N;
+        for (i = 0; i < image->n_directories; ++i) {
+                image->directories[i].virtual_address = c_efi_pe_read_u32(opt + off_dirs + i * 8);
+                image->directories[i].size = c_efi_pe_read_u32(opt + off_dirs + i * 8 + 4);
+        }
+
+        if (image->size_of_headers > image->size_of_image ||
+            (loaded && image->size_of_image > size))
+                return C_EFI_LOAD_ERROR;
+
+        off_sections = (CEfiUSize)(opt - p) + n_opt;
+        if (n_sections > C_EFI_PE_SECTIONS_MAX)
+                return C_EFI_UNSUPPORTED;
+        if (off_sections & 3)
+                return C_EFI_UNSUPPORTED;
+        if ((size - off_sections) / sizeof(CEfiPeSectionHeader) < n_sections)
+                return C_EFI_LOAD_ERROR;
+
+        image->n_sections = n_sections;
+        image->sections = (const void *)(p + off_sections);
+
+        for (i = 0; i < n_sections; ++i) {
+                s = &image->sections[i];
+
+                end = s->virtual_address + s->virtual_size;
+                if (end < s->virtual_address || end > image->size_of_image)
+                        return C_EFI_LOAD_ERROR;
+
+                if (!loaded && s->size_of_raw_data) {
+                        extent = s->pointer_to_raw_data + s->size_of_raw_data;
+                        if (extent < s->pointer_to_raw_data || extent > size)
+                                return C_EFI_LOAD_ERROR;
+                }
+
+                slot = c_efi_pe_name_hash(c_efi_pe_name_key(s->name, sizeof(s->name)));
+                while (image->index[slot])
+                        slot = (slot + 1) % sizeof(image->index);
+                image->index[slot] = i + 1;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_pe_image_from_loaded_image() - Parse a loaded image
+ * @image:              object to fill in
+ * @loaded_image:       loaded image protocol of the image
+ *
+ * This is a shortcut for c_efi_pe_image_parse() on the in-memory image
+ * described by @loaded_image, for instance the running image itself.
+ *
+ * Return: See c_efi_pe_image_parse().
+ */
+static inline CEfiStatus c_efi_pe_image_from_loaded_image(CEfiPeImage *image,
+                                                          const CEfiLoadedImageProtocol *loaded_image) {
+        return c_efi_pe_image_parse(image,
+                                    loaded_image->image_base,
+                                    (CEfiUSize)loaded_image->image_size,
+                                    C_EFI_TRUE);
+}
+
+/**
+ * c_efi_pe_section_find() - Find section by name
+ * @image:              parsed image
+ * @name:               section name
+ *
+ * Section names of images are limited to 8 characters, so longer names
+ * never match.
+ *
+ * Return: Pointer to the first section with the given name, or NULL.
+ */
+static inline const CEfiPeSectionHeader *c_efi_pe_section_find(const CEfiPeImage *image, const char *name) {
+        const CEfiPeSectionHeader *s;
+        CEfiUSize i, slot;
+        CEfiU64 key;
+
+        for (i = 0; i <= 8 && name[i]; ++i)
+                ;
+        if (i > 8)
+                return C_EFI_NULL;
+
+        key = c_efi_pe_name_key((const CEfiU8 *)name, 8);
+        slot = c_efi_pe_name_hash(key);
+
+        while (image->index[slot]) {
+                s = &image->sections[image->index[slot] - 1];
+                if (c_efi_pe_name_key(s->name, sizeof(s->name)) == key)
+                        return s;
+                slot = (slot + 1) % sizeof(image->index);
+        }
+
+        return C_EFI_NULL;
+}
+
+/**
+ * c_efi_pe_section_data() - Get in-place section data
+ * @image:              parsed image
+ * @section:            section of @image
+ * @sizep:              output argument for the data size
+ *
+ * This returns a pointer to the data of @section within the image, without
+ * copying it. For loaded images, this covers the virtual size of the section
+ * (including zero-fill). For file layouts, this covers the raw data, bounded
+ * by the virtual size if non-zero, so file alignment padding is excluded.
+ *
+ * Return: Pointer to the section data, or NULL if the section has no data.
+ */
+static inline const void *c_efi_pe_section_data(const CEfiPeImage *image,
+                                                const CEfiPeSectionHeader *section,
+                                                CEfiUSize *sizep) {
+        CEfiU32 n;
+
+        if (image->loaded) {
+                *sizep = section->virtual_size;
+                return section->virtual_size ? image->base + section->virtual_address : C_EFI_NULL;
+        }
+
+        n = section->size_of_raw_data;
+        if (section->virtual_size && section->virtual_size < n)
+                n = section->virtual_size;
+
+        *sizep = n;
+        return n ? image->base + section->pointer_to_raw_data : C_EFI_NULL;
+}
+
+/**
+ * c_efi_pe_rva() - Resolve RVA to pointer
+ * @image:              parsed image
+ * @rva:                relative virtual address
+ * @size:               number of bytes that must be accessible at @rva
+ *
+ * This translates @rva into a pointer into the image, verifying that @size
+ * bytes are accessible. For file layouts, the RVA is translated through the
+ * section table; RVAs within the headers map 1-to-1.
+ *
+ * Return: Pointer to the data at @rva, or NULL if out of bounds.
+ */
+static inline const void *c_efi_pe_rva(const CEfiPeImage *image, CEfiU32 rva, CEfiU32 size) {
+        const CEfiPeSectionHeader *s;
+        CEfiU32 off;
+        CEfiUSize i;
+
+        if (rva + size < rva)
+                return C_EFI_NULL;
+
+        if (image->loaded || rva + size <= image->size_of_headers)
+                return rva + size <= image->size ? image->base + rva : C_EFI_NULL;
+
+        for (i = 0; i < image->n_sections; ++i) {
+                s = &image->sections[i];
+                if (rva < s->virtual_address)
+                        continue;
+
+                off = rva - s->virtual_address;
+                if (off + size >= off && off + size <= s->size_of_raw_data)
+                        return image->base + s->pointer_to_raw_data + off;
+        }
+
+        return C_EFI_NULL;
+}
+
+/**
+ * c_efi_pe_directory() - Get in-place data directory
+ * @image:              parsed image
+ * @index:              directory index, one of C_EFI_PE_DIRECTORY_*
+ * @sizep:              output argument for the directory size
+ *
+ * Note that the security directory is special: its address is a file offset,
+ * not an RVA, and it is not mapped into loaded images. It is returned as NULL
+ * for loaded images.
+ *
+ * Return: Pointer to the directory data, or NULL if absent or out of bounds.
+ */
+static inline const void *c_efi_pe_directory(const CEfiPeImage *image, CEfiUSize index, CEfiUSize *sizep) {
+        const CEfiPeDataDirectory *d;
+        const void *p;
+
+        *sizep = 0;
+        if (index >= image->n_directories)
+                return C_EFI_NULL;
+
+        d = &image->directories[index];
+        if (!d->virtual_address || !d->size)
+                return C_EFI_NULL;
+
+        if (index == C_EFI_PE_DIRECTORY_SECURITY) {
+                if (image->loaded || d->virtual_address + d->size < d->virtual_address ||
+                    d->virtual_address + d->size > image->size)
+                        return C_EFI_NULL;
+                p = image->base + d->virtual_address;
+        } else {
+                p = c_efi_pe_rva(image, d->virtual_address, d->size);
+        }
+
+        if (p)
+                *sizep = d->size;
+        return p;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,902 @@
+#pragma once
+
+/**
+ * Streaming Pipeline
+ *
+ * Reading, verifying and decompressing a payload one after another leaves
+ * the device idle while the CPU works, and the CPU idle while the device
+ * reads. This header connects the steps as stages of a pipeline instead,
+ * which pass buffers of a bounded ring along:
+ *
+ *  - The ring consists of page-aligned buffers of `allocate_pages` memory.
+ *    The first stage, the producer, fills free buffers with the stream, the
+ *    following stages process them in place, in order, and once the last
+ *    stage, the sink, is done with a buffer, it is free again.
+ *
+ *  - Each stage starts buffers with a callback. Synchronous stages complete
+ *    them right away. Asynchronous stages, like Block I/O 2 reads, keep up to
+ *    `depth` buffers in flight, and report completion when polled. Their
+ *    completion notifications signal a wake event of the pipeline.
+ *
+ *  - The pipeline runs cooperatively. Each pass over the stages retires
+ *    completed buffers, starts at most one buffer per synchronous stage, and
+ *    submits as many as fit for asynchronous ones. Passes run from the sink
+ *    back to the producer, so freed buffers are refilled right away, and no
+ *    CPU-bound stage holds up the refill of the device queue for long.
+ *    If a pass makes no progress, the pipeline waits for its wake event via
+ *    `wait_for_event`, so the CPU sleeps in firmware while devices work.
+ *    Callers with their own event loop drive single passes instead, and
+ *    wait for the wake event alongside their own events.
+ *
+ *  - Every stage accounts the time it spends in callbacks, idle with
+ *    buffers in flight, starved for input and, for the producer, blocked on
+ *    a full ring. The number of buffers each stage holds is integrated over
+ *    time. Buffers pile up in front of the bottleneck, while the stages
+ *    behind it starve. Timing needs a CEfiClock, counters are kept anyway.
+ *
+ * Adapters are provided for the helpers of this library: Block I/O 2 and
+ * file readers as producers, SHA-256 verification, and LZ4, zstd and plain
+ * copies as sinks into the final destination.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-block-queue.h>
+#include <c-efi-clock.h>
+#include <c-efi-file-reader.h>
+#include <c-efi-lz4.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-block-io.h>
+#include <c-efi-protocol-block-io2.h>
+#include <c-efi-sha2.h>
+#include <c-efi-zstd.h>
+
+#define C_EFI_PIPELINE_BUFFER_SIZE (256 * 1024)
+
+typedef struct CEfiPipeline CEfiPipeline;
+typedef struct CEfiPipelineStage CEfiPipelineStage;
+
+/**
+ * CEfiPipelineBuffer: Buffer of the Ring
+ * @data:               page-aligned storage of the buffer
+ * @size:               number of valid bytes, set by the producer
+ * @offset:             offset of @data in the stream
+ * @index:              sequence number of the buffer in the stream
+ */
+typedef struct CEfiPipelineBuffer {
+        CEfiU8 *data;
+        CEfiUSize size;
+        CEfiU64 offset;
+        CEfiU64 index;
+} CEfiPipelineBuffer;
+
+/**
+ * CEfiPipelineStageFn: Stage Callback
+ * @stage:              stage to operate on
+ * @buffer:             buffer to operate on
+ *
+ * `start` is called with every buffer in stream order. The producer sets
+ * the size of the buffer, or returns C_EFI_END_OF_FILE at the end of the
+ * stream. Stages with a `poll` callback complete buffers asynchronously:
+ * `poll` is called with the oldest buffer in flight, until it stops
+ * returning C_EFI_NOT_READY. Either callback may return C_EFI_NOT_READY
+ * to be called again later, in which case the stage must signal the wake
+ * event once it can make progress.
+ *
+ * Return: C_EFI_SUCCESS if done, C_EFI_NOT_READY to be called again, or
+ *         an error, which aborts the pipeline.
+ */
+typedef CEfiStatus (*CEfiPipelineStageFn)(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer);
+
+/**
+ * CEfiPipelineStats: Stage Statistics
+ * @n_buffers:          number of buffers completed
+ * @n_bytes:            number of bytes in completed buffers
+ * @n_stalls:           number of passes the stage was starved or blocked
+ * @max_occupancy:      maximum number of buffers held
+ * @busy_ns:            time spent in callbacks
+ * @pending_ns:         time idle with buffers in flight
+ * @starved_ns:         time idle without input
+ * @blocked_ns:         time idle without free buffers, producer only
+ * @occupancy_ns:       number of buffers held, integrated over time
+ *
+ * A stage holds the buffers it has in flight, and those completed by its
+ * predecessor but not yet started. The mean occupancy is @occupancy_ns
+ * divided by the run time.
+ */
+typedef struct CEfiPipelineStats {
+        CEfiU64 n_buffers;
+        CEfiU64 n_bytes;
+        CEfiU64 n_stalls;
+        CEfiU64 max_occupancy;
+        CEfiU64 busy_ns;
+        CEfiU64 pending_ns;
+        CEfiU64 starved_ns;
+        CEfiU64 blocked_ns;
+        CEfiU64 occupancy_ns;
+} CEfiPipelineStats;
+
+enum {
+        C_EFI_PIPELINE_STATE_BUSY,
+        C_EFI_PIPELINE_STATE_PENDING,
+        C_EFI_PIPELINE_STATE_STARVED,
+        C_EFI_PIPELINE_STATE_BLOCKED,
+        C_EFI_PIPELINE_STATE_ENDED,
+};
+
+/**
+ * CEfiPipelineStage: Pipeline Stage
+ * @start:              callback to start a buffer
+ * @poll:               callback to complete a buffer, or NULL if synchronous
+ * @finish:             callback at the end of the stream, or NULL
+ * @userdata:           context of the callbacks
+ * @depth:              maximum number of buffers in flight, 0 means 1
+ * @pipeline:           pipeline the stage runs in
+ * @n_started:          number of buffers started
+ * @n_done:             number of buffers completed
+ * @state:              C_EFI_PIPELINE_STATE_* after the last pass
+ * @pass_ns:            time spent in callbacks during the current pass
+ * @stats:              statistics of the current stream
+ *
+ * Callers fill in the fields up to @depth. `finish` is called with a NULL
+ * buffer once all stages completed the stream, so stages can verify it.
+ */
+struct CEfiPipelineStage {
+        CEfiPipelineStageFn start;
+        CEfiPipelineStageFn poll;
+        CEfiPipelineStageFn finish;
+        void *userdata;
+        CEfiUSize depth;
+        CEfiPipeline *pipeline;
+        CEfiU64 n_started;
+        CEfiU64 n_done;
+        unsigned int state;
+        CEfiU64 pass_ns;
+        CEfiPipelineStats stats;
+};
+
+/**
+ * CEfiPipeline: Streaming Pipeline
+ * @bs:                 boot services
+ * @clock:              clock to account time with, or NULL
+ * @wake:               event signaled by asynchronous stages
+ * @pages:              storage of all buffers
+ * @buffers:            buffers of the ring
+ * @n_buffers:          number of buffers of the ring
+ * @buffer_size:        size of each buffer, a multiple of 4096
+ * @stages:             stages of the current stream
+ * @n_stages:           number of stages of the current stream
+ * @offset:             stream offset of the next buffer to produce
+ * @eof:                whether the producer reached the end of the stream
+ * @idle:               whether the last pass made no progress
+ * @status:             result of the current stream, or C_EFI_NOT_READY
+ * @last_ns:            time of the end of the last pass
+ * @n_passes:           number of passes
+ * @n_waits:            number of waits for the wake event
+ * @wait_ns:            time spent waiting for the wake event
+ * @total_ns:           time since the start of the stream
+ */
+struct CEfiPipeline {
+        CEfiBootServices *bs;
+        const CEfiClock *clock;
+        CEfiEvent wake;
+        CEfiPhysicalAddress pages;
+        CEfiPipelineBuffer *buffers;
+        CEfiUSize n_buffers;
+        CEfiUSize buffer_size;
+        CEfiPipelineStage *stages;
+        CEfiUSize n_stages;
+        CEfiU64 offset;
+        CEfiBool eof;
+        CEfiBool idle;
+        CEfiStatus status;
+        CEfiU64 last_ns;
+        CEfiU64 n_passes;
+        CEfiU64 n_waits;
+        CEfiU64 wait_ns;
+        CEfiU64 total_ns;
+};
+
+static inline CEfiU64 c_efi_pipeline_now(CEfiPipeline *p) {
+        return p->clock ? c_efi_clock_ns(p->clock) : 0;
+}
+
+/**
+ * c_efi_pipeline_init() - Initialize pipeline
+ * @p:                  pipeline to initialize
+ * @bs:                 boot services
+ * @clock:              clock to account time with, or NULL
+ * @buffers:            storage for the buffer descriptors
+ * @n_buffers:          number of entries in @buffers, the ring size
+ * @buffer_size:        size of each buffer, or 0 for the default
+ *
+ * @buffer_size is rounded up to a multiple of the page size. The buffers
+ * are allocated as a single run of pages.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_buffers
+ *         is 0, or the error of `allocate_pages` or `create_event`.
+ */
+static inline CEfiStatus c_efi_pipeline_init(CEfiPipeline *p,
+                                             CEfiBootServices *bs,
+                                             const CEfiClock *clock,
+                                             CEfiPipelineBuffer *buffers,
+                                             CEfiUSize n_buffers,
+                                             CEfiUSize buffer_size) {
+        CEfiStatus r;
+        CEfiUSize i;
+
+        if (!buffer_size)
+                buffer_size = C_EFI_PIPELINE_BUFFER_SIZE;
+        buffer_size = (buffer_size + 4095) & ~(CEfiUSize)4095;
+
+        *p = (CEfiPipeline){ .bs = bs, .clock = clock, .buffers = buffers, .buffer_size = buffer_size };
+
+        if (!n_buffers)
+                return C_EFI_INVALID_PARAMETER;
+
+        r = bs->allocate_pages(C_EFI_ALLOCATE_ANY_PAGES,
+                               C_EFI_LOADER_DATA,
+                               n_buffers * (buffer_size / 4096),
+                               &p->pages);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = bs->create_event(0, 0, C_EFI_NULL, C_EFI_NULL, &p->wake);
+        if (C_EFI_ERROR(r)) {
+                bs->free_pages(p->pages, n_buffers * (buffer_size / 4096));
+                return r;
+        }
+
+        for (i = 0; i < n_buffers; ++i)
+                buffers[i] = (CEfiPipelineBuffer){ .data = (CEfiU8 *)(CEfiUSize)p->pages + i * buffer_size };
+
+        p->n_buffers = n_buffers;
+        return C_EFI_SUCCESS;
+}
+
+/* run a callback, and account its time */
+static inline CEfiStatus c_efi_pipeline_call(CEfiPipeline *p,
+                                             CEfiPipelineStage *s,
+                                             CEfiPipelineStageFn fn,
+                                             CEfiPipelineBuffer *b) {
+        CEfiU64 start;
+        CEfiStatus r;
+
+        if (!p->clock)
+                return fn(s, b);
+
+        start = c_efi_clock_ns(p->clock);
+        r = fn(s, b);
+        s->pass_ns += c_efi_clock_ns(p->clock) - start;
+        return r;
+}
+
+static inline void c_efi_pipeline_retire(CEfiPipelineStage *s, CEfiPipelineBuffer *b) {
+        ++s->n_done;
+        ++s->stats.n_buffers;
+        s->stats.n_bytes += b->size;
+}
+
+/**
+ * c_efi_pipeline_drain() - Wait for all buffers in flight
+ * @p:                  pipeline to drain
+ *
+ * Asynchronous stages must not be torn down while their requests may still
+ * complete. This polls every buffer in flight until it completes, ignoring
+ * its result, and ends the current stream.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `wait_for_event`.
+ */
+static inline CEfiStatus c_efi_pipeline_drain(CEfiPipeline *p) {
+        CEfiPipelineStage *s;
+        CEfiUSize i, index;
+        CEfiStatus r;
+
+        for (i = 0; i < p->n_stages; ++i) {
+                s = &p->stages[i];
+                while (s->n_done < s->n_started) {
+                        if (s->poll && s->poll(s, &p->buffers[s->n_done % p->n_buffers]) == C_EFI_NOT_READY) {
+                                r = p->bs->wait_for_event(1, &p->wake, &index);
+                                if (C_EFI_ERROR(r))
+                                        return r;
+                                continue;
+                        }
+                        ++s->n_done;
+                }
+        }
+
+        p->n_stages = 0;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_pipeline_deinit() - Deinitialize pipeline
+ * @p:                  pipeline to deinitialize
+ *
+ * This drains the pipeline, then frees the buffers and closes the wake
+ * event. Stages that signal the wake event must be torn down afterwards.
+ */
+static inline void c_efi_pipeline_deinit(CEfiPipeline *p) {
+        if (!p->n_buffers)
+                return;
+
+        c_efi_pipeline_drain(p);
+        p->bs->close_event(p->wake);
+        p->bs->free_pages(p->pages, p->n_buffers * (p->buffer_size / 4096));
+        p->n_buffers = 0;
+}
+
+/**
+ * c_efi_pipeline_start() - Start a stream
+ * @p:                  pipeline to use
+ * @stages:             stages, from the producer to the sink
+ * @n_stages:           number of entries in @stages
+ *
+ * This drains the previous stream, if any, and resets the state and the
+ * statistics of all stages. The stages must stay valid until the stream
+ * ends.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_stages
+ *         is 0, or the error of `wait_for_event`.
+ */
+static inline CEfiStatus c_efi_pipeline_start(CEfiPipeline *p, CEfiPipelineStage *stages, CEfiUSize n_stages) {
+        CEfiStatus r;
+        CEfiUSize i;
+
+        r = c_efi_pipeline_drain(p);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (!n_stages)
+                return C_EFI_INVALID_PARAMETER;
+
+        for (i = 0; i < n_stages; ++i) {
+                stages[i].pipeline = p;
+                stages[i].n_started = 0;
+                stages[i].n_done = 0;
+                stages[i].state = C_EFI_PIPELINE_STATE_BUSY;
+                stages[i].pass_ns = 0;
+                stages[i].stats = (CEfiPipelineStats){ 0 };
+                if (!stages[i].depth)
+                        stages[i].depth = 1;
+        }
+
+        p->stages = stages;
+        p->n_stages = n_stages;
+        p->offset = 0;
+        p->eof = C_EFI_FALSE;
+        p->idle = C_EFI_FALSE;
+        p->status = C_EFI_NOT_READY;
+        p->n_passes = 0;
+        p->n_waits = 0;
+        p->wait_ns = 0;
+        p->total_ns = 0;
+        p->last_ns = c_efi_pipeline_now(p);
+        return C_EFI_SUCCESS;
+}
+
+/* number of buffers available to stage @k, started or not */
+static inline CEfiU64 c_efi_pipeline_input(CEfiPipeline *p, CEfiUSize k) {
+        if (k)
+                return p->stages[k - 1].n_done;
+        if (p->eof)
+                return p->stages[0].n_started;
+        return p->stages[p->n_stages - 1].n_done + p->n_buffers;
+}
+
+/* what stage @k waits for, if it cannot start another buffer */
+static inline unsigned int c_efi_pipeline_state(CEfiPipeline *p, CEfiUSize k) {
+        CEfiPipelineStage *s = &p->stages[k];
+
+        if (s->n_started - s->n_done >= s->depth)
+                return C_EFI_PIPELINE_STATE_PENDING;
+        if (s->n_started < c_efi_pipeline_input(p, k))
+                return C_EFI_PIPELINE_STATE_BUSY;
+        if (s->n_done < s->n_started)
+                return C_EFI_PIPELINE_STATE_PENDING;
+        if (k ? p->stages[k - 1].state == C_EFI_PIPELINE_STATE_ENDED : p->eof)
+                return C_EFI_PIPELINE_STATE_ENDED;
+        return k ? C_EFI_PIPELINE_STATE_STARVED : C_EFI_PIPELINE_STATE_BLOCKED;
+}
+
+/* retire completed buffers of stage @k, and start new ones */
+static inline CEfiStatus c_efi_pipeline_step(CEfiPipeline *p, CEfiUSize k, CEfiBool *progressp) {
+        CEfiPipelineStage *s = &p->stages[k];
+        unsigned int state = s->state;
+        CEfiBool started = C_EFI_FALSE;
+        CEfiPipelineBuffer *b;
+        CEfiStatus r;
+
+        /*
+         * Synchronous stages start a single buffer per pass. Starts of
+         * asynchronous stages only submit requests, so they fill all room.
+         */
+        for (;;) {
+                while (s->n_done < s->n_started) {
+                        b = &p->buffers[s->n_done % p->n_buffers];
+                        if (s->poll) {
+                                r = c_efi_pipeline_call(p, s, s->poll, b);
+                                if (r == C_EFI_NOT_READY)
+                                        break;
+                                if (C_EFI_ERROR(r))
+                                        return r;
+                        }
+                        c_efi_pipeline_retire(s, b);
+                        *progressp = C_EFI_TRUE;
+                }
+
+                /* the time until the next pass is spent waiting for this */
+                s->state = c_efi_pipeline_state(p, k);
+                if (s->state != C_EFI_PIPELINE_STATE_BUSY || started)
+                        break;
+
+                b = &p->buffers[s->n_started % p->n_buffers];
+                if (!k) {
+                        b->size = 0;
+                        b->offset = p->offset;
+                        b->index = s->n_started;
+                }
+
+                r = c_efi_pipeline_call(p, s, s->start, b);
+                if (!k && r == C_EFI_END_OF_FILE) {
+                        p->eof = C_EFI_TRUE;
+                        continue;
+                }
+                if (r == C_EFI_NOT_READY) {
+                        s->state = C_EFI_PIPELINE_STATE_PENDING;
+                        break;
+                }
+                if (C_EFI_ERROR(r))
+                        return r;
+
+                if (!k)
+                        p->offset += b->size;
+                ++s->n_started;
+                started = !s->poll;
+                *progressp = C_EFI_TRUE;
+        }
+
+        if (s->state == C_EFI_PIPELINE_STATE_ENDED && state != C_EFI_PIPELINE_STATE_ENDED)
+                *progressp = C_EFI_TRUE;
+        return C_EFI_SUCCESS;
+}
+
+/* attribute the time since the last pass to the state of each stage */
+static inline void c_efi_pipeline_account(CEfiPipeline *p) {
+        CEfiPipelineStage *s;
+        CEfiU64 now, dt, idle, held;
+        CEfiUSize k;
+
+        now = c_efi_pipeline_now(p);
+        dt = now - p->last_ns;
+        p->last_ns = now;
+        p->total_ns += dt;
+
+        for (k = 0; k < p->n_stages; ++k) {
+                s = &p->stages[k];
+                idle = dt > s->pass_ns ? dt - s->pass_ns : 0;
+                s->stats.busy_ns += s->pass_ns;
+                s->pass_ns = 0;
+
+                switch (s->state) {
+                case C_EFI_PIPELINE_STATE_PENDING:
+                        s->stats.pending_ns += idle;
+                        break;
+                case C_EFI_PIPELINE_STATE_STARVED:
+                        s->stats.starved_ns += idle;
+                        ++s->stats.n_stalls;
+                        break;
+                case C_EFI_PIPELINE_STATE_BLOCKED:
+                        s->stats.blocked_ns += idle;
+                        ++s->stats.n_stalls;
+                        break;
+                }
+
+                held = (k ? p->stages[k - 1].n_done : s->n_started) - s->n_done;
+                if (held > s->stats.max_occupancy)
+                        s->stats.max_occupancy = held;
+                s->stats.occupancy_ns += held * dt;
+        }
+}
+
+/**
+ * c_efi_pipeline_poll() - Run a single pass
+ * @p:                  pipeline to run
+ *
+ * This retires completed buffers and starts new ones, without waiting. If
+ * the pass made no progress, `idle` is set, and the caller should wait for
+ * the `wake` event before the next pass. At the end of the stream, the
+ * `finish` callbacks run from the producer to the sink.
+ *
+ * Return: C_EFI_SUCCESS once the stream completed, C_EFI_NOT_READY if it
+ *         continues, or the error of a stage, which ends the stream.
+ */
+static inline CEfiStatus c_efi_pipeline_poll(CEfiPipeline *p) {
+        CEfiBool progress = C_EFI_FALSE;
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiUSize k;
+
+        if (p->status != C_EFI_NOT_READY)
+                return p->status;
+
+        ++p->n_passes;
+        for (k = p->n_stages; k-- > 0 && !C_EFI_ERROR(r); )
+                r = c_efi_pipeline_step(p, k, &progress);
+        c_efi_pipeline_account(p);
+
+        if (!C_EFI_ERROR(r) && p->stages[p->n_stages - 1].state == C_EFI_PIPELINE_STATE_ENDED) {
+                for (k = 0; k < p->n_stages && !C_EFI_ERROR(r); ++k)
+                        if (p->stages[k].finish)
+                                r = p->stages[k].finish(&p->stages[k], C_EFI_NULL);
+                p->status = r;
+                return r;
+        }
+
+        if (C_EFI_ERROR(r)) {
+                p->status = r;
+                return r;
+        }
+
+        p->idle = !progress;
+        return C_EFI_NOT_READY;
+}
+
+/**
+ * c_efi_pipeline_run() - Run a stream to completion
+ * @p:                  pipeline to run
+ *
+ * This runs passes until the stream ends, and waits for the wake event
+ * whenever a pass made no progress.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of a stage or of
+ *         `wait_for_event`.
+ */
+static inline CEfiStatus c_efi_pipeline_run(CEfiPipeline *p) {
+        CEfiUSize index;
+        CEfiU64 start;
+        CEfiStatus r;
+
+        for (;;) {
+                r = c_efi_pipeline_poll(p);
+                if (r != C_EFI_NOT_READY)
+                        return r;
+                if (!p->idle)
+                        continue;
+
+                start = c_efi_pipeline_now(p);
+                ++p->n_waits;
+                r = p->bs->wait_for_event(1, &p->wake, &index);
+                if (C_EFI_ERROR(r)) {
+                        p->status = r;
+                        return r;
+                }
+                p->wait_ns += c_efi_pipeline_now(p) - start;
+        }
+}
+
+/**
+ * c_efi_pipeline_bottleneck() - Find the bottleneck
+ * @p:                  pipeline to query
+ *
+ * The bottleneck is the stage that was busy, or had buffers in flight, for
+ * the longest time. This needs a clock.
+ *
+ * Return: Index of the bottleneck stage.
+ */
+static inline CEfiUSize c_efi_pipeline_bottleneck(CEfiPipeline *p) {
+        CEfiU64 t, max = 0;
+        CEfiUSize k, index = 0;
+
+        for (k = 0; k < p->n_stages; ++k) {
+                t = p->stages[k].stats.busy_ns + p->stages[k].stats.pending_ns;
+                if (t > max) {
+                        max = t;
+                        index = k;
+                }
+        }
+
+        return index;
+}
+
+/**
+ * CEfiPipelineBlockReader: Block I/O 2 Producer
+ * @bio:                block device
+ * @media_id:           media ID at initialization
+ * @block_size:         block size of the media
+ * @lba:                first block of the stream
+ * @size:               size of the stream in bytes
+ * @offset:             offset of the next request
+ * @slots:              request slots, one per buffer in flight
+ * @n_slots:            number of request slots
+ */
+typedef struct CEfiPipelineBlockReader {
+        CEfiBlockIo2Protocol *bio;
+        CEfiU32 media_id;
+        CEfiU32 block_size;
+        CEfiLba lba;
+        CEfiU64 size;
+        CEfiU64 offset;
+        CEfiBlockQueueSlot *slots;
+        CEfiUSize n_slots;
+} CEfiPipelineBlockReader;
+
+/**
+ * c_efi_pipeline_block_reader_deinit() - Deinitialize block reader
+ * @reader:             reader to deinitialize
+ * @p:                  pipeline the reader was initialized for
+ *
+ * This closes the events of all slots. The pipeline must be drained first.
+ */
+static inline void c_efi_pipeline_block_reader_deinit(CEfiPipelineBlockReader *reader, CEfiPipeline *p) {
+        c_efi_block_queue_slots_deinit(reader->slots, reader->n_slots);
+        reader->n_slots = 0;
+}
+
+/**
+ * c_efi_pipeline_block_reader_init() - Initialize block reader
+ * @reader:             reader to initialize
+ * @p:                  pipeline to read into
+ * @bio:                block device to read from
+ * @slots:              storage for the request slots
+ * @n_slots:            number of entries in @slots, the queue depth
+ * @lba:                first block of the stream
+ * @size:               size of the stream in bytes
+ *
+ * The stream is read with one request per buffer. This initializes @slots
+ * with c_efi_block_queue_slots_init(), so completions signal the wake event
+ * of @p.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_slots
+ *         is 0 or @size is not a multiple of the block size,
+ *         C_EFI_NO_MEDIA if no media is present, C_EFI_UNSUPPORTED if the
+ *         buffers do not suit the geometry of the media, or the error of
+ *         `create_event`.
+ */
+static inline CEfiStatus c_efi_pipeline_block_reader_init(CEfiPipelineBlockReader *reader,
+                                                          CEfiPipeline *p,
+                                                          CEfiBlockIo2Protocol *bio,
+                                                          CEfiBlockQueueSlot *slots,
+                                                          CEfiUSize n_slots,
+                                                          CEfiLba lba,
+                                                          CEfiU64 size) {
+        CEfiBlockIoMedia *media = bio->media;
+        CEfiStatus r;
+
+        *reader = (CEfiPipelineBlockReader){ .bio = bio, .lba = lba, .size = size, .slots = slots };
+
+        if (!media->media_present)
+                return C_EFI_NO_MEDIA;
+        if (!media->block_size || p->buffer_size % media->block_size || media->io_align > 4096 ||
+            (media->io_align & (media->io_align - 1)))
+                return C_EFI_UNSUPPORTED;
+        if (!n_slots || size % media->block_size)
+                return C_EFI_INVALID_PARAMETER;
+
+        reader->media_id = media->media_id;
+        reader->block_size = media->block_size;
+
+        r = c_efi_block_queue_slots_init(slots, n_slots, p->bs, p->wake);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        reader->n_slots = n_slots;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_pipeline_block_reader_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiPipelineBlockReader *reader = stage->userdata;
+        CEfiBlockQueueSlot *slot = &reader->slots[buffer->index % reader->n_slots];
+        CEfiU64 n;
+        CEfiStatus r;
+
+        if (reader->offset == reader->size)
+                return C_EFI_END_OF_FILE;
+
+        n = reader->size - reader->offset;
+        if (n > stage->pipeline->buffer_size)
+                n = stage->pipeline->buffer_size;
+
+        r = c_efi_block_queue_slot_submit(slot,
+                                          reader->bio,
+                                          reader->media_id,
+                                          reader->lba + reader->offset / reader->block_size,
+                                          buffer->data,
+                                          n);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        buffer->size = n;
+        reader->offset += n;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_pipeline_block_reader_poll(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiPipelineBlockReader *reader = stage->userdata;
+        CEfiBlockQueueSlot *slot = &reader->slots[buffer->index % reader->n_slots];
+
+        return slot->done ? slot->token.transaction_status : C_EFI_NOT_READY;
+}
+
+/**
+ * c_efi_pipeline_block_reader_stage() - Describe block reader stage
+ * @reader:             initialized reader
+ *
+ * This rewinds @reader, so a reader can serve several streams.
+ *
+ * Return: A producer stage, which keeps one request per slot in flight.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_block_reader_stage(CEfiPipelineBlockReader *reader) {
+        reader->offset = 0;
+
+        return (CEfiPipelineStage){
+                .start = c_efi_pipeline_block_reader_start,
+                .poll = c_efi_pipeline_block_reader_poll,
+                .userdata = reader,
+                .depth = reader->n_slots,
+        };
+}
+
+static inline CEfiStatus c_efi_pipeline_file_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiStatus r;
+
+        r = c_efi_file_reader_read(stage->userdata, buffer->data, stage->pipeline->buffer_size, &buffer->size);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        return buffer->size ? C_EFI_SUCCESS : C_EFI_END_OF_FILE;
+}
+
+/**
+ * c_efi_pipeline_file_stage() - Describe file reader stage
+ * @reader:             reader to read the stream from
+ *
+ * Return: A synchronous producer stage, which reads until the end of file.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_file_stage(CEfiFileReader *reader) {
+        return (CEfiPipelineStage){ .start = c_efi_pipeline_file_start, .userdata = reader };
+}
+
+/**
+ * CEfiPipelineSha256: SHA-256 Verification Stage
+ * @sha:                hash state
+ * @expected:           expected digest, or NULL to only compute it
+ * @digest:             digest of the stream, once it ended
+ */
+typedef struct CEfiPipelineSha256 {
+        CEfiSha256 sha;
+        const CEfiU8 *expected;
+        CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE];
+} CEfiPipelineSha256;
+
+static inline CEfiStatus c_efi_pipeline_sha256_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiPipelineSha256 *h = stage->userdata;
+
+        c_efi_sha256_update(&h->sha, buffer->data, buffer->size);
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_pipeline_sha256_finish(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiPipelineSha256 *h = stage->userdata;
+
+        c_efi_sha256_final(&h->sha, h->digest);
+        if (h->expected && c_efi_memcmp(h->digest, h->expected, sizeof(h->digest)))
+                return C_EFI_SECURITY_VIOLATION;
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_pipeline_sha256_stage() - Describe SHA-256 verification stage
+ * @h:                  stage state to initialize
+ * @expected:           expected digest, or NULL to only compute it
+ *
+ * The stage hashes every buffer. At the end of the stream, it fails the
+ * pipeline with C_EFI_SECURITY_VIOLATION if the digest does not match.
+ *
+ * Return: A synchronous stage.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_sha256_stage(CEfiPipelineSha256 *h, const CEfiU8 *expected) {
+        c_efi_sha256_init(&h->sha);
+        h->expected = expected;
+
+        return (CEfiPipelineStage){
+                .start = c_efi_pipeline_sha256_start,
+                .finish = c_efi_pipeline_sha256_finish,
+                .userdata = h,
+        };
+}
+
+static inline CEfiStatus c_efi_pipeline_lz4_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiUSize used;
+
+        return c_efi_lz4_decode(stage->userdata, buffer->data, buffer->size, &used);
+}
+
+static inline CEfiStatus c_efi_pipeline_lz4_finish(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        return c_efi_lz4_done(stage->userdata) ? C_EFI_SUCCESS : C_EFI_COMPROMISED_DATA;
+}
+
+/**
+ * c_efi_pipeline_lz4_stage() - Describe LZ4 decompression sink
+ * @dec:                decoder, whose window is the final destination
+ *
+ * The window of @dec must hold the whole output, as the stage never
+ * releases it. A full window fails the pipeline with
+ * C_EFI_BUFFER_TOO_SMALL, a truncated stream with C_EFI_COMPROMISED_DATA.
+ *
+ * Return: A synchronous stage.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_lz4_stage(CEfiLz4 *dec) {
+        return (CEfiPipelineStage){
+                .start = c_efi_pipeline_lz4_start,
+                .finish = c_efi_pipeline_lz4_finish,
+                .userdata = dec,
+        };
+}
+
+static inline CEfiStatus c_efi_pipeline_zstd_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiUSize used;
+
+        return c_efi_zstd_decode(stage->userdata, buffer->data, buffer->size, &used);
+}
+
+static inline CEfiStatus c_efi_pipeline_zstd_finish(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        return c_efi_zstd_done(stage->userdata) ? C_EFI_SUCCESS : C_EFI_COMPROMISED_DATA;
+}
+
+/**
+ * c_efi_pipeline_zstd_stage() - Describe zstd decompression sink
+ * @dec:                decoder, whose window is the final destination
+ *
+ * This behaves like c_efi_pipeline_lz4_stage(), for zstd streams.
+ *
+ * Return: A synchronous stage.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_zstd_stage(CEfiZstd *dec) {
+        return (CEfiPipelineStage){
+                .start = c_efi_pipeline_zstd_start,
+                .finish = c_efi_pipeline_zstd_finish,
+                .userdata = dec,
+        };
+}
+
+/**
+ * CEfiPipelineCopy: Copy Sink
+ * @dst:                final destination of the stream
+ * @n_dst:              size of @dst in bytes
+ */
+typedef struct CEfiPipelineCopy {
+        void *dst;
+        CEfiUSize n_dst;
+} CEfiPipelineCopy;
+
+static inline CEfiStatus c_efi_pipeline_copy_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiPipelineCopy *c = stage->userdata;
+
+        if (buffer->offset > c->n_dst || buffer->size > c->n_dst - buffer->offset)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        c_efi_memcpy((CEfiU8 *)c->dst + buffer->offset, buffer->data, buffer->size);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_pipeline_copy_stage() - Describe copy sink
+ * @c:                  destination of the stream
+ *
+ * The stage copies every buffer to its offset in the destination. A stream
+ * that exceeds the destination fails the pipeline with
+ * C_EFI_BUFFER_TOO_SMALL.
+ *
+ * Return: A synchronous stage.
+ */
+static inline CEfiPipelineStage c_efi_pipeline_copy_stage(CEfiPipelineCopy *c) {
+        return (CEfiPipelineStage){ .start = c_efi_pipeline_copy_start, .userdata = c };
+}
+
+#ifdef __cplusplus
+}
+#endif
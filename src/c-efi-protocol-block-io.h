@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * UEFI Protocol - Block I/O
+ *
+ * XXX
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+typedef struct CEfiBlockIoProtocol CEfiBlockIoProtocol;
+
+#define C_EFI_BLOCK_IO_PROTOCOL_GUID C_EFI_GUID(0x964e5b21, 0x6459, 0x11d2, 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b)
+
+#define C_EFI_BLOCK_IO_PROTOCOL_REVISION C_EFI_U64_C(0x00010000)
+#define C_EFI_BLOCK_IO_PROTOCOL_REVISION2 C_EFI_U64_C(0x00020001)
+#define C_EFI_BLOCK_IO_PROTOCOL_REVISION3 C_EFI_U64_C(0x0002001f)
+
+typedef struct CEfiBlockIoMedia {
+        CEfiU32 media_id;
+        CEfiBool removable_media;
+        CEfiBool media_present;
+        CEfiBool logical_partition;
+        CEfiBool read_only;
+        CEfiBool write_caching;
+        CEfiU32 block_size;
+        CEfiU32 io_align;
+        CEfiLba last_block;
+
+        /* available since C_EFI_BLOCK_IO_PROTOCOL_REVISION2 */
+        CEfiLba lowest_aligned_lba;
+        CEfiU32 logical_blocks_per_physical_block;
+
+        /* available since C_EFI_BLOCK_IO_PROTOCOL_REVISION3 */
+        CEfiU32 optimal_transfer_length_granularity;
+} CEfiBlockIoMedia;
+
+typedef struct CEfiBlockIoProtocol {
+        CEfiU64 revision;
+        CEfiBlockIoMedia *media;
+
+        CEfiStatus (CEFICALL *reset) (
+                CEfiBlockIoProtocol *this_,
+                CEfiBool extended_verification
+        );
+        CEfiStatus (CEFICALL *read_blocks) (
+                CEfiBlockIoProtocol *this_,
+                CEfiU32 media_id,
+                CEfiLba lba,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *write_blocks) (
+                CEfiBlockIoProtocol *this_,
+                CEfiU32 media_id,
+                CEfiLba lba,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *flush_blocks) (
+                CEfiBlockIoProtocol *this_
+        );
+} CEfiBlockIoProtocol;
+
+#ifdef __cplusplus
+}
+#endif
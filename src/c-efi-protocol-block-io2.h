@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * UEFI Protocol - Block I/O 2
+ *
+ * XXX
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-protocol-block-io.h>
+
+typedef struct CEfiBlockIo2Protocol CEfiBlockIo2Protocol;
+
+#define C_EFI_BLOCK_IO2_PROTOCOL_GUID C_EFI_GUID(0xa77b2472, 0xe282, 0x4e9f, 0xa2, 0x45, 0xc2, 0xc0, 0xe2, 0x7b, 0xbc, 0xc1)
+
+typedef struct CEfiBlockIo2Token {
+        CEfiEvent event;
+        CEfiStatus transaction_status;
+} CEfiBlockIo2Token;
+
+typedef struct CEfiBlockIo2Protocol {
+        CEfiBlockIoMedia *media;
+
+        CEfiStatus (CEFICALL *reset) (
+                CEfiBlockIo2Protocol *this_,
+                CEfiBool extended_verification
+        );
+        CEfiStatus (CEFICALL *read_blocks_ex) (
+                CEfiBlockIo2Protocol *this_,
+                CEfiU32 media_id,
+                CEfiLba lba,
+                CEfiBlockIo2Token *token,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *write_blocks_ex) (
+                CEfiBlockIo2Protocol *this_,
+                CEfiU32 media_id,
+                CEfiLba lba,
+                CEfiBlockIo2Token *token,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *flush_blocks_ex) (
+                CEfiBlockIo2Protocol *this_,
+                CEfiBlockIo2Token *token
+        );
+} CEfiBlockIo2Protocol;
+
+#ifdef __cplusplus
+}
+#endif
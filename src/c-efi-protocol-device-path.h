@@ -57,6 +57,46 @@ typedef struct CEfiDevicePathProtocol {
 #define C_EFI_DEVICE_PATH_SUBTYPE_HARDWARE_CONTROLLER           C_EFI_U8_C(0x05)
 #define C_EFI_DEVICE_PATH_SUBTYPE_HARDWARE_BMC                  C_EFI_U8_C(0x06)
 
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_HARD_DRIVE              C_EFI_U8_C(0x01)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_CDROM                   C_EFI_U8_C(0x02)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_VENDOR                  C_EFI_U8_C(0x03)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_FILE_PATH               C_EFI_U8_C(0x04)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_PROTOCOL                C_EFI_U8_C(0x05)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_PIWG_FIRMWARE_FILE      C_EFI_U8_C(0x06)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_PIWG_FIRMWARE_VOLUME    C_EFI_U8_C(0x07)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_RELATIVE_OFFSET         C_EFI_U8_C(0x08)
+#define C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_RAM_DISK                C_EFI_U8_C(0x09)
+
+#define C_EFI_HARD_DRIVE_PARTITION_FORMAT_MBR                   C_EFI_U8_C(0x01)
+#define C_EFI_HARD_DRIVE_PARTITION_FORMAT_GPT                   C_EFI_U8_C(0x02)
+
+#define C_EFI_HARD_DRIVE_SIGNATURE_TYPE_NONE                    C_EFI_U8_C(0x00)
+#define C_EFI_HARD_DRIVE_SIGNATURE_TYPE_MBR                     C_EFI_U8_C(0x01)
+#define C_EFI_HARD_DRIVE_SIGNATURE_TYPE_GUID                    C_EFI_U8_C(0x02)
+
+/**
+ * CEfiDevicePathHardDrive: Hard Drive Media Device Path
+ * @header:             device node header
+ * @partition_number:   1-based entry number in the partition table
+ * @partition_start:    first block of the partition
+ * @partition_size:     size of the partition in blocks
+ * @partition_signature: unique partition GUID, or MBR disk signature
+ * @partition_format:   partition table format
+ * @signature_type:     type of @partition_signature
+ *
+ * Like all device nodes, this is unaligned, so all multi-byte fields are
+ * stored as little-endian byte arrays.
+ */
+typedef struct CEfiDevicePathHardDrive {
+        CEfiDevicePathProtocol header;
+        CEfiU8 partition_number[4];
+        CEfiU8 partition_start[8];
+        CEfiU8 partition_size[8];
+        CEfiU8 partition_signature[16];
+        CEfiU8 partition_format;
+        CEfiU8 signature_type;
+} CEfiDevicePathHardDrive;
+
 #define C_EFI_DEVICE_PATH_NULL {                                                \
                 .type           = C_EFI_DEVICE_PATH_TYPE_END,                   \
                 .subtype        = C_EFI_DEVICE_PATH_SUBTYPE_END_ALL,            \
@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * UEFI Protocol - Disk I/O
+ *
+ * XXX
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+typedef struct CEfiDiskIoProtocol CEfiDiskIoProtocol;
+
+#define C_EFI_DISK_IO_PROTOCOL_GUID C_EFI_GUID(0xce345171, 0xba0b, 0x11d2, 0x8e, 0x4f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b)
+
+#define C_EFI_DISK_IO_PROTOCOL_REVISION C_EFI_U64_C(0x00010000)
+
+typedef struct CEfiDiskIoProtocol {
+        CEfiU64 revision;
+
+        CEfiStatus (CEFICALL *read_disk) (
+                CEfiDiskIoProtocol *this_,
+                CEfiU32 media_id,
+                CEfiU64 offset,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *write_disk) (
+                CEfiDiskIoProtocol *this_,
+                CEfiU32 media_id,
+                CEfiU64 offset,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+} CEfiDiskIoProtocol;
+
+#ifdef __cplusplus
+}
+#endif
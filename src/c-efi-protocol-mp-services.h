@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+ * UEFI Protocol - MP Services
+ *
+ * The MP Services Protocol of the Platform Initialization Specification
+ * provides access to the application processors (APs) of the system, until
+ * `exit_boot_services`. Only the bootstrap processor (BSP) may call its
+ * functions, except for `whoami`. Procedures running on APs must not call
+ * any UEFI services.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+typedef struct CEfiMpServicesProtocol CEfiMpServicesProtocol;
+
+#define C_EFI_MP_SERVICES_PROTOCOL_GUID C_EFI_GUID(0x3fdda605, 0xa76e, 0x4f46, 0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08)
+
+#define C_EFI_PROCESSOR_AS_BSP_BIT C_EFI_U32_C(0x00000001)
+#define C_EFI_PROCESSOR_ENABLED_BIT C_EFI_U32_C(0x00000002)
+#define C_EFI_PROCESSOR_HEALTH_STATUS_BIT C_EFI_U32_C(0x00000004)
+
+#define C_EFI_END_OF_CPU_LIST ((CEfiUSize)0xffffffff)
+
+#define C_EFI_CPU_V2_EXTENDED_TOPOLOGY ((CEfiUSize)1 << 24)
+
+typedef void (CEFICALL *CEfiApProcedure) (void *buffer);
+
+typedef struct CEfiCpuPhysicalLocation {
+        CEfiU32 package;
+        CEfiU32 core;
+        CEfiU32 thread;
+} CEfiCpuPhysicalLocation;
+
+typedef struct CEfiCpuPhysicalLocation2 {
+        CEfiU32 package;
+        CEfiU32 die;
+        CEfiU32 tile;
+        CEfiU32 module;
+        CEfiU32 core;
+        CEfiU32 thread;
+} CEfiCpuPhysicalLocation2;
+
+typedef union CEfiExtendedProcessorInformation {
+        CEfiCpuPhysicalLocation2 location2;
+} CEfiExtendedProcessorInformation;
+
+typedef struct CEfiProcessorInformation {
+        CEfiU64 processor_id;
+        CEfiU32 status_flag;
+        CEfiCpuPhysicalLocation location;
+
+        /* only filled in if C_EFI_CPU_V2_EXTENDED_TOPOLOGY is requested */
+        CEfiExtendedProcessorInformation extended_information;
+} CEfiProcessorInformation;
+
+typedef struct CEfiMpServicesProtocol {
+        CEfiStatus (CEFICALL *get_number_of_processors) (
+                CEfiMpServicesProtocol *this_,
+                CEfiUSize *number_of_processors,
+                CEfiUSize *number_of_enabled_processors
+        );
+        CEfiStatus (CEFICALL *get_processor_info) (
+                CEfiMpServicesProtocol *this_,
+                CEfiUSize processor_number,
+                CEfiProcessorInformation *processor_info_buffer
+        );
+        CEfiStatus (CEFICALL *startup_all_aps) (
+                CEfiMpServicesProtocol *this_,
+                CEfiApProcedure procedure,
+                CEfiBool single_thread,
+                CEfiEvent wait_event,
+                CEfiUSize timeout_in_micro_seconds,
+                void *procedure_argument,
+                CEfiUSize **failed_cpu_list
+        );
+        CEfiStatus (CEFICALL *startup_this_ap) (
+                CEfiMpServicesProtocol *this_,
+                CEfiApProcedure procedure,
+                CEfiUSize processor_number,
+                CEfiEvent wait_event,
+                CEfiUSize timeout_in_micro_seconds,
+                void *procedure_argument,
+                CEfiBool *finished
+        );
+        CEfiStatus (CEFICALL *switch_bsp) (
+                CEfiMpServicesProtocol *this_,
+                CEfiUSize processor_number,
+                CEfiBool enable_old_bsp
+        );
+        CEfiStatus (CEFICALL *enable_disable_ap) (
+                CEfiMpServicesProtocol *this_,
+                CEfiUSize processor_number,
+                CEfiBool enable_ap,
+                CEfiU32 *health_flag
+        );
+        CEfiStatus (CEFICALL *whoami) (
+                CEfiMpServicesProtocol *this_,
+                CEfiUSize *processor_number
+        );
+} CEfiMpServicesProtocol;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+
+/**
+ * UEFI Protocol - Simple File System
+ *
+ * XXX
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+typedef struct CEfiSimpleFileSystemProtocol CEfiSimpleFileSystemProtocol;
+typedef struct CEfiFileProtocol CEfiFileProtocol;
+
+#define C_EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID C_EFI_GUID(0x964e5b22, 0x6459, 0x11d2, 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b)
+
+#define C_EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION C_EFI_U64_C(0x00010000)
+
+typedef struct CEfiSimpleFileSystemProtocol {
+        CEfiU64 revision;
+
+        CEfiStatus (CEFICALL *open_volume) (
+                CEfiSimpleFileSystemProtocol *this_,
+                CEfiFileProtocol **root
+        );
+} CEfiSimpleFileSystemProtocol;
+
+#define C_EFI_FILE_PROTOCOL_REVISION C_EFI_U64_C(0x00010000)
+#define C_EFI_FILE_PROTOCOL_REVISION2 C_EFI_U64_C(0x00020000)
+#define C_EFI_FILE_PROTOCOL_LATEST_REVISION C_EFI_FILE_PROTOCOL_REVISION2
+
+#define C_EFI_FILE_MODE_READ            C_EFI_U64_C(0x0000000000000001)
+#define C_EFI_FILE_MODE_WRITE           C_EFI_U64_C(0x0000000000000002)
+#define C_EFI_FILE_MODE_CREATE          C_EFI_U64_C(0x8000000000000000)
+
+#define C_EFI_FILE_READ_ONLY            C_EFI_U64_C(0x0000000000000001)
+#define C_EFI_FILE_HIDDEN               C_EFI_U64_C(0x0000000000000002)
+#define C_EFI_FILE_SYSTEM               C_EFI_U64_C(0x0000000000000004)
+#define C_EFI_FILE_RESERVED             C_EFI_U64_C(0x0000000000000008)
+#define C_EFI_FILE_DIRECTORY            C_EFI_U64_C(0x0000000000000010)
+#define C_EFI_FILE_ARCHIVE              C_EFI_U64_C(0x0000000000000020)
+#define C_EFI_FILE_VALID_ATTR           C_EFI_U64_C(0x0000000000000037)
+
+typedef struct CEfiFileIoToken {
+        CEfiEvent event;
+        CEfiStatus status;
+        CEfiUSize buffer_size;
+        void *buffer;
+} CEfiFileIoToken;
+
+typedef struct CEfiFileProtocol {
+        CEfiU64 revision;
+
+        CEfiStatus (CEFICALL *open) (
+                CEfiFileProtocol *this_,
+                CEfiFileProtocol **new_handle,
+                CEfiChar16 *file_name,
+                CEfiU64 open_mode,
+                CEfiU64 attributes
+        );
+        CEfiStatus (CEFICALL *close) (
+                CEfiFileProtocol *this_
+        );
+        CEfiStatus (CEFICALL *delete_) (
+                CEfiFileProtocol *this_
+        );
+        CEfiStatus (CEFICALL *read) (
+                CEfiFileProtocol *this_,
+                CEfiUSize *buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *write) (
+                CEfiFileProtocol *this_,
+                CEfiUSize *buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *get_position) (
+                CEfiFileProtocol *this_,
+                CEfiU64 *position
+        );
+        CEfiStatus (CEFICALL *set_position) (
+                CEfiFileProtocol *this_,
+                CEfiU64 position
+        );
+        CEfiStatus (CEFICALL *get_info) (
+                CEfiFileProtocol *this_,
+                CEfiGuid *information_type,
+                CEfiUSize *buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *set_info) (
+                CEfiFileProtocol *this_,
+                CEfiGuid *information_type,
+                CEfiUSize buffer_size,
+                void *buffer
+        );
+        CEfiStatus (CEFICALL *flush) (
+                CEfiFileProtocol *this_
+        );
+
+        /* available since C_EFI_FILE_PROTOCOL_REVISION2 */
+        CEfiStatus (CEFICALL *open_ex) (
+                CEfiFileProtocol *this_,
+                CEfiFileProtocol **new_handle,
+                CEfiChar16 *file_name,
+                CEfiU64 open_mode,
+                CEfiU64 attributes,
+                CEfiFileIoToken *token
+        );
+        CEfiStatus (CEFICALL *read_ex) (
+                CEfiFileProtocol *this_,
+                CEfiFileIoToken *token
+        );
+        CEfiStatus (CEFICALL *write_ex) (
+                CEfiFileProtocol *this_,
+                CEfiFileIoToken *token
+        );
+        CEfiStatus (CEFICALL *flush_ex) (
+                CEfiFileProtocol *this_,
+                CEfiFileIoToken *token
+        );
+} CEfiFileProtocol;
+
+#define C_EFI_FILE_INFO_ID C_EFI_GUID(0x09576e92, 0x6d3f, 0x11d2, 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b)
+
+typedef struct CEfiFileInfo {
+        CEfiU64 size;
+        CEfiU64 file_size;
+        CEfiU64 physical_size;
+        CEfiTime create_time;
+        CEfiTime last_access_time;
+        CEfiTime modification_time;
+        CEfiU64 attribute;
+        CEfiChar16 file_name[];
+} CEfiFileInfo;
+
+#define C_EFI_FILE_SYSTEM_INFO_ID C_EFI_GUID(0x09576e93, 0x6d3f, 0x11d2, 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b)
+
+typedef struct CEfiFileSystemInfo {
+        CEfiU64 size;
+        CEfiBool read_only;
+        CEfiU64 volume_size;
+        CEfiU64 free_space;
+        CEfiU32 block_size;
+        CEfiChar16 volume_label[];
+} CEfiFileSystemInfo;
+
+/* the information is just the NUL-terminated volume label */
+#define C_EFI_FILE_SYSTEM_VOLUME_LABEL_ID C_EFI_GUID(0xdb47d7d3, 0xfe81, 0x11d3, 0x9a, 0x35, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d)
+
+#ifdef __cplusplus
+}
+#endif
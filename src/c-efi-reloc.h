@@ -0,0 +1,350 @@
+#pragma once
+
+/**
+ * Runtime Pointer Relocation
+ *
+ * When the operating system calls `set_virtual_address_map`, runtime drivers
+ * are notified via C_EFI_EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE and must convert
+ * every pointer they keep into runtime memory. The `convert_pointer` runtime
+ * service does this one pointer per indirect call, each doing a linear search
+ * of the memory map in most firmware.
+ *
+ * This header provides a registry of pointer slots, which drivers fill at
+ * initialization. On the address change, all slots are relocated in a single
+ * pass: the runtime descriptors of the virtual map are sorted once, and every
+ * slot is looked up via binary search, with a shortcut for slots pointing into
+ * the same region as their predecessor. Slots that are not covered by the map
+ * are passed to `convert_pointer` as fallback.
+ *
+ * Notification functions are not passed the virtual map. It is captured by
+ * hooking `set_virtual_address_map` in the runtime services table, see
+ * c_efi_reloc_hook(), or handed in explicitly by whoever calls it, see
+ * c_efi_reloc_set_map(). Without a map, every slot takes the fallback.
+ * `set_virtual_address_map` takes no context, so the hook keeps its state in
+ * static variables, of which every translation unit including this header
+ * has its own copy.
+ *
+ * No allocations are performed. The registry and its arrays must be allocated
+ * by the caller from runtime memory, since they are accessed during the
+ * address change.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-crc32.h>
+#include <c-efi-memattr.h>
+
+/**
+ * CEfiRelocRegistry: Pointer Relocation Registry
+ * @rt:                 runtime services, for the `convert_pointer` fallback
+ * @slots:              registered pointer slots
+ * @n_slots:            number of entries in @slots
+ * @n_slots_max:        number of entries @slots has room for
+ * @ranges:             sorted runtime ranges of the virtual map
+ * @deltas:             offset of the virtual address of each entry of
+ *                      @ranges, modulo 2^64
+ * @n_ranges:           number of entries in @ranges, 0 if no map is known
+ * @n_ranges_max:       number of entries @ranges has room for
+ * @n_fallback:         number of slots converted via the fallback
+ * @status:             result of the last relocation
+ */
+typedef struct CEfiRelocRegistry {
+        CEfiRuntimeServices *rt;
+        void ***slots;
+        CEfiUSize n_slots;
+        CEfiUSize n_slots_max;
+        CEfiMemoryRange *ranges;
+        CEfiU64 *deltas;
+        CEfiUSize n_ranges;
+        CEfiUSize n_ranges_max;
+        CEfiUSize n_fallback;
+        CEfiStatus status;
+} CEfiRelocRegistry;
+
+/**
+ * c_efi_reloc_init() - Initialize relocation registry
+ * @registry:           registry to initialize
+ * @rt:                 runtime services
+ * @slots:              storage for the slot array
+ * @n_slots_max:        number of entries @slots has room for
+ * @ranges:             storage for the range index
+ * @deltas:             storage for the offsets of the range index
+ * @n_ranges_max:       number of entries @ranges and @deltas have room for
+ *
+ * @ranges needs one entry per runtime descriptor of the virtual map. If it is
+ * too small, relocation falls back to `convert_pointer` for all slots.
+ */
+static inline void c_efi_reloc_init(CEfiRelocRegistry *registry,
+                                    CEfiRuntimeServices *rt,
+                                    void ***slots,
+                                    CEfiUSize n_slots_max,
+                                    CEfiMemoryRange *ranges,
+                                    CEfiU64 *deltas,
+                                    CEfiUSize n_ranges_max) {
+        *registry = (CEfiRelocRegistry){
+                .rt = rt,
+                .slots = slots,
+                .n_slots_max = n_slots_max,
+                .ranges = ranges,
+                .deltas = deltas,
+                .n_ranges_max = n_ranges_max,
+                .status = C_EFI_NOT_READY,
+        };
+}
+
+/**
+ * c_efi_reloc_register() - Register pointer slot
+ * @registry:           registry to use
+ * @slot:               address of the pointer to relocate
+ *
+ * This registers @slot for relocation. The pointer stored in @slot is only
+ * read on the address change, so it may be changed freely until then. NULL
+ * pointers are left untouched, like C_EFI_OPTIONAL_POINTER does for
+ * `convert_pointer`. A slot registered more than once is relocated once, but
+ * takes up an entry per registration until then.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_OUT_OF_RESOURCES if the registry
+ *         is full.
+ */
+static inline CEfiStatus c_efi_reloc_register(CEfiRelocRegistry *registry, void **slot) {
+        if (registry->n_slots >= registry->n_slots_max)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        registry->slots[registry->n_slots++] = slot;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_reloc_set_map() - Provide the virtual map
+ * @registry:           registry to use
+ * @memory_map_size:    size of @virtual_map in bytes
+ * @descriptor_size:    stride of @virtual_map in bytes
+ * @virtual_map:        virtual map, as passed to `set_virtual_address_map`
+ *
+ * This builds the sorted index of all runtime descriptors of @virtual_map.
+ * Descriptors without C_EFI_MEMORY_RUNTIME are skipped, since
+ * `convert_pointer` rejects them as well. On error, the index is cleared and
+ * relocation falls back to `convert_pointer`.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if
+ *         @descriptor_size is invalid or descriptors overlap,
+ *         C_EFI_BUFFER_TOO_SMALL if the range index is too small.
+ */
+static inline CEfiStatus c_efi_reloc_set_map(CEfiRelocRegistry *registry,
+                                             CEfiUSize memory_map_size,
+                                             CEfiUSize descriptor_size,
+                                             const CEfiMemoryDescriptor *virtual_map) {
+        CEfiMemoryRange *ranges = registry->ranges, r;
+        CEfiU64 *deltas = registry->deltas, delta;
+        const CEfiMemoryDescriptor *d;
+        CEfiUSize i, j, n = 0;
+
+        registry->n_ranges = 0;
+
+        if (descriptor_size < sizeof(CEfiMemoryDescriptor) || (descriptor_size & 7))
+                return C_EFI_INVALID_PARAMETER;
+
+        for (i = 0; i + descriptor_size <= memory_map_size; i += descriptor_size) {
+                d = (const void *)((const CEfiU8 *)virtual_map + i);
+                if (!(d->attribute & C_EFI_MEMORY_RUNTIME) || !d->number_of_pages)
+                        continue;
+                if (d->number_of_pages > (C_EFI_U64_C(0xffffffffffffffff) >> 12) ||
+                    d->physical_start > C_EFI_U64_C(0xffffffffffffffff) - (d->number_of_pages << 12))
+                        return C_EFI_INVALID_PARAMETER;
+                if (n >= registry->n_ranges_max)
+                        return C_EFI_BUFFER_TOO_SMALL;
+
+                r.start = d->physical_start;
+                r.end = d->physical_start + (d->number_of_pages << 12);
+                r.attribute = d->attribute;
+                r.type = d->type;
+                delta = d->virtual_start - d->physical_start;
+
+                for (j = n; j > 0 && ranges[j - 1].start > r.start; --j) {
+                        ranges[j] = ranges[j - 1];
+                        deltas[j] = deltas[j - 1];
+                }
+                ranges[j] = r;
+                deltas[j] = delta;
+                ++n;
+        }
+
+        for (i = 1; i < n; ++i)
+                if (ranges[i - 1].end > ranges[i].start)
+                        return C_EFI_INVALID_PARAMETER;
+
+        registry->n_ranges = n;
+        return C_EFI_SUCCESS;
+}
+
+/* sift @slots[i] down the max-heap of the first @n slots */
+static inline void c_efi_reloc_sift(void ***slots, CEfiUSize i, CEfiUSize n) {
+        void **t;
+        CEfiUSize c;
+
+        while ((c = 2 * i + 1) < n) {
+                if (c + 1 < n && (CEfiUSize)slots[c + 1] > (CEfiUSize)slots[c])
+                        ++c;
+                if ((CEfiUSize)slots[i] >= (CEfiUSize)slots[c])
+                        break;
+                t = slots[i];
+                slots[i] = slots[c];
+                slots[c] = t;
+                i = c;
+        }
+}
+
+/* sort the slots by address, and drop duplicate registrations */
+static inline void c_efi_reloc_unique(CEfiRelocRegistry *registry) {
+        void ***slots = registry->slots, **t;
+        CEfiUSize i, n = registry->n_slots;
+
+        /* drivers mostly register in address order, so skip sorting then */
+        for (i = 1; i < n && (CEfiUSize)slots[i - 1] <= (CEfiUSize)slots[i]; ++i)
+                ;
+        if (i < n) {
+                for (i = n / 2; i > 0; --i)
+                        c_efi_reloc_sift(slots, i - 1, n);
+                for (i = n; i > 1; --i) {
+                        t = slots[0];
+                        slots[0] = slots[i - 1];
+                        slots[i - 1] = t;
+                        c_efi_reloc_sift(slots, 0, i - 1);
+                }
+        }
+
+        for (i = 1, n = n ? 1 : 0; i < registry->n_slots; ++i)
+                if (slots[i] != slots[n - 1])
+                        slots[n++] = slots[i];
+        registry->n_slots = n;
+}
+
+/**
+ * c_efi_reloc_apply() - Relocate all registered slots
+ * @registry:           registry to use
+ *
+ * This converts the pointers of all registered slots to virtual addresses.
+ * Pointers within the runtime ranges of the virtual map are converted
+ * directly, all others via `convert_pointer`. Slots are sorted by address
+ * first, and duplicate registrations dropped, so a slot is never converted
+ * twice. @n_fallback and @status of @registry are updated.
+ *
+ * Return: C_EFI_SUCCESS on success, or the first error of `convert_pointer`.
+ *         All slots are processed even on error.
+ */
+static inline CEfiStatus c_efi_reloc_apply(CEfiRelocRegistry *registry) {
+        const CEfiMemoryRange *range = C_EFI_NULL;
+        CEfiStatus r, status = C_EFI_SUCCESS;
+        CEfiPhysicalAddress p;
+        CEfiUSize i;
+
+        registry->n_fallback = 0;
+        c_efi_reloc_unique(registry);
+
+        for (i = 0; i < registry->n_slots; ++i) {
+                p = (CEfiPhysicalAddress)(CEfiUSize)*registry->slots[i];
+                if (!p)
+                        continue;
+
+                /* consecutive slots mostly point into the same image */
+                if (!range || p < range->start || p >= range->end)
+                        range = c_efi_memory_ranges_find(registry->ranges, registry->n_ranges, p);
+
+                if (range) {
+                        *registry->slots[i] = (void *)(CEfiUSize)(p + registry->deltas[range - registry->ranges]);
+                } else {
+                        ++registry->n_fallback;
+                        r = registry->rt->convert_pointer(0, registry->slots[i]);
+                        if (C_EFI_ERROR(r) && !C_EFI_ERROR(status))
+                                status = r;
+                }
+        }
+
+        /* drop the registrations, so nothing is relocated twice */
+        registry->n_slots = 0;
+        registry->status = status;
+        return status;
+}
+
+/**
+ * c_efi_reloc_notify() - Address change notification
+ * @event:              event that was signaled
+ * @context:            registry to relocate
+ *
+ * This is a notification function for C_EFI_EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE,
+ * or the C_EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE event group. Pass the
+ * registry as context. It runs c_efi_reloc_apply(), whose result is left in
+ * @status of the registry.
+ */
+static inline void CEFICALL c_efi_reloc_notify(CEfiEvent event, void *context) {
+        c_efi_reloc_apply(context);
+}
+
+/* the hook has no context, so its state is per translation unit */
+static CEfiRelocRegistry *c_efi_reloc_hooked;
+static CEfiStatus (CEFICALL *c_efi_reloc_chained) (CEfiUSize, CEfiUSize, CEfiU32, CEfiMemoryDescriptor *);
+
+static inline CEfiStatus CEFICALL c_efi_reloc_set_virtual_address_map(CEfiUSize memory_map_size,
+                                                                      CEfiUSize descriptor_size,
+                                                                      CEfiU32 descriptor_version,
+                                                                      CEfiMemoryDescriptor *virtual_map) {
+        CEfiRelocRegistry *registry = c_efi_reloc_hooked;
+
+        /* the registry is not relocated, so only use it on the first call */
+        c_efi_reloc_hooked = C_EFI_NULL;
+        if (registry && descriptor_version == C_EFI_MEMORY_DESCRIPTOR_VERSION)
+                c_efi_reloc_set_map(registry, memory_map_size, descriptor_size, virtual_map);
+
+        return c_efi_reloc_chained(memory_map_size, descriptor_size, descriptor_version, virtual_map);
+}
+
+/**
+ * c_efi_reloc_hook() - Capture the virtual map
+ * @registry:           registry to provide the map to
+ *
+ * This replaces `set_virtual_address_map` in the runtime services table of
+ * @registry with a wrapper, which passes the virtual map to
+ * c_efi_reloc_set_map() before calling the original service. The table
+ * checksum is updated. The pointer to the original service is registered
+ * with @registry itself, so the wrapper stays functional in virtual mode.
+ *
+ * The hook state lives in static variables of the including translation
+ * unit, so only one registry per translation unit can be hooked. Hooks from
+ * different translation units are not detected, but chain: each wrapper
+ * captures the map for its own registry, then calls the previous one. An
+ * image should still hook a single registry, from a single place.
+ *
+ * Must be called from a runtime driver before ExitBootServices(), while the
+ * runtime services table is still writable.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_ALREADY_STARTED if a registry of
+ *         this translation unit is already hooked, C_EFI_OUT_OF_RESOURCES if
+ *         @registry is full.
+ */
+static inline CEfiStatus c_efi_reloc_hook(CEfiRelocRegistry *registry) {
+        CEfiRuntimeServices *rt = registry->rt;
+        CEfiStatus r;
+
+        if (c_efi_reloc_chained)
+                return C_EFI_ALREADY_STARTED;
+
+        r = c_efi_reloc_register(registry, (void **)&c_efi_reloc_chained);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        c_efi_reloc_hooked = registry;
+        c_efi_reloc_chained = rt->set_virtual_address_map;
+        rt->set_virtual_address_map = c_efi_reloc_set_virtual_address_map;
+
+        rt->hdr.crc32 = 0;
+        rt->hdr.crc32 = c_efi_crc32(0, rt, rt->hdr.header_size);
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1066 @@
+#pragma once
+
+/**
+ * SHA-256 and SHA-384 Hashes
+ *
+ * Measured boot extends TPM PCRs with SHA-256 or SHA-384 digests of every
+ * image, and payload verification hashes them once more. This header provides
+ * streaming implementations of both, so payloads can be hashed while they are
+ * read, with per-architecture kernels for SHA-256:
+ *
+ *  - x86-64 uses the SHA extensions, if CPUID reports them and SSE is
+ *    enabled. Builds with SSE assume it is, builds without check CR0 and
+ *    CR4 at runtime, so they use the kernels once c_efi_simd_enable() ran
+ *    (see 'c-efi-simd.h'). The kernels are compiled for their target
+ *    extensions either way.
+ *
+ *  - AArch64 uses the SHA-256 instructions of the cryptographic extension, if
+ *    ID_AA64ISAR0_EL1 reports them.
+ *
+ *  - All other configurations use the scalar reference algorithm, unrolled
+ *    by eight rounds.
+ *
+ * SHA-384 is always scalar. The SHA-512 instructions of ARMv8.2 and recent
+ * x86-64 CPUs are not used.
+ *
+ * Several independent payloads can be hashed at once with
+ * c_efi_sha256_update_multi() and c_efi_sha384_update_multi(). On x86-64
+ * with SSE enabled, these run the scalar algorithm in SIMD lanes, 8 messages
+ * for SHA-256 and 4 for SHA-384, using AVX2 if the CPU and the firmware enable
+ * it. CPUs with SHA-256 instructions hash the SHA-256 messages one after
+ * another instead, which is faster still.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#if defined(__x86_64__)
+#  include <c-efi-simd.h>
+#endif
+
+#define C_EFI_SHA256_BLOCK_SIZE         64
+#define C_EFI_SHA256_DIGEST_SIZE        32
+#define C_EFI_SHA384_BLOCK_SIZE         128
+#define C_EFI_SHA384_DIGEST_SIZE        48
+
+/**
+ * CEfiSha256: Streaming SHA-256 State
+ * @h:                  intermediate hash value
+ * @n_total:            number of bytes hashed so far
+ * @buffer:             partial block carried over between updates
+ */
+typedef struct CEfiSha256 {
+        CEfiU32 h[8];
+        CEfiU64 n_total;
+        CEfiU8 buffer[C_EFI_SHA256_BLOCK_SIZE];
+} CEfiSha256;
+
+/**
+ * CEfiSha384: Streaming SHA-384 State
+ * @h:                  intermediate hash value
+ * @n_total:            number of bytes hashed so far
+ * @buffer:             partial block carried over between updates
+ *
+ * The message length is limited to 2^64 - 1 bytes, rather than the 2^128 - 1
+ * bits of the specification.
+ */
+typedef struct CEfiSha384 {
+        CEfiU64 h[8];
+        CEfiU64 n_total;
+        CEfiU8 buffer[C_EFI_SHA384_BLOCK_SIZE];
+} CEfiSha384;
+
+static const CEfiU32 c_efi_sha256_k[64] = {
+        C_EFI_U32_C(0x428a2f98), C_EFI_U32_C(0x71374491), C_EFI_U32_C(0xb5c0fbcf), C_EFI_U32_C(0xe9b5dba5),
+        C_EFI_U32_C(0x3956c25b), C_EFI_U32_C(0x59f111f1), C_EFI_U32_C(0x923f82a4), C_EFI_U32_C(0xab1c5ed5),
+        C_EFI_U32_C(0xd807aa98), C_EFI_U32_C(0x12835b01), C_EFI_U32_C(0x243185be), C_EFI_U32_C(0x550c7dc3),
+        C_EFI_U32_C(0x72be5d74), C_EFI_U32_C(0x80deb1fe), C_EFI_U32_C(0x9bdc06a7), C_EFI_U32_C(0xc19bf174),
+        C_EFI_U32_C(0xe49b69c1), C_EFI_U32_C(0xefbe4786), C_EFI_U32_C(0x0fc19dc6), C_EFI_U32_C(0x240ca1cc),
+        C_EFI_U32_C(0x2de92c6f), C_EFI_U32_C(0x4a7484aa), C_EFI_U32_C(0x5cb0a9dc), C_EFI_U32_C(0x76f988da),
+        C_EFI_U32_C(0x983e5152), C_EFI_U32_C(0xa831c66d), C_EFI_U32_C(0xb00327c8), C_EFI_U32_C(0xbf597fc7),
+        C_EFI_U32_C(0xc6e00bf3), C_EFI_U32_C(0xd5a79147), C_EFI_U32_C(0x06ca6351), C_EFI_U32_C(0x14292967),
+        C_EFI_U32_C(0x27b70a85), C_EFI_U32_C(0x2e1b2138), C_EFI_U32_C(0x4d2c6dfc), C_EFI_U32_C(0x53380d13),
+        C_EFI_U32_C(0x650a7354), C_EFI_U32_C(0x766a0abb), C_EFI_U32_C(0x81c2c92e), C_EFI_U32_C(0x92722c85),
+        C_EFI_U32_C(0xa2bfe8a1), C_EFI_U32_C(0xa81a664b), C_EFI_U32_C(0xc24b8b70), C_EFI_U32_C(0xc76c51a3),
+        C_EFI_U32_C(0xd192e819), C_EFI_U32_C(0xd6990624), C_EFI_U32_C(0xf40e3585), C_EFI_U32_C(0x106aa070),
+        C_EFI_U32_C(0x19a4c116), C_EFI_U32_C(0x1e376c08), C_EFI_U32_C(0x2748774c), C_EFI_U32_C(0x34b0bcb5),
+        C_EFI_U32_C(0x391c0cb3), C_EFI_U32_C(0x4ed8aa4a), C_EFI_U32_C(0x5b9cca4f), C_EFI_U32_C(0x682e6ff3),
+        C_EFI_U32_C(0x748f82ee), C_EFI_U32_C(0x78a5636f), C_EFI_U32_C(0x84c87814), C_EFI_U32_C(0x8cc70208),
+        C_EFI_U32_C(0x90befffa), C_EFI_U32_C(0xa4506ceb), C_EFI_U32_C(0xbef9a3f7), C_EFI_U32_C(0xc67178f2),
+};
+
+static const CEfiU64 c_efi_sha512_k[80] = {
+        C_EFI_U64_C(0x428a2f98d728ae22), C_EFI_U64_C(0x7137449123ef65cd), C_EFI_U64_C(0xb5c0fbcfec4d3b2f), C_EFI_U64_C(0xe9b5dba58189dbbc),
+        C_EFI_U64_C(0x3956c25bf348b538), C_EFI_U64_C(0x59f111f1b605d019), C_EFI_U64_C(0x923f82a4af194f9b), C_EFI_U64_C(0xab1c5ed5da6d8118),
+        C_EFI_U64_C(0xd807aa98a3030242), C_EFI_U64_C(0x12835b0145706fbe), C_EFI_U64_C(0x243185be4ee4b28c), C_EFI_U64_C(0x550c7dc3d5ffb4e2),
+        C_EFI_U64_C(0x72be5d74f27b896f), C_EFI_U64_C(0x80deb1fe3b1696b1), C_EFI_U64_C(0x9bdc06a725c71235), C_EFI_U64_C(0xc19bf174cf692694),
+        C_EFI_U64_C(0xe49b69c19ef14ad2), C_EFI_U64_C(0xefbe4786384f25e3), C_EFI_U64_C(0x0fc19dc68b8cd5b5), C_EFI_U64_C(0x240ca1cc77ac9c65),
+        C_EFI_U64_C(0x2de92c6f592b0275), C_EFI_U64_C(0x4a7484aa6ea6e483), C_EFI_U64_C(0x5cb0a9dcbd41fbd4), C_EFI_U64_C(0x76f988da831153b5),
+        C_EFI_U64_C(0x983e5152ee66dfab), C_EFI_U64_C(0xa831c66d2db43210), C_EFI_U64_C(0xb00327c898fb213f), C_EFI_U64_C(0xbf597fc7beef0ee4),
+        C_EFI_U64_C(0xc6e00bf33da88fc2), C_EFI_U64_C(0xd5a79147930aa725), C_EFI_U64_C(0x06ca6351e003826f), C_EFI_U64_C(0x142929670a0e6e70),
+        C_EFI_U64_C(0x27b70a8546d22ffc), C_EFI_U64_C(0x2e1b21385c26c926), C_EFI_U64_C(0x4d2c6dfc5ac42aed), C_EFI_U64_C(0x53380d139d95b3df),
+        C_EFI_U64_C(0x650a73548baf63de), C_EFI_U64_C(0x766a0abb3c77b2a8), C_EFI_U64_C(0x81c2c92e47edaee6), C_EFI_U64_C(0x92722c851482353b),
+        C_EFI_U64_C(0xa2bfe8a14cf10364), C_EFI_U64_C(0xa81a664bbc423001), C_EFI_U64_C(0xc24b8b70d0f89791), C_EFI_U64_C(0xc76c51a30654be30),
+        C_EFI_U64_C(0xd192e819d6ef5218), C_EFI_U64_C(0xd69906245565a910), C_EFI_U64_C(0xf40e35855771202a), C_EFI_U64_C(0x106aa07032bbd1b8),
+        C_EFI_U64_C(0x19a4c116b8d2d0c8), C_EFI_U64_C(0x1e376c085141ab53), C_EFI_U64_C(0x2748774cdf8eeb99), C_EFI_U64_C(0x34b0bcb5e19b48a8),
+        C_EFI_U64_C(0x391c0cb3c5c95a63), C_EFI_U64_C(0x4ed8aa4ae3418acb), C_EFI_U64_C(0x5b9cca4f7763e373), C_EFI_U64_C(0x682e6ff3d6b2b8a3),
+        C_EFI_U64_C(0x748f82ee5defb2fc), C_EFI_U64_C(0x78a5636f43172f60), C_EFI_U64_C(0x84c87814a1f0ab72), C_EFI_U64_C(0x8cc702081a6439ec),
+        C_EFI_U64_C(0x90befffa23631e28), C_EFI_U64_C(0xa4506cebde82bde9), C_EFI_U64_C(0xbef9a3f7b2c67915), C_EFI_U64_C(0xc67178f2e372532b),
+        C_EFI_U64_C(0xca273eceea26619c), C_EFI_U64_C(0xd186b8c721c0c207), C_EFI_U64_C(0xeada7dd6cde0eb1e), C_EFI_U64_C(0xf57d4f7fee6ed178),
+        C_EFI_U64_C(0x06f067aa72176fba), C_EFI_U64_C(0x0a637dc5a2c898a6), C_EFI_U64_C(0x113f9804bef90dae), C_EFI_U64_C(0x1b710b35131c471b),
+        C_EFI_U64_C(0x28db77f523047d84), C_EFI_U64_C(0x32caab7b40c72493), C_EFI_U64_C(0x3c9ebe0a15c9bebc), C_EFI_U64_C(0x431d67c49c100d4c),
+        C_EFI_U64_C(0x4cc5d4becb3e42b6), C_EFI_U64_C(0x597f299cfc657e2a), C_EFI_U64_C(0x5fcb6fab3ad6faec), C_EFI_U64_C(0x6c44198c4a475817),
+};
+
+static inline CEfiU32 c_efi_sha2_load32(const CEfiU8 *p) {
+        CEfiU32 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return __builtin_bswap32(v);
+}
+
+static inline CEfiU64 c_efi_sha2_load64(const CEfiU8 *p) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return __builtin_bswap64(v);
+}
+
+static inline void c_efi_sha2_store32(CEfiU8 *p, CEfiU32 v) {
+        v = __builtin_bswap32(v);
+        __builtin_memcpy(p, &v, sizeof(v));
+}
+
+static inline void c_efi_sha2_store64(CEfiU8 *p, CEfiU64 v) {
+        v = __builtin_bswap64(v);
+        __builtin_memcpy(p, &v, sizeof(v));
+}
+
+static inline CEfiU32 c_efi_sha256_ror(CEfiU32 x, unsigned int n) {
+        return (x >> n) | (x << (32 - n));
+}
+
+static inline CEfiU64 c_efi_sha512_ror(CEfiU64 x, unsigned int n) {
+        return (x >> n) | (x << (64 - n));
+}
+
+/* extend the message schedule by words @i to @i + 7, in the 16 word window @w */
+static inline void c_efi_sha256_schedule(CEfiU32 w[16], CEfiUSize i) {
+        CEfiU32 x, y;
+        CEfiUSize j;
+
+        for (j = i; j < i + 8; ++j) {
+                x = w[(j - 15) & 15];
+                y = w[(j - 2) & 15];
+                w[j & 15] += (c_efi_sha256_ror(x, 7) ^ c_efi_sha256_ror(x, 18) ^ (x >> 3)) +
+                             (c_efi_sha256_ror(y, 17) ^ c_efi_sha256_ror(y, 19) ^ (y >> 10)) +
+                             w[(j - 7) & 15];
+        }
+}
+
+static inline void c_efi_sha512_schedule(CEfiU64 w[16], CEfiUSize i) {
+        CEfiU64 x, y;
+        CEfiUSize j;
+
+        for (j = i; j < i + 8; ++j) {
+                x = w[(j - 15) & 15];
+                y = w[(j - 2) & 15];
+                w[j & 15] += (c_efi_sha512_ror(x, 1) ^ c_efi_sha512_ror(x, 8) ^ (x >> 7)) +
+                             (c_efi_sha512_ror(y, 19) ^ c_efi_sha512_ror(y, 61) ^ (y >> 6)) +
+                             w[(j - 7) & 15];
+        }
+}
+
+/*
+ * One round, with the working variables passed in rotated order rather than
+ * shifted, so unrolled calls compile to register renames. @kw is the round
+ * constant plus the message schedule word.
+ */
+static inline void c_efi_sha256_round(CEfiU32 a, CEfiU32 b, CEfiU32 c, CEfiU32 *d,
+                                      CEfiU32 e, CEfiU32 f, CEfiU32 g, CEfiU32 *h,
+                                      CEfiU32 kw) {
+        CEfiU32 t;
+
+        t = *h + (c_efi_sha256_ror(e, 6) ^ c_efi_sha256_ror(e, 11) ^ c_efi_sha256_ror(e, 25)) +
+            (g ^ (e & (f ^ g))) + kw;
+        *d += t;
+        *h = t + (c_efi_sha256_ror(a, 2) ^ c_efi_sha256_ror(a, 13) ^ c_efi_sha256_ror(a, 22)) +
+             ((a & b) | (c & (a | b)));
+}
+
+static inline void c_efi_sha512_round(CEfiU64 a, CEfiU64 b, CEfiU64 c, CEfiU64 *d,
+                                      CEfiU64 e, CEfiU64 f, CEfiU64 g, CEfiU64 *h,
+                                      CEfiU64 kw) {
+        CEfiU64 t;
+
+        t = *h + (c_efi_sha512_ror(e, 14) ^ c_efi_sha512_ror(e, 18) ^ c_efi_sha512_ror(e, 41)) +
+            (g ^ (e & (f ^ g))) + kw;
+        *d += t;
+        *h = t + (c_efi_sha512_ror(a, 28) ^ c_efi_sha512_ror(a, 34) ^ c_efi_sha512_ror(a, 39)) +
+             ((a & b) | (c & (a | b)));
+}
+
+static inline void c_efi_sha256_blocks_scalar(CEfiU32 s[8], const CEfiU8 *p, CEfiUSize n) {
+        CEfiU32 a, b, c, d, e, f, g, h, w[16];
+        CEfiUSize i;
+
+        for ( ; n; --n, p += C_EFI_SHA256_BLOCK_SIZE) {
+                for (i = 0; i < 16; ++i)
+                        w[i] = c_efi_sha2_load32(p + i * 4);
+
+                a = s[0];
+                b = s[1];
+                c = s[2];
+                d = s[3];
+                e = s[4];
+                f = s[5];
+                g = s[6];
+                h = s[7];
+
+                for (i = 0; i < 64; i += 8) {
+                        if (i >= 16)
+                                c_efi_sha256_schedule(w, i);
+                        c_efi_sha256_round(a, b, c, &d, e, f, g, &h, c_efi_sha256_k[i + 0] + w[(i + 0) & 15]);
+                        c_efi_sha256_round(h, a, b, &c, d, e, f, &g, c_efi_sha256_k[i + 1] + w[(i + 1) & 15]);
+                        c_efi_sha256_round(g, h, a, &b, c, d, e, &f, c_efi_sha256_k[i + 2] + w[(i + 2) & 15]);
+                        c_efi_sha256_round(f, g, h, &a, b, c, d, &e, c_efi_sha256_k[i + 3] + w[(i + 3) & 15]);
+                        c_efi_sha256_round(e, f, g, &h, a, b, c, &d, c_efi_sha256_k[i + 4] + w[(i + 4) & 15]);
+                        c_efi_sha256_round(d, e, f, &g, h, a, b, &c, c_efi_sha256_k[i + 5] + w[(i + 5) & 15]);
+                        c_efi_sha256_round(c, d, e, &f, g, h, a, &b, c_efi_sha256_k[i + 6] + w[(i + 6) & 15]);
+                        c_efi_sha256_round(b, c, d, &e, f, g, h, &a, c_efi_sha256_k[i + 7] + w[(i + 7) & 15]);
+                }
+
+                s[0] += a;
+                s[1] += b;
+                s[2] += c;
+                s[3] += d;
+                s[4] += e;
+                s[5] += f;
+                s[6] += g;
+                s[7] += h;
+        }
+}
+
+static inline void c_efi_sha512_blocks_scalar(CEfiU64 s[8], const CEfiU8 *p, CEfiUSize n) {
+        CEfiU64 a, b, c, d, e, f, g, h, w[16];
+        CEfiUSize i;
+
+        for ( ; n; --n, p += C_EFI_SHA384_BLOCK_SIZE) {
+                for (i = 0; i < 16; ++i)
+                        w[i] = c_efi_sha2_load64(p + i * 8);
+
+                a = s[0];
+                b = s[1];
+                c = s[2];
+                d = s[3];
+                e = s[4];
+                f = s[5];
+                g = s[6];
+                h = s[7];
+
+                for (i = 0; i < 80; i += 8) {
+                        if (i >= 16)
+                                c_efi_sha512_schedule(w, i);
+                        c_efi_sha512_round(a, b, c, &d, e, f, g, &h, c_efi_sha512_k[i + 0] + w[(i + 0) & 15]);
+                        c_efi_sha512_round(h, a, b, &c, d, e, f, &g, c_efi_sha512_k[i + 1] + w[(i + 1) & 15]);
+                        c_efi_sha512_round(g, h, a, &b, c, d, e, &f, c_efi_sha512_k[i + 2] + w[(i + 2) & 15]);
+                        c_efi_sha512_round(f, g, h, &a, b, c, d, &e, c_efi_sha512_k[i + 3] + w[(i + 3) & 15]);
+                        c_efi_sha512_round(e, f, g, &h, a, b, c, &d, c_efi_sha512_k[i + 4] + w[(i + 4) & 15]);
+                        c_efi_sha512_round(d, e, f, &g, h, a, b, &c, c_efi_sha512_k[i + 5] + w[(i + 5) & 15]);
+                        c_efi_sha512_round(c, d, e, &f, g, h, a, &b, c_efi_sha512_k[i + 6] + w[(i + 6) & 15]);
+                        c_efi_sha512_round(b, c, d, &e, f, g, h, &a, c_efi_sha512_k[i + 7] + w[(i + 7) & 15]);
+                }
+
+                s[0] += a;
+                s[1] += b;
+                s[2] += c;
+                s[3] += d;
+                s[4] += e;
+                s[5] += f;
+                s[6] += g;
+                s[7] += h;
+        }
+}
+
+#if defined(__aarch64__)
+
+typedef CEfiU32 CEfiSha256Vec __attribute__((__vector_size__(16)));
+typedef CEfiU8 CEfiSha256Bytes __attribute__((__vector_size__(16)));
+
+static inline CEfiBool c_efi_sha256_has_insn(void) {
+        static CEfiU32 cache;
+        CEfiU64 isar0;
+        CEfiU32 v;
+
+        /* bit 1 marks the cache as valid, bit 0 is the result */
+        v = __atomic_load_n(&cache, __ATOMIC_RELAXED);
+        if (!v) {
+                __asm__ ("mrs %0, ID_AA64ISAR0_EL1" : "=r" (isar0));
+                v = 2 | !!((isar0 >> 12) & 0xf);
+                __atomic_store_n(&cache, v, __ATOMIC_RELAXED);
+        }
+
+        return v & 1;
+}
+
+static inline CEfiSha256Vec c_efi_sha256_insn_load(const CEfiU8 *p) {
+        CEfiSha256Bytes v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        v = __builtin_shufflevector(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return (CEfiSha256Vec)v;
+}
+
+static inline void c_efi_sha256_insn_rounds(CEfiSha256Vec *abcd, CEfiSha256Vec *efgh, CEfiSha256Vec w, CEfiUSize i) {
+        CEfiSha256Vec k, t;
+
+        __builtin_memcpy(&k, c_efi_sha256_k + i, sizeof(k));
+        k += w;
+        __asm__ (
+                ".arch_extension sha2\n\t"
+                "mov %[t].16b, %[abcd].16b\n\t"
+                "sha256h %q[abcd], %q[efgh], %[k].4s\n\t"
+                "sha256h2 %q[efgh], %q[t], %[k].4s"
+                : [abcd] "+w" (*abcd), [efgh] "+w" (*efgh), [t] "=&w" (t)
+                : [k] "w" (k)
+        );
+}
+
+/* four rounds per instruction pair, the schedule is four words per pair too */
+static inline void c_efi_sha256_blocks_insn(CEfiU32 s[8], const CEfiU8 *p, CEfiUSize n) {
+        CEfiSha256Vec abcd, efgh, abcd0, efgh0, m0, m1, m2, m3;
+        CEfiUSize i;
+
+        __builtin_memcpy(&abcd, s, sizeof(abcd));
+        __builtin_memcpy(&efgh, s + 4, sizeof(efgh));
+
+        for ( ; n; --n, p += C_EFI_SHA256_BLOCK_SIZE) {
+                abcd0 = abcd;
+                efgh0 = efgh;
+                m0 = c_efi_sha256_insn_load(p);
+                m1 = c_efi_sha256_insn_load(p + 16);
+                m2 = c_efi_sha256_insn_load(p + 32);
+                m3 = c_efi_sha256_insn_load(p + 48);
+
+                for (i = 0; i < 48; i += 16) {
+                        c_efi_sha256_insn_rounds(&abcd, &efgh, m0, i);
+                        __asm__ (
+                                ".arch_extension sha2\n\t"
+                                "sha256su0 %0.4s, %1.4s\n\t"
+                                "sha256su1 %0.4s, %2.4s, %3.4s"
+                                : "+w" (m0) : "w" (m1), "w" (m2), "w" (m3)
+                        );
+                        c_efi_sha256_insn_rounds(&abcd, &efgh, m1, i + 4);
+                        __asm__ (
+                                ".arch_extension sha2\n\t"
+                                "sha256su0 %0.4s, %1.4s\n\t"
+                                "sha256su1 %0.4s, %2.4s, %3.4s"
+                                : "+w" (m1) : "w" (m2), "w" (m3), "w" (m0)
+                        );
+                        c_efi_sha256_insn_rounds(&abcd, &efgh, m2, i + 8);
+                        __asm__ (
+                                ".arch_extension sha2\n\t"
+                                "sha256su0 %0.4s, %1.4s\n\t"
+                                "sha256su1 %0.4s, %2.4s, %3.4s"
+                                : "+w" (m2) : "w" (m3), "w" (m0), "w" (m1)
+                        );
+                        c_efi_sha256_insn_rounds(&abcd, &efgh, m3, i + 12);
+                        __asm__ (
+                                ".arch_extension sha2\n\t"
+                                "sha256su0 %0.4s, %1.4s\n\t"
+                                "sha256su1 %0.4s, %2.4s, %3.4s"
+                                : "+w" (m3) : "w" (m0), "w" (m1), "w" (m2)
+                        );
+                }
+                c_efi_sha256_insn_rounds(&abcd, &efgh, m0, 48);
+                c_efi_sha256_insn_rounds(&abcd, &efgh, m1, 52);
+                c_efi_sha256_insn_rounds(&abcd, &efgh, m2, 56);
+                c_efi_sha256_insn_rounds(&abcd, &efgh, m3, 60);
+
+                abcd += abcd0;
+                efgh += efgh0;
+        }
+
+        __builtin_memcpy(s, &abcd, sizeof(abcd));
+        __builtin_memcpy(s + 4, &efgh, sizeof(efgh));
+}
+
+#elif defined(__x86_64__)
+
+typedef CEfiU32 CEfiSha256Vec __attribute__((__vector_size__(16)));
+typedef CEfiU8 CEfiSha256Bytes __attribute__((__vector_size__(16)));
+typedef int CEfiSha256VecS __attribute__((__vector_size__(16)));
+typedef CEfiU32 CEfiSha256X4 __attribute__((__vector_size__(16)));
+typedef CEfiU32 CEfiSha256X8 __attribute__((__vector_size__(32)));
+typedef CEfiU64 CEfiSha512X2 __attribute__((__vector_size__(16)));
+typedef CEfiU64 CEfiSha512X4 __attribute__((__vector_size__(32)));
+
+/*
+ * Builds with SSE assume it is enabled. Others check CR0 and CR4, which
+ * c_efi_simd_enable() sets up, so they must run at ring 0, as UEFI images
+ * do. The kernels carry their own target attributes, and only run after
+ * this succeeded.
+ */
+static inline CEfiBool c_efi_sha2_has_sse(void) {
+#if defined(__SSE2__)
+        return 1;
+#else
+        return !(c_efi_simd_read_cr0() & (C_EFI_SIMD_CR0_EM | C_EFI_SIMD_CR0_TS)) &&
+               (c_efi_simd_read_cr4() & C_EFI_SIMD_CR4_OSFXSR);
+#endif
+}
+
+static inline CEfiBool c_efi_sha256_has_insn(void) {
+        return (c_efi_simd_cpu_features_cached() & (C_EFI_SIMD_SSSE3 | C_EFI_SIMD_SHA)) ==
+               (C_EFI_SIMD_SSSE3 | C_EFI_SIMD_SHA) &&
+               c_efi_sha2_has_sse();
+}
+
+__attribute__((__target__("sha,ssse3")))
+static inline CEfiSha256Vec c_efi_sha256_insn_load(const CEfiU8 *p) {
+        CEfiSha256Bytes v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        v = __builtin_shufflevector(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return (CEfiSha256Vec)v;
+}
+
+__attribute__((__target__("sha,ssse3")))
+static inline void c_efi_sha256_insn_rounds(CEfiSha256Vec *abef, CEfiSha256Vec *cdgh, CEfiSha256Vec w, CEfiUSize i) {
+        CEfiSha256Vec k;
+
+        __builtin_memcpy(&k, c_efi_sha256_k + i, sizeof(k));
+        k += w;
+        *cdgh = (CEfiSha256Vec)__builtin_ia32_sha256rnds2((CEfiSha256VecS)*cdgh, (CEfiSha256VecS)*abef, (CEfiSha256VecS)k);
+        k = __builtin_shufflevector(k, k, 2, 3, 0, 0);
+        *abef = (CEfiSha256Vec)__builtin_ia32_sha256rnds2((CEfiSha256VecS)*abef, (CEfiSha256VecS)*cdgh, (CEfiSha256VecS)k);
+}
+
+/* the schedule for the next four rounds, from the last sixteen words */
+__attribute__((__target__("sha,ssse3")))
+static inline CEfiSha256Vec c_efi_sha256_insn_schedule(CEfiSha256Vec m0, CEfiSha256Vec m1,
+                                                       CEfiSha256Vec m2, CEfiSha256Vec m3) {
+        CEfiSha256Vec t;
+
+        t = (CEfiSha256Vec)__builtin_ia32_sha256msg1((CEfiSha256VecS)m0, (CEfiSha256VecS)m1);
+        t += __builtin_shufflevector(m2, m3, 1, 2, 3, 4);
+        return (CEfiSha256Vec)__builtin_ia32_sha256msg2((CEfiSha256VecS)t, (CEfiSha256VecS)m3);
+}
+
+/*
+ * SHA256RNDS2 keeps the state as ABEF and CDGH, with A and C in the highest
+ * lanes. Convert once per call rather than once per block.
+ */
+__attribute__((__target__("sha,ssse3")))
+static inline void c_efi_sha256_blocks_insn(CEfiU32 s[8], const CEfiU8 *p, CEfiUSize n) {
+        CEfiSha256Vec abcd, efgh, abef, cdgh, abef0, cdgh0, m0, m1, m2, m3, m;
+        CEfiUSize i;
+
+        __builtin_memcpy(&abcd, s, sizeof(abcd));
+        __builtin_memcpy(&efgh, s + 4, sizeof(efgh));
+        abef = __builtin_shufflevector(abcd, efgh, 5, 4, 1, 0);
+        cdgh = __builtin_shufflevector(abcd, efgh, 7, 6, 3, 2);
+
+        for ( ; n; --n, p += C_EFI_SHA256_BLOCK_SIZE) {
+                abef0 = abef;
+                cdgh0 = cdgh;
+                m0 = c_efi_sha256_insn_load(p);
+                m1 = c_efi_sha256_insn_load(p + 16);
+                m2 = c_efi_sha256_insn_load(p + 32);
+                m3 = c_efi_sha256_insn_load(p + 48);
+
+                c_efi_sha256_insn_rounds(&abef, &cdgh, m0, 0);
+                c_efi_sha256_insn_rounds(&abef, &cdgh, m1, 4);
+                c_efi_sha256_insn_rounds(&abef, &cdgh, m2, 8);
+                c_efi_sha256_insn_rounds(&abef, &cdgh, m3, 12);
+                for (i = 16; i < 64; i += 4) {
+                        m = c_efi_sha256_insn_schedule(m0, m1, m2, m3);
+                        c_efi_sha256_insn_rounds(&abef, &cdgh, m, i);
+                        m0 = m1;
+                        m1 = m2;
+                        m2 = m3;
+                        m3 = m;
+                }
+
+                abef += abef0;
+                cdgh += cdgh0;
+        }
+
+        abcd = __builtin_shufflevector(abef, cdgh, 3, 2, 7, 6);
+        efgh = __builtin_shufflevector(abef, cdgh, 1, 0, 5, 4);
+        __builtin_memcpy(s, &abcd, sizeof(abcd));
+        __builtin_memcpy(s + 4, &efgh, sizeof(efgh));
+}
+
+/*
+ * The multi-buffer kernels run the scalar algorithm on one message per lane,
+ * all lanes advancing by @n blocks. They are instantiated once per vector
+ * width, with as many lanes as fit into a register: twice as many for AVX2 as
+ * for SSE2. Wider vectors on SSE2 only split into register pairs and spill.
+ */
+#define C_EFI_SHA256_LANES(_name, _vec, _n_lanes, _target)                                                     \
+        __attribute__((__target__(_target)))                                                                   \
+        static inline void _name(CEfiU32 *const s[], const CEfiU8 *const src[], CEfiUSize n) {                 \
+                _vec a, b, c, d, e, f, g, h, t, x, y, w[16], v[8];                                             \
+                const CEfiU8 *p[_n_lanes];                                                                     \
+                CEfiUSize i, j;                                                                                \
+                                                                                                               \
+                for (j = 0; j < _n_lanes; ++j) {                                                               \
+                        p[j] = src[j];                                                                         \
+                        for (i = 0; i < 8; ++i)                                                                \
+                                v[i][j] = s[j][i];                                                             \
+                }                                                                                              \
+                                                                                                               \
+                for ( ; n; --n) {                                                                              \
+                        for (j = 0; j < _n_lanes; ++j) {                                                       \
+                                for (i = 0; i < 16; ++i)                                                       \
+                                        w[i][j] = c_efi_sha2_load32(p[j] + i * 4);                             \
+                                p[j] += C_EFI_SHA256_BLOCK_SIZE;                                               \
+                        }                                                                                      \
+                                                                                                               \
+                        a = v[0];                                                                              \
+                        b = v[1];                                                                              \
+                        c = v[2];                                                                              \
+                        d = v[3];                                                                              \
+                        e = v[4];                                                                              \
+                        f = v[5];                                                                              \
+                        g = v[6];                                                                              \
+                        h = v[7];                                                                              \
+                                                                                                               \
+                        for (i = 0; i < 64; ++i) {                                                             \
+                                if (i >= 16) {                                                                 \
+                                        x = w[(i - 15) & 15];                                                  \
+                                        y = w[(i - 2) & 15];                                                   \
+                                        w[i & 15] += ((x >> 7 | x << 25) ^ (x >> 18 | x << 14) ^ (x >> 3)) +   \
+                                                     ((y >> 17 | y << 15) ^ (y >> 19 | y << 13) ^ (y >> 10)) + \
+                                                     w[(i - 7) & 15];                                          \
+                                }                                                                              \
+                                                                                                               \
+                                t = h + ((e >> 6 | e << 26) ^ (e >> 11 | e << 21) ^ (e >> 25 | e << 7)) +      \
+                                    (g ^ (e & (f ^ g))) + c_efi_sha256_k[i] + w[i & 15];                       \
+                                h = g;                                                                         \
+                                g = f;                                                                         \
+                                f = e;                                                                         \
+                                e = d + t;                                                                     \
+                                d = c;                                                                         \
+                                c = b;                                                                         \
+                                b = a;                                                                         \
+                                a = t + ((b >> 2 | b << 30) ^ (b >> 13 | b << 19) ^ (b >> 22 | b << 10)) +     \
+                                    ((b & c) | (d & (b | c)));                                                 \
+                        }                                                                                      \
+                                                                                                               \
+                        v[0] += a;                                                                             \
+                        v[1] += b;                                                                             \
+                        v[2] += c;                                                                             \
+                        v[3] += d;                                                                             \
+                        v[4] += e;                                                                             \
+                        v[5] += f;                                                                             \
+                        v[6] += g;                                                                             \
+                        v[7] += h;                                                                             \
+                }                                                                                              \
+                                                                                                               \
+                for (j = 0; j < _n_lanes; ++j)                                                                 \
+                        for (i = 0; i < 8; ++i)                                                                \
+                                s[j][i] = v[i][j];                                                             \
+        }
+
+#define C_EFI_SHA512_LANES(_name, _vec, _n_lanes, _target)                                                   \
+        __attribute__((__target__(_target)))                                                                 \
+        static inline void _name(CEfiU64 *const s[], const CEfiU8 *const src[], CEfiUSize n) {               \
+                _vec a, b, c, d, e, f, g, h, t, x, y, w[16], v[8];                                           \
+                const CEfiU8 *p[_n_lanes];                                                                   \
+                CEfiUSize i, j;                                                                              \
+                                                                                                             \
+                for (j = 0; j < _n_lanes; ++j) {                                                             \
+                        p[j] = src[j];                                                                       \
+                        for (i = 0; i < 8; ++i)                                                              \
+                                v[i][j] = s[j][i];                                                           \
+                }                                                                                            \
+                                                                                                             \
+                for ( ; n; --n) {                                                                            \
+                        for (j = 0; j < _n_lanes; ++j) {                                                     \
+                                for (i = 0; i < 16; ++i)                                                     \
+                                        w[i][j] = c_efi_sha2_load64(p[j] + i * 8);                           \
+                                p[j] += C_EFI_SHA384_BLOCK_SIZE;                                             \
+                        }                                                                                    \
+                                                                                                             \
+                        a = v[0];                                                                            \
+                        b = v[1];                                                                            \
+                        c = v[2];                                                                            \
+                        d = v[3];                                                                            \
+                        e = v[4];                                                                            \
+                        f = v[5];                                                                            \
+                        g = v[6];                                                                            \
+                        h = v[7];                                                                            \
+                                                                                                             \
+                        for (i = 0; i < 80; ++i) {                                                           \
+                                if (i >= 16) {                                                               \
+                                        x = w[(i - 15) & 15];                                                \
+                                        y = w[(i - 2) & 15];                                                 \
+                                        w[i & 15] += ((x >> 1 | x << 63) ^ (x >> 8 | x << 56) ^ (x >> 7)) +  \
+                                                     ((y >> 19 | y << 45) ^ (y >> 61 | y << 3) ^ (y >> 6)) + \
+                                                     w[(i - 7) & 15];                                        \
+                                }                                                                            \
+                                                                                                             \
+                                t = h + ((e >> 14 | e << 50) ^ (e >> 18 | e << 46) ^ (e >> 41 | e << 23)) +  \
+                                    (g ^ (e & (f ^ g))) + c_efi_sha512_k[i] + w[i & 15];                     \
+                                h = g;                                                                       \
+                                g = f;                                                                       \
+                                f = e;                                                                       \
+                                e = d + t;                                                                   \
+                                d = c;                                                                       \
+                                c = b;                                                                       \
+                                b = a;                                                                       \
+                                a = t + ((b >> 28 | b << 36) ^ (b >> 34 | b << 30) ^ (b >> 39 | b << 25)) +  \
+                                    ((b & c) | (d & (b | c)));                                               \
+                        }                                                                                    \
+                                                                                                             \
+                        v[0] += a;                                                                           \
+                        v[1] += b;                                                                           \
+                        v[2] += c;                                                                           \
+                        v[3] += d;                                                                           \
+                        v[4] += e;                                                                           \
+                        v[5] += f;                                                                           \
+                        v[6] += g;                                                                           \
+                        v[7] += h;                                                                           \
+                }                                                                                            \
+                                                                                                             \
+                for (j = 0; j < _n_lanes; ++j)                                                               \
+                        for (i = 0; i < 8; ++i)                                                              \
+                                s[j][i] = v[i][j];                                                           \
+        }
+
+C_EFI_SHA256_LANES(c_efi_sha256_x4_sse2, CEfiSha256X4, 4, "sse2")
+C_EFI_SHA256_LANES(c_efi_sha256_x8_avx2, CEfiSha256X8, 8, "avx2")
+C_EFI_SHA512_LANES(c_efi_sha512_x2_sse2, CEfiSha512X2, 2, "sse2")
+C_EFI_SHA512_LANES(c_efi_sha512_x4_avx2, CEfiSha512X4, 4, "avx2")
+
+/*
+ * CPUID reports what the CPU implements, but the YMM registers are only usable
+ * once CR4.OSXSAVE and XCR0 enable them, which c_efi_simd_enable() does on
+ * request. Check the live state, since firmware commonly leaves them off.
+ */
+static inline CEfiBool c_efi_sha2_has_avx2(void) {
+        CEfiU32 regs[4];
+
+        if (!(c_efi_simd_cpu_features_cached() & C_EFI_SIMD_AVX2))
+                return 0;
+
+        c_efi_simd_cpuid(1, 0, regs);
+        if (!(regs[2] & (C_EFI_U32_C(1) << 27)))
+                return 0;
+
+        return (c_efi_simd_xgetbv(0) & (C_EFI_SIMD_XCR0_SSE | C_EFI_SIMD_XCR0_AVX)) ==
+               (C_EFI_SIMD_XCR0_SSE | C_EFI_SIMD_XCR0_AVX) &&
+               c_efi_sha2_has_sse();
+}
+
+#endif
+
+static inline void c_efi_sha256_blocks(CEfiU32 s[8], const CEfiU8 *p, CEfiUSize n) {
+#if defined(__aarch64__) || defined(__x86_64__)
+        if (c_efi_sha256_has_insn()) {
+                c_efi_sha256_blocks_insn(s, p, n);
+                return;
+        }
+#endif
+
+        c_efi_sha256_blocks_scalar(s, p, n);
+}
+
+static inline void c_efi_sha512_blocks(CEfiU64 s[8], const CEfiU8 *p, CEfiUSize n) {
+        c_efi_sha512_blocks_scalar(s, p, n);
+}
+
+/**
+ * c_efi_sha256_init() - Initialize SHA-256 state
+ * @sha:                state to initialize
+ *
+ * This starts a new SHA-256 hash in @sha.
+ */
+static inline void c_efi_sha256_init(CEfiSha256 *sha) {
+        sha->h[0] = C_EFI_U32_C(0x6a09e667);
+        sha->h[1] = C_EFI_U32_C(0xbb67ae85);
+        sha->h[2] = C_EFI_U32_C(0x3c6ef372);
+        sha->h[3] = C_EFI_U32_C(0xa54ff53a);
+        sha->h[4] = C_EFI_U32_C(0x510e527f);
+        sha->h[5] = C_EFI_U32_C(0x9b05688c);
+        sha->h[6] = C_EFI_U32_C(0x1f83d9ab);
+        sha->h[7] = C_EFI_U32_C(0x5be0cd19);
+        sha->n_total = 0;
+}
+
+/**
+ * c_efi_sha256_update() - Hash data into SHA-256 state
+ * @sha:                state to update
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * This appends @data to the message hashed by @sha. Data may be split at any
+ * byte, the result does not depend on how the message is divided.
+ */
+static inline void c_efi_sha256_update(CEfiSha256 *sha, const void *data, CEfiUSize n) {
+        const CEfiU8 *p = data;
+        CEfiUSize fill, k;
+
+        fill = sha->n_total % C_EFI_SHA256_BLOCK_SIZE;
+        sha->n_total += n;
+
+        if (fill) {
+                k = C_EFI_SHA256_BLOCK_SIZE - fill;
+                if (n < k) {
+                        __builtin_memcpy(sha->buffer + fill, p, n);
+                        return;
+                }
+                __builtin_memcpy(sha->buffer + fill, p, k);
+                c_efi_sha256_blocks(sha->h, sha->buffer, 1);
+                p += k;
+                n -= k;
+        }
+
+        if (n >= C_EFI_SHA256_BLOCK_SIZE) {
+                c_efi_sha256_blocks(sha->h, p, n / C_EFI_SHA256_BLOCK_SIZE);
+                p += n & ~(CEfiUSize)(C_EFI_SHA256_BLOCK_SIZE - 1);
+                n %= C_EFI_SHA256_BLOCK_SIZE;
+        }
+
+        __builtin_memcpy(sha->buffer, p, n);
+}
+
+/**
+ * c_efi_sha256_final() - Finish SHA-256 hash
+ * @sha:                state to finish
+ * @digest:             output buffer for the digest
+ *
+ * This pads the message hashed by @sha and writes its digest to @digest. The
+ * state must be initialized again before it is reused.
+ */
+static inline void c_efi_sha256_final(CEfiSha256 *sha, CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE]) {
+        CEfiUSize i, fill = sha->n_total % C_EFI_SHA256_BLOCK_SIZE;
+
+        sha->buffer[fill++] = 0x80;
+        if (fill > C_EFI_SHA256_BLOCK_SIZE - 8) {
+                __builtin_memset(sha->buffer + fill, 0, C_EFI_SHA256_BLOCK_SIZE - fill);
+                c_efi_sha256_blocks(sha->h, sha->buffer, 1);
+                fill = 0;
+        }
+        __builtin_memset(sha->buffer + fill, 0, C_EFI_SHA256_BLOCK_SIZE - 8 - fill);
+        c_efi_sha2_store64(sha->buffer + C_EFI_SHA256_BLOCK_SIZE - 8, sha->n_total << 3);
+        c_efi_sha256_blocks(sha->h, sha->buffer, 1);
+
+        for (i = 0; i < 8; ++i)
+                c_efi_sha2_store32(digest + i * 4, sha->h[i]);
+}
+
+/**
+ * c_efi_sha256() - Calculate SHA-256
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ * @digest:             output buffer for the digest
+ *
+ * This hashes @data in one go.
+ */
+static inline void c_efi_sha256(const void *data, CEfiUSize n, CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE]) {
+        CEfiSha256 sha;
+
+        c_efi_sha256_init(&sha);
+        c_efi_sha256_update(&sha, data, n);
+        c_efi_sha256_final(&sha, digest);
+}
+
+/**
+ * c_efi_sha384_init() - Initialize SHA-384 state
+ * @sha:                state to initialize
+ *
+ * This starts a new SHA-384 hash in @sha.
+ */
+static inline void c_efi_sha384_init(CEfiSha384 *sha) {
+        sha->h[0] = C_EFI_U64_C(0xcbbb9d5dc1059ed8);
+        sha->h[1] = C_EFI_U64_C(0x629a292a367cd507);
+        sha->h[2] = C_EFI_U64_C(0x9159015a3070dd17);
+        sha->h[3] = C_EFI_U64_C(0x152fecd8f70e5939);
+        sha->h[4] = C_EFI_U64_C(0x67332667ffc00b31);
+        sha->h[5] = C_EFI_U64_C(0x8eb44a8768581511);
+        sha->h[6] = C_EFI_U64_C(0xdb0c2e0d64f98fa7);
+        sha->h[7] = C_EFI_U64_C(0x47b5481dbefa4fa4);
+        sha->n_total = 0;
+}
+
+/**
+ * c_efi_sha384_update() - Hash data into SHA-384 state
+ * @sha:                state to update
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * This appends @data to the message hashed by @sha. Data may be split at any
+ * byte, the result does not depend on how the message is divided.
+ */
+static inline void c_efi_sha384_update(CEfiSha384 *sha, const void *data, CEfiUSize n) {
+        const CEfiU8 *p = data;
+        CEfiUSize fill, k;
+
+        fill = sha->n_total % C_EFI_SHA384_BLOCK_SIZE;
+        sha->n_total += n;
+
+        if (fill) {
+                k = C_EFI_SHA384_BLOCK_SIZE - fill;
+                if (n < k) {
+                        __builtin_memcpy(sha->buffer + fill, p, n);
+                        return;
+                }
+                __builtin_memcpy(sha->buffer + fill, p, k);
+                c_efi_sha512_blocks(sha->h, sha->buffer, 1);
+                p += k;
+                n -= k;
+        }
+
+        if (n >= C_EFI_SHA384_BLOCK_SIZE) {
+                c_efi_sha512_blocks(sha->h, p, n / C_EFI_SHA384_BLOCK_SIZE);
+                p += n & ~(CEfiUSize)(C_EFI_SHA384_BLOCK_SIZE - 1);
+                n %= C_EFI_SHA384_BLOCK_SIZE;
+        }
+
+        __builtin_memcpy(sha->buffer, p, n);
+}
+
+/**
+ * c_efi_sha384_final() - Finish SHA-384 hash
+ * @sha:                state to finish
+ * @digest:             output buffer for the digest
+ *
+ * This pads the message hashed by @sha and writes its digest to @digest. The
+ * state must be initialized again before it is reused.
+ */
+static inline void c_efi_sha384_final(CEfiSha384 *sha, CEfiU8 digest[C_EFI_SHA384_DIGEST_SIZE]) {
+        CEfiUSize i, fill = sha->n_total % C_EFI_SHA384_BLOCK_SIZE;
+
+        /* the length field is 128 bits, the upper bits of the bit count first */
+        sha->buffer[fill++] = 0x80;
+        if (fill > C_EFI_SHA384_BLOCK_SIZE - 16) {
+                __builtin_memset(sha->buffer + fill, 0, C_EFI_SHA384_BLOCK_SIZE - fill);
+                c_efi_sha512_blocks(sha->h, sha->buffer, 1);
+                fill = 0;
+        }
+        __builtin_memset(sha->buffer + fill, 0, C_EFI_SHA384_BLOCK_SIZE - 16 - fill);
+        c_efi_sha2_store64(sha->buffer + C_EFI_SHA384_BLOCK_SIZE - 16, sha->n_total >> 61);
+        c_efi_sha2_store64(sha->buffer + C_EFI_SHA384_BLOCK_SIZE - 8, sha->n_total << 3);
+        c_efi_sha512_blocks(sha->h, sha->buffer, 1);
+
+        for (i = 0; i < 6; ++i)
+                c_efi_sha2_store64(digest + i * 8, sha->h[i]);
+}
+
+/**
+ * c_efi_sha384() - Calculate SHA-384
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ * @digest:             output buffer for the digest
+ *
+ * This hashes @data in one go.
+ */
+static inline void c_efi_sha384(const void *data, CEfiUSize n, CEfiU8 digest[C_EFI_SHA384_DIGEST_SIZE]) {
+        CEfiSha384 sha;
+
+        c_efi_sha384_init(&sha);
+        c_efi_sha384_update(&sha, data, n);
+        c_efi_sha384_final(&sha, digest);
+}
+
+#if defined(__x86_64__)
+
+/*
+ * Complete partial blocks one by one, then hash the whole blocks of as many
+ * messages as the kernel has lanes side by side. Lanes whose message ran out
+ * hash a copy of a busy lane into a scratch state, until only one message is
+ * left.
+ */
+static inline void c_efi_sha256_lanes(CEfiSha256 *const *shas,
+                                      const void *const *data,
+                                      const CEfiUSize *n,
+                                      CEfiUSize n_lanes,
+                                      CEfiBool avx2) {
+        CEfiU32 *h[8], scratch[8];
+        const CEfiU8 *p[8], *q[8];
+        CEfiUSize i, k, busy, n_busy, n_blocks[8], n_width = avx2 ? 8 : 4;
+
+        for (i = 0; i < n_lanes; ++i) {
+                k = shas[i]->n_total % C_EFI_SHA256_BLOCK_SIZE;
+                k = k ? C_EFI_SHA256_BLOCK_SIZE - k : 0;
+                k = k < n[i] ? k : n[i];
+                c_efi_sha256_update(shas[i], data[i], k);
+                q[i] = (const CEfiU8 *)data[i] + k;
+                n_blocks[i] = (n[i] - k) / C_EFI_SHA256_BLOCK_SIZE;
+        }
+
+        for (;;) {
+                for (i = 0, k = 0, busy = 0, n_busy = 0; i < n_lanes; ++i) {
+                        if (n_blocks[i]) {
+                                if (!n_busy++ || n_blocks[i] < k)
+                                        k = n_blocks[i];
+                                busy = i;
+                        }
+                }
+                if (n_busy < 2)
+                        break;
+
+                for (i = 0; i < n_width; ++i) {
+                        if (i < n_lanes && n_blocks[i]) {
+                                h[i] = shas[i]->h;
+                                p[i] = q[i];
+                        } else {
+                                h[i] = scratch;
+                                p[i] = q[busy];
+                        }
+                }
+
+                if (avx2)
+                        c_efi_sha256_x8_avx2(h, p, k);
+                else
+                        c_efi_sha256_x4_sse2(h, p, k);
+
+                for (i = 0; i < n_lanes; ++i) {
+                        if (n_blocks[i]) {
+                                q[i] += k * C_EFI_SHA256_BLOCK_SIZE;
+                                shas[i]->n_total += k * C_EFI_SHA256_BLOCK_SIZE;
+                                n_blocks[i] -= k;
+                        }
+                }
+        }
+
+        for (i = 0; i < n_lanes; ++i)
+                c_efi_sha256_update(shas[i], q[i], n[i] - (q[i] - (const CEfiU8 *)data[i]));
+}
+
+static inline void c_efi_sha384_lanes(CEfiSha384 *const *shas,
+                                      const void *const *data,
+                                      const CEfiUSize *n,
+                                      CEfiUSize n_lanes,
+                                      CEfiBool avx2) {
+        CEfiU64 *h[4], scratch[8];
+        const CEfiU8 *p[4], *q[4];
+        CEfiUSize i, k, busy, n_busy, n_blocks[4], n_width = avx2 ? 4 : 2;
+
+        for (i = 0; i < n_lanes; ++i) {
+                k = shas[i]->n_total % C_EFI_SHA384_BLOCK_SIZE;
+                k = k ? C_EFI_SHA384_BLOCK_SIZE - k : 0;
+                k = k < n[i] ? k : n[i];
+                c_efi_sha384_update(shas[i], data[i], k);
+                q[i] = (const CEfiU8 *)data[i] + k;
+                n_blocks[i] = (n[i] - k) / C_EFI_SHA384_BLOCK_SIZE;
+        }
+
+        for (;;) {
+                for (i = 0, k = 0, busy = 0, n_busy = 0; i < n_lanes; ++i) {
+                        if (n_blocks[i]) {
+                                if (!n_busy++ || n_blocks[i] < k)
+                                        k = n_blocks[i];
+                                busy = i;
+                        }
+                }
+                if (n_busy < 2)
+                        break;
+
+                for (i = 0; i < n_width; ++i) {
+                        if (i < n_lanes && n_blocks[i]) {
+                                h[i] = shas[i]->h;
+                                p[i] = q[i];
+                        } else {
+                                h[i] = scratch;
+                                p[i] = q[busy];
+                        }
+                }
+
+                if (avx2)
+                        c_efi_sha512_x4_avx2(h, p, k);
+                else
+                        c_efi_sha512_x2_sse2(h, p, k);
+
+                for (i = 0; i < n_lanes; ++i) {
+                        if (n_blocks[i]) {
+                                q[i] += k * C_EFI_SHA384_BLOCK_SIZE;
+                                shas[i]->n_total += k * C_EFI_SHA384_BLOCK_SIZE;
+                                n_blocks[i] -= k;
+                        }
+                }
+        }
+
+        for (i = 0; i < n_lanes; ++i)
+                c_efi_sha384_update(shas[i], q[i], n[i] - (q[i] - (const CEfiU8 *)data[i]));
+}
+
+#endif
+
+/**
+ * c_efi_sha256_update_multi() - Hash data into several SHA-256 states
+ * @shas:               states to update
+ * @data:               data to hash, one entry per state
+ * @n:                  size of each entry of @data in bytes
+ * @n_shas:             number of states
+ *
+ * This is equivalent to calling c_efi_sha256_update() on each state with its
+ * own data, but hashes the messages side by side where the CPU can do that
+ * faster. The states must be distinct. Messages of different sizes are fine,
+ * the longer ones continue with fewer lanes once shorter ones run out.
+ */
+static inline void c_efi_sha256_update_multi(CEfiSha256 *const *shas,
+                                             const void *const *data,
+                                             const CEfiUSize *n,
+                                             CEfiUSize n_shas) {
+        CEfiUSize i;
+
+#if defined(__x86_64__)
+        CEfiUSize n_width;
+        CEfiBool avx2;
+
+        if (n_shas > 1 && !c_efi_sha256_has_insn() && c_efi_sha2_has_sse()) {
+                avx2 = c_efi_sha2_has_avx2();
+                n_width = avx2 ? 8 : 4;
+                for (i = 0; i < n_shas; i += n_width)
+                        c_efi_sha256_lanes(shas + i, data + i, n + i,
+                                           n_shas - i < n_width ? n_shas - i : n_width, avx2);
+                return;
+        }
+#endif
+
+        for (i = 0; i < n_shas; ++i)
+                c_efi_sha256_update(shas[i], data[i], n[i]);
+}
+
+/**
+ * c_efi_sha384_update_multi() - Hash data into several SHA-384 states
+ * @shas:               states to update
+ * @data:               data to hash, one entry per state
+ * @n:                  size of each entry of @data in bytes
+ * @n_shas:             number of states
+ *
+ * This is the SHA-384 counterpart of c_efi_sha256_update_multi().
+ */
+static inline void c_efi_sha384_update_multi(CEfiSha384 *const *shas,
+                                             const void *const *data,
+                                             const CEfiUSize *n,
+                                             CEfiUSize n_shas) {
+        CEfiUSize i;
+
+#if defined(__x86_64__)
+        CEfiUSize n_width;
+        CEfiBool avx2;
+
+        if (n_shas > 1 && c_efi_sha2_has_sse()) {
+                avx2 = c_efi_sha2_has_avx2();
+                n_width = avx2 ? 4 : 2;
+                for (i = 0; i < n_shas; i += n_width)
+                        c_efi_sha384_lanes(shas + i, data + i, n + i,
+                                           n_shas - i < n_width ? n_shas - i : n_width, avx2);
+                return;
+        }
+#endif
+
+        for (i = 0; i < n_shas; ++i)
+                c_efi_sha384_update(shas[i], data[i], n[i]);
+}
+
+#ifdef __cplusplus
+}
+#endif
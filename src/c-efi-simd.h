@@ -0,0 +1,394 @@
+#pragma once
+
+/**
+ * SIMD State Initialization
+ *
+ * The default cross-files compile without MMX and SSE, since some firmware
+ * fails to initialize the floating-point units before handing control to
+ * applications, even though the specification requires it. This header
+ * provides the runtime support for images built with the SIMD cross-files:
+ *
+ *  - c_efi_simd_cpu_features() queries CPUID for the available extensions.
+ *
+ *  - c_efi_simd_enable() brings CR0, CR4, XCR0, the x87 control word and
+ *    MXCSR into the state mandated by the specification, and records the
+ *    previous state. It must be called at the top of `efi_main()`, before any
+ *    SIMD code runs. c_efi_simd_restore() reverts it before returning to the
+ *    firmware.
+ *
+ *  - c_efi_simd_save() and c_efi_simd_load() preserve the register file
+ *    around callbacks invoked by the firmware (event notification functions,
+ *    protocol members), which may interrupt other code that uses SIMD
+ *    registers without preserving them.
+ *
+ * Only x86-64 is supported. On other architectures, the helpers report
+ * C_EFI_UNSUPPORTED and no features, so callers fall back to scalar code.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+
+#define C_EFI_SIMD_SSE2                 C_EFI_U32_C(0x00000001)
+#define C_EFI_SIMD_SSSE3                C_EFI_U32_C(0x00000002)
+#define C_EFI_SIMD_SSE4_2               C_EFI_U32_C(0x00000004)
+#define C_EFI_SIMD_PCLMULQDQ            C_EFI_U32_C(0x00000008)
+#define C_EFI_SIMD_AVX                  C_EFI_U32_C(0x00000010)
+#define C_EFI_SIMD_AVX2                 C_EFI_U32_C(0x00000020)
+#define C_EFI_SIMD_SHA                  C_EFI_U32_C(0x00000040)
+
+#define C_EFI_SIMD_CR0_MP               C_EFI_U64_C(0x0000000000000002)
+#define C_EFI_SIMD_CR0_EM               C_EFI_U64_C(0x0000000000000004)
+#define C_EFI_SIMD_CR0_TS               C_EFI_U64_C(0x0000000000000008)
+#define C_EFI_SIMD_CR0_NE               C_EFI_U64_C(0x0000000000000020)
+#define C_EFI_SIMD_CR4_OSFXSR           C_EFI_U64_C(0x0000000000000200)
+#define C_EFI_SIMD_CR4_OSXMMEXCPT       C_EFI_U64_C(0x0000000000000400)
+#define C_EFI_SIMD_CR4_OSXSAVE          C_EFI_U64_C(0x0000000000040000)
+#define C_EFI_SIMD_XCR0_X87             C_EFI_U64_C(0x0000000000000001)
+#define C_EFI_SIMD_XCR0_SSE             C_EFI_U64_C(0x0000000000000002)
+#define C_EFI_SIMD_XCR0_AVX             C_EFI_U64_C(0x0000000000000004)
+
+#define C_EFI_SIMD_FCW_DEFAULT          C_EFI_U16_C(0x037f)
+#define C_EFI_SIMD_MXCSR_DEFAULT        C_EFI_U32_C(0x00001f80)
+
+/**
+ * CEfiSimdState: Saved SIMD Control State
+ * @cr0:                CR0 on entry
+ * @cr4:                CR4 on entry
+ * @xcr0:               XCR0 on entry, 0 if XSAVE was disabled
+ * @mxcsr:              MXCSR on entry, only valid if @cr4 had OSFXSR set
+ * @fcw:                x87 control word on entry, only valid if @cr0 had EM
+ *                      and TS cleared
+ * @reserved:           reserved, must be 0
+ * @features:           C_EFI_SIMD_* features usable after enabling
+ *
+ * This records the control state found on entry by c_efi_simd_enable(), so
+ * c_efi_simd_restore() can return it to the firmware unchanged.
+ */
+typedef struct CEfiSimdState {
+        CEfiU64 cr0;
+        CEfiU64 cr4;
+        CEfiU64 xcr0;
+        CEfiU32 mxcsr;
+        CEfiU16 fcw;
+        CEfiU16 reserved;
+        CEfiU32 features;
+} CEfiSimdState;
+
+/**
+ * CEfiSimdFrame: Saved SIMD Register File
+ * @area:               FXSAVE/XSAVE area
+ * @mask:               XSAVE component mask, 0 if FXSAVE was used
+ * @features:           features the frame was saved with
+ *
+ * Callers usually place this on the stack of a callback. The area covers the
+ * legacy region, the XSAVE header and the AVX component.
+ */
+typedef struct CEfiSimdFrame {
+        CEfiU8 area[1024] __attribute__((aligned(64)));
+        CEfiU64 mask;
+        CEfiU32 features;
+} CEfiSimdFrame;
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * c_efi_simd_cpuid() - Query CPUID
+ * @leaf:               leaf to query, in EAX
+ * @subleaf:            sub-leaf to query, in ECX
+ * @regs:               output argument for EAX, EBX, ECX and EDX
+ *
+ * This is the CPUID helper of all headers, including those unrelated to SIMD.
+ * Unlike the rest of this header, it is available on 32-bit x86 as well.
+ */
+static inline void c_efi_simd_cpuid(CEfiU32 leaf, CEfiU32 subleaf, CEfiU32 regs[4]) {
+        __asm__ __volatile__ (
+                "cpuid"
+                : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+                : "a" (leaf), "c" (subleaf)
+        );
+}
+
+#endif
+
+#if defined(__x86_64__)
+
+static inline CEfiU64 c_efi_simd_xgetbv(CEfiU32 index) {
+        CEfiU32 lo, hi;
+
+        __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (index));
+        return ((CEfiU64)hi << 32) | lo;
+}
+
+static inline void c_efi_simd_xsetbv(CEfiU32 index, CEfiU64 v) {
+        __asm__ __volatile__ ("xsetbv" : : "c" (index), "a" ((CEfiU32)v), "d" ((CEfiU32)(v >> 32)) : "memory");
+}
+
+static inline CEfiU64 c_efi_simd_read_cr0(void) {
+        CEfiU64 v;
+
+        __asm__ __volatile__ ("mov %%cr0, %0" : "=r" (v));
+        return v;
+}
+
+static inline void c_efi_simd_write_cr0(CEfiU64 v) {
+        __asm__ __volatile__ ("mov %0, %%cr0" : : "r" (v) : "memory");
+}
+
+static inline CEfiU64 c_efi_simd_read_cr4(void) {
+        CEfiU64 v;
+
+        __asm__ __volatile__ ("mov %%cr4, %0" : "=r" (v));
+        return v;
+}
+
+static inline void c_efi_simd_write_cr4(CEfiU64 v) {
+        __asm__ __volatile__ ("mov %0, %%cr4" : : "r" (v) : "memory");
+}
+
+/**
+ * c_efi_simd_cpu_features() - Query SIMD features of the CPU
+ *
+ * This queries CPUID for the SIMD extensions implemented by the CPU. AVX and
+ * AVX2 are only reported if the CPU supports XSAVE. CPUID is unprivileged,
+ * so this can be used before c_efi_simd_enable() to decide whether to enable
+ * SIMD at all.
+ *
+ * Note that this does not tell whether the extensions are currently enabled.
+ * Use the @features field of CEfiSimdState for that.
+ *
+ * Return: Mask of C_EFI_SIMD_* features implemented by the CPU.
+ */
+static inline CEfiU32 c_efi_simd_cpu_features(void) {
+        CEfiU32 regs[4], max, features = 0;
+
+        c_efi_simd_cpuid(0, 0, regs);
+        max = regs[0];
+
+        c_efi_simd_cpuid(1, 0, regs);
+        if (regs[3] & (C_EFI_U32_C(1) << 26))
+                features |= C_EFI_SIMD_SSE2;
+        if (regs[2] & (C_EFI_U32_C(1) << 9))
+                features |= C_EFI_SIMD_SSSE3;
+        if (regs[2] & (C_EFI_U32_C(1) << 20))
+                features |= C_EFI_SIMD_SSE4_2;
+        if (regs[2] & (C_EFI_U32_C(1) << 1))
+                features |= C_EFI_SIMD_PCLMULQDQ;
+
+        /* AVX requires XSAVE support to manage the upper halves */
+        if ((regs[2] & (C_EFI_U32_C(1) << 26)) && (regs[2] & (C_EFI_U32_C(1) << 28)))
+                features |= C_EFI_SIMD_AVX;
+
+        if (max >= 7) {
+                c_efi_simd_cpuid(7, 0, regs);
+                if ((features & C_EFI_SIMD_AVX) && (regs[1] & (C_EFI_U32_C(1) << 5)))
+                        features |= C_EFI_SIMD_AVX2;
+                if (regs[1] & (C_EFI_U32_C(1) << 29))
+                        features |= C_EFI_SIMD_SHA;
+        }
+
+        return features;
+}
+
+/**
+ * c_efi_simd_cpu_features_cached() - Query SIMD features of the CPU, cached
+ *
+ * This is like c_efi_simd_cpu_features() but caches the result, since CPUID
+ * is serializing and traps to the hypervisor on virtual machines. Use this
+ * for dispatching kernels on hot paths. The cache is local to each
+ * translation unit.
+ *
+ * Return: Mask of C_EFI_SIMD_* features implemented by the CPU.
+ */
+static inline CEfiU32 c_efi_simd_cpu_features_cached(void) {
+        static CEfiU32 cache;
+        CEfiU32 v;
+
+        /* bit 31 marks the cache as valid */
+        v = __atomic_load_n(&cache, __ATOMIC_RELAXED);
+        if (!v) {
+                v = c_efi_simd_cpu_features() | C_EFI_U32_C(0x80000000);
+                __atomic_store_n(&cache, v, __ATOMIC_RELAXED);
+        }
+
+        return v & ~C_EFI_U32_C(0x80000000);
+}
+
+/**
+ * c_efi_simd_enable() - Enable SIMD state
+ * @state:              state object to record the entry state in
+ * @features:           mask of C_EFI_SIMD_* features to enable
+ *
+ * This enables the requested SIMD features, limited to those implemented by
+ * the CPU. CR0.EM and CR0.TS are cleared, CR0.MP and CR0.NE set, and
+ * CR4.OSFXSR and CR4.OSXMMEXCPT are set. If AVX is requested, CR4.OSXSAVE is
+ * set and XCR0 extended by the SSE and AVX components. The x87 control word
+ * and MXCSR are loaded with the defaults of the specification.
+ *
+ * This must run at ring 0, which is the case for all UEFI applications and
+ * drivers. The previous state is recorded in @state and can be restored via
+ * c_efi_simd_restore().
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_UNSUPPORTED if the CPU lacks SSE2.
+ */
+static inline CEfiStatus c_efi_simd_enable(CEfiSimdState *state, CEfiU32 features) {
+        CEfiU64 cr0, cr4, xcr0;
+        CEfiU32 mxcsr = C_EFI_SIMD_MXCSR_DEFAULT;
+        CEfiU16 fcw = C_EFI_SIMD_FCW_DEFAULT;
+
+        *state = (CEfiSimdState){ 0 };
+
+        features &= c_efi_simd_cpu_features();
+        if (!(features & C_EFI_SIMD_SSE2))
+                return C_EFI_UNSUPPORTED;
+        if (!(features & C_EFI_SIMD_AVX))
+                features &= ~C_EFI_SIMD_AVX2;
+
+        cr0 = c_efi_simd_read_cr0();
+        cr4 = c_efi_simd_read_cr4();
+        state->cr0 = cr0;
+        state->cr4 = cr4;
+
+        /* only touch the FPU state if it was accessible before */
+        if (!(cr0 & (C_EFI_SIMD_CR0_EM | C_EFI_SIMD_CR0_TS)))
+                __asm__ __volatile__ ("fnstcw %0" : "=m" (state->fcw));
+        if (cr4 & C_EFI_SIMD_CR4_OSFXSR)
+                __asm__ __volatile__ ("stmxcsr %0" : "=m" (state->mxcsr));
+        if (cr4 & C_EFI_SIMD_CR4_OSXSAVE)
+                state->xcr0 = c_efi_simd_xgetbv(0);
+
+        cr0 &= ~(C_EFI_SIMD_CR0_EM | C_EFI_SIMD_CR0_TS);
+        cr0 |= C_EFI_SIMD_CR0_MP | C_EFI_SIMD_CR0_NE;
+        cr4 |= C_EFI_SIMD_CR4_OSFXSR | C_EFI_SIMD_CR4_OSXMMEXCPT;
+        if (features & C_EFI_SIMD_AVX)
+                cr4 |= C_EFI_SIMD_CR4_OSXSAVE;
+
+        if (cr0 != state->cr0)
+                c_efi_simd_write_cr0(cr0);
+        if (cr4 != state->cr4)
+                c_efi_simd_write_cr4(cr4);
+
+        if (features & C_EFI_SIMD_AVX) {
+                xcr0 = state->xcr0 | C_EFI_SIMD_XCR0_X87 | C_EFI_SIMD_XCR0_SSE | C_EFI_SIMD_XCR0_AVX;
+                if (xcr0 != state->xcr0)
+                        c_efi_simd_xsetbv(0, xcr0);
+        }
+
+        __asm__ __volatile__ ("fninit\n\tfldcw %0" : : "m" (fcw));
+        __asm__ __volatile__ ("ldmxcsr %0" : : "m" (mxcsr));
+
+        state->features = features;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_simd_restore() - Restore SIMD state
+ * @state:              state recorded by c_efi_simd_enable()
+ *
+ * This reverts the changes of c_efi_simd_enable(). The SIMD registers are not
+ * cleared, callers must not leave secrets in them. No SIMD code must run
+ * after this returns.
+ */
+static inline void c_efi_simd_restore(const CEfiSimdState *state) {
+        if (!state->features)
+                return;
+
+        if (!(state->cr0 & (C_EFI_SIMD_CR0_EM | C_EFI_SIMD_CR0_TS)))
+                __asm__ __volatile__ ("fldcw %0" : : "m" (state->fcw));
+        if (state->cr4 & C_EFI_SIMD_CR4_OSFXSR)
+                __asm__ __volatile__ ("ldmxcsr %0" : : "m" (state->mxcsr));
+
+        if ((state->features & C_EFI_SIMD_AVX) && (state->cr4 & C_EFI_SIMD_CR4_OSXSAVE))
+                c_efi_simd_xsetbv(0, state->xcr0);
+
+        if (c_efi_simd_read_cr4() != state->cr4)
+                c_efi_simd_write_cr4(state->cr4);
+        if (c_efi_simd_read_cr0() != state->cr0)
+                c_efi_simd_write_cr0(state->cr0);
+}
+
+/**
+ * c_efi_simd_save() - Save SIMD register file
+ * @frame:              frame to save into
+ * @features:           features in use, usually from CEfiSimdState
+ *
+ * This saves the x87, SSE and, if @features includes AVX, the AVX register
+ * state into @frame. Callbacks invoked by the firmware use this on entry
+ * before running SIMD code, and c_efi_simd_load() before returning.
+ */
+static inline void c_efi_simd_save(CEfiSimdFrame *frame, CEfiU32 features) {
+        CEfiUSize i;
+        CEfiU64 mask;
+
+        frame->features = features;
+        frame->mask = 0;
+
+        if (features & C_EFI_SIMD_AVX) {
+                /* XRSTOR faults on stale data in the reserved header bytes */
+                for (i = 0; i < 8; ++i)
+                        ((CEfiU64 *)(frame->area + 512))[i] = 0;
+                mask = C_EFI_SIMD_XCR0_X87 | C_EFI_SIMD_XCR0_SSE | C_EFI_SIMD_XCR0_AVX;
+                frame->mask = mask;
+                __asm__ __volatile__ (
+                        "xsave %0"
+                        : "=m" (frame->area)
+                        : "a" ((CEfiU32)mask), "d" ((CEfiU32)(mask >> 32))
+                        : "memory"
+                );
+        } else if (features & C_EFI_SIMD_SSE2) {
+                __asm__ __volatile__ ("fxsave %0" : "=m" (frame->area) : : "memory");
+        }
+}
+
+/**
+ * c_efi_simd_load() - Load SIMD register file
+ * @frame:              frame previously saved via c_efi_simd_save()
+ *
+ * This restores the register state saved in @frame.
+ */
+static inline void c_efi_simd_load(const CEfiSimdFrame *frame) {
+        if (frame->mask) {
+                __asm__ __volatile__ (
+                        "xrstor %0"
+                        :
+                        : "m" (frame->area), "a" ((CEfiU32)frame->mask), "d" ((CEfiU32)(frame->mask >> 32))
+                        : "memory"
+                );
+        } else if (frame->features & C_EFI_SIMD_SSE2) {
+                __asm__ __volatile__ ("fxrstor %0" : : "m" (frame->area) : "memory");
+        }
+}
+
+#else
+
+static inline CEfiU32 c_efi_simd_cpu_features(void) {
+        return 0;
+}
+
+static inline CEfiU32 c_efi_simd_cpu_features_cached(void) {
+        return 0;
+}
+
+static inline CEfiStatus c_efi_simd_enable(CEfiSimdState *state, CEfiU32 features) {
+        *state = (CEfiSimdState){ 0 };
+        return C_EFI_UNSUPPORTED;
+}
+
+static inline void c_efi_simd_restore(const CEfiSimdState *state) {
+}
+
+static inline void c_efi_simd_save(CEfiSimdFrame *frame, CEfiU32 features) {
+        frame->mask = 0;
+        frame->features = 0;
+}
+
+static inline void c_efi_simd_load(const CEfiSimdFrame *frame) {
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,378 @@
+#pragma once
+
+/**
+ * Cross-Processor Synchronization
+ *
+ * Raising the TPL to C_EFI_TPL_HIGH_LEVEL serializes code against event
+ * notifications on the BSP, but not against application processors, which
+ * run regardless of the TPL of the BSP. It also holds off the timer, and
+ * thus every other notification, for as long as it is raised. This header
+ * provides primitives built on atomic operations instead, which work across
+ * processors and need no firmware calls:
+ *
+ *  - CEfiSpinLock is a ticket lock. Waiters are served in arrival order, so
+ *    no processor starves. Event notifications on the BSP that take a lock
+ *    also taken at a lower TPL would deadlock against it, so such locks must
+ *    be taken with c_efi_spin_lock_tpl() on the BSP, which raises the TPL to
+ *    that of the notifications first. APs take locks directly, since they
+ *    must not call boot services.
+ *
+ *  - CEfiSpscQueue is a bounded ring for one producer and one consumer. Each
+ *    side caches the index of the other side, so it touches the shared
+ *    cache line only when the ring appears full or empty.
+ *
+ *  - CEfiMpscQueue is a bounded ring for any number of producers and one
+ *    consumer. Producers claim cells with a compare-and-swap, and publish
+ *    them with a per-cell sequence number. Neither side ever waits, so
+ *    producers may run in event notifications, which interrupt other
+ *    producers on the same processor. A cell claimed by an interrupted
+ *    producer makes the consumer see an empty ring until it is published.
+ *
+ * Queue entries are pointer-sized values. All primitives keep counters of
+ * contention, which are meant for instrumentation and are only exact once
+ * all users are quiescent.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+/**
+ * c_efi_sync_relax() - Hint a busy-wait to the CPU
+ *
+ * This yields pipeline resources to sibling hardware threads and saves
+ * power while spinning, with `pause` on x86 and `yield` on ARM.
+ */
+static inline void c_efi_sync_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        __asm__ __volatile__ ("pause" : : : "memory");
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__ ("yield" : : : "memory");
+#else
+        __asm__ __volatile__ ("" : : : "memory");
+#endif
+}
+
+/**
+ * CEfiSpinLock: Ticket Spinlock
+ * @next:               next ticket to hand out
+ * @owner:              ticket currently holding the lock
+ * @n_acquired:         number of acquisitions
+ * @n_contended:        number of acquisitions that had to wait
+ * @n_spins:            number of polls of the lock while waiting
+ *
+ * A zeroed lock is unlocked. The counters are updated by the holder.
+ */
+typedef struct CEfiSpinLock {
+        CEfiU32 next;
+        CEfiU32 owner;
+        CEfiU64 n_acquired;
+        CEfiU64 n_contended;
+        CEfiU64 n_spins;
+} CEfiSpinLock;
+
+#define C_EFI_SPIN_LOCK_INIT { 0 }
+
+/**
+ * c_efi_spin_lock() - Acquire spinlock
+ * @lock:               lock to acquire
+ *
+ * This takes a ticket and waits until it is served. The wait is
+ * proportional to the number of waiters ahead, to keep the polling of the
+ * lock word from slowing down the holder.
+ */
+static inline void c_efi_spin_lock(CEfiSpinLock *lock) {
+        CEfiU32 ticket, owner, i;
+        CEfiU64 spins = 0;
+
+        ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+        for (;;) {
+                owner = __atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE);
+                if (owner == ticket)
+                        break;
+                for (i = ticket - owner; i; --i)
+                        c_efi_sync_relax();
+                ++spins;
+        }
+
+        ++lock->n_acquired;
+        if (spins) {
+                ++lock->n_contended;
+                lock->n_spins += spins;
+        }
+}
+
+/**
+ * c_efi_spin_trylock() - Acquire spinlock if free
+ * @lock:               lock to acquire
+ *
+ * Return: True if the lock was acquired, false if it is held.
+ */
+static inline CEfiBool c_efi_spin_trylock(CEfiSpinLock *lock) {
+        CEfiU32 owner, next;
+
+        owner = __atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE);
+        next = owner;
+        if (!__atomic_compare_exchange_n(&lock->next, &next, owner + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return 0;
+
+        ++lock->n_acquired;
+        return 1;
+}
+
+/**
+ * c_efi_spin_unlock() - Release spinlock
+ * @lock:               lock to release
+ *
+ * This serves the next ticket. It must be called by the holder.
+ */
+static inline void c_efi_spin_unlock(CEfiSpinLock *lock) {
+        __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * c_efi_spin_lock_tpl() - Raise TPL and acquire spinlock
+ * @lock:               lock to acquire
+ * @bs:                 boot services
+ * @tpl:                TPL of the notifications taking @lock
+ *
+ * This raises the TPL before taking @lock, so no notification that takes
+ * @lock can interrupt the holder on the same processor. It must only be
+ * called on the BSP.
+ *
+ * Return: The previous TPL, to be passed to c_efi_spin_unlock_tpl().
+ */
+static inline CEfiTpl c_efi_spin_lock_tpl(CEfiSpinLock *lock, CEfiBootServices *bs, CEfiTpl tpl) {
+        CEfiTpl old;
+
+        old = bs->raise_tpl(tpl);
+        c_efi_spin_lock(lock);
+        return old;
+}
+
+/**
+ * c_efi_spin_unlock_tpl() - Release spinlock and restore TPL
+ * @lock:               lock to release
+ * @bs:                 boot services
+ * @old:                TPL returned by c_efi_spin_lock_tpl()
+ */
+static inline void c_efi_spin_unlock_tpl(CEfiSpinLock *lock, CEfiBootServices *bs, CEfiTpl old) {
+        c_efi_spin_unlock(lock);
+        bs->restore_tpl(old);
+}
+
+/**
+ * CEfiSpscQueue: Single-Producer Single-Consumer Queue
+ * @slots:              storage of the ring
+ * @mask:               number of slots minus 1
+ * @head:               index of the next entry to pop, consumer only
+ * @tail_cache:         last seen value of @tail, consumer only
+ * @n_empty:            number of pops from an empty ring, consumer only
+ * @tail:               index of the next entry to push, producer only
+ * @head_cache:         last seen value of @head, producer only
+ * @n_full:             number of pushes to a full ring, producer only
+ *
+ * Both sides have a cache line of their own.
+ */
+typedef struct CEfiSpscQueue {
+        _Alignas(64) CEfiUSize *slots;
+        CEfiUSize mask;
+        _Alignas(64) CEfiUSize head;
+        CEfiUSize tail_cache;
+        CEfiU64 n_empty;
+        _Alignas(64) CEfiUSize tail;
+        CEfiUSize head_cache;
+        CEfiU64 n_full;
+} CEfiSpscQueue;
+
+/**
+ * c_efi_spsc_init() - Initialize single-producer queue
+ * @q:                  queue to initialize
+ * @slots:              storage for the ring
+ * @n_slots:            number of entries in @slots, a power of 2
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_slots
+ *         is not a power of 2.
+ */
+static inline CEfiStatus c_efi_spsc_init(CEfiSpscQueue *q, CEfiUSize *slots, CEfiUSize n_slots) {
+        if (!n_slots || (n_slots & (n_slots - 1)))
+                return C_EFI_INVALID_PARAMETER;
+
+        *q = (CEfiSpscQueue){ .slots = slots, .mask = n_slots - 1 };
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_spsc_push() - Push entry to single-producer queue
+ * @q:                  queue to push to
+ * @value:              entry to push
+ *
+ * This must only be called by the producer.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_OUT_OF_RESOURCES if the ring is
+ *         full.
+ */
+static inline CEfiStatus c_efi_spsc_push(CEfiSpscQueue *q, CEfiUSize value) {
+        CEfiUSize tail = q->tail;
+
+        if (tail - q->head_cache > q->mask) {
+                q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+                if (tail - q->head_cache > q->mask) {
+                        ++q->n_full;
+                        return C_EFI_OUT_OF_RESOURCES;
+                }
+        }
+
+        q->slots[tail & q->mask] = value;
+        __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_spsc_pop() - Pop entry from single-producer queue
+ * @q:                  queue to pop from
+ * @valuep:             output variable for the entry
+ *
+ * This must only be called by the consumer.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_READY if the ring is empty.
+ */
+static inline CEfiStatus c_efi_spsc_pop(CEfiSpscQueue *q, CEfiUSize *valuep) {
+        CEfiUSize head = q->head;
+
+        if (head == q->tail_cache) {
+                q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+                if (head == q->tail_cache) {
+                        ++q->n_empty;
+                        return C_EFI_NOT_READY;
+                }
+        }
+
+        *valuep = q->slots[head & q->mask];
+        __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * CEfiMpscCell: Cell of a Multi-Producer Queue
+ * @sequence:           index the cell is ready to be pushed at, or that
+ *                      plus 1 once it is ready to be popped
+ * @value:              entry of the cell
+ */
+typedef struct CEfiMpscCell {
+        CEfiUSize sequence;
+        CEfiUSize value;
+} CEfiMpscCell;
+
+/**
+ * CEfiMpscQueue: Multi-Producer Single-Consumer Queue
+ * @cells:              storage of the ring
+ * @mask:               number of cells minus 1
+ * @tail:               index of the next cell to claim, shared by producers
+ * @n_retries:          number of claims lost to other producers
+ * @n_full:             number of pushes to a full ring
+ * @head:               index of the next entry to pop, consumer only
+ * @n_empty:            number of pops from an empty ring, consumer only
+ */
+typedef struct CEfiMpscQueue {
+        _Alignas(64) CEfiMpscCell *cells;
+        CEfiUSize mask;
+        _Alignas(64) CEfiUSize tail;
+        CEfiU64 n_retries;
+        CEfiU64 n_full;
+        _Alignas(64) CEfiUSize head;
+        CEfiU64 n_empty;
+} CEfiMpscQueue;
+
+/**
+ * c_efi_mpsc_init() - Initialize multi-producer queue
+ * @q:                  queue to initialize
+ * @cells:              storage for the ring
+ * @n_cells:            number of entries in @cells, a power of 2
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_cells
+ *         is not a power of 2.
+ */
+static inline CEfiStatus c_efi_mpsc_init(CEfiMpscQueue *q, CEfiMpscCell *cells, CEfiUSize n_cells) {
+        CEfiUSize i;
+
+        if (!n_cells || (n_cells & (n_cells - 1)))
+                return C_EFI_INVALID_PARAMETER;
+
+        *q = (CEfiMpscQueue){ .cells = cells, .mask = n_cells - 1 };
+        for (i = 0; i < n_cells; ++i)
+                cells[i] = (CEfiMpscCell){ .sequence = i };
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_mpsc_push() - Push entry to multi-producer queue
+ * @q:                  queue to push to
+ * @value:              entry to push
+ *
+ * This may be called by any number of producers at once, on any processor
+ * and at any TPL.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_OUT_OF_RESOURCES if the ring is
+ *         full.
+ */
+static inline CEfiStatus c_efi_mpsc_push(CEfiMpscQueue *q, CEfiUSize value) {
+        CEfiUSize pos, seq;
+        CEfiMpscCell *cell;
+        CEfiISize diff;
+
+        pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        for (;;) {
+                cell = &q->cells[pos & q->mask];
+                seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+                diff = (CEfiISize)(seq - pos);
+                if (!diff) {
+                        if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                                break;
+                } else if (diff < 0) {
+                        /* the consumer has not popped the previous round yet */
+                        __atomic_fetch_add(&q->n_full, 1, __ATOMIC_RELAXED);
+                        return C_EFI_OUT_OF_RESOURCES;
+                } else {
+                        pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+                }
+                __atomic_fetch_add(&q->n_retries, 1, __ATOMIC_RELAXED);
+        }
+
+        cell->value = value;
+        __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_mpsc_pop() - Pop entry from multi-producer queue
+ * @q:                  queue to pop from
+ * @valuep:             output variable for the entry
+ *
+ * This must only be called by the consumer. Entries of each producer are
+ * popped in the order they were pushed.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_NOT_READY if the ring is empty,
+ *         or the next entry is not published yet.
+ */
+static inline CEfiStatus c_efi_mpsc_pop(CEfiMpscQueue *q, CEfiUSize *valuep) {
+        CEfiMpscCell *cell = &q->cells[q->head & q->mask];
+
+        if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != q->head + 1) {
+                ++q->n_empty;
+                return C_EFI_NOT_READY;
+        }
+
+        *valuep = cell->value;
+        __atomic_store_n(&cell->sequence, q->head + q->mask + 1, __ATOMIC_RELEASE);
+        ++q->head;
+        return C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -146,9 +146,9 @@ typedef struct CEfiCapsuleBlockDescriptor {
         };
 } CEfiCapsuleBlockDescriptor;
 
-#define C_EFI_CAPSULE_FLAGS_PERSIST_ACROSS_RESET        C_EFI_U32(0x00010000)
-#define C_EFI_CAPSULE_FLAGS_POPULATE_SYSTEM_TABLE       C_EFI_U32(0x00020000)
-#define C_EFI_CAPSULE_FLAGS_INITIATE_RESET              C_EFI_U32(0x00040000)
+#define C_EFI_CAPSULE_FLAGS_PERSIST_ACROSS_RESET        C_EFI_U32_C(0x00010000)
+#define C_EFI_CAPSULE_FLAGS_POPULATE_SYSTEM_TABLE       C_EFI_U32_C(0x00020000)
+#define C_EFI_CAPSULE_FLAGS_INITIATE_RESET              C_EFI_U32_C(0x00040000)
 
 typedef struct CEfiCapsuleHeader {
         CEfiGuid capsule_guid;
@@ -0,0 +1,261 @@
+#pragma once
+
+/**
+ * Time Conversion and Cached Wall-Clock
+ *
+ * This header converts between CEfiTime and nanoseconds since the Unix epoch,
+ * and provides a wall-clock that calls the `get_time` runtime service only
+ * once and extrapolates from the CPU counter afterwards.
+ *
+ * The conversion uses the days-from-civil algorithm of Howard Hinnant, which
+ * is a fixed sequence of integer operations without data-dependent branches.
+ * Only validation of the input branches.
+ *
+ * CEfiTime carries the offset of local time from UTC in minutes, following
+ * the current specification: `Localtime = UTC + TimeZone`. If
+ * C_EFI_TIME_IN_DAYLIGHT is set, local time is one more hour ahead. A
+ * timezone of C_EFI_UNSPECIFIED_TIMEZONE is taken as UTC, which is what
+ * operating systems assume for the RTC as well.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-clock.h>
+
+#define C_EFI_TIME_NSEC_PER_SEC C_EFI_I64_C(1000000000)
+
+/* 1677-09-21 to 2262-04-11 is representable as 64-bit nanoseconds */
+#define C_EFI_TIME_EPOCH_SEC_MIN (-(C_EFI_I64_C(0x7fffffffffffffff) / C_EFI_TIME_NSEC_PER_SEC))
+#define C_EFI_TIME_EPOCH_SEC_MAX (C_EFI_I64_C(0x7fffffffffffffff) / C_EFI_TIME_NSEC_PER_SEC - 1)
+
+/**
+ * CEfiWallClock: Cached Wall-Clock
+ * @rt:                 runtime services, used if the counter frequency is 0
+ * @base_ns:            wall-clock time at the start of @counter, in ns since
+ *                      the epoch
+ * @counter:            monotonic clock started at @base_ns
+ * @timezone:           timezone reported by the firmware
+ * @daylight:           daylight flags reported by the firmware
+ *
+ * This caches a single `get_time` result, and extrapolates the current time
+ * from the CPU counter via CEfiClock. If the counter frequency is unknown, every
+ * read falls back to `get_time`.
+ */
+typedef struct CEfiWallClock {
+        CEfiRuntimeServices *rt;
+        CEfiI64 base_ns;
+        CEfiClock counter;
+        CEfiI16 timezone;
+        CEfiU8 daylight;
+} CEfiWallClock;
+
+static inline CEfiI64 c_efi_time_days_from_civil(CEfiI64 y, CEfiI64 m, CEfiI64 d) {
+        CEfiI64 era, yoe, doy, doe;
+
+        /* years start in March, so leap days are at the end */
+        y -= m <= 2;
+        era = y / 400;
+        yoe = y - era * 400;
+        doy = (153 * (m + 9 - 12 * (m > 2)) + 2) / 5 + d - 1;
+        doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+}
+
+static inline void c_efi_time_civil_from_days(CEfiI64 z, CEfiI64 *yp, CEfiI64 *mp, CEfiI64 *dp) {
+        CEfiI64 era, doe, yoe, doy, m;
+
+        z += 719468;
+        era = z / 146097;
+        doe = z - era * 146097;
+        yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        m = (5 * doy + 2) / 153;
+        *dp = doy - (153 * m + 2) / 5 + 1;
+        m = m + 3 - 12 * (m >= 10);
+        *mp = m;
+        *yp = yoe + era * 400 + (m <= 2);
+}
+
+static inline CEfiI64 c_efi_time_offset(CEfiI16 timezone, CEfiU8 daylight) {
+        return (CEfiI64)timezone * 60 * (timezone != C_EFI_UNSPECIFIED_TIMEZONE) +
+               3600 * !!(daylight & C_EFI_TIME_IN_DAYLIGHT);
+}
+
+/**
+ * c_efi_time_to_epoch_ns() - Convert CEfiTime to nanoseconds since the epoch
+ * @time:               time to convert
+ * @nsp:                output for the nanoseconds since 1970-01-01 UTC
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @time is not
+ *         a valid time, C_EFI_UNSUPPORTED if it is not representable as
+ *         64-bit nanoseconds.
+ */
+static inline CEfiStatus c_efi_time_to_epoch_ns(const CEfiTime *time, CEfiI64 *nsp) {
+        static const CEfiU8 days_in_month[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        CEfiI64 days, sec;
+        CEfiBool leap;
+
+        if (time->year < 1900 || time->year > 9999 ||
+            time->month < 1 || time->month > 12 ||
+            time->day < 1 || time->day > days_in_month[time->month - 1] ||
+            time->hour > 23 || time->minute > 59 || time->second > 59 ||
+            time->nanosecond >= C_EFI_TIME_NSEC_PER_SEC ||
+            ((time->timezone < -1440 || time->timezone > 1440) &&
+             time->timezone != C_EFI_UNSPECIFIED_TIMEZONE))
+                return C_EFI_INVALID_PARAMETER;
+
+        leap = !(time->year % 4) && ((time->year % 100) || !(time->year % 400));
+        if (time->month == 2 && time->day == 29 && !leap)
+                return C_EFI_INVALID_PARAMETER;
+
+        days = c_efi_time_days_from_civil(time->year, time->month, time->day);
+        sec = days * 86400 + time->hour * 3600 + time->minute * 60 + time->second;
+        sec -= c_efi_time_offset(time->timezone, time->daylight);
+
+        if (sec < C_EFI_TIME_EPOCH_SEC_MIN || sec > C_EFI_TIME_EPOCH_SEC_MAX)
+                return C_EFI_UNSUPPORTED;
+
+        *nsp = sec * C_EFI_TIME_NSEC_PER_SEC + time->nanosecond;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_time_from_epoch_ns() - Convert nanoseconds since the epoch to CEfiTime
+ * @ns:                 nanoseconds since 1970-01-01 UTC
+ * @timezone:           timezone of the result, or C_EFI_UNSPECIFIED_TIMEZONE
+ * @daylight:           daylight flags of the result
+ * @time:               output for the converted time
+ *
+ * This converts @ns into local time of @timezone and @daylight, which are
+ * stored in @time as well. Pass 0 or C_EFI_UNSPECIFIED_TIMEZONE, and no
+ * daylight flags, to get UTC.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @timezone is
+ *         invalid, C_EFI_UNSUPPORTED if the result is before year 1900.
+ */
+static inline CEfiStatus c_efi_time_from_epoch_ns(CEfiI64 ns, CEfiI16 timezone, CEfiU8 daylight, CEfiTime *time) {
+        CEfiI64 sec, nsec, days, rem, y, m, d;
+
+        if ((timezone < -1440 || timezone > 1440) && timezone != C_EFI_UNSPECIFIED_TIMEZONE)
+                return C_EFI_INVALID_PARAMETER;
+
+        /* floored division, so times before the epoch work */
+        sec = ns / C_EFI_TIME_NSEC_PER_SEC;
+        nsec = ns % C_EFI_TIME_NSEC_PER_SEC;
+        sec -= nsec < 0;
+        nsec += C_EFI_TIME_NSEC_PER_SEC * (nsec < 0);
+
+        sec += c_efi_time_offset(timezone, daylight);
+
+        days = sec / 86400;
+        rem = sec % 86400;
+        days -= rem < 0;
+        rem += 86400 * (rem < 0);
+
+        c_efi_time_civil_from_days(days, &y, &m, &d);
+        if (y < 1900)
+                return C_EFI_UNSUPPORTED;
+
+        *time = (CEfiTime){
+                .year = y,
+                .month = m,
+                .day = d,
+                .hour = rem / 3600,
+                .minute = rem / 60 % 60,
+                .second = rem % 60,
+                .nanosecond = nsec,
+                .timezone = timezone,
+                .daylight = daylight,
+        };
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_wall_clock_init() - Initialize cached wall-clock
+ * @clock:              clock to initialize
+ * @rt:                 runtime services
+ * @ticks_per_second:   frequency of the CPU counter, or 0 to query
+ *
+ * This reads the time once via `get_time` and records the CPU counter. If
+ * @ticks_per_second is 0, c_efi_clock_frequency() is used. Pass the result of
+ * c_efi_clock_calibrate() where that is unknown. If the frequency stays
+ * unknown, the clock falls back to `get_time` on every read.
+ *
+ * Most RTCs have a resolution of one second, so the clock has an offset of up
+ * to one second against the true time, but is precise relative to itself.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `get_time` or
+ *         c_efi_time_to_epoch_ns().
+ */
+static inline CEfiStatus c_efi_wall_clock_init(CEfiWallClock *clock, CEfiRuntimeServices *rt, CEfiU64 ticks_per_second) {
+        CEfiStatus r;
+        CEfiTime t;
+
+        *clock = (CEfiWallClock){ .rt = rt };
+
+        r = rt->get_time(&t, C_EFI_NULL);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        c_efi_clock_init(&clock->counter, ticks_per_second ? ticks_per_second : c_efi_clock_frequency());
+
+        r = c_efi_time_to_epoch_ns(&t, &clock->base_ns);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        clock->timezone = t.timezone;
+        clock->daylight = t.daylight;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_wall_clock_now() - Read cached wall-clock
+ * @clock:              clock to read
+ * @nsp:                output for the nanoseconds since 1970-01-01 UTC
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of the `get_time` fallback.
+ */
+static inline CEfiStatus c_efi_wall_clock_now(CEfiWallClock *clock, CEfiI64 *nsp) {
+        CEfiStatus r;
+        CEfiTime t;
+
+        if (!clock->counter.ticks_per_second) {
+                r = clock->rt->get_time(&t, C_EFI_NULL);
+                if (C_EFI_ERROR(r))
+                        return r;
+                return c_efi_time_to_epoch_ns(&t, nsp);
+        }
+
+        *nsp = clock->base_ns + (CEfiI64)c_efi_clock_ns(&clock->counter);
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_wall_clock_get_time() - Read cached wall-clock as CEfiTime
+ * @clock:              clock to read
+ * @time:               output for the current time
+ *
+ * This is like the `get_time` runtime service, but served from the cache. The
+ * result uses the timezone and daylight flags reported at initialization.
+ *
+ * Return: C_EFI_SUCCESS on success, or an error of c_efi_wall_clock_now() or
+ *         c_efi_time_from_epoch_ns().
+ */
+static inline CEfiStatus c_efi_wall_clock_get_time(CEfiWallClock *clock, CEfiTime *time) {
+        CEfiStatus r;
+        CEfiI64 ns;
+
+        r = c_efi_wall_clock_now(clock, &ns);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        return c_efi_time_from_epoch_ns(ns, clock->timezone, clock->daylight, time);
+}
+
+#ifdef __cplusplus
+}
+#endif
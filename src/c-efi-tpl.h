@@ -0,0 +1,164 @@
+#pragma once
+
+/**
+ * Lazy TPL Critical Sections
+ *
+ * Every `raise_tpl` and `restore_tpl` is an indirect call into firmware,
+ * and `restore_tpl` dispatches all notifications that became pending while
+ * the TPL was raised. Critical sections nest: a helper raising the TPL to
+ * protect its state is often called from code which raised it already, so
+ * most of these calls change nothing.
+ *
+ * CEfiTplGuard tracks the TPL locally instead, and skips calls that cannot
+ * change anything:
+ *
+ *  - Entering a scope at a TPL the firmware already runs at, or lower,
+ *    makes no call. Only scopes that need a higher TPL call `raise_tpl`.
+ *
+ *  - Leaving an inner scope makes no call, even if it raised the TPL. The
+ *    firmware stays at the highest TPL of all open scopes, which is always
+ *    safe, until the outermost scope is left. That calls `restore_tpl`
+ *    exactly once, if any scope raised the TPL. Pending notifications are
+ *    thus dispatched once, rather than at the end of every inner scope.
+ *
+ *  - Code that waits for notifications inside an outer scope, after an
+ *    inner scope raised the TPL above them, calls c_efi_tpl_sync() first,
+ *    which lowers the firmware TPL to that of the open scopes.
+ *
+ * A guard belongs to a single context. Notification functions interrupt
+ * the BSP at their own TPL and use guards of their own, initialized with
+ * that TPL. APs must not use guards at all, since they must not call boot
+ * services.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+
+/**
+ * CEfiTplGuard: Lazy TPL Tracker
+ * @bs:                 boot services
+ * @base:               TPL outside of all scopes
+ * @current:            TPL required by the open scopes
+ * @firmware:           TPL the firmware runs at
+ * @depth:              number of open scopes
+ * @n_raises:           number of calls to `raise_tpl`
+ * @n_restores:         number of calls to `restore_tpl`
+ * @n_elided:           number of raises and restores that made no call
+ *
+ * @firmware is never below @current. Both are @base outside of all scopes.
+ */
+typedef struct CEfiTplGuard {
+        CEfiBootServices *bs;
+        CEfiTpl base;
+        CEfiTpl current;
+        CEfiTpl firmware;
+        CEfiUSize depth;
+        CEfiU64 n_raises;
+        CEfiU64 n_restores;
+        CEfiU64 n_elided;
+} CEfiTplGuard;
+
+/**
+ * c_efi_tpl_query() - Query the current TPL
+ * @bs:                 boot services
+ *
+ * UEFI provides no way to read the TPL other than raising it. This raises
+ * the TPL to C_EFI_TPL_HIGH_LEVEL and restores it right away.
+ *
+ * Return: The TPL of the caller.
+ */
+static inline CEfiTpl c_efi_tpl_query(CEfiBootServices *bs) {
+        CEfiTpl tpl;
+
+        tpl = bs->raise_tpl(C_EFI_TPL_HIGH_LEVEL);
+        bs->restore_tpl(tpl);
+        return tpl;
+}
+
+/**
+ * c_efi_tpl_guard_init() - Initialize TPL guard
+ * @guard:              guard to initialize
+ * @bs:                 boot services
+ * @tpl:                TPL the caller runs at
+ *
+ * @tpl is C_EFI_TPL_APPLICATION in image entry points, and the TPL of the
+ * event in notification functions. Otherwise, c_efi_tpl_query() finds it.
+ */
+static inline void c_efi_tpl_guard_init(CEfiTplGuard *guard, CEfiBootServices *bs, CEfiTpl tpl) {
+        *guard = (CEfiTplGuard){ .bs = bs, .base = tpl, .current = tpl, .firmware = tpl };
+}
+
+/**
+ * c_efi_tpl_enter() - Enter a critical section
+ * @guard:              guard to operate on
+ * @tpl:                TPL the section requires
+ *
+ * This raises the firmware TPL to @tpl, unless it runs at @tpl or higher
+ * already. Unlike `raise_tpl`, @tpl may be below the current TPL, in which
+ * case the section runs at the current TPL.
+ *
+ * Return: The TPL required before, to be passed to c_efi_tpl_leave().
+ */
+static inline CEfiTpl c_efi_tpl_enter(CEfiTplGuard *guard, CEfiTpl tpl) {
+        CEfiTpl old = guard->current;
+
+        ++guard->depth;
+        if (tpl > guard->current)
+                guard->current = tpl;
+
+        if (tpl > guard->firmware) {
+                guard->bs->raise_tpl(tpl);
+                guard->firmware = tpl;
+                ++guard->n_raises;
+        } else {
+                ++guard->n_elided;
+        }
+
+        return old;
+}
+
+/**
+ * c_efi_tpl_leave() - Leave a critical section
+ * @guard:              guard to operate on
+ * @old:                TPL returned by the matching c_efi_tpl_enter()
+ *
+ * Sections must be left in reverse order of entering them. Only leaving the
+ * outermost section restores the firmware TPL, if any section raised it.
+ */
+static inline void c_efi_tpl_leave(CEfiTplGuard *guard, CEfiTpl old) {
+        guard->current = old;
+
+        if (--guard->depth || guard->firmware == guard->base) {
+                ++guard->n_elided;
+                return;
+        }
+
+        guard->bs->restore_tpl(guard->base);
+        guard->firmware = guard->base;
+        ++guard->n_restores;
+}
+
+/**
+ * c_efi_tpl_sync() - Lower the firmware TPL to the open sections
+ * @guard:              guard to operate on
+ *
+ * Inner sections leave the firmware TPL raised. This lowers it to the TPL
+ * the open sections require, which dispatches the notifications pending
+ * above that. Sections that wait for notifications call this first.
+ */
+static inline void c_efi_tpl_sync(CEfiTplGuard *guard) {
+        if (guard->firmware == guard->current)
+                return;
+
+        guard->bs->restore_tpl(guard->current);
+        guard->firmware = guard->current;
+        ++guard->n_restores;
+}
+
+#ifdef __cplusplus
+}
+#endif
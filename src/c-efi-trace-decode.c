@@ -0,0 +1,169 @@
+/*
+ * Boot Trace Decoder
+ *
+ * This is a native tool that reads a dump of a c-efi boot trace table (see
+ * c-efi-trace.h) and writes the contained events as Chrome trace JSON. On
+ * Linux, the table can be dumped from the physical address listed for its
+ * GUID in the EFI configuration tables.
+ *
+ * Usage: c-efi-trace-decode [FILE]
+ *
+ * If FILE is omitted, the dump is read from standard input. The JSON document
+ * is written to standard output. Timestamps are converted to microseconds if
+ * the table carries a counter frequency, otherwise raw ticks are emitted.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi-trace.h"
+
+static const char *category_name(uint8_t category) {
+        switch (category) {
+        case C_EFI_TRACE_CATEGORY_USER:
+                return "user";
+        case C_EFI_TRACE_CATEGORY_IMAGE_LOAD:
+                return "image-load";
+        case C_EFI_TRACE_CATEGORY_IMAGE_START:
+                return "image-start";
+        case C_EFI_TRACE_CATEGORY_PROTOCOL_OPEN:
+                return "protocol-open";
+        case C_EFI_TRACE_CATEGORY_IO:
+                return "io";
+        default:
+                return "unknown";
+        }
+}
+
+static char phase(uint8_t type) {
+        switch (type) {
+        case C_EFI_TRACE_TYPE_BEGIN:
+                return 'B';
+        case C_EFI_TRACE_TYPE_END:
+                return 'E';
+        default:
+                return 'i';
+        }
+}
+
+static int read_all(FILE *f, uint8_t **datap, size_t *sizep) {
+        uint8_t *data = NULL, *t;
+        size_t size = 0, n_alloc = 0, n;
+
+        do {
+                if (size == n_alloc) {
+                        n_alloc = n_alloc ? n_alloc * 2 : 64 * 1024;
+                        t = realloc(data, n_alloc);
+                        if (!t) {
+                                free(data);
+                                return -ENOMEM;
+                        }
+                        data = t;
+                }
+
+                n = fread(data + size, 1, n_alloc - size, f);
+                size += n;
+        } while (n > 0);
+
+        if (ferror(f)) {
+                free(data);
+                return -EIO;
+        }
+
+        *datap = data;
+        *sizep = size;
+        return 0;
+}
+
+static int decode(const uint8_t *data, size_t size, FILE *out) {
+        const CEfiTraceTable *table = (const void *)data;
+        const CEfiTraceEvent *event;
+        uint64_t first, seq;
+        const char *sep = "";
+        double ts;
+
+        if (size < sizeof(*table) ||
+            table->signature != C_EFI_TRACE_TABLE_SIGNATURE) {
+                fprintf(stderr, "Invalid trace table signature\n");
+                return -EINVAL;
+        }
+        if (table->version != C_EFI_TRACE_TABLE_VERSION ||
+            table->event_size != sizeof(CEfiTraceEvent) ||
+            table->header_size != sizeof(CEfiTraceTable)) {
+                fprintf(stderr, "Unsupported trace table version %" PRIu32 "\n", table->version);
+                return -EINVAL;
+        }
+        if (!table->n_events || (table->n_events & (table->n_events - 1)) ||
+            size < c_efi_trace_table_size(table->n_events)) {
+                fprintf(stderr, "Truncated trace table\n");
+                return -EINVAL;
+        }
+
+        first = table->head > table->n_events ? table->head - table->n_events : 0;
+
+        fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        for (seq = first; seq < table->head; ++seq) {
+                event = &table->events[seq & (table->n_events - 1)];
+
+                /* skip torn or overwritten slots */
+                if (event->sequence != seq + 1)
+                        continue;
+
+                if (table->ticks_per_second)
+                        ts = (double)event->timestamp * 1000000.0 / (double)table->ticks_per_second;
+                else
+                        ts = (double)event->timestamp;
+
+                fprintf(out,
+                        "%s\n{\"name\":\"%s:%" PRIu32 "\",\"cat\":\"%s\",\"ph\":\"%c\","
+                        "\"ts\":%.3f,\"pid\":0,\"tid\":0,%s"
+                        "\"args\":{\"seq\":%" PRIu64 ",\"arg\":\"0x%" PRIx64 "\"}}",
+                        sep,
+                        category_name(event->category), event->id,
+                        category_name(event->category),
+                        phase(event->type),
+                        ts,
+                        event->type == C_EFI_TRACE_TYPE_INSTANT ? "\"s\":\"g\"," : "",
+                        seq, event->argument);
+                sep = ",";
+        }
+        fprintf(out, "\n]}\n");
+
+        return 0;
+}
+
+int main(int argc, char **argv) {
+        uint8_t *data;
+        size_t size;
+        FILE *f;
+        int r;
+
+        if (argc > 2) {
+                fprintf(stderr, "Usage: %s [FILE]\n", argv[0]);
+                return 2;
+        }
+
+        if (argc == 2) {
+                f = fopen(argv[1], "rb");
+                if (!f) {
+                        fprintf(stderr, "Cannot open '%s': %m\n", argv[1]);
+                        return 1;
+                }
+        } else {
+                f = stdin;
+        }
+
+        r = read_all(f, &data, &size);
+        if (f != stdin)
+                fclose(f);
+        if (r < 0) {
+                fprintf(stderr, "Cannot read trace: %s\n", strerror(-r));
+                return 1;
+        }
+
+        r = decode(data, size, stdout);
+        free(data);
+        return r < 0 ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+/**
+ * Boot Trace Ring Buffer
+ *
+ * This header provides a fixed-size, lock-free ring buffer of timestamped
+ * trace events. It is meant to record begin/end events of boot-time
+ * operations (image loads, protocol lookups, custom spans) with minimal
+ * overhead. The buffer is self-describing and can be published as UEFI
+ * configuration table, so the operating system can pick it up after boot and
+ * correlate it with its own boot trace.
+ *
+ * The in-memory layout is stable and little-endian. It is shared with the
+ * `c-efi-trace-decode` tool, which converts a dump of the table into Chrome
+ * trace JSON. Any change to the layout must bump C_EFI_TRACE_TABLE_VERSION.
+ *
+ * Writers reserve a slot with a single atomic increment of the head counter
+ * and never block. Once the ring is full, the oldest events are overwritten.
+ * Each event carries the sequence number of the slot reservation, which is
+ * stored last. Readers use it to drop slots that were torn or overwritten.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-clock.h>
+
+#define C_EFI_TRACE_TABLE_GUID C_EFI_GUID(0xf18b473b, 0x1fbc, 0x40ec, 0x95, 0x08, 0xb8, 0xba, 0xcb, 0x25, 0x9f, 0x8c)
+
+#define C_EFI_TRACE_TABLE_SIGNATURE C_EFI_U64_C(0x4543525449464543) /* "CEFITRCE" */
+#define C_EFI_TRACE_TABLE_VERSION C_EFI_U32_C(0x00000001)
+
+#define C_EFI_TRACE_TYPE_BEGIN          C_EFI_U8_C(0x01)
+#define C_EFI_TRACE_TYPE_END            C_EFI_U8_C(0x02)
+#define C_EFI_TRACE_TYPE_INSTANT        C_EFI_U8_C(0x03)
+
+#define C_EFI_TRACE_CATEGORY_USER               C_EFI_U8_C(0x00)
+#define C_EFI_TRACE_CATEGORY_IMAGE_LOAD         C_EFI_U8_C(0x01)
+#define C_EFI_TRACE_CATEGORY_IMAGE_START        C_EFI_U8_C(0x02)
+#define C_EFI_TRACE_CATEGORY_PROTOCOL_OPEN      C_EFI_U8_C(0x03)
+#define C_EFI_TRACE_CATEGORY_IO                 C_EFI_U8_C(0x04)
+
+/**
+ * CEfiTraceEvent: Trace Event
+ * @timestamp:          raw counter value, see @ticks_per_second of the table
+ * @sequence:           slot reservation number plus one, 0 if unused
+ * @argument:           free-form argument (e.g., handle, address, size)
+ * @id:                 caller-defined event identifier
+ * @type:               event type, one of C_EFI_TRACE_TYPE_*
+ * @category:           event category, one of C_EFI_TRACE_CATEGORY_*
+ * @reserved:           reserved, must be 0
+ *
+ * A single entry in the trace ring. Begin and end events are matched by
+ * @category and @id.
+ */
+typedef struct CEfiTraceEvent {
+        CEfiU64 timestamp;
+        CEfiU64 sequence;
+        CEfiU64 argument;
+        CEfiU32 id;
+        CEfiU8 type;
+        CEfiU8 category;
+        CEfiU16 reserved;
+} CEfiTraceEvent;
+
+/**
+ * CEfiTraceTable: Trace Table
+ * @signature:          C_EFI_TRACE_TABLE_SIGNATURE
+ * @version:            C_EFI_TRACE_TABLE_VERSION
+ * @header_size:        size of this header, offset of @events
+ * @event_size:         size of a single event
+ * @n_events:           number of event slots, always a power of 2
+ * @ticks_per_second:   frequency of the event timestamps, 0 if unknown
+ * @head:               total number of reserved slots
+ * @events:             event slots
+ *
+ * This is the header of the trace ring, followed by @n_events event slots.
+ * Slot reservation number `n` is stored at index `n & (n_events - 1)`. The
+ * valid events are the last `min(head, n_events)` reservations.
+ */
+typedef struct CEfiTraceTable {
+        CEfiU64 signature;
+        CEfiU32 version;
+        CEfiU32 header_size;
+        CEfiU32 event_size;
+        CEfiU32 n_events;
+        CEfiU64 ticks_per_second;
+        CEfiU64 head;
+        CEfiTraceEvent events[];
+} CEfiTraceTable;
+
+/**
+ * c_efi_trace_table_size() - Calculate the size of a trace table
+ * @n_events:           number of event slots, must be a power of 2
+ *
+ * Return: The number of bytes needed for a trace table with @n_events slots.
+ */
+static inline CEfiUSize c_efi_trace_table_size(CEfiUSize n_events) {
+        return sizeof(CEfiTraceTable) + n_events * sizeof(CEfiTraceEvent);
+}
+
+/**
+ * c_efi_trace_table_init() - Initialize a trace table
+ * @table:              memory to initialize
+ * @size:               size of @table in bytes
+ * @ticks_per_second:   frequency of c_efi_clock_ticks(), 0 if unknown
+ *
+ * This initializes a trace table in the caller-provided memory. The number of
+ * event slots is the largest power of 2 that fits into @size.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if not even a
+ *         single event fits into @size.
+ */
+static inline CEfiStatus c_efi_trace_table_init(CEfiTraceTable *table,
+                                                CEfiUSize size,
+                                                CEfiU64 ticks_per_second) {
+        CEfiUSize i, n;
+
+        if (size < c_efi_trace_table_size(1))
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        n = (size - sizeof(CEfiTraceTable)) / sizeof(CEfiTraceEvent);
+        while (n & (n - 1))
+                n &= n - 1;
+        if (n > C_EFI_U32_C(0x80000000))
+                n = C_EFI_U32_C(0x80000000);
+
+        table->signature = C_EFI_TRACE_TABLE_SIGNATURE;
+        table->version = C_EFI_TRACE_TABLE_VERSION;
+        table->header_size = sizeof(CEfiTraceTable);
+        table->event_size = sizeof(CEfiTraceEvent);
+        table->n_events = n;
+        table->ticks_per_second = ticks_per_second;
+        table->head = 0;
+
+        for (i = 0; i < n; ++i)
+                table->events[i] = (CEfiTraceEvent){ 0 };
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_trace_table_new() - Allocate and publish a trace table
+ * @st:                 system table
+ * @n_events:           minimum number of event slots
+ * @ticks_per_second:   frequency of c_efi_clock_ticks(), 0 if unknown
+ * @tablep:             output argument for the new table
+ *
+ * This allocates a trace table with at least @n_events slots (rounded up to
+ * a power of 2) from C_EFI_RUNTIME_SERVICES_DATA pool memory, so it survives
+ * ExitBootServices(). The table is then installed as configuration table
+ * under C_EFI_TRACE_TABLE_GUID. A table holds at most 2^31 slots.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_INVALID_PARAMETER if @n_events
+ *         exceeds 2^31 or the table size overflows, or the error of the
+ *         failing boot service.
+ */
+static inline CEfiStatus c_efi_trace_table_new(CEfiSystemTable *st,
+                                               CEfiUSize n_events,
+                                               CEfiU64 ticks_per_second,
+                                               CEfiTraceTable **tablep) {
+        CEfiGuid guid = C_EFI_TRACE_TABLE_GUID;
+        CEfiTraceTable *table;
+        CEfiStatus r;
+        CEfiUSize n = 1;
+
+        if (n_events > C_EFI_U32_C(0x80000000) ||
+            n_events > ((CEfiUSize)-1 - sizeof(CEfiTraceTable)) / sizeof(CEfiTraceEvent))
+                return C_EFI_INVALID_PARAMETER;
+
+        while (n < n_events)
+                n <<= 1;
+
+        r = st->boot_services->allocate_pool(C_EFI_RUNTIME_SERVICES_DATA,
+                                             c_efi_trace_table_size(n),
+                                             (void **)&table);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = c_efi_trace_table_init(table, c_efi_trace_table_size(n), ticks_per_second);
+        if (!C_EFI_ERROR(r))
+                r = st->boot_services->install_configuration_table(&guid, table);
+        if (C_EFI_ERROR(r)) {
+                st->boot_services->free_pool(table);
+                return r;
+        }
+
+        *tablep = table;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_trace_record() - Record a trace event
+ * @table:              trace table to record into, or NULL
+ * @type:               event type, one of C_EFI_TRACE_TYPE_*
+ * @category:           event category, one of C_EFI_TRACE_CATEGORY_*
+ * @id:                 caller-defined event identifier
+ * @argument:           free-form argument
+ *
+ * This reserves the next slot in the trace ring and records an event with the
+ * current timestamp. This never blocks and is safe to call from any TPL and
+ * any CPU. If @table is NULL, this is a no-op.
+ */
+static inline void c_efi_trace_record(CEfiTraceTable *table,
+                                      CEfiU8 type,
+                                      CEfiU8 category,
+                                      CEfiU32 id,
+                                      CEfiU64 argument) {
+        CEfiTraceEvent *event;
+        CEfiU64 seq;
+
+        if (!table)
+                return;
+
+        seq = __atomic_fetch_add(&table->head, 1, __ATOMIC_RELAXED);
+        event = &table->events[seq & (table->n_events - 1)];
+
+        /*
+         * Invalidate the slot before touching the payload, so readers never
+         * see a stale sequence number attached to new data.
+         */
+        __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        event->timestamp = c_efi_clock_ticks();
+        event->argument = argument;
+        event->id = id;
+        event->type = type;
+        event->category = category;
+        event->reserved = 0;
+
+        __atomic_store_n(&event->sequence, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * c_efi_trace_begin() - Record the begin of a span
+ * @table:              trace table to record into, or NULL
+ * @category:           span category, one of C_EFI_TRACE_CATEGORY_*
+ * @id:                 caller-defined span identifier
+ * @argument:           free-form argument
+ *
+ * This records a C_EFI_TRACE_TYPE_BEGIN event. Spans may nest, and each must
+ * be closed by c_efi_trace_end() with the same @category and @id.
+ */
+static inline void c_efi_trace_begin(CEfiTraceTable *table, CEfiU8 category, CEfiU32 id, CEfiU64 argument) {
+        c_efi_trace_record(table, C_EFI_TRACE_TYPE_BEGIN, category, id, argument);
+}
+
+/**
+ * c_efi_trace_end() - Record the end of a span
+ * @table:              trace table to record into, or NULL
+ * @category:           category passed to c_efi_trace_begin()
+ * @id:                 identifier passed to c_efi_trace_begin()
+ * @argument:           free-form argument
+ *
+ * This records a C_EFI_TRACE_TYPE_END event, which closes the span opened with
+ * the same @category and @id.
+ */
+static inline void c_efi_trace_end(CEfiTraceTable *table, CEfiU8 category, CEfiU32 id, CEfiU64 argument) {
+        c_efi_trace_record(table, C_EFI_TRACE_TYPE_END, category, id, argument);
+}
+
+/**
+ * c_efi_trace_instant() - Record an instant event
+ * @table:              trace table to record into, or NULL
+ * @category:           event category, one of C_EFI_TRACE_CATEGORY_*
+ * @id:                 caller-defined event identifier
+ * @argument:           free-form argument
+ *
+ * This records a C_EFI_TRACE_TYPE_INSTANT event, which marks a point in time
+ * rather than a span.
+ */
+static inline void c_efi_trace_instant(CEfiTraceTable *table, CEfiU8 category, CEfiU32 id, CEfiU64 argument) {
+        c_efi_trace_record(table, C_EFI_TRACE_TYPE_INSTANT, category, id, argument);
+}
+
+#ifdef __cplusplus
+}
+#endif
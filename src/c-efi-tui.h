@@ -0,0 +1,367 @@
+#pragma once
+
+/**
+ * Shadow-Buffer Text UI Renderer
+ *
+ * Redrawing a text screen via `clear_screen` and `output_string` flickers,
+ * and is slow on serial consoles, where firmware translates every call into
+ * escape sequences. This header keeps two cell buffers of the screen: the
+ * frame being drawn, and the frame last sent to the console. Presenting a
+ * frame compares both, and emits only the changed cells:
+ *
+ *  - Rows without changes are skipped with a single memcmp().
+ *
+ *  - Changed cells with the same attribute are coalesced into one
+ *    `output_string` call. Short runs of unchanged cells between them are
+ *    included, since reprinting a few characters is cheaper than moving the
+ *    cursor.
+ *
+ *  - The cursor position and attribute of the console are tracked, so
+ *    `set_cursor_position` and `set_attribute` are only called if needed.
+ *
+ * The bottom-right cell is never drawn, since printing to it makes most
+ * firmware scroll the screen.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-system.h>
+#include <c-efi-mem.h>
+#include <c-efi-protocol-simple-text-output.h>
+
+#define C_EFI_TUI_RUN_MAX 128
+#define C_EFI_TUI_GAP_MAX 4
+
+/**
+ * CEfiTuiCell: Screen Cell
+ * @c:                  character, control characters are drawn as space
+ * @attribute:          text attribute, see C_EFI_WHITE
+ */
+typedef struct CEfiTuiCell {
+        CEfiChar16 c;
+        CEfiU16 attribute;
+} CEfiTuiCell;
+
+/**
+ * CEfiTui: Text UI Renderer
+ * @con:                console to render to
+ * @columns:            number of columns of the current mode
+ * @rows:               number of rows of the current mode
+ * @back:               frame being drawn
+ * @front:              frame on the console
+ * @cursor_column:      cursor column of the console, or @columns if unknown
+ * @cursor_row:         cursor row of the console
+ * @attribute:          attribute of the console, or (CEfiUSize)-1 if unknown
+ * @n_calls:            number of console calls made by the last present
+ */
+typedef struct CEfiTui {
+        CEfiSimpleTextOutputProtocol *con;
+        CEfiUSize columns;
+        CEfiUSize rows;
+        CEfiTuiCell *back;
+        CEfiTuiCell *front;
+        CEfiUSize cursor_column;
+        CEfiUSize cursor_row;
+        CEfiUSize attribute;
+        CEfiUSize n_calls;
+} CEfiTui;
+
+/**
+ * c_efi_tui_geometry() - Query console geometry
+ * @con:                console to query
+ * @columnsp:           output for the number of columns
+ * @rowsp:              output for the number of rows
+ *
+ * This queries the geometry of the current mode of @con. A renderer needs
+ * `2 * columns * rows` cells of storage.
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of `query_mode`.
+ */
+static inline CEfiStatus c_efi_tui_geometry(CEfiSimpleTextOutputProtocol *con, CEfiUSize *columnsp, CEfiUSize *rowsp) {
+        return con->query_mode(con, con->mode->mode, columnsp, rowsp);
+}
+
+/**
+ * c_efi_tui_clear() - Clear the frame being drawn
+ * @tui:                renderer to use
+ * @attribute:          attribute to fill with
+ */
+static inline void c_efi_tui_clear(CEfiTui *tui, CEfiUSize attribute) {
+        CEfiUSize i;
+
+        for (i = 0; i < tui->columns * tui->rows; ++i)
+                tui->back[i] = (CEfiTuiCell){ .c = ' ', .attribute = attribute };
+}
+
+/**
+ * c_efi_tui_put() - Draw text
+ * @tui:                renderer to use
+ * @column:             start column
+ * @row:                row
+ * @attribute:          attribute of the text
+ * @s:                  text to draw
+ * @n:                  number of characters in @s
+ *
+ * This draws @s into the frame being drawn. Text beyond the screen is
+ * clipped, no wrapping is done.
+ */
+static inline void c_efi_tui_put(CEfiTui *tui,
+                                 CEfiUSize column,
+                                 CEfiUSize row,
+                                 CEfiUSize attribute,
+                                 const CEfiChar16 *s,
+                                 CEfiUSize n) {
+        CEfiTuiCell *cell;
+        CEfiUSize i;
+
+        if (row >= tui->rows || column >= tui->columns)
+                return;
+        if (n > tui->columns - column)
+                n = tui->columns - column;
+
+        cell = &tui->back[row * tui->columns + column];
+        for (i = 0; i < n; ++i)
+                cell[i] = (CEfiTuiCell){ .c = s[i] < 0x20 ? ' ' : s[i], .attribute = attribute };
+}
+
+/**
+ * c_efi_tui_put8() - Draw ASCII text
+ * @tui:                renderer to use
+ * @column:             start column
+ * @row:                row
+ * @attribute:          attribute of the text
+ * @s:                  NUL-terminated ASCII text to draw
+ *
+ * This is like c_efi_tui_put(), but takes a NUL-terminated ASCII string.
+ */
+static inline void c_efi_tui_put8(CEfiTui *tui, CEfiUSize column, CEfiUSize row, CEfiUSize attribute, const char *s) {
+        CEfiTuiCell *cell;
+        CEfiUSize i;
+
+        if (row >= tui->rows || column >= tui->columns)
+                return;
+
+        cell = &tui->back[row * tui->columns + column];
+        for (i = 0; s[i] && i < tui->columns - column; ++i)
+                cell[i] = (CEfiTuiCell){ .c = (CEfiU8)s[i] < 0x20 ? ' ' : (CEfiU8)s[i], .attribute = attribute };
+}
+
+/**
+ * c_efi_tui_fill() - Fill a rectangle
+ * @tui:                renderer to use
+ * @column:             left column
+ * @row:                top row
+ * @width:              width in columns
+ * @height:             height in rows
+ * @c:                  character to fill with
+ * @attribute:          attribute to fill with
+ *
+ * The rectangle is clipped to the screen.
+ */
+static inline void c_efi_tui_fill(CEfiTui *tui,
+                                  CEfiUSize column,
+                                  CEfiUSize row,
+                                  CEfiUSize width,
+                                  CEfiUSize height,
+                                  CEfiChar16 c,
+                                  CEfiUSize attribute) {
+        CEfiUSize x, y;
+
+        if (row >= tui->rows || column >= tui->columns)
+                return;
+        if (width > tui->columns - column)
+                width = tui->columns - column;
+        if (height > tui->rows - row)
+                height = tui->rows - row;
+
+        for (y = row; y < row + height; ++y)
+                for (x = column; x < column + width; ++x)
+                        tui->back[y * tui->columns + x] = (CEfiTuiCell){ .c = c < 0x20 ? ' ' : c, .attribute = attribute };
+}
+
+/**
+ * c_efi_tui_invalidate() - Forget the console state
+ * @tui:                renderer to use
+ *
+ * Call this after anything else wrote to the console. The next present
+ * clears the console in the attribute of the top-left cell, and redraws
+ * everything.
+ */
+static inline void c_efi_tui_invalidate(CEfiTui *tui) {
+        tui->cursor_column = tui->columns;
+        tui->attribute = (CEfiUSize)-1;
+}
+
+/* emit @n characters of @buf at @column/@row in @attribute */
+static inline CEfiStatus c_efi_tui_emit(CEfiTui *tui,
+                                        CEfiUSize column,
+                                        CEfiUSize row,
+                                        CEfiUSize attribute,
+                                        CEfiChar16 *buf,
+                                        CEfiUSize n) {
+        CEfiSimpleTextOutputProtocol *con = tui->con;
+        CEfiStatus r;
+
+        if (tui->cursor_column != column || tui->cursor_row != row) {
+                ++tui->n_calls;
+                r = con->set_cursor_position(con, column, row);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        if (tui->attribute != attribute) {
+                ++tui->n_calls;
+                r = con->set_attribute(con, attribute);
+                if (C_EFI_ERROR(r))
+                        return r;
+                tui->attribute = attribute;
+        }
+
+        buf[n] = 0;
+        ++tui->n_calls;
+        r = con->output_string(con, buf);
+
+        /* the cursor wraps at the end of the row, in firmware-specific ways */
+        tui->cursor_column = column + n < tui->columns ? column + n : tui->columns;
+        tui->cursor_row = row;
+        return r;
+}
+
+/* present a single row, whose cells differ */
+static inline CEfiStatus c_efi_tui_present_row(CEfiTui *tui, CEfiUSize row) {
+        CEfiTuiCell *back = &tui->back[row * tui->columns], *front = &tui->front[row * tui->columns];
+        CEfiChar16 buf[C_EFI_TUI_RUN_MAX + 1];
+        CEfiUSize i, x, end, gap, start = 0, n = 0, attribute = 0;
+        CEfiStatus r;
+
+        end = tui->columns;
+        if (row + 1 == tui->rows) {
+                --end;
+                front[end] = back[end];
+        }
+
+        for (x = 0; x < end; ++x) {
+                if (back[x].c == front[x].c && back[x].attribute == front[x].attribute)
+                        continue;
+
+                if (n) {
+                        /* extend the run over a short gap of unchanged cells */
+                        gap = x - (start + n);
+                        if (back[x].attribute == attribute && gap <= C_EFI_TUI_GAP_MAX && n + gap < C_EFI_TUI_RUN_MAX) {
+                                for (i = start + n; i < x && back[i].attribute == attribute; ++i)
+                                        /* empty */ ;
+                                if (i == x)
+                                        for ( ; start + n < x; ++n)
+                                                buf[n] = back[start + n].c;
+                        }
+
+                        if (start + n != x || back[x].attribute != attribute || n >= C_EFI_TUI_RUN_MAX) {
+                                r = c_efi_tui_emit(tui, start, row, attribute, buf, n);
+                                if (C_EFI_ERROR(r))
+                                        return r;
+                                n = 0;
+                        }
+                }
+
+                if (!n) {
+                        start = x;
+                        attribute = back[x].attribute;
+                }
+                buf[n++] = back[x].c;
+                front[x] = back[x];
+        }
+
+        if (n)
+                return c_efi_tui_emit(tui, start, row, attribute, buf, n);
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_tui_present() - Present the drawn frame
+ * @tui:                renderer to use
+ *
+ * This sends the difference of the drawn frame to the console. The drawn
+ * frame is kept, so the next frame can be drawn incrementally, or from
+ * scratch after c_efi_tui_clear().
+ *
+ * Return: C_EFI_SUCCESS on success, or the error of a console call. On
+ *         error, c_efi_tui_invalidate() is implied.
+ */
+static inline CEfiStatus c_efi_tui_present(CEfiTui *tui) {
+        CEfiUSize i, row, size = tui->columns * sizeof(CEfiTuiCell);
+        CEfiStatus r;
+
+        tui->n_calls = 0;
+
+        /* an invalidated console has not been cleared yet */
+        if (tui->attribute == (CEfiUSize)-1) {
+                tui->n_calls += 2;
+                r = tui->con->set_attribute(tui->con, tui->back[0].attribute);
+                if (!C_EFI_ERROR(r))
+                        r = tui->con->clear_screen(tui->con);
+                if (C_EFI_ERROR(r))
+                        return r;
+
+                tui->attribute = tui->back[0].attribute;
+                tui->cursor_column = 0;
+                tui->cursor_row = 0;
+                for (i = 0; i < tui->columns * tui->rows; ++i)
+                        tui->front[i] = (CEfiTuiCell){ .c = ' ', .attribute = tui->attribute };
+        }
+
+        for (row = 0; row < tui->rows; ++row) {
+                if (!c_efi_memcmp(&tui->back[row * tui->columns], &tui->front[row * tui->columns], size))
+                        continue;
+
+                r = c_efi_tui_present_row(tui, row);
+                if (C_EFI_ERROR(r)) {
+                        c_efi_tui_invalidate(tui);
+                        return r;
+                }
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_tui_init() - Initialize renderer
+ * @tui:                renderer to initialize
+ * @con:                console to render to
+ * @cells:              storage for both frames
+ * @n_cells:            number of entries in @cells
+ *
+ * This clears the console in light gray on black, and prepares an equal,
+ * empty frame for drawing.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @cells is too
+ *         small, or the error of a console call.
+ */
+static inline CEfiStatus c_efi_tui_init(CEfiTui *tui, CEfiSimpleTextOutputProtocol *con, CEfiTuiCell *cells, CEfiUSize n_cells) {
+        CEfiUSize columns = 0, rows = 0;
+        CEfiStatus r;
+
+        *tui = (CEfiTui){ .con = con, .attribute = (CEfiUSize)-1 };
+
+        r = c_efi_tui_geometry(con, &columns, &rows);
+        if (C_EFI_ERROR(r))
+                return r;
+        if (n_cells / 2 / (columns ? columns : 1) < rows)
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        tui->columns = columns;
+        tui->rows = rows;
+        tui->back = cells;
+        tui->front = cells + columns * rows;
+        tui->cursor_column = columns;
+
+        c_efi_tui_clear(tui, C_EFI_LIGHTGRAY | C_EFI_BACKGROUND_BLACK);
+        return c_efi_tui_present(tui);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,249 @@
+#pragma once
+
+/**
+ * UCS-2 Transcoding
+ *
+ * UEFI strings are UCS-2, while configuration files, kernel command lines and
+ * most on-disk data are UTF-8. This header converts between both encodings.
+ * Only the Basic Multilingual Plane can be represented in UCS-2, hence code
+ * points beyond it, as well as surrogates, are rejected.
+ *
+ * Text is overwhelmingly ASCII, so runs of ASCII take a fast path:
+ *
+ *  - If compiled with NEON (always on AArch64) or SSE2 (see 'c-efi-simd.h'),
+ *    16 characters are widened or narrowed per iteration with vector
+ *    instructions.
+ *
+ *  - Otherwise, including RISC-V and the default x86 cross-files, 8
+ *    characters are handled per iteration in general purpose registers.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+#  define C_EFI_UCS2_BLOCK 16
+typedef CEfiU8 CEfiUcs2Bytes __attribute__((__vector_size__(16)));
+typedef CEfiU16 CEfiUcs2Chars __attribute__((__vector_size__(32)));
+#else
+#  define C_EFI_UCS2_BLOCK 8
+#endif
+
+static inline CEfiU64 c_efi_ucs2_load64(const void *p) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+/* widen @C_EFI_UCS2_BLOCK ASCII bytes, false if any is not ASCII */
+static inline CEfiBool c_efi_ucs2_widen(CEfiChar16 *d, const CEfiChar8 *s) {
+#if C_EFI_UCS2_BLOCK == 16
+        CEfiUcs2Chars w;
+        CEfiUcs2Bytes v;
+
+        if ((c_efi_ucs2_load64(s) | c_efi_ucs2_load64(s + 8)) & C_EFI_U64_C(0x8080808080808080))
+                return C_EFI_FALSE;
+
+        __builtin_memcpy(&v, s, sizeof(v));
+        w = __builtin_convertvector(v, CEfiUcs2Chars);
+        __builtin_memcpy(d, &w, sizeof(w));
+#else
+        CEfiU64 v, lo, hi;
+
+        v = c_efi_ucs2_load64(s);
+        if (v & C_EFI_U64_C(0x8080808080808080))
+                return C_EFI_FALSE;
+
+        /* spread the bytes of each half into 16-bit lanes */
+        lo = v & C_EFI_U64_C(0xffffffff);
+        hi = v >> 32;
+        lo = (lo | (lo << 16)) & C_EFI_U64_C(0x0000ffff0000ffff);
+        lo = (lo | (lo << 8)) & C_EFI_U64_C(0x00ff00ff00ff00ff);
+        hi = (hi | (hi << 16)) & C_EFI_U64_C(0x0000ffff0000ffff);
+        hi = (hi | (hi << 8)) & C_EFI_U64_C(0x00ff00ff00ff00ff);
+        __builtin_memcpy(d, &lo, sizeof(lo));
+        __builtin_memcpy(d + 4, &hi, sizeof(hi));
+#endif
+        return C_EFI_TRUE;
+}
+
+/* narrow @C_EFI_UCS2_BLOCK ASCII characters, false if any is not ASCII */
+static inline CEfiBool c_efi_ucs2_narrow(CEfiChar8 *d, const CEfiChar16 *s) {
+#if C_EFI_UCS2_BLOCK == 16
+        CEfiUcs2Chars w;
+        CEfiUcs2Bytes v;
+
+        if ((c_efi_ucs2_load64(s) | c_efi_ucs2_load64(s + 4) |
+             c_efi_ucs2_load64(s + 8) | c_efi_ucs2_load64(s + 12)) & C_EFI_U64_C(0xff80ff80ff80ff80))
+                return C_EFI_FALSE;
+
+        __builtin_memcpy(&w, s, sizeof(w));
+        v = __builtin_convertvector(w, CEfiUcs2Bytes);
+        __builtin_memcpy(d, &v, sizeof(v));
+#else
+        CEfiU64 lo, hi;
+
+        lo = c_efi_ucs2_load64(s);
+        hi = c_efi_ucs2_load64(s + 4);
+        if ((lo | hi) & C_EFI_U64_C(0xff80ff80ff80ff80))
+                return C_EFI_FALSE;
+
+        /* gather the low bytes of the 16-bit lanes */
+        lo = (lo | (lo >> 8)) & C_EFI_U64_C(0x0000ffff0000ffff);
+        lo = (lo | (lo >> 16)) & C_EFI_U64_C(0x00000000ffffffff);
+        hi = (hi | (hi >> 8)) & C_EFI_U64_C(0x0000ffff0000ffff);
+        hi = (hi | (hi >> 16)) & C_EFI_U64_C(0x00000000ffffffff);
+        lo |= hi << 32;
+        __builtin_memcpy(d, &lo, sizeof(lo));
+#endif
+        return C_EFI_TRUE;
+}
+
+/**
+ * c_efi_utf8_to_ucs2() - Convert UTF-8 to UCS-2
+ * @dst:                destination buffer, or NULL
+ * @n_dst:              size of @dst in characters
+ * @src:                UTF-8 input
+ * @n_src:              size of @src in bytes
+ * @n_dstp:             output for the number of characters produced
+ *
+ * This converts @n_src bytes of UTF-8 at @src into UCS-2 at @dst. No
+ * terminating zero is read or written. If @dst is too small, conversion
+ * continues without writing, so @n_dstp returns the required size. On invalid
+ * input, @n_dstp returns the size of the valid prefix.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @dst is too
+ *         small, C_EFI_INVALID_PARAMETER if @src is not valid UTF-8 or
+ *         contains characters outside of the Basic Multilingual Plane.
+ */
+static inline CEfiStatus c_efi_utf8_to_ucs2(CEfiChar16 *dst,
+                                            CEfiUSize n_dst,
+                                            const CEfiChar8 *src,
+                                            CEfiUSize n_src,
+                                            CEfiUSize *n_dstp) {
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiUSize i = 0, j = 0;
+        CEfiU32 c;
+
+        while (i < n_src) {
+                if (n_src - i >= C_EFI_UCS2_BLOCK &&
+                    n_dst >= j + C_EFI_UCS2_BLOCK &&
+                    c_efi_ucs2_widen(dst + j, src + i)) {
+                        i += C_EFI_UCS2_BLOCK;
+                        j += C_EFI_UCS2_BLOCK;
+                        continue;
+                }
+
+                c = src[i];
+                if (c < 0x80) {
+                        ++i;
+                } else if ((c & 0xe0) == 0xc0) {
+                        if (n_src - i < 2 || (src[i + 1] & 0xc0) != 0x80) {
+                                r = C_EFI_INVALID_PARAMETER;
+                                break;
+                        }
+                        c = ((c & 0x1f) << 6) | (src[i + 1] & 0x3f);
+                        if (c < 0x80) {
+                                r = C_EFI_INVALID_PARAMETER;
+                                break;
+                        }
+                        i += 2;
+                } else if ((c & 0xf0) == 0xe0) {
+                        if (n_src - i < 3 || (src[i + 1] & 0xc0) != 0x80 || (src[i + 2] & 0xc0) != 0x80) {
+                                r = C_EFI_INVALID_PARAMETER;
+                                break;
+                        }
+                        c = ((c & 0x0f) << 12) | ((src[i + 1] & 0x3f) << 6) | (src[i + 2] & 0x3f);
+                        if (c < 0x800 || (c >= 0xd800 && c <= 0xdfff)) {
+                                r = C_EFI_INVALID_PARAMETER;
+                                break;
+                        }
+                        i += 3;
+                } else {
+                        r = C_EFI_INVALID_PARAMETER;
+                        break;
+                }
+
+                if (j < n_dst)
+                        dst[j] = c;
+                ++j;
+        }
+
+        *n_dstp = j;
+        if (C_EFI_ERROR(r))
+                return r;
+        return j > n_dst ? C_EFI_BUFFER_TOO_SMALL : C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_ucs2_to_utf8() - Convert UCS-2 to UTF-8
+ * @dst:                destination buffer, or NULL
+ * @n_dst:              size of @dst in bytes
+ * @src:                UCS-2 input
+ * @n_src:              size of @src in characters
+ * @n_dstp:             output for the number of bytes produced
+ *
+ * This converts @n_src characters of UCS-2 at @src into UTF-8 at @dst. No
+ * terminating zero is read or written. If @dst is too small, conversion
+ * continues without writing, so @n_dstp returns the required size. Multi-byte
+ * sequences are never truncated. On invalid input, @n_dstp returns the size
+ * of the valid prefix.
+ *
+ * Return: C_EFI_SUCCESS on success, C_EFI_BUFFER_TOO_SMALL if @dst is too
+ *         small, C_EFI_INVALID_PARAMETER if @src contains surrogates.
+ */
+static inline CEfiStatus c_efi_ucs2_to_utf8(CEfiChar8 *dst,
+                                            CEfiUSize n_dst,
+                                            const CEfiChar16 *src,
+                                            CEfiUSize n_src,
+                                            CEfiUSize *n_dstp) {
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiUSize i = 0, j = 0;
+        CEfiU32 c;
+
+        while (i < n_src) {
+                if (n_src - i >= C_EFI_UCS2_BLOCK &&
+                    n_dst >= j + C_EFI_UCS2_BLOCK &&
+                    c_efi_ucs2_narrow(dst + j, src + i)) {
+                        i += C_EFI_UCS2_BLOCK;
+                        j += C_EFI_UCS2_BLOCK;
+                        continue;
+                }
+
+                c = src[i++];
+                if (c < 0x80) {
+                        if (j < n_dst)
+                                dst[j] = c;
+                        j += 1;
+                } else if (c < 0x800) {
+                        if (n_dst >= j + 2) {
+                                dst[j] = 0xc0 | (c >> 6);
+                                dst[j + 1] = 0x80 | (c & 0x3f);
+                        }
+                        j += 2;
+                } else if (c >= 0xd800 && c <= 0xdfff) {
+                        r = C_EFI_INVALID_PARAMETER;
+                        break;
+                } else {
+                        if (n_dst >= j + 3) {
+                                dst[j] = 0xe0 | (c >> 12);
+                                dst[j + 1] = 0x80 | ((c >> 6) & 0x3f);
+                                dst[j + 2] = 0x80 | (c & 0x3f);
+                        }
+                        j += 3;
+                }
+        }
+
+        *n_dstp = j;
+        if (C_EFI_ERROR(r))
+                return r;
+        return j > n_dst ? C_EFI_BUFFER_TOO_SMALL : C_EFI_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,348 @@
+#pragma once
+
+/**
+ * xxHash Checksums
+ *
+ * The LZ4 frame format protects headers, blocks and content with XXH32, and
+ * zstd frames carry the low 32 bits of XXH64 of their content. This header
+ * provides streaming implementations of both, so checksums can be updated as
+ * data is decompressed, without a second pass over the output.
+ *
+ * Both are the scalar reference algorithms. They process 16 (XXH32) or 32
+ * (XXH64) bytes per round in four independent lanes, which keeps them well
+ * ahead of the decompressors that use them.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+
+#define C_EFI_XXH32_P1 C_EFI_U32_C(0x9e3779b1)
+#define C_EFI_XXH32_P2 C_EFI_U32_C(0x85ebca77)
+#define C_EFI_XXH32_P3 C_EFI_U32_C(0xc2b2ae3d)
+#define C_EFI_XXH32_P4 C_EFI_U32_C(0x27d4eb2f)
+#define C_EFI_XXH32_P5 C_EFI_U32_C(0x165667b1)
+
+#define C_EFI_XXH64_P1 C_EFI_U64_C(0x9e3779b185ebca87)
+#define C_EFI_XXH64_P2 C_EFI_U64_C(0xc2b2ae3d27d4eb4f)
+#define C_EFI_XXH64_P3 C_EFI_U64_C(0x165667b19e3779f9)
+#define C_EFI_XXH64_P4 C_EFI_U64_C(0x85ebca77c2b2ae63)
+#define C_EFI_XXH64_P5 C_EFI_U64_C(0x27d4eb2f165667c5)
+
+/**
+ * CEfiXxh32: Streaming XXH32 state
+ * @v:                  lane accumulators
+ * @seed:               seed the state was initialized with
+ * @n_total:            number of bytes hashed so far
+ * @n_buffer:           number of bytes in @buffer
+ * @buffer:             partial stripe carried over between updates
+ */
+typedef struct CEfiXxh32 {
+        CEfiU32 v[4];
+        CEfiU32 seed;
+        CEfiU64 n_total;
+        CEfiU32 n_buffer;
+        CEfiU8 buffer[16];
+} CEfiXxh32;
+
+/**
+ * CEfiXxh64: Streaming XXH64 state
+ * @v:                  lane accumulators
+ * @seed:               seed the state was initialized with
+ * @n_total:            number of bytes hashed so far
+ * @n_buffer:           number of bytes in @buffer
+ * @buffer:             partial stripe carried over between updates
+ */
+typedef struct CEfiXxh64 {
+        CEfiU64 v[4];
+        CEfiU64 seed;
+        CEfiU64 n_total;
+        CEfiU32 n_buffer;
+        CEfiU8 buffer[32];
+} CEfiXxh64;
+
+/* UEFI mandates little-endian, so the native byte order is the xxHash one */
+static inline CEfiU32 c_efi_xxh_load32(const CEfiU8 *p) {
+        CEfiU32 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static inline CEfiU64 c_efi_xxh_load64(const CEfiU8 *p) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static inline CEfiU32 c_efi_xxh32_rotl(CEfiU32 v, unsigned int n) {
+        return (v << n) | (v >> (32 - n));
+}
+
+static inline CEfiU64 c_efi_xxh64_rotl(CEfiU64 v, unsigned int n) {
+        return (v << n) | (v >> (64 - n));
+}
+
+static inline CEfiU32 c_efi_xxh32_round(CEfiU32 acc, CEfiU32 v) {
+        return c_efi_xxh32_rotl(acc + v * C_EFI_XXH32_P2, 13) * C_EFI_XXH32_P1;
+}
+
+static inline CEfiU64 c_efi_xxh64_round(CEfiU64 acc, CEfiU64 v) {
+        return c_efi_xxh64_rotl(acc + v * C_EFI_XXH64_P2, 31) * C_EFI_XXH64_P1;
+}
+
+static inline CEfiU64 c_efi_xxh64_merge(CEfiU64 acc, CEfiU64 v) {
+        return (acc ^ c_efi_xxh64_round(0, v)) * C_EFI_XXH64_P1 + C_EFI_XXH64_P4;
+}
+
+/* consume all whole stripes of @p, returning the number of bytes consumed */
+static inline CEfiUSize c_efi_xxh32_stripes(CEfiU32 *v, const CEfiU8 *p, CEfiUSize n) {
+        CEfiU32 v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+        CEfiUSize i;
+
+        for (i = 0; i + 16 <= n; i += 16) {
+                v0 = c_efi_xxh32_round(v0, c_efi_xxh_load32(p + i));
+                v1 = c_efi_xxh32_round(v1, c_efi_xxh_load32(p + i + 4));
+                v2 = c_efi_xxh32_round(v2, c_efi_xxh_load32(p + i + 8));
+                v3 = c_efi_xxh32_round(v3, c_efi_xxh_load32(p + i + 12));
+        }
+
+        v[0] = v0;
+        v[1] = v1;
+        v[2] = v2;
+        v[3] = v3;
+        return i;
+}
+
+static inline CEfiUSize c_efi_xxh64_stripes(CEfiU64 *v, const CEfiU8 *p, CEfiUSize n) {
+        CEfiU64 v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+        CEfiUSize i;
+
+        for (i = 0; i + 32 <= n; i += 32) {
+                v0 = c_efi_xxh64_round(v0, c_efi_xxh_load64(p + i));
+                v1 = c_efi_xxh64_round(v1, c_efi_xxh_load64(p + i + 8));
+                v2 = c_efi_xxh64_round(v2, c_efi_xxh_load64(p + i + 16));
+                v3 = c_efi_xxh64_round(v3, c_efi_xxh_load64(p + i + 24));
+        }
+
+        v[0] = v0;
+        v[1] = v1;
+        v[2] = v2;
+        v[3] = v3;
+        return i;
+}
+
+/**
+ * c_efi_xxh32_init() - Start an XXH32 checksum
+ * @state:              state to initialize
+ * @seed:               seed, 0 for the LZ4 frame format
+ *
+ * This initializes @state to hash a new message.
+ */
+static inline void c_efi_xxh32_init(CEfiXxh32 *state, CEfiU32 seed) {
+        *state = (CEfiXxh32){
+                .v = {
+                        seed + C_EFI_XXH32_P1 + C_EFI_XXH32_P2,
+                        seed + C_EFI_XXH32_P2,
+                        seed,
+                        seed - C_EFI_XXH32_P1,
+                },
+                .seed = seed,
+        };
+}
+
+/**
+ * c_efi_xxh32_update() - Hash more data
+ * @state:              state to update
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * This appends @data to the message hashed by @state. Updates can be of any
+ * size, the result only depends on the concatenated message.
+ */
+static inline void c_efi_xxh32_update(CEfiXxh32 *state, const void *data, CEfiUSize n) {
+        const CEfiU8 *p = data;
+        CEfiUSize i;
+
+        state->n_total += n;
+
+        if (state->n_buffer) {
+                for ( ; n && state->n_buffer < sizeof(state->buffer); --n)
+                        state->buffer[state->n_buffer++] = *p++;
+                if (state->n_buffer < sizeof(state->buffer))
+                        return;
+                c_efi_xxh32_stripes(state->v, state->buffer, sizeof(state->buffer));
+                state->n_buffer = 0;
+        }
+
+        i = c_efi_xxh32_stripes(state->v, p, n);
+        for ( ; i < n; ++i)
+                state->buffer[state->n_buffer++] = p[i];
+}
+
+/**
+ * c_efi_xxh32_final() - Finish an XXH32 checksum
+ * @state:              state to finish
+ *
+ * This calculates the checksum of all data passed to @state so far. @state is
+ * not modified, so it can be updated further.
+ *
+ * Return: The XXH32 of the message.
+ */
+static inline CEfiU32 c_efi_xxh32_final(const CEfiXxh32 *state) {
+        const CEfiU8 *p = state->buffer;
+        CEfiU32 h, n = state->n_buffer;
+
+        if (state->n_total >= 16)
+                h = c_efi_xxh32_rotl(state->v[0], 1) +
+                    c_efi_xxh32_rotl(state->v[1], 7) +
+                    c_efi_xxh32_rotl(state->v[2], 12) +
+                    c_efi_xxh32_rotl(state->v[3], 18);
+        else
+                h = state->seed + C_EFI_XXH32_P5;
+
+        h += (CEfiU32)state->n_total;
+
+        for ( ; n >= 4; n -= 4, p += 4)
+                h = c_efi_xxh32_rotl(h + c_efi_xxh_load32(p) * C_EFI_XXH32_P3, 17) * C_EFI_XXH32_P4;
+        for ( ; n; --n, ++p)
+                h = c_efi_xxh32_rotl(h + *p * C_EFI_XXH32_P5, 11) * C_EFI_XXH32_P1;
+
+        h ^= h >> 15;
+        h *= C_EFI_XXH32_P2;
+        h ^= h >> 13;
+        h *= C_EFI_XXH32_P3;
+        h ^= h >> 16;
+        return h;
+}
+
+/**
+ * c_efi_xxh32() - Calculate XXH32
+ * @seed:               seed, 0 for the LZ4 frame format
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * Return: The XXH32 of @data.
+ */
+static inline CEfiU32 c_efi_xxh32(CEfiU32 seed, const void *data, CEfiUSize n) {
+        CEfiXxh32 state;
+
+        c_efi_xxh32_init(&state, seed);
+        c_efi_xxh32_update(&state, data, n);
+        return c_efi_xxh32_final(&state);
+}
+
+/**
+ * c_efi_xxh64_init() - Start an XXH64 checksum
+ * @state:              state to initialize
+ * @seed:               seed, 0 for the zstd frame format
+ *
+ * This initializes @state to hash a new message.
+ */
+static inline void c_efi_xxh64_init(CEfiXxh64 *state, CEfiU64 seed) {
+        *state = (CEfiXxh64){
+                .v = {
+                        seed + C_EFI_XXH64_P1 + C_EFI_XXH64_P2,
+                        seed + C_EFI_XXH64_P2,
+                        seed,
+                        seed - C_EFI_XXH64_P1,
+                },
+                .seed = seed,
+        };
+}
+
+/**
+ * c_efi_xxh64_update() - Hash more data
+ * @state:              state to update
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * This appends @data to the message hashed by @state. Updates can be of any
+ * size, the result only depends on the concatenated message.
+ */
+static inline void c_efi_xxh64_update(CEfiXxh64 *state, const void *data, CEfiUSize n) {
+        const CEfiU8 *p = data;
+        CEfiUSize i;
+
+        state->n_total += n;
+
+        if (state->n_buffer) {
+                for ( ; n && state->n_buffer < sizeof(state->buffer); --n)
+                        state->buffer[state->n_buffer++] = *p++;
+                if (state->n_buffer < sizeof(state->buffer))
+                        return;
+                c_efi_xxh64_stripes(state->v, state->buffer, sizeof(state->buffer));
+                state->n_buffer = 0;
+        }
+
+        i = c_efi_xxh64_stripes(state->v, p, n);
+        for ( ; i < n; ++i)
+                state->buffer[state->n_buffer++] = p[i];
+}
+
+/**
+ * c_efi_xxh64_final() - Finish an XXH64 checksum
+ * @state:              state to finish
+ *
+ * This calculates the checksum of all data passed to @state so far. @state is
+ * not modified, so it can be updated further.
+ *
+ * Return: The XXH64 of the message.
+ */
+static inline CEfiU64 c_efi_xxh64_final(const CEfiXxh64 *state) {
+        const CEfiU8 *p = state->buffer;
+        CEfiU32 n = state->n_buffer;
+        CEfiU64 h;
+
+        if (state->n_total >= 32) {
+                h = c_efi_xxh64_rotl(state->v[0], 1) +
+                    c_efi_xxh64_rotl(state->v[1], 7) +
+                    c_efi_xxh64_rotl(state->v[2], 12) +
+                    c_efi_xxh64_rotl(state->v[3], 18);
+                h = c_efi_xxh64_merge(h, state->v[0]);
+                h = c_efi_xxh64_merge(h, state->v[1]);
+                h = c_efi_xxh64_merge(h, state->v[2]);
+                h = c_efi_xxh64_merge(h, state->v[3]);
+        } else {
+                h = state->seed + C_EFI_XXH64_P5;
+        }
+
+        h += state->n_total;
+
+        for ( ; n >= 8; n -= 8, p += 8)
+                h = c_efi_xxh64_rotl(h ^ c_efi_xxh64_round(0, c_efi_xxh_load64(p)), 27) * C_EFI_XXH64_P1 + C_EFI_XXH64_P4;
+        for ( ; n >= 4; n -= 4, p += 4)
+                h = c_efi_xxh64_rotl(h ^ (c_efi_xxh_load32(p) * C_EFI_XXH64_P1), 23) * C_EFI_XXH64_P2 + C_EFI_XXH64_P3;
+        for ( ; n; --n, ++p)
+                h = c_efi_xxh64_rotl(h ^ (*p * C_EFI_XXH64_P5), 11) * C_EFI_XXH64_P1;
+
+        h ^= h >> 33;
+        h *= C_EFI_XXH64_P2;
+        h ^= h >> 29;
+        h *= C_EFI_XXH64_P3;
+        h ^= h >> 32;
+        return h;
+}
+
+/**
+ * c_efi_xxh64() - Calculate XXH64
+ * @seed:               seed, 0 for the zstd frame format
+ * @data:               data to hash
+ * @n:                  size of @data in bytes
+ *
+ * Return: The XXH64 of @data.
+ */
+static inline CEfiU64 c_efi_xxh64(CEfiU64 seed, const void *data, CEfiUSize n) {
+        CEfiXxh64 state;
+
+        c_efi_xxh64_init(&state, seed);
+        c_efi_xxh64_update(&state, data, n);
+        return c_efi_xxh64_final(&state);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1485 @@
+#pragma once
+
+/**
+ * Zstandard Streaming Decompression
+ *
+ * This decodes zstd frames (RFC 8878) as compressed input arrives, so a loader
+ * can decompress while the next chunk is still being read. The decoder never
+ * allocates; the caller provides all memory up front:
+ *
+ *  - The window receives the decoded output. It doubles as the history that
+ *    matches refer to. If it is large enough for the entire content, output is
+ *    decoded in place and never moved, so the window can be the final
+ *    destination of a payload. Otherwise, the caller takes decoded data out
+ *    via c_efi_zstd_pending() and c_efi_zstd_release(), and the decoder slides
+ *    the frame's window of history to the front once it runs out of space.
+ *    Such ring operation needs a window of at least the frame window size
+ *    plus 128KiB, the maximum block size.
+ *
+ *  - The workspace holds the literals of the current block and stages blocks
+ *    that are split across input chunks. Blocks that are complete in the
+ *    input are decoded directly from it. C_EFI_ZSTD_WORKSPACE_SIZE covers all
+ *    frames. Frames with small windows have small blocks, and get by with
+ *    less.
+ *
+ * The entropy tables live in the decoder object itself, which is about 14KiB.
+ * Concatenated frames and skippable frames are supported, dictionaries are
+ * not. Content checksums are verified unless disabled with
+ * C_EFI_ZSTD_FLAG_SKIP_CHECKSUM, for instance because the payload is verified
+ * by other means.
+ *
+ * Literals and matches are copied in 8 and 16 byte strides. These strides
+ * write past the end of the data, but never past the end of the window, so
+ * the window content behind the decoded data is undefined.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <c-efi-base.h>
+#include <c-efi-mem.h>
+#include <c-efi-xxhash.h>
+
+#define C_EFI_ZSTD_MAGIC                C_EFI_U32_C(0xfd2fb528)
+#define C_EFI_ZSTD_MAGIC_SKIPPABLE      C_EFI_U32_C(0x184d2a50)
+#define C_EFI_ZSTD_MAGIC_SKIPPABLE_MASK C_EFI_U32_C(0xfffffff0)
+
+#define C_EFI_ZSTD_BLOCK_MAX            (128 * 1024)
+#define C_EFI_ZSTD_LITERALS_SLACK       32
+#define C_EFI_ZSTD_WORKSPACE_SIZE       (2 * C_EFI_ZSTD_BLOCK_MAX + C_EFI_ZSTD_LITERALS_SLACK)
+
+#define C_EFI_ZSTD_FLAG_SKIP_CHECKSUM   C_EFI_U32_C(0x00000001)
+
+#define C_EFI_ZSTD_LL_LOG_MAX           9
+#define C_EFI_ZSTD_ML_LOG_MAX           9
+#define C_EFI_ZSTD_OF_LOG_MAX           8
+#define C_EFI_ZSTD_HUF_LOG_MAX          11
+#define C_EFI_ZSTD_LL_SYMBOL_MAX        35
+#define C_EFI_ZSTD_ML_SYMBOL_MAX        52
+#define C_EFI_ZSTD_OF_SYMBOL_MAX        31
+#define C_EFI_ZSTD_AHEAD                8
+
+enum {
+        C_EFI_ZSTD_STATE_MAGIC,
+        C_EFI_ZSTD_STATE_FRAME_HEADER,
+        C_EFI_ZSTD_STATE_BLOCK_HEADER,
+        C_EFI_ZSTD_STATE_BLOCK,
+        C_EFI_ZSTD_STATE_RAW,
+        C_EFI_ZSTD_STATE_RLE,
+        C_EFI_ZSTD_STATE_CHECKSUM,
+        C_EFI_ZSTD_STATE_SKIP_SIZE,
+        C_EFI_ZSTD_STATE_SKIP,
+};
+
+enum {
+        C_EFI_ZSTD_BLOCK_RAW,
+        C_EFI_ZSTD_BLOCK_RLE,
+        C_EFI_ZSTD_BLOCK_COMPRESSED,
+};
+
+/*
+ * FSE decoding table entry. Sequence tables resolve their symbols to the
+ * baseline value and number of extra bits, Huffman weight tables store the
+ * symbol as baseline.
+ */
+typedef struct CEfiZstdFse {
+        CEfiU32 base;
+        CEfiU16 next;
+        CEfiU8 n_bits;
+        CEfiU8 n_extra;
+} CEfiZstdFse;
+
+typedef struct CEfiZstdHuf {
+        CEfiU8 symbol;
+        CEfiU8 n_bits;
+} CEfiZstdHuf;
+
+/* backward bitstream, as used by all entropy coded zstd streams */
+typedef struct CEfiZstdBits {
+        CEfiU64 bits;
+        CEfiU32 consumed;
+        const CEfiU8 *start;
+        const CEfiU8 *ptr;
+} CEfiZstdBits;
+
+typedef struct CEfiZstdSeq {
+        CEfiUSize ll;
+        CEfiUSize ml;
+        CEfiUSize off;
+} CEfiZstdSeq;
+
+/* sequence decoder of a block: bitstream, tables, states, repeated offsets */
+typedef struct CEfiZstdSeqs {
+        CEfiZstdBits br;
+        const CEfiZstdFse *ll;
+        const CEfiZstdFse *ml;
+        const CEfiZstdFse *of;
+        CEfiU32 s_ll;
+        CEfiU32 s_ml;
+        CEfiU32 s_of;
+        CEfiUSize rep[3];
+} CEfiZstdSeqs;
+
+/**
+ * CEfiZstd: Zstandard Decoder
+ * @flags:              C_EFI_ZSTD_FLAG_* as passed to c_efi_zstd_init()
+ * @status:             sticky error, once decoding failed
+ * @window:             caller-provided output window
+ * @n_window:           size of @window in bytes
+ * @pos:                end of the decoded data in @window
+ * @tail:               start of the decoded data not yet released
+ * @base:               start of the data that matches may refer to
+ * @literals:           literals buffer, in the workspace
+ * @n_literals:         size of @literals, including slack for wide copies
+ * @staging:            staging buffer for split blocks, in the workspace
+ * @n_staging:          size of @staging in bytes
+ * @n_staged:           number of bytes of the current block in @staging
+ * @state:              C_EFI_ZSTD_STATE_* of the parser
+ * @descriptor:         frame header descriptor of the current frame
+ * @last:               whether the current block is the last of its frame
+ * @block_size:         size of the current block, or bytes left of it
+ * @block_max:          maximum block size of the current frame
+ * @window_size:        window size of the current frame
+ * @n_header:           number of bytes in @header
+ * @header:             header bytes collected so far
+ * @content_size:       content size declared by the current frame
+ * @n_content:          number of bytes decoded in the current frame
+ * @n_skip:             bytes left to skip in a skippable frame
+ * @rep:                repeated offsets
+ * @ll_log:             accuracy log of @ll
+ * @ml_log:             accuracy log of @ml
+ * @of_log:             accuracy log of @of
+ * @huf_log:            maximum code length of @huf, 0 if undefined
+ * @ll:                 literals length decoding table
+ * @ml:                 match length decoding table
+ * @of:                 offset decoding table
+ * @huf:                Huffman decoding table for literals
+ * @xxh:                content checksum of the current frame
+ * @n_frames:           number of frames completed
+ * @n_blocks:           number of compressed blocks decoded
+ * @n_direct:           number of them decoded directly from the input
+ * @n_slides:           number of times history was moved to the front
+ * @n_slide_bytes:      number of bytes moved by those slides
+ */
+typedef struct CEfiZstd {
+        CEfiU32 flags;
+        CEfiStatus status;
+
+        CEfiU8 *window;
+        CEfiUSize n_window;
+        CEfiUSize pos;
+        CEfiUSize tail;
+        CEfiUSize base;
+
+        CEfiU8 *literals;
+        CEfiUSize n_literals;
+        CEfiU8 *staging;
+        CEfiUSize n_staging;
+        CEfiUSize n_staged;
+
+        CEfiU32 state;
+        CEfiU32 descriptor;
+        CEfiBool last;
+        CEfiU32 block_size;
+        CEfiU32 block_max;
+        CEfiU64 window_size;
+        CEfiU32 n_header;
+        CEfiU8 header[16];
+        CEfiU64 content_size;
+        CEfiU64 n_content;
+        CEfiU64 n_skip;
+
+        CEfiU32 rep[3];
+        CEfiU32 ll_log;
+        CEfiU32 ml_log;
+        CEfiU32 of_log;
+        CEfiU32 huf_log;
+        CEfiZstdFse ll[1 << C_EFI_ZSTD_LL_LOG_MAX];
+        CEfiZstdFse ml[1 << C_EFI_ZSTD_ML_LOG_MAX];
+        CEfiZstdFse of[1 << C_EFI_ZSTD_OF_LOG_MAX];
+        CEfiZstdHuf huf[1 << C_EFI_ZSTD_HUF_LOG_MAX];
+        CEfiXxh64 xxh;
+
+        CEfiU64 n_frames;
+        CEfiU64 n_blocks;
+        CEfiU64 n_direct;
+        CEfiU64 n_slides;
+        CEfiU64 n_slide_bytes;
+} CEfiZstd;
+
+static const CEfiU32 c_efi_zstd_ll_base[C_EFI_ZSTD_LL_SYMBOL_MAX + 1] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+        8192, 16384, 32768, 65536,
+};
+
+static const CEfiU8 c_efi_zstd_ll_extra[C_EFI_ZSTD_LL_SYMBOL_MAX + 1] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+        13, 14, 15, 16,
+};
+
+static const CEfiU32 c_efi_zstd_ml_base[C_EFI_ZSTD_ML_SYMBOL_MAX + 1] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+        19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+        35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+        4099, 8195, 16387, 32771, 65539,
+};
+
+static const CEfiU8 c_efi_zstd_ml_extra[C_EFI_ZSTD_ML_SYMBOL_MAX + 1] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+        12, 13, 14, 15, 16,
+};
+
+/* offset codes are their own number of extra bits, on top of 1 << code */
+static const CEfiU32 c_efi_zstd_of_base[C_EFI_ZSTD_OF_SYMBOL_MAX + 1] = {
+        C_EFI_U32_C(1) << 0, C_EFI_U32_C(1) << 1, C_EFI_U32_C(1) << 2, C_EFI_U32_C(1) << 3,
+        C_EFI_U32_C(1) << 4, C_EFI_U32_C(1) << 5, C_EFI_U32_C(1) << 6, C_EFI_U32_C(1) << 7,
+        C_EFI_U32_C(1) << 8, C_EFI_U32_C(1) << 9, C_EFI_U32_C(1) << 10, C_EFI_U32_C(1) << 11,
+        C_EFI_U32_C(1) << 12, C_EFI_U32_C(1) << 13, C_EFI_U32_C(1) << 14, C_EFI_U32_C(1) << 15,
+        C_EFI_U32_C(1) << 16, C_EFI_U32_C(1) << 17, C_EFI_U32_C(1) << 18, C_EFI_U32_C(1) << 19,
+        C_EFI_U32_C(1) << 20, C_EFI_U32_C(1) << 21, C_EFI_U32_C(1) << 22, C_EFI_U32_C(1) << 23,
+        C_EFI_U32_C(1) << 24, C_EFI_U32_C(1) << 25, C_EFI_U32_C(1) << 26, C_EFI_U32_C(1) << 27,
+        C_EFI_U32_C(1) << 28, C_EFI_U32_C(1) << 29, C_EFI_U32_C(1) << 30, C_EFI_U32_C(1) << 31,
+};
+
+static const CEfiU8 c_efi_zstd_of_extra[C_EFI_ZSTD_OF_SYMBOL_MAX + 1] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+};
+
+/* predefined distributions, RFC 8878 section 3.1.1.3.2.2 */
+static const CEfiI16 c_efi_zstd_ll_default[C_EFI_ZSTD_LL_SYMBOL_MAX + 1] = {
+        4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+        -1, -1, -1, -1,
+};
+
+static const CEfiI16 c_efi_zstd_ml_default[C_EFI_ZSTD_ML_SYMBOL_MAX + 1] = {
+        1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+        -1, -1, -1, -1, -1,
+};
+
+static const CEfiI16 c_efi_zstd_of_default[29] = {
+        1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1,
+};
+
+static inline CEfiU32 c_efi_zstd_le(const CEfiU8 *p, unsigned int n) {
+        CEfiU32 v = 0;
+
+        while (n--)
+                v = (v << 8) | p[n];
+        return v;
+}
+
+static inline CEfiU32 c_efi_zstd_highbit(CEfiU32 v) {
+        return 31 - __builtin_clz(v);
+}
+
+static inline void c_efi_zstd_copy8(CEfiU8 *d, const CEfiU8 *s) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, s, sizeof(v));
+        __builtin_memcpy(d, &v, sizeof(v));
+}
+
+static inline CEfiU64 c_efi_zstd_load64(const CEfiU8 *p) {
+        CEfiU64 v;
+
+        __builtin_memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static inline CEfiStatus c_efi_zstd_bits_init(CEfiZstdBits *br, const CEfiU8 *src, CEfiUSize n) {
+        CEfiUSize i;
+
+        /* the last byte holds a marker bit in front of the first bit read */
+        if (!n || !src[n - 1])
+                return C_EFI_COMPROMISED_DATA;
+
+        br->start = src;
+        br->consumed = 8 - c_efi_zstd_highbit(src[n - 1]);
+        if (n >= 8) {
+                br->ptr = src + n - 8;
+                br->bits = c_efi_zstd_load64(br->ptr);
+        } else {
+                br->ptr = src;
+                br->bits = 0;
+                for (i = 0; i < n; ++i)
+                        br->bits |= (CEfiU64)src[i] << (8 * i);
+                br->consumed += (8 - n) * 8;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/* corrupt streams may over-read, which yields garbage, but no faults */
+static inline CEfiU64 c_efi_zstd_bits_peek(const CEfiZstdBits *br, CEfiU32 n) {
+        return ((br->bits << (br->consumed & 63)) >> 1) >> (63 - n);
+}
+
+static inline CEfiU64 c_efi_zstd_bits_read(CEfiZstdBits *br, CEfiU32 n) {
+        CEfiU64 v = c_efi_zstd_bits_peek(br, n);
+
+        br->consumed += n;
+        return v;
+}
+
+/* refill, returns false if more bits were read than the stream has */
+static inline CEfiBool c_efi_zstd_bits_reload(CEfiZstdBits *br) {
+        CEfiUSize n;
+
+        if (br->consumed > 64)
+                return 0;
+
+        if (br->ptr - br->start >= 8) {
+                br->ptr -= br->consumed >> 3;
+                br->consumed &= 7;
+        } else if (br->ptr == br->start) {
+                return 1;
+        } else {
+                n = br->consumed >> 3;
+                if (n > (CEfiUSize)(br->ptr - br->start))
+                        n = br->ptr - br->start;
+                br->ptr -= n;
+                br->consumed -= n * 8;
+        }
+
+        br->bits = c_efi_zstd_load64(br->ptr);
+        return 1;
+}
+
+static inline CEfiBool c_efi_zstd_bits_done(CEfiZstdBits *br) {
+        return c_efi_zstd_bits_reload(br) && br->ptr == br->start && br->consumed == 64;
+}
+
+/* up to 32 bits at bit offset @pos of a forward bitstream, zero beyond @n */
+static inline CEfiU32 c_efi_zstd_forward(const CEfiU8 *src, CEfiUSize n, CEfiUSize pos) {
+        CEfiU64 v = 0;
+        CEfiUSize i, o = pos >> 3;
+
+        for (i = 0; i < 5 && o + i < n; ++i)
+                v |= (CEfiU64)src[o + i] << (8 * i);
+        return (CEfiU32)(v >> (pos & 7));
+}
+
+/* read an FSE table description, RFC 8878 section 4.1.1 */
+static inline CEfiStatus c_efi_zstd_fse_read(CEfiI16 *norm,
+                                             CEfiU32 symbol_max,
+                                             CEfiU32 log_max,
+                                             CEfiU32 *n_symbolsp,
+                                             CEfiU32 *logp,
+                                             const CEfiU8 *src,
+                                             CEfiUSize n,
+                                             CEfiUSize *n_usedp) {
+        CEfiU32 log, remaining, threshold, n_bits, symbol = 0, v, max, repeat, i;
+        CEfiUSize pos;
+        CEfiI32 count;
+
+        if (!n)
+                return C_EFI_COMPROMISED_DATA;
+
+        log = (src[0] & 15) + 5;
+        if (log > log_max)
+                return C_EFI_COMPROMISED_DATA;
+
+        pos = 4;
+        remaining = (C_EFI_U32_C(1) << log) + 1;
+        threshold = C_EFI_U32_C(1) << log;
+        n_bits = log + 1;
+
+        while (remaining > 1) {
+                if (symbol > symbol_max)
+                        return C_EFI_COMPROMISED_DATA;
+
+                v = c_efi_zstd_forward(src, n, pos);
+                max = 2 * threshold - 1 - remaining;
+                if ((v & (threshold - 1)) < max) {
+                        count = v & (threshold - 1);
+                        pos += n_bits - 1;
+                } else {
+                        count = v & (2 * threshold - 1);
+                        if (count >= (CEfiI32)threshold)
+                                count -= max;
+                        pos += n_bits;
+                }
+
+                /* 0 encodes a probability of "less than 1" */
+                --count;
+                if ((CEfiU32)(count < 0 ? -count : count) > remaining)
+                        return C_EFI_COMPROMISED_DATA;
+                remaining -= count < 0 ? -count : count;
+                norm[symbol++] = count;
+
+                /* zero probabilities are followed by 2-bit repeat flags */
+                if (!count) {
+                        do {
+                                repeat = c_efi_zstd_forward(src, n, pos) & 3;
+                                pos += 2;
+                                if (symbol + repeat > symbol_max + 1)
+                                        return C_EFI_COMPROMISED_DATA;
+                                for (i = 0; i < repeat; ++i)
+                                        norm[symbol++] = 0;
+                        } while (repeat == 3);
+                }
+
+                while (remaining < threshold) {
+                        --n_bits;
+                        threshold >>= 1;
+                }
+        }
+
+        if (remaining != 1 || (pos + 7) / 8 > n)
+                return C_EFI_COMPROMISED_DATA;
+
+        *n_symbolsp = symbol;
+        *logp = log;
+        *n_usedp = (pos + 7) / 8;
+        return C_EFI_SUCCESS;
+}
+
+/* build a decoding table, resolving symbols via @base and @extra, if given */
+static inline CEfiStatus c_efi_zstd_fse_build(CEfiZstdFse *table,
+                                              const CEfiI16 *norm,
+                                              CEfiU32 n_symbols,
+                                              CEfiU32 log,
+                                              const CEfiU32 *base,
+                                              const CEfiU8 *extra) {
+        CEfiU32 size = C_EFI_U32_C(1) << log, high = size - 1, mask = size - 1;
+        CEfiU32 step = (size >> 1) + (size >> 3) + 3, pos = 0, s, u, x;
+        CEfiU16 next[C_EFI_ZSTD_ML_SYMBOL_MAX + 1];
+        CEfiI32 i;
+
+        for (s = 0; s < n_symbols; ++s) {
+                if (norm[s] == -1) {
+                        table[high--].base = s;
+                        next[s] = 1;
+                } else {
+                        next[s] = norm[s];
+                }
+        }
+
+        for (s = 0; s < n_symbols; ++s) {
+                for (i = 0; i < norm[s]; ++i) {
+                        table[pos].base = s;
+                        do
+                                pos = (pos + step) & mask;
+                        while (pos > high);
+                }
+        }
+        if (pos)
+                return C_EFI_COMPROMISED_DATA;
+
+        for (u = 0; u < size; ++u) {
+                s = table[u].base;
+                x = next[s]++;
+                table[u].n_bits = log - c_efi_zstd_highbit(x);
+                table[u].next = (x << table[u].n_bits) - size;
+                table[u].base = base ? base[s] : s;
+                table[u].n_extra = extra ? extra[s] : 0;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/* decode Huffman weights compressed with FSE, RFC 8878 section 4.2.1.2 */
+static inline CEfiStatus c_efi_zstd_huf_weights(CEfiU8 *w, CEfiU32 *n_wp, const CEfiU8 *src, CEfiUSize n) {
+        CEfiZstdFse table[64];
+        CEfiU32 n_symbols, log, s1, s2, n_w = 0;
+        CEfiUSize used;
+        CEfiZstdBits br;
+        CEfiI16 norm[16];
+        CEfiStatus r;
+
+        r = c_efi_zstd_fse_read(norm, 15, 6, &n_symbols, &log, src, n, &used);
+        if (C_EFI_ERROR(r))
+                return r;
+        r = c_efi_zstd_fse_build(table, norm, n_symbols, log, C_EFI_NULL, C_EFI_NULL);
+        if (C_EFI_ERROR(r))
+                return r;
+        r = c_efi_zstd_bits_init(&br, src + used, n - used);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        /* two interleaved states, until the stream is exhausted */
+        s1 = c_efi_zstd_bits_read(&br, log);
+        s2 = c_efi_zstd_bits_read(&br, log);
+        for (;;) {
+                if (n_w > 253 || !c_efi_zstd_bits_reload(&br))
+                        return C_EFI_COMPROMISED_DATA;
+                w[n_w++] = table[s1].base;
+                s1 = table[s1].next + c_efi_zstd_bits_read(&br, table[s1].n_bits);
+                if (!c_efi_zstd_bits_reload(&br)) {
+                        w[n_w++] = table[s2].base;
+                        break;
+                }
+
+                if (n_w > 253)
+                        return C_EFI_COMPROMISED_DATA;
+                w[n_w++] = table[s2].base;
+                s2 = table[s2].next + c_efi_zstd_bits_read(&br, table[s2].n_bits);
+                if (!c_efi_zstd_bits_reload(&br)) {
+                        w[n_w++] = table[s1].base;
+                        break;
+                }
+        }
+
+        *n_wp = n_w;
+        return C_EFI_SUCCESS;
+}
+
+/* read a Huffman tree description and build the decoding table */
+static inline CEfiStatus c_efi_zstd_huf_read(CEfiZstd *dec, const CEfiU8 *src, CEfiUSize n, CEfiUSize *n_usedp) {
+        CEfiU32 rank[C_EFI_ZSTD_HUF_LOG_MAX + 2] = { 0 }, n_w, sum = 0, log, rest, i, k, start, len;
+        CEfiU8 w[256];
+        CEfiStatus r;
+
+        if (!n)
+                return C_EFI_COMPROMISED_DATA;
+
+        if (src[0] < 128) {
+                if ((CEfiUSize)src[0] + 1 > n)
+                        return C_EFI_COMPROMISED_DATA;
+                r = c_efi_zstd_huf_weights(w, &n_w, src + 1, src[0]);
+                if (C_EFI_ERROR(r))
+                        return r;
+                *n_usedp = 1 + src[0];
+        } else {
+                n_w = src[0] - 127;
+                if (1 + (n_w + 1) / 2 > n)
+                        return C_EFI_COMPROMISED_DATA;
+                for (i = 0; i < n_w; ++i)
+                        w[i] = (i & 1) ? (src[1 + i / 2] & 15) : (src[1 + i / 2] >> 4);
+                *n_usedp = 1 + (n_w + 1) / 2;
+        }
+
+        for (i = 0; i < n_w; ++i) {
+                if (w[i] > C_EFI_ZSTD_HUF_LOG_MAX)
+                        return C_EFI_COMPROMISED_DATA;
+                ++rank[w[i]];
+                sum += (C_EFI_U32_C(1) << w[i]) >> 1;
+        }
+        if (!sum)
+                return C_EFI_COMPROMISED_DATA;
+
+        /* the weight of the last symbol is implied by the total */
+        log = c_efi_zstd_highbit(sum) + 1;
+        if (log > C_EFI_ZSTD_HUF_LOG_MAX)
+                return C_EFI_COMPROMISED_DATA;
+        rest = (C_EFI_U32_C(1) << log) - sum;
+        if (rest & (rest - 1))
+                return C_EFI_COMPROMISED_DATA;
+        w[n_w] = c_efi_zstd_highbit(rest) + 1;
+        ++rank[w[n_w]];
+        if (rank[1] < 2 || (rank[1] & 1))
+                return C_EFI_COMPROMISED_DATA;
+
+        /* longest codes first, each weight in order of symbol values */
+        for (start = 0, i = 1; i <= log; ++i) {
+                k = rank[i];
+                rank[i] = start;
+                start += k << (i - 1);
+        }
+        for (i = 0; i <= n_w; ++i) {
+                if (!w[i])
+                        continue;
+                len = (C_EFI_U32_C(1) << w[i]) >> 1;
+                for (k = 0; k < len; ++k)
+                        dec->huf[rank[w[i]] + k] = (CEfiZstdHuf){ i, log + 1 - w[i] };
+                rank[w[i]] += len;
+        }
+
+        dec->huf_log = log;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiU8 c_efi_zstd_huf_symbol(const CEfiZstdHuf *huf, CEfiU32 log, CEfiZstdBits *br) {
+        const CEfiZstdHuf *e = huf + c_efi_zstd_bits_peek(br, log);
+
+        br->consumed += e->n_bits;
+        return e->symbol;
+}
+
+/* decode @n_dst literals from 1 or 4 Huffman coded streams */
+static inline CEfiStatus c_efi_zstd_huf_decode(CEfiZstd *dec,
+                                               CEfiU8 *dst,
+                                               CEfiUSize n_dst,
+                                               const CEfiU8 *src,
+                                               CEfiUSize n,
+                                               CEfiBool four) {
+        const CEfiZstdHuf *huf = dec->huf;
+        CEfiU32 log = dec->huf_log, i, j;
+        CEfiUSize sizes[4], segment, offset;
+        CEfiU8 *op[4], *oe[4];
+        CEfiZstdBits br[4];
+        CEfiStatus r;
+
+        if (!four) {
+                sizes[0] = n;
+                op[0] = dst;
+                oe[0] = dst + n_dst;
+        } else {
+                if (n < 10)
+                        return C_EFI_COMPROMISED_DATA;
+                sizes[0] = c_efi_zstd_le(src, 2);
+                sizes[1] = c_efi_zstd_le(src + 2, 2);
+                sizes[2] = c_efi_zstd_le(src + 4, 2);
+                if (sizes[0] + sizes[1] + sizes[2] + 6 > n)
+                        return C_EFI_COMPROMISED_DATA;
+                sizes[3] = n - 6 - sizes[0] - sizes[1] - sizes[2];
+                src += 6;
+
+                segment = (n_dst + 3) / 4;
+                if (3 * segment > n_dst)
+                        return C_EFI_COMPROMISED_DATA;
+                for (i = 0; i < 4; ++i) {
+                        op[i] = dst + i * segment;
+                        oe[i] = i < 3 ? op[i] + segment : dst + n_dst;
+                }
+        }
+
+        for (offset = 0, i = 0; i < (four ? 4U : 1U); offset += sizes[i++]) {
+                r = c_efi_zstd_bits_init(&br[i], src + offset, sizes[i]);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        /* a reload leaves at least 57 bits, enough for 4 symbols of 11 bits */
+        if (four) {
+                while (oe[0] - op[0] >= 4 && oe[1] - op[1] >= 4 && oe[2] - op[2] >= 4 && oe[3] - op[3] >= 4) {
+                        for (i = 0; i < 4; ++i)
+                                c_efi_zstd_bits_reload(&br[i]);
+                        for (j = 0; j < 4; ++j)
+                                for (i = 0; i < 4; ++i)
+                                        *op[i]++ = c_efi_zstd_huf_symbol(huf, log, &br[i]);
+                }
+        }
+
+        for (i = 0; i < (four ? 4U : 1U); ++i) {
+                while (oe[i] - op[i] >= 4) {
+                        c_efi_zstd_bits_reload(&br[i]);
+                        for (j = 0; j < 4; ++j)
+                                *op[i]++ = c_efi_zstd_huf_symbol(huf, log, &br[i]);
+                }
+                c_efi_zstd_bits_reload(&br[i]);
+                while (op[i] < oe[i])
+                        *op[i]++ = c_efi_zstd_huf_symbol(huf, log, &br[i]);
+                if (!c_efi_zstd_bits_done(&br[i]))
+                        return C_EFI_COMPROMISED_DATA;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/* parse the literals section, RFC 8878 section 3.1.1.3.1 */
+static inline CEfiStatus c_efi_zstd_literals(CEfiZstd *dec,
+                                             const CEfiU8 *src,
+                                             CEfiUSize n,
+                                             const CEfiU8 **litp,
+                                             CEfiUSize *n_litp,
+                                             const CEfiU8 **lit_endp,
+                                             CEfiUSize *n_usedp) {
+        CEfiU32 type = src[0] & 3, format = (src[0] >> 2) & 3, header, bits, i;
+        CEfiUSize regen, size, used;
+        CEfiU64 v = 0;
+        CEfiStatus r;
+
+        if (type < 2) {
+                header = (format & 1) ? 2 + (format >> 1) : 1;
+                if (header > n)
+                        return C_EFI_COMPROMISED_DATA;
+                regen = c_efi_zstd_le(src, header) >> (header == 1 ? 3 : 4);
+                if (regen > dec->block_max)
+                        return C_EFI_COMPROMISED_DATA;
+
+                if (type == 0) {
+                        if (regen > n - header)
+                                return C_EFI_COMPROMISED_DATA;
+                        *litp = src + header;
+                        *n_litp = regen;
+                        *lit_endp = src + n;
+                        *n_usedp = header + regen;
+                } else {
+                        if (header >= n)
+                                return C_EFI_COMPROMISED_DATA;
+                        if (regen + C_EFI_ZSTD_LITERALS_SLACK > dec->n_literals)
+                                return C_EFI_OUT_OF_RESOURCES;
+                        c_efi_memset(dec->literals, src[header], regen);
+                        *litp = dec->literals;
+                        *n_litp = regen;
+                        *lit_endp = dec->literals + dec->n_literals;
+                        *n_usedp = header + 1;
+                }
+                return C_EFI_SUCCESS;
+        }
+
+        header = format < 2 ? 3 : format + 2;
+        bits = format < 2 ? 10 : 4 * format + 6;
+        if (header > n)
+                return C_EFI_COMPROMISED_DATA;
+        for (i = header; i--; )
+                v = (v << 8) | src[i];
+        regen = (v >> 4) & ((C_EFI_U32_C(1) << bits) - 1);
+        size = (v >> (4 + bits)) & ((C_EFI_U32_C(1) << bits) - 1);
+        if (regen > dec->block_max || size > n - header)
+                return C_EFI_COMPROMISED_DATA;
+        if (regen + C_EFI_ZSTD_LITERALS_SLACK > dec->n_literals)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        src += header;
+        used = 0;
+        if (type == 2) {
+                r = c_efi_zstd_huf_read(dec, src, size, &used);
+                if (C_EFI_ERROR(r)) {
+                        dec->huf_log = 0;
+                        return r;
+                }
+        } else if (!dec->huf_log) {
+                return C_EFI_COMPROMISED_DATA;
+        }
+
+        r = c_efi_zstd_huf_decode(dec, dec->literals, regen, src + used, size - used, format != 0);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        *litp = dec->literals;
+        *n_litp = regen;
+        *lit_endp = dec->literals + dec->n_literals;
+        *n_usedp = header + size;
+        return C_EFI_SUCCESS;
+}
+
+/* set up one of the sequence decoding tables, RFC 8878 section 3.1.1.3.2.2 */
+static inline CEfiStatus c_efi_zstd_table(CEfiZstdFse *table,
+                                          CEfiU32 *logp,
+                                          CEfiU32 mode,
+                                          const CEfiI16 *defaults,
+                                          CEfiU32 n_defaults,
+                                          CEfiU32 default_log,
+                                          CEfiU32 symbol_max,
+                                          CEfiU32 log_max,
+                                          const CEfiU32 *base,
+                                          const CEfiU8 *extra,
+                                          const CEfiU8 *src,
+                                          CEfiUSize n,
+                                          CEfiUSize *n_usedp) {
+        CEfiI16 norm[C_EFI_ZSTD_ML_SYMBOL_MAX + 1];
+        CEfiU32 n_symbols, log;
+        CEfiStatus r;
+
+        *n_usedp = 0;
+        switch (mode) {
+        case 0:
+                *logp = default_log;
+                return c_efi_zstd_fse_build(table, defaults, n_defaults, default_log, base, extra);
+        case 1:
+                if (!n || src[0] > symbol_max)
+                        return C_EFI_COMPROMISED_DATA;
+                table[0] = (CEfiZstdFse){ base[src[0]], 0, 0, extra[src[0]] };
+                *logp = 0;
+                *n_usedp = 1;
+                return C_EFI_SUCCESS;
+        case 2:
+                r = c_efi_zstd_fse_read(norm, symbol_max, log_max, &n_symbols, &log, src, n, n_usedp);
+                if (C_EFI_ERROR(r))
+                        return r;
+                *logp = log;
+                return c_efi_zstd_fse_build(table, norm, n_symbols, log, base, extra);
+        default:
+                /* repeat mode, the table of the previous block must exist */
+                return *logp == (CEfiU32)-1 ? C_EFI_COMPROMISED_DATA : C_EFI_SUCCESS;
+        }
+}
+
+static inline void c_efi_zstd_copy_match(CEfiU8 *op, CEfiUSize off, CEfiUSize len, CEfiU8 *oend) {
+        static const CEfiU8 stride[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+        const CEfiU8 *match = op - off;
+        CEfiU8 *e = op + len;
+        CEfiUSize i;
+
+        if ((CEfiUSize)(oend - op) < len + 8) {
+                for ( ; op < e; ++op, ++match)
+                        *op = *match;
+                return;
+        }
+
+        if (off < 8) {
+                for (i = 0; i < 8; ++i)
+                        op[i] = match[i];
+                match = op + 8 - stride[off];
+                op += 8;
+        }
+        for ( ; op < e; op += 8, match += 8)
+                c_efi_zstd_copy8(op, match);
+}
+
+/* decode the next sequence, and advance the states unless it is the last */
+static inline void c_efi_zstd_seq_decode(CEfiZstdSeqs *s, CEfiZstdSeq *seq, CEfiBool last) {
+        const CEfiZstdFse *e_ll = s->ll + s->s_ll, *e_ml = s->ml + s->s_ml, *e_of = s->of + s->s_of;
+        CEfiUSize off;
+        CEfiU32 idx;
+
+        /* offset, match length, literals length, in this order */
+        c_efi_zstd_bits_reload(&s->br);
+        off = e_of->base + c_efi_zstd_bits_read(&s->br, e_of->n_extra);
+        seq->ml = e_ml->base + c_efi_zstd_bits_read(&s->br, e_ml->n_extra);
+        if (e_of->n_extra + e_ml->n_extra + e_ll->n_extra >= 31)
+                c_efi_zstd_bits_reload(&s->br);
+        seq->ll = e_ll->base + c_efi_zstd_bits_read(&s->br, e_ll->n_extra);
+
+        if (off > 3) {
+                off -= 3;
+                s->rep[2] = s->rep[1];
+                s->rep[1] = s->rep[0];
+                s->rep[0] = off;
+        } else {
+                idx = off - 1 + !e_ll->base;
+                if (idx == 0) {
+                        off = s->rep[0];
+                } else {
+                        off = idx < 3 ? s->rep[idx] : s->rep[0] - 1;
+                        if (idx != 1)
+                                s->rep[2] = s->rep[1];
+                        s->rep[1] = s->rep[0];
+                        s->rep[0] = off;
+                }
+        }
+        seq->off = off;
+
+        if (!last) {
+                s->s_ll = e_ll->next + c_efi_zstd_bits_read(&s->br, e_ll->n_bits);
+                s->s_ml = e_ml->next + c_efi_zstd_bits_read(&s->br, e_ml->n_bits);
+                s->s_of = e_of->next + c_efi_zstd_bits_read(&s->br, e_of->n_bits);
+        }
+}
+
+/* copy the literals and the match of a sequence */
+static inline CEfiStatus c_efi_zstd_seq_exec(const CEfiZstdSeq *seq,
+                                             CEfiU8 **opp,
+                                             const CEfiU8 **lpp,
+                                             const CEfiU8 *le,
+                                             const CEfiU8 *lit_end,
+                                             const CEfiU8 *base,
+                                             CEfiU8 *oend) {
+        CEfiUSize ll = seq->ll, k;
+        const CEfiU8 *lp = *lpp;
+        CEfiU8 *op = *opp;
+
+        if (ll > (CEfiUSize)(le - lp))
+                return C_EFI_COMPROMISED_DATA;
+        if (ll + seq->ml > (CEfiUSize)(oend - op))
+                return C_EFI_BUFFER_TOO_SMALL;
+
+        if ((CEfiUSize)(lit_end - lp) >= ll + 16 && (CEfiUSize)(oend - op) >= ll + 16) {
+                for (k = 0; k < ll; k += 16) {
+                        c_efi_zstd_copy8(op + k, lp + k);
+                        c_efi_zstd_copy8(op + k + 8, lp + k + 8);
+                }
+        } else {
+                c_efi_memcpy(op, lp, ll);
+        }
+        op += ll;
+
+        if (!seq->off || seq->off > (CEfiUSize)(op - base))
+                return C_EFI_COMPROMISED_DATA;
+        c_efi_zstd_copy_match(op, seq->off, seq->ml, oend);
+
+        *opp = op + seq->ml;
+        *lpp = lp + ll;
+        return C_EFI_SUCCESS;
+}
+
+/*
+ * Decode the sequences section and execute the sequences into @dst. Matches
+ * may refer back to @base. Literals between @lit and @lit_end may be read in
+ * 16 byte strides.
+ *
+ * Matches reach back as far as the frame window, far beyond the caches, so
+ * sequences are decoded C_EFI_ZSTD_AHEAD ahead of their execution and the
+ * sources of their matches are prefetched in the meantime.
+ */
+static inline CEfiStatus c_efi_zstd_sequences(CEfiZstd *dec,
+                                              const CEfiU8 *src,
+                                              CEfiUSize n,
+                                              const CEfiU8 *lit,
+                                              CEfiUSize n_lit,
+                                              const CEfiU8 *lit_end,
+                                              CEfiU8 *base,
+                                              CEfiU8 *dst,
+                                              CEfiUSize n_dst,
+                                              CEfiUSize *n_outp) {
+        const CEfiU8 *lp = lit, *le = lit + n_lit;
+        CEfiU8 *op = dst, *oend = dst + n_dst;
+        CEfiUSize n_seq, n_ahead, used, i, k, pf, back = dst - base;
+        CEfiZstdSeq ring[C_EFI_ZSTD_AHEAD], *seq;
+        CEfiZstdSeqs s;
+        CEfiU32 modes;
+        CEfiStatus r;
+
+        if (!n)
+                return C_EFI_COMPROMISED_DATA;
+
+        if (src[0] < 128) {
+                n_seq = src[0];
+                used = 1;
+        } else if (src[0] < 255) {
+                if (n < 2)
+                        return C_EFI_COMPROMISED_DATA;
+                n_seq = ((CEfiUSize)(src[0] - 128) << 8) + src[1];
+                used = 2;
+        } else {
+                if (n < 3)
+                        return C_EFI_COMPROMISED_DATA;
+                n_seq = src[1] + ((CEfiUSize)src[2] << 8) + 0x7f00;
+                used = 3;
+        }
+
+        if (n_seq) {
+                if (used >= n)
+                        return C_EFI_COMPROMISED_DATA;
+                modes = src[used++];
+                if (modes & 3)
+                        return C_EFI_COMPROMISED_DATA;
+
+                r = c_efi_zstd_table(dec->ll, &dec->ll_log, modes >> 6,
+                                     c_efi_zstd_ll_default, C_EFI_ZSTD_LL_SYMBOL_MAX + 1, 6,
+                                     C_EFI_ZSTD_LL_SYMBOL_MAX, C_EFI_ZSTD_LL_LOG_MAX,
+                                     c_efi_zstd_ll_base, c_efi_zstd_ll_extra,
+                                     src + used, n - used, &k);
+                if (C_EFI_ERROR(r))
+                        return r;
+                used += k;
+                r = c_efi_zstd_table(dec->of, &dec->of_log, (modes >> 4) & 3,
+                                     c_efi_zstd_of_default, 29, 5,
+                                     C_EFI_ZSTD_OF_SYMBOL_MAX, C_EFI_ZSTD_OF_LOG_MAX,
+                                     c_efi_zstd_of_base, c_efi_zstd_of_extra,
+                                     src + used, n - used, &k);
+                if (C_EFI_ERROR(r))
+                        return r;
+                used += k;
+                r = c_efi_zstd_table(dec->ml, &dec->ml_log, (modes >> 2) & 3,
+                                     c_efi_zstd_ml_default, C_EFI_ZSTD_ML_SYMBOL_MAX + 1, 6,
+                                     C_EFI_ZSTD_ML_SYMBOL_MAX, C_EFI_ZSTD_ML_LOG_MAX,
+                                     c_efi_zstd_ml_base, c_efi_zstd_ml_extra,
+                                     src + used, n - used, &k);
+                if (C_EFI_ERROR(r))
+                        return r;
+                used += k;
+
+                r = c_efi_zstd_bits_init(&s.br, src + used, n - used);
+                if (C_EFI_ERROR(r))
+                        return r;
+
+                /* output stores may alias @dec, so keep hot state in locals */
+                s.ll = dec->ll;
+                s.ml = dec->ml;
+                s.of = dec->of;
+                s.rep[0] = dec->rep[0];
+                s.rep[1] = dec->rep[1];
+                s.rep[2] = dec->rep[2];
+                s.s_ll = c_efi_zstd_bits_read(&s.br, dec->ll_log);
+                s.s_of = c_efi_zstd_bits_read(&s.br, dec->of_log);
+                s.s_ml = c_efi_zstd_bits_read(&s.br, dec->ml_log);
+
+                n_ahead = n_seq < C_EFI_ZSTD_AHEAD ? n_seq : C_EFI_ZSTD_AHEAD;
+                for (pf = 0, i = 0; i < n_seq + n_ahead; ++i) {
+                        if (i >= n_ahead) {
+                                r = c_efi_zstd_seq_exec(&ring[(i - n_ahead) % C_EFI_ZSTD_AHEAD],
+                                                        &op, &lp, le, lit_end, base, oend);
+                                if (C_EFI_ERROR(r))
+                                        return r;
+                        }
+                        if (i < n_seq) {
+                                seq = &ring[i % C_EFI_ZSTD_AHEAD];
+                                c_efi_zstd_seq_decode(&s, seq, i + 1 == n_seq);
+                                pf += seq->ll;
+                                if (seq->off <= back + pf && pf <= n_dst)
+                                        __builtin_prefetch(base + (back + pf - seq->off));
+                                pf += seq->ml;
+                        }
+                }
+
+                if (!c_efi_zstd_bits_done(&s.br))
+                        return C_EFI_COMPROMISED_DATA;
+        } else if (used != n) {
+                return C_EFI_COMPROMISED_DATA;
+        }
+
+        k = le - lp;
+        if (k > (CEfiUSize)(oend - op))
+                return C_EFI_BUFFER_TOO_SMALL;
+        c_efi_memcpy(op, lp, k);
+        op += k;
+
+        /* repeated offsets only advance once the block is complete */
+        if (n_seq) {
+                dec->rep[0] = s.rep[0];
+                dec->rep[1] = s.rep[1];
+                dec->rep[2] = s.rep[2];
+        }
+
+        *n_outp = op - dst;
+        return C_EFI_SUCCESS;
+}
+
+/**
+ * c_efi_zstd_init() - Initialize a zstd decoder
+ * @dec:                decoder to initialize
+ * @flags:              C_EFI_ZSTD_FLAG_* to modify the decoder
+ * @window:             output window
+ * @n_window:           size of @window in bytes
+ * @workspace:          workspace for literals and split blocks
+ * @n_workspace:        size of @workspace in bytes
+ *
+ * This prepares @dec to decode a stream of zstd frames into @window. The
+ * buffers are owned by the caller and must stay valid while @dec is used.
+ * The first half of the workspace, up to C_EFI_ZSTD_BLOCK_MAX plus
+ * C_EFI_ZSTD_LITERALS_SLACK, holds literals, the rest stages split blocks.
+ * A decoder can be re-initialized at any time to start a new stream.
+ */
+static inline void c_efi_zstd_init(CEfiZstd *dec,
+                                   CEfiU32 flags,
+                                   void *window,
+                                   CEfiUSize n_window,
+                                   void *workspace,
+                                   CEfiUSize n_workspace) {
+        CEfiUSize n_literals = 0;
+
+        /* split evenly, once the slack of the literals is accounted for */
+        if (n_workspace >= C_EFI_ZSTD_LITERALS_SLACK)
+                n_literals = (n_workspace + C_EFI_ZSTD_LITERALS_SLACK) / 2;
+        if (n_literals > C_EFI_ZSTD_BLOCK_MAX + C_EFI_ZSTD_LITERALS_SLACK)
+                n_literals = C_EFI_ZSTD_BLOCK_MAX + C_EFI_ZSTD_LITERALS_SLACK;
+
+        dec->flags = flags;
+        dec->status = C_EFI_SUCCESS;
+        dec->window = window;
+        dec->n_window = n_window;
+        dec->pos = 0;
+        dec->tail = 0;
+        dec->base = 0;
+        dec->literals = workspace;
+        dec->n_literals = n_literals;
+        dec->staging = (CEfiU8 *)workspace + n_literals;
+        dec->n_staging = n_workspace - n_literals;
+        dec->n_staged = 0;
+        dec->state = C_EFI_ZSTD_STATE_MAGIC;
+        dec->n_header = 0;
+        dec->n_frames = 0;
+        dec->n_blocks = 0;
+        dec->n_direct = 0;
+        dec->n_slides = 0;
+        dec->n_slide_bytes = 0;
+}
+
+/**
+ * c_efi_zstd_pending() - Return decoded data not yet released
+ * @dec:                decoder to query
+ * @datap:              output variable for the decoded data
+ *
+ * Return: The number of bytes at *@datap.
+ */
+static inline CEfiUSize c_efi_zstd_pending(CEfiZstd *dec, const CEfiU8 **datap) {
+        *datap = dec->window + dec->tail;
+        return dec->pos - dec->tail;
+}
+
+/**
+ * c_efi_zstd_release() - Release decoded data
+ * @dec:                decoder to operate on
+ * @n:                  number of bytes to release
+ *
+ * This marks the first @n bytes returned by c_efi_zstd_pending() as consumed,
+ * so the decoder can reuse their space in the window once they dropped out
+ * of the history.
+ */
+static inline void c_efi_zstd_release(CEfiZstd *dec, CEfiUSize n) {
+        if (n > dec->pos - dec->tail)
+                n = dec->pos - dec->tail;
+        dec->tail += n;
+}
+
+/**
+ * c_efi_zstd_done() - Check for a frame boundary
+ * @dec:                decoder to query
+ *
+ * Return: True if at least one frame was decoded and the decoder is not in
+ *         the middle of another frame, false otherwise. When the input ends,
+ *         this tells whether it was complete.
+ */
+static inline CEfiBool c_efi_zstd_done(CEfiZstd *dec) {
+        return !dec->status && dec->n_frames && !dec->n_header && dec->state == C_EFI_ZSTD_STATE_MAGIC;
+}
+
+/* move history and unreleased data to the front, if that frees @need bytes */
+static inline void c_efi_zstd_make_room(CEfiZstd *dec, CEfiUSize need) {
+        CEfiUSize keep, shift;
+
+        if (dec->n_window - dec->pos >= need)
+                return;
+
+        keep = dec->pos - dec->base;
+        if (keep > dec->window_size)
+                keep = dec->window_size;
+        shift = dec->pos - keep;
+        if (shift > dec->tail)
+                shift = dec->tail;
+        if (!shift)
+                return;
+
+        c_efi_memmove(dec->window, dec->window + shift, dec->pos - shift);
+        dec->pos -= shift;
+        dec->tail -= shift;
+        dec->base = dec->base > shift ? dec->base - shift : 0;
+        ++dec->n_slides;
+        dec->n_slide_bytes += dec->pos;
+}
+
+static inline CEfiStatus c_efi_zstd_gather(CEfiZstd *dec, const CEfiU8 **p, CEfiUSize *n, CEfiU32 need) {
+        while (dec->n_header < need) {
+                if (!*n)
+                        return C_EFI_NOT_READY;
+                dec->header[dec->n_header++] = *(*p)++;
+                --*n;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiBool c_efi_zstd_verify(CEfiZstd *dec) {
+        return (dec->descriptor & 0x04) && !(dec->flags & C_EFI_ZSTD_FLAG_SKIP_CHECKSUM);
+}
+
+static inline void c_efi_zstd_produced(CEfiZstd *dec, CEfiUSize n) {
+        if (c_efi_zstd_verify(dec))
+                c_efi_xxh64_update(&dec->xxh, dec->window + dec->pos, n);
+        dec->pos += n;
+        dec->n_content += n;
+}
+
+static inline CEfiStatus c_efi_zstd_magic(CEfiZstd *dec) {
+        CEfiU32 magic = c_efi_zstd_le(dec->header, 4);
+
+        dec->n_header = 0;
+        if (magic == C_EFI_ZSTD_MAGIC)
+                dec->state = C_EFI_ZSTD_STATE_FRAME_HEADER;
+        else if ((magic & C_EFI_ZSTD_MAGIC_SKIPPABLE_MASK) == C_EFI_ZSTD_MAGIC_SKIPPABLE)
+                dec->state = C_EFI_ZSTD_STATE_SKIP_SIZE;
+        else
+                return C_EFI_COMPROMISED_DATA;
+
+        return C_EFI_SUCCESS;
+}
+
+/* parse the frame header, RFC 8878 section 3.1.1.1 */
+static inline CEfiStatus c_efi_zstd_frame_header(CEfiZstd *dec, const CEfiU8 **p, CEfiUSize *n) {
+        static const CEfiU8 did_sizes[4] = { 0, 1, 2, 4 };
+        static const CEfiU8 fcs_sizes[4] = { 0, 2, 4, 8 };
+        CEfiU32 d, single, did_size, fcs_size, size, wd, log;
+        const CEfiU8 *h;
+        CEfiStatus r;
+
+        r = c_efi_zstd_gather(dec, p, n, 1);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        d = dec->header[0];
+        if (d & 0x08)
+                return C_EFI_COMPROMISED_DATA;
+        single = (d >> 5) & 1;
+        did_size = did_sizes[d & 3];
+        fcs_size = fcs_sizes[d >> 6];
+        if (single && !fcs_size)
+                fcs_size = 1;
+        size = 1 + !single + did_size + fcs_size;
+
+        r = c_efi_zstd_gather(dec, p, n, size);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        h = dec->header + 1;
+        if (!single) {
+                wd = *h++;
+                log = 10 + (wd >> 3);
+                dec->window_size = (C_EFI_U64_C(1) << log) + ((C_EFI_U64_C(1) << log) >> 3) * (wd & 7);
+        }
+        if (did_size && c_efi_zstd_le(h, did_size))
+                return C_EFI_UNSUPPORTED;
+        h += did_size;
+
+        dec->content_size = 0;
+        if (fcs_size == 8)
+                dec->content_size = c_efi_zstd_le(h, 4) | ((CEfiU64)c_efi_zstd_le(h + 4, 4) << 32);
+        else if (fcs_size)
+                dec->content_size = c_efi_zstd_le(h, fcs_size) + (fcs_size == 2 ? 256 : 0);
+        if (single)
+                dec->window_size = dec->content_size;
+
+        dec->descriptor = d;
+        dec->block_max = dec->window_size < C_EFI_ZSTD_BLOCK_MAX ? dec->window_size : C_EFI_ZSTD_BLOCK_MAX;
+        dec->n_content = 0;
+        dec->base = dec->pos;
+        dec->rep[0] = 1;
+        dec->rep[1] = 4;
+        dec->rep[2] = 8;
+        dec->ll_log = (CEfiU32)-1;
+        dec->ml_log = (CEfiU32)-1;
+        dec->of_log = (CEfiU32)-1;
+        dec->huf_log = 0;
+        c_efi_xxh64_init(&dec->xxh, 0);
+
+        dec->n_header = 0;
+        dec->state = C_EFI_ZSTD_STATE_BLOCK_HEADER;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_zstd_frame_end(CEfiZstd *dec) {
+        if ((dec->descriptor & 0xe0) && dec->n_content != dec->content_size)
+                return C_EFI_COMPROMISED_DATA;
+
+        ++dec->n_frames;
+        dec->state = C_EFI_ZSTD_STATE_MAGIC;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_zstd_block_end(CEfiZstd *dec) {
+        if (!dec->last)
+                dec->state = C_EFI_ZSTD_STATE_BLOCK_HEADER;
+        else if (dec->descriptor & 0x04)
+                dec->state = C_EFI_ZSTD_STATE_CHECKSUM;
+        else
+                return c_efi_zstd_frame_end(dec);
+
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus c_efi_zstd_block_header(CEfiZstd *dec) {
+        CEfiU32 v = c_efi_zstd_le(dec->header, 3), type = (v >> 1) & 3;
+
+        dec->n_header = 0;
+        dec->last = v & 1;
+        dec->block_size = v >> 3;
+        if (dec->block_size > dec->block_max)
+                return C_EFI_COMPROMISED_DATA;
+
+        switch (type) {
+        case C_EFI_ZSTD_BLOCK_RAW:
+                dec->state = C_EFI_ZSTD_STATE_RAW;
+                break;
+        case C_EFI_ZSTD_BLOCK_RLE:
+                dec->state = C_EFI_ZSTD_STATE_RLE;
+                break;
+        case C_EFI_ZSTD_BLOCK_COMPRESSED:
+                dec->state = C_EFI_ZSTD_STATE_BLOCK;
+                break;
+        default:
+                return C_EFI_COMPROMISED_DATA;
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+/* decode a complete block, leaving it for a retry if the window is full */
+static inline CEfiStatus c_efi_zstd_compressed(CEfiZstd *dec, const CEfiU8 *src) {
+        CEfiUSize n = dec->block_size, n_lit, used, limit, n_out;
+        const CEfiU8 *lit, *lit_end;
+        CEfiStatus r;
+
+        c_efi_zstd_make_room(dec, dec->block_max);
+        limit = dec->n_window - dec->pos;
+        if (limit > dec->block_max)
+                limit = dec->block_max;
+
+        if (!n)
+                return C_EFI_COMPROMISED_DATA;
+        r = c_efi_zstd_literals(dec, src, n, &lit, &n_lit, &lit_end, &used);
+        if (C_EFI_ERROR(r))
+                return r;
+
+        r = c_efi_zstd_sequences(dec, src + used, n - used, lit, n_lit, lit_end,
+                                 dec->window + dec->base, dec->window + dec->pos, limit, &n_out);
+        if (r == C_EFI_BUFFER_TOO_SMALL && limit == dec->block_max)
+                r = C_EFI_COMPROMISED_DATA;
+        if (C_EFI_ERROR(r))
+                return r;
+
+        c_efi_zstd_produced(dec, n_out);
+        ++dec->n_blocks;
+        return c_efi_zstd_block_end(dec);
+}
+
+static inline CEfiStatus c_efi_zstd_block_data(CEfiZstd *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiUSize k;
+        CEfiStatus r;
+
+        if (!dec->n_staged && *n >= dec->block_size) {
+                r = c_efi_zstd_compressed(dec, *p);
+                if (C_EFI_ERROR(r))
+                        return r;
+                *p += dec->block_size;
+                *n -= dec->block_size;
+                ++dec->n_direct;
+                return C_EFI_SUCCESS;
+        }
+
+        if (dec->block_size > dec->n_staging)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        k = dec->block_size - dec->n_staged;
+        if (k > *n)
+                k = *n;
+        c_efi_memcpy(dec->staging + dec->n_staged, *p, k);
+        dec->n_staged += k;
+        *p += k;
+        *n -= k;
+        if (dec->n_staged < dec->block_size)
+                return C_EFI_NOT_READY;
+
+        r = c_efi_zstd_compressed(dec, dec->staging);
+        if (C_EFI_ERROR(r))
+                return r;
+        dec->n_staged = 0;
+        return C_EFI_SUCCESS;
+}
+
+/* raw and RLE blocks are streamed into the window, as far as it has room */
+static inline CEfiStatus c_efi_zstd_fill(CEfiZstd *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiBool rle = dec->state == C_EFI_ZSTD_STATE_RLE;
+        CEfiUSize k;
+        CEfiStatus r;
+
+        /* the byte to repeat is kept in the header buffer */
+        if (rle) {
+                r = c_efi_zstd_gather(dec, p, n, 1);
+                if (C_EFI_ERROR(r))
+                        return r;
+        }
+
+        if (dec->block_size) {
+                if (!rle && !*n)
+                        return C_EFI_NOT_READY;
+
+                c_efi_zstd_make_room(dec, dec->block_size);
+                k = dec->n_window - dec->pos;
+                if (!k)
+                        return C_EFI_BUFFER_TOO_SMALL;
+                if (k > dec->block_size)
+                        k = dec->block_size;
+
+                if (rle) {
+                        c_efi_memset(dec->window + dec->pos, dec->header[0], k);
+                } else {
+                        if (k > *n)
+                                k = *n;
+                        c_efi_memcpy(dec->window + dec->pos, *p, k);
+                        *p += k;
+                        *n -= k;
+                }
+
+                c_efi_zstd_produced(dec, k);
+                dec->block_size -= k;
+                if (dec->block_size)
+                        return C_EFI_SUCCESS;
+        }
+
+        dec->n_header = 0;
+        return c_efi_zstd_block_end(dec);
+}
+
+static inline CEfiStatus c_efi_zstd_step(CEfiZstd *dec, const CEfiU8 **p, CEfiUSize *n) {
+        CEfiUSize k;
+        CEfiStatus r;
+
+        switch (dec->state) {
+        case C_EFI_ZSTD_STATE_MAGIC:
+                r = c_efi_zstd_gather(dec, p, n, 4);
+                return C_EFI_ERROR(r) ? r : c_efi_zstd_magic(dec);
+        case C_EFI_ZSTD_STATE_FRAME_HEADER:
+                return c_efi_zstd_frame_header(dec, p, n);
+        case C_EFI_ZSTD_STATE_BLOCK_HEADER:
+                r = c_efi_zstd_gather(dec, p, n, 3);
+                return C_EFI_ERROR(r) ? r : c_efi_zstd_block_header(dec);
+        case C_EFI_ZSTD_STATE_BLOCK:
+                return c_efi_zstd_block_data(dec, p, n);
+        case C_EFI_ZSTD_STATE_RAW:
+        case C_EFI_ZSTD_STATE_RLE:
+                return c_efi_zstd_fill(dec, p, n);
+        case C_EFI_ZSTD_STATE_CHECKSUM:
+                r = c_efi_zstd_gather(dec, p, n, 4);
+                if (C_EFI_ERROR(r))
+                        return r;
+                dec->n_header = 0;
+                if (c_efi_zstd_verify(dec) &&
+                    (CEfiU32)c_efi_xxh64_final(&dec->xxh) != c_efi_zstd_le(dec->header, 4))
+                        return C_EFI_CRC_ERROR;
+                return c_efi_zstd_frame_end(dec);
+        case C_EFI_ZSTD_STATE_SKIP_SIZE:
+                r = c_efi_zstd_gather(dec, p, n, 4);
+                if (C_EFI_ERROR(r))
+                        return r;
+                dec->n_header = 0;
+                dec->n_skip = c_efi_zstd_le(dec->header, 4);
+                dec->state = C_EFI_ZSTD_STATE_SKIP;
+                return C_EFI_SUCCESS;
+        case C_EFI_ZSTD_STATE_SKIP:
+                k = *n < dec->n_skip ? *n : dec->n_skip;
+                *p += k;
+                *n -= k;
+                dec->n_skip -= k;
+                if (dec->n_skip)
+                        return C_EFI_NOT_READY;
+                ++dec->n_frames;
+                dec->state = C_EFI_ZSTD_STATE_MAGIC;
+                return C_EFI_SUCCESS;
+        }
+
+        return C_EFI_COMPROMISED_DATA;
+}
+
+/**
+ * c_efi_zstd_decode() - Decode more input
+ * @dec:                decoder to operate on
+ * @in:                 next chunk of the compressed stream
+ * @n_in:               size of @in in bytes
+ * @n_consumedp:        output variable for the number of bytes consumed
+ *
+ * This decodes as much of @in as possible into the window. Input can be
+ * split at arbitrary boundaries. If the window is full, this stops early and
+ * the caller has to release output, then pass the rest of the input again.
+ *
+ * Return: C_EFI_SUCCESS if all input was consumed,
+ *         C_EFI_BUFFER_TOO_SMALL if the window is full. If nothing is
+ *         pending, the window is too small for the stream,
+ *         C_EFI_OUT_OF_RESOURCES if the workspace is too small for a block,
+ *         C_EFI_UNSUPPORTED if a frame needs a dictionary,
+ *         C_EFI_CRC_ERROR if a content checksum does not match,
+ *         C_EFI_COMPROMISED_DATA if the stream is malformed.
+ *         Errors other than C_EFI_BUFFER_TOO_SMALL are permanent.
+ */
+static inline CEfiStatus c_efi_zstd_decode(CEfiZstd *dec, const void *in, CEfiUSize n_in, CEfiUSize *n_consumedp) {
+        const CEfiU8 *p = in;
+        CEfiUSize n = n_in;
+        CEfiStatus r;
+
+        r = dec->status;
+        while (!r)
+                r = c_efi_zstd_step(dec, &p, &n);
+
+        if (r == C_EFI_NOT_READY)
+                r = C_EFI_SUCCESS;
+        else if (r != C_EFI_BUFFER_TOO_SMALL)
+                dec->status = r;
+
+        *n_consumedp = p - (const CEfiU8 *)in;
+        return r;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,12 +17,18 @@ extern "C" {
 
 #include <c-efi-base.h>
 #include <c-efi-system.h>
+#include <c-efi-protocol-block-io.h>
+#include <c-efi-protocol-block-io2.h>
 #include <c-efi-protocol-device-path.h>
 #include <c-efi-protocol-device-path-from-text.h>
 #include <c-efi-protocol-device-path-to-text.h>
 #include <c-efi-protocol-device-path-utility.h>
+#include <c-efi-protocol-disk-io.h>
+#include <c-efi-protocol-graphics-output.h>
 #include <c-efi-protocol-loaded-image.h>
 #include <c-efi-protocol-loaded-image-device-path.h>
+#include <c-efi-protocol-mp-services.h>
+#include <c-efi-protocol-simple-file-system.h>
 #include <c-efi-protocol-simple-text-input.h>
 #include <c-efi-protocol-simple-text-input-ex.h>
 #include <c-efi-protocol-simple-text-output.h>
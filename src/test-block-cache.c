@@ -0,0 +1,218 @@
+/*
+ * Tests for the Block I/O Read Cache
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-efi.h"
+#include "c-efi-block-cache.h"
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_N_BLOCKS 4000 /* not a multiple of the extent size */
+#define TEST_ALIGN 64
+#define TEST_BLOCK_IO
+#include "test-firmware.h"
+
+static CEfiU8 *test_disk;
+
+static void test_setup(void) {
+        size_t i;
+
+        test_disk_open();
+
+        test_disk = malloc(TEST_N_BLOCKS * TEST_BLOCK_SIZE);
+        assert(test_disk);
+        srand(3);
+        for (i = 0; i < TEST_N_BLOCKS * TEST_BLOCK_SIZE; ++i)
+                test_disk[i] = rand();
+        assert(write(test_fd, test_disk, TEST_N_BLOCKS * TEST_BLOCK_SIZE) == TEST_N_BLOCKS * TEST_BLOCK_SIZE);
+}
+
+static void test_check(CEfiBlockCache *cache, CEfiU64 offset, CEfiUSize size, CEfiU8 *buf) {
+        memset(buf, 0xaa, size + 1);
+        assert(!c_efi_block_cache_read(cache, offset, size, buf));
+        assert(!memcmp(buf, test_disk + offset, size));
+        assert(buf[size] == 0xaa);
+}
+
+static void test_init(void) {
+        CEfiBlockCacheExtent extents[16];
+        CEfiBlockCache cache;
+        static CEfiU8 data[16 * 8192 + TEST_ALIGN];
+
+        /* the data is aligned, and the extent count limited by both buffers */
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 16, data + 1, sizeof(data) - 1, 8000));
+        assert(!((uintptr_t)cache.data % TEST_ALIGN));
+        assert(cache.extent_size == 8192 && cache.extent_blocks == 16);
+        assert(cache.n_extents == 16 && cache.group == 8);
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 16, data + 1, 3 * 8192 + TEST_ALIGN, 8192));
+        assert(cache.n_extents == 3 && cache.group == 1);
+        assert(c_efi_block_cache_init(&cache, &test_bio, extents, 16, data + 1, 8192, 8192) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_block_cache_init(&cache, &test_bio, extents, 0, data, sizeof(data), 8192) == C_EFI_BUFFER_TOO_SMALL);
+
+        /* unaligned extents are supported, but never grouped */
+        test_media.io_align = 4096;
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 16, data, sizeof(data), 1000));
+        assert(cache.extent_size == 1024 && cache.stride == 4096 && cache.group == 1);
+        test_media.io_align = 3;
+        assert(c_efi_block_cache_init(&cache, &test_bio, extents, 16, data, sizeof(data), 0) == C_EFI_UNSUPPORTED);
+        test_media.io_align = TEST_ALIGN;
+
+        test_media.media_present = 0;
+        assert(c_efi_block_cache_init(&cache, &test_bio, extents, 16, data, sizeof(data), 0) == C_EFI_NO_MEDIA);
+        test_media.media_present = 1;
+}
+
+static void test_sequential(void) {
+        CEfiBlockCacheExtent extents[32];
+        CEfiBlockCache cache;
+        CEfiU8 *data, *buf;
+        CEfiU64 offset;
+
+        data = malloc(32 * 8192);
+        buf = aligned_alloc(TEST_ALIGN, TEST_N_BLOCKS * TEST_BLOCK_SIZE + TEST_ALIGN);
+        assert(data && buf);
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 32, data, 32 * 8192, 8192));
+        assert(cache.group == 8);
+
+        /* small sequential reads grow the window up to 8 extents */
+        test_n_reads = 0;
+        for (offset = 0; offset + 1000 <= TEST_N_BLOCKS * TEST_BLOCK_SIZE; offset += 1000)
+                test_check(&cache, offset, 1000, buf);
+        test_check(&cache, offset, TEST_N_BLOCKS * TEST_BLOCK_SIZE - offset, buf);
+        assert(test_n_reads == cache.n_reads && test_n_reads == cache.n_misses);
+        assert(cache.n_read_bytes == TEST_N_BLOCKS * TEST_BLOCK_SIZE);
+        assert(test_n_reads == 1 + 1 + 1 + 1 + (250 - 8 + 7) / 8);
+
+        /* the tail is cached, and served without device access */
+        test_n_reads = 0;
+        test_check(&cache, TEST_N_BLOCKS * TEST_BLOCK_SIZE - 5000, 5000, buf);
+        assert(test_n_reads == 0);
+
+        /* a large aligned request bypasses the cache */
+        c_efi_block_cache_invalidate(&cache);
+        test_n_reads = 0;
+        test_check(&cache, 0, TEST_N_BLOCKS * TEST_BLOCK_SIZE, buf);
+        assert(test_n_reads == 1);
+        test_check(&cache, 8192, 8192, buf);
+        assert(test_n_reads == 2);
+
+        /* an unaligned one does not */
+        c_efi_block_cache_invalidate(&cache);
+        test_n_reads = 0;
+        test_check(&cache, 0, 16 * 8192, buf + 1);
+        assert(test_n_reads == 5);
+
+        /* requests beyond the end fail */
+        assert(c_efi_block_cache_read(&cache, TEST_N_BLOCKS * TEST_BLOCK_SIZE, 1, buf) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_block_cache_read(&cache, 1, TEST_N_BLOCKS * TEST_BLOCK_SIZE, buf) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_block_cache_read(&cache, TEST_N_BLOCKS * TEST_BLOCK_SIZE, 0, buf));
+
+        free(buf);
+        free(data);
+}
+
+static void test_random(void) {
+        CEfiBlockCacheExtent extents[12];
+        CEfiBlockCache cache;
+        CEfiU8 *data, buf[20001];
+        CEfiU64 offset;
+        CEfiUSize i, size;
+
+        data = malloc(12 * 4096 + TEST_ALIGN);
+        assert(data);
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 12, data + 3, 12 * 4096 + TEST_ALIGN - 3, 4096));
+        assert(cache.n_extents == 12 && cache.group == 4);
+
+        srand(11);
+        for (i = 0; i < 20000; ++i) {
+                size = rand() % 20000;
+                offset = (CEfiU64)rand() % (TEST_N_BLOCKS * TEST_BLOCK_SIZE - size);
+                if (rand() % 4 == 0)
+                        offset = cache.next_lba * TEST_BLOCK_SIZE - (CEfiU64)rand() % 600;
+                if (offset + size > TEST_N_BLOCKS * TEST_BLOCK_SIZE)
+                        offset = 0;
+                test_check(&cache, offset, size, buf);
+        }
+
+        /* a hot set that fits the cache stays cached */
+        for (i = 0; i < 8; ++i)
+                test_check(&cache, i * 40960, 100, buf);
+        test_n_reads = 0;
+        for (i = 0; i < 800; ++i)
+                test_check(&cache, (i % 8) * 40960 + (i / 8) % 30 * 100, 100, buf);
+        assert(test_n_reads == 0);
+
+        free(data);
+}
+
+static void test_errors(void) {
+        CEfiBlockCacheExtent extents[8];
+        CEfiBlockCache cache;
+        CEfiU8 *data, buf[4097];
+
+        data = malloc(8 * 4096);
+        assert(data);
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 8, data, 8 * 4096, 4096));
+        test_check(&cache, 0, 100, buf);
+
+        /* device errors are passed through, and leave nothing cached */
+        test_read_error = C_EFI_DEVICE_ERROR;
+        assert(c_efi_block_cache_read(&cache, 8192, 100, buf) == C_EFI_DEVICE_ERROR);
+        test_read_error = 0;
+        test_n_reads = 0;
+        test_check(&cache, 0, 100, buf);
+        assert(test_n_reads == 0);
+        test_check(&cache, 8192, 100, buf);
+        assert(test_n_reads == 1);
+
+        /* a media change invalidates everything, and retries read the new media */
+        test_media.media_id = 2;
+        test_media.last_block = TEST_N_BLOCKS / 2 - 1;
+        assert(c_efi_block_cache_read(&cache, 12288, 100, buf) == C_EFI_MEDIA_CHANGED);
+        assert(c_efi_block_cache_lookup(&cache, 0) == C_EFI_BLOCK_CACHE_NONE);
+        assert(cache.media_id == 2 && cache.last_block == TEST_N_BLOCKS / 2 - 1);
+        test_n_reads = 0;
+        test_check(&cache, 0, 100, buf);
+        test_check(&cache, 12288, 100, buf);
+        assert(test_n_reads == 2);
+        assert(c_efi_block_cache_read(&cache, TEST_N_BLOCKS / 2 * TEST_BLOCK_SIZE, 1, buf) ==
+               C_EFI_INVALID_PARAMETER);
+
+        /* media with another geometry need a new cache */
+        test_media.media_id = 3;
+        test_media.io_align = 2 * TEST_ALIGN;
+        assert(c_efi_block_cache_read(&cache, 100000, 100, buf) == C_EFI_MEDIA_CHANGED);
+        assert(c_efi_block_cache_read(&cache, 0, 100, buf) == C_EFI_MEDIA_CHANGED);
+        assert(cache.media_id == 2);
+        test_media.media_id = 4;
+        test_media.io_align = TEST_ALIGN;
+        test_media.block_size = 4096;
+        test_media.last_block = TEST_N_BLOCKS * TEST_BLOCK_SIZE / 4096 - 1;
+        assert(c_efi_block_cache_invalidate(&cache) == C_EFI_UNSUPPORTED);
+        assert(c_efi_block_cache_read(&cache, 0, 100, buf) == C_EFI_MEDIA_CHANGED);
+        assert(!c_efi_block_cache_init(&cache, &test_bio, extents, 8, data, 8 * 4096, 4096));
+        test_check(&cache, 0, 100, buf);
+        test_check(&cache, 5000, 100, buf);
+
+        test_media.media_id = 1;
+        test_media.block_size = TEST_BLOCK_SIZE;
+        test_media.last_block = TEST_N_BLOCKS - 1;
+
+        free(data);
+}
+
+int main(int argc, char **argv) {
+        test_setup();
+        test_init();
+        test_sequential();
+        test_random();
+        test_errors();
+        test_disk_close();
+        free(test_disk);
+        return 0;
+}
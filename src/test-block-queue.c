@@ -0,0 +1,207 @@
+/*
+ * Tests for the Block I/O 2 Request Queue
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-block-queue.h"
+
+/*
+ * The device completes requests on a simulated clock, so completions arrive
+ * out of order, while the consumer waits or does simulated CPU work.
+ */
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_N_BLOCKS 8192
+#define TEST_ALIGN 16
+#define TEST_BLOCK_IO2
+#include "test-firmware.h"
+
+static CEfiBootServices test_bs = {
+        .create_event = test_create_event,
+        .wait_for_event = test_wait_for_event,
+        .signal_event = test_signal_event,
+        .close_event = test_close_event,
+};
+
+static void test_init(void) {
+        CEfiBlockQueueSlot slots[4];
+        CEfiBlockQueue q;
+
+        assert(!c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 4, 1000));
+        assert(q.chunk_size == 1024 && test_n_open == 5);
+        c_efi_block_queue_deinit(&q);
+        c_efi_block_queue_deinit(&q);
+        assert(test_n_open == 0);
+
+        test_media.io_align = 4096;
+        assert(!c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 4, 1000));
+        assert(q.chunk_size == 4096);
+        c_efi_block_queue_deinit(&q);
+        test_media.io_align = TEST_ALIGN;
+
+        assert(c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 0, 0) == C_EFI_INVALID_PARAMETER);
+
+        /* failing event creation releases everything */
+        test_create_limit = 3;
+        assert(c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 4, 0) == C_EFI_OUT_OF_RESOURCES);
+        assert(test_n_open == 0);
+        test_create_limit = TEST_N_EVENTS;
+}
+
+static void test_stream(void) {
+        static const CEfiBlockQueueExtent extents[] = {
+                { .lba = 100, .size = 37 * TEST_BLOCK_SIZE },
+                { .lba = 5000, .size = 0 },
+                { .lba = 4000, .size = 3 * TEST_BLOCK_SIZE },
+                { .lba = 0, .size = 100 * TEST_BLOCK_SIZE },
+                { .lba = TEST_N_BLOCKS - 9, .size = 9 * TEST_BLOCK_SIZE },
+        };
+        CEfiBlockQueueSlot slots[6];
+        CEfiU8 *buffer, *expected, *p;
+        CEfiUSize i, size = 0, total = 0;
+        void *data = NULL;
+        CEfiBlockQueue q;
+
+        buffer = aligned_alloc(TEST_ALIGN, 149 * TEST_BLOCK_SIZE);
+        expected = malloc(149 * TEST_BLOCK_SIZE);
+        assert(buffer && expected);
+        for (i = 0, p = expected; i < sizeof(extents) / sizeof(*extents); ++i) {
+                memcpy(p, test_disk + extents[i].lba * TEST_BLOCK_SIZE, extents[i].size);
+                p += extents[i].size;
+        }
+
+        /* chunks arrive in order, and the queue stays full */
+        test_max_requests = 0;
+        assert(!c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 6, 8 * TEST_BLOCK_SIZE));
+        assert(!c_efi_block_queue_start(&q, extents, sizeof(extents) / sizeof(*extents), buffer));
+        assert(q.n_pending == 6);
+        for (;;) {
+                CEfiStatus r = c_efi_block_queue_next(&q, &data, &size);
+
+                if (r == C_EFI_NOT_FOUND)
+                        break;
+                assert(!r);
+                assert((CEfiU8 *)data == buffer + total);
+                assert(size <= 8 * TEST_BLOCK_SIZE);
+                assert(!memcmp(data, expected + total, size));
+                total += size;
+                test_work(1000);
+        }
+        assert(total == 149 * TEST_BLOCK_SIZE);
+        assert(test_max_requests == 6);
+        assert(q.n_submitted == 5 + 1 + 13 + 2);
+        assert(c_efi_block_queue_next(&q, &data, &size) == C_EFI_NOT_FOUND);
+
+        /* the convenience reader */
+        memset(buffer, 0, 149 * TEST_BLOCK_SIZE);
+        assert(!c_efi_block_queue_read(&q, extents, sizeof(extents) / sizeof(*extents), buffer));
+        assert(!memcmp(buffer, expected, 149 * TEST_BLOCK_SIZE));
+        assert(!c_efi_block_queue_read(&q, extents, 0, buffer));
+
+        /* misaligned or partial-block extents are rejected */
+        assert(c_efi_block_queue_start(&q, extents, 1, buffer + 1) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_block_queue_start(&q, &(CEfiBlockQueueExtent){ .size = 100 }, 1, buffer) == C_EFI_INVALID_PARAMETER);
+
+        /* restarting drains the previous stream */
+        assert(!c_efi_block_queue_start(&q, extents, 1, buffer));
+        assert(!c_efi_block_queue_start(&q, extents + 3, 1, buffer));
+        assert(!c_efi_block_queue_next(&q, &data, &size));
+        assert(!memcmp(data, test_disk, size));
+
+        c_efi_block_queue_deinit(&q);
+        assert(test_n_open == 0 && test_n_requests == 0);
+        free(expected);
+        free(buffer);
+}
+
+/* total simulated time to stream and process @n chunks at @depth */
+static uint64_t test_pipeline(CEfiUSize depth, CEfiUSize n, uint64_t work) {
+        CEfiBlockQueueExtent extent = { .lba = 0, .size = n * 64 * TEST_BLOCK_SIZE };
+        CEfiBlockQueueSlot slots[16];
+        CEfiUSize size = 0;
+        void *data = NULL;
+        CEfiBlockQueue q;
+        CEfiU8 *buffer;
+        uint64_t start;
+
+        buffer = aligned_alloc(TEST_ALIGN, extent.size);
+        assert(buffer);
+        assert(!c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, depth, 64 * TEST_BLOCK_SIZE));
+
+        start = test_now;
+        assert(!c_efi_block_queue_start(&q, &extent, 1, buffer));
+        while (!c_efi_block_queue_next(&q, &data, &size))
+                test_work(work);
+        assert(!memcmp(buffer, test_disk, extent.size));
+
+        c_efi_block_queue_deinit(&q);
+        free(buffer);
+        return test_now - start;
+}
+
+static void test_overlap(void) {
+        uint64_t t1, t8, io = test_latency + 64 * TEST_BLOCK_SIZE;
+
+        /* a single slot is bound by the device latency of every chunk */
+        t1 = test_pipeline(1, 100, io / 4);
+        assert(t1 >= 100 * io);
+
+        /* a deep queue hides the latency, and is bound by the CPU work */
+        t8 = test_pipeline(8, 100, io / 4);
+        assert(t8 < 100 * io / 4 * 13 / 10 + 2 * io);
+        assert(t8 * 3 < t1);
+}
+
+static void test_errors(void) {
+        CEfiBlockQueueExtent extent = { .lba = 0, .size = 64 * TEST_BLOCK_SIZE };
+        CEfiBlockQueueSlot slots[4];
+        CEfiUSize size = 0;
+        void *data = NULL;
+        CEfiBlockQueue q;
+        CEfiU8 *buffer;
+
+        buffer = aligned_alloc(TEST_ALIGN, extent.size);
+        assert(buffer);
+        assert(!c_efi_block_queue_init(&q, &test_bs, &test_bio, slots, 4, 8 * TEST_BLOCK_SIZE));
+
+        /* a failed transaction ends the stream, with requests in flight */
+        test_error_lba = 16;
+        test_transaction_error = C_EFI_DEVICE_ERROR;
+        assert(!c_efi_block_queue_start(&q, &extent, 1, buffer));
+        assert(!c_efi_block_queue_next(&q, &data, &size));
+        assert(!c_efi_block_queue_next(&q, &data, &size));
+        assert(c_efi_block_queue_next(&q, &data, &size) == C_EFI_DEVICE_ERROR);
+        assert(c_efi_block_queue_next(&q, &data, &size) == C_EFI_DEVICE_ERROR);
+        assert(test_n_requests > 0);
+        test_error_lba = (CEfiLba)-1;
+
+        /* a failed submission as well */
+        test_submit_error = C_EFI_MEDIA_CHANGED;
+        assert(c_efi_block_queue_read(&q, &extent, 1, buffer) == C_EFI_MEDIA_CHANGED);
+        test_submit_error = 0;
+        assert(!c_efi_block_queue_read(&q, &extent, 1, buffer));
+
+        /* deinit waits for the device before closing the events */
+        assert(!c_efi_block_queue_start(&q, &extent, 1, buffer));
+        c_efi_block_queue_deinit(&q);
+        assert(test_n_open == 0 && test_n_requests == 0);
+        free(buffer);
+}
+
+int main(int argc, char **argv) {
+        size_t i;
+
+        srand(5);
+        for (i = 0; i < sizeof(test_disk); ++i)
+                test_disk[i] = rand();
+
+        test_init();
+        test_stream();
+        test_overlap();
+        test_errors();
+        return 0;
+}
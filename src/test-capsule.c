@@ -0,0 +1,160 @@
+/*
+ * Tests for the Capsule Scatter-Gather Builder
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-capsule.h"
+
+static CEfiUSize test_n_pages;
+static CEfiUSize test_fail_after = (CEfiUSize)-1;
+static CEfiU64 test_max_size = (CEfiU64)-1;
+static CEfiU8 test_gathered[4 * 4096];
+static CEfiUSize test_n_gathered;
+
+static CEfiStatus CEFICALL test_allocate_pages(CEfiAllocateType type,
+                                               CEfiMemoryType memory_type,
+                                               CEfiUSize pages,
+                                               CEfiPhysicalAddress *memory) {
+        void *p;
+
+        assert(type == C_EFI_ALLOCATE_ANY_PAGES);
+        assert(pages == 1);
+
+        if (!test_fail_after)
+                return C_EFI_OUT_OF_RESOURCES;
+        --test_fail_after;
+
+        p = aligned_alloc(4096, 4096);
+        assert(p);
+        memset(p, 0xaa, 4096);
+        ++test_n_pages;
+        *memory = (CEfiPhysicalAddress)(CEfiUSize)p;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        assert(pages == 1);
+        assert(test_n_pages > 0);
+        --test_n_pages;
+        free((void *)(CEfiUSize)memory);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_query_capsule_capabilities(CEfiCapsuleHeader **headers,
+                                                           CEfiUSize n_headers,
+                                                           CEfiU64 *maximum_capsule_size,
+                                                           CEfiResetType *reset_type) {
+        *maximum_capsule_size = test_max_size;
+        *reset_type = C_EFI_RESET_WARM;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_update_capsule(CEfiCapsuleHeader **headers,
+                                               CEfiUSize n_headers,
+                                               CEfiPhysicalAddress sg) {
+        CEfiCapsuleBlockDescriptor *d = (void *)(CEfiUSize)sg;
+
+        /* gather the payload by walking the descriptor chain */
+        test_n_gathered = 0;
+        for (;;) {
+                if (d->length) {
+                        assert(test_n_gathered + d->length <= sizeof(test_gathered));
+                        memcpy(test_gathered + test_n_gathered,
+                               (void *)(CEfiUSize)d->data_block,
+                               d->length);
+                        test_n_gathered += d->length;
+                        ++d;
+                } else if (d->continuation_pointer) {
+                        d = (void *)(CEfiUSize)d->continuation_pointer;
+                } else {
+                        break;
+                }
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static void test_builder(void) {
+        CEfiBootServices bs = {
+                .allocate_pages = test_allocate_pages,
+                .free_pages = test_free_pages,
+        };
+        CEfiRuntimeServices rs = {
+                .query_capsule_capabilities = test_query_capsule_capabilities,
+                .update_capsule = test_update_capsule,
+        };
+        CEfiSystemTable st = {
+                .boot_services = &bs,
+                .runtime_services = &rs,
+        };
+        CEfiCapsuleSegment segments[600];
+        CEfiCapsuleBuilder b;
+        CEfiCapsuleHeader *header;
+        CEfiResetType reset_type;
+        CEfiU8 *payload;
+        CEfiUSize i, size;
+
+        /* capsule spread over 600 segments, one of them empty */
+        size = 3 * 4096;
+        payload = malloc(size);
+        assert(payload);
+        for (i = 0; i < size; ++i)
+                payload[i] = i * 7;
+
+        header = (void *)payload;
+        *header = (CEfiCapsuleHeader){
+                .header_size = sizeof(*header),
+                .flags = C_EFI_CAPSULE_FLAGS_PERSIST_ACROSS_RESET,
+                .capsule_image_size = size,
+        };
+
+        segments[0] = (CEfiCapsuleSegment){ payload, 64 };
+        segments[1] = (CEfiCapsuleSegment){ payload + 64, 0 };
+        for (i = 2; i < 599; ++i)
+                segments[i] = (CEfiCapsuleSegment){ payload + 64 + (i - 2) * 20, 20 };
+        segments[599] = (CEfiCapsuleSegment){ payload + 64 + 597 * 20, size - 64 - 597 * 20 };
+
+        c_efi_capsule_builder_init(&b, &st);
+        assert(c_efi_capsule_builder_query(&b, &reset_type) == C_EFI_NOT_READY);
+
+        /* header mismatch is rejected */
+        assert(c_efi_capsule_builder_add(&b, segments, 598) == C_EFI_INVALID_PARAMETER);
+        segments[0].size = sizeof(*header) - 1;
+        assert(c_efi_capsule_builder_add(&b, segments, 600) == C_EFI_INVALID_PARAMETER);
+        segments[0].size = 64;
+
+        /* allocation failure leaves the builder untouched */
+        test_fail_after = 2;
+        assert(c_efi_capsule_builder_add(&b, segments, 600) == C_EFI_OUT_OF_RESOURCES);
+        assert(!b.head && !b.spare && !b.n_capsules);
+        assert(test_n_pages == 0);
+        test_fail_after = (CEfiUSize)-1;
+
+        /* 599 data blocks need 3 descriptor pages of 255 data entries */
+        assert(!c_efi_capsule_builder_add(&b, segments, 600));
+        assert(b.n_capsules == 1);
+        assert(b.n_pages == 3);
+        assert(test_n_pages == 3);
+
+        test_max_size = size - 1;
+        assert(c_efi_capsule_builder_submit(&b, &reset_type) == C_EFI_BAD_BUFFER_SIZE);
+        test_max_size = (CEfiU64)-1;
+
+        assert(!c_efi_capsule_builder_submit(&b, &reset_type));
+        assert(reset_type == C_EFI_RESET_WARM);
+        assert(test_n_gathered == size);
+        assert(!memcmp(test_gathered, payload, size));
+
+        c_efi_capsule_builder_deinit(&b);
+        assert(test_n_pages == 0);
+
+        free(payload);
+}
+
+int main(int argc, char **argv) {
+        test_builder();
+        return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Tests for the Calibrated Monotonic Clock
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdint.h>
+#include <time.h>
+#include "c-efi.h"
+#include "c-efi-clock.h"
+
+static uint64_t test_monotonic_ns(void) {
+        struct timespec ts;
+
+        assert(!clock_gettime(CLOCK_MONOTONIC, &ts));
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* busy-wait like firmware does, with the kernel clock as reference */
+static CEfiStatus CEFICALL test_stall(CEfiUSize microseconds) {
+        uint64_t end = test_monotonic_ns() + (uint64_t)microseconds * 1000;
+
+        while (test_monotonic_ns() < end)
+                ;
+
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices test_bs = {
+        .stall = test_stall,
+};
+
+static void test_scale(void) {
+        static const CEfiU64 freqs[] = {
+                1, 19200000, 24000000, 1000000000, 2899999999, 3000000000, 5400000000,
+        };
+        CEfiClock clock;
+        CEfiUSize i;
+        CEfiU64 f, ns, ticks;
+
+        for (i = 0; i < sizeof(freqs) / sizeof(*freqs); ++i) {
+                f = freqs[i];
+                c_efi_clock_init(&clock, f);
+
+                /* one second, and an hour, within the fixed-point error */
+                ns = c_efi_clock_ticks_to_ns(&clock, f);
+                assert(ns <= 1000000000 && ns >= 1000000000 - 2);
+                ns = c_efi_clock_ticks_to_ns(&clock, f * 3600);
+                assert(ns <= C_EFI_U64_C(3600000000000) && ns >= C_EFI_U64_C(3600000000000) - 3600);
+
+                ticks = c_efi_clock_ns_to_ticks(&clock, 1000000000);
+                assert(ticks <= f && ticks + 2 >= f);
+                ticks = c_efi_clock_ns_to_ticks(&clock, C_EFI_U64_C(3600000000000));
+                assert(ticks <= f * 3600 && ticks + 3600 >= f * 3600);
+        }
+
+        /* products beyond 64 bits must not wrap */
+        assert(c_efi_clock_scale(C_EFI_U64_C(0xffffffffffffffff), C_EFI_U64_C(1) << 32) ==
+               C_EFI_U64_C(0xffffffffffffffff));
+        assert(c_efi_clock_scale(C_EFI_U64_C(1) << 40, C_EFI_U64_C(3) << 30) == C_EFI_U64_C(3) << 38);
+
+        /* an unknown frequency reads 0 */
+        c_efi_clock_init(&clock, 0);
+        assert(c_efi_clock_ns(&clock) == 0);
+}
+
+static void test_calibrate(void) {
+        CEfiU64 f = 0, ns, hw;
+        CEfiClock clock;
+
+        if (!c_efi_clock_ticks())
+                return;
+
+        assert(!c_efi_clock_calibrate(&test_bs, 0, &f));
+        assert(f > 0);
+
+        /* the architectural frequency, if any, must match the measurement */
+        hw = c_efi_clock_frequency();
+        if (hw)
+                assert(f > hw - hw / 100 && f < hw + hw / 100);
+
+        c_efi_clock_init(&clock, f);
+        ns = c_efi_clock_ns(&clock);
+        test_stall(1000);
+        assert(c_efi_clock_ns(&clock) > ns);
+
+        /* an architectural frequency is used as is, anything else is measured */
+        assert(!c_efi_clock_setup(&clock, &test_bs));
+        assert(clock.ticks_per_second);
+        if (hw)
+                assert(clock.ticks_per_second == hw);
+}
+
+int main(int argc, char **argv) {
+        test_scale();
+        test_calibrate();
+        return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Tests for the Load Options Command-Line Parser
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-cmdline.h"
+
+static CEfiChar16 test_buf[256];
+static CEfiDevicePathProtocol test_path;
+
+/* store ASCII @s as UCS-2, return its size in bytes without terminator */
+static CEfiUSize test_set(const char *s) {
+        CEfiUSize i;
+
+        memset(test_buf, 0, sizeof(test_buf));
+        for (i = 0; s[i]; ++i)
+                test_buf[i] = (CEfiU8)s[i];
+        return i * sizeof(CEfiChar16);
+}
+
+static CEfiDevicePathProtocol *CEFICALL test_convert_text_to_device_path(CEfiChar16 *text) {
+        static const CEfiChar16 expected[] = { 'P', 'c', 'i', 'R', 'o', 'o', 't', '(', '0', ')', 0 };
+
+        return memcmp(text, expected, sizeof(expected)) ? C_EFI_NULL : &test_path;
+}
+
+static CEfiDevicePathFromTextProtocol test_from_text = {
+        .convert_text_to_device_path = test_convert_text_to_device_path,
+};
+
+static CEfiCmdlineArg test_arg(const char *s) {
+        CEfiCmdline cmdline;
+        CEfiCmdlineArg arg = { 0 };
+
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, test_set(s)));
+        assert(!c_efi_cmdline_next(&cmdline, &arg));
+        return arg;
+}
+
+static void test_split(void) {
+        static const char *const expected[] = {
+                "fs0:\\app.efi", "-v", "hello world", "", "a\"b", "x y", "^", "end",
+        };
+        CEfiCmdline cmdline;
+        CEfiCmdlineArg arg;
+        CEfiUSize i, size;
+
+        size = test_set("  fs0:\\app.efi\t-v \"hello world\" \"\" a^\"b x\" \"y ^^ end  ");
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, size));
+        for (i = 0; i < sizeof(expected) / sizeof(*expected); ++i) {
+                assert(!c_efi_cmdline_next(&cmdline, &arg));
+                assert(c_efi_cmdline_arg_equal(&arg, expected[i]));
+        }
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+
+        /* the NUL terminator and trailing padding are accepted */
+        size = test_set("a b");
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, size + 8));
+        assert(!c_efi_cmdline_next(&cmdline, &arg) && c_efi_cmdline_arg_equal(&arg, "a"));
+        assert(!c_efi_cmdline_next(&cmdline, &arg) && c_efi_cmdline_arg_equal(&arg, "b"));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+
+        /* unterminated quotes and escapes */
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, test_set("a \"b c")));
+        assert(!c_efi_cmdline_next(&cmdline, &arg));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, test_set("a^")));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_INVALID_PARAMETER);
+
+        /* on error, neither the buffer nor the iterator are modified */
+        size = test_set("a^^b\"c d");
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, size));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_INVALID_PARAMETER);
+        assert(cmdline.pos == test_buf);
+        assert(test_buf[1] == '^' && test_buf[2] == '^' && test_buf[3] == 'b' && test_buf[4] == '"');
+        size = test_set("a^\"b^");
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, size));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_INVALID_PARAMETER);
+        assert(test_buf[1] == '^' && test_buf[2] == '"' && test_buf[3] == 'b' && test_buf[4] == '^');
+
+        /* empty and absent load options */
+        assert(!c_efi_cmdline_init(&cmdline, C_EFI_NULL, 0));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, test_set("   ")));
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+}
+
+static void test_binary(void) {
+        CEfiCmdline cmdline;
+        CEfiCmdlineArg arg;
+        CEfiUSize size;
+
+        /* odd sizes, control characters, and data after the terminator */
+        size = test_set("abc");
+        assert(c_efi_cmdline_init(&cmdline, test_buf, size - 1) == C_EFI_UNSUPPORTED);
+        assert(c_efi_cmdline_init(&cmdline, (CEfiU8 *)test_buf + 1, size) == C_EFI_UNSUPPORTED);
+        test_buf[1] = 0x0001;
+        assert(c_efi_cmdline_init(&cmdline, test_buf, size) == C_EFI_UNSUPPORTED);
+        test_buf[1] = 0xffff;
+        assert(c_efi_cmdline_init(&cmdline, test_buf, size) == C_EFI_UNSUPPORTED);
+        test_buf[1] = 0;
+        assert(c_efi_cmdline_init(&cmdline, test_buf, size) == C_EFI_UNSUPPORTED);
+        assert(c_efi_cmdline_next(&cmdline, &arg) == C_EFI_NOT_FOUND);
+
+        /* non-ASCII text is fine */
+        test_set("x");
+        test_buf[0] = 0x00e4;
+        assert(!c_efi_cmdline_init(&cmdline, test_buf, 2));
+        assert(!c_efi_cmdline_next(&cmdline, &arg) && arg.n == 1 && arg.s[0] == 0x00e4);
+}
+
+static void test_accessors(void) {
+        CEfiCmdlineArg arg, value;
+        CEfiChar16 buf[11];
+        CEfiDevicePathProtocol *path;
+        CEfiGuid guid;
+        CEfiBool b = C_EFI_FALSE;
+        CEfiU64 u = 0;
+        CEfiI64 i = 0;
+
+        arg = test_arg("--timeout=0x1f");
+        assert(!c_efi_cmdline_arg_option(&arg, "--time", &value));
+        assert(c_efi_cmdline_arg_option(&arg, "--timeout", &value));
+        assert(!c_efi_cmdline_parse_u64(&value, &u) && u == 31);
+        arg = test_arg("--quiet");
+        assert(c_efi_cmdline_arg_option(&arg, "--quiet", &value) && !value.s);
+        arg = test_arg("--quiet=");
+        assert(c_efi_cmdline_arg_option(&arg, "--quiet", &value) && value.s && !value.n);
+
+        arg = test_arg("18446744073709551615");
+        assert(!c_efi_cmdline_parse_u64(&arg, &u) && u == C_EFI_U64_C(0xffffffffffffffff));
+        arg = test_arg("18446744073709551616");
+        assert(c_efi_cmdline_parse_u64(&arg, &u) == C_EFI_UNSUPPORTED);
+        arg = test_arg("12a");
+        assert(c_efi_cmdline_parse_u64(&arg, &u) == C_EFI_INVALID_PARAMETER);
+        arg = test_arg("0x");
+        assert(c_efi_cmdline_parse_u64(&arg, &u) == C_EFI_INVALID_PARAMETER);
+
+        arg = test_arg("-9223372036854775808");
+        assert(!c_efi_cmdline_parse_i64(&arg, &i) && i == -C_EFI_I64_C(0x7fffffffffffffff) - 1);
+        arg = test_arg("+9223372036854775808");
+        assert(c_efi_cmdline_parse_i64(&arg, &i) == C_EFI_UNSUPPORTED);
+        arg = test_arg("-0x10");
+        assert(!c_efi_cmdline_parse_i64(&arg, &i) && i == -16);
+        arg = test_arg("-");
+        assert(c_efi_cmdline_parse_i64(&arg, &i) == C_EFI_INVALID_PARAMETER);
+
+        arg = test_arg("64K");
+        assert(!c_efi_cmdline_parse_size(&arg, &u) && u == 65536);
+        arg = test_arg("2gb");
+        assert(!c_efi_cmdline_parse_size(&arg, &u) && u == C_EFI_U64_C(2) << 30);
+        arg = test_arg("0x1B");
+        assert(!c_efi_cmdline_parse_size(&arg, &u) && u == 27);
+        arg = test_arg("16777216T");
+        assert(c_efi_cmdline_parse_size(&arg, &u) == C_EFI_UNSUPPORTED);
+        arg = test_arg("1KK");
+        assert(c_efi_cmdline_parse_size(&arg, &u) == C_EFI_INVALID_PARAMETER);
+
+        arg = test_arg("YES");
+        assert(!c_efi_cmdline_parse_bool(&arg, &b) && b);
+        arg = test_arg("off");
+        assert(!c_efi_cmdline_parse_bool(&arg, &b) && !b);
+        arg = test_arg("of");
+        assert(c_efi_cmdline_parse_bool(&arg, &b) == C_EFI_INVALID_PARAMETER);
+
+        arg = test_arg("{05C99A21-C70F-4AD2-8a5f-35DF3343F51E}");
+        assert(!c_efi_cmdline_parse_guid(&arg, &guid));
+        assert(!memcmp(&guid, &C_EFI_DEVICE_PATH_FROM_TEXT_PROTOCOL_GUID, sizeof(guid)));
+        arg = test_arg("05c99a21-c70f-4ad2-8a5f-35df3343f51e");
+        assert(!c_efi_cmdline_parse_guid(&arg, &guid));
+        assert(!memcmp(&guid, &C_EFI_DEVICE_PATH_FROM_TEXT_PROTOCOL_GUID, sizeof(guid)));
+        arg = test_arg("05c99a21-c70f-4ad2-8a5f_35df3343f51e");
+        assert(c_efi_cmdline_parse_guid(&arg, &guid) == C_EFI_INVALID_PARAMETER);
+        arg = test_arg("05c99a21-c70f-4ad2-8a5f-35df3343f51g");
+        assert(c_efi_cmdline_parse_guid(&arg, &guid) == C_EFI_INVALID_PARAMETER);
+
+        arg = test_arg("PciRoot(0)");
+        assert(c_efi_cmdline_parse_device_path(&arg, &test_from_text, buf, 10, &path) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_cmdline_parse_device_path(&arg, &test_from_text, buf, 11, &path) && path == &test_path);
+        arg = test_arg("PciRoot(1)");
+        assert(c_efi_cmdline_parse_device_path(&arg, &test_from_text, buf, 11, &path) == C_EFI_INVALID_PARAMETER);
+}
+
+int main(int argc, char **argv) {
+        test_split();
+        test_binary();
+        test_accessors();
+        return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Tests for CRC32 Checksums
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-crc32.h"
+
+static CEfiU32 test_reference(CEfiU32 crc, const CEfiU8 *p, CEfiUSize n) {
+        CEfiUSize i, j;
+
+        crc = ~crc;
+        for (i = 0; i < n; ++i) {
+                crc ^= p[i];
+                for (j = 0; j < 8; ++j)
+                        crc = (crc >> 1) ^ (C_EFI_U32_C(0xedb88320) & -(crc & 1));
+        }
+
+        return ~crc;
+}
+
+static void test_crc32(void) {
+        static CEfiU8 buf[4096 + 16];
+        CEfiUSize i, off, n;
+        CEfiU32 crc;
+
+        for (i = 0; i < sizeof(buf); ++i)
+                buf[i] = (CEfiU8)(i * 7 + (i >> 8));
+
+        /* check value of the IEEE 802.3 polynomial */
+        assert(c_efi_crc32(0, "123456789", 9) == C_EFI_U32_C(0xcbf43926));
+        assert(c_efi_crc32(0, "", 0) == 0);
+
+        /* all kernels against the bitwise reference, at all alignments */
+        for (off = 0; off < 16; ++off)
+                for (n = 0; n <= 4096; n += (n < 300 ? 1 : 509))
+                        assert(c_efi_crc32(0, buf + off, n) == test_reference(0, buf + off, n));
+
+        /* incremental updates equal a single pass */
+        crc = 0;
+        for (i = 0; i < 4096; i += 97)
+                crc = c_efi_crc32(crc, buf + i, 4096 - i < 97 ? 4096 - i : 97);
+        assert(crc == c_efi_crc32(0, buf, 4096));
+}
+
+int main(int argc, char **argv) {
+        test_crc32();
+        return 0;
+}
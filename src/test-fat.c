@@ -0,0 +1,650 @@
+/*
+ * Tests for the Read-Only FAT File System
+ *
+ * mkfs.vfat is not available everywhere, so the tests format their own
+ * images, following the layout and cluster count thresholds of the FAT
+ * specification, and write them to a temporary file.
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-efi.h"
+#include "c-efi-fat.h"
+
+#define TEST_SECTOR 512
+#define TEST_BLOCK_SIZE TEST_SECTOR
+#define TEST_ALIGN 64
+#define TEST_N_ALLOCATIONS 8
+#define TEST_BLOCK_IO
+#include "test-firmware.h"
+
+typedef struct TestFs {
+        unsigned int type;
+        uint32_t per_cluster;
+        uint32_t n_sectors;
+        uint32_t n_reserved;
+        uint32_t fat_sectors;
+        uint32_t n_root;
+        uint32_t n_clusters;
+        uint32_t cluster_size;
+        uint64_t data_offset;
+        uint32_t next_free;
+} TestFs;
+
+typedef struct TestDir {
+        uint32_t cluster; /* 0 for the FAT12/16 root directory */
+        uint8_t entries[64 * 1024];
+        size_t n_entries;
+        unsigned int n_aliases;
+} TestDir;
+
+static uint8_t *test_disk;
+static size_t test_disk_size;
+static uint64_t test_volume; /* byte offset of the volume on the disk */
+static TestFs test_fs;
+
+static CEfiBootServices test_bs = {
+        .allocate_pages = test_allocate_pages,
+        .free_pages = test_free_pages,
+};
+
+static uint8_t *test_at(uint64_t offset) {
+        return test_disk + test_volume + offset;
+}
+
+static void test_put16(uint8_t *p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+}
+
+static void test_put32(uint8_t *p, uint32_t v) {
+        test_put16(p, v);
+        test_put16(p + 2, v >> 16);
+}
+
+static void test_set_fat(uint32_t cluster, uint32_t value) {
+        uint8_t *fat = test_at((uint64_t)test_fs.n_reserved * TEST_SECTOR);
+        uint8_t *p;
+
+        switch (test_fs.type) {
+        case 12:
+                p = fat + cluster + cluster / 2;
+                if (cluster & 1) {
+                        p[0] = (p[0] & 0x0f) | (value << 4);
+                        p[1] = value >> 4;
+                } else {
+                        p[0] = value;
+                        p[1] = (p[1] & 0xf0) | ((value >> 8) & 0x0f);
+                }
+                break;
+        case 16:
+                test_put16(fat + cluster * 2, value);
+                break;
+        default:
+                test_put32(fat + cluster * 4, value);
+                break;
+        }
+}
+
+static uint32_t test_get_fat(uint32_t cluster) {
+        CEfiFat fat = {
+                .type = test_fs.type,
+                .table = test_at((uint64_t)test_fs.n_reserved * TEST_SECTOR),
+        };
+
+        return c_efi_fat_next(&fat, cluster);
+}
+
+static uint32_t test_eoc(void) {
+        return test_fs.type == 12 ? 0xfff : test_fs.type == 16 ? 0xffff : 0x0fffffff;
+}
+
+static uint8_t *test_cluster(uint32_t cluster) {
+        return test_at(test_fs.data_offset + (uint64_t)(cluster - 2) * test_fs.cluster_size);
+}
+
+/*
+ * Allocate a chain of @n clusters, in runs of @run clusters separated by
+ * a gap of one free cluster. A @run of 0 allocates contiguously.
+ */
+static uint32_t test_alloc(uint32_t n, uint32_t run) {
+        uint32_t first = test_fs.next_free, c = first, i;
+
+        assert(n);
+        for (i = 0; i < n; ++i) {
+                assert(c - 2 < test_fs.n_clusters);
+                if (i + 1 == n) {
+                        test_set_fat(c, test_eoc());
+                        test_fs.next_free = c + 1;
+                } else if (run && (i + 1) % run == 0) {
+                        test_set_fat(c, c + 2);
+                        c += 2;
+                } else {
+                        test_set_fat(c, c + 1);
+                        c += 1;
+                }
+        }
+
+        return first;
+}
+
+static void test_write_chain(uint32_t cluster, const uint8_t *data, size_t size) {
+        size_t n;
+
+        while (size) {
+                n = size < test_fs.cluster_size ? size : test_fs.cluster_size;
+                memcpy(test_cluster(cluster), data, n);
+                data += n;
+                size -= n;
+                if (size)
+                        cluster = test_get_fat(cluster);
+        }
+}
+
+static void test_format(unsigned int type, uint32_t per_cluster, uint32_t n_sectors) {
+        uint32_t bits = type == 12 ? 12 : type == 16 ? 16 : 32, n_root = type == 32 ? 0 : 512;
+        uint8_t *b;
+
+        memset(test_disk + test_volume, 0, (uint64_t)n_sectors * TEST_SECTOR);
+        test_fs = (TestFs){
+                .type = type,
+                .per_cluster = per_cluster,
+                .n_sectors = n_sectors,
+                .n_reserved = type == 32 ? 32 : 1,
+                .n_root = n_root,
+                .cluster_size = per_cluster * TEST_SECTOR,
+                .next_free = 2,
+        };
+
+        /* size the FAT for the upper bound of clusters */
+        test_fs.fat_sectors = ((uint64_t)(n_sectors / per_cluster + 2) * bits / 8 + TEST_SECTOR - 1) / TEST_SECTOR;
+        test_fs.data_offset = ((uint64_t)test_fs.n_reserved + 2 * test_fs.fat_sectors + n_root * 32 / TEST_SECTOR) * TEST_SECTOR;
+        test_fs.n_clusters = (n_sectors - test_fs.data_offset / TEST_SECTOR) / per_cluster;
+        assert(type == (test_fs.n_clusters < 4085 ? 12u : test_fs.n_clusters < 65525 ? 16u : 32u));
+
+        b = test_at(0);
+        b[0] = 0xeb;
+        b[1] = 0x3c;
+        b[2] = 0x90;
+        memcpy(b + 3, "MSWIN4.1", 8);
+        test_put16(b + 11, TEST_SECTOR);
+        b[13] = per_cluster;
+        test_put16(b + 14, test_fs.n_reserved);
+        b[16] = 2;
+        test_put16(b + 17, n_root);
+        if (n_sectors < 0x10000)
+                test_put16(b + 19, n_sectors);
+        else
+                test_put32(b + 32, n_sectors);
+        b[21] = 0xf8;
+        if (type == 32) {
+                test_put32(b + 36, test_fs.fat_sectors);
+                test_put32(b + 44, 2);
+        } else {
+                test_put16(b + 22, test_fs.fat_sectors);
+        }
+        b[510] = 0x55;
+        b[511] = 0xaa;
+
+        test_set_fat(0, 0xfffff8 & test_eoc());
+        test_set_fat(1, test_eoc());
+        if (type == 32)
+                test_alloc(1, 0);
+}
+
+static uint8_t test_checksum(const uint8_t *short_name) {
+        uint8_t sum = 0;
+        size_t i;
+
+        for (i = 0; i < 11; ++i)
+                sum = ((sum & 1) << 7) + (sum >> 1) + short_name[i];
+
+        return sum;
+}
+
+static uint8_t *test_dir_slot(TestDir *dir) {
+        assert(dir->n_entries < sizeof(dir->entries) / 32);
+        return dir->entries + 32 * dir->n_entries++;
+}
+
+/*
+ * Add an entry for @name. Names that are valid upper-case 8.3 names get a
+ * short entry only, like most implementations do. Others get a long name,
+ * and a numbered alias, unless @nt_case is set, which sets the lower-case
+ * flags of Windows NT instead.
+ */
+static void test_dir_add(TestDir *dir, const char *name, uint8_t attributes, uint32_t cluster, uint32_t size, int nt_case) {
+        const char *dot = strrchr(name, '.');
+        size_t n = strlen(name), base, i, k, n_long;
+        uint8_t short_name[11], *d, sum;
+        int fits = 1;
+
+        memset(short_name, ' ', 11);
+        if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                memcpy(short_name, name, n);
+        } else {
+                if (!dot || dot == name)
+                        dot = name + n;
+                base = dot - name;
+                fits = base <= 8 && (!*dot || strlen(dot + 1) <= 3) && !strchr(name, ' ') && !memchr(name, '.', base);
+                for (i = 0; fits && i < n; ++i)
+                        if ((name[i] >= 'a' && name[i] <= 'z') && !nt_case)
+                                fits = 0;
+
+                if (fits) {
+                        for (i = 0; i < base; ++i)
+                                short_name[i] = name[i] >= 'a' && name[i] <= 'z' ? name[i] - 32 : name[i];
+                        for (i = 0; *dot && dot[1 + i]; ++i)
+                                short_name[8 + i] = dot[1 + i] >= 'a' && dot[1 + i] <= 'z' ? dot[1 + i] - 32 : dot[1 + i];
+                } else {
+                        for (i = 0, k = 0; k < 6 && i < base; ++i)
+                                if (name[i] != ' ' && name[i] != '.')
+                                        short_name[k++] = name[i] >= 'a' && name[i] <= 'z' ? name[i] - 32 : name[i];
+                        short_name[k++] = '~';
+                        short_name[k] = '1' + dir->n_aliases++;
+                        for (i = 0; *dot && i < 3 && dot[1 + i]; ++i)
+                                short_name[8 + i] = dot[1 + i] >= 'a' && dot[1 + i] <= 'z' ? dot[1 + i] - 32 : dot[1 + i];
+                }
+        }
+
+        if (!fits) {
+                sum = test_checksum(short_name);
+                n_long = (n + 12) / 13;
+                for (k = n_long; k >= 1; --k) {
+                        static const uint8_t offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+                        d = test_dir_slot(dir);
+                        d[0] = k | (k == n_long ? 0x40 : 0);
+                        d[11] = C_EFI_FAT_ATTRIBUTE_LONG_NAME;
+                        d[13] = sum;
+                        for (i = 0; i < 13; ++i) {
+                                size_t j = (k - 1) * 13 + i;
+
+                                test_put16(d + offsets[i], j < n ? (uint8_t)name[j] : j == n ? 0 : 0xffff);
+                        }
+                }
+        }
+
+        d = test_dir_slot(dir);
+        memcpy(d, short_name, 11);
+        d[11] = attributes;
+        if (nt_case)
+                d[12] = 0x18;
+        test_put16(d + 20, cluster >> 16);
+        test_put16(d + 26, cluster);
+        test_put32(d + 28, size);
+}
+
+/* store @dir in its chain, extended as needed, or the FAT12/16 root region */
+static void test_dir_write(TestDir *dir) {
+        size_t size = dir->n_entries * 32, i;
+        uint32_t c, next;
+
+        if (!dir->cluster) {
+                assert(size <= test_fs.n_root * 32);
+                memcpy(test_at(test_fs.data_offset - test_fs.n_root * 32), dir->entries, size);
+                return;
+        }
+
+        for (c = dir->cluster, i = test_fs.cluster_size; i < size; i += test_fs.cluster_size, c = next) {
+                next = test_get_fat(c);
+                if (next >= (test_eoc() & ~7u)) {
+                        next = test_alloc(1, 0);
+                        test_set_fat(c, next);
+                }
+        }
+
+        test_write_chain(dir->cluster, dir->entries, size);
+}
+
+static uint8_t *test_content(size_t size, unsigned int seed) {
+        uint8_t *p = malloc(size + 1);
+        size_t i;
+
+        assert(p);
+        for (i = 0; i < size; ++i)
+                p[i] = (uint8_t)((i * 2654435761u) >> 13) ^ seed;
+        return p;
+}
+
+static void test_sync(void) {
+        assert(pwrite(test_fd, test_disk, test_disk_size, 0) == (ssize_t)test_disk_size);
+        test_media.last_block = test_disk_size / test_media.block_size - 1;
+}
+
+typedef struct TestImage {
+        uint8_t *kernel;
+        uint32_t kernel_size;
+        uint8_t *efi;
+        uint32_t efi_size;
+        uint32_t efi_cluster;
+        uint8_t *config;
+        uint32_t config_size;
+} TestImage;
+
+#define TEST_LONG_NAME "a name that spans more than three long name entries.conf"
+#define TEST_EXACT_NAME "exactly26charactersname.ab"
+
+/*
+ * Build a volume with:
+ *   \EFI\BOOT\BOOTX64.EFI              fragmented, in runs of 3 clusters
+ *   \vmlinuz-linux                     contiguous
+ *   \loader\entries\Arch Linux.conf    long name with a space
+ *   \readme.txt                        lower-case 8.3 name via NT flags
+ *   \empty                             empty file
+ *   \<TEST_LONG_NAME>, \<TEST_EXACT_NAME>, \ORPHAN~5.TXT
+ * plus a volume label and a deleted entry in the root directory.
+ */
+static void test_build(TestImage *img, unsigned int type, uint32_t per_cluster, uint32_t n_sectors) {
+        static TestDir root, efi, boot, loader, entries;
+        uint32_t kernel, config, readme, long_file;
+
+        test_format(type, per_cluster, n_sectors);
+
+        /* allocate directories first, so growing them fragments their chains */
+        root = (TestDir){ .cluster = type == 32 ? 2 : 0 };
+        efi = (TestDir){ .cluster = test_alloc(1, 0) };
+        boot = (TestDir){ .cluster = test_alloc(1, 0) };
+        loader = (TestDir){ .cluster = test_alloc(1, 0) };
+        entries = (TestDir){ .cluster = test_alloc(1, 0) };
+
+        img->efi_size = 37 * test_fs.cluster_size + 1234;
+        img->efi = test_content(img->efi_size, 1);
+        img->efi_cluster = test_alloc((img->efi_size + test_fs.cluster_size - 1) / test_fs.cluster_size, 3);
+        test_write_chain(img->efi_cluster, img->efi, img->efi_size);
+
+        img->kernel_size = 300 * 1024 + 17;
+        img->kernel = test_content(img->kernel_size, 2);
+        kernel = test_alloc((img->kernel_size + test_fs.cluster_size - 1) / test_fs.cluster_size, 0);
+        test_write_chain(kernel, img->kernel, img->kernel_size);
+
+        img->config_size = 100;
+        img->config = test_content(img->config_size, 3);
+        config = test_alloc(1, 0);
+        test_write_chain(config, img->config, img->config_size);
+
+        readme = test_alloc(1, 0);
+        memcpy(test_cluster(readme), "hello", 5);
+        long_file = test_alloc(1, 0);
+        memcpy(test_cluster(long_file), "long", 4);
+
+        test_dir_add(&root, "ESP", C_EFI_FAT_ATTRIBUTE_VOLUME_ID, 0, 0, 0);
+        test_dir_add(&root, "EFI", C_EFI_FAT_ATTRIBUTE_DIRECTORY, efi.cluster, 0, 0);
+        test_dir_add(&root, "GONE.TXT", 0, 0, 0, 0);
+        root.entries[32 * (root.n_entries - 1)] = 0xe5;
+        test_dir_add(&root, "vmlinuz-linux", C_EFI_FAT_ATTRIBUTE_ARCHIVE, kernel, img->kernel_size, 0);
+        test_dir_add(&root, "loader", C_EFI_FAT_ATTRIBUTE_DIRECTORY, loader.cluster, 0, 0);
+        test_dir_add(&root, "readme.txt", C_EFI_FAT_ATTRIBUTE_ARCHIVE, readme, 5, 1);
+        test_dir_add(&root, "EMPTY", C_EFI_FAT_ATTRIBUTE_ARCHIVE, 0, 0, 0);
+        test_dir_add(&root, TEST_LONG_NAME, 0, long_file, 4, 0);
+        test_dir_add(&root, TEST_EXACT_NAME, 0, long_file, 4, 0);
+
+        /* a long name with a bad checksum falls back to the alias */
+        test_dir_add(&root, "orphan name.txt", 0, long_file, 4, 0);
+        root.entries[32 * (root.n_entries - 3) + 13] ^= 1;
+
+        /* make FAT32 roots span several clusters, with the last entry in a later one */
+        if (type == 32) {
+                while (root.n_entries < 2 * test_fs.cluster_size / 32) {
+                        test_dir_add(&root, "PAD", 0, 0, 0, 0);
+                        root.entries[32 * (root.n_entries - 1)] = 0xe5;
+                }
+                test_dir_add(&root, "LAST", 0, readme, 5, 0);
+        }
+        test_dir_write(&root);
+
+        test_dir_add(&efi, ".", C_EFI_FAT_ATTRIBUTE_DIRECTORY, efi.cluster, 0, 0);
+        test_dir_add(&efi, "..", C_EFI_FAT_ATTRIBUTE_DIRECTORY, 0, 0, 0);
+        test_dir_add(&efi, "BOOT", C_EFI_FAT_ATTRIBUTE_DIRECTORY, boot.cluster, 0, 0);
+        test_dir_write(&efi);
+
+        test_dir_add(&boot, ".", C_EFI_FAT_ATTRIBUTE_DIRECTORY, boot.cluster, 0, 0);
+        test_dir_add(&boot, "..", C_EFI_FAT_ATTRIBUTE_DIRECTORY, efi.cluster, 0, 0);
+        test_dir_add(&boot, "BOOTX64.EFI", C_EFI_FAT_ATTRIBUTE_ARCHIVE, img->efi_cluster, img->efi_size, 0);
+        test_dir_write(&boot);
+
+        test_dir_add(&loader, ".", C_EFI_FAT_ATTRIBUTE_DIRECTORY, loader.cluster, 0, 0);
+        test_dir_add(&loader, "..", C_EFI_FAT_ATTRIBUTE_DIRECTORY, 0, 0, 0);
+        test_dir_add(&loader, "entries", C_EFI_FAT_ATTRIBUTE_DIRECTORY, entries.cluster, 0, 0);
+        test_dir_write(&loader);
+
+        test_dir_add(&entries, ".", C_EFI_FAT_ATTRIBUTE_DIRECTORY, entries.cluster, 0, 0);
+        test_dir_add(&entries, "..", C_EFI_FAT_ATTRIBUTE_DIRECTORY, loader.cluster, 0, 0);
+        test_dir_add(&entries, "Arch Linux.conf", C_EFI_FAT_ATTRIBUTE_ARCHIVE, config, img->config_size, 0);
+        test_dir_write(&entries);
+
+        memcpy(test_at((uint64_t)(test_fs.n_reserved + test_fs.fat_sectors) * TEST_SECTOR),
+               test_at((uint64_t)test_fs.n_reserved * TEST_SECTOR),
+               (size_t)test_fs.fat_sectors * TEST_SECTOR);
+        test_sync();
+}
+
+static void test_image_free(TestImage *img) {
+        free(img->efi);
+        free(img->kernel);
+        free(img->config);
+}
+
+static int test_name(const CEfiChar16 *name, const char *s) {
+        while (*s && *name == (uint8_t)*s)
+                ++name, ++s;
+        return !*s && !*name;
+}
+
+static const CEfiChar16 *test_u(const char *s) {
+        static CEfiChar16 buf[4][256];
+        static unsigned int k;
+        CEfiChar16 *p = buf[k++ % 4];
+        size_t i;
+
+        for (i = 0; s[i]; ++i)
+                p[i] = (uint8_t)s[i];
+        p[i] = 0;
+        return p;
+}
+
+static void test_read_all(CEfiFat *fat, const char *path, const uint8_t *content, size_t size) {
+        CEfiFatFile file;
+        CEfiUSize n;
+        uint8_t *buf;
+
+        buf = aligned_alloc(4096, (size + 4096) / 4096 * 4096);
+        assert(buf);
+        assert(!c_efi_fat_open(fat, C_EFI_NULL, test_u(path), &file));
+        assert(file.size == size);
+        buf[size] = 0xaa;
+        assert(!c_efi_fat_read(fat, &file, buf, size + 1, &n));
+        assert(n == size && buf[size] == 0xaa);
+        assert(!memcmp(buf, content, size));
+        assert(!c_efi_fat_read(fat, &file, buf, 1, &n) && !n);
+        free(buf);
+}
+
+static void test_volume_type(unsigned int type, uint32_t per_cluster, uint32_t n_sectors) {
+        CEfiFatFile file, dir, root;
+        CEfiFatEntry entry;
+        TestImage img;
+        CEfiFat fat;
+        CEfiUSize n, i, pos, direct;
+        uint64_t hits;
+        uint8_t *buf;
+
+        test_build(&img, type, per_cluster, n_sectors);
+
+        test_n_reads = 0;
+        assert(!c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, n_sectors));
+        assert(test_n_reads == 2);
+        assert(fat.type == type);
+        assert(fat.n_clusters == test_fs.n_clusters);
+        assert(fat.cluster_size == test_fs.cluster_size);
+
+        /* whole-file reads issue one call per run of contiguous clusters */
+        test_n_reads = 0;
+        test_read_all(&fat, "\\vmlinuz-linux", img.kernel, img.kernel_size);
+        assert(test_n_reads == 1 + 1 + 1); /* root directory, whole blocks, tail */
+
+        /* the whole blocks touch a number of clusters, in runs of 3 */
+        direct = (img.efi_size / TEST_SECTOR * TEST_SECTOR + test_fs.cluster_size - 1) / test_fs.cluster_size;
+        test_n_reads = 0;
+        test_read_all(&fat, "\\EFI\\BOOT\\BOOTX64.EFI", img.efi, img.efi_size);
+        assert(test_n_reads == 3 + (direct + 2) / 3 + 1);
+
+        test_read_all(&fat, "loader/entries/arch linux.CONF", img.config, img.config_size);
+        test_read_all(&fat, "/readme.txt", (const uint8_t *)"hello", 5);
+        test_read_all(&fat, "README.TXT", (const uint8_t *)"hello", 5);
+        test_read_all(&fat, "empty", (const uint8_t *)"", 0);
+        test_read_all(&fat, TEST_LONG_NAME, (const uint8_t *)"long", 4);
+        test_read_all(&fat, TEST_EXACT_NAME, (const uint8_t *)"long", 4);
+
+        /* repeated lookups are served from the cache, without any I/O */
+        hits = fat.n_lookup_hits;
+        test_n_reads = 0;
+        assert(!c_efi_fat_open(&fat, C_EFI_NULL, test_u("\\EFI\\BOOT\\BOOTX64.EFI"), &file));
+        assert(!test_n_reads && fat.n_lookup_hits == hits + 3);
+        assert(file.size == img.efi_size && !file.position);
+
+        /* relative paths, "." and ".." */
+        assert(!c_efi_fat_open(&fat, C_EFI_NULL, test_u("EFI"), &dir));
+        assert(dir.attributes & C_EFI_FAT_ATTRIBUTE_DIRECTORY);
+        assert(!c_efi_fat_open(&fat, &dir, test_u("./BOOT//bootx64.efi"), &file));
+        assert(file.size == img.efi_size);
+        assert(!c_efi_fat_open(&fat, &dir, test_u("BOOT/../../loader/./entries/Arch Linux.conf"), &file));
+        assert(file.size == img.config_size);
+        assert(!c_efi_fat_open(&fat, &dir, test_u("\\readme.txt"), &file));
+        assert(file.size == 5);
+
+        /* missing entries, and files used as directories */
+        assert(c_efi_fat_open(&fat, C_EFI_NULL, test_u("EFI\\BOOT\\BOOTIA32.EFI"), &file) == C_EFI_NOT_FOUND);
+        assert(c_efi_fat_open(&fat, C_EFI_NULL, test_u("readme.txt\\x"), &file) == C_EFI_NOT_FOUND);
+        assert(c_efi_fat_open(&fat, C_EFI_NULL, test_u("GONE.TXT"), &file) == C_EFI_NOT_FOUND);
+        assert(c_efi_fat_open(&fat, C_EFI_NULL, test_u("ESP"), &file) == C_EFI_NOT_FOUND);
+        assert(c_efi_fat_open(&fat, C_EFI_NULL, test_u(".."), &file) == C_EFI_NOT_FOUND);
+
+        /* small, unaligned reads through the window */
+        buf = malloc(img.efi_size + 1);
+        assert(buf);
+        assert(!c_efi_fat_open(&fat, C_EFI_NULL, test_u("EFI/BOOT/BOOTX64.EFI"), &file));
+        for (i = 0; i < img.efi_size; i += n) {
+                assert(!c_efi_fat_read(&fat, &file, buf + 1 + i % 7, 777, &n));
+                assert(n == (img.efi_size - i < 777 ? img.efi_size - i : 777));
+                assert(!memcmp(buf + 1 + i % 7, img.efi + i, n));
+        }
+
+        /* seeking back and forth */
+        for (i = 0; i < 64; ++i) {
+                pos = (i * 7919 * 97) % img.efi_size;
+                file.position = pos;
+                assert(!c_efi_fat_read(&fat, &file, buf, 3000, &n));
+                assert(n == (img.efi_size - pos < 3000 ? img.efi_size - pos : 3000));
+                assert(!memcmp(buf, img.efi + pos, n));
+        }
+        file.position = img.efi_size + 5;
+        assert(!c_efi_fat_read(&fat, &file, buf, 1, &n) && !n);
+        free(buf);
+
+        /* listing the root directory */
+        assert(!c_efi_fat_root(&fat, &root));
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "EFI"));
+        assert(entry.attributes == C_EFI_FAT_ATTRIBUTE_DIRECTORY);
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "vmlinuz-linux"));
+        assert(entry.size == img.kernel_size);
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "loader"));
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "readme.txt"));
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "EMPTY"));
+        assert(!entry.cluster && !entry.size);
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, TEST_LONG_NAME));
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, TEST_EXACT_NAME));
+        assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "ORPHAN~5.TXT"));
+        if (type == 32)
+                assert(!c_efi_fat_readdir(&fat, &root, &entry) && test_name(entry.name, "LAST"));
+        assert(c_efi_fat_readdir(&fat, &root, &entry) == C_EFI_NOT_FOUND);
+        assert(c_efi_fat_readdir(&fat, &root, &entry) == C_EFI_NOT_FOUND);
+
+        assert(!c_efi_fat_open(&fat, C_EFI_NULL, test_u("EFI/BOOT"), &dir));
+        assert(!c_efi_fat_readdir(&fat, &dir, &entry) && test_name(entry.name, "."));
+        assert(!c_efi_fat_readdir(&fat, &dir, &entry) && test_name(entry.name, ".."));
+        assert(!c_efi_fat_readdir(&fat, &dir, &entry) && test_name(entry.name, "BOOTX64.EFI"));
+        assert(entry.cluster == img.efi_cluster);
+        assert(c_efi_fat_readdir(&fat, &dir, &entry) == C_EFI_NOT_FOUND);
+
+        /* a chain shorter than its file */
+        test_set_fat(img.efi_cluster + 1, test_eoc());
+        test_sync();
+        c_efi_fat_deinit(&fat);
+        assert(!test_n_allocations);
+        assert(!c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 0));
+        buf = aligned_alloc(4096, (img.efi_size + 4096) / 4096 * 4096);
+        assert(buf);
+        assert(!c_efi_fat_open(&fat, C_EFI_NULL, test_u("EFI/BOOT/BOOTX64.EFI"), &file));
+        assert(c_efi_fat_read(&fat, &file, buf, img.efi_size, &n) == C_EFI_VOLUME_CORRUPTED);
+        assert(n == 2 * test_fs.cluster_size);
+        free(buf);
+
+        c_efi_fat_deinit(&fat);
+        assert(!test_n_allocations);
+        test_image_free(&img);
+}
+
+static void test_init(void) {
+        TestImage img;
+        CEfiFat fat;
+        uint8_t *b = test_at(0);
+
+        test_build(&img, 16, 4, 40000);
+
+        /* not a FAT volume */
+        b[510] = 0;
+        test_sync();
+        assert(c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 0) == C_EFI_NOT_FOUND);
+        assert(!test_n_allocations);
+        b[510] = 0x55;
+
+        /* invalid geometry */
+        b[13] = 3;
+        test_sync();
+        assert(c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 0) == C_EFI_VOLUME_CORRUPTED);
+        b[13] = 4;
+
+        /* a volume larger than its partition */
+        test_sync();
+        assert(c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 39999) == C_EFI_VOLUME_CORRUPTED);
+        assert(!c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 40000));
+        c_efi_fat_deinit(&fat);
+
+        /* sectors smaller than blocks */
+        test_media.block_size = 4096;
+        test_sync();
+        assert(c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / 4096, 0) == C_EFI_UNSUPPORTED);
+        test_media.block_size = TEST_SECTOR;
+        test_sync();
+
+        test_media.media_present = 0;
+        assert(c_efi_fat_init(&fat, &test_bs, &test_bio, test_volume / TEST_SECTOR, 0) == C_EFI_NO_MEDIA);
+        test_media.media_present = 1;
+
+        assert(!test_n_allocations);
+        test_image_free(&img);
+}
+
+int main(int argc, char **argv) {
+        test_disk_open();
+
+        /* volumes start at a partition offset, and end before the disk does */
+        test_volume = 1024 * 1024;
+        test_disk_size = test_volume + 40 * 1024 * 1024;
+        test_disk = calloc(1, test_disk_size);
+        assert(test_disk);
+
+        test_init();
+        test_volume_type(12, 4, 4000);
+        test_volume_type(16, 4, 40000);
+        test_volume_type(32, 1, 70000);
+
+        free(test_disk);
+        test_disk_close();
+        return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Tests for the Framebuffer Text Console
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-fbcon.h"
+
+#define TEST_WIDTH 68   /* not a multiple of the glyph width */
+#define TEST_HEIGHT 36
+#define TEST_STRIDE 72
+
+static CEfiU32 test_screen[TEST_STRIDE * TEST_HEIGHT];
+static unsigned int test_n_blt;
+
+static CEfiStatus CEFICALL test_blt(CEfiGraphicsOutputProtocol *this_,
+                                    CEfiGraphicsOutputBltPixel *blt_buffer,
+                                    CEfiGraphicsOutputBltOperation blt_operation,
+                                    CEfiUSize source_x,
+                                    CEfiUSize source_y,
+                                    CEfiUSize destination_x,
+                                    CEfiUSize destination_y,
+                                    CEfiUSize width,
+                                    CEfiUSize height,
+                                    CEfiUSize delta) {
+        CEfiU32 *buf = (CEfiU32 *)blt_buffer;
+        CEfiUSize x, y, stride = (delta ? delta : width * 4) / 4;
+
+        ++test_n_blt;
+        assert(destination_x + width <= TEST_WIDTH && destination_y + height <= TEST_HEIGHT);
+
+        switch (blt_operation) {
+        case C_EFI_BLT_VIDEO_FILL:
+                for (y = 0; y < height; ++y)
+                        for (x = 0; x < width; ++x)
+                                test_screen[(destination_y + y) * TEST_STRIDE + destination_x + x] = *buf;
+                break;
+        case C_EFI_BLT_VIDEO_TO_BLT_BUFFER:
+                for (y = 0; y < height; ++y)
+                        for (x = 0; x < width; ++x)
+                                buf[(destination_y + y) * stride + destination_x + x] =
+                                        test_screen[(source_y + y) * TEST_STRIDE + source_x + x];
+                break;
+        case C_EFI_BLT_BUFFER_TO_VIDEO:
+                for (y = 0; y < height; ++y)
+                        for (x = 0; x < width; ++x)
+                                test_screen[(destination_y + y) * TEST_STRIDE + destination_x + x] =
+                                        buf[(source_y + y) * stride + source_x + x];
+                break;
+        case C_EFI_BLT_VIDEO_TO_VIDEO:
+                assert(destination_y <= source_y);
+                for (y = 0; y < height; ++y)
+                        memmove(&test_screen[(destination_y + y) * TEST_STRIDE + destination_x],
+                                &test_screen[(source_y + y) * TEST_STRIDE + source_x],
+                                width * 4);
+                break;
+        default:
+                assert(0);
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static CEfiGraphicsOutputModeInformation test_info = {
+        .horizontal_resolution = TEST_WIDTH,
+        .vertical_resolution = TEST_HEIGHT,
+        .pixel_format = C_EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR,
+        .pixels_per_scan_line = TEST_STRIDE,
+};
+
+static CEfiGraphicsOutputProtocolMode test_mode = {
+        .info = &test_info,
+        .size_of_info = sizeof(test_info),
+};
+
+static CEfiGraphicsOutputProtocol test_gop = {
+        .blt = test_blt,
+        .mode = &test_mode,
+};
+
+/* check that the text cell at @column/@row shows @c */
+static void test_cell(const CEfiU32 *fb, CEfiUSize stride, CEfiU32 scale,
+                      CEfiU32 column, CEfiU32 row, char c, CEfiU32 fg, CEfiU32 bg) {
+        const CEfiU8 *glyph = &c_efi_fbcon_font[(c - 0x20) * 8];
+        CEfiUSize x, y, px, py;
+
+        for (y = 0; y < 8 * scale; ++y) {
+                for (x = 0; x < 8 * scale; ++x) {
+                        px = column * 8 * scale + x;
+                        py = row * 8 * scale + y;
+                        assert(fb[py * stride + px] == (((glyph[y / scale] << (x / scale)) & 0x80) ? fg : bg));
+                }
+        }
+}
+
+static void test_sequence(CEfiFbcon *fbcon) {
+        static const CEfiChar8 lines[] = "0\n1\n2\tx\n3\n456789ab";
+        static const CEfiChar16 wide[] = { 'c', 0x00e4, 'd' };
+
+        assert(!c_efi_fbcon_write8(fbcon, lines, sizeof(lines) - 1));
+        c_efi_fbcon_set_attribute(fbcon, C_EFI_YELLOW | C_EFI_BACKGROUND_BLUE);
+        assert(!c_efi_fbcon_write(fbcon, wide, 3));
+        assert(!c_efi_fbcon_set_cursor(fbcon, 1, 0));
+        assert(!c_efi_fbcon_write8(fbcon, (const CEfiChar8 *)"\xc3\xa4\b\bZ", 5));
+        assert(c_efi_fbcon_set_cursor(fbcon, 8, 0) == C_EFI_INVALID_PARAMETER);
+}
+
+static void test_linear(void) {
+        CEfiU32 *fb, white, blue, yellow, gray;
+        CEfiFbcon fbcon;
+        CEfiUSize i;
+
+        fb = malloc(sizeof(test_screen));
+        assert(fb);
+        for (i = 0; i < TEST_STRIDE * TEST_HEIGHT; ++i)
+                fb[i] = 0xdeadbeef;
+
+        test_info.pixel_format = C_EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR;
+        test_mode.frame_buffer_base = (CEfiUSize)fb;
+        assert(c_efi_fbcon_shadow_size(&test_info, 0) == 0);
+        assert(!c_efi_fbcon_init(&fbcon, &test_gop, C_EFI_NULL, 0, 1));
+        assert(fbcon.columns == 8 && fbcon.rows == 4);
+
+        /* the padding of each scan line is never touched */
+        for (i = 0; i < TEST_HEIGHT; ++i)
+                assert(fb[i * TEST_STRIDE + TEST_WIDTH] == 0xdeadbeef && fb[i * TEST_STRIDE + TEST_WIDTH - 1] == 0);
+
+        /*
+         * The tab wraps "x" to its own row, every following line scrolls,
+         * and "c" wraps after the full row, scrolling in a row of the new
+         * background color. Then the top row is overwritten.
+         */
+        gray = 0xaaaaaa;
+        blue = 0x0000aa;
+        yellow = 0xffff55;
+        test_sequence(&fbcon);
+        test_cell(fb, TEST_STRIDE, 1, 0, 0, 'Z', yellow, blue);
+        test_cell(fb, TEST_STRIDE, 1, 1, 0, '?', yellow, blue);
+        test_cell(fb, TEST_STRIDE, 1, 2, 0, ' ', gray, 0);
+        test_cell(fb, TEST_STRIDE, 1, 0, 1, '3', gray, 0);
+        test_cell(fb, TEST_STRIDE, 1, 0, 2, '4', gray, 0);
+        test_cell(fb, TEST_STRIDE, 1, 7, 2, 'b', gray, 0);
+        test_cell(fb, TEST_STRIDE, 1, 0, 3, 'c', yellow, blue);
+        test_cell(fb, TEST_STRIDE, 1, 1, 3, '?', yellow, blue);
+        test_cell(fb, TEST_STRIDE, 1, 2, 3, 'd', yellow, blue);
+        test_cell(fb, TEST_STRIDE, 1, 3, 3, ' ', yellow, blue);
+        assert(fbcon.column == 1 && fbcon.row == 0);
+
+        /* bit masks, and scaled glyphs */
+        test_info.pixel_format = C_EFI_PIXEL_BIT_MASK;
+        test_info.pixel_information = (CEfiPixelBitmask){ .red_mask = 0xf800, .green_mask = 0x07e0, .blue_mask = 0x001f };
+        assert(!c_efi_fbcon_init(&fbcon, &test_gop, C_EFI_NULL, 0, 2));
+        assert(fbcon.columns == 4 && fbcon.rows == 2);
+        c_efi_fbcon_set_attribute(&fbcon, C_EFI_WHITE | C_EFI_BACKGROUND_RED);
+        white = 0xffff;
+        assert(!c_efi_fbcon_write8(&fbcon, (const CEfiChar8 *)"W", 1));
+        test_cell(fb, TEST_STRIDE, 2, 0, 0, 'W', white, 0xa800);
+
+        test_info.pixel_information.green_mask = 0x07a0;
+        assert(c_efi_fbcon_init(&fbcon, &test_gop, C_EFI_NULL, 0, 1) == C_EFI_UNSUPPORTED);
+        test_info.pixel_information.green_mask = 0x07e0;
+        assert(c_efi_fbcon_init(&fbcon, &test_gop, C_EFI_NULL, 0, 5) == C_EFI_INVALID_PARAMETER);
+
+        free(fb);
+}
+
+static void test_blt_mode(void) {
+        CEfiU32 *fb, shadow[TEST_WIDTH * 8];
+        CEfiFbcon fbcon;
+        CEfiUSize i;
+
+        /* reference picture via a linear framebuffer without padding */
+        fb = calloc(1, sizeof(test_screen));
+        assert(fb);
+        test_info.pixel_format = C_EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR;
+        test_mode.frame_buffer_base = (CEfiUSize)fb;
+        assert(!c_efi_fbcon_init(&fbcon, &test_gop, C_EFI_NULL, 0, 1));
+        test_sequence(&fbcon);
+
+        test_info.pixel_format = C_EFI_PIXEL_BLT_ONLY;
+        test_mode.frame_buffer_base = 0;
+        for (i = 0; i < TEST_STRIDE * TEST_HEIGHT; ++i)
+                test_screen[i] = 0xdeadbeef;
+
+        assert(c_efi_fbcon_shadow_size(&test_info, 1) == TEST_WIDTH * 8);
+        assert(c_efi_fbcon_init(&fbcon, &test_gop, shadow, TEST_WIDTH * 8 - 1, 1) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_fbcon_init(&fbcon, &test_gop, shadow, TEST_WIDTH * 8, 1));
+
+        /* a whole row of text is sent with one blt */
+        test_n_blt = 0;
+        assert(!c_efi_fbcon_write8(&fbcon, (const CEfiChar8 *)"abcdefg", 7));
+        assert(test_n_blt == 1);
+        assert(!c_efi_fbcon_clear(&fbcon));
+
+        test_sequence(&fbcon);
+        for (i = 0; i < TEST_HEIGHT; ++i)
+                assert(!memcmp(&test_screen[i * TEST_STRIDE], &fb[i * TEST_STRIDE], TEST_WIDTH * 4));
+
+        free(fb);
+}
+
+int main(int argc, char **argv) {
+        test_linear();
+        test_blt_mode();
+        return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Tests for the Buffered File Reader
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-file-reader.h"
+
+#define TEST_SIZE (10 * 1024 * 1024 + 123)
+#define TEST_CHUNK (1024 * 1024)
+#define TEST_N_ALLOCATIONS 16
+#include "test-firmware.h"
+
+static size_t test_n_pools;
+static CEfiU8 *test_data;
+static CEfiU64 test_position, test_size = TEST_SIZE, test_missing;
+static CEfiUSize test_name_length = 8, test_max_read;
+static unsigned int test_n_reads;
+static CEfiBool test_no_info;
+static CEfiBool test_zero_copy;
+
+static CEfiStatus CEFICALL test_allocate_pool(CEfiMemoryType pool_type, CEfiUSize size, void **buffer) {
+        *buffer = malloc(size);
+        assert(*buffer);
+        ++test_n_pools;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_free_pool(void *buffer) {
+        free(buffer);
+        --test_n_pools;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices test_bs = {
+        .allocate_pages = test_allocate_pages,
+        .free_pages = test_free_pages,
+        .allocate_pool = test_allocate_pool,
+        .free_pool = test_free_pool,
+};
+
+static CEfiStatus CEFICALL test_read(CEfiFileProtocol *this_, CEfiUSize *buffer_size, void *buffer) {
+        CEfiUSize n = *buffer_size;
+
+        ++test_n_reads;
+        /* reads must go straight into the latest allocation */
+        if (test_zero_copy)
+                assert((uintptr_t)buffer >= test_allocations[test_n_allocations - 1].address &&
+                       (uintptr_t)buffer + n <= test_allocations[test_n_allocations - 1].address +
+                                                test_allocations[test_n_allocations - 1].pages * 4096);
+
+        if (test_max_read && n > test_max_read)
+                n = test_max_read;
+        if (n > test_size - test_position)
+                n = test_size - test_position;
+
+        memcpy(buffer, test_data + test_position, n);
+        test_position += n;
+        *buffer_size = n;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_get_position(CEfiFileProtocol *this_, CEfiU64 *position) {
+        *position = test_position;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_get_info(CEfiFileProtocol *this_,
+                                         CEfiGuid *information_type,
+                                         CEfiUSize *buffer_size,
+                                         void *buffer) {
+        CEfiUSize size = sizeof(CEfiFileInfo) + (test_name_length + 1) * sizeof(CEfiChar16);
+        CEfiFileInfo *info = buffer;
+
+        assert(!memcmp(information_type, &C_EFI_FILE_INFO_ID, sizeof(CEfiGuid)));
+        if (test_no_info)
+                return C_EFI_UNSUPPORTED;
+        if (*buffer_size < size) {
+                *buffer_size = size;
+                return C_EFI_BUFFER_TOO_SMALL;
+        }
+
+        memset(info, 0, size);
+        info->size = size;
+        info->file_size = test_size + test_missing;
+        info->physical_size = (info->file_size + 511) & ~(CEfiU64)511;
+        *buffer_size = size;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiFileProtocol test_file = {
+        .revision = C_EFI_FILE_PROTOCOL_REVISION,
+        .read = test_read,
+        .get_position = test_get_position,
+        .get_info = test_get_info,
+};
+
+static void test_reset(void) {
+        test_position = 0;
+        test_n_reads = 0;
+        test_zero_copy = C_EFI_FALSE;
+}
+
+static void test_buffered(void) {
+        CEfiFileReader reader;
+        CEfiU8 *buf;
+        CEfiUSize n = 0, total = 0;
+        CEfiU64 size = 0;
+
+        buf = malloc(3 * TEST_CHUNK);
+        assert(buf);
+
+        /* small reads are served from the buffer */
+        test_reset();
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK - 100);
+        assert(reader.chunk_size == TEST_CHUNK);
+        assert(!c_efi_file_reader_size(&reader, &size) && size == TEST_SIZE);
+        do {
+                assert(!c_efi_file_reader_read(&reader, buf, 1000, &n));
+                assert(!memcmp(buf, test_data + total, n));
+                total += n;
+        } while (n == 1000);
+        assert(total == TEST_SIZE);
+        assert(test_n_reads == TEST_SIZE / TEST_CHUNK + 2);
+        assert(reader.n_reads == test_n_reads && reader.n_bytes == TEST_SIZE && reader.n_ns == 0);
+        assert(test_n_allocations == 1);
+        assert(!c_efi_file_reader_read(&reader, buf, 1000, &n) && n == 0);
+        assert(test_n_reads == TEST_SIZE / TEST_CHUNK + 2);
+        c_efi_file_reader_deinit(&reader);
+        assert(test_n_allocations == 0);
+
+        /* large reads bypass the buffer, the rest is buffered */
+        test_reset();
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_read(&reader, buf, 10, &n) && n == 10);
+        assert(!c_efi_file_reader_size(&reader, &size) && size == TEST_SIZE - 10);
+        assert(!c_efi_file_reader_read(&reader, buf + 10, 2 * TEST_CHUNK + 5, &n));
+        assert(n == 2 * TEST_CHUNK + 5);
+        assert(!memcmp(buf, test_data, 2 * TEST_CHUNK + 15));
+        assert(test_n_reads == 3);
+        c_efi_file_reader_deinit(&reader);
+
+        /* short reads of the firmware are retried */
+        test_reset();
+        test_max_read = 3000;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_read(&reader, buf, 2 * TEST_CHUNK, &n) && n == 2 * TEST_CHUNK);
+        assert(!memcmp(buf, test_data, 2 * TEST_CHUNK));
+        test_max_read = 0;
+        c_efi_file_reader_deinit(&reader);
+
+        free(buf);
+}
+
+static void test_load(void) {
+        CEfiPhysicalAddress address = 0;
+        CEfiFileReader reader;
+        CEfiUSize size = 0, n = 0;
+        CEfiU8 buf[100];
+        CEfiClock clock;
+
+        /* a known size is read straight into the destination */
+        test_reset();
+        c_efi_clock_init(&clock, 1000000000);
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, &clock, TEST_CHUNK);
+        test_zero_copy = C_EFI_TRUE;
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == TEST_SIZE);
+        assert(!memcmp((void *)(uintptr_t)address, test_data, TEST_SIZE));
+        assert(test_n_reads == TEST_SIZE / TEST_CHUNK + 1);
+        assert(test_n_allocations == 1 && test_allocations[0].pages == (TEST_SIZE + 4095) / 4096);
+        test_free_pages(address, (TEST_SIZE + 4095) / 4096);
+        c_efi_file_reader_deinit(&reader);
+
+        /* buffered data is handed over, and a long name needs the pool */
+        test_reset();
+        test_name_length = 300;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_read(&reader, buf, sizeof(buf), &n) && n == sizeof(buf));
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == TEST_SIZE - sizeof(buf));
+        assert(!memcmp((void *)(uintptr_t)address, test_data + sizeof(buf), size));
+        assert(test_n_pools == 0);
+        test_free_pages(address, (size + 4095) / 4096);
+        c_efi_file_reader_deinit(&reader);
+        test_name_length = 8;
+
+        /* an unknown size grows the destination */
+        test_reset();
+        test_no_info = C_EFI_TRUE;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == TEST_SIZE);
+        assert(!memcmp((void *)(uintptr_t)address, test_data, TEST_SIZE));
+        assert(test_n_allocations == 1 && test_allocations[0].pages == (TEST_SIZE + 4095) / 4096);
+        test_free_pages(address, (size + 4095) / 4096);
+        assert(test_n_allocations == 0);
+        c_efi_file_reader_deinit(&reader);
+
+        /* ...and odd lengths keep just the last partial page */
+        test_reset();
+        test_size = 3 * TEST_CHUNK + 4097;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == 3 * TEST_CHUNK + 4097);
+        assert(!memcmp((void *)(uintptr_t)address, test_data, size));
+        assert(test_n_allocations == 1 && test_allocations[0].pages == 3 * TEST_CHUNK / 4096 + 2);
+        test_free_pages(address, (size + 4095) / 4096);
+        assert(test_n_allocations == 0);
+        c_efi_file_reader_deinit(&reader);
+        test_size = TEST_SIZE;
+        test_no_info = C_EFI_FALSE;
+
+        /* files shorter than reported keep only the pages read */
+        test_reset();
+        test_missing = 5 * 4096 + 7;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, TEST_CHUNK);
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == TEST_SIZE);
+        assert(!memcmp((void *)(uintptr_t)address, test_data, size));
+        assert(test_n_allocations == 1 && test_allocations[0].pages == (TEST_SIZE + 4095) / 4096);
+        test_free_pages(address, (size + 4095) / 4096);
+        assert(test_n_allocations == 0);
+        c_efi_file_reader_deinit(&reader);
+        test_missing = 0;
+
+        /* empty files */
+        test_reset();
+        test_size = 0;
+        c_efi_file_reader_init(&reader, &test_bs, &test_file, NULL, 0);
+        assert(reader.chunk_size == C_EFI_FILE_READER_CHUNK_SIZE);
+        assert(!c_efi_file_reader_load(&reader, C_EFI_LOADER_DATA, &address, &size));
+        assert(size == 0 && test_n_reads == 0);
+        test_free_pages(address, 1);
+        test_size = TEST_SIZE;
+        assert(test_n_allocations == 0);
+}
+
+int main(int argc, char **argv) {
+        size_t i;
+
+        test_data = malloc(TEST_SIZE);
+        assert(test_data);
+        srand(9);
+        for (i = 0; i < TEST_SIZE; ++i)
+                test_data[i] = rand();
+
+        test_buffered();
+        test_load();
+
+        free(test_data);
+        return 0;
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+/*
+ * Fake Firmware for Tests
+ *
+ * Host stand-ins for the boot services and devices the tests run against.
+ * Each test includes the parts it needs by defining their macros first:
+ *
+ *  - TEST_N_ALLOCATIONS enables page allocations, which are served from the
+ *    host heap and tracked, so tests can check for leaks. New pages are
+ *    poisoned, and the tail of an allocation may be freed on its own, like
+ *    firmware allows.
+ *
+ *  - TEST_BLOCK_IO enables a Block I/O device backed by a temporary file,
+ *    see test_disk_open(). Its media uses TEST_BLOCK_SIZE and TEST_ALIGN,
+ *    and TEST_N_BLOCKS if defined. Tests write their image to `test_fd`,
+ *    and may fail reads with `test_read_error`.
+ *
+ *  - TEST_BLOCK_IO2 enables firmware events and a Block I/O 2 device on an
+ *    in-memory disk of TEST_N_BLOCKS blocks of TEST_BLOCK_SIZE. The device
+ *    completes requests on a simulated clock, after a fixed latency plus a
+ *    random jitter, so completions arrive out of order. Requests complete
+ *    while the consumer waits for an event, or does simulated CPU work with
+ *    test_work(). With `test_instant` set, they complete right when they
+ *    are submitted.
+ *
+ * The two block devices share `test_media` and `test_bio`, so a test uses
+ * one of them only.
+ *
+ * Tests define their own `test_bs` from the functions here, so every test
+ * states which boot services it relies on.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+
+#ifdef TEST_N_ALLOCATIONS
+
+typedef struct TestAllocation {
+        CEfiPhysicalAddress address;
+        CEfiUSize pages;
+} TestAllocation;
+
+static TestAllocation test_allocations[TEST_N_ALLOCATIONS];
+static size_t test_n_allocations;
+
+static inline CEfiStatus CEFICALL test_allocate_pages(CEfiAllocateType type,
+                                                      CEfiMemoryType memory_type,
+                                                      CEfiUSize pages,
+                                                      CEfiPhysicalAddress *memory) {
+        void *p;
+
+        assert(type == C_EFI_ALLOCATE_ANY_PAGES && pages);
+        assert(test_n_allocations < TEST_N_ALLOCATIONS);
+        p = aligned_alloc(4096, pages * 4096);
+        assert(p);
+        memset(p, 0xcc, pages * 4096);
+        *memory = (uintptr_t)p;
+        test_allocations[test_n_allocations++] = (TestAllocation){ .address = *memory, .pages = pages };
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus CEFICALL test_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        size_t i;
+
+        for (i = 0; i < test_n_allocations; ++i) {
+                if (test_allocations[i].address == memory) {
+                        assert(test_allocations[i].pages == pages);
+                        free((void *)(uintptr_t)memory);
+                        test_allocations[i] = test_allocations[--test_n_allocations];
+                        return C_EFI_SUCCESS;
+                }
+
+                /* the tail of an allocation may be freed on its own */
+                if (memory > test_allocations[i].address &&
+                    memory + pages * 4096 == test_allocations[i].address + test_allocations[i].pages * 4096) {
+                        assert(!((memory - test_allocations[i].address) % 4096));
+                        test_allocations[i].pages -= pages;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        assert(0);
+        return C_EFI_NOT_FOUND;
+}
+
+#endif /* TEST_N_ALLOCATIONS */
+
+#if defined(TEST_BLOCK_IO) && defined(TEST_BLOCK_IO2)
+#error "TEST_BLOCK_IO and TEST_BLOCK_IO2 are mutually exclusive"
+#endif
+
+#ifdef TEST_BLOCK_IO
+
+#include <unistd.h>
+
+static int test_fd = -1;
+static unsigned int test_n_reads;
+static CEfiStatus test_read_error;
+
+static inline CEfiStatus CEFICALL test_read_blocks(CEfiBlockIoProtocol *this_,
+                                                   CEfiU32 media_id,
+                                                   CEfiLba lba,
+                                                   CEfiUSize buffer_size,
+                                                   void *buffer) {
+        ++test_n_reads;
+        if (test_read_error)
+                return test_read_error;
+        if (media_id != this_->media->media_id)
+                return C_EFI_MEDIA_CHANGED;
+
+        assert(!((uintptr_t)buffer % this_->media->io_align));
+        assert(!(buffer_size % this_->media->block_size));
+        assert(lba <= this_->media->last_block);
+        assert(buffer_size / this_->media->block_size <= this_->media->last_block + 1 - lba);
+        assert(pread(test_fd, buffer, buffer_size, lba * this_->media->block_size) == (ssize_t)buffer_size);
+        return C_EFI_SUCCESS;
+}
+
+/* create the temporary file backing the device, removed once closed */
+static inline void test_disk_open(void) {
+        char path[] = "/tmp/test-disk-XXXXXX";
+
+        test_fd = mkstemp(path);
+        assert(test_fd >= 0);
+        unlink(path);
+}
+
+static inline void test_disk_close(void) {
+        close(test_fd);
+        test_fd = -1;
+}
+
+static CEfiBlockIoMedia test_media = {
+        .media_id = 1,
+        .media_present = 1,
+        .block_size = TEST_BLOCK_SIZE,
+        .io_align = TEST_ALIGN,
+#ifdef TEST_N_BLOCKS
+        .last_block = TEST_N_BLOCKS - 1,
+#endif
+};
+
+static CEfiBlockIoProtocol test_bio = {
+        .revision = C_EFI_BLOCK_IO_PROTOCOL_REVISION3,
+        .media = &test_media,
+        .read_blocks = test_read_blocks,
+};
+
+#endif /* TEST_BLOCK_IO */
+
+#ifdef TEST_BLOCK_IO2
+
+#ifndef TEST_N_EVENTS
+#define TEST_N_EVENTS 64
+#endif
+
+#ifndef TEST_N_REQUESTS
+#define TEST_N_REQUESTS 64
+#endif
+
+typedef struct TestEvent {
+        CEfiU32 type;
+        CEfiEventNotify notify;
+        void *context;
+        int signaled;
+        int used;
+} TestEvent;
+
+typedef struct TestRequest {
+        CEfiBlockIo2Token *token;
+        CEfiLba lba;
+        CEfiUSize size;
+        void *buffer;
+        uint64_t done_at;
+} TestRequest;
+
+static TestEvent test_events[TEST_N_EVENTS];
+static TestRequest test_requests[TEST_N_REQUESTS];
+static size_t test_n_requests, test_max_requests, test_n_open;
+static uint64_t test_now, test_latency = 100000;
+static CEfiU8 test_disk[TEST_N_BLOCKS * TEST_BLOCK_SIZE];
+static CEfiStatus test_submit_error, test_transaction_error;
+static CEfiLba test_error_lba = (CEfiLba)-1;
+static unsigned int test_create_limit = TEST_N_EVENTS;
+static int test_instant;
+
+static inline CEfiStatus CEFICALL test_create_event(CEfiU32 type,
+                                                    CEfiTpl notify_tpl,
+                                                    CEfiEventNotify notify_function,
+                                                    void *notify_context,
+                                                    CEfiEvent *event) {
+        size_t i;
+
+        if (!test_create_limit)
+                return C_EFI_OUT_OF_RESOURCES;
+        --test_create_limit;
+
+        assert(!type || (type == C_EFI_EVT_NOTIFY_SIGNAL && notify_tpl == C_EFI_TPL_CALLBACK && notify_function));
+        for (i = 0; i < TEST_N_EVENTS; ++i) {
+                if (!test_events[i].used) {
+                        test_events[i] = (TestEvent){ .type = type, .notify = notify_function, .context = notify_context, .used = 1 };
+                        *event = &test_events[i];
+                        ++test_n_open;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        return C_EFI_OUT_OF_RESOURCES;
+}
+
+static inline CEfiStatus CEFICALL test_signal_event(CEfiEvent event) {
+        TestEvent *e = event;
+
+        assert(e->used);
+        if (e->notify)
+                e->notify(event, e->context);
+        else
+                e->signaled = 1;
+        return C_EFI_SUCCESS;
+}
+
+static inline CEfiStatus CEFICALL test_close_event(CEfiEvent event) {
+        TestEvent *e = event;
+        size_t i;
+
+        /* no request may still refer to the event */
+        for (i = 0; i < test_n_requests; ++i)
+                assert(test_requests[i].token->event != event);
+
+        assert(e->used);
+        e->used = 0;
+        --test_n_open;
+        return C_EFI_SUCCESS;
+}
+
+/* complete the request at @i, and advance the clock to its completion */
+static inline void test_finish(size_t i) {
+        TestRequest req;
+
+        req = test_requests[i];
+        test_requests[i] = test_requests[--test_n_requests];
+        if (test_now < req.done_at)
+                test_now = req.done_at;
+
+        memcpy(req.buffer, test_disk + req.lba * TEST_BLOCK_SIZE, req.size);
+        req.token->transaction_status = req.lba == test_error_lba ? test_transaction_error : C_EFI_SUCCESS;
+        test_signal_event(req.token->event);
+}
+
+/* complete the earliest request, if it is due by @until */
+static inline int test_complete(uint64_t until) {
+        size_t i, min = 0;
+
+        if (!test_n_requests)
+                return 0;
+
+        for (i = 1; i < test_n_requests; ++i)
+                if (test_requests[i].done_at < test_requests[min].done_at)
+                        min = i;
+        if (test_requests[min].done_at > until)
+                return 0;
+
+        test_finish(min);
+        return 1;
+}
+
+static inline CEfiStatus CEFICALL test_wait_for_event(CEfiUSize number_of_events, CEfiEvent *event, CEfiUSize *index) {
+        TestEvent *e = event[0];
+
+        assert(number_of_events == 1 && !e->type);
+        while (!e->signaled)
+                assert(test_complete((uint64_t)-1));
+
+        e->signaled = 0;
+        *index = 0;
+        return C_EFI_SUCCESS;
+}
+
+/* simulate CPU work of @ns, while the device keeps completing requests */
+static inline void test_work(uint64_t ns) {
+        uint64_t until = test_now + ns;
+
+        while (test_complete(until))
+                ;
+        test_now = until;
+}
+
+static inline CEfiStatus CEFICALL test_read_blocks_ex(CEfiBlockIo2Protocol *this_,
+                                                      CEfiU32 media_id,
+                                                      CEfiLba lba,
+                                                      CEfiBlockIo2Token *token,
+                                                      CEfiUSize buffer_size,
+                                                      void *buffer) {
+        CEfiBlockIoMedia *media = this_->media;
+
+        assert(media_id == media->media_id);
+        assert(!media->io_align || !((uintptr_t)buffer % media->io_align));
+        assert(buffer_size && !(buffer_size % media->block_size));
+        assert(lba + buffer_size / media->block_size <= TEST_N_BLOCKS);
+        assert(token && token->event);
+
+        if (test_submit_error)
+                return test_submit_error;
+
+        assert(test_n_requests < TEST_N_REQUESTS);
+        test_requests[test_n_requests++] = (TestRequest){
+                .token = token,
+                .lba = lba,
+                .size = buffer_size,
+                .buffer = buffer,
+                .done_at = test_now + test_latency + (uint64_t)rand() % (test_latency / 2) + buffer_size,
+        };
+        if (test_n_requests > test_max_requests)
+                test_max_requests = test_n_requests;
+        if (test_instant)
+                test_finish(test_n_requests - 1);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBlockIoMedia test_media = {
+        .media_id = 7,
+        .media_present = 1,
+        .block_size = TEST_BLOCK_SIZE,
+        .io_align = TEST_ALIGN,
+        .last_block = TEST_N_BLOCKS - 1,
+};
+
+static CEfiBlockIo2Protocol test_bio = {
+        .media = &test_media,
+        .read_blocks_ex = test_read_blocks_ex,
+};
+
+#endif /* TEST_BLOCK_IO2 */
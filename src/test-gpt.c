@@ -0,0 +1,382 @@
+/*
+ * Tests for the GUID Partition Table Parser
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-efi.h"
+#include "c-efi-gpt.h"
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_N_BLOCKS 2048
+#define TEST_LAST (TEST_N_BLOCKS - 1)
+#define TEST_N_ENTRIES 128
+#define TEST_ENTRIES_BLOCKS (TEST_N_ENTRIES * 128 / TEST_BLOCK_SIZE)
+#define TEST_ALIGN 64
+
+#define TEST_BLOCK_IO
+#include "test-firmware.h"
+
+#define TEST_TYPE_LINUX_GUID C_EFI_GUID(0x0fc63daf, 0x8483, 0x4772, 0x8e, 0x79, 0x3d, 0x69, 0xd8, 0x47, 0x7d, 0xe4)
+
+static _Alignas(8) CEfiU8 test_disk[TEST_N_BLOCKS * TEST_BLOCK_SIZE];
+
+/* an independent, bitwise CRC32 */
+static uint32_t test_crc32(const void *data, size_t n) {
+        const uint8_t *p = data;
+        uint32_t crc = 0xffffffff;
+        size_t i, k;
+
+        for (i = 0; i < n; ++i) {
+                crc ^= p[i];
+                for (k = 0; k < 8; ++k)
+                        crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+
+        return ~crc;
+}
+
+static CEfiGptHeader *test_header(CEfiLba lba) {
+        return (CEfiGptHeader *)(test_disk + lba * TEST_BLOCK_SIZE);
+}
+
+static CEfiGptEntry *test_entry(CEfiLba entries_lba, unsigned int i) {
+        return (CEfiGptEntry *)(test_disk + entries_lba * TEST_BLOCK_SIZE) + i;
+}
+
+static void test_guid(CEfiGuid *guid, unsigned int seed) {
+        unsigned int i;
+
+        for (i = 0; i < 16; ++i)
+                guid->u8[i] = (CEfiU8)(seed * 131 + i * 7 + 1);
+}
+
+/* recompute the CRCs of a header and, if it fits the disk, its entry array */
+static void test_seal(CEfiLba lba) {
+        CEfiGptHeader *h = test_header(lba);
+        size_t n = (size_t)h->number_of_partition_entries * h->size_of_partition_entry;
+
+        if (n <= TEST_N_ENTRIES * 128)
+                h->partition_entry_array_crc32 = test_crc32(test_entry(h->partition_entry_lba, 0), n);
+        h->header_crc32 = 0;
+        h->header_crc32 = test_crc32(h, h->header_size);
+}
+
+static void test_sync(void) {
+        assert(pwrite(test_fd, test_disk, sizeof(test_disk), 0) == sizeof(test_disk));
+}
+
+/*
+ * Build a disk with a protective MBR, and primary and backup tables with
+ * @n_used partitions: an ESP, followed by Linux partitions of 8 blocks each.
+ */
+static void test_build(unsigned int n_used) {
+        CEfiGptHeader *h;
+        CEfiGptEntry *e;
+        unsigned int i;
+
+        memset(test_disk, 0, sizeof(test_disk));
+        test_disk[446 + 4] = 0xee;
+        test_disk[510] = 0x55;
+        test_disk[511] = 0xaa;
+
+        for (i = 0; i < n_used; ++i) {
+                e = test_entry(2, i);
+                e->partition_type_guid = i ? TEST_TYPE_LINUX_GUID : C_EFI_GPT_TYPE_EFI_SYSTEM_GUID;
+                test_guid(&e->unique_partition_guid, i);
+                e->starting_lba = 2 + TEST_ENTRIES_BLOCKS + 8 * i;
+                e->ending_lba = e->starting_lba + 7;
+                e->partition_name[0] = 'a' + i % 26;
+        }
+        memcpy(test_entry(TEST_LAST - TEST_ENTRIES_BLOCKS, 0), test_entry(2, 0), TEST_N_ENTRIES * 128);
+
+        h = test_header(1);
+        h->signature = C_EFI_GPT_HEADER_SIGNATURE;
+        h->revision = C_EFI_GPT_HEADER_REVISION;
+        h->header_size = C_EFI_GPT_HEADER_SIZE_MIN;
+        h->my_lba = 1;
+        h->alternate_lba = TEST_LAST;
+        h->first_usable_lba = 2 + TEST_ENTRIES_BLOCKS;
+        h->last_usable_lba = TEST_LAST - TEST_ENTRIES_BLOCKS - 1;
+        test_guid(&h->disk_guid, 1000);
+        h->partition_entry_lba = 2;
+        h->number_of_partition_entries = TEST_N_ENTRIES;
+        h->size_of_partition_entry = 128;
+
+        *test_header(TEST_LAST) = *h;
+        test_header(TEST_LAST)->my_lba = TEST_LAST;
+        test_header(TEST_LAST)->alternate_lba = 1;
+        test_header(TEST_LAST)->partition_entry_lba = TEST_LAST - TEST_ENTRIES_BLOCKS;
+
+        test_seal(1);
+        test_seal(TEST_LAST);
+        test_sync();
+}
+
+static _Alignas(TEST_ALIGN) CEfiU8 test_buffer[2 * TEST_BLOCK_SIZE + TEST_N_ENTRIES * 128];
+
+static void test_header_check(void) {
+        CEfiGptHeader *h = test_header(1);
+
+        test_build(4);
+        assert(!c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST));
+        assert(!c_efi_gpt_header_check(test_header(TEST_LAST), TEST_BLOCK_SIZE, TEST_LAST, TEST_LAST));
+        assert(!c_efi_gpt_entries_check(h, test_entry(2, 0)));
+
+        /* read from the wrong LBA, or on a smaller disk */
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 2, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST - 1) == C_EFI_VOLUME_CORRUPTED);
+
+        /* missing signature, and bad CRC */
+        assert(c_efi_gpt_header_check(test_header(0), TEST_BLOCK_SIZE, 0, TEST_LAST) == C_EFI_NOT_FOUND);
+        h->reserved = 1;
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_CRC_ERROR);
+        h->reserved = 0;
+
+        /* a larger header size covers more bytes by the CRC */
+        h->header_size = 96;
+        test_seal(1);
+        assert(!c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST));
+        h->header_size = TEST_BLOCK_SIZE + 8;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->header_size = C_EFI_GPT_HEADER_SIZE_MIN;
+
+        /* unknown major revision */
+        h->revision = 0x00020000;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->revision = C_EFI_GPT_HEADER_REVISION;
+
+        /* entry arrays overlapping the usable range, or overflowing */
+        h->first_usable_lba = 2 + TEST_ENTRIES_BLOCKS - 1;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->first_usable_lba = 2 + TEST_ENTRIES_BLOCKS;
+        h->number_of_partition_entries = 0x80000000;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->number_of_partition_entries = TEST_N_ENTRIES;
+        h->size_of_partition_entry = 192;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->size_of_partition_entry = 128;
+
+        /* usable range beyond the disk, or reversed */
+        h->last_usable_lba = TEST_N_BLOCKS;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->last_usable_lba = h->first_usable_lba - 1;
+        test_seal(1);
+        assert(c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_VOLUME_CORRUPTED);
+        h->last_usable_lba = TEST_LAST - TEST_ENTRIES_BLOCKS - 1;
+        test_seal(1);
+        assert(!c_efi_gpt_header_check(h, TEST_BLOCK_SIZE, 1, TEST_LAST));
+
+        /* entries must have a valid CRC, and lie in the usable range */
+        test_entry(2, 100)->attributes = 1;
+        assert(c_efi_gpt_entries_check(h, test_entry(2, 0)) == C_EFI_CRC_ERROR);
+        test_seal(1);
+        assert(!c_efi_gpt_entries_check(h, test_entry(2, 0)));
+        test_entry(2, 3)->ending_lba = h->last_usable_lba + 1;
+        test_seal(1);
+        assert(c_efi_gpt_entries_check(h, test_entry(2, 0)) == C_EFI_VOLUME_CORRUPTED);
+        test_entry(2, 3)->ending_lba = test_entry(2, 3)->starting_lba - 1;
+        test_seal(1);
+        assert(c_efi_gpt_entries_check(h, test_entry(2, 0)) == C_EFI_VOLUME_CORRUPTED);
+
+        /* misaligned buffers */
+        assert(c_efi_gpt_header_check(test_disk + 516, TEST_BLOCK_SIZE, 1, TEST_LAST) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_gpt_entries_check(h, test_disk + 1028) == C_EFI_INVALID_PARAMETER);
+}
+
+static void test_load(void) {
+        CEfiGpt gpt;
+
+        /* both tables intact, the backup entries are not read */
+        test_build(4);
+        test_n_reads = 0;
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(test_n_reads == 3);
+        assert(gpt.primary_valid && gpt.backup_valid);
+        assert(gpt.header->my_lba == 1);
+        assert(gpt.n_entries == TEST_N_ENTRIES && gpt.entry_size == 128);
+        assert(gpt.entries >= test_buffer && gpt.entries < test_buffer + sizeof(test_buffer));
+        assert(!memcmp(gpt.entries, test_entry(2, 0), TEST_N_ENTRIES * 128));
+        assert(c_efi_guid_equal(&c_efi_gpt_entry(&gpt, 0)->partition_type_guid, &C_EFI_GPT_TYPE_EFI_SYSTEM_GUID));
+        assert(c_efi_gpt_entry(&gpt, 3)->starting_lba == 2 + TEST_ENTRIES_BLOCKS + 24);
+
+        /* damaged primary header, the backup is used */
+        test_header(1)->first_usable_lba = 3;
+        test_sync();
+        test_n_reads = 0;
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(test_n_reads == 3);
+        assert(!gpt.primary_valid && gpt.backup_valid);
+        assert(gpt.header->my_lba == TEST_LAST);
+        assert(!memcmp(gpt.entries, test_entry(2, 0), TEST_N_ENTRIES * 128));
+
+        /* damaged primary entries, the backup is used */
+        test_build(4);
+        test_entry(2, 1)->attributes = 4;
+        test_sync();
+        test_n_reads = 0;
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(test_n_reads == 4);
+        assert(!gpt.primary_valid && gpt.backup_valid);
+        assert(!c_efi_gpt_entry(&gpt, 1)->attributes);
+
+        /* damaged backup header */
+        test_build(4);
+        test_header(TEST_LAST)->alternate_lba = 2;
+        test_seal(TEST_LAST);
+        test_sync();
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(gpt.primary_valid && !gpt.backup_valid);
+
+        /* backup describing a different table */
+        test_build(4);
+        test_entry(TEST_LAST - TEST_ENTRIES_BLOCKS, 1)->attributes = 4;
+        test_seal(TEST_LAST);
+        test_sync();
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(gpt.primary_valid && !gpt.backup_valid);
+
+        /* both damaged, the primary error is returned */
+        test_build(4);
+        test_header(1)->reserved = 1;
+        test_header(TEST_LAST)->reserved = 1;
+        test_sync();
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)) == C_EFI_CRC_ERROR);
+        assert(!gpt.primary_valid && !gpt.backup_valid && !gpt.header);
+
+        test_build(4);
+        test_header(1)->reserved = 1;
+        test_entry(TEST_LAST - TEST_ENTRIES_BLOCKS, 1)->attributes = 4;
+        test_sync();
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)) == C_EFI_CRC_ERROR);
+
+        /* no partition table at all */
+        memset(test_disk, 0, sizeof(test_disk));
+        test_sync();
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)) == C_EFI_NOT_FOUND);
+
+        /* buffer size and alignment */
+        test_build(4);
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer) - 1) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer, TEST_BLOCK_SIZE) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_gpt_load(&gpt, &test_bio, test_buffer + 8, sizeof(test_buffer) - 8) == C_EFI_INVALID_PARAMETER);
+}
+
+static void test_index(void) {
+        CEfiU32 slots[2 * 2 * TEST_N_ENTRIES], i, iter, n;
+        CEfiGptIndex index;
+        CEfiGuid guid;
+        CEfiGpt gpt;
+        _Bool seen[TEST_N_ENTRIES] = { 0 };
+
+        test_build(5);
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+
+        /* 5 used entries need tables of 8 slots */
+        assert(c_efi_gpt_index_init(&index, &gpt, slots, 15) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_gpt_index_init(&index, &gpt, slots, 16));
+        assert(index.mask == 7);
+        assert(!c_efi_gpt_index_init(&index, &gpt, slots, 47));
+        assert(index.mask == 15);
+
+        iter = 0;
+        assert(c_efi_gpt_index_find_type(&index, &C_EFI_GPT_TYPE_EFI_SYSTEM_GUID, &iter) == 0);
+        assert(c_efi_gpt_index_find_type(&index, &C_EFI_GPT_TYPE_EFI_SYSTEM_GUID, &iter) == C_EFI_GPT_NONE);
+        iter = 0;
+        assert(c_efi_gpt_index_find_type(&index, &C_EFI_GPT_TYPE_LEGACY_MBR_GUID, &iter) == C_EFI_GPT_NONE);
+        iter = 0;
+        assert(c_efi_gpt_index_find_type(&index, &C_EFI_GPT_TYPE_UNUSED_GUID, &iter) == C_EFI_GPT_NONE);
+
+        for (n = 0, iter = 0; (i = c_efi_gpt_index_find_type(&index, &TEST_TYPE_LINUX_GUID, &iter)) != C_EFI_GPT_NONE; ++n) {
+                assert(i >= 1 && i < 5 && !seen[i]);
+                seen[i] = 1;
+        }
+        assert(n == 4);
+
+        for (i = 0; i < 5; ++i) {
+                test_guid(&guid, i);
+                assert(c_efi_gpt_index_find_unique(&index, &guid) == i);
+        }
+        test_guid(&guid, 5);
+        assert(c_efi_gpt_index_find_unique(&index, &guid) == C_EFI_GPT_NONE);
+
+        /* a full table, with every type colliding */
+        test_build(TEST_N_ENTRIES);
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(c_efi_gpt_index_init(&index, &gpt, slots, sizeof(slots) / sizeof(*slots) - 1) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_gpt_index_init(&index, &gpt, slots, sizeof(slots) / sizeof(*slots)));
+
+        memset(seen, 0, sizeof(seen));
+        for (n = 0, iter = 0; (i = c_efi_gpt_index_find_type(&index, &TEST_TYPE_LINUX_GUID, &iter)) != C_EFI_GPT_NONE; ++n) {
+                assert(i >= 1 && i < TEST_N_ENTRIES && !seen[i]);
+                seen[i] = 1;
+        }
+        assert(n == TEST_N_ENTRIES - 1);
+
+        for (i = 0; i < TEST_N_ENTRIES; ++i) {
+                test_guid(&guid, i);
+                assert(c_efi_gpt_index_find_unique(&index, &guid) == i);
+        }
+}
+
+static void test_device_path(void) {
+        CEfiU32 slots[32];
+        CEfiDevicePathHardDrive node;
+        CEfiGptIndex index;
+        CEfiGpt gpt;
+        CEfiU8 *raw = (CEfiU8 *)&node;
+
+        test_build(5);
+        assert(!c_efi_gpt_load(&gpt, &test_bio, test_buffer, sizeof(test_buffer)));
+        assert(!c_efi_gpt_index_init(&index, &gpt, slots, 32));
+
+        /* the node layout is fixed by the specification */
+        c_efi_gpt_device_path(&gpt, 2, &node);
+        assert(sizeof(node) == 42);
+        assert(raw[0] == 0x04 && raw[1] == 0x01 && raw[2] == 42 && raw[3] == 0);
+        assert(raw[4] == 3 && !raw[5] && !raw[6] && !raw[7]);
+        assert(raw[8] == 2 + TEST_ENTRIES_BLOCKS + 16 && !raw[9] && !raw[15]);
+        assert(raw[16] == 8 && !raw[17] && !raw[23]);
+        assert(!memcmp(raw + 24, &c_efi_gpt_entry(&gpt, 2)->unique_partition_guid, 16));
+        assert(raw[40] == 2 && raw[41] == 2);
+
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == 2);
+
+        /* the entry number does not matter, but start and size do */
+        node.partition_number[0] = 9;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == 2);
+        node.partition_start[0] += 1;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == C_EFI_GPT_NONE);
+        node.partition_start[0] -= 1;
+        node.partition_size[1] = 1;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == C_EFI_GPT_NONE);
+        node.partition_size[1] = 0;
+        node.signature_type = C_EFI_HARD_DRIVE_SIGNATURE_TYPE_MBR;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == C_EFI_GPT_NONE);
+        node.signature_type = C_EFI_HARD_DRIVE_SIGNATURE_TYPE_GUID;
+        node.header.subtype = C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_CDROM;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == C_EFI_GPT_NONE);
+        node.header.subtype = C_EFI_DEVICE_PATH_SUBTYPE_MEDIA_HARD_DRIVE;
+        assert(c_efi_gpt_index_match_device_path(&index, &node.header) == 2);
+}
+
+int main(int argc, char **argv) {
+        test_disk_open();
+        test_header_check();
+        test_load();
+        test_index();
+        test_device_path();
+
+        test_disk_close();
+        return 0;
+}
@@ -0,0 +1,932 @@
+/*
+ * Tests for LZ4 Streaming Decompression
+ *
+ * The vectors were produced by the reference implementation (liblz4 1.9.4,
+ * LZ4F_compressFrame() and LZ4_compress_default()) from the generators below.
+ * On top, the tests build frames with a small greedy compressor of their own,
+ * to cover flag combinations and corner cases the reference never emits.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-lz4.h"
+
+static const CEfiU8 test_lz4_text[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x5d, 0x02, 0x00, 0x00, 0xf6,
+        0x04, 0x70, 0x61, 0x72, 0x74, 0x69, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x61,
+        0x20, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x20, 0x13, 0x00, 0xd6, 0x6f,
+        0x66, 0x0a, 0x69, 0x6e, 0x69, 0x74, 0x72, 0x64, 0x20, 0x6f, 0x66, 0x0a,
+        0x17, 0x00, 0x10, 0x61, 0x0f, 0x00, 0xc4, 0x69, 0x6d, 0x61, 0x67, 0x65,
+        0x20, 0x6b, 0x65, 0x72, 0x6e, 0x65, 0x6c, 0x3a, 0x00, 0x74, 0x62, 0x6f,
+        0x6f, 0x74, 0x20, 0x6f, 0x66, 0x0f, 0x00, 0xf3, 0x04, 0x6f, 0x66, 0x20,
+        0x64, 0x65, 0x66, 0x61, 0x75, 0x6c, 0x74, 0x20, 0x65, 0x66, 0x69, 0x20,
+        0x73, 0x74, 0x75, 0x62, 0x37, 0x00, 0xd4, 0x65, 0x6e, 0x74, 0x72, 0x79,
+        0x20, 0x74, 0x69, 0x6d, 0x65, 0x6f, 0x75, 0x74, 0x45, 0x00, 0x02, 0x15,
+        0x00, 0x00, 0x44, 0x00, 0x10, 0x0a, 0x2f, 0x00, 0x00, 0x09, 0x00, 0x72,
+        0x20, 0x6c, 0x6f, 0x61, 0x64, 0x65, 0x72, 0x0c, 0x00, 0x04, 0x4c, 0x00,
+        0x0a, 0x74, 0x00, 0x00, 0x56, 0x00, 0x05, 0x4a, 0x00, 0x20, 0x6f, 0x66,
+        0x7f, 0x00, 0x06, 0x82, 0x00, 0x02, 0x53, 0x00, 0x04, 0x39, 0x00, 0x00,
+        0x56, 0x00, 0x54, 0x6f, 0x66, 0x20, 0x74, 0x68, 0x81, 0x00, 0x06, 0xd3,
+        0x00, 0x00, 0x1b, 0x00, 0x01, 0x4a, 0x00, 0x04, 0x2c, 0x00, 0x03, 0x65,
+        0x00, 0x03, 0x2f, 0x00, 0x03, 0x1a, 0x01, 0x03, 0x15, 0x00, 0x02, 0x56,
+        0x00, 0x00, 0x47, 0x00, 0x06, 0x41, 0x00, 0x03, 0x28, 0x01, 0x58, 0x76,
+        0x6f, 0x6c, 0x75, 0x6d, 0x18, 0x00, 0x17, 0x61, 0x4f, 0x01, 0x02, 0x46,
+        0x00, 0x11, 0x0a, 0x68, 0x00, 0x03, 0x29, 0x00, 0x04, 0x6f, 0x00, 0x03,
+        0x3f, 0x00, 0x00, 0x54, 0x00, 0x02, 0x65, 0x00, 0x13, 0x0a, 0x21, 0x00,
+        0x02, 0x0e, 0x00, 0x03, 0x73, 0x00, 0x03, 0x0e, 0x01, 0x02, 0x48, 0x00,
+        0x13, 0x20, 0x22, 0x00, 0x00, 0xbb, 0x00, 0x08, 0x66, 0x00, 0x04, 0x53,
+        0x00, 0x01, 0x67, 0x00, 0x02, 0x32, 0x00, 0x03, 0x76, 0x01, 0x03, 0x31,
+        0x00, 0x03, 0x53, 0x00, 0x03, 0x07, 0x00, 0x02, 0x22, 0x00, 0x01, 0x15,
+        0x01, 0x07, 0x85, 0x00, 0x04, 0x9b, 0x01, 0x06, 0xe1, 0x00, 0x00, 0x9b,
+        0x00, 0x04, 0x5b, 0x00, 0x06, 0x16, 0x00, 0x03, 0x3e, 0x00, 0x03, 0x4c,
+        0x00, 0x01, 0x73, 0x00, 0x00, 0x90, 0x00, 0x01, 0xe6, 0x01, 0x11, 0x0a,
+        0xb6, 0x01, 0x12, 0x61, 0x07, 0x00, 0x04, 0x51, 0x00, 0x00, 0x51, 0x01,
+        0x03, 0xf7, 0x01, 0x02, 0xd4, 0x00, 0x01, 0x2f, 0x00, 0x02, 0x65, 0x02,
+        0x04, 0x24, 0x00, 0x03, 0xe0, 0x00, 0x22, 0x6f, 0x66, 0xf8, 0x01, 0x02,
+        0x97, 0x00, 0x24, 0x0a, 0x61, 0x0d, 0x02, 0x13, 0x61, 0x5f, 0x00, 0x00,
+        0x3a, 0x00, 0x11, 0x61, 0xb9, 0x00, 0x06, 0x90, 0x00, 0x03, 0x3b, 0x00,
+        0x03, 0xea, 0x00, 0x03, 0x9e, 0x00, 0x02, 0x41, 0x00, 0x03, 0x3f, 0x00,
+        0x13, 0x0a, 0xac, 0x00, 0x00, 0xd0, 0x00, 0x06, 0x38, 0x00, 0x31, 0x65,
+        0x66, 0x69, 0x75, 0x02, 0x01, 0xc2, 0x00, 0x03, 0x45, 0x00, 0x03, 0x37,
+        0x00, 0x04, 0x96, 0x00, 0x06, 0x2d, 0x00, 0x04, 0x12, 0x00, 0x01, 0x87,
+        0x00, 0x04, 0x87, 0x01, 0x04, 0x1c, 0x01, 0x04, 0x1d, 0x00, 0x00, 0x9e,
+        0x00, 0x04, 0x0c, 0x00, 0x01, 0x56, 0x00, 0x01, 0x05, 0x00, 0x06, 0xf4,
+        0x00, 0x03, 0x87, 0x00, 0x03, 0x37, 0x00, 0x04, 0x96, 0x00, 0x02, 0x20,
+        0x00, 0x03, 0xb8, 0x00, 0x02, 0x0d, 0x00, 0x14, 0x61, 0x20, 0x03, 0x2b,
+        0x61, 0x0a, 0x11, 0x00, 0x03, 0xe6, 0x00, 0x03, 0xaf, 0x00, 0x05, 0x28,
+        0x00, 0x06, 0xa9, 0x00, 0x06, 0x0a, 0x00, 0x03, 0x52, 0x00, 0x22, 0x6f,
+        0x66, 0x3c, 0x01, 0x22, 0x20, 0x61, 0x52, 0x02, 0x33, 0x0a, 0x6f, 0x66,
+        0x43, 0x01, 0x01, 0xac, 0x01, 0x02, 0x60, 0x00, 0x06, 0x36, 0x00, 0x00,
+        0x16, 0x01, 0x01, 0xb7, 0x00, 0x03, 0x0b, 0x01, 0x02, 0xf1, 0x00, 0x01,
+        0x12, 0x00, 0x00, 0xdf, 0x00, 0x03, 0x55, 0x00, 0x03, 0x07, 0x00, 0x04,
+        0xed, 0x00, 0x03, 0xd9, 0x00, 0x03, 0x07, 0x00, 0x03, 0xa4, 0x00, 0x03,
+        0x24, 0x00, 0x05, 0x5b, 0x00, 0x01, 0x6d, 0x01, 0x02, 0x7a, 0x00, 0x05,
+        0x14, 0x00, 0x01, 0xee, 0x01, 0x02, 0x1e, 0x03, 0x00, 0x5e, 0x00, 0x11,
+        0x61, 0x10, 0x00, 0x03, 0xb6, 0x01, 0x90, 0x20, 0x65, 0x6e, 0x74, 0x72,
+        0x79, 0x20, 0x74, 0x68, 0x00, 0x00, 0x00, 0x00, 0xed, 0xf3, 0x66, 0xf7,
+};
+
+static const CEfiU8 test_lz4_noise[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x2c, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0xfa, 0x2c, 0x01, 0x00, 0x80, 0x1c, 0x53, 0xbc, 0x58, 0x9e,
+        0x61, 0x80, 0x7b, 0x8d, 0xb3, 0xf8, 0xe0, 0x40, 0xc1, 0xe7, 0xda, 0x3f,
+        0xc4, 0x71, 0xc9, 0x3b, 0x70, 0xe8, 0x7c, 0x31, 0x75, 0x6a, 0x4b, 0xbe,
+        0x75, 0x44, 0xd0, 0xa4, 0x48, 0x45, 0x4a, 0x03, 0x75, 0x09, 0xa9, 0x83,
+        0xd3, 0x8a, 0xd3, 0xb7, 0x69, 0xfa, 0xae, 0xec, 0xd6, 0xc7, 0xe1, 0xfa,
+        0x13, 0x8b, 0x56, 0x41, 0x7d, 0x6e, 0x4d, 0xd3, 0x43, 0x05, 0x5f, 0xea,
+        0xd9, 0xd2, 0xd1, 0xa3, 0x40, 0x14, 0x3e, 0xab, 0x31, 0x98, 0xbc, 0xa6,
+        0x16, 0x6d, 0x14, 0xac, 0xbf, 0x27, 0x5b, 0x12, 0x14, 0x57, 0x41, 0x56,
+        0xd1, 0xfb, 0xe0, 0xd0, 0x2c, 0xc2, 0x9f, 0x50, 0x4c, 0x31, 0x78, 0x89,
+        0xc4, 0x36, 0xab, 0x49, 0x0c, 0xa1, 0xa4, 0x61, 0x79, 0x1d, 0x5b, 0x68,
+        0x9f, 0x4c, 0x65, 0x08, 0xa5, 0xba, 0xa0, 0xe1, 0x92, 0x67, 0x64, 0x34,
+        0xde, 0x54, 0xfc, 0x9b, 0xa1, 0x6e, 0x38, 0xc0, 0xf6, 0x5b, 0xa6, 0x3a,
+        0xf0, 0x1f, 0xb0, 0x0d, 0x8d, 0x89, 0x9b, 0x7c, 0xe9, 0xf5, 0xb0, 0xdf,
+        0xdb, 0xcb, 0xfe, 0x53, 0xb1, 0x6c, 0x76, 0x62, 0x33, 0x21, 0xa7, 0xae,
+        0x64, 0x0f, 0x47, 0xe8, 0x40, 0xcc, 0x77, 0x21, 0x2b, 0x70, 0x48, 0xe6,
+        0x63, 0x3d, 0xde, 0x75, 0x75, 0x23, 0xab, 0x89, 0x8d, 0x6d, 0x39, 0xa9,
+        0xa5, 0x03, 0x79, 0x1d, 0xe1, 0xa7, 0xa2, 0x95, 0xef, 0x27, 0x93, 0x44,
+        0x9f, 0xbe, 0x1b, 0x64, 0xfb, 0xa2, 0x3e, 0xcd, 0xce, 0xae, 0x93, 0x90,
+        0xcf, 0x9b, 0xbf, 0x91, 0x62, 0xd8, 0x68, 0xba, 0x2b, 0x6b, 0x6c, 0xd4,
+        0xb7, 0x07, 0xfd, 0xd6, 0xb6, 0x43, 0x5b, 0x3c, 0x5c, 0x0c, 0xef, 0xf6,
+        0x37, 0x52, 0x06, 0x08, 0xb4, 0x9f, 0xc4, 0x3d, 0x05, 0x00, 0x14, 0x2f,
+        0xf0, 0x6f, 0x94, 0xce, 0x5b, 0x55, 0x21, 0x48, 0x8c, 0x79, 0x47, 0xa5,
+        0xfa, 0x2a, 0xad, 0x02, 0xad, 0x28, 0xdc, 0xbd, 0x0b, 0x83, 0x15, 0xee,
+        0xd8, 0x92, 0xf4, 0x56, 0x58, 0x88, 0xf3, 0x48, 0x0a, 0xaf, 0xf3, 0x9b,
+        0x06, 0x4f, 0xc5, 0x8c, 0xd0, 0x7a, 0x8f, 0x96, 0x5b, 0x66, 0x00, 0x4c,
+        0x31, 0x4c, 0xe8, 0x10, 0xf9, 0xf7, 0x55, 0xc6, 0x4e, 0x30, 0x4d, 0x00,
+        0x00, 0x00, 0x00, 0xc6, 0x4e, 0x30, 0x4d,
+};
+
+static const CEfiU8 test_lz4_linked[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x54, 0x40, 0xae, 0x4a, 0x04, 0x00, 0x00, 0xff,
+        0xff, 0xff, 0xb0, 0x9e, 0xea, 0xb0, 0x5d, 0x35, 0x70, 0x07, 0xc6, 0x32,
+        0xf3, 0xdb, 0xb4, 0x84, 0x89, 0x92, 0x4d, 0x55, 0x2b, 0x08, 0xfe, 0x0c,
+        0x35, 0x3a, 0x0d, 0x4a, 0x1f, 0x00, 0xac, 0xda, 0x2c, 0x46, 0x3a, 0xfb,
+        0xea, 0x67, 0xc5, 0xe8, 0xd2, 0x87, 0x7c, 0x5e, 0x3b, 0xc3, 0x97, 0xa6,
+        0x59, 0x94, 0x9e, 0xf8, 0x02, 0x1e, 0x95, 0x4e, 0x0a, 0x12, 0x27, 0x4e,
+        0xb6, 0x22, 0xb0, 0x8d, 0x73, 0x21, 0x1b, 0x49, 0xf8, 0x2d, 0x05, 0xc6,
+        0xaf, 0x4a, 0x39, 0x81, 0x96, 0x31, 0xd9, 0xd7, 0x39, 0x05, 0xd3, 0x92,
+        0x6c, 0x4b, 0xb7, 0x1a, 0x2b, 0x01, 0x23, 0xb6, 0x2e, 0xd4, 0xf5, 0xdb,
+        0x83, 0xb9, 0x12, 0xd6, 0x94, 0xf2, 0xf6, 0x8d, 0x7b, 0xf7, 0xd4, 0x40,
+        0x59, 0x04, 0x78, 0x59, 0x61, 0xa8, 0x9b, 0x14, 0x43, 0x4a, 0x69, 0xb3,
+        0xc8, 0xcd, 0x9f, 0x3d, 0xdb, 0x8d, 0x66, 0x70, 0xb8, 0x47, 0x72, 0x61,
+        0xfe, 0x24, 0xe7, 0xa9, 0x5b, 0xf5, 0xc1, 0xbf, 0x6e, 0xf1, 0x8d, 0xd6,
+        0x69, 0xf4, 0xd4, 0x83, 0x04, 0xc3, 0xe4, 0xc9, 0xa9, 0x48, 0xa5, 0xc2,
+        0x88, 0x2f, 0xf2, 0xcb, 0xcc, 0x65, 0x73, 0x88, 0xc6, 0x38, 0xd2, 0x0f,
+        0x74, 0x59, 0xe2, 0x31, 0xfa, 0xe6, 0x78, 0x32, 0xb5, 0x76, 0x8e, 0xa0,
+        0xf5, 0xe6, 0x8f, 0x47, 0x63, 0x74, 0xdd, 0xce, 0x8e, 0x03, 0xcc, 0x81,
+        0x12, 0x11, 0x61, 0x0c, 0x48, 0xf4, 0xef, 0x1d, 0x3b, 0x12, 0xf8, 0x6d,
+        0xd3, 0x89, 0x47, 0x3e, 0xc7, 0xdc, 0xc6, 0xde, 0xad, 0xf0, 0xd5, 0xa8,
+        0x8d, 0x99, 0x31, 0x6a, 0xb9, 0xa8, 0xc2, 0x95, 0x58, 0x64, 0xf0, 0x54,
+        0x02, 0x02, 0x8b, 0x21, 0xbc, 0x46, 0x73, 0xce, 0x67, 0x33, 0xe2, 0xa2,
+        0x64, 0xf4, 0x4d, 0x8f, 0xad, 0xb0, 0x84, 0x7f, 0xf8, 0xcf, 0x37, 0x3a,
+        0x53, 0x79, 0x3f, 0x85, 0xc6, 0xbe, 0x45, 0xe4, 0xe0, 0xcd, 0x80, 0xfa,
+        0x09, 0x0a, 0x1b, 0x44, 0x04, 0x76, 0x80, 0x9a, 0x61, 0xe3, 0x02, 0x4e,
+        0x53, 0x89, 0xc1, 0x36, 0x56, 0xf1, 0x41, 0xb1, 0x8e, 0x5b, 0x55, 0x45,
+        0x1c, 0x1e, 0xa0, 0x67, 0x75, 0x3e, 0xf3, 0x31, 0xb1, 0x30, 0x24, 0xb6,
+        0x85, 0x9e, 0x68, 0x44, 0x40, 0xc1, 0x85, 0xfc, 0x74, 0x2b, 0x8b, 0xa8,
+        0xe4, 0x7e, 0xe7, 0x50, 0xb8, 0xb1, 0x69, 0x52, 0x83, 0x66, 0x90, 0xa9,
+        0x97, 0xaf, 0xa2, 0x38, 0x99, 0x7e, 0x3c, 0xbc, 0xe1, 0x9c, 0x46, 0xb6,
+        0xf7, 0xf4, 0x62, 0x0b, 0xc6, 0xe8, 0x79, 0xe2, 0x61, 0x85, 0xa2, 0x31,
+        0x8d, 0xd9, 0x53, 0xe6, 0x88, 0x8a, 0x23, 0xe7, 0xdc, 0x2b, 0x8b, 0x87,
+        0xa8, 0x53, 0x8d, 0x54, 0x8f, 0x7d, 0x1b, 0xaa, 0xda, 0xf2, 0x0e, 0x6c,
+        0xb8, 0x95, 0x78, 0x24, 0xf7, 0x9a, 0x41, 0x32, 0xb3, 0xbd, 0x22, 0x8f,
+        0xc9, 0xf2, 0xca, 0xf0, 0x36, 0x29, 0xc3, 0xe1, 0x43, 0x9d, 0xce, 0x22,
+        0x5d, 0x98, 0x4c, 0x16, 0x04, 0x5e, 0x24, 0x0e, 0x34, 0xca, 0x3f, 0x40,
+        0xb7, 0xa7, 0x13, 0xdd, 0x63, 0xcf, 0x40, 0x7e, 0xa1, 0xc3, 0x63, 0xd0,
+        0x50, 0xd7, 0xe6, 0x5d, 0x05, 0xfe, 0x3a, 0xda, 0xf6, 0xc4, 0x6e, 0xed,
+        0x79, 0x0a, 0xe0, 0xbe, 0xa0, 0x87, 0xa2, 0x62, 0xe5, 0x84, 0x0f, 0x71,
+        0x46, 0x2c, 0x4f, 0x61, 0x3c, 0x6b, 0x7a, 0x2e, 0x1e, 0x7f, 0xe9, 0x99,
+        0xef, 0x23, 0xaf, 0x86, 0x69, 0x1d, 0xf9, 0x19, 0xe1, 0xf5, 0x35, 0x13,
+        0x8e, 0x9f, 0x00, 0x9e, 0x8f, 0x70, 0x75, 0x51, 0xd1, 0xdb, 0xc1, 0xe9,
+        0x7d, 0x67, 0xb5, 0xcf, 0xe3, 0xa3, 0xf5, 0x23, 0xe3, 0x68, 0x18, 0xb6,
+        0xc2, 0x41, 0x91, 0xd0, 0xf4, 0x3e, 0xa3, 0x24, 0x91, 0x85, 0xc6, 0xe4,
+        0xba, 0xaf, 0x42, 0xf3, 0x9f, 0x74, 0x51, 0xea, 0x98, 0x1c, 0x3b, 0x97,
+        0xe8, 0x16, 0x80, 0x05, 0x67, 0x6e, 0x03, 0xec, 0x2d, 0x69, 0x5d, 0x98,
+        0x62, 0xc5, 0x8e, 0xf7, 0x29, 0xc9, 0x68, 0x5c, 0xfe, 0x33, 0x34, 0x35,
+        0xd4, 0x46, 0x1f, 0x7d, 0x65, 0x83, 0x35, 0xcd, 0x2f, 0xd9, 0xfb, 0x79,
+        0x7e, 0xa0, 0x66, 0x38, 0x01, 0x66, 0x81, 0x71, 0x9a, 0x47, 0xfb, 0xd4,
+        0xd4, 0x1d, 0xfe, 0xdd, 0x6f, 0x7e, 0x1b, 0x4d, 0x0a, 0x74, 0xbf, 0xa1,
+        0x31, 0x7f, 0x60, 0x86, 0xbf, 0x3c, 0x3e, 0xbf, 0xba, 0x3e, 0x87, 0x92,
+        0xde, 0x45, 0x11, 0x3e, 0xd5, 0xe7, 0x4b, 0x31, 0x39, 0x86, 0x95, 0xbc,
+        0x7d, 0xdb, 0xf2, 0x88, 0x0b, 0x9a, 0x74, 0xa5, 0x44, 0xf9, 0x6c, 0xf1,
+        0x47, 0x90, 0x3f, 0x8b, 0xde, 0x5e, 0x68, 0x33, 0x14, 0x2e, 0x87, 0xd1,
+        0x7b, 0x52, 0x00, 0x51, 0x9c, 0x57, 0x26, 0x29, 0xd6, 0x8b, 0x8d, 0x80,
+        0x5b, 0x32, 0x6b, 0xd0, 0x40, 0xf8, 0xee, 0x60, 0x95, 0xc5, 0xb1, 0x9b,
+        0xdf, 0x0a, 0x41, 0x3b, 0x8e, 0x3a, 0x55, 0xdd, 0x4f, 0x05, 0xa3, 0x7c,
+        0xff, 0x6e, 0x56, 0x0e, 0x29, 0xbe, 0x7e, 0xde, 0x9a, 0x4f, 0x23, 0xf3,
+        0x33, 0xb3, 0x98, 0x37, 0xb3, 0x54, 0xbe, 0xcd, 0x8a, 0xac, 0x51, 0xc2,
+        0xf2, 0xd7, 0x24, 0xab, 0xcc, 0xdc, 0x74, 0x7a, 0xdc, 0x90, 0x4a, 0xb5,
+        0x84, 0xea, 0x7a, 0x49, 0xae, 0x17, 0xff, 0xc4, 0xbc, 0x02, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x40,
+        0x1f, 0xa8, 0xac, 0x0d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xa5, 0x1f, 0xf2, 0xac, 0x0d, 0xff, 0xff,
+        0x45, 0x1f, 0xdf, 0x14, 0x1e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0b, 0x0f, 0x68, 0x10, 0xff,
+        0xe0, 0x1f, 0x5e, 0x7c, 0x2e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x70, 0x0f, 0x68, 0x10, 0xff,
+        0x7b, 0x1f, 0xec, 0xe4, 0x3e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xd5, 0x0f, 0x68, 0x10, 0xff,
+        0x16, 0x1f, 0xb5, 0x4c, 0x4f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3b, 0x0f, 0x68, 0x10,
+        0xb0, 0x1f, 0xe3, 0xb4, 0x5f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xa0, 0x0f, 0x68, 0x10,
+        0x4b, 0x1f, 0xde, 0x60, 0x6d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x47, 0x0f, 0xac, 0x0d, 0x4b, 0x1f,
+        0x84, 0xac, 0x0d, 0xff, 0xff, 0x45, 0x1f, 0x6b, 0xc8, 0x7d, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xac,
+        0x0f, 0x68, 0x10, 0xff, 0xff, 0x3f, 0x1f, 0xcb, 0x30, 0x8e, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x12, 0x0f, 0x68, 0x10, 0xff, 0xd9, 0x1f, 0xc7, 0x98, 0x9e, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x77, 0x0f, 0x68, 0x10, 0xff, 0x74, 0x1f, 0x2f, 0x00, 0xaf, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xdc, 0x0f, 0x68, 0x10, 0xff, 0x0f, 0x1f, 0xdb, 0x68, 0xbf, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x42, 0x0f, 0x68, 0x10, 0xa9, 0x1f, 0x79, 0xd0, 0xcf, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xa7, 0x0f, 0x68, 0x10, 0x44, 0x1f, 0x86, 0x7c, 0xdd, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x4e,
+        0x0f, 0xac, 0x0d, 0x44, 0x1f, 0xdc, 0xac, 0x0d, 0xff, 0xff, 0x45, 0x1f,
+        0x84, 0xe4, 0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xb3, 0x0f, 0x68, 0x10, 0xff, 0xff, 0x03, 0x50,
+        0xe0, 0xbe, 0xa0, 0x87, 0xa2, 0x58, 0xf2, 0xe9, 0xcd, 0xaf, 0x01, 0x00,
+        0x00, 0x0f, 0x4c, 0xfe, 0x1d, 0x1f, 0x79, 0x4c, 0xfe, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x19,
+        0x0f, 0x68, 0x10, 0xff, 0xd2, 0x8f, 0x90, 0xf0, 0x36, 0x29, 0xc3, 0xe1,
+        0x43, 0x9d, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f, 0x01, 0x55, 0x45,
+        0x1c, 0x1e, 0xa0, 0x67, 0x75, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f,
+        0x39, 0x74, 0xdd, 0xce, 0x8e, 0x03, 0xcc, 0x81, 0x1c, 0x70, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xf7, 0x8f, 0xc8, 0x6c, 0x4b, 0xb7, 0x1a, 0x2b, 0x01, 0x23, 0x1c,
+        0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xf7, 0x1f, 0x0b, 0x70, 0x62, 0xff, 0xff, 0x4c,
+        0x1f, 0xde, 0x70, 0x62, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0x9e, 0x1f, 0x66, 0xac, 0x0d, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xa5,
+        0x1f, 0x3c, 0xac, 0x0d, 0xff, 0xff, 0x45, 0x8f, 0x27, 0x67, 0xb5, 0xcf,
+        0xe3, 0xa3, 0xf5, 0x23, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f, 0x68,
+        0xb3, 0xbd, 0x22, 0x8f, 0xc9, 0xf2, 0xca, 0x1c, 0x70, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xf7, 0x8f, 0x9b, 0x36, 0x56, 0xf1, 0x41, 0xb1, 0x8e, 0x5b, 0x1c, 0x70,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xf7, 0x8f, 0x2c, 0x8e, 0xa0, 0xf5, 0xe6, 0x8f, 0x47,
+        0x63, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f, 0xcc, 0x31, 0xd9, 0xd7,
+        0x39, 0x05, 0xd3, 0x92, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f, 0x6d,
+        0xb3, 0x54, 0xbe, 0xcd, 0x8a, 0xac, 0x51, 0x1c, 0x70, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xf7, 0x1f, 0xe5, 0x70, 0x62, 0xff, 0xff, 0x4c, 0x1f, 0x7d, 0x70, 0x62,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x9e, 0x1f, 0x2a, 0xac, 0x0d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xa5, 0x1f, 0x70, 0xac, 0x0d,
+        0xff, 0xff, 0x45, 0x8f, 0xe2, 0x95, 0x78, 0x24, 0xf7, 0x9a, 0x41, 0x32,
+        0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0x92, 0x50, 0xe2, 0x31, 0xfa, 0xe6, 0x78,
+        0x56, 0xf7, 0xfe, 0x05, 0x8c, 0x00, 0x00, 0x00, 0x3f, 0x32, 0xb5, 0x76,
+        0xb4, 0x5f, 0x4a, 0x8f, 0xc0, 0x61, 0xe3, 0x02, 0x4e, 0x53, 0x89, 0xc1,
+        0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x1f, 0xb8, 0x68, 0x10, 0x51, 0x1f,
+        0x9a, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x8f, 0x77, 0x05, 0xc6, 0xaf,
+        0x4a, 0x39, 0x81, 0x96, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0x8f, 0xc0,
+        0x4f, 0x23, 0xf3, 0x33, 0xb3, 0x98, 0x37, 0x1c, 0x70, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xf7, 0x8f, 0x87, 0x6f, 0x7e, 0x1b, 0x4d, 0x0a, 0x74, 0xbf, 0x1c, 0x70,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x6d, 0x50, 0xef,
+        0x1d, 0x3b, 0x12, 0xf8, 0xb8, 0x81, 0x3a, 0xed, 0x00, 0x00, 0x00, 0x00,
+        0xd2, 0xb4, 0xae, 0x2f,
+};
+
+static const CEfiU8 test_lz4_independent[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x68, 0x40, 0x70, 0x11, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x61, 0x36, 0x04, 0x00, 0x00, 0xff, 0xff, 0xff, 0xb0, 0x2f,
+        0xbb, 0xc7, 0x53, 0x07, 0x51, 0xfa, 0x31, 0xe9, 0x74, 0x15, 0x0c, 0xfd,
+        0xf9, 0x3c, 0x68, 0x28, 0x5d, 0xda, 0x94, 0x69, 0xab, 0x96, 0xeb, 0x18,
+        0xcb, 0xd4, 0xea, 0xa1, 0xbf, 0x41, 0x66, 0x4d, 0xa6, 0x22, 0xd0, 0x1e,
+        0x19, 0x8c, 0xd7, 0xa8, 0x6a, 0x51, 0x0f, 0xc9, 0x79, 0x5f, 0xbd, 0xe1,
+        0xaa, 0x6f, 0x2d, 0xa6, 0x1d, 0x04, 0x85, 0x34, 0x43, 0xba, 0xea, 0x19,
+        0x13, 0xea, 0xa3, 0x8b, 0xba, 0x77, 0x9e, 0x80, 0xd0, 0xde, 0x42, 0xd5,
+        0xcd, 0x00, 0x9f, 0x74, 0xf2, 0xd6, 0x55, 0xc5, 0x13, 0x02, 0xff, 0x09,
+        0xfd, 0xad, 0x5f, 0xf6, 0x74, 0x22, 0xcb, 0xc5, 0xd5, 0xca, 0x2c, 0xca,
+        0x04, 0x6f, 0xf9, 0x86, 0x0c, 0x76, 0x82, 0x51, 0xbf, 0x3e, 0xd1, 0x6a,
+        0x90, 0x92, 0x1a, 0xbd, 0xfb, 0x4e, 0x60, 0x5d, 0x83, 0xa8, 0xa1, 0x84,
+        0x49, 0x41, 0x62, 0xf9, 0x04, 0x60, 0x85, 0xd4, 0x44, 0xb8, 0x89, 0xd6,
+        0x91, 0xc1, 0x8c, 0xb5, 0x72, 0x4c, 0xd3, 0x44, 0xb2, 0x1e, 0x62, 0x76,
+        0xcf, 0x26, 0x7b, 0xf5, 0x0c, 0x4e, 0x57, 0xe4, 0xdb, 0xa8, 0xfb, 0xf9,
+        0x9a, 0xdd, 0xdc, 0xd4, 0x02, 0xe5, 0xbc, 0xc1, 0x0c, 0x40, 0x0b, 0x11,
+        0x5b, 0xf9, 0x19, 0x9a, 0x11, 0x04, 0x2e, 0x4a, 0xf4, 0x61, 0xc8, 0xcb,
+        0xb7, 0x66, 0x95, 0x84, 0xbb, 0x02, 0x26, 0xb9, 0xb1, 0x3e, 0xe2, 0x1d,
+        0x97, 0x5a, 0x36, 0x6c, 0x04, 0x6b, 0x3f, 0x5c, 0x24, 0xbc, 0x35, 0x5b,
+        0xd5, 0x80, 0x60, 0x41, 0xf1, 0x46, 0xa9, 0x7a, 0x36, 0x17, 0x9f, 0x09,
+        0x9d, 0x2e, 0x17, 0x12, 0x15, 0xaa, 0x0b, 0x58, 0x6a, 0x83, 0x2c, 0x56,
+        0xfc, 0xd2, 0x6a, 0x1e, 0x07, 0x70, 0x2a, 0x6f, 0x03, 0x4b, 0x3b, 0xeb,
+        0x5c, 0x50, 0xa4, 0xdf, 0xe8, 0x0f, 0xf1, 0x61, 0x63, 0x32, 0x02, 0x0b,
+        0x52, 0x33, 0x49, 0x66, 0x14, 0x86, 0xda, 0x0a, 0x51, 0x46, 0x9c, 0x36,
+        0x12, 0x90, 0xab, 0x41, 0x4f, 0x40, 0xe7, 0x5f, 0x5d, 0x87, 0x26, 0x5a,
+        0xbd, 0x6e, 0xa5, 0x85, 0x7e, 0x42, 0x35, 0xd3, 0x85, 0xd5, 0x7f, 0xc5,
+        0x41, 0x8e, 0x0c, 0x66, 0xb0, 0x67, 0xac, 0x6a, 0x6c, 0x50, 0x43, 0xc9,
+        0x6b, 0x27, 0x1b, 0x5d, 0x8c, 0x44, 0xe1, 0x72, 0x73, 0xea, 0x09, 0x3c,
+        0xd0, 0xf3, 0x55, 0x20, 0x61, 0x7b, 0x1f, 0x22, 0x06, 0xfc, 0xf2, 0x64,
+        0xce, 0xa0, 0xdc, 0x0b, 0xef, 0x35, 0x72, 0xda, 0xc7, 0x1a, 0x96, 0x48,
+        0xad, 0xe9, 0x8f, 0x13, 0x5e, 0xfd, 0x21, 0xca, 0x66, 0xa9, 0x87, 0xc0,
+        0x30, 0xb6, 0xa3, 0x6d, 0xae, 0x0c, 0xc2, 0x18, 0x91, 0x4d, 0xd6, 0xe7,
+        0x31, 0x60, 0x80, 0xbc, 0xfc, 0xbd, 0xa2, 0x9b, 0xd4, 0xd8, 0x38, 0x89,
+        0x4c, 0x19, 0x64, 0x88, 0xd8, 0x5c, 0x69, 0x98, 0xfd, 0x03, 0x37, 0xdb,
+        0x2c, 0xca, 0x1e, 0x6c, 0xf2, 0xb7, 0x92, 0xbe, 0x8c, 0x71, 0x0e, 0x69,
+        0x45, 0x17, 0xca, 0x7e, 0x7c, 0xfa, 0x22, 0x40, 0xf7, 0x80, 0x3b, 0x60,
+        0x7f, 0x23, 0x43, 0xb5, 0xd5, 0xaf, 0x4e, 0x50, 0xea, 0xcc, 0xa5, 0x1e,
+        0xa8, 0x95, 0x3c, 0x85, 0xc7, 0xa2, 0x76, 0x63, 0x00, 0x95, 0xa6, 0x4e,
+        0x83, 0x22, 0x1e, 0x48, 0x02, 0xd0, 0x7e, 0x56, 0x84, 0x28, 0x2d, 0x96,
+        0x84, 0xc9, 0xbe, 0xcf, 0x00, 0xb1, 0xed, 0x9b, 0xf0, 0xde, 0x46, 0x0c,
+        0xa8, 0xa7, 0x82, 0xaa, 0x5a, 0xda, 0xd9, 0x2a, 0x18, 0xcb, 0x31, 0xde,
+        0xb4, 0x10, 0xbb, 0x9c, 0x4a, 0x40, 0xd7, 0xa9, 0x45, 0xfd, 0xb9, 0x0a,
+        0xdd, 0x35, 0xb3, 0x9a, 0xe6, 0x08, 0x99, 0xf5, 0x24, 0xf0, 0x5e, 0x15,
+        0x6e, 0xd4, 0x4f, 0x00, 0x63, 0x1d, 0x5b, 0x7c, 0x75, 0xe4, 0x0b, 0x1a,
+        0xde, 0xe7, 0xfb, 0xa5, 0xa2, 0xf9, 0x06, 0x71, 0xcf, 0x7e, 0x43, 0x94,
+        0x5e, 0x2d, 0x33, 0x62, 0xaf, 0x0c, 0x42, 0x46, 0x60, 0xea, 0x3e, 0x16,
+        0x0e, 0x6a, 0xd9, 0x54, 0x64, 0x8e, 0xf3, 0xe5, 0xd8, 0x26, 0xce, 0x6f,
+        0xfc, 0x83, 0xd9, 0xeb, 0x1f, 0x51, 0xdb, 0xe4, 0x8b, 0x09, 0x7f, 0x6f,
+        0xda, 0x21, 0x08, 0x64, 0x49, 0x45, 0xb9, 0xc0, 0xc2, 0xfa, 0x43, 0xb7,
+        0x92, 0x47, 0x14, 0xbf, 0x6e, 0xb3, 0x74, 0x4e, 0x43, 0x70, 0x06, 0xe8,
+        0x2e, 0xf6, 0x30, 0xbc, 0x7a, 0x88, 0x5a, 0x36, 0x93, 0x09, 0xb7, 0xf5,
+        0x94, 0xb5, 0x38, 0xa6, 0x4f, 0xbb, 0xa0, 0x7d, 0xf6, 0xf9, 0x74, 0xa5,
+        0x8e, 0x97, 0xe2, 0x5b, 0xe1, 0x87, 0x7a, 0x78, 0x76, 0xd6, 0x69, 0xfc,
+        0x07, 0x37, 0xec, 0x0b, 0x37, 0xed, 0xed, 0x5c, 0xad, 0x27, 0x14, 0xf1,
+        0x6f, 0x1d, 0xfb, 0x62, 0x95, 0x70, 0x91, 0x35, 0x65, 0xd3, 0x93, 0x68,
+        0x2d, 0x9f, 0x82, 0xf2, 0x50, 0x3b, 0x57, 0xc4, 0xfb, 0xed, 0x63, 0x91,
+        0xfd, 0x10, 0x4c, 0x0e, 0x0c, 0x6f, 0xcc, 0xc0, 0xe4, 0x6a, 0xef, 0x27,
+        0x3c, 0xb8, 0xcc, 0xff, 0x06, 0x8c, 0x31, 0x1e, 0x71, 0x50, 0xd2, 0xd3,
+        0x12, 0x23, 0x42, 0x9e, 0xc1, 0xfa, 0x1d, 0x72, 0x76, 0x25, 0x09, 0xd9,
+        0x40, 0xda, 0xc3, 0x59, 0x39, 0xe4, 0x36, 0x57, 0xaf, 0xe1, 0x64, 0xb5,
+        0xb9, 0xc8, 0x77, 0x75, 0xbc, 0x02, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x40, 0x1f, 0x2e, 0xac, 0x0d,
+        0x52, 0x0f, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x1f, 0x47, 0x14, 0x1e,
+        0x52, 0x0f, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x1f, 0x1f, 0x7c, 0x2e,
+        0x52, 0x0f, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x1f, 0x30, 0xe4, 0x3e,
+        0x52, 0x0f, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x1f, 0x6c, 0x4c, 0x4f,
+        0x52, 0x0f, 0x68, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x99, 0x1f, 0x90, 0xb4, 0x5f,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xa0, 0x0f, 0xbc, 0x02, 0x4b, 0x1e, 0xf5, 0xb4, 0x5f,
+        0x0f, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xec, 0x1e, 0xfc, 0xb4, 0x5f, 0x0f,
+        0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xec, 0x1e, 0x04, 0xb4, 0x5f, 0x0f, 0x1c,
+        0x70, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xec, 0x1e, 0xed, 0xb4, 0x5f, 0x0f, 0x1c, 0x70,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xec, 0x1e, 0x1b, 0xb4, 0x5f, 0x0f, 0x1c, 0x70, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xec, 0x1e, 0xe3, 0xb4, 0x5f, 0x0f, 0x1c, 0x70, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xec, 0x1e, 0x05, 0xd0, 0xcf, 0x0f, 0x1c, 0x70, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xec, 0x1e, 0x80, 0xd0, 0xcf, 0x0f, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xec,
+        0x1e, 0xc9, 0xd0, 0xcf, 0x0f, 0x1c, 0x70, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xb7, 0x50,
+        0xa6, 0x4e, 0x83, 0x22, 0x1e, 0xe1, 0x02, 0x00, 0x00, 0xff, 0xff, 0xff,
+        0xaf, 0x48, 0x02, 0xd0, 0x7e, 0x56, 0x84, 0x28, 0x2d, 0x96, 0x84, 0xc9,
+        0xbe, 0xcf, 0x00, 0xb1, 0xed, 0x9b, 0xf0, 0xde, 0x46, 0x0c, 0xa8, 0xa7,
+        0x82, 0xaa, 0x5a, 0xda, 0xd9, 0x2a, 0x18, 0xcb, 0x31, 0xde, 0xb4, 0x10,
+        0xbb, 0x9c, 0x4a, 0x40, 0xd7, 0xa9, 0x45, 0xfd, 0xb9, 0x0a, 0xdd, 0x35,
+        0xb3, 0xc0, 0xe6, 0x08, 0x99, 0xf5, 0x24, 0xf0, 0x5e, 0x15, 0x6e, 0xd4,
+        0x4f, 0x00, 0x63, 0x1d, 0x5b, 0x7c, 0x75, 0xe4, 0x0b, 0x1a, 0xde, 0xe7,
+        0xfb, 0xa5, 0xa2, 0xf9, 0x06, 0x71, 0xcf, 0x7e, 0x43, 0x94, 0x5e, 0x2d,
+        0x33, 0x62, 0xaf, 0x0c, 0x42, 0x46, 0x60, 0xea, 0x3e, 0x16, 0x0e, 0x6a,
+        0xd9, 0x54, 0x64, 0x8e, 0xf3, 0xe5, 0xd8, 0x26, 0xce, 0x6f, 0xfc, 0x83,
+        0xd9, 0xeb, 0x1f, 0x51, 0xdb, 0xe4, 0x8b, 0x09, 0x7f, 0x6f, 0xda, 0x21,
+        0x08, 0x64, 0x49, 0x45, 0xb9, 0xc0, 0xc2, 0xfa, 0x43, 0xb7, 0x92, 0x47,
+        0x14, 0xbf, 0x6e, 0xb3, 0x74, 0x4e, 0x43, 0x70, 0x06, 0xe8, 0x2e, 0xf6,
+        0x30, 0xbc, 0x7a, 0x88, 0x5a, 0x36, 0x93, 0x09, 0xb7, 0xf5, 0x94, 0xb5,
+        0x38, 0xa6, 0x4f, 0xbb, 0xa0, 0x7d, 0xf6, 0xf9, 0x74, 0xa5, 0x8e, 0x97,
+        0xe2, 0x5b, 0xe1, 0x87, 0x7a, 0x78, 0x76, 0xd6, 0x69, 0xfc, 0x07, 0x37,
+        0xec, 0x0b, 0x37, 0xed, 0xed, 0x5c, 0xad, 0x27, 0x14, 0xf1, 0x6f, 0x1d,
+        0xfb, 0x62, 0x95, 0x70, 0x91, 0x35, 0x65, 0xd3, 0x93, 0x68, 0x2d, 0x9f,
+        0x82, 0xf2, 0x50, 0x3b, 0x57, 0xc4, 0xfb, 0xed, 0x63, 0x91, 0xfd, 0x10,
+        0x4c, 0x0e, 0x0c, 0x6f, 0xcc, 0xc0, 0xe4, 0x6a, 0xef, 0x27, 0x3c, 0xb8,
+        0xcc, 0xff, 0x06, 0x8c, 0x31, 0x1e, 0x71, 0x50, 0xd2, 0xd3, 0x12, 0x23,
+        0x42, 0x9e, 0xc1, 0xfa, 0x1d, 0x72, 0x76, 0x25, 0x09, 0xd9, 0x40, 0xda,
+        0xc3, 0x59, 0x39, 0xe4, 0x36, 0x57, 0xaf, 0xe1, 0x64, 0xb5, 0xb9, 0xc8,
+        0x77, 0x75, 0xbb, 0xc7, 0x53, 0x07, 0x51, 0xfa, 0x31, 0xe9, 0x74, 0x15,
+        0x0c, 0xfd, 0xf9, 0x3c, 0x68, 0x28, 0x5d, 0xda, 0x94, 0x69, 0xab, 0x96,
+        0xeb, 0x18, 0xcb, 0xd4, 0xea, 0xa1, 0xbf, 0x41, 0x66, 0x4d, 0xa6, 0x22,
+        0xd0, 0x1e, 0x19, 0x8c, 0xd7, 0xa8, 0x6a, 0x51, 0x0f, 0xc9, 0x79, 0x5f,
+        0xbd, 0xe1, 0xaa, 0x6f, 0x2d, 0xa6, 0x1d, 0x04, 0x85, 0x34, 0x43, 0xba,
+        0xea, 0x19, 0x13, 0xea, 0xa3, 0x8b, 0xba, 0x77, 0x9e, 0x80, 0xd0, 0xde,
+        0x42, 0xd5, 0xcd, 0x00, 0x9f, 0x74, 0xf2, 0xd6, 0x55, 0xc5, 0x13, 0x02,
+        0xff, 0x09, 0xfd, 0xad, 0x5f, 0xf6, 0x74, 0x22, 0xcb, 0xc5, 0xd5, 0xca,
+        0x2c, 0xca, 0x04, 0x6f, 0xf9, 0x86, 0x0c, 0x76, 0x82, 0x51, 0xbf, 0x3e,
+        0xd1, 0x6a, 0x90, 0x92, 0x1a, 0xbd, 0xfb, 0x4e, 0x60, 0x5d, 0x83, 0xa8,
+        0xa1, 0x84, 0x49, 0x41, 0x62, 0xf9, 0x04, 0x60, 0x85, 0xd4, 0x44, 0xb8,
+        0x89, 0xd6, 0x91, 0xc1, 0x8c, 0xb5, 0x72, 0x4c, 0xd3, 0x44, 0xb2, 0x1e,
+        0x62, 0x76, 0xcf, 0x26, 0x7b, 0xf5, 0x0c, 0x4e, 0x57, 0xe4, 0xdb, 0xa8,
+        0xfb, 0xf9, 0x9a, 0xdd, 0xdc, 0xd4, 0x02, 0xe5, 0xbc, 0xc1, 0x0c, 0x40,
+        0x0b, 0x11, 0x5b, 0xf9, 0x19, 0x9a, 0x11, 0x04, 0x2e, 0x4a, 0xf4, 0x61,
+        0xc8, 0xcb, 0xb7, 0x66, 0x95, 0x84, 0xbb, 0x02, 0x26, 0xb9, 0xb1, 0x3e,
+        0xe2, 0x1d, 0x97, 0x5a, 0x36, 0x6c, 0x04, 0x6b, 0x3f, 0x5c, 0x24, 0xbc,
+        0x35, 0x5b, 0xd5, 0x80, 0x60, 0x41, 0xf1, 0x46, 0xa9, 0x7a, 0x36, 0x17,
+        0x9f, 0x09, 0x9d, 0x2e, 0x17, 0x12, 0x15, 0xaa, 0x0b, 0x58, 0x6a, 0x83,
+        0x2c, 0x56, 0xfc, 0xd2, 0x6a, 0x1e, 0x07, 0x70, 0x2a, 0x6f, 0x03, 0x4b,
+        0x3b, 0xeb, 0x5c, 0x50, 0xa4, 0xdf, 0xe8, 0x0f, 0xf1, 0x61, 0x63, 0x32,
+        0x02, 0x0b, 0x52, 0x33, 0x49, 0x66, 0x14, 0x86, 0xda, 0x0a, 0x51, 0x46,
+        0x9c, 0x36, 0x12, 0x90, 0xab, 0x41, 0x4f, 0x40, 0xe7, 0x5f, 0x5d, 0x87,
+        0x26, 0x5a, 0xbd, 0x6e, 0xa5, 0x85, 0x7e, 0x42, 0x35, 0xd3, 0x85, 0xd5,
+        0x7f, 0xc5, 0x41, 0x8e, 0x0c, 0x66, 0xb0, 0x67, 0xac, 0x6a, 0x6c, 0x50,
+        0x43, 0xc9, 0x6b, 0x27, 0x1b, 0x5d, 0x8c, 0x44, 0xe1, 0x72, 0x73, 0xea,
+        0x09, 0x3c, 0xd0, 0xf3, 0x55, 0x20, 0x61, 0x7b, 0x1f, 0x22, 0x06, 0xfc,
+        0xf2, 0x64, 0xce, 0xa0, 0xdc, 0x0b, 0xef, 0x35, 0x72, 0xda, 0xc7, 0x1a,
+        0x96, 0x48, 0xad, 0xe9, 0x8f, 0x13, 0x5e, 0xfd, 0x21, 0xca, 0x66, 0xa9,
+        0x87, 0xc0, 0x30, 0xb6, 0xa3, 0x6d, 0xae, 0x0c, 0xc2, 0x18, 0x91, 0x4d,
+        0xd6, 0xe7, 0x31, 0x60, 0x80, 0xbc, 0xfc, 0xbd, 0xa2, 0x9b, 0xd4, 0xd8,
+        0x38, 0x89, 0x4c, 0x19, 0x64, 0x88, 0xd8, 0x5c, 0x69, 0x98, 0xfd, 0x03,
+        0x37, 0xdb, 0x2c, 0xca, 0x1e, 0x6c, 0xf2, 0xb7, 0x92, 0xbe, 0x8c, 0x71,
+        0x0e, 0x69, 0x45, 0x17, 0xca, 0x7e, 0x7c, 0xfa, 0x22, 0x40, 0xf7, 0x80,
+        0x3b, 0x60, 0x7f, 0x23, 0x43, 0xb5, 0xd5, 0xaf, 0x4e, 0x50, 0xea, 0xcc,
+        0xa5, 0x1e, 0xa8, 0x95, 0x3c, 0x85, 0xc7, 0xa2, 0x76, 0x63, 0x00, 0x95,
+        0xa6, 0x4e, 0x83, 0x22, 0x1e, 0xbc, 0x02, 0x1d, 0x1f, 0x9a, 0xbc, 0x02,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x40, 0x1f, 0x6d, 0xbc, 0x02, 0xff, 0x25, 0x50, 0x64, 0xb5, 0xb9,
+        0xc8, 0x77, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const CEfiU8 test_lz4_legacy[] = {
+        0x02, 0x21, 0x4c, 0x18, 0x6f, 0x04, 0x00, 0x00, 0xff, 0xff, 0xff, 0xb0,
+        0x2f, 0xbb, 0xc7, 0x53, 0x07, 0x51, 0xfa, 0x31, 0xe9, 0x74, 0x15, 0x0c,
+        0xfd, 0xf9, 0x3c, 0x68, 0x28, 0x5d, 0xda, 0x94, 0x69, 0xab, 0x96, 0xeb,
+        0x18, 0xcb, 0xd4, 0xea, 0xa1, 0xbf, 0x41, 0x66, 0x4d, 0xa6, 0x22, 0xd0,
+        0x1e, 0x19, 0x8c, 0xd7, 0xa8, 0x6a, 0x51, 0x0f, 0xc9, 0x79, 0x5f, 0xbd,
+        0xe1, 0xaa, 0x6f, 0x2d, 0xa6, 0x1d, 0x04, 0x85, 0x34, 0x43, 0xba, 0xea,
+        0x19, 0x13, 0xea, 0xa3, 0x8b, 0xba, 0x77, 0x9e, 0x80, 0xd0, 0xde, 0x42,
+        0xd5, 0xcd, 0x00, 0x9f, 0x74, 0xf2, 0xd6, 0x55, 0xc5, 0x13, 0x02, 0xff,
+        0x09, 0xfd, 0xad, 0x5f, 0xf6, 0x74, 0x22, 0xcb, 0xc5, 0xd5, 0xca, 0x2c,
+        0xca, 0x04, 0x6f, 0xf9, 0x86, 0x0c, 0x76, 0x82, 0x51, 0xbf, 0x3e, 0xd1,
+        0x6a, 0x90, 0x92, 0x1a, 0xbd, 0xfb, 0x4e, 0x60, 0x5d, 0x83, 0xa8, 0xa1,
+        0x84, 0x49, 0x41, 0x62, 0xf9, 0x04, 0x60, 0x85, 0xd4, 0x44, 0xb8, 0x89,
+        0xd6, 0x91, 0xc1, 0x8c, 0xb5, 0x72, 0x4c, 0xd3, 0x44, 0xb2, 0x1e, 0x62,
+        0x76, 0xcf, 0x26, 0x7b, 0xf5, 0x0c, 0x4e, 0x57, 0xe4, 0xdb, 0xa8, 0xfb,
+        0xf9, 0x9a, 0xdd, 0xdc, 0xd4, 0x02, 0xe5, 0xbc, 0xc1, 0x0c, 0x40, 0x0b,
+        0x11, 0x5b, 0xf9, 0x19, 0x9a, 0x11, 0x04, 0x2e, 0x4a, 0xf4, 0x61, 0xc8,
+        0xcb, 0xb7, 0x66, 0x95, 0x84, 0xbb, 0x02, 0x26, 0xb9, 0xb1, 0x3e, 0xe2,
+        0x1d, 0x97, 0x5a, 0x36, 0x6c, 0x04, 0x6b, 0x3f, 0x5c, 0x24, 0xbc, 0x35,
+        0x5b, 0xd5, 0x80, 0x60, 0x41, 0xf1, 0x46, 0xa9, 0x7a, 0x36, 0x17, 0x9f,
+        0x09, 0x9d, 0x2e, 0x17, 0x12, 0x15, 0xaa, 0x0b, 0x58, 0x6a, 0x83, 0x2c,
+        0x56, 0xfc, 0xd2, 0x6a, 0x1e, 0x07, 0x70, 0x2a, 0x6f, 0x03, 0x4b, 0x3b,
+        0xeb, 0x5c, 0x50, 0xa4, 0xdf, 0xe8, 0x0f, 0xf1, 0x61, 0x63, 0x32, 0x02,
+        0x0b, 0x52, 0x33, 0x49, 0x66, 0x14, 0x86, 0xda, 0x0a, 0x51, 0x46, 0x9c,
+        0x36, 0x12, 0x90, 0xab, 0x41, 0x4f, 0x40, 0xe7, 0x5f, 0x5d, 0x87, 0x26,
+        0x5a, 0xbd, 0x6e, 0xa5, 0x85, 0x7e, 0x42, 0x35, 0xd3, 0x85, 0xd5, 0x7f,
+        0xc5, 0x41, 0x8e, 0x0c, 0x66, 0xb0, 0x67, 0xac, 0x6a, 0x6c, 0x50, 0x43,
+        0xc9, 0x6b, 0x27, 0x1b, 0x5d, 0x8c, 0x44, 0xe1, 0x72, 0x73, 0xea, 0x09,
+        0x3c, 0xd0, 0xf3, 0x55, 0x20, 0x61, 0x7b, 0x1f, 0x22, 0x06, 0xfc, 0xf2,
+        0x64, 0xce, 0xa0, 0xdc, 0x0b, 0xef, 0x35, 0x72, 0xda, 0xc7, 0x1a, 0x96,
+        0x48, 0xad, 0xe9, 0x8f, 0x13, 0x5e, 0xfd, 0x21, 0xca, 0x66, 0xa9, 0x87,
+        0xc0, 0x30, 0xb6, 0xa3, 0x6d, 0xae, 0x0c, 0xc2, 0x18, 0x91, 0x4d, 0xd6,
+        0xe7, 0x31, 0x60, 0x80, 0xbc, 0xfc, 0xbd, 0xa2, 0x9b, 0xd4, 0xd8, 0x38,
+        0x89, 0x4c, 0x19, 0x64, 0x88, 0xd8, 0x5c, 0x69, 0x98, 0xfd, 0x03, 0x37,
+        0xdb, 0x2c, 0xca, 0x1e, 0x6c, 0xf2, 0xb7, 0x92, 0xbe, 0x8c, 0x71, 0x0e,
+        0x69, 0x45, 0x17, 0xca, 0x7e, 0x7c, 0xfa, 0x22, 0x40, 0xf7, 0x80, 0x3b,
+        0x60, 0x7f, 0x23, 0x43, 0xb5, 0xd5, 0xaf, 0x4e, 0x50, 0xea, 0xcc, 0xa5,
+        0x1e, 0xa8, 0x95, 0x3c, 0x85, 0xc7, 0xa2, 0x76, 0x63, 0x00, 0x95, 0xa6,
+        0x4e, 0x83, 0x22, 0x1e, 0x48, 0x02, 0xd0, 0x7e, 0x56, 0x84, 0x28, 0x2d,
+        0x96, 0x84, 0xc9, 0xbe, 0xcf, 0x00, 0xb1, 0xed, 0x9b, 0xf0, 0xde, 0x46,
+        0x0c, 0xa8, 0xa7, 0x82, 0xaa, 0x5a, 0xda, 0xd9, 0x2a, 0x18, 0xcb, 0x31,
+        0xde, 0xb4, 0x10, 0xbb, 0x9c, 0x4a, 0x40, 0xd7, 0xa9, 0x45, 0xfd, 0xb9,
+        0x0a, 0xdd, 0x35, 0xb3, 0x9a, 0xe6, 0x08, 0x99, 0xf5, 0x24, 0xf0, 0x5e,
+        0x15, 0x6e, 0xd4, 0x4f, 0x00, 0x63, 0x1d, 0x5b, 0x7c, 0x75, 0xe4, 0x0b,
+        0x1a, 0xde, 0xe7, 0xfb, 0xa5, 0xa2, 0xf9, 0x06, 0x71, 0xcf, 0x7e, 0x43,
+        0x94, 0x5e, 0x2d, 0x33, 0x62, 0xaf, 0x0c, 0x42, 0x46, 0x60, 0xea, 0x3e,
+        0x16, 0x0e, 0x6a, 0xd9, 0x54, 0x64, 0x8e, 0xf3, 0xe5, 0xd8, 0x26, 0xce,
+        0x6f, 0xfc, 0x83, 0xd9, 0xeb, 0x1f, 0x51, 0xdb, 0xe4, 0x8b, 0x09, 0x7f,
+        0x6f, 0xda, 0x21, 0x08, 0x64, 0x49, 0x45, 0xb9, 0xc0, 0xc2, 0xfa, 0x43,
+        0xb7, 0x92, 0x47, 0x14, 0xbf, 0x6e, 0xb3, 0x74, 0x4e, 0x43, 0x70, 0x06,
+        0xe8, 0x2e, 0xf6, 0x30, 0xbc, 0x7a, 0x88, 0x5a, 0x36, 0x93, 0x09, 0xb7,
+        0xf5, 0x94, 0xb5, 0x38, 0xa6, 0x4f, 0xbb, 0xa0, 0x7d, 0xf6, 0xf9, 0x74,
+        0xa5, 0x8e, 0x97, 0xe2, 0x5b, 0xe1, 0x87, 0x7a, 0x78, 0x76, 0xd6, 0x69,
+        0xfc, 0x07, 0x37, 0xec, 0x0b, 0x37, 0xed, 0xed, 0x5c, 0xad, 0x27, 0x14,
+        0xf1, 0x6f, 0x1d, 0xfb, 0x62, 0x95, 0x70, 0x91, 0x35, 0x65, 0xd3, 0x93,
+        0x68, 0x2d, 0x9f, 0x82, 0xf2, 0x50, 0x3b, 0x57, 0xc4, 0xfb, 0xed, 0x63,
+        0x91, 0xfd, 0x10, 0x4c, 0x0e, 0x0c, 0x6f, 0xcc, 0xc0, 0xe4, 0x6a, 0xef,
+        0x27, 0x3c, 0xb8, 0xcc, 0xff, 0x06, 0x8c, 0x31, 0x1e, 0x71, 0x50, 0xd2,
+        0xd3, 0x12, 0x23, 0x42, 0x9e, 0xc1, 0xfa, 0x1d, 0x72, 0x76, 0x25, 0x09,
+        0xd9, 0x40, 0xda, 0xc3, 0x59, 0x39, 0xe4, 0x36, 0x57, 0xaf, 0xe1, 0x64,
+        0xb5, 0xb9, 0xc8, 0x77, 0x75, 0xbc, 0x02, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x40, 0x1f, 0x2e, 0xac,
+        0x0d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xa5, 0x1f, 0x74, 0xac, 0x0d, 0xff, 0xff, 0x45, 0x1f, 0x47,
+        0x14, 0x1e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0x0b, 0x0f, 0x68, 0x10, 0xff, 0xe0, 0x1f, 0x1f,
+        0x7c, 0x2e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0x70, 0x0f, 0x68, 0x10, 0xff, 0x7b, 0x1f, 0x30,
+        0xe4, 0x3e, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xd5, 0x0f, 0x68, 0x10, 0xff, 0x16, 0x1f, 0x6c,
+        0x4c, 0x4f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0x3b, 0x0f, 0x68, 0x10, 0xb0, 0x1f, 0x90,
+        0xb4, 0x5f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xa0, 0x0f, 0x68, 0x10, 0x4b, 0x1f, 0xf5,
+        0x60, 0x6d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0x47, 0x0f, 0xac, 0x0d, 0x4b, 0x1f, 0xaf, 0xac, 0x0d,
+        0xff, 0xff, 0x45, 0x1f, 0xfc, 0xc8, 0x7d, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xac, 0x0f, 0x68, 0x10,
+        0xff, 0xff, 0x3f, 0x1f, 0x04, 0x30, 0x8e, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x12, 0x0f, 0x68,
+        0x10, 0xff, 0xd9, 0x1f, 0xed, 0x98, 0x9e, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x77, 0x0f, 0x68,
+        0x10, 0xff, 0x74, 0x1f, 0x1b, 0x00, 0xaf, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xdc, 0x0f, 0x68,
+        0x10, 0xff, 0x0f, 0x1f, 0xe3, 0x68, 0xbf, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x42, 0x0f,
+        0x68, 0x10, 0xa9, 0x1f, 0x05, 0xd0, 0xcf, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xa7, 0x0f,
+        0x68, 0x10, 0x44, 0x1f, 0x80, 0x7c, 0xdd, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x4e, 0x0f, 0xac, 0x0d,
+        0x44, 0x1f, 0xda, 0xac, 0x0d, 0xff, 0xff, 0x45, 0x1f, 0xc9, 0xe4, 0xed,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xb3, 0x0f, 0x68, 0x10, 0xff, 0xff, 0x38, 0x1f, 0xc0, 0x4c, 0xfe,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0x19, 0x0f, 0x68, 0x10, 0xff, 0xd2, 0x8f, 0x6d, 0xdb, 0x2c,
+        0xca, 0x1e, 0x6c, 0xf2, 0xb7, 0x1c, 0x70, 0xff, 0x1e, 0x50, 0x64, 0xb5,
+        0xb9, 0xc8, 0x77,
+};
+
+static const CEfiU8 test_lz4_empty[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x00, 0x00, 0x00, 0x00, 0x05,
+        0x5d, 0xcc, 0x02,
+};
+
+static const char *const test_words[] = {
+        "boot", "loader", "kernel", "initrd", "efi", "stub", "partition", "volume",
+        "the", "a", "of", "image", "config", "entry", "timeout", "default",
+};
+
+static uint64_t test_next(uint64_t *x) {
+        *x = *x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return *x;
+}
+
+/* space separated words, with the occasional line break */
+static void test_text(uint8_t *p, size_t n, uint64_t x) {
+        size_t i = 0, l;
+        const char *w;
+
+        while (i < n) {
+                test_next(&x);
+                w = test_words[(x >> 33) % 16];
+                for (l = 0; w[l] && i < n; ++l)
+                        p[i++] = w[l];
+                if (i < n)
+                        p[i++] = (x >> 40) % 11 ? ' ' : '\n';
+        }
+}
+
+static void test_noise(uint8_t *p, size_t n, uint64_t x) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                p[i] = test_next(&x) >> 56;
+}
+
+/* 700 bytes of noise, repeated, with a flipped byte every 4099 bytes */
+static void test_periodic(uint8_t *p, size_t n, uint64_t x) {
+        uint8_t base[700];
+        size_t i;
+
+        test_noise(base, sizeof(base), x);
+        for (i = 0; i < n; ++i)
+                p[i] = base[i % 700] ^ (i % 4099 ? 0 : 0x5a);
+}
+
+static void test_put32(uint8_t *p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+}
+
+static uint32_t test_get32(const uint8_t *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *test_length(uint8_t *d, size_t len) {
+        for ( ; len >= 255; len -= 255)
+                *d++ = 255;
+        *d++ = len;
+        return d;
+}
+
+/*
+ * Greedy LZ4 block compressor. Matches may reach back to @base, and end at
+ * least 5 bytes before the end of the block, as the format demands.
+ */
+static size_t test_compress(const uint8_t *base, const uint8_t *src, size_t n, uint8_t *dst) {
+        static uint32_t table[4096];
+        size_t i = 0, anchor = 0, lit, len, off;
+        uint32_t v, h, cand;
+        uint8_t *d = dst, *token;
+
+        memset(table, 0xff, sizeof(table));
+        for (cand = 0; cand + 4 <= (size_t)(src - base); ++cand) {
+                memcpy(&v, base + cand, 4);
+                table[(v * 2654435761U) >> 20] = cand;
+        }
+
+        while (n >= 12 && i + 12 <= n) {
+                memcpy(&v, src + i, 4);
+                h = (v * 2654435761U) >> 20;
+                cand = table[h];
+                table[h] = src - base + i;
+                off = src - base + i - cand;
+                if (cand == UINT32_MAX || off > 65535 || memcmp(base + cand, src + i, 4)) {
+                        ++i;
+                        continue;
+                }
+
+                for (len = 4; i + len < n - 5 && base[cand + len] == src[i + len]; ++len)
+                        ;
+
+                lit = i - anchor;
+                token = d++;
+                *token = (lit < 15 ? lit : 15) << 4 | (len - 4 < 15 ? len - 4 : 15);
+                if (lit >= 15)
+                        d = test_length(d, lit - 15);
+                memcpy(d, src + anchor, lit);
+                d += lit;
+                *d++ = off;
+                *d++ = off >> 8;
+                if (len - 4 >= 15)
+                        d = test_length(d, len - 4 - 15);
+
+                i += len;
+                anchor = i;
+        }
+
+        lit = n - anchor;
+        *d++ = (lit < 15 ? lit : 15) << 4;
+        if (lit >= 15)
+                d = test_length(d, lit - 15);
+        memcpy(d, src + anchor, lit);
+        d += lit;
+
+        return d - dst;
+}
+
+/* build an LZ4 frame of @src with the FLG bits in @flg and 64KiB blocks */
+static size_t test_frame(const uint8_t *src, size_t n, uint8_t flg, uint8_t *dst) {
+        size_t i, k, size, n_header;
+        uint8_t *d = dst, *h;
+
+        test_put32(d, C_EFI_LZ4_MAGIC);
+        h = d + 4;
+        h[0] = C_EFI_LZ4_FLG_VERSION | flg;
+        h[1] = 4 << 4;
+        n_header = 2;
+        if (flg & C_EFI_LZ4_FLG_CONTENT_SIZE) {
+                test_put32(h + 2, n);
+                test_put32(h + 6, 0);
+                n_header += 8;
+        }
+        h[n_header] = c_efi_xxh32(0, h, n_header) >> 8;
+        d = h + n_header + 1;
+
+        for (i = 0; i < n; i += k) {
+                k = n - i < 65536 ? n - i : 65536;
+                size = test_compress((flg & C_EFI_LZ4_FLG_BLOCK_INDEPENDENT) ? src + i : src, src + i, k, d + 4);
+                if (size >= k) {
+                        memcpy(d + 4, src + i, k);
+                        test_put32(d, k | C_EFI_LZ4_BLOCK_UNCOMPRESSED);
+                        size = k;
+                } else {
+                        test_put32(d, size);
+                }
+                d += 4 + size;
+                if (flg & C_EFI_LZ4_FLG_BLOCK_CHECKSUM) {
+                        test_put32(d, c_efi_xxh32(0, d - size, size));
+                        d += 4;
+                }
+        }
+
+        test_put32(d, 0);
+        d += 4;
+        if (flg & C_EFI_LZ4_FLG_CONTENT_CHECKSUM) {
+                test_put32(d, c_efi_xxh32(0, src, n));
+                d += 4;
+        }
+
+        return d - dst;
+}
+
+/*
+ * Decode @in, fed in chunks of @chunk bytes, through a window of @n_window
+ * bytes, draining it into @out whenever the decoder asks for it.
+ */
+static CEfiStatus test_stream(const uint8_t *in, size_t n_in, size_t chunk,
+                              size_t n_window, CEfiBool staging,
+                              uint8_t *out, size_t n_out_max, size_t *n_outp) {
+        size_t off = 0, n_out = 0, k, m;
+        CEfiUSize used;
+        const CEfiU8 *p;
+        uint8_t *window, *stage;
+        CEfiStatus r;
+        CEfiLz4 dec;
+
+        window = malloc(n_window);
+        stage = staging ? malloc(C_EFI_LZ4_STAGING_MAX) : NULL;
+        assert(window && (stage || !staging));
+        c_efi_lz4_init(&dec, 0, window, n_window, stage, staging ? C_EFI_LZ4_STAGING_MAX : 0);
+
+        for (;;) {
+                k = n_in - off < chunk ? n_in - off : chunk;
+                r = c_efi_lz4_decode(&dec, in + off, k, &used);
+                assert(used <= k);
+                off += used;
+
+                m = c_efi_lz4_pending(&dec, &p);
+                assert(n_out + m <= n_out_max);
+                memcpy(out + n_out, p, m);
+                n_out += m;
+                c_efi_lz4_release(&dec, m);
+
+                if (r == C_EFI_BUFFER_TOO_SMALL && (used || m))
+                        continue;
+                if (r)
+                        break;
+                if (off == n_in) {
+                        r = c_efi_lz4_done(&dec) ? C_EFI_SUCCESS : C_EFI_END_OF_FILE;
+                        break;
+                }
+        }
+
+        assert(dec.pos <= n_window);
+        *n_outp = n_out;
+        free(stage);
+        free(window);
+        return r;
+}
+
+/* decode @in in all supported ways and compare the results against @expect */
+static void test_decode(const uint8_t *in, size_t n_in, const uint8_t *expect, size_t n_expect) {
+        static const size_t chunks[] = { 1, 7, 4096, SIZE_MAX };
+        uint8_t *out, *window;
+        size_t i, n_out;
+        CEfiUSize used;
+        CEfiLz4 dec;
+
+        out = malloc(n_expect + 1);
+        assert(out);
+
+        /* in place, into a window of exactly the content size */
+        window = malloc(n_expect + 1);
+        assert(window);
+        c_efi_lz4_init(&dec, 0, window, n_expect, NULL, 0);
+        assert(!c_efi_lz4_decode(&dec, in, n_in, &used));
+        assert(used == n_in);
+        assert(c_efi_lz4_done(&dec));
+        assert(dec.pos == n_expect && dec.tail == 0 && !dec.n_slides);
+        assert(!memcmp(window, expect, n_expect));
+        free(window);
+
+        /* split input needs staging, a small window slides */
+        for (i = 0; i < sizeof(chunks) / sizeof(*chunks); ++i) {
+                assert(!test_stream(in, n_in, chunks[i], n_expect + 1, 1, out, n_expect, &n_out));
+                assert(n_out == n_expect && !memcmp(out, expect, n_expect));
+                assert(!test_stream(in, n_in, chunks[i], 160 * 1024, 1, out, n_expect, &n_out));
+                assert(n_out == n_expect && !memcmp(out, expect, n_expect));
+        }
+
+        free(out);
+}
+
+static void test_vectors(void) {
+        uint8_t *buf;
+
+        buf = malloc(150000);
+        assert(buf);
+
+        test_text(buf, 1200, 1);
+        test_decode(test_lz4_text, sizeof(test_lz4_text), buf, 1200);
+        test_noise(buf, 300, 3);
+        test_decode(test_lz4_noise, sizeof(test_lz4_noise), buf, 300);
+        test_periodic(buf, 150000, 2);
+        test_decode(test_lz4_linked, sizeof(test_lz4_linked), buf, 150000);
+        test_periodic(buf, 70000, 4);
+        test_decode(test_lz4_independent, sizeof(test_lz4_independent), buf, 70000);
+        test_decode(test_lz4_legacy, sizeof(test_lz4_legacy), buf, 70000);
+        test_decode(test_lz4_empty, sizeof(test_lz4_empty), buf, 0);
+
+        free(buf);
+}
+
+static void test_frames(void) {
+        static const uint8_t flgs[] = {
+                0,
+                C_EFI_LZ4_FLG_BLOCK_INDEPENDENT,
+                C_EFI_LZ4_FLG_BLOCK_CHECKSUM | C_EFI_LZ4_FLG_CONTENT_CHECKSUM,
+                C_EFI_LZ4_FLG_BLOCK_INDEPENDENT | C_EFI_LZ4_FLG_BLOCK_CHECKSUM | C_EFI_LZ4_FLG_CONTENT_SIZE,
+                C_EFI_LZ4_FLG_CONTENT_SIZE | C_EFI_LZ4_FLG_CONTENT_CHECKSUM,
+        };
+        const size_t n = 300000;
+        uint8_t *src, *frame, *p;
+        size_t i, n_frame, n_all;
+
+        src = malloc(n);
+        frame = malloc(2 * n);
+        assert(src && frame);
+
+        /*
+         * Noise, long runs of a single byte and of short periods, text, and
+         * 80k of noise repeated at an offset of 65535, the largest possible.
+         */
+        test_noise(src, 20000, 5);
+        memset(src + 20000, 'z', 5000);
+        for (i = 25000; i < 30000; ++i)
+                src[i] = "abcdefg"[i % (1 + i / 1000 % 7)];
+        test_text(src + 30000, 60000, 6);
+        test_noise(src + 90000, 80000, 7);
+        memcpy(src + 90000 + 65535, src + 90000, 80000 - 65535);
+        memcpy(src + 170000, src + 40000, 130000);
+
+        for (i = 0; i < sizeof(flgs); ++i) {
+                n_frame = test_frame(src, n, flgs[i], frame);
+                test_decode(frame, n_frame, src, n);
+        }
+
+        /* concatenated frames, with a skippable frame and a legacy frame */
+        p = frame;
+        p += test_frame(src, 1000, 0, p);
+        test_put32(p, C_EFI_LZ4_MAGIC_SKIPPABLE | 7);
+        test_put32(p + 4, 3);
+        p += 11;
+        test_put32(p, C_EFI_LZ4_MAGIC_LEGACY);
+        test_put32(p + 4, test_compress(src + 1000, src + 1000, 2000, p + 8));
+        p += 8 + test_get32(p + 4);
+        p += test_frame(src + 3000, 500, C_EFI_LZ4_FLG_CONTENT_CHECKSUM, p);
+        n_all = p - frame;
+        test_decode(frame, n_all, src, 3500);
+
+        free(frame);
+        free(src);
+}
+
+static void test_block(void) {
+        uint8_t out[64], in[64];
+        CEfiUSize n_out;
+
+        /* literals only */
+        in[0] = 3 << 4;
+        memcpy(in + 1, "abc", 3);
+        assert(!c_efi_lz4_block(out, out, sizeof(out), in, 4, &n_out));
+        assert(n_out == 3 && !memcmp(out, "abc", 3));
+        assert(c_efi_lz4_block(out, out, 2, in, 4, &n_out) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 3, &n_out) == C_EFI_COMPROMISED_DATA);
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 0, &n_out) == C_EFI_COMPROMISED_DATA);
+
+        /* a match at offset 1 repeats the last byte */
+        in[0] = 1 << 4 | 6;
+        in[1] = 'x';
+        in[2] = 1;
+        in[3] = 0;
+        in[4] = 0;
+        assert(!c_efi_lz4_block(out, out, sizeof(out), in, 5, &n_out));
+        assert(n_out == 11 && !memcmp(out, "xxxxxxxxxxx", 11));
+        assert(c_efi_lz4_block(out, out, 10, in, 5, &n_out) == C_EFI_BUFFER_TOO_SMALL);
+
+        /* offsets of 0 and before the base are invalid, but reach into history */
+        in[2] = 0;
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 5, &n_out) == C_EFI_COMPROMISED_DATA);
+        in[2] = 2;
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 5, &n_out) == C_EFI_COMPROMISED_DATA);
+        out[0] = 'y';
+        assert(!c_efi_lz4_block(out, out + 1, sizeof(out) - 1, in, 5, &n_out));
+        assert(n_out == 11 && !memcmp(out, "yxyxyxyxyxyx", 12));
+
+        /* truncated offsets and length extensions */
+        in[0] = 15 << 4;
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 1, &n_out) == C_EFI_COMPROMISED_DATA);
+        in[0] = 1 << 4 | 15;
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 3, &n_out) == C_EFI_COMPROMISED_DATA);
+        in[2] = 1;
+        assert(c_efi_lz4_block(out, out, sizeof(out), in, 4, &n_out) == C_EFI_COMPROMISED_DATA);
+}
+
+static void test_errors(void) {
+        uint8_t src[5000], frame[6000], window[5000], stage[6000];
+        size_t i, n_frame, n_out;
+        CEfiUSize used;
+        CEfiStatus r;
+        CEfiLz4 dec;
+
+        test_text(src, sizeof(src), 8);
+        n_frame = test_frame(src, sizeof(src),
+                             C_EFI_LZ4_FLG_BLOCK_CHECKSUM | C_EFI_LZ4_FLG_CONTENT_CHECKSUM | C_EFI_LZ4_FLG_CONTENT_SIZE,
+                             frame);
+
+        /* every single bit flip is caught, by checksums or the parser */
+        for (i = 0; i < n_frame * 8; ++i) {
+                frame[i / 8] ^= 1 << (i % 8);
+                r = test_stream(frame, n_frame, SIZE_MAX, sizeof(window), 0, window, sizeof(window), &n_out);
+                assert(r == C_EFI_CRC_ERROR || r == C_EFI_COMPROMISED_DATA || r == C_EFI_UNSUPPORTED ||
+                       r == C_EFI_OUT_OF_RESOURCES || r == C_EFI_END_OF_FILE);
+                frame[i / 8] ^= 1 << (i % 8);
+        }
+
+        /* without checksums, corrupt blocks still decode safely */
+        for (i = 0; i < n_frame * 8; i += 3) {
+                frame[i / 8] ^= 1 << (i % 8);
+                c_efi_lz4_init(&dec, C_EFI_LZ4_FLAG_SKIP_CHECKSUMS, window, sizeof(window), NULL, 0);
+                c_efi_lz4_decode(&dec, frame, n_frame, &used);
+                frame[i / 8] ^= 1 << (i % 8);
+        }
+
+        /* truncated input is not done */
+        for (i = 0; i < n_frame; i += 97) {
+                assert(test_stream(frame, i, SIZE_MAX, sizeof(window), 1, window, sizeof(window), &n_out) ==
+                       C_EFI_END_OF_FILE);
+                assert(n_out <= sizeof(src) && !memcmp(window, src, n_out));
+        }
+
+        /* errors are sticky */
+        c_efi_lz4_init(&dec, 0, window, sizeof(window), NULL, 0);
+        assert(c_efi_lz4_decode(&dec, "junk", 4, &used) == C_EFI_COMPROMISED_DATA);
+        assert(c_efi_lz4_decode(&dec, frame, n_frame, &used) == C_EFI_COMPROMISED_DATA);
+        assert(used == 0);
+
+        /* split blocks need staging */
+        c_efi_lz4_init(&dec, 0, window, sizeof(window), NULL, 0);
+        assert(c_efi_lz4_decode(&dec, frame, n_frame / 2, &used) == C_EFI_OUT_OF_RESOURCES);
+        c_efi_lz4_init(&dec, 0, window, sizeof(window), stage, sizeof(stage));
+        assert(!c_efi_lz4_decode(&dec, frame, n_frame / 2, &used));
+        assert(!c_efi_lz4_decode(&dec, frame + n_frame / 2, n_frame - n_frame / 2, &used));
+        assert(c_efi_lz4_done(&dec) && !memcmp(window, src, sizeof(src)));
+        assert(dec.n_blocks == 1 && dec.n_direct == 0);
+
+        /* a window smaller than the content cannot be used in place */
+        c_efi_lz4_init(&dec, 0, window, sizeof(src) - 1, NULL, 0);
+        assert(c_efi_lz4_decode(&dec, frame, n_frame, &used) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_lz4_pending(&dec, &(const CEfiU8 *){ NULL }) == 0);
+
+        /* dictionaries are not supported */
+        frame[4] |= C_EFI_LZ4_FLG_DICT_ID;
+        c_efi_lz4_init(&dec, 0, window, sizeof(window), NULL, 0);
+        assert(c_efi_lz4_decode(&dec, frame, n_frame, &used) == C_EFI_UNSUPPORTED);
+}
+
+int main(int argc, char **argv) {
+        test_block();
+        test_vectors();
+        test_frames();
+        test_errors();
+        return 0;
+}
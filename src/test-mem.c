@@ -0,0 +1,104 @@
+/*
+ * Tests for Memory Primitives and GUID Helpers
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-guid.h"
+#include "c-efi-mem.h"
+
+#define TEST_SIZE 512
+
+static void test_fill(CEfiU8 *p, CEfiUSize n, unsigned int seed) {
+        CEfiUSize i;
+
+        for (i = 0; i < n; ++i)
+                p[i] = (CEfiU8)(i * 31 + seed);
+}
+
+static void test_mem(void) {
+        CEfiU8 a[TEST_SIZE + 16], b[TEST_SIZE + 16], ref[TEST_SIZE + 16];
+        CEfiUSize off_d, off_s, n;
+
+        /* all sizes around the word and block boundaries, at all alignments */
+        for (off_d = 0; off_d < 8; ++off_d) {
+                for (off_s = 0; off_s < 8; ++off_s) {
+                        for (n = 0; n <= 200; n += (n < 40 ? 1 : 13)) {
+                                test_fill(a, sizeof(a), 1);
+                                test_fill(b, sizeof(b), 2);
+                                memcpy(ref, b, sizeof(ref));
+                                memcpy(ref + off_d, a + off_s, n);
+                                assert(c_efi_memcpy(b + off_d, a + off_s, n) == b + off_d);
+                                assert(!memcmp(b, ref, sizeof(b)));
+                                assert(!c_efi_memcmp(b + off_d, a + off_s, n));
+
+                                memset(ref + off_d, 0xa5, n);
+                                assert(c_efi_memset(b + off_d, 0xa5, n) == b + off_d);
+                                assert(!memcmp(b, ref, sizeof(b)));
+
+                                /* overlapping moves in both directions */
+                                test_fill(b, sizeof(b), 3);
+                                memcpy(ref, b, sizeof(ref));
+                                memmove(ref + off_d, ref + off_s + 4, n);
+                                assert(c_efi_memmove(b + off_d, b + off_s + 4, n) == b + off_d);
+                                assert(!memcmp(b, ref, sizeof(b)));
+
+                                memmove(ref + off_s + 4, ref + off_d, n);
+                                c_efi_memmove(b + off_s + 4, b + off_d, n);
+                                assert(!memcmp(b, ref, sizeof(b)));
+                        }
+                }
+        }
+
+        /* ordering is decided by the first differing byte, unsigned */
+        test_fill(a, sizeof(a), 1);
+        memcpy(b, a, sizeof(b));
+        assert(!c_efi_memcmp(a, b, TEST_SIZE));
+        b[77] = 0xff;
+        a[77] = 0x01;
+        a[78] = 0xff;
+        assert(c_efi_memcmp(a, b, TEST_SIZE) < 0);
+        assert(c_efi_memcmp(b, a, TEST_SIZE) > 0);
+        assert(!c_efi_memcmp(a, b, 77));
+}
+
+static void test_guid(void) {
+        CEfiGuid a = C_EFI_LOADED_IMAGE_PROTOCOL_GUID;
+        CEfiGuid b = C_EFI_LOADED_IMAGE_PROTOCOL_GUID;
+        CEfiGuid c = C_EFI_DEVICE_PATH_PROTOCOL_GUID;
+        CEfiConfigurationTable tables[2] = {
+                { .vendor_guid = C_EFI_DEVICE_PATH_PROTOCOL_GUID, .vendor_table = &c },
+                { .vendor_guid = C_EFI_LOADED_IMAGE_PROTOCOL_GUID, .vendor_table = &a },
+        };
+        CEfiSystemTable st = {
+                .number_of_table_entries = 2,
+                .configuration_table = tables,
+        };
+        CEfiUSize i;
+
+        assert(c_efi_guid_equal(&a, &b));
+        assert(!c_efi_guid_equal(&a, &c));
+        assert(c_efi_guid_hash(&a) == c_efi_guid_hash(&b));
+        assert(c_efi_guid_hash(&a) != c_efi_guid_hash(&c));
+
+        /* a single bit in either word changes the result */
+        for (i = 0; i < 128; ++i) {
+                b = a;
+                b.u8[i / 8] ^= 1 << (i % 8);
+                assert(!c_efi_guid_equal(&a, &b));
+                assert(c_efi_guid_hash(&a) != c_efi_guid_hash(&b));
+        }
+
+        assert(c_efi_configuration_table_find(&st, &a) == &a);
+        assert(c_efi_configuration_table_find(&st, &c) == &c);
+        b.u8[0] ^= 1;
+        assert(!c_efi_configuration_table_find(&st, &b));
+}
+
+int main(int argc, char **argv) {
+        test_mem();
+        test_guid();
+        return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Tests for the Memory Attributes Table Parser
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-memattr.h"
+
+#define TEST_STRIDE 48 /* larger than sizeof(CEfiMemoryDescriptor) */
+
+static void test_put(void *array, CEfiUSize i, CEfiU32 type, CEfiPhysicalAddress start, CEfiU64 pages, CEfiU64 attribute) {
+        CEfiMemoryDescriptor *d = (void *)((CEfiU8 *)array + i * TEST_STRIDE);
+
+        *d = (CEfiMemoryDescriptor){
+                .type = type,
+                .physical_start = start,
+                .number_of_pages = pages,
+                .attribute = attribute,
+        };
+}
+
+static void test_index(void) {
+        _Alignas(8) CEfiU8 map[4 * TEST_STRIDE] = { 0 };
+        CEfiMemoryRange ranges[4];
+        CEfiUSize n;
+
+        /* unsorted input is sorted, empty descriptors are skipped */
+        test_put(map, 0, C_EFI_RUNTIME_SERVICES_CODE, 0x3000, 2, C_EFI_MEMORY_RUNTIME);
+        test_put(map, 1, C_EFI_CONVENTIONAL_MEMORY, 0x0000, 1, C_EFI_MEMORY_WB);
+        test_put(map, 2, C_EFI_LOADER_DATA, 0x9000, 0, 0);
+        test_put(map, 3, C_EFI_LOADER_DATA, 0x1000, 2, C_EFI_MEMORY_WB);
+
+        assert(c_efi_memory_ranges_index(map, 4, 44, ranges, &n) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_memory_ranges_index(map, 4, TEST_STRIDE, ranges, &n));
+        assert(n == 3);
+        assert(ranges[0].start == 0x0000 && ranges[0].end == 0x1000);
+        assert(ranges[1].start == 0x1000 && ranges[1].end == 0x3000);
+        assert(ranges[2].start == 0x3000 && ranges[2].end == 0x5000);
+        assert(ranges[2].type == C_EFI_RUNTIME_SERVICES_CODE);
+
+        assert(c_efi_memory_ranges_find(ranges, n, 0x0fff) == &ranges[0]);
+        assert(c_efi_memory_ranges_find(ranges, n, 0x1000) == &ranges[1]);
+        assert(c_efi_memory_ranges_find(ranges, n, 0x4fff) == &ranges[2]);
+        assert(!c_efi_memory_ranges_find(ranges, n, 0x5000));
+
+        /* overlapping descriptors are rejected */
+        test_put(map, 2, C_EFI_LOADER_DATA, 0x2000, 1, 0);
+        assert(c_efi_memory_ranges_index(map, 4, TEST_STRIDE, ranges, &n) == C_EFI_VOLUME_CORRUPTED);
+}
+
+static void test_merge(void) {
+        CEfiMemoryAttributesTable *table;
+        CEfiMemoryRange map[2], attrs[3], out[8];
+        CEfiUSize n, n_attrs, size;
+
+        size = sizeof(*table) + 3 * TEST_STRIDE;
+        table = calloc(1, size);
+        assert(table);
+
+        table->version = C_EFI_MEMORY_ATTRIBUTES_TABLE_VERSION;
+        table->number_of_entries = 3;
+        table->descriptor_size = TEST_STRIDE;
+
+        /* code section RO, data section XP, gap in between */
+        test_put(table->entry, 0, C_EFI_RUNTIME_SERVICES_CODE, 0x10000, 1,
+                 C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_RO);
+        test_put(table->entry, 1, C_EFI_RUNTIME_SERVICES_CODE, 0x12000, 2,
+                 C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_XP);
+        test_put(table->entry, 2, C_EFI_RUNTIME_SERVICES_DATA, 0x20000, 1,
+                 C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_XP);
+
+        assert(c_efi_memattr_index(table, size - 1, attrs, 3, &n_attrs) == C_EFI_VOLUME_CORRUPTED);
+        assert(c_efi_memattr_index(table, size, attrs, 2, &n_attrs) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_memattr_index(table, size, attrs, 3, &n_attrs));
+        assert(n_attrs == 3);
+
+        table->version = 3;
+        assert(c_efi_memattr_index(table, size, attrs, 3, &n_attrs) == C_EFI_INCOMPATIBLE_VERSION);
+        table->version = C_EFI_MEMORY_ATTRIBUTES_TABLE_VERSION;
+
+        map[0] = (CEfiMemoryRange){ 0x10000, 0x15000, C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME, C_EFI_RUNTIME_SERVICES_CODE };
+        map[1] = (CEfiMemoryRange){ 0x15000, 0x16000, C_EFI_MEMORY_WB, C_EFI_CONVENTIONAL_MEMORY };
+
+        assert(c_efi_memattr_merge(map, 2, attrs, n_attrs, out, 3, &n) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!c_efi_memattr_merge(map, 2, attrs, n_attrs, out, 8, &n));
+        assert(n == 5);
+
+        assert(out[0].start == 0x10000 && out[0].end == 0x11000);
+        assert(out[0].attribute == (C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_RO));
+        assert(out[1].start == 0x11000 && out[1].end == 0x12000);
+        assert(out[1].attribute == (C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME));
+        assert(out[2].start == 0x12000 && out[2].end == 0x14000);
+        assert(out[2].attribute == (C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME | C_EFI_MEMORY_XP));
+        assert(out[3].start == 0x14000 && out[3].end == 0x15000);
+        assert(out[3].attribute == (C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME));
+        assert(out[4].start == 0x15000 && out[4].end == 0x16000);
+        assert(out[4].type == C_EFI_CONVENTIONAL_MEMORY);
+
+        /* equal neighbours are coalesced */
+        map[1] = (CEfiMemoryRange){ 0x15000, 0x16000, C_EFI_MEMORY_WB | C_EFI_MEMORY_RUNTIME, C_EFI_RUNTIME_SERVICES_CODE };
+        assert(!c_efi_memattr_merge(map, 2, attrs, n_attrs, out, 8, &n));
+        assert(n == 4);
+        assert(out[3].start == 0x14000 && out[3].end == 0x16000);
+
+        free(table);
+}
+
+int main(int argc, char **argv) {
+        test_index();
+        test_merge();
+        return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * Tests for the Parallel Work Dispatcher
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "c-efi.h"
+#include "c-efi-mp.h"
+
+#define TEST_N_EVENTS 16
+#define TEST_N_PROCESSORS 6
+#define TEST_BSP 2
+#define TEST_DISABLED 4
+#define TEST_N_APS 4
+
+/*
+ * A host stand-in for firmware events and the MP services. Each AP is a
+ * thread, started anew for every procedure. Events are signaled from those
+ * threads, so they are atomic, and waits spin on them.
+ */
+
+typedef struct TestEvent {
+        int signaled;
+        int used;
+} TestEvent;
+
+typedef struct TestAp {
+        pthread_t thread;
+        CEfiApProcedure procedure;
+        void *argument;
+        CEfiEvent event;
+} TestAp;
+
+static TestEvent test_events[TEST_N_EVENTS];
+static TestAp test_aps[TEST_N_PROCESSORS];
+static CEfiEvent test_all_event;
+static size_t test_n_open, test_n_all, test_n_blocking, test_n_this;
+static int test_reject_nonblocking, test_not_ready, test_wait_error;
+
+static CEfiStatus CEFICALL test_create_event(CEfiU32 type,
+                                             CEfiTpl notify_tpl,
+                                             CEfiEventNotify notify_function,
+                                             void *notify_context,
+                                             CEfiEvent *event) {
+        size_t i;
+
+        assert(!type && !notify_function);
+        for (i = 0; i < TEST_N_EVENTS; ++i) {
+                if (!test_events[i].used) {
+                        test_events[i] = (TestEvent){ .used = 1 };
+                        *event = &test_events[i];
+                        ++test_n_open;
+                        return C_EFI_SUCCESS;
+                }
+        }
+
+        return C_EFI_OUT_OF_RESOURCES;
+}
+
+static CEfiStatus CEFICALL test_signal_event(CEfiEvent event) {
+        TestEvent *e = event;
+
+        assert(e->used);
+        __atomic_store_n(&e->signaled, 1, __ATOMIC_RELEASE);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_close_event(CEfiEvent event) {
+        TestEvent *e = event;
+
+        assert(e->used);
+        e->used = 0;
+        --test_n_open;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_wait_for_event(CEfiUSize number_of_events, CEfiEvent *event, CEfiUSize *index) {
+        TestEvent *e = event[0];
+
+        assert(number_of_events == 1 && e->used);
+        if (test_wait_error)
+                return C_EFI_INVALID_PARAMETER;
+        while (!__atomic_exchange_n(&e->signaled, 0, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+        *index = 0;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices test_bs = {
+        .create_event = test_create_event,
+        .wait_for_event = test_wait_for_event,
+        .signal_event = test_signal_event,
+        .close_event = test_close_event,
+};
+
+static int test_is_ap(CEfiUSize n) {
+        return n < TEST_N_PROCESSORS && n != TEST_BSP && n != TEST_DISABLED;
+}
+
+static CEfiStatus CEFICALL test_get_number_of_processors(CEfiMpServicesProtocol *this_,
+                                                         CEfiUSize *number_of_processors,
+                                                         CEfiUSize *number_of_enabled_processors) {
+        *number_of_processors = TEST_N_PROCESSORS;
+        *number_of_enabled_processors = TEST_N_PROCESSORS - 1;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_get_processor_info(CEfiMpServicesProtocol *this_,
+                                                   CEfiUSize processor_number,
+                                                   CEfiProcessorInformation *processor_info_buffer) {
+        if (processor_number >= TEST_N_PROCESSORS)
+                return C_EFI_NOT_FOUND;
+
+        *processor_info_buffer = (CEfiProcessorInformation){
+                .processor_id = processor_number * 2,
+                .status_flag = C_EFI_PROCESSOR_HEALTH_STATUS_BIT,
+                .location = { .core = processor_number },
+        };
+        if (processor_number == TEST_BSP)
+                processor_info_buffer->status_flag |= C_EFI_PROCESSOR_AS_BSP_BIT;
+        if (processor_number != TEST_DISABLED)
+                processor_info_buffer->status_flag |= C_EFI_PROCESSOR_ENABLED_BIT;
+        return C_EFI_SUCCESS;
+}
+
+static void *test_ap_thread(void *userdata) {
+        TestAp *ap = userdata;
+
+        ap->procedure(ap->argument);
+        if (ap->event)
+                test_signal_event(ap->event);
+        return NULL;
+}
+
+static void test_ap_start(CEfiUSize n, CEfiApProcedure procedure, void *argument, CEfiEvent event) {
+        test_aps[n] = (TestAp){ .procedure = procedure, .argument = argument, .event = event };
+        assert(!pthread_create(&test_aps[n].thread, NULL, test_ap_thread, &test_aps[n]));
+}
+
+static void *test_all_thread(void *userdata) {
+        size_t i;
+
+        for (i = 0; i < TEST_N_PROCESSORS; ++i)
+                if (test_is_ap(i))
+                        assert(!pthread_join(test_aps[i].thread, NULL));
+        test_signal_event(test_all_event);
+        return NULL;
+}
+
+static CEfiStatus CEFICALL test_startup_all_aps(CEfiMpServicesProtocol *this_,
+                                                CEfiApProcedure procedure,
+                                                CEfiBool single_thread,
+                                                CEfiEvent wait_event,
+                                                CEfiUSize timeout_in_micro_seconds,
+                                                void *procedure_argument,
+                                                CEfiUSize **failed_cpu_list) {
+        pthread_t thread;
+        size_t i;
+
+        assert(!single_thread && !timeout_in_micro_seconds && !failed_cpu_list);
+        if (test_not_ready)
+                return C_EFI_NOT_READY;
+        if (wait_event && test_reject_nonblocking)
+                return C_EFI_UNSUPPORTED;
+
+        for (i = 0; i < TEST_N_PROCESSORS; ++i)
+                if (test_is_ap(i))
+                        test_ap_start(i, procedure, procedure_argument, C_EFI_NULL);
+
+        if (wait_event) {
+                ++test_n_all;
+                test_all_event = wait_event;
+                assert(!pthread_create(&thread, NULL, test_all_thread, NULL));
+                assert(!pthread_detach(thread));
+        } else {
+                ++test_n_blocking;
+                for (i = 0; i < TEST_N_PROCESSORS; ++i)
+                        if (test_is_ap(i))
+                                assert(!pthread_join(test_aps[i].thread, NULL));
+        }
+
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_startup_this_ap(CEfiMpServicesProtocol *this_,
+                                                CEfiApProcedure procedure,
+                                                CEfiUSize processor_number,
+                                                CEfiEvent wait_event,
+                                                CEfiUSize timeout_in_micro_seconds,
+                                                void *procedure_argument,
+                                                CEfiBool *finished) {
+        assert(test_is_ap(processor_number) && wait_event && !timeout_in_micro_seconds && !finished);
+        if (test_not_ready)
+                return C_EFI_NOT_READY;
+
+        ++test_n_this;
+        test_ap_start(processor_number, procedure, procedure_argument, wait_event);
+        assert(!pthread_detach(test_aps[processor_number].thread));
+        return C_EFI_SUCCESS;
+}
+
+static CEfiMpServicesProtocol test_mp = {
+        .get_number_of_processors = test_get_number_of_processors,
+        .get_processor_info = test_get_processor_info,
+        .startup_all_aps = test_startup_all_aps,
+        .startup_this_ap = test_startup_this_ap,
+};
+
+typedef struct TestJob {
+        unsigned int *counts;
+        CEfiUSize n_items;
+        CEfiUSize fail_at;
+        CEfiUSize slow_chunk;
+        unsigned long n_calls;
+        unsigned long n_inside;
+} TestJob;
+
+static CEfiStatus test_count(void *userdata, CEfiUSize begin, CEfiUSize end, CEfiUSize worker) {
+        struct timespec ts = { .tv_nsec = 20 * 1000 * 1000 };
+        TestJob *job = userdata;
+        CEfiStatus r = C_EFI_SUCCESS;
+        CEfiUSize i;
+
+        assert(begin < end && end <= job->n_items && worker <= TEST_N_APS);
+        __atomic_fetch_add(&job->n_calls, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&job->n_inside, 1, __ATOMIC_RELAXED);
+        if (begin == job->slow_chunk)
+                nanosleep(&ts, NULL);
+
+        for (i = begin; i < end; ++i) {
+                if (i == job->fail_at) {
+                        r = C_EFI_DEVICE_ERROR;
+                        break;
+                }
+                __atomic_fetch_add(&job->counts[i], 1, __ATOMIC_RELAXED);
+        }
+
+        __atomic_fetch_sub(&job->n_inside, 1, __ATOMIC_RELEASE);
+        return r;
+}
+
+/* run a job counting its items, and check each was run exactly once */
+static void test_job(CEfiMp *mp, CEfiUSize n_items, CEfiUSize chunk_size) {
+        TestJob job = { .n_items = n_items, .fail_at = (CEfiUSize)-1, .slow_chunk = (CEfiUSize)-1 };
+        CEfiU64 n_chunks = 0;
+        CEfiUSize i;
+
+        job.counts = calloc(n_items + 1, sizeof(*job.counts));
+        assert(job.counts);
+
+        for (i = 0; i < mp->n_workers; ++i)
+                n_chunks -= mp->workers[i].n_chunks;
+        assert(!c_efi_mp_run(mp, test_count, &job, n_items, chunk_size));
+        for (i = 0; i < mp->n_workers; ++i)
+                n_chunks += mp->workers[i].n_chunks;
+
+        for (i = 0; i < n_items; ++i)
+                assert(job.counts[i] == 1);
+        assert(n_chunks == job.n_calls);
+        if (chunk_size)
+                assert(job.n_calls == (n_items + chunk_size - 1) / chunk_size);
+        else if (n_items)
+                assert(job.n_calls <= mp->n_workers * C_EFI_MP_CHUNKS_PER_WORKER);
+
+        free(job.counts);
+}
+
+static void test_init(void) {
+        CEfiMpWorker workers[8];
+        CEfiMp mp;
+
+        assert(c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 0) == C_EFI_INVALID_PARAMETER);
+
+        /* without MP services, only the BSP works */
+        assert(!c_efi_mp_init(&mp, &test_bs, C_EFI_NULL, workers, 8));
+        assert(mp.n_workers == 1 && !test_n_open);
+        test_job(&mp, 1000, 0);
+        assert(workers[0].n_chunks == C_EFI_MP_CHUNKS_PER_WORKER);
+        c_efi_mp_deinit(&mp);
+
+        /* the BSP and disabled processors are skipped */
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+        assert(mp.n_workers == 5 && mp.n_aps == TEST_N_APS);
+        assert(workers[1].processor == 0 && workers[2].processor == 1);
+        assert(workers[3].processor == 3 && workers[4].processor == 5);
+        assert(test_n_open == 5);
+        c_efi_mp_deinit(&mp);
+        assert(!test_n_open);
+
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 3));
+        assert(mp.n_workers == 3 && test_n_open == 3);
+        c_efi_mp_deinit(&mp);
+        assert(!test_n_open);
+}
+
+static void test_run(void) {
+        static const CEfiUSize n_items[] = { 0, 1, 2, 5, 64, 1000, 100003 };
+        static const CEfiUSize chunk_sizes[] = { 0, 1, 7, 4096 };
+        CEfiMpWorker workers[8];
+        size_t i, j, n;
+        CEfiMp mp;
+
+        /* all APs are started at once */
+        test_n_all = test_n_this = 0;
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+        for (i = 0; i < sizeof(n_items) / sizeof(*n_items); ++i)
+                for (j = 0; j < sizeof(chunk_sizes) / sizeof(*chunk_sizes); ++j)
+                        test_job(&mp, n_items[i], chunk_sizes[j]);
+        assert(test_n_all && !test_n_this && !mp.n_fallbacks);
+        c_efi_mp_deinit(&mp);
+
+        /* a subset of the APs is started one by one */
+        n = test_n_all;
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 3));
+        for (i = 0; i < sizeof(n_items) / sizeof(*n_items); ++i)
+                for (j = 0; j < sizeof(chunk_sizes) / sizeof(*chunk_sizes); ++j)
+                        test_job(&mp, n_items[i], chunk_sizes[j]);
+        assert(test_n_all == n && test_n_this && !mp.n_fallbacks);
+        c_efi_mp_deinit(&mp);
+        assert(!test_n_open);
+}
+
+static void test_steal(void) {
+        TestJob job = { .n_items = 64, .fail_at = (CEfiUSize)-1, .slow_chunk = 0 };
+        CEfiMpWorker workers[8];
+        CEfiMp mp;
+        size_t i;
+
+        /* the first chunk of the BSP stalls, so the APs steal the rest */
+        job.counts = calloc(job.n_items, sizeof(*job.counts));
+        assert(job.counts);
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+        assert(!c_efi_mp_run(&mp, test_count, &job, job.n_items, 1));
+        for (i = 0; i < job.n_items; ++i)
+                assert(job.counts[i] == 1);
+        assert(c_efi_mp_steals(&mp) > 0);
+        assert(workers[0].n_chunks < job.n_items / mp.n_workers);
+        c_efi_mp_deinit(&mp);
+        free(job.counts);
+}
+
+static void test_fallback(void) {
+        CEfiMpWorker workers[8];
+        size_t n;
+        CEfiMp mp;
+
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+
+        /* blocking calls after ready-to-boot */
+        test_reject_nonblocking = 1;
+        n = test_n_blocking;
+        test_job(&mp, 10000, 0);
+        assert(test_n_blocking == n + 1 && mp.n_fallbacks == 1);
+        test_reject_nonblocking = 0;
+
+        /* busy APs leave all the work to the BSP */
+        test_not_ready = 1;
+        test_job(&mp, 10000, 0);
+        assert(mp.n_fallbacks == 2);
+        c_efi_mp_deinit(&mp);
+
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 3));
+        test_job(&mp, 10000, 0);
+        assert(mp.n_fallbacks == 1);
+        test_not_ready = 0;
+        c_efi_mp_deinit(&mp);
+        assert(!test_n_open);
+}
+
+static void test_error(void) {
+        TestJob job = { .n_items = 100000, .fail_at = 5000, .slow_chunk = (CEfiUSize)-1 };
+        CEfiMpWorker workers[8];
+        CEfiMp mp;
+
+        job.counts = calloc(job.n_items, sizeof(*job.counts));
+        assert(job.counts);
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+        assert(c_efi_mp_run(&mp, test_count, &job, job.n_items, 10) == C_EFI_DEVICE_ERROR);
+        assert(job.counts[5000] == 0);
+
+        /* the next job starts afresh */
+        job.fail_at = (CEfiUSize)-1;
+        assert(!c_efi_mp_run(&mp, test_count, &job, job.n_items, 10));
+        assert(job.counts[5000] == 1);
+        c_efi_mp_deinit(&mp);
+        free(job.counts);
+}
+
+static void test_wait(CEfiUSize n_workers) {
+        TestJob job = { .n_items = 64, .fail_at = (CEfiUSize)-1 };
+        CEfiMpWorker workers[8];
+        CEfiUSize i, index;
+        CEfiMp mp;
+
+        /* failing waits still return only after every AP left the callback */
+        job.counts = calloc(job.n_items, sizeof(*job.counts));
+        assert(job.counts);
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, n_workers));
+        job.slow_chunk = job.n_items / mp.n_workers;
+        test_wait_error = 1;
+        assert(c_efi_mp_run(&mp, test_count, &job, job.n_items, 1) == C_EFI_INVALID_PARAMETER);
+        assert(!__atomic_load_n(&job.n_inside, __ATOMIC_ACQUIRE));
+        assert(!mp.n_running);
+        for (i = 0; i < job.n_items; ++i)
+                assert(job.counts[i] == 1);
+        test_wait_error = 0;
+
+        /* let the stand-in signal the events, before starting the APs again */
+        if (n_workers - 1 >= mp.n_aps)
+                assert(!test_wait_for_event(1, &mp.done, &index));
+        else
+                for (i = 1; i < mp.n_workers; ++i)
+                        assert(!test_wait_for_event(1, &workers[i].event, &index));
+
+        c_efi_mp_deinit(&mp);
+        free(job.counts);
+}
+
+/* an LZ4 block of a literal, repeated by a match at offset 1, and no trailing literals */
+static size_t test_lz4_run(CEfiU8 *d, CEfiU8 c, size_t n) {
+        size_t len = n - 1 - 4 - 15, i = 0;
+
+        d[i++] = 1 << 4 | 15;
+        d[i++] = c;
+        d[i++] = 1;
+        d[i++] = 0;
+        for ( ; len >= 255; len -= 255)
+                d[i++] = 255;
+        d[i++] = len;
+        d[i++] = 0;
+        return i;
+}
+
+static void test_helpers(void) {
+        CEfiU8 (*digests)[C_EFI_SHA256_DIGEST_SIZE], digest[C_EFI_SHA256_DIGEST_SIZE], *data;
+        CEfiU8 src[16][64], dst[16][4096];
+        CEfiMpLz4Block blocks[16];
+        CEfiMpWorker workers[8];
+        size_t i, n = 3 * C_EFI_MP_MEMSET_CHUNK + 1;
+        CEfiMp mp;
+
+        data = malloc(n);
+        digests = calloc(n / 1000 + 1, sizeof(*digests));
+        assert(data && digests);
+        assert(!c_efi_mp_init(&mp, &test_bs, &test_mp, workers, 8));
+
+        memset(data, 0xaa, n);
+        assert(!c_efi_mp_memset(&mp, data + 1, 0x55, n - 2));
+        assert(data[0] == 0xaa && data[n - 1] == 0xaa);
+        for (i = 1; i < n - 1; ++i)
+                assert(data[i] == 0x55);
+
+        for (i = 0; i < n; ++i)
+                data[i] = (CEfiU8)(i * 7 + (i >> 9));
+        assert(c_efi_mp_sha256_pieces(&mp, data, n, 0, digests) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_mp_sha256_pieces(&mp, data, n, 1000, digests));
+        for (i = 0; i * 1000 < n; ++i) {
+                c_efi_sha256(data + i * 1000, n - i * 1000 < 1000 ? n - i * 1000 : 1000, digest);
+                assert(!memcmp(digest, digests[i], sizeof(digest)));
+        }
+
+        for (i = 0; i < 16; ++i)
+                blocks[i] = (CEfiMpLz4Block){
+                        .src = src[i],
+                        .n_src = test_lz4_run(src[i], 'a' + i, 4096),
+                        .dst = dst[i],
+                        .n_dst = sizeof(dst[i]),
+                };
+        assert(!c_efi_mp_lz4_blocks(&mp, blocks, 16));
+        for (i = 0; i < 16; ++i) {
+                assert(blocks[i].n_out == 4096);
+                assert(dst[i][0] == 'a' + i && dst[i][4095] == 'a' + i);
+        }
+
+        /* a truncated block fails the job */
+        --blocks[9].n_src;
+        assert(c_efi_mp_lz4_blocks(&mp, blocks, 16) == C_EFI_COMPROMISED_DATA);
+
+        c_efi_mp_deinit(&mp);
+        free(digests);
+        free(data);
+}
+
+int main(int argc, char **argv) {
+        size_t i;
+
+        test_init();
+        for (i = 0; i < 8; ++i)
+                test_run();
+        test_steal();
+        test_fallback();
+        test_error();
+        test_wait(8);
+        test_wait(3);
+        test_helpers();
+        assert(!test_n_open);
+        return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Tests for the In-Memory PE/COFF Loader
+ *
+ * This maps a synthetic PE32+ image with base relocations and, on x86-64,
+ * runs it. If a path to a cross-built UEFI application is passed as first
+ * argument (meson does so for `example-hello-world` when cross-compiling for
+ * the build machine architecture), that image is loaded and run against a
+ * host stand-in of the system table as well.
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "c-efi.h"
+#include "c-efi-pe-loader.h"
+
+static CEfiUSize test_n_pages;
+static CEfiHandle test_handle;
+static void *test_interface;
+static CEfiChar16 test_output[256];
+static CEfiUSize test_n_output;
+
+static CEfiStatus CEFICALL test_allocate_pages(CEfiAllocateType type,
+                                               CEfiMemoryType memory_type,
+                                               CEfiUSize pages,
+                                               CEfiPhysicalAddress *memory) {
+        void *p;
+
+        assert(type == C_EFI_ALLOCATE_ANY_PAGES);
+        assert(memory_type == C_EFI_LOADER_CODE);
+
+        p = mmap(NULL, pages * 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+                return C_EFI_OUT_OF_RESOURCES;
+
+        /* poison, so missing zero-fill is detected */
+        memset(p, 0xcc, pages * 4096);
+        test_n_pages += pages;
+        *memory = (CEfiPhysicalAddress)(CEfiUSize)p;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_free_pages(CEfiPhysicalAddress memory, CEfiUSize pages) {
+        assert(test_n_pages >= pages);
+        test_n_pages -= pages;
+        munmap((void *)(CEfiUSize)memory, pages * 4096);
+        return C_EFI_SUCCESS;
+}
+
+static void CEFICALL test_copy_mem(void *dst, void *src, CEfiUSize n) {
+        memmove(dst, src, n);
+}
+
+static void CEFICALL test_set_mem(void *dst, CEfiUSize n, CEfiU8 v) {
+        memset(dst, v, n);
+}
+
+static CEfiStatus CEFICALL test_install_protocol_interface(CEfiHandle *handle,
+                                                           CEfiGuid *protocol,
+                                                           CEfiInterfaceType type,
+                                                           void *interface) {
+        CEfiGuid guid = C_EFI_LOADED_IMAGE_PROTOCOL_GUID;
+
+        assert(!*handle);
+        assert(!memcmp(protocol, &guid, sizeof(guid)));
+        assert(!test_interface);
+
+        *handle = test_handle = &test_handle;
+        test_interface = interface;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_uninstall_protocol_interface(CEfiHandle handle,
+                                                             CEfiGuid *protocol,
+                                                             void *interface) {
+        assert(handle == test_handle);
+        assert(interface == test_interface);
+        test_interface = NULL;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_handle_protocol(CEfiHandle handle, CEfiGuid *protocol, void **interface) {
+        if (handle != test_handle || !test_interface)
+                return C_EFI_UNSUPPORTED;
+        *interface = test_interface;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_wait_for_event(CEfiUSize n, CEfiEvent *events, CEfiUSize *index) {
+        *index = 0;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_output_string(CEfiSimpleTextOutputProtocol *this_, CEfiChar16 *string) {
+        while (*string && test_n_output < sizeof(test_output) / sizeof(*test_output) - 1)
+                test_output[test_n_output++] = *string++;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiBootServices test_bs = {
+        .allocate_pages = test_allocate_pages,
+        .free_pages = test_free_pages,
+        .copy_mem = test_copy_mem,
+        .set_mem = test_set_mem,
+        .install_protocol_interface = test_install_protocol_interface,
+        .uninstall_protocol_interface = test_uninstall_protocol_interface,
+        .handle_protocol = test_handle_protocol,
+        .wait_for_event = test_wait_for_event,
+};
+
+static CEfiSimpleTextInputProtocol test_con_in;
+static CEfiSimpleTextOutputProtocol test_con_out = {
+        .output_string = test_output_string,
+};
+
+static CEfiSystemTable test_st = {
+        .con_in = &test_con_in,
+        .con_out = &test_con_out,
+        .boot_services = &test_bs,
+};
+
+/*
+ * Synthetic image: .text at 0x1000 loads a pointer from .data at 0x2000 and
+ * returns the 32bit value it points to (0x2a at 0x2100). The pointer is
+ * covered by a DIR64 relocation in .reloc at 0x3000.
+ */
+static CEfiU8 *test_build(CEfiUSize *sizep) {
+        static const CEfiU8 code[] = {
+                0x48, 0x8b, 0x05, 0xf9, 0x0f, 0x00, 0x00,       /* mov rax, [rip + 0xff9] */
+                0x8b, 0x00,                                     /* mov eax, [rax] */
+                0xc3,                                           /* ret */
+        };
+        static const struct {
+                const char *name;
+                CEfiU32 rva, offset, raw, virt;
+        } sections[] = {
+                { ".text",      0x1000, 0x400, 0x200, 0x010 },
+                { ".data",      0x2000, 0x600, 0x200, 0x800 },
+                { ".reloc",     0x3000, 0x800, 0x200, 0x00c },
+        };
+        CEfiPeOptionalHeader64 *oh;
+        CEfiPeSectionHeader *sh;
+        CEfiPeFileHeader *fh;
+        CEfiU8 *file;
+        CEfiUSize i;
+
+        file = calloc(1, 0xa00);
+        assert(file);
+
+        file[0] = 'M';
+        file[1] = 'Z';
+        *(CEfiU32 *)(file + 0x3c) = 0x80;
+        memcpy(file + 0x80, "PE\0\0", 4);
+
+        fh = (void *)(file + 0x84);
+        fh->machine = C_EFI_PE_MACHINE_X64;
+        fh->number_of_sections = 3;
+        fh->size_of_optional_header = sizeof(*oh) + 16 * sizeof(CEfiPeDataDirectory);
+        fh->characteristics = C_EFI_PE_FILE_EXECUTABLE_IMAGE;
+
+        oh = (void *)(fh + 1);
+        oh->magic = C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS;
+        oh->address_of_entry_point = 0x1000;
+        oh->image_base = 0x140000000;
+        oh->section_alignment = 0x1000;
+        oh->file_alignment = 0x200;
+        oh->size_of_image = 0x4000;
+        oh->size_of_headers = 0x400;
+        oh->subsystem = C_EFI_PE_SUBSYSTEM_EFI_APPLICATION;
+        oh->number_of_rva_and_sizes = 16;
+        oh->data_directory[C_EFI_PE_DIRECTORY_BASERELOC].virtual_address = 0x3000;
+        oh->data_directory[C_EFI_PE_DIRECTORY_BASERELOC].size = 0x00c;
+
+        sh = (void *)((CEfiU8 *)oh + fh->size_of_optional_header);
+        for (i = 0; i < 3; ++i) {
+                strncpy((char *)sh[i].name, sections[i].name, sizeof(sh[i].name));
+                sh[i].virtual_address = sections[i].rva;
+                sh[i].virtual_size = sections[i].virt;
+                sh[i].pointer_to_raw_data = sections[i].offset;
+                sh[i].size_of_raw_data = sections[i].raw;
+        }
+
+        memcpy(file + 0x400, code, sizeof(code));
+        *(CEfiU64 *)(file + 0x600) = 0x140000000 + 0x2100;
+        *(CEfiU32 *)(file + 0x700) = 0x2a;
+        /* reloc block: page 0x2000, 12 bytes, DIR64 at +0, ABSOLUTE padding */
+        *(CEfiU32 *)(file + 0x800) = 0x2000;
+        *(CEfiU32 *)(file + 0x804) = 0x00c;
+        *(CEfiU16 *)(file + 0x808) = (C_EFI_PE_REL_BASED_DIR64 << 12) | 0x000;
+        *(CEfiU16 *)(file + 0x80a) = (C_EFI_PE_REL_BASED_ABSOLUTE << 12);
+
+        *sizep = 0xa00;
+        return file;
+}
+
+static void test_synthetic(void) {
+        CEfiPeLoader loader;
+        CEfiU8 *file, *base;
+        CEfiUSize size;
+
+        file = test_build(&size);
+
+        assert(!c_efi_pe_loader_load(&loader, &test_st, &test_st, file, size));
+        assert(test_n_pages == 4);
+        base = loader.loaded_image.image_base;
+        assert(base == (void *)(CEfiUSize)loader.pages);
+        assert(loader.loaded_image.image_size == 0x4000);
+        assert(loader.loaded_image.parent_handle == &test_st);
+        assert(loader.loaded_image.system_table == &test_st);
+
+        /* headers and sections copied, gaps and tails zeroed, relocated */
+        assert(!memcmp(base, file, 0x400));
+        assert(base[0x400] == 0 && base[0xfff] == 0);
+        assert(base[0x1000] == 0x48 && base[0x1010] == 0);
+        assert(*(CEfiU64 *)(base + 0x2000) == (CEfiUSize)base + 0x2100);
+        assert(*(CEfiU32 *)(base + 0x2100) == 0x2a);
+        assert(base[0x2200] == 0 && base[0x27ff] == 0);
+        assert(base[0x3fff] == 0);
+
+#if defined(__x86_64__)
+        assert(c_efi_pe_loader_start(&loader) == 0x2a);
+        assert(!test_interface);
+#endif
+
+        c_efi_pe_loader_unload(&loader);
+        assert(test_n_pages == 0);
+
+        /* broken relocations are rejected and release the pages */
+        *(CEfiU32 *)(file + 0x804) = 0x00d;
+        assert(c_efi_pe_loader_load(&loader, &test_st, NULL, file, size) == C_EFI_LOAD_ERROR);
+        assert(test_n_pages == 0);
+        *(CEfiU32 *)(file + 0x804) = 0x00c;
+
+        /* foreign machines are rejected */
+        *(CEfiU16 *)(file + 0x84) = C_EFI_PE_MACHINE_I386;
+        assert(c_efi_pe_loader_load(&loader, &test_st, NULL, file, size) == C_EFI_UNSUPPORTED);
+
+        free(file);
+}
+
+static void test_file(const char *path) {
+        static const CEfiChar16 expected[] = { 'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n', 0 };
+        CEfiPeLoader loader;
+        CEfiU8 *data;
+        long size;
+        FILE *f;
+
+        f = fopen(path, "rb");
+        assert(f);
+        assert(!fseek(f, 0, SEEK_END));
+        size = ftell(f);
+        assert(size > 0);
+        rewind(f);
+        data = malloc(size);
+        assert(data);
+        assert(fread(data, 1, size, f) == (size_t)size);
+        fclose(f);
+
+        assert(!c_efi_pe_loader_load(&loader, &test_st, &test_st, data, size));
+        assert(!c_efi_pe_loader_start(&loader));
+        assert(!memcmp(test_output, expected, sizeof(expected)));
+
+        c_efi_pe_loader_unload(&loader);
+        assert(test_n_pages == 0);
+
+        free(data);
+}
+
+int main(int argc, char **argv) {
+        test_synthetic();
+        if (argc > 1)
+                test_file(argv[1]);
+        return 0;
+}
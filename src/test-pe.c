@@ -0,0 +1,155 @@
+/*
+ * Tests for PE/COFF Image Introspection
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-pe.h"
+
+#define TEST_FILE_SIZE 0x1000
+#define TEST_IMAGE_SIZE 0x4000
+
+static const struct {
+        const char *name;
+        CEfiU32 rva;
+        CEfiU32 offset;
+        CEfiU32 size;
+} test_sections[] = {
+        { ".text",      0x1000, 0x400, 0x100 },
+        { ".linux",     0x2000, 0x600, 0x180 },
+        { ".cmdline",   0x3000, 0x800, 0x010 },
+};
+
+static void test_build(CEfiU8 *file) {
+        CEfiPeFileHeader *fh;
+        CEfiPeOptionalHeader64 *oh;
+        CEfiPeSectionHeader *sh;
+        CEfiUSize i;
+
+        memset(file, 0, TEST_FILE_SIZE);
+
+        file[0] = 'M';
+        file[1] = 'Z';
+        *(CEfiU32 *)(file + 0x3c) = 0x80;
+        memcpy(file + 0x80, "PE\0\0", 4);
+
+        fh = (void *)(file + 0x84);
+        fh->machine = C_EFI_PE_MACHINE_X64;
+        fh->number_of_sections = 3;
+        fh->size_of_optional_header = sizeof(*oh) + 16 * sizeof(CEfiPeDataDirectory);
+
+        oh = (void *)(fh + 1);
+        oh->magic = C_EFI_PE_OPTIONAL_MAGIC_PE32PLUS;
+        oh->address_of_entry_point = 0x1010;
+        oh->image_base = 0x140000000;
+        oh->section_alignment = 0x1000;
+        oh->file_alignment = 0x200;
+        oh->size_of_image = TEST_IMAGE_SIZE;
+        oh->size_of_headers = 0x400;
+        oh->subsystem = C_EFI_PE_SUBSYSTEM_EFI_APPLICATION;
+        oh->number_of_rva_and_sizes = 16;
+        oh->data_directory[C_EFI_PE_DIRECTORY_DEBUG].virtual_address = 0x2010;
+        oh->data_directory[C_EFI_PE_DIRECTORY_DEBUG].size = 0x20;
+
+        sh = (void *)((CEfiU8 *)oh + fh->size_of_optional_header);
+        for (i = 0; i < 3; ++i) {
+                strncpy((char *)sh[i].name, test_sections[i].name, sizeof(sh[i].name));
+                sh[i].virtual_size = test_sections[i].size;
+                sh[i].virtual_address = test_sections[i].rva;
+                sh[i].size_of_raw_data = 0x200;
+                sh[i].pointer_to_raw_data = test_sections[i].offset;
+                memset(file + test_sections[i].offset, 'a' + i, test_sections[i].size);
+        }
+}
+
+static void test_load(CEfiU8 *mem, const CEfiU8 *file) {
+        CEfiUSize i;
+
+        memset(mem, 0, TEST_IMAGE_SIZE);
+        memcpy(mem, file, 0x400);
+        for (i = 0; i < 3; ++i)
+                memcpy(mem + test_sections[i].rva,
+                       file + test_sections[i].offset,
+                       test_sections[i].size);
+}
+
+static void test_layout(const CEfiU8 *base, CEfiUSize size, CEfiBool loaded) {
+        const CEfiPeSectionHeader *s;
+        const CEfiU8 *p;
+        CEfiPeImage image;
+        CEfiUSize i, n;
+
+        assert(!c_efi_pe_image_parse(&image, base, size, loaded));
+        assert(image.machine == C_EFI_PE_MACHINE_X64);
+        assert(image.subsystem == C_EFI_PE_SUBSYSTEM_EFI_APPLICATION);
+        assert(image.image_base == 0x140000000);
+        assert(image.entry_point == 0x1010);
+        assert(image.size_of_image == TEST_IMAGE_SIZE);
+        assert(image.n_directories == 16);
+        assert(image.n_sections == 3);
+
+        for (i = 0; i < 3; ++i) {
+                s = c_efi_pe_section_find(&image, test_sections[i].name);
+                assert(s == &image.sections[i]);
+
+                p = c_efi_pe_section_data(&image, s, &n);
+                assert(n == test_sections[i].size);
+                assert(p == base + (loaded ? test_sections[i].rva : test_sections[i].offset));
+                assert(p[0] == 'a' + i && p[n - 1] == 'a' + i);
+        }
+
+        assert(!c_efi_pe_section_find(&image, ".initrd"));
+        assert(!c_efi_pe_section_find(&image, ".cmdlinex"));
+        assert(!c_efi_pe_section_find(&image, ".lin"));
+
+        p = c_efi_pe_directory(&image, C_EFI_PE_DIRECTORY_DEBUG, &n);
+        assert(n == 0x20);
+        assert(p == base + (loaded ? 0x2010 : 0x610));
+        assert(!c_efi_pe_directory(&image, C_EFI_PE_DIRECTORY_BASERELOC, &n));
+        assert(!n);
+
+        assert(c_efi_pe_rva(&image, 0x1000, 0x100));
+        assert(!c_efi_pe_rva(&image, 0xffffffff, 2));
+        if (!loaded)
+                assert(!c_efi_pe_rva(&image, 0x1100, 0x200));
+}
+
+static void test_pe(void) {
+        CEfiLoadedImageProtocol loaded_image = { 0 };
+        CEfiU8 *file, *mem;
+        CEfiPeImage image;
+
+        file = malloc(TEST_FILE_SIZE);
+        mem = malloc(TEST_IMAGE_SIZE);
+        assert(file && mem);
+
+        test_build(file);
+        test_load(mem, file);
+
+        test_layout(file, TEST_FILE_SIZE, C_EFI_FALSE);
+        test_layout(mem, TEST_IMAGE_SIZE, C_EFI_TRUE);
+
+        loaded_image.image_base = mem;
+        loaded_image.image_size = TEST_IMAGE_SIZE;
+        assert(!c_efi_pe_image_from_loaded_image(&image, &loaded_image));
+        assert(image.loaded);
+
+        /* truncated images and broken headers are rejected */
+        assert(c_efi_pe_image_parse(&image, file, 0x100, C_EFI_FALSE) == C_EFI_LOAD_ERROR);
+        assert(c_efi_pe_image_parse(&image, mem, TEST_IMAGE_SIZE - 1, C_EFI_TRUE) == C_EFI_LOAD_ERROR);
+        file[0x80] = 'X';
+        assert(c_efi_pe_image_parse(&image, file, TEST_FILE_SIZE, C_EFI_FALSE) == C_EFI_LOAD_ERROR);
+        test_build(file);
+        ((CEfiPeSectionHeader *)(file + 0x188))[2].pointer_to_raw_data = TEST_FILE_SIZE - 0x100;
+        assert(c_efi_pe_image_parse(&image, file, TEST_FILE_SIZE, C_EFI_FALSE) == C_EFI_LOAD_ERROR);
+
+        free(mem);
+        free(file);
+}
+
+int main(int argc, char **argv) {
+        test_pe();
+        return 0;
+}
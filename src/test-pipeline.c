@@ -0,0 +1,431 @@
+/*
+ * Tests for the Streaming Pipeline
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-pipeline.h"
+#include "c-efi-xxhash.h"
+
+/*
+ * The pipeline never does simulated CPU work, so the device completes
+ * requests only while it waits for its wake event, and every wait is
+ * observable. Buffers come from page allocations, which the device checks
+ * by requiring page alignment.
+ */
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_N_BLOCKS 4096
+#define TEST_SIZE (TEST_N_BLOCKS * TEST_BLOCK_SIZE)
+#define TEST_ALIGN 4096
+#define TEST_N_ALLOCATIONS 8
+#define TEST_BLOCK_IO2
+#include "test-firmware.h"
+
+static CEfiClock test_clock;
+
+static CEfiBootServices test_bs = {
+        .allocate_pages = test_allocate_pages,
+        .free_pages = test_free_pages,
+        .create_event = test_create_event,
+        .wait_for_event = test_wait_for_event,
+        .signal_event = test_signal_event,
+        .close_event = test_close_event,
+};
+
+/*
+ * A synchronous producer of a memory range, with a cap on the size of each
+ * buffer to exercise partial buffers.
+ */
+typedef struct TestSource {
+        const CEfiU8 *data;
+        size_t size;
+        size_t offset;
+        size_t max;
+} TestSource;
+
+static CEfiStatus test_source_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        TestSource *src = stage->userdata;
+        size_t n = src->size - src->offset;
+
+        if (!n)
+                return C_EFI_END_OF_FILE;
+        if (n > src->max)
+                n = src->max;
+        if (n > stage->pipeline->buffer_size)
+                n = stage->pipeline->buffer_size;
+
+        assert(buffer->offset == src->offset);
+        memcpy(buffer->data, src->data + src->offset, n);
+        buffer->size = n;
+        src->offset += n;
+        return C_EFI_SUCCESS;
+}
+
+/* a stage that burns @userdata nanoseconds per buffer */
+static CEfiStatus test_spin_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        CEfiU64 end = c_efi_clock_ns(&test_clock) + (uintptr_t)stage->userdata;
+
+        while (c_efi_clock_ns(&test_clock) < end)
+                ;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus test_fail_start(CEfiPipelineStage *stage, CEfiPipelineBuffer *buffer) {
+        return buffer->index == 3 ? C_EFI_ABORTED : C_EFI_SUCCESS;
+}
+
+static void test_put32(uint8_t *p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+}
+
+/* LZ4 frame of uncompressed 64KiB blocks */
+static size_t test_lz4_frame(const uint8_t *src, size_t n, uint8_t *dst) {
+        uint8_t *d = dst;
+        size_t i, k;
+
+        test_put32(d, C_EFI_LZ4_MAGIC);
+        d[4] = C_EFI_LZ4_FLG_VERSION | C_EFI_LZ4_FLG_BLOCK_INDEPENDENT | C_EFI_LZ4_FLG_CONTENT_CHECKSUM;
+        d[5] = 4 << 4;
+        d[6] = c_efi_xxh32(0, d + 4, 2) >> 8;
+        d += 7;
+
+        for (i = 0; i < n; i += k) {
+                k = n - i < 65536 ? n - i : 65536;
+                test_put32(d, k | C_EFI_LZ4_BLOCK_UNCOMPRESSED);
+                memcpy(d + 4, src + i, k);
+                d += 4 + k;
+        }
+
+        test_put32(d, 0);
+        test_put32(d + 4, c_efi_xxh32(0, src, n));
+        return d + 8 - dst;
+}
+
+/* zstd frame of raw 64KiB blocks, with a window of 128KiB */
+static size_t test_zstd_frame(const uint8_t *src, size_t n, uint8_t *dst) {
+        uint8_t *d = dst;
+        size_t i = 0, k;
+
+        test_put32(d, C_EFI_ZSTD_MAGIC);
+        d[4] = 0;
+        d[5] = (17 - 10) << 3;
+        d += 6;
+
+        do {
+                k = n - i < 65536 ? n - i : 65536;
+                test_put32(d, k << 3 | C_EFI_ZSTD_BLOCK_RAW << 1 | (i + k == n));
+                memcpy(d + 3, src + i, k);
+                d += 3 + k;
+                i += k;
+        } while (i < n);
+
+        return d - dst;
+}
+
+static void test_init(void) {
+        CEfiPipelineBuffer buffers[4];
+        CEfiPipeline p;
+
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 4, 5000));
+        assert(p.buffer_size == 8192 && test_n_open == 1 && test_n_allocations == 1);
+        assert(buffers[0].data == (CEfiU8 *)(uintptr_t)p.pages);
+        assert(buffers[3].data == buffers[0].data + 3 * 8192);
+        c_efi_pipeline_deinit(&p);
+        c_efi_pipeline_deinit(&p);
+        assert(test_n_open == 0 && test_n_allocations == 0);
+
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 4, 0));
+        assert(p.buffer_size == C_EFI_PIPELINE_BUFFER_SIZE);
+        assert(c_efi_pipeline_start(&p, NULL, 0) == C_EFI_INVALID_PARAMETER);
+        c_efi_pipeline_deinit(&p);
+
+        assert(c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 0, 0) == C_EFI_INVALID_PARAMETER);
+        c_efi_pipeline_deinit(&p);
+
+        /* failing event creation releases the pages */
+        test_create_limit = 0;
+        assert(c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 4, 0) == C_EFI_OUT_OF_RESOURCES);
+        assert(test_n_open == 0 && test_n_allocations == 0);
+        test_create_limit = TEST_N_EVENTS;
+}
+
+static void test_sync(void) {
+        static const size_t sizes[] = { 0, 1, 4096, 4097, 3 * 8192, 100000 };
+        CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE], *dst;
+        CEfiPipelineBuffer buffers[3];
+        CEfiPipelineStage stages[3];
+        CEfiPipelineSha256 sha;
+        CEfiPipelineCopy copy;
+        TestSource src;
+        CEfiPipeline p;
+        size_t i;
+
+        dst = malloc(100000);
+        assert(dst);
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 3, 8192));
+
+        /* all data arrives, in order, through a ring smaller than the stream */
+        for (i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+                src = (TestSource){ .data = test_disk, .size = sizes[i], .max = 5000 };
+                copy = (CEfiPipelineCopy){ .dst = dst, .n_dst = sizes[i] };
+                c_efi_sha256(test_disk, sizes[i], digest);
+                stages[0] = (CEfiPipelineStage){ .start = test_source_start, .userdata = &src };
+                stages[1] = c_efi_pipeline_sha256_stage(&sha, digest);
+                stages[2] = c_efi_pipeline_copy_stage(&copy);
+
+                memset(dst, 0, 100000);
+                assert(!c_efi_pipeline_start(&p, stages, 3));
+                assert(!c_efi_pipeline_run(&p));
+                assert(!memcmp(dst, test_disk, sizes[i]));
+                assert(!memcmp(sha.digest, digest, sizeof(digest)));
+                assert(stages[2].stats.n_bytes == sizes[i]);
+                assert(stages[2].stats.n_buffers == (sizes[i] + 4999) / 5000);
+                assert(stages[0].stats.max_occupancy <= 1);
+                assert(stages[2].stats.max_occupancy <= 3);
+                assert(p.n_waits == 0);
+                assert(c_efi_pipeline_poll(&p) == C_EFI_SUCCESS);
+        }
+
+        /* the digest is verified at the end */
+        digest[0] ^= 1;
+        src = (TestSource){ .data = test_disk, .size = 100000, .max = 8192 };
+        copy = (CEfiPipelineCopy){ .dst = dst, .n_dst = 100000 };
+        stages[0] = (CEfiPipelineStage){ .start = test_source_start, .userdata = &src };
+        stages[1] = c_efi_pipeline_sha256_stage(&sha, digest);
+        stages[2] = c_efi_pipeline_copy_stage(&copy);
+        assert(!c_efi_pipeline_start(&p, stages, 3));
+        assert(c_efi_pipeline_run(&p) == C_EFI_SECURITY_VIOLATION);
+        assert(stages[2].stats.n_bytes == 100000);
+
+        /* a stream exceeding the destination fails */
+        src = (TestSource){ .data = test_disk, .size = 100000, .max = 8192 };
+        copy = (CEfiPipelineCopy){ .dst = dst, .n_dst = 50000 };
+        stages[1] = c_efi_pipeline_sha256_stage(&sha, NULL);
+        assert(!c_efi_pipeline_start(&p, stages, 3));
+        assert(c_efi_pipeline_run(&p) == C_EFI_BUFFER_TOO_SMALL);
+        assert(stages[2].stats.n_bytes == 49152);
+
+        /* a stage error ends the stream, and sticks */
+        src = (TestSource){ .data = test_disk, .size = 100000, .max = 8192 };
+        stages[1] = (CEfiPipelineStage){ .start = test_fail_start };
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(c_efi_pipeline_run(&p) == C_EFI_ABORTED);
+        assert(c_efi_pipeline_poll(&p) == C_EFI_ABORTED);
+        assert(stages[1].stats.n_buffers == 3);
+
+        c_efi_pipeline_deinit(&p);
+        assert(test_n_allocations == 0);
+        free(dst);
+}
+
+static void test_decompress(void) {
+        CEfiPipelineBuffer buffers[4];
+        CEfiPipelineStage stages[2];
+        CEfiU8 *frame, *dst, *workspace;
+        TestSource src;
+        CEfiPipeline p;
+        CEfiZstd *zstd;
+        CEfiLz4 lz4;
+        size_t n;
+
+        frame = malloc(300000);
+        dst = malloc(200000);
+        workspace = malloc(2 * C_EFI_ZSTD_BLOCK_MAX + 2 * C_EFI_ZSTD_LITERALS_SLACK);
+        zstd = malloc(sizeof(*zstd));
+        assert(frame && dst && workspace && zstd);
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 4, 16384));
+
+        /* LZ4 into the final destination, with frames split across buffers */
+        n = test_lz4_frame(test_disk, 200000, frame);
+        src = (TestSource){ .data = frame, .size = n, .max = 10000 };
+        c_efi_lz4_init(&lz4, 0, dst, 200000, NULL, 0);
+        stages[0] = (CEfiPipelineStage){ .start = test_source_start, .userdata = &src };
+        stages[1] = c_efi_pipeline_lz4_stage(&lz4);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(!c_efi_pipeline_run(&p));
+        assert(lz4.pos == 200000 && !memcmp(dst, test_disk, 200000));
+
+        /* a truncated stream is detected at the end */
+        src = (TestSource){ .data = frame, .size = n - 4, .max = 10000 };
+        c_efi_lz4_init(&lz4, 0, dst, 200000, NULL, 0);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(c_efi_pipeline_run(&p) == C_EFI_COMPROMISED_DATA);
+
+        /* and a destination that is too small while decoding */
+        src = (TestSource){ .data = frame, .size = n, .max = 10000 };
+        c_efi_lz4_init(&lz4, 0, dst, 100000, NULL, 0);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(c_efi_pipeline_run(&p) == C_EFI_BUFFER_TOO_SMALL);
+
+        /* zstd the same way */
+        n = test_zstd_frame(test_disk + 1, 200000, frame);
+        src = (TestSource){ .data = frame, .size = n, .max = 10000 };
+        c_efi_zstd_init(zstd, 0, dst, 200000, workspace, 2 * C_EFI_ZSTD_BLOCK_MAX + 2 * C_EFI_ZSTD_LITERALS_SLACK);
+        stages[1] = c_efi_pipeline_zstd_stage(zstd);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(!c_efi_pipeline_run(&p));
+        assert(zstd->pos == 200000 && !memcmp(dst, test_disk + 1, 200000));
+
+        src = (TestSource){ .data = frame, .size = n - 100, .max = 10000 };
+        c_efi_zstd_init(zstd, 0, dst, 200000, workspace, 2 * C_EFI_ZSTD_BLOCK_MAX + 2 * C_EFI_ZSTD_LITERALS_SLACK);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+        assert(c_efi_pipeline_run(&p) == C_EFI_COMPROMISED_DATA);
+
+        c_efi_pipeline_deinit(&p);
+        free(zstd);
+        free(workspace);
+        free(dst);
+        free(frame);
+}
+
+static void test_block(void) {
+        CEfiU8 digest[C_EFI_SHA256_DIGEST_SIZE], *dst;
+        CEfiPipelineBlockReader reader;
+        CEfiBlockQueueSlot slots[4];
+        CEfiPipelineBuffer buffers[6];
+        CEfiPipelineStage stages[3];
+        CEfiPipelineSha256 sha;
+        CEfiPipelineCopy copy;
+        CEfiPipeline p;
+
+        dst = malloc(TEST_SIZE);
+        assert(dst);
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 6, 16384));
+
+        assert(c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 4, 0, 100) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 0, 0, 0) == C_EFI_INVALID_PARAMETER);
+        test_media.block_size = 520;
+        assert(c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 4, 0, 0) == C_EFI_UNSUPPORTED);
+        test_media.block_size = TEST_BLOCK_SIZE;
+        test_create_limit = 2;
+        assert(c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 4, 0, 0) == C_EFI_OUT_OF_RESOURCES);
+        assert(test_n_open == 1);
+        test_create_limit = TEST_N_EVENTS;
+
+        /* the device stays busy, and the data arrives in order */
+        c_efi_sha256(test_disk + 7 * TEST_BLOCK_SIZE, 1000 * TEST_BLOCK_SIZE, digest);
+        assert(!c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 4, 7, 1000 * TEST_BLOCK_SIZE));
+        copy = (CEfiPipelineCopy){ .dst = dst, .n_dst = TEST_SIZE };
+        stages[0] = c_efi_pipeline_block_reader_stage(&reader);
+        stages[1] = c_efi_pipeline_sha256_stage(&sha, digest);
+        stages[2] = c_efi_pipeline_copy_stage(&copy);
+        test_max_requests = 0;
+        assert(!c_efi_pipeline_start(&p, stages, 3));
+        assert(!c_efi_pipeline_run(&p));
+        assert(!memcmp(dst, test_disk + 7 * TEST_BLOCK_SIZE, 1000 * TEST_BLOCK_SIZE));
+        assert(test_max_requests == 4);
+        assert(stages[0].stats.n_buffers == 32 && stages[0].stats.max_occupancy == 4);
+        assert(p.n_waits > 0 && test_n_requests == 0);
+
+        c_efi_pipeline_block_reader_deinit(&reader, &p);
+
+        /* a failed transaction aborts the pipeline, and deinit drains it */
+        assert(!c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 4, 0, TEST_SIZE));
+        stages[0] = c_efi_pipeline_block_reader_stage(&reader);
+        stages[1] = c_efi_pipeline_sha256_stage(&sha, NULL);
+        test_error_lba = 4 * 32;
+        test_transaction_error = C_EFI_DEVICE_ERROR;
+        assert(!c_efi_pipeline_start(&p, stages, 3));
+        assert(c_efi_pipeline_run(&p) == C_EFI_DEVICE_ERROR);
+        assert(stages[0].stats.n_buffers == 4);
+        test_error_lba = (CEfiLba)-1;
+
+        c_efi_pipeline_deinit(&p);
+        assert(test_n_requests == 0);
+        c_efi_pipeline_block_reader_deinit(&reader, &p);
+        c_efi_pipeline_block_reader_deinit(&reader, &p);
+        assert(test_n_open == 0 && test_n_allocations == 0);
+        free(dst);
+}
+
+static void test_cooperative(void) {
+        CEfiPipelineBlockReader reader;
+        CEfiBlockQueueSlot slots[2];
+        CEfiPipelineBuffer buffers[2];
+        CEfiPipelineStage stages[2];
+        CEfiPipelineSha256 sha;
+        CEfiUSize index;
+        CEfiPipeline p;
+        CEfiStatus r;
+        size_t n_idle = 0;
+
+        assert(!c_efi_pipeline_init(&p, &test_bs, NULL, buffers, 2, 4096));
+        assert(!c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 2, 0, 64 * TEST_BLOCK_SIZE));
+        stages[0] = c_efi_pipeline_block_reader_stage(&reader);
+        stages[1] = c_efi_pipeline_sha256_stage(&sha, NULL);
+        assert(!c_efi_pipeline_start(&p, stages, 2));
+
+        /* passes never block, idle ones ask for a wait on the wake event */
+        while ((r = c_efi_pipeline_poll(&p)) == C_EFI_NOT_READY) {
+                assert(test_n_requests <= 2);
+                if (p.idle) {
+                        ++n_idle;
+                        assert(test_n_requests > 0);
+                        assert(!test_bs.wait_for_event(1, &p.wake, &index));
+                }
+        }
+        assert(!r && n_idle >= 8 && p.n_waits == 0);
+        assert(stages[1].stats.n_bytes == 64 * TEST_BLOCK_SIZE);
+
+        c_efi_pipeline_deinit(&p);
+        c_efi_pipeline_block_reader_deinit(&reader, &p);
+        assert(test_n_open == 0 && test_n_allocations == 0);
+}
+
+static void test_stats(void) {
+        CEfiPipelineBlockReader reader;
+        CEfiBlockQueueSlot slots[2];
+        CEfiPipelineBuffer buffers[4];
+        CEfiPipelineStage stages[3];
+        CEfiPipeline p;
+
+        c_efi_clock_init(&test_clock, 1000000000);
+        assert(!c_efi_pipeline_init(&p, &test_bs, &test_clock, buffers, 4, 4096));
+        assert(!c_efi_pipeline_block_reader_init(&reader, &p, &test_bio, slots, 2, 0, 64 * 4096));
+
+        /* a slow middle stage fills the ring in front of it, and starves the sink */
+        test_instant = 1;
+        stages[0] = c_efi_pipeline_block_reader_stage(&reader);
+        stages[1] = (CEfiPipelineStage){ .start = test_spin_start, .userdata = (void *)(uintptr_t)200000 };
+        stages[2] = (CEfiPipelineStage){ .start = test_spin_start, .userdata = (void *)(uintptr_t)10000 };
+        assert(!c_efi_pipeline_start(&p, stages, 3));
+        assert(!c_efi_pipeline_run(&p));
+        test_instant = 0;
+
+        assert(c_efi_pipeline_bottleneck(&p) == 1);
+        assert(stages[1].stats.busy_ns >= 64 * 200000);
+        assert(stages[1].stats.busy_ns > 4 * stages[2].stats.busy_ns);
+        assert(stages[0].stats.blocked_ns > stages[1].stats.busy_ns / 2);
+        assert(stages[2].stats.starved_ns > stages[1].stats.busy_ns / 2);
+        assert(stages[1].stats.starved_ns < stages[1].stats.busy_ns / 4);
+        assert(stages[1].stats.max_occupancy >= 3);
+        assert(stages[1].stats.occupancy_ns > stages[2].stats.occupancy_ns * 2);
+        assert(p.total_ns >= stages[1].stats.busy_ns);
+
+        c_efi_pipeline_deinit(&p);
+        c_efi_pipeline_block_reader_deinit(&reader, &p);
+        assert(test_n_open == 0 && test_n_allocations == 0);
+}
+
+int main(int argc, char **argv) {
+        size_t i;
+
+        srand(9);
+        for (i = 0; i < sizeof(test_disk); ++i)
+                test_disk[i] = rand();
+
+        test_init();
+        test_sync();
+        test_decompress();
+        test_block();
+        test_cooperative();
+        test_stats();
+        return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Tests for Runtime Pointer Relocation
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-reloc.h"
+
+#define TEST_STRIDE 48 /* larger than sizeof(CEfiMemoryDescriptor) */
+#define TEST_FALLBACK_DELTA 0x7000000000
+
+static CEfiRelocRegistry test_registry;
+static unsigned int test_n_convert;
+static unsigned int test_n_svam;
+
+static CEfiStatus CEFICALL test_convert_pointer(CEfiUSize debug_disposition, void **address) {
+        ++test_n_convert;
+        if ((uintptr_t)*address >= 0xf0000000)
+                return C_EFI_NOT_FOUND;
+
+        *address = (void *)((uintptr_t)*address + TEST_FALLBACK_DELTA);
+        return C_EFI_SUCCESS;
+}
+
+/* firmware signals the address change from within the service */
+static CEfiStatus CEFICALL test_set_virtual_address_map(CEfiUSize memory_map_size,
+                                                        CEfiUSize descriptor_size,
+                                                        CEfiU32 descriptor_version,
+                                                        CEfiMemoryDescriptor *virtual_map) {
+        ++test_n_svam;
+        c_efi_reloc_notify(C_EFI_NULL, &test_registry);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiRuntimeServices test_rt = {
+        .hdr = {
+                .header_size = sizeof(CEfiRuntimeServices),
+        },
+        .set_virtual_address_map = test_set_virtual_address_map,
+        .convert_pointer = test_convert_pointer,
+};
+
+static void test_put(void *array, CEfiUSize i, CEfiPhysicalAddress start, CEfiU64 pages, CEfiVirtualAddress virt, CEfiU64 attribute) {
+        CEfiMemoryDescriptor *d = (void *)((CEfiU8 *)array + i * TEST_STRIDE);
+
+        *d = (CEfiMemoryDescriptor){
+                .type = C_EFI_RUNTIME_SERVICES_DATA,
+                .physical_start = start,
+                .virtual_start = virt,
+                .number_of_pages = pages,
+                .attribute = attribute,
+        };
+}
+
+static void test_apply(void) {
+        _Alignas(8) CEfiU8 map[4 * TEST_STRIDE] = { 0 };
+        CEfiMemoryRange ranges[3];
+        CEfiU64 deltas[3];
+        void **slots[8], *p[8];
+        CEfiUSize i;
+
+        c_efi_reloc_init(&test_registry, &test_rt, slots, 8, ranges, deltas, 3);
+        assert(test_registry.status == C_EFI_NOT_READY);
+
+        /* unsorted, with a boot-services range that must be ignored */
+        test_put(map, 0, 0x300000, 2, C_EFI_U64_C(0xffffffff80300000), C_EFI_MEMORY_RUNTIME);
+        test_put(map, 1, 0x100000, 1, C_EFI_U64_C(0xffffffff80000000), C_EFI_MEMORY_RUNTIME);
+        test_put(map, 2, 0x200000, 1, 0, C_EFI_MEMORY_WB);
+        test_put(map, 3, 0x101000, 1, 0x101000, C_EFI_MEMORY_RUNTIME);
+
+        assert(c_efi_reloc_set_map(&test_registry, sizeof(map), 44, (void *)map) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_reloc_set_map(&test_registry, sizeof(map), TEST_STRIDE, (void *)map));
+        assert(test_registry.n_ranges == 3);
+        assert(ranges[0].start == 0x100000 && ranges[1].start == 0x101000 && ranges[2].start == 0x300000);
+        assert(deltas[0] == C_EFI_U64_C(0xffffffff80000000) - 0x100000 && deltas[1] == 0);
+        assert(deltas[2] == C_EFI_U64_C(0xffffffff80000000));
+
+        p[0] = (void *)0x100010;        /* first range */
+        p[1] = (void *)0x101ff8;        /* identity range */
+        p[2] = (void *)0x301234;        /* second page of the last range */
+        p[3] = C_EFI_NULL;              /* optional pointer */
+        p[4] = (void *)0x200000;        /* not runtime, converted by firmware */
+        p[5] = (void *)0x100020;        /* back to the first range */
+        for (i = 0; i < 6; ++i)
+                assert(!c_efi_reloc_register(&test_registry, &p[i]));
+
+        test_n_convert = 0;
+        assert(!c_efi_reloc_apply(&test_registry));
+        assert(p[0] == (void *)C_EFI_U64_C(0xffffffff80000010));
+        assert(p[1] == (void *)0x101ff8);
+        assert(p[2] == (void *)C_EFI_U64_C(0xffffffff80301234));
+        assert(!p[3]);
+        assert(p[4] == (void *)(0x200000 + TEST_FALLBACK_DELTA));
+        assert(p[5] == (void *)C_EFI_U64_C(0xffffffff80000020));
+        assert(test_n_convert == 1 && test_registry.n_fallback == 1);
+
+        /* registrations are consumed */
+        assert(!test_registry.n_slots && !test_registry.status);
+
+        /* without a map, everything falls back, and errors are reported */
+        p[0] = (void *)0x100010;
+        p[1] = (void *)0xf0000000;
+        p[2] = (void *)0x100020;
+        for (i = 0; i < 3; ++i)
+                assert(!c_efi_reloc_register(&test_registry, &p[i]));
+        test_put(map, 2, 0x200000, 1, 0, C_EFI_MEMORY_RUNTIME);
+        assert(c_efi_reloc_set_map(&test_registry, sizeof(map), TEST_STRIDE, (void *)map) == C_EFI_BUFFER_TOO_SMALL);
+        assert(!test_registry.n_ranges);
+        assert(c_efi_reloc_apply(&test_registry) == C_EFI_NOT_FOUND);
+        assert(test_registry.status == C_EFI_NOT_FOUND && test_registry.n_fallback == 3);
+        assert(p[0] == (void *)(0x100010 + TEST_FALLBACK_DELTA));
+        assert(p[2] == (void *)(0x100020 + TEST_FALLBACK_DELTA));
+
+        /* a slot registered twice is relocated once, in any order */
+        test_put(map, 0, 0x100000, 1, 0x200000, C_EFI_MEMORY_RUNTIME);
+        test_put(map, 1, 0x200000, 1, 0x900000, C_EFI_MEMORY_RUNTIME);
+        test_put(map, 2, 0, 0, 0, 0);
+        test_put(map, 3, 0, 0, 0, 0);
+        assert(!c_efi_reloc_set_map(&test_registry, sizeof(map), TEST_STRIDE, (void *)map));
+        p[0] = (void *)0x100010;
+        p[1] = (void *)0x100020;
+        p[2] = (void *)0x200030;
+        assert(!c_efi_reloc_register(&test_registry, &p[2]));
+        assert(!c_efi_reloc_register(&test_registry, &p[0]));
+        assert(!c_efi_reloc_register(&test_registry, &p[1]));
+        assert(!c_efi_reloc_register(&test_registry, &p[0]));
+        assert(!c_efi_reloc_register(&test_registry, &p[2]));
+        assert(!c_efi_reloc_register(&test_registry, &p[0]));
+        test_n_convert = 0;
+        assert(!c_efi_reloc_apply(&test_registry));
+        assert(p[0] == (void *)0x200010);
+        assert(p[1] == (void *)0x200020);
+        assert(p[2] == (void *)0x900030);
+        assert(!test_n_convert && !test_registry.n_slots);
+
+        /* a full registry */
+        for (i = 0; i < 8; ++i)
+                assert(!c_efi_reloc_register(&test_registry, &p[i]));
+        assert(c_efi_reloc_register(&test_registry, &p[0]) == C_EFI_OUT_OF_RESOURCES);
+        assert(test_registry.n_slots == 8);
+}
+
+static void test_hook(void) {
+        _Alignas(8) CEfiU8 map[2 * TEST_STRIDE] = { 0 };
+        CEfiMemoryRange ranges[2];
+        CEfiU64 deltas[2];
+        void **slots[4], *p;
+        CEfiPhysicalAddress code;
+        CEfiU32 crc;
+
+        c_efi_reloc_init(&test_registry, &test_rt, slots, 4, ranges, deltas, 2);
+        assert(!c_efi_reloc_hook(&test_registry));
+        assert(c_efi_reloc_hook(&test_registry) == C_EFI_ALREADY_STARTED);
+        assert(test_rt.set_virtual_address_map != test_set_virtual_address_map);
+
+        crc = test_rt.hdr.crc32;
+        test_rt.hdr.crc32 = 0;
+        assert(crc == c_efi_crc32(0, &test_rt, sizeof(test_rt)));
+        test_rt.hdr.crc32 = crc;
+
+        /* map the test code 1:1, so the chained service stays callable */
+        code = (uintptr_t)test_set_virtual_address_map & ~(CEfiPhysicalAddress)0xfff;
+        test_put(map, 0, code, 2, code, C_EFI_MEMORY_RUNTIME);
+        test_put(map, 1, 0x100000, 1, 0x80100000, C_EFI_MEMORY_RUNTIME);
+
+        p = (void *)0x100008;
+        assert(!c_efi_reloc_register(&test_registry, &p));
+
+        test_n_convert = 0;
+        test_n_svam = 0;
+        assert(!test_rt.set_virtual_address_map(sizeof(map), TEST_STRIDE, C_EFI_MEMORY_DESCRIPTOR_VERSION, (void *)map));
+        assert(test_n_svam == 1 && !test_n_convert);
+        assert(!test_registry.status && test_registry.n_ranges == 2);
+        assert(p == (void *)0x80100008);
+
+        /* later calls go straight to the firmware */
+        assert(!test_rt.set_virtual_address_map(sizeof(map), TEST_STRIDE, C_EFI_MEMORY_DESCRIPTOR_VERSION, (void *)map));
+        assert(test_n_svam == 2 && p == (void *)0x80100008);
+}
+
+int main(int argc, char **argv) {
+        test_apply();
+        test_hook();
+        return 0;
+}
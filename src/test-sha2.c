@@ -0,0 +1,249 @@
+/*
+ * Tests for SHA-256 and SHA-384 Hashes
+ *
+ * The digests were computed with Python's hashlib (OpenSSL). The kernels are
+ * also checked against each other, since the dispatcher only exercises the
+ * best one the CPU supports.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-sha2.h"
+
+#define TEST_SIZE 100000
+
+typedef struct TestVector {
+        CEfiUSize n;
+        const char *sha256;
+        const char *sha384;
+} TestVector;
+
+static CEfiU8 test_buf[TEST_SIZE + 16];
+
+static void test_hex(const CEfiU8 *digest, CEfiUSize n, const char *hex) {
+        static const char digits[] = "0123456789abcdef";
+        CEfiUSize i;
+
+        assert(strlen(hex) == n * 2);
+        for (i = 0; i < n; ++i) {
+                assert(hex[i * 2] == digits[digest[i] >> 4]);
+                assert(hex[i * 2 + 1] == digits[digest[i] & 0xf]);
+        }
+}
+
+static void test_vectors(void) {
+        static const struct {
+                const char *message;
+                const char *sha256;
+                const char *sha384;
+        } nist[] = {
+                {
+                        "",
+                        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+                        "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b",
+                },
+                {
+                        "abc",
+                        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+                        "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7",
+                },
+                {
+                        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+                        "3391fdddfc8dc7393707a65b1b4709397cf8b1d162af05abfe8f450de5f36bc6b0455a8520bc4e6f5fe95b1fe3c8452b",
+                },
+                {
+                        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+                        "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+                        "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039",
+                },
+        };
+        /* prefixes of test_buf, around the padding boundaries */
+        static const TestVector vectors[] = {
+                { 55, "576a1bf8d4478657e6dc4af9398544765c2a92cde28478b019235cfed315fc09",
+                  "68a572a7629b55660e2b4403c105436ccf58c408a5a68695b16162666d5ea360ab361b631ae6683d5024cf973c0c5269" },
+                { 56, "9b20501dfd1d99161c257950f3444f3e49230c351c5c8e0943ef369f85f5205d",
+                  "7c1bb2be687d492dcd4d6edf1f9eee68829d8e348f9d812344f082c27c18c711d04a88abc1f0577203d060ff63678d5a" },
+                { 63, "30b345906b493f06f69444b6521113511c242f30e29840462950035043682f1e",
+                  "7e9118995a30ce02c6a3dd15dfd64736ae074abd614d1e467336f1aa06fc3c2cb886448fe50db05ce0121319893d1da6" },
+                { 64, "d8bc63b4fc1156e5e7d95a418b9bf54cd3174bedbc2db40f74895349b229b3c0",
+                  "a1b7ea028cb6abc58ee795f43c0ae1916d41fd9dc7210dbc24b56ad78ece7493f5b3137887ba4c9ad6f51f00b2ce7a73" },
+                { 111, "d80a22461ae74d8e6944001e255f9e47eca17702b1dc987238d78e6e1ea3e342",
+                  "0e07dbe3a06921ecf592290797728554366c98285033aa79394dd6f7a39e20d5acb14eb307cb4e3dc28bb99a122c43e7" },
+                { 112, "a4ecd1e6c38e9d976d0cef32d899be35eb83c98d46b4dbfd68a1560f83b786a2",
+                  "44716227fafa9d5b225200d1ac73a37c574dd7a890433be121e7aa2143a921a7282a49053bb5a921c2d11d89efe44e63" },
+                { 127, "67d79933e3c9aa8e89f481e071cfca1e9a16c09d7263b5efa3bb01f1a9f8d065",
+                  "101b507234e59db36edd7f903eb3adbf0b5a6abb3f305be500de8556d37d5b142a2736ac437a1eae9bc930d58ab12b21" },
+                { 128, "54c9eb041badfd7064645067b107661fed6113197ce2dd066ba69618abd3732f",
+                  "1f2e7f5020a66aaf910acce311ebeef5293d0b52cd6bc9ca281192c14ae35f1229cf8071ca311e282c3276b2a9a205d5" },
+                { 1000, "c85a431e0fe575b2609289d3a4042414715f400612575a125d2ce5573d608732",
+                  "358033b5fc73409a38b4035ffbbaf3096b7fed43cd5eefe43d779698af2e7e311664ae13f71671d900a7ac835b3553ac" },
+                { 100000, "55af394c980c7a7fb68aa904c4afdd93d76e5f826487105fc06f92a25bab8cbe",
+                  "dc5f16a53142d75b2a1ac5a0ea73d0702b75f71b5598ebc5ba47c6f4b4a27b94c0c8fa36ade53e4983e979871a75fe69" },
+        };
+        CEfiU8 d256[C_EFI_SHA256_DIGEST_SIZE], d384[C_EFI_SHA384_DIGEST_SIZE], *a;
+        CEfiSha256 s256;
+        CEfiSha384 s384;
+        CEfiUSize i;
+
+        for (i = 0; i < sizeof(nist) / sizeof(*nist); ++i) {
+                c_efi_sha256(nist[i].message, strlen(nist[i].message), d256);
+                test_hex(d256, sizeof(d256), nist[i].sha256);
+                c_efi_sha384(nist[i].message, strlen(nist[i].message), d384);
+                test_hex(d384, sizeof(d384), nist[i].sha384);
+        }
+
+        for (i = 0; i < sizeof(vectors) / sizeof(*vectors); ++i) {
+                c_efi_sha256(test_buf, vectors[i].n, d256);
+                test_hex(d256, sizeof(d256), vectors[i].sha256);
+                c_efi_sha384(test_buf, vectors[i].n, d384);
+                test_hex(d384, sizeof(d384), vectors[i].sha384);
+        }
+
+        /* one million times 'a', in uneven pieces */
+        a = malloc(1000000);
+        assert(a);
+        memset(a, 'a', 1000000);
+        c_efi_sha256_init(&s256);
+        c_efi_sha384_init(&s384);
+        for (i = 0; i < 1000000; i += 4099) {
+                c_efi_sha256_update(&s256, a + i, 1000000 - i < 4099 ? 1000000 - i : 4099);
+                c_efi_sha384_update(&s384, a + i, 1000000 - i < 4099 ? 1000000 - i : 4099);
+        }
+        c_efi_sha256_final(&s256, d256);
+        c_efi_sha384_final(&s384, d384);
+        test_hex(d256, sizeof(d256), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        test_hex(d384, sizeof(d384),
+                 "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985");
+        free(a);
+}
+
+static void test_kernels(void) {
+        static const CEfiU32 init[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        CEfiU32 s[8], r[8];
+        CEfiUSize off, n;
+
+        /* all kernels against the scalar one, at all alignments */
+        for (off = 0; off < 16; ++off) {
+                for (n = 0; n <= 64; n += (n < 8 ? 1 : 19)) {
+                        memcpy(r, init, sizeof(r));
+                        c_efi_sha256_blocks_scalar(r, test_buf + off, n);
+                        memcpy(s, init, sizeof(s));
+                        c_efi_sha256_blocks(s, test_buf + off, n);
+                        assert(!memcmp(s, r, sizeof(s)));
+#if defined(__aarch64__) || (defined(__x86_64__) && defined(__SSE2__))
+                        if (c_efi_sha256_has_insn()) {
+                                memcpy(s, init, sizeof(s));
+                                c_efi_sha256_blocks_insn(s, test_buf + off, n);
+                                assert(!memcmp(s, r, sizeof(s)));
+                        }
+#endif
+                }
+        }
+}
+
+static void test_incremental(void) {
+        CEfiU8 d[C_EFI_SHA384_DIGEST_SIZE], e[C_EFI_SHA384_DIGEST_SIZE];
+        CEfiSha256 s256;
+        CEfiSha384 s384;
+        CEfiUSize i, step;
+
+        /* incremental updates equal a single pass, for any split */
+        for (step = 1; step <= 300; step += (step < 20 ? 1 : 37)) {
+                c_efi_sha256_init(&s256);
+                c_efi_sha384_init(&s384);
+                for (i = 0; i < 5000; i += step) {
+                        c_efi_sha256_update(&s256, test_buf + i, 5000 - i < step ? 5000 - i : step);
+                        c_efi_sha384_update(&s384, test_buf + i, 5000 - i < step ? 5000 - i : step);
+                }
+
+                c_efi_sha256_final(&s256, d);
+                c_efi_sha256(test_buf, 5000, e);
+                assert(!memcmp(d, e, C_EFI_SHA256_DIGEST_SIZE));
+                c_efi_sha384_final(&s384, d);
+                c_efi_sha384(test_buf, 5000, e);
+                assert(!memcmp(d, e, C_EFI_SHA384_DIGEST_SIZE));
+        }
+}
+
+static void test_multi(void) {
+        static const CEfiUSize sizes[] = { 0, 1, 63, 64, 65, 127, 128, 129, 1000, 4096, 7777, 20000, 3 };
+        CEfiU8 d[C_EFI_SHA384_DIGEST_SIZE], e[C_EFI_SHA384_DIGEST_SIZE];
+        CEfiSha256 s256[13], *p256[13];
+        CEfiSha384 s384[13], *p384[13];
+        const void *data[13];
+        CEfiUSize i, k, count, head, n[13];
+
+        /* any number of messages, of different sizes, with partial blocks buffered */
+        for (count = 1; count <= 13; ++count) {
+                for (head = 0; head < 3; ++head) {
+                        for (i = 0; i < count; ++i) {
+                                c_efi_sha256_init(&s256[i]);
+                                c_efi_sha384_init(&s384[i]);
+                                k = head * (i + 5) % 11;
+                                c_efi_sha256_update(&s256[i], test_buf + i, k);
+                                c_efi_sha384_update(&s384[i], test_buf + i, k);
+                                p256[i] = &s256[i];
+                                p384[i] = &s384[i];
+                                data[i] = test_buf + i + k;
+                                n[i] = sizes[(i + count) % 13];
+                        }
+
+                        c_efi_sha256_update_multi(p256, data, n, count);
+                        c_efi_sha384_update_multi(p384, data, n, count);
+
+                        for (i = 0; i < count; ++i) {
+                                k = head * (i + 5) % 11;
+                                c_efi_sha256_final(&s256[i], d);
+                                c_efi_sha256(test_buf + i, k + n[i], e);
+                                assert(!memcmp(d, e, C_EFI_SHA256_DIGEST_SIZE));
+                                c_efi_sha384_final(&s384[i], d);
+                                c_efi_sha384(test_buf + i, k + n[i], e);
+                                assert(!memcmp(d, e, C_EFI_SHA384_DIGEST_SIZE));
+                        }
+                }
+        }
+
+#if defined(__x86_64__) && defined(__SSE2__)
+        /* the lane kernels, which CPUs with SHA instructions skip for SHA-256 */
+        for (k = 0; k <= c_efi_sha2_has_avx2(); ++k) {
+                for (i = 0; i < 8; ++i) {
+                        c_efi_sha256_init(&s256[i]);
+                        c_efi_sha384_init(&s384[i]);
+                        p256[i] = &s256[i];
+                        p384[i] = &s384[i];
+                        data[i] = test_buf + i * 3;
+                        n[i] = sizes[i + 3];
+                }
+
+                for (i = 0; i < 8; i += k ? 8 : 4)
+                        c_efi_sha256_lanes(p256 + i, data + i, n + i, k ? 8 : 4, k);
+                for (i = 0; i < 8; i += k ? 4 : 2)
+                        c_efi_sha384_lanes(p384 + i, data + i, n + i, k ? 4 : 2, k);
+
+                for (i = 0; i < 8; ++i) {
+                        c_efi_sha256_final(&s256[i], d);
+                        c_efi_sha256(data[i], n[i], e);
+                        assert(!memcmp(d, e, C_EFI_SHA256_DIGEST_SIZE));
+                        c_efi_sha384_final(&s384[i], d);
+                        c_efi_sha384(data[i], n[i], e);
+                        assert(!memcmp(d, e, C_EFI_SHA384_DIGEST_SIZE));
+                }
+        }
+#endif
+}
+
+int main(int argc, char **argv) {
+        CEfiUSize i;
+
+        for (i = 0; i < sizeof(test_buf); ++i)
+                test_buf[i] = (CEfiU8)(i * 7 + (i >> 8));
+
+        test_vectors();
+        test_kernels();
+        test_incremental();
+        test_multi();
+        return 0;
+}
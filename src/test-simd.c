@@ -0,0 +1,83 @@
+/*
+ * Tests for SIMD State Initialization
+ *
+ * The control register helpers need ring 0 and cannot run natively. This
+ * covers feature detection and saving/restoring the register file, which are
+ * unprivileged.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-simd.h"
+
+#if defined(__x86_64__)
+
+static CEfiU32 test_get_mxcsr(void) {
+        CEfiU32 v;
+
+        __asm__ __volatile__ ("stmxcsr %0" : "=m" (v));
+        return v;
+}
+
+static void test_set_mxcsr(CEfiU32 v) {
+        __asm__ __volatile__ ("ldmxcsr %0" : : "m" (v));
+}
+
+static void test_frame(CEfiU32 features) {
+        static const CEfiU8 pattern[16] = "0123456789abcdef";
+        CEfiU8 out[16];
+        CEfiSimdFrame frame;
+        CEfiU32 mxcsr;
+
+        mxcsr = test_get_mxcsr();
+
+        /* round-toward-zero and a marker in xmm7 */
+        test_set_mxcsr(C_EFI_SIMD_MXCSR_DEFAULT | 0x6000);
+        __asm__ __volatile__ ("movdqu %0, %%xmm7" : : "m" (pattern) : "xmm7");
+
+        c_efi_simd_save(&frame, features);
+        assert(frame.features == features);
+        assert(!!frame.mask == !!(features & C_EFI_SIMD_AVX));
+
+        test_set_mxcsr(C_EFI_SIMD_MXCSR_DEFAULT);
+        __asm__ __volatile__ ("pxor %%xmm7, %%xmm7" : : : "xmm7");
+
+        c_efi_simd_load(&frame);
+
+        __asm__ __volatile__ ("movdqu %%xmm7, %0" : "=m" (out));
+        assert(test_get_mxcsr() == (C_EFI_SIMD_MXCSR_DEFAULT | 0x6000));
+        assert(!memcmp(out, pattern, sizeof(out)));
+
+        test_set_mxcsr(mxcsr);
+}
+
+static void test_simd(void) {
+        CEfiU32 features;
+
+        features = c_efi_simd_cpu_features();
+        assert(features & C_EFI_SIMD_SSE2);
+        if (features & C_EFI_SIMD_AVX2)
+                assert(features & C_EFI_SIMD_AVX);
+
+        test_frame(C_EFI_SIMD_SSE2);
+        if (features & C_EFI_SIMD_AVX)
+                test_frame(C_EFI_SIMD_SSE2 | C_EFI_SIMD_AVX);
+}
+
+#else
+
+static void test_simd(void) {
+        CEfiSimdState state;
+
+        assert(!c_efi_simd_cpu_features());
+        assert(c_efi_simd_enable(&state, C_EFI_SIMD_SSE2) == C_EFI_UNSUPPORTED);
+        assert(!state.features);
+}
+
+#endif
+
+int main(int argc, char **argv) {
+        test_simd();
+        return 0;
+}
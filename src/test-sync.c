@@ -0,0 +1,278 @@
+/*
+ * Tests for Cross-Processor Synchronization
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-sync.h"
+
+#define TEST_N_THREADS 4
+#define TEST_N_LOCKS 2000
+#define TEST_N_ENTRIES 100000
+
+static CEfiTpl test_tpl = C_EFI_TPL_APPLICATION;
+static size_t test_n_raises;
+
+static CEfiTpl CEFICALL test_raise_tpl(CEfiTpl new_tpl) {
+        CEfiTpl old = test_tpl;
+
+        assert(new_tpl >= test_tpl);
+        test_tpl = new_tpl;
+        ++test_n_raises;
+        return old;
+}
+
+static void CEFICALL test_restore_tpl(CEfiTpl old_tpl) {
+        assert(old_tpl <= test_tpl);
+        test_tpl = old_tpl;
+}
+
+static CEfiBootServices test_bs = {
+        .raise_tpl = test_raise_tpl,
+        .restore_tpl = test_restore_tpl,
+};
+
+typedef struct TestShared {
+        CEfiSpinLock lock;
+        CEfiSpscQueue spsc;
+        CEfiMpscQueue mpsc;
+        unsigned long counter;
+        unsigned long inside;
+        CEfiUSize n_entries;
+} TestShared;
+
+typedef struct TestThread {
+        pthread_t thread;
+        TestShared *shared;
+        CEfiUSize id;
+} TestThread;
+
+static void test_lock_basic(void) {
+        CEfiSpinLock lock = C_EFI_SPIN_LOCK_INIT;
+        CEfiTpl old;
+
+        c_efi_spin_lock(&lock);
+        assert(!c_efi_spin_trylock(&lock));
+        c_efi_spin_unlock(&lock);
+        assert(c_efi_spin_trylock(&lock));
+        c_efi_spin_unlock(&lock);
+        assert(lock.n_acquired == 2 && !lock.n_contended && !lock.n_spins);
+
+        /* tickets wrap around */
+        lock = (CEfiSpinLock){ .next = UINT32_MAX, .owner = UINT32_MAX };
+        c_efi_spin_lock(&lock);
+        assert(!c_efi_spin_trylock(&lock));
+        c_efi_spin_unlock(&lock);
+        assert(lock.next == 0 && lock.owner == 0);
+        assert(c_efi_spin_trylock(&lock));
+        c_efi_spin_unlock(&lock);
+
+        /* the TPL is raised around the lock */
+        old = c_efi_spin_lock_tpl(&lock, &test_bs, C_EFI_TPL_NOTIFY);
+        assert(old == C_EFI_TPL_APPLICATION && test_tpl == C_EFI_TPL_NOTIFY);
+        assert(!c_efi_spin_trylock(&lock));
+        c_efi_spin_unlock_tpl(&lock, &test_bs, old);
+        assert(test_tpl == C_EFI_TPL_APPLICATION && test_n_raises == 1);
+}
+
+static void *test_lock_thread(void *userdata) {
+        TestThread *t = userdata;
+        TestShared *s = t->shared;
+        size_t i;
+
+        for (i = 0; i < TEST_N_LOCKS; ++i) {
+                if (i % 8 == 7) {
+                        while (!c_efi_spin_trylock(&s->lock))
+                                sched_yield();
+                } else {
+                        c_efi_spin_lock(&s->lock);
+                }
+
+                /* plain accesses, any overlap would lose updates */
+                assert(++s->inside == 1);
+                ++s->counter;
+                --s->inside;
+                c_efi_spin_unlock(&s->lock);
+        }
+
+        return NULL;
+}
+
+static void test_lock_stress(void) {
+        TestThread threads[TEST_N_THREADS];
+        TestShared *s;
+        size_t i;
+
+        s = calloc(1, sizeof(*s));
+        assert(s);
+
+        for (i = 0; i < TEST_N_THREADS; ++i) {
+                threads[i] = (TestThread){ .shared = s, .id = i };
+                assert(!pthread_create(&threads[i].thread, NULL, test_lock_thread, &threads[i]));
+        }
+        for (i = 0; i < TEST_N_THREADS; ++i)
+                assert(!pthread_join(threads[i].thread, NULL));
+
+        assert(s->counter == TEST_N_THREADS * TEST_N_LOCKS);
+        assert(s->lock.n_acquired == TEST_N_THREADS * TEST_N_LOCKS);
+        assert(s->lock.n_contended <= s->lock.n_acquired);
+        assert(s->lock.n_contended <= s->lock.n_spins);
+        assert(s->lock.next == s->lock.owner);
+        free(s);
+}
+
+static void test_spsc_basic(void) {
+        CEfiUSize slots[4], v;
+        CEfiSpscQueue q;
+        size_t i;
+
+        assert(c_efi_spsc_init(&q, slots, 0) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_spsc_init(&q, slots, 3) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_spsc_init(&q, slots, 4));
+
+        assert(c_efi_spsc_pop(&q, &v) == C_EFI_NOT_READY);
+        for (i = 0; i < 4; ++i)
+                assert(!c_efi_spsc_push(&q, i + 10));
+        assert(c_efi_spsc_push(&q, 99) == C_EFI_OUT_OF_RESOURCES);
+        for (i = 0; i < 4; ++i) {
+                assert(!c_efi_spsc_pop(&q, &v));
+                assert(v == i + 10);
+        }
+        assert(c_efi_spsc_pop(&q, &v) == C_EFI_NOT_READY);
+        assert(q.n_full == 1 && q.n_empty == 2);
+
+        /* indices wrap around */
+        q.head = q.tail = q.head_cache = q.tail_cache = (CEfiUSize)-2;
+        for (i = 0; i < 10; ++i) {
+                assert(!c_efi_spsc_push(&q, i));
+                assert(!c_efi_spsc_push(&q, i + 100));
+                assert(!c_efi_spsc_pop(&q, &v) && v == i);
+                assert(!c_efi_spsc_pop(&q, &v) && v == i + 100);
+        }
+}
+
+static void *test_spsc_thread(void *userdata) {
+        TestShared *s = userdata;
+        CEfiUSize i;
+
+        for (i = 0; i < s->n_entries; ++i)
+                while (c_efi_spsc_push(&s->spsc, i))
+                        sched_yield();
+
+        return NULL;
+}
+
+static void test_spsc_stress(void) {
+        CEfiUSize slots[16], v, i;
+        pthread_t thread;
+        TestShared *s;
+
+        s = calloc(1, sizeof(*s));
+        assert(s);
+        s->n_entries = TEST_N_ENTRIES;
+        assert(!c_efi_spsc_init(&s->spsc, slots, 16));
+
+        assert(!pthread_create(&thread, NULL, test_spsc_thread, s));
+        for (i = 0; i < TEST_N_ENTRIES; ++i) {
+                while (c_efi_spsc_pop(&s->spsc, &v))
+                        sched_yield();
+                assert(v == i);
+        }
+        assert(!pthread_join(thread, NULL));
+
+        assert(c_efi_spsc_pop(&s->spsc, &v) == C_EFI_NOT_READY);
+        free(s);
+}
+
+static void test_mpsc_basic(void) {
+        CEfiMpscCell cells[4];
+        CEfiMpscQueue q;
+        CEfiUSize v;
+        size_t i;
+
+        assert(c_efi_mpsc_init(&q, cells, 0) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_mpsc_init(&q, cells, 6) == C_EFI_INVALID_PARAMETER);
+        assert(!c_efi_mpsc_init(&q, cells, 4));
+
+        assert(c_efi_mpsc_pop(&q, &v) == C_EFI_NOT_READY);
+        for (i = 0; i < 4; ++i)
+                assert(!c_efi_mpsc_push(&q, i + 10));
+        assert(c_efi_mpsc_push(&q, 99) == C_EFI_OUT_OF_RESOURCES);
+        for (i = 0; i < 4; ++i) {
+                assert(!c_efi_mpsc_pop(&q, &v));
+                assert(v == i + 10);
+        }
+        assert(c_efi_mpsc_pop(&q, &v) == C_EFI_NOT_READY);
+        assert(q.n_full == 1 && q.n_empty == 2 && !q.n_retries);
+
+        /* a claimed but unpublished cell holds back the consumer */
+        assert(!c_efi_mpsc_push(&q, 1));
+        ++q.tail;
+        assert(!c_efi_mpsc_push(&q, 3));
+        assert(!c_efi_mpsc_pop(&q, &v) && v == 1);
+        assert(c_efi_mpsc_pop(&q, &v) == C_EFI_NOT_READY);
+        cells[5 & 3] = (CEfiMpscCell){ .sequence = 6, .value = 2 };
+        assert(!c_efi_mpsc_pop(&q, &v) && v == 2);
+        assert(!c_efi_mpsc_pop(&q, &v) && v == 3);
+}
+
+static void *test_mpsc_thread(void *userdata) {
+        TestThread *t = userdata;
+        TestShared *s = t->shared;
+        CEfiUSize i;
+
+        for (i = 0; i < s->n_entries; ++i)
+                while (c_efi_mpsc_push(&s->mpsc, t->id * s->n_entries + i))
+                        sched_yield();
+
+        return NULL;
+}
+
+static void test_mpsc_stress(void) {
+        CEfiUSize next[TEST_N_THREADS] = { 0 }, v, i, id;
+        TestThread threads[TEST_N_THREADS];
+        CEfiMpscCell cells[64];
+        TestShared *s;
+
+        s = calloc(1, sizeof(*s));
+        assert(s);
+        s->n_entries = TEST_N_ENTRIES / TEST_N_THREADS;
+        assert(!c_efi_mpsc_init(&s->mpsc, cells, 64));
+
+        for (i = 0; i < TEST_N_THREADS; ++i) {
+                threads[i] = (TestThread){ .shared = s, .id = i };
+                assert(!pthread_create(&threads[i].thread, NULL, test_mpsc_thread, &threads[i]));
+        }
+
+        /* entries of each producer arrive in order */
+        for (i = 0; i < TEST_N_THREADS * s->n_entries; ++i) {
+                while (c_efi_mpsc_pop(&s->mpsc, &v))
+                        sched_yield();
+                id = v / s->n_entries;
+                assert(id < TEST_N_THREADS);
+                assert(v % s->n_entries == next[id]++);
+        }
+        for (i = 0; i < TEST_N_THREADS; ++i) {
+                assert(!pthread_join(threads[i].thread, NULL));
+                assert(next[i] == s->n_entries);
+        }
+
+        assert(c_efi_mpsc_pop(&s->mpsc, &v) == C_EFI_NOT_READY);
+        free(s);
+}
+
+int main(int argc, char **argv) {
+        test_lock_basic();
+        test_lock_stress();
+        test_spsc_basic();
+        test_spsc_stress();
+        test_mpsc_basic();
+        test_mpsc_stress();
+        return 0;
+}
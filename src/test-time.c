@@ -0,0 +1,125 @@
+/*
+ * Tests for Time Conversion and Cached Wall-Clock
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include "c-efi.h"
+#include "c-efi-time.h"
+
+static CEfiTime test_now;
+static unsigned int test_n_get_time;
+
+static CEfiStatus CEFICALL test_get_time(CEfiTime *time, CEfiTimeCapabilities *capabilities) {
+        ++test_n_get_time;
+        *time = test_now;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiRuntimeServices test_rt = {
+        .get_time = test_get_time,
+};
+
+static void test_convert(void) {
+        CEfiTime t, u;
+        struct tm tm;
+        CEfiUSize i;
+        CEfiI64 ns;
+        time_t s;
+
+        /* the epoch, leap days, and the extremes of the 64-bit range */
+        t = (CEfiTime){ .year = 1970, .month = 1, .day = 1 };
+        assert(!c_efi_time_to_epoch_ns(&t, &ns) && ns == 0);
+        t = (CEfiTime){ .year = 2000, .month = 2, .day = 29, .hour = 12, .nanosecond = 5 };
+        assert(!c_efi_time_to_epoch_ns(&t, &ns) && ns == C_EFI_I64_C(951825600000000005));
+        t = (CEfiTime){ .year = 1900, .month = 1, .day = 1 };
+        assert(!c_efi_time_to_epoch_ns(&t, &ns) && ns == C_EFI_I64_C(-2208988800) * 1000000000);
+        assert(!c_efi_time_from_epoch_ns(ns, 0, 0, &u));
+        assert(u.year == 1900 && u.month == 1 && u.day == 1 && !u.hour);
+        t = (CEfiTime){ .year = 2262, .month = 4, .day = 11 };
+        assert(!c_efi_time_to_epoch_ns(&t, &ns));
+        t = (CEfiTime){ .year = 2262, .month = 4, .day = 12 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_UNSUPPORTED);
+        assert(c_efi_time_from_epoch_ns(C_EFI_I64_C(-2208988800) * 1000000000 - 1, 0, 0, &u) == C_EFI_UNSUPPORTED);
+
+        /* invalid times */
+        t = (CEfiTime){ .year = 1900, .month = 2, .day = 29 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_INVALID_PARAMETER);
+        t = (CEfiTime){ .year = 2023, .month = 13, .day = 1 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_INVALID_PARAMETER);
+        t = (CEfiTime){ .year = 2023, .month = 4, .day = 31 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_INVALID_PARAMETER);
+        t = (CEfiTime){ .year = 2023, .month = 1, .day = 1, .nanosecond = 1000000000 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_INVALID_PARAMETER);
+        t = (CEfiTime){ .year = 2023, .month = 1, .day = 1, .timezone = 1441 };
+        assert(c_efi_time_to_epoch_ns(&t, &ns) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_time_from_epoch_ns(0, -1441, 0, &u) == C_EFI_INVALID_PARAMETER);
+
+        /* timezones and daylight saving are applied as local offsets */
+        t = (CEfiTime){ .year = 2024, .month = 3, .day = 1, .hour = 1, .timezone = 120 };
+        assert(!c_efi_time_to_epoch_ns(&t, &ns));
+        assert(!c_efi_time_from_epoch_ns(ns, 0, 0, &u));
+        assert(u.year == 2024 && u.month == 2 && u.day == 29 && u.hour == 23);
+        t.daylight = C_EFI_TIME_ADJUST_DAYLIGHT | C_EFI_TIME_IN_DAYLIGHT;
+        assert(!c_efi_time_to_epoch_ns(&t, &ns));
+        assert(!c_efi_time_from_epoch_ns(ns, C_EFI_UNSPECIFIED_TIMEZONE, 0, &u));
+        assert(u.day == 29 && u.hour == 22 && u.timezone == C_EFI_UNSPECIFIED_TIMEZONE);
+        assert(!c_efi_time_from_epoch_ns(ns, 120, t.daylight, &u));
+        assert(u.day == 1 && u.hour == 1 && u.timezone == 120 && u.daylight == t.daylight);
+
+        /* compare against the C library over the whole supported range */
+        srand(1);
+        for (i = 0; i < 100000; ++i) {
+                s = (time_t)((((CEfiI64)rand() << 31) ^ rand()) % (C_EFI_I64_C(9200000000) + 2208988800)) - 2208988800;
+                ns = (CEfiI64)s * 1000000000 + rand() % 1000000000;
+                assert(gmtime_r(&s, &tm));
+
+                assert(!c_efi_time_from_epoch_ns(ns, 0, 0, &t));
+                assert(t.year == tm.tm_year + 1900);
+                assert(t.month == tm.tm_mon + 1);
+                assert(t.day == tm.tm_mday);
+                assert(t.hour == tm.tm_hour);
+                assert(t.minute == tm.tm_min);
+                assert(t.second == tm.tm_sec);
+                assert(t.nanosecond == (ns % 1000000000 + 1000000000) % 1000000000);
+
+                t.timezone = rand() % 2881 - 1440;
+                assert(!c_efi_time_from_epoch_ns(ns, t.timezone, 0, &u));
+                assert(!c_efi_time_to_epoch_ns(&u, &ns) && ns == (CEfiI64)s * 1000000000 + t.nanosecond);
+        }
+}
+
+static void test_wall_clock(void) {
+        CEfiWallClock clock;
+        CEfiI64 a, b;
+        CEfiTime t;
+
+        test_now = (CEfiTime){ .year = 2024, .month = 5, .day = 17, .hour = 10, .timezone = 60 };
+
+        /* with a counter, get_time is called exactly once */
+        test_n_get_time = 0;
+        assert(!c_efi_wall_clock_init(&clock, &test_rt, 1000000000));
+        assert(!c_efi_wall_clock_now(&clock, &a));
+        assert(!c_efi_wall_clock_now(&clock, &b));
+        assert(test_n_get_time == 1);
+        assert(a >= clock.base_ns && b >= a);
+        assert(!c_efi_wall_clock_get_time(&clock, &t));
+        assert(t.year == 2024 && t.month == 5 && t.day == 17 && t.timezone == 60);
+
+        /* without a counter, every read falls back to get_time */
+        clock.counter.ticks_per_second = 0;
+        assert(!c_efi_wall_clock_now(&clock, &a));
+        assert(a == clock.base_ns);
+        assert(test_n_get_time == 2);
+
+        test_now.month = 0;
+        assert(c_efi_wall_clock_init(&clock, &test_rt, 0) == C_EFI_INVALID_PARAMETER);
+}
+
+int main(int argc, char **argv) {
+        test_convert();
+        test_wall_clock();
+        return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Tests for Lazy TPL Critical Sections
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "c-efi.h"
+#include "c-efi-tpl.h"
+
+/*
+ * A host stand-in for the firmware TPL, which enforces the rules of
+ * `raise_tpl` and `restore_tpl`, and counts dispatches of pending
+ * notifications.
+ */
+
+static CEfiTpl test_tpl = C_EFI_TPL_APPLICATION;
+static size_t test_n_raises, test_n_restores, test_n_dispatches;
+
+static CEfiTpl CEFICALL test_raise_tpl(CEfiTpl new_tpl) {
+        CEfiTpl old = test_tpl;
+
+        assert(new_tpl >= test_tpl && new_tpl <= C_EFI_TPL_HIGH_LEVEL);
+        test_tpl = new_tpl;
+        ++test_n_raises;
+        return old;
+}
+
+static void CEFICALL test_restore_tpl(CEfiTpl old_tpl) {
+        assert(old_tpl <= test_tpl);
+        if (old_tpl < C_EFI_TPL_NOTIFY && test_tpl >= C_EFI_TPL_NOTIFY)
+                ++test_n_dispatches;
+        test_tpl = old_tpl;
+        ++test_n_restores;
+}
+
+static CEfiBootServices test_bs = {
+        .raise_tpl = test_raise_tpl,
+        .restore_tpl = test_restore_tpl,
+};
+
+static void test_reset(void) {
+        test_tpl = C_EFI_TPL_APPLICATION;
+        test_n_raises = 0;
+        test_n_restores = 0;
+        test_n_dispatches = 0;
+}
+
+static void test_basic(void) {
+        CEfiTplGuard g;
+        CEfiTpl a, b, c;
+
+        test_reset();
+        assert(c_efi_tpl_query(&test_bs) == C_EFI_TPL_APPLICATION);
+        assert(test_tpl == C_EFI_TPL_APPLICATION);
+
+        /* a single section raises and restores */
+        test_reset();
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_APPLICATION);
+        a = c_efi_tpl_enter(&g, C_EFI_TPL_NOTIFY);
+        assert(a == C_EFI_TPL_APPLICATION && test_tpl == C_EFI_TPL_NOTIFY);
+        c_efi_tpl_leave(&g, a);
+        assert(test_tpl == C_EFI_TPL_APPLICATION);
+        assert(test_n_raises == 1 && test_n_restores == 1);
+        assert(g.n_raises == 1 && g.n_restores == 1 && !g.n_elided);
+
+        /* nested sections at equal or lower TPLs make no calls */
+        test_reset();
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_APPLICATION);
+        a = c_efi_tpl_enter(&g, C_EFI_TPL_NOTIFY);
+        b = c_efi_tpl_enter(&g, C_EFI_TPL_NOTIFY);
+        c = c_efi_tpl_enter(&g, C_EFI_TPL_CALLBACK);
+        assert(b == C_EFI_TPL_NOTIFY && c == C_EFI_TPL_NOTIFY);
+        assert(g.current == C_EFI_TPL_NOTIFY && g.depth == 3);
+        c_efi_tpl_leave(&g, c);
+        c_efi_tpl_leave(&g, b);
+        assert(test_tpl == C_EFI_TPL_NOTIFY);
+        c_efi_tpl_leave(&g, a);
+        assert(test_tpl == C_EFI_TPL_APPLICATION && !g.depth);
+        assert(test_n_raises == 1 && test_n_restores == 1 && test_n_dispatches == 1);
+        assert(g.n_elided == 4);
+
+        /* inner raises stay in effect until the outermost section ends */
+        test_reset();
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_APPLICATION);
+        a = c_efi_tpl_enter(&g, C_EFI_TPL_CALLBACK);
+        b = c_efi_tpl_enter(&g, C_EFI_TPL_HIGH_LEVEL);
+        assert(test_tpl == C_EFI_TPL_HIGH_LEVEL);
+        c_efi_tpl_leave(&g, b);
+        assert(test_tpl == C_EFI_TPL_HIGH_LEVEL && g.current == C_EFI_TPL_CALLBACK);
+        c = c_efi_tpl_enter(&g, C_EFI_TPL_NOTIFY);
+        c_efi_tpl_leave(&g, c);
+        c_efi_tpl_leave(&g, a);
+        assert(test_tpl == C_EFI_TPL_APPLICATION);
+        assert(test_n_raises == 2 && test_n_restores == 1 && test_n_dispatches == 1);
+        assert(g.n_raises == 2 && g.n_restores == 1 && g.n_elided == 3);
+
+        /* syncing lowers the firmware to the open sections */
+        test_reset();
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_APPLICATION);
+        a = c_efi_tpl_enter(&g, C_EFI_TPL_CALLBACK);
+        c_efi_tpl_sync(&g);
+        assert(!test_n_restores);
+        b = c_efi_tpl_enter(&g, C_EFI_TPL_HIGH_LEVEL);
+        c_efi_tpl_leave(&g, b);
+        c_efi_tpl_sync(&g);
+        assert(test_tpl == C_EFI_TPL_CALLBACK && test_n_dispatches == 1);
+        c_efi_tpl_leave(&g, a);
+        assert(test_tpl == C_EFI_TPL_APPLICATION);
+        assert(test_n_raises == 2 && test_n_restores == 2);
+
+        /* sections at the TPL of a notification make no calls at all */
+        test_reset();
+        test_tpl = C_EFI_TPL_NOTIFY;
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_NOTIFY);
+        a = c_efi_tpl_enter(&g, C_EFI_TPL_CALLBACK);
+        b = c_efi_tpl_enter(&g, C_EFI_TPL_NOTIFY);
+        c_efi_tpl_leave(&g, b);
+        c_efi_tpl_leave(&g, a);
+        assert(!test_n_raises && !test_n_restores && g.n_elided == 4);
+        assert(test_tpl == C_EFI_TPL_NOTIFY);
+}
+
+/* nest sections randomly, and compare the firmware TPL against the rules */
+static void test_random(void) {
+        static const CEfiTpl tpls[] = {
+                C_EFI_TPL_APPLICATION,
+                C_EFI_TPL_CALLBACK,
+                C_EFI_TPL_NOTIFY,
+                C_EFI_TPL_HIGH_LEVEL,
+        };
+        CEfiTpl olds[64], needed[64];
+        size_t i, n, depth = 0, n_sections = 0, n_syncs = 0;
+        CEfiTplGuard g;
+        CEfiTpl tpl;
+
+        test_reset();
+        c_efi_tpl_guard_init(&g, &test_bs, C_EFI_TPL_APPLICATION);
+
+        for (i = 0; i < 100000; ++i) {
+                if (depth < 64 && (!depth || rand() % 2)) {
+                        tpl = tpls[rand() % 4];
+                        needed[depth] = depth && needed[depth - 1] > tpl ? needed[depth - 1] : tpl;
+                        olds[depth++] = c_efi_tpl_enter(&g, tpl);
+                        ++n_sections;
+                } else if (rand() % 8) {
+                        c_efi_tpl_leave(&g, olds[--depth]);
+                } else {
+                        n = test_n_restores;
+                        c_efi_tpl_sync(&g);
+                        n_syncs += test_n_restores - n;
+                        assert(test_tpl == g.current);
+                }
+
+                /* the firmware always runs at least at the TPL required */
+                assert(g.depth == depth);
+                assert(g.current == (depth ? needed[depth - 1] : C_EFI_TPL_APPLICATION));
+                assert(test_tpl == g.firmware && test_tpl >= g.current);
+                if (!depth)
+                        assert(test_tpl == C_EFI_TPL_APPLICATION);
+        }
+
+        while (depth)
+                c_efi_tpl_leave(&g, olds[--depth]);
+        assert(test_tpl == C_EFI_TPL_APPLICATION);
+
+        assert(g.n_raises == test_n_raises && g.n_restores == test_n_restores);
+        /* every enter and leave either calls or is elided, syncs may call */
+        assert(g.n_raises + g.n_restores + g.n_elided == 2 * n_sections + n_syncs);
+        assert(g.n_elided > g.n_raises);
+}
+
+int main(int argc, char **argv) {
+        srand(5);
+        test_basic();
+        test_random();
+        return 0;
+}
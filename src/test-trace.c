@@ -0,0 +1,209 @@
+/*
+ * Tests for the Boot Trace Ring Buffer
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-trace.h"
+
+/* the decoder is a tool, so build it in with its entry point renamed */
+#define main test_decode_main
+#include "c-efi-trace-decode.c"
+#undef main
+
+static void *test_table;
+
+static CEfiStatus CEFICALL test_allocate_pool(CEfiMemoryType type, CEfiUSize size, void **buffer) {
+        assert(type == C_EFI_RUNTIME_SERVICES_DATA);
+        *buffer = malloc(size);
+        return *buffer ? C_EFI_SUCCESS : C_EFI_OUT_OF_RESOURCES;
+}
+
+static CEfiStatus CEFICALL test_free_pool(void *buffer) {
+        free(buffer);
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_install_configuration_table(CEfiGuid *guid, void *table) {
+        CEfiGuid expected = C_EFI_TRACE_TABLE_GUID;
+
+        assert(!memcmp(guid, &expected, sizeof(expected)));
+        test_table = table;
+        return C_EFI_SUCCESS;
+}
+
+static void test_ring(void) {
+        CEfiTraceTable *table;
+        CEfiUSize i, size;
+
+        assert(sizeof(CEfiTraceEvent) == 32);
+        assert(sizeof(CEfiTraceTable) == 40);
+
+        /* too small for a single event */
+        size = c_efi_trace_table_size(1) - 1;
+        table = malloc(size);
+        assert(c_efi_trace_table_init(table, size, 0) == C_EFI_BUFFER_TOO_SMALL);
+        free(table);
+
+        /* slot count is rounded down to a power of 2 */
+        size = c_efi_trace_table_size(6);
+        table = malloc(size);
+        assert(!c_efi_trace_table_init(table, size, 1000));
+        assert(table->n_events == 4);
+        assert(table->head == 0);
+
+        c_efi_trace_begin(table, C_EFI_TRACE_CATEGORY_IMAGE_LOAD, 7, 0x1000);
+        c_efi_trace_end(table, C_EFI_TRACE_CATEGORY_IMAGE_LOAD, 7, 0x1000);
+        assert(table->head == 2);
+        assert(table->events[0].sequence == 1);
+        assert(table->events[0].type == C_EFI_TRACE_TYPE_BEGIN);
+        assert(table->events[1].sequence == 2);
+        assert(table->events[1].type == C_EFI_TRACE_TYPE_END);
+        assert(table->events[1].timestamp >= table->events[0].timestamp);
+
+        /* wrap around and overwrite the oldest slots */
+        for (i = 0; i < 5; ++i)
+                c_efi_trace_instant(table, C_EFI_TRACE_CATEGORY_USER, i, i);
+        assert(table->head == 7);
+        for (i = 3; i < 7; ++i) {
+                assert(table->events[i & 3].sequence == i + 1);
+                assert(table->events[i & 3].type == C_EFI_TRACE_TYPE_INSTANT);
+        }
+
+        /* recording into a NULL table is a no-op */
+        c_efi_trace_begin(NULL, C_EFI_TRACE_CATEGORY_USER, 0, 0);
+
+        free(table);
+}
+
+static void test_publish(void) {
+        CEfiBootServices bs = {
+                .allocate_pool = test_allocate_pool,
+                .free_pool = test_free_pool,
+                .install_configuration_table = test_install_configuration_table,
+        };
+        CEfiSystemTable st = {
+                .boot_services = &bs,
+        };
+        CEfiTraceTable *table = NULL;
+
+        assert(!c_efi_trace_table_new(&st, 100, 0, &table));
+        assert(table);
+        assert(table == test_table);
+        assert(table->signature == C_EFI_TRACE_TABLE_SIGNATURE);
+        assert(table->n_events == 128);
+        free(table);
+
+        /* sizes beyond the slot count of a table are rejected up front */
+        test_table = NULL;
+        assert(c_efi_trace_table_new(&st, (CEfiUSize)0x80000000 + 1, 0, &table) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_trace_table_new(&st, (CEfiUSize)-1, 0, &table) == C_EFI_INVALID_PARAMETER);
+        assert(!test_table);
+}
+
+/* dump @table, decode the dump, and parse the events back from the JSON */
+static size_t test_decode(CEfiTraceTable *table, char names[][32], char *phases, double *ts, size_t n_max) {
+        char line[512];
+        uint8_t *data;
+        size_t n = 0, size;
+        FILE *f;
+
+        f = tmpfile();
+        assert(f);
+        size = c_efi_trace_table_size(table->n_events);
+        assert(fwrite(table, 1, size, f) == size);
+        rewind(f);
+        assert(!read_all(f, &data, &size));
+        fclose(f);
+
+        f = tmpfile();
+        assert(f);
+        assert(!decode(data, size, f));
+        free(data);
+        rewind(f);
+
+        assert(fgets(line, sizeof(line), f));
+        assert(!strcmp(line, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"));
+        while (fgets(line, sizeof(line), f) && line[0] == '{') {
+                assert(n < n_max);
+                assert(sscanf(line, "{\"name\":\"%31[^\"]\",\"cat\":\"%*[^\"]\",\"ph\":\"%c\",\"ts\":%lf,",
+                              names[n], &phases[n], &ts[n]) == 3);
+                ++n;
+        }
+        assert(!strcmp(line, "]}\n"));
+        assert(!fgets(line, sizeof(line), f));
+
+        fclose(f);
+        return n;
+}
+
+static void test_round_trip(void) {
+        static const char *const names[] = {
+                "image-load:1", "io:2", "user:3", "io:2", "io:4", "io:4", "image-load:1",
+        };
+        char decoded[16][32], phases[16], stack[16][32];
+        CEfiTraceTable *table;
+        size_t i, n, depth = 0;
+        double ts[16];
+
+        table = malloc(c_efi_trace_table_size(16));
+        assert(table);
+        assert(!c_efi_trace_table_init(table, c_efi_trace_table_size(16), 0));
+
+        /* an image load with two reads nested in it, and an instant in the first */
+        c_efi_trace_begin(table, C_EFI_TRACE_CATEGORY_IMAGE_LOAD, 1, 0);
+        c_efi_trace_begin(table, C_EFI_TRACE_CATEGORY_IO, 2, 4096);
+        c_efi_trace_instant(table, C_EFI_TRACE_CATEGORY_USER, 3, 0);
+        c_efi_trace_end(table, C_EFI_TRACE_CATEGORY_IO, 2, 4096);
+        c_efi_trace_begin(table, C_EFI_TRACE_CATEGORY_IO, 4, 8192);
+        c_efi_trace_end(table, C_EFI_TRACE_CATEGORY_IO, 4, 8192);
+        c_efi_trace_end(table, C_EFI_TRACE_CATEGORY_IMAGE_LOAD, 1, 0);
+
+        n = test_decode(table, decoded, phases, ts, 16);
+        assert(n == 7);
+        assert(!memcmp(phases, "BBiEBEE", 7));
+
+        for (i = 0; i < n; ++i) {
+                assert(!strcmp(decoded[i], names[i]));
+
+                /* without a frequency, timestamps are the raw ticks */
+                assert(ts[i] == (double)table->events[i].timestamp);
+                assert(!i || ts[i] >= ts[i - 1]);
+
+                /* every end closes the innermost open span */
+                if (phases[i] == 'B')
+                        strcpy(stack[depth++], decoded[i]);
+                else if (phases[i] == 'E')
+                        assert(depth && !strcmp(stack[--depth], decoded[i]));
+                assert(depth <= 2);
+        }
+        assert(!depth);
+
+        /* with a frequency, timestamps are in microseconds */
+        table->ticks_per_second = 1000000000;
+        for (i = 0; i < 7; ++i)
+                table->events[i].timestamp = 1000 * i + 500;
+        assert(test_decode(table, decoded, phases, ts, 16) == 7);
+        for (i = 0; i < 7; ++i)
+                assert(ts[i] == i + 0.5);
+
+        /* torn and overwritten slots are dropped */
+        for (i = 0; i < 12; ++i)
+                c_efi_trace_instant(table, C_EFI_TRACE_CATEGORY_USER, 100 + i, 0);
+        table->events[10].sequence = 0;
+        n = test_decode(table, decoded, phases, ts, 16);
+        assert(n == 15);
+        assert(!strcmp(decoded[0], "io:2") && phases[0] == 'E');
+        assert(!strcmp(decoded[n - 1], "user:111"));
+
+        free(table);
+}
+
+int main(int argc, char **argv) {
+        test_ring();
+        test_publish();
+        test_round_trip();
+        return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Tests for the Shadow-Buffer Text UI Renderer
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-tui.h"
+
+#define TEST_COLUMNS 20
+#define TEST_ROWS 5
+
+static CEfiTuiCell test_screen[TEST_ROWS][TEST_COLUMNS];
+static CEfiUSize test_column, test_row, test_attribute;
+static unsigned int test_n_cursor, test_n_attribute, test_n_output, test_n_chars, test_n_clear;
+
+static CEfiStatus CEFICALL test_output_string(CEfiSimpleTextOutputProtocol *this_, CEfiChar16 *string) {
+        ++test_n_output;
+        for ( ; *string; ++string) {
+                /* the renderer must never make the console scroll */
+                assert(test_row < TEST_ROWS);
+                assert(test_row + 1 < TEST_ROWS || test_column + 1 < TEST_COLUMNS);
+                test_screen[test_row][test_column] = (CEfiTuiCell){ .c = *string, .attribute = test_attribute };
+                ++test_n_chars;
+                if (++test_column == TEST_COLUMNS) {
+                        test_column = 0;
+                        ++test_row;
+                }
+        }
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_query_mode(CEfiSimpleTextOutputProtocol *this_,
+                                           CEfiUSize mode_number,
+                                           CEfiUSize *columns,
+                                           CEfiUSize *rows) {
+        assert(mode_number == 1);
+        *columns = TEST_COLUMNS;
+        *rows = TEST_ROWS;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_set_attribute(CEfiSimpleTextOutputProtocol *this_, CEfiUSize attribute) {
+        ++test_n_attribute;
+        test_attribute = attribute;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_clear_screen(CEfiSimpleTextOutputProtocol *this_) {
+        CEfiUSize x, y;
+
+        ++test_n_clear;
+        for (y = 0; y < TEST_ROWS; ++y)
+                for (x = 0; x < TEST_COLUMNS; ++x)
+                        test_screen[y][x] = (CEfiTuiCell){ .c = ' ', .attribute = test_attribute };
+        test_column = 0;
+        test_row = 0;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiStatus CEFICALL test_set_cursor_position(CEfiSimpleTextOutputProtocol *this_, CEfiUSize column, CEfiUSize row) {
+        assert(column < TEST_COLUMNS && row < TEST_ROWS);
+        ++test_n_cursor;
+        test_column = column;
+        test_row = row;
+        return C_EFI_SUCCESS;
+}
+
+static CEfiSimpleTextOutputMode test_mode = {
+        .max_mode = 2,
+        .mode = 1,
+};
+
+static CEfiSimpleTextOutputProtocol test_con = {
+        .output_string = test_output_string,
+        .query_mode = test_query_mode,
+        .set_attribute = test_set_attribute,
+        .clear_screen = test_clear_screen,
+        .set_cursor_position = test_set_cursor_position,
+        .mode = &test_mode,
+};
+
+static void test_reset_counters(void) {
+        test_n_cursor = 0;
+        test_n_attribute = 0;
+        test_n_output = 0;
+        test_n_chars = 0;
+        test_n_clear = 0;
+}
+
+/* check that the console shows the drawn frame, except for the last cell */
+static void test_verify(CEfiTui *tui) {
+        assert(!memcmp(test_screen, tui->back, sizeof(test_screen) - sizeof(CEfiTuiCell)));
+        assert(!memcmp(tui->front, tui->back, sizeof(test_screen)));
+        assert(tui->n_calls == test_n_cursor + test_n_attribute + test_n_output + test_n_clear);
+}
+
+static void test_basic(void) {
+        static const CEfiChar16 wide[] = { 'a', 0x00e4, '\n', 'b' };
+        CEfiTuiCell cells[2 * TEST_COLUMNS * TEST_ROWS];
+        CEfiUSize columns = 0, rows = 0;
+        CEfiTui tui;
+
+        assert(!c_efi_tui_geometry(&test_con, &columns, &rows));
+        assert(columns == TEST_COLUMNS && rows == TEST_ROWS);
+        assert(c_efi_tui_init(&tui, &test_con, cells, 2 * TEST_COLUMNS * TEST_ROWS - 1) == C_EFI_BUFFER_TOO_SMALL);
+
+        /* init clears the console once, with nothing else to draw */
+        test_reset_counters();
+        assert(!c_efi_tui_init(&tui, &test_con, cells, 2 * TEST_COLUMNS * TEST_ROWS));
+        assert(test_n_clear == 1 && test_n_attribute == 1 && test_n_output == 0 && test_n_cursor == 0);
+        test_verify(&tui);
+
+        /* a menu with a highlighted entry */
+        test_reset_counters();
+        c_efi_tui_put8(&tui, 2, 1, C_EFI_WHITE, "Boot Menu");
+        c_efi_tui_put8(&tui, 4, 2, C_EFI_BLACK | C_EFI_BACKGROUND_LIGHTGRAY, "Entry 1");
+        c_efi_tui_put8(&tui, 4, 3, C_EFI_LIGHTGRAY, "Entry 2");
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_output == 3 && test_n_chars == 9 + 7 + 7);
+        assert(test_n_cursor == 3 && test_n_attribute == 3);
+        test_verify(&tui);
+
+        /* presenting an unchanged frame does nothing */
+        test_reset_counters();
+        assert(!c_efi_tui_present(&tui));
+        assert(tui.n_calls == 0);
+
+        /* moving the highlight changes attributes only */
+        test_reset_counters();
+        c_efi_tui_put8(&tui, 4, 2, C_EFI_LIGHTGRAY, "Entry 1");
+        c_efi_tui_put8(&tui, 4, 3, C_EFI_BLACK | C_EFI_BACKGROUND_LIGHTGRAY, "Entry 2");
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_output == 2 && test_n_chars == 14);
+        assert(test_n_cursor == 2 && test_n_attribute == 1);
+        test_verify(&tui);
+
+        /* short gaps are reprinted, long gaps move the cursor */
+        test_reset_counters();
+        c_efi_tui_put8(&tui, 2, 1, C_EFI_WHITE, "Bxot Mxnu");
+        c_efi_tui_put8(&tui, 0, 0, C_EFI_LIGHTGRAY, "x");
+        c_efi_tui_put8(&tui, 19, 0, C_EFI_LIGHTGRAY, "y");
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_output == 3 && test_n_chars == 1 + 1 + 6);
+        assert(test_n_cursor == 3 && test_n_attribute == 2);
+        test_verify(&tui);
+
+        /* adjacent runs continue at the cursor, control characters are blanked */
+        test_reset_counters();
+        c_efi_tui_put8(&tui, 4, 3, C_EFI_RED, "E");
+        c_efi_tui_put(&tui, 5, 3, C_EFI_GREEN, wide, 4);
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_output == 2 && test_n_cursor == 1 && test_n_attribute == 2);
+        assert(tui.back[3 * TEST_COLUMNS + 7].c == ' ');
+        assert(tui.back[3 * TEST_COLUMNS + 6].c == 0x00e4);
+        test_verify(&tui);
+
+        /* the bottom-right cell is never drawn */
+        test_reset_counters();
+        c_efi_tui_fill(&tui, 10, 3, 100, 100, '#', C_EFI_BLUE);
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_output == 2 && test_n_chars == 10 + 9);
+        assert(test_screen[TEST_ROWS - 1][TEST_COLUMNS - 1].c == ' ');
+        test_verify(&tui);
+        test_reset_counters();
+        assert(!c_efi_tui_present(&tui));
+        assert(tui.n_calls == 0);
+
+        /* text is clipped */
+        c_efi_tui_put8(&tui, 15, 0, C_EFI_LIGHTGRAY, "0123456789");
+        c_efi_tui_put8(&tui, 0, TEST_ROWS, C_EFI_LIGHTGRAY, "0123456789");
+        assert(!c_efi_tui_present(&tui));
+        test_verify(&tui);
+
+        /* a full redraw after invalidation */
+        test_screen[0][0].c = '?';
+        test_reset_counters();
+        c_efi_tui_invalidate(&tui);
+        assert(!c_efi_tui_present(&tui));
+        assert(test_n_clear == 1);
+        test_verify(&tui);
+}
+
+static void test_runs(void) {
+        CEfiTuiCell cells[2 * TEST_COLUMNS * TEST_ROWS];
+        CEfiChar16 row[TEST_COLUMNS];
+        CEfiUSize i, k;
+        CEfiTui tui;
+
+        /* random frames always end up on the console */
+        srand(7);
+        assert(!c_efi_tui_init(&tui, &test_con, cells, 2 * TEST_COLUMNS * TEST_ROWS));
+        for (i = 0; i < 1000; ++i) {
+                for (k = 0; k < TEST_COLUMNS; ++k)
+                        row[k] = 'a' + rand() % 3;
+                c_efi_tui_put(&tui, rand() % TEST_COLUMNS, rand() % TEST_ROWS, rand() % 3, row, rand() % TEST_COLUMNS);
+                if (!(rand() % 50))
+                        c_efi_tui_clear(&tui, rand() % 3);
+                test_reset_counters();
+                assert(!c_efi_tui_present(&tui));
+                test_verify(&tui);
+        }
+}
+
+int main(int argc, char **argv) {
+        test_basic();
+        test_runs();
+        return 0;
+}
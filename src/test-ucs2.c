@@ -0,0 +1,85 @@
+/*
+ * Tests for UCS-2 Transcoding
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-ucs2.h"
+
+static void test_roundtrip(const char *utf8, const CEfiChar16 *ucs2, CEfiUSize n_ucs2) {
+        CEfiChar16 wbuf[128];
+        CEfiChar8 buf[256];
+        CEfiUSize n_utf8 = strlen(utf8), n;
+
+        assert(!c_efi_utf8_to_ucs2(wbuf, 128, (const CEfiChar8 *)utf8, n_utf8, &n));
+        assert(n == n_ucs2);
+        assert(!n || !memcmp(wbuf, ucs2, n * sizeof(*wbuf)));
+
+        assert(!c_efi_ucs2_to_utf8(buf, sizeof(buf), ucs2, n_ucs2, &n));
+        assert(n == n_utf8);
+        assert(!n || !memcmp(buf, utf8, n));
+
+        /* size queries */
+        assert(c_efi_utf8_to_ucs2(NULL, 0, (const CEfiChar8 *)utf8, n_utf8, &n) ==
+               (n_ucs2 ? C_EFI_BUFFER_TOO_SMALL : C_EFI_SUCCESS));
+        assert(n == n_ucs2);
+        assert(c_efi_ucs2_to_utf8(NULL, 0, ucs2, n_ucs2, &n) ==
+               (n_utf8 ? C_EFI_BUFFER_TOO_SMALL : C_EFI_SUCCESS));
+        assert(n == n_utf8);
+}
+
+static void test_ucs2(void) {
+        static const CEfiChar16 mixed[] = {
+                'v', 'm', 'l', 'i', 'n', 'u', 'z', ' ', 'r', 'o', 'o', 't', '=', '/', 'd', 'e',
+                'v', '/', 0xe4, ' ', 0x20ac, ' ', 'q', 'u', 'i', 'e', 't', ' ', 's', 'p', 'l', 'a',
+                's', 'h', ' ', 'c', 'o', 'n', 's', 'o', 'l', 'e', '=', 't', 't', 'y', 'S', '0',
+        };
+        CEfiChar8 buf[64], ascii[100];
+        CEfiChar16 wbuf[100];
+        CEfiUSize i, n;
+
+        test_roundtrip("", NULL, 0);
+        test_roundtrip("vmlinuz root=/dev/\xc3\xa4 \xe2\x82\xac quiet splash console=ttyS0",
+                       mixed, sizeof(mixed) / sizeof(*mixed));
+
+        /* every length around the block size takes the fast path correctly */
+        for (i = 0; i < sizeof(ascii); ++i)
+                ascii[i] = 'A' + i % 26;
+        for (i = 0; i <= sizeof(ascii); ++i) {
+                memset(wbuf, 0xff, sizeof(wbuf));
+                assert(!c_efi_utf8_to_ucs2(wbuf, i, ascii, i, &n));
+                assert(n == i);
+                for (n = 0; n < i; ++n)
+                        assert(wbuf[n] == ascii[n]);
+                if (i < 100)
+                        assert(wbuf[i] == 0xffff);
+        }
+
+        /* too small buffers never receive partial sequences */
+        memset(buf, 0, sizeof(buf));
+        assert(c_efi_ucs2_to_utf8(buf, 19, mixed, 20, &n) == C_EFI_BUFFER_TOO_SMALL);
+        assert(n == 21);
+        assert(buf[17] == '/' && buf[18] == 0);
+        assert(c_efi_ucs2_to_utf8(buf, 21, mixed, 20, &n) == C_EFI_SUCCESS);
+        assert(buf[18] == 0xc3 && buf[19] == 0xa4 && buf[20] == ' ');
+        assert(c_efi_ucs2_to_utf8(buf, 2, mixed + 18, 3, &n) == C_EFI_BUFFER_TOO_SMALL);
+        assert(n == 6);
+
+        /* invalid input */
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xc3", 1, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xc3\x28", 2, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xc0\xaf", 2, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xe0\x80\xaf", 3, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xed\xa0\x80", 3, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"\xf0\x9f\x98\x80", 4, &n) == C_EFI_INVALID_PARAMETER);
+        assert(c_efi_utf8_to_ucs2(wbuf, 100, (const CEfiChar8 *)"0123456789abcdef\x80", 17, &n) == C_EFI_INVALID_PARAMETER);
+        assert(n == 16);
+        wbuf[0] = 0xd83d;
+        assert(c_efi_ucs2_to_utf8(buf, sizeof(buf), wbuf, 1, &n) == C_EFI_INVALID_PARAMETER);
+}
+
+int main(int argc, char **argv) {
+        test_ucs2();
+        return 0;
+}
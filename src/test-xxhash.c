@@ -0,0 +1,93 @@
+/*
+ * Tests for xxHash Checksums
+ *
+ * The vectors were produced by the reference implementation (libxxhash
+ * 0.8.1), over prefixes of the test buffer, to hit every tail length and
+ * both sides of the stripe boundaries.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-xxhash.h"
+
+static void test_xxhash(void) {
+        static const struct {
+                CEfiUSize n;
+                CEfiU32 seed;
+                CEfiU32 h32;
+                CEfiU64 h64;
+        } vectors[] = {
+                {    0, 0x00000000U, 0x02cc5d05U, C_EFI_U64_C(0xef46db3751d8e999) },
+                {    0, 0x9e3779b1U, 0x36b78ae7U, C_EFI_U64_C(0xac75fda2929b17ef) },
+                {    1, 0x00000000U, 0xcf65b03eU, C_EFI_U64_C(0xe934a84adb052768) },
+                {    1, 0x9e3779b1U, 0xb4545aa4U, C_EFI_U64_C(0x5014607643a9b4c3) },
+                {    3, 0x00000000U, 0x14744175U, C_EFI_U64_C(0x9ff70a635a6209ab) },
+                {    3, 0x9e3779b1U, 0x08bf1ab1U, C_EFI_U64_C(0xecf3373c29e497d4) },
+                {    4, 0x00000000U, 0xc8f60fc5U, C_EFI_U64_C(0xae5acdc00a55ac41) },
+                {    4, 0x9e3779b1U, 0x372c1e48U, C_EFI_U64_C(0xba4a2450c7e2c0a9) },
+                {   15, 0x00000000U, 0x8807d6b2U, C_EFI_U64_C(0x02c53ab1e360882f) },
+                {   15, 0x9e3779b1U, 0xa6aede90U, C_EFI_U64_C(0x38158bed9ecc1cf6) },
+                {   16, 0x00000000U, 0xb59b7e13U, C_EFI_U64_C(0xed1dd2fac0a31fbc) },
+                {   16, 0x9e3779b1U, 0xd4e20520U, C_EFI_U64_C(0x5c35571ba8e15df8) },
+                {   17, 0x00000000U, 0x20dd4529U, C_EFI_U64_C(0x758409c57cd5d0a2) },
+                {   17, 0x9e3779b1U, 0xa83ecf00U, C_EFI_U64_C(0xb6bed953e332df3a) },
+                {   31, 0x00000000U, 0xdc5b7443U, C_EFI_U64_C(0x0f187c62b1e722b7) },
+                {   31, 0x9e3779b1U, 0x61ac8a29U, C_EFI_U64_C(0xa2ba2580312f0f94) },
+                {   32, 0x00000000U, 0xd7f70f45U, C_EFI_U64_C(0x91b0cb0931a8c629) },
+                {   32, 0x9e3779b1U, 0x03695891U, C_EFI_U64_C(0xba4945101354e701) },
+                {   33, 0x00000000U, 0xe5b60f32U, C_EFI_U64_C(0x931b043cf8d65b94) },
+                {   33, 0x9e3779b1U, 0xb32568c1U, C_EFI_U64_C(0x1f245ed9dde2a6c8) },
+                {   63, 0x00000000U, 0xc7c21636U, C_EFI_U64_C(0x219110bf13e2fa26) },
+                {   63, 0x9e3779b1U, 0xcb7dfae4U, C_EFI_U64_C(0x7010506b304f24a3) },
+                {   64, 0x00000000U, 0xb9258763U, C_EFI_U64_C(0xbf3052e3445775d0) },
+                {   64, 0x9e3779b1U, 0x49532af5U, C_EFI_U64_C(0x7a368c1f823dfc0e) },
+                {  100, 0x00000000U, 0xaa19e8b7U, C_EFI_U64_C(0x8e2272c08247d5db) },
+                {  100, 0x9e3779b1U, 0x7b20fbc7U, C_EFI_U64_C(0xac47104ac97e0bd1) },
+                { 1000, 0x00000000U, 0x3e483681U, C_EFI_U64_C(0x698399d62f9c1695) },
+                { 1000, 0x9e3779b1U, 0x12e7ff9fU, C_EFI_U64_C(0x54bf4105274d8346) },
+                { 4096, 0x00000000U, 0xa73a6d89U, C_EFI_U64_C(0x2f2095dbb4b78856) },
+                { 4096, 0x9e3779b1U, 0x8816ec54U, C_EFI_U64_C(0xcc8b0e5afcf639cb) },
+        };
+        static CEfiU8 buf[4096 + 16];
+        CEfiUSize i, j, k, off, step;
+        CEfiXxh32 s32;
+        CEfiXxh64 s64;
+
+        for (i = 0; i < 4096; ++i)
+                buf[i] = (CEfiU8)(i * 7 + (i >> 8));
+
+        assert(c_efi_xxh32(0, "abc", 3) == C_EFI_U32_C(0x32d153ff));
+        assert(c_efi_xxh64(0, "abc", 3) == C_EFI_U64_C(0x44bc2cf5ad770999));
+
+        for (i = 0; i < sizeof(vectors) / sizeof(*vectors); ++i) {
+                assert(c_efi_xxh32(vectors[i].seed, buf, vectors[i].n) == vectors[i].h32);
+                assert(c_efi_xxh64(vectors[i].seed, buf, vectors[i].n) == vectors[i].h64);
+
+                /* incremental updates of any size equal a single pass */
+                for (step = 1; step < 100; step += 12) {
+                        c_efi_xxh32_init(&s32, vectors[i].seed);
+                        c_efi_xxh64_init(&s64, vectors[i].seed);
+                        for (j = 0; j < vectors[i].n; j += k) {
+                                k = vectors[i].n - j < step ? vectors[i].n - j : step;
+                                c_efi_xxh32_update(&s32, buf + j, k);
+                                c_efi_xxh64_update(&s64, buf + j, k);
+                        }
+                        assert(c_efi_xxh32_final(&s32) == vectors[i].h32);
+                        assert(c_efi_xxh64_final(&s64) == vectors[i].h64);
+                }
+        }
+
+        /* unaligned input */
+        for (off = 1; off < 16; ++off) {
+                memmove(buf + off, buf + off - 1, 4096);
+                assert(c_efi_xxh32(0, buf + off, 1000) == C_EFI_U32_C(0x3e483681));
+                assert(c_efi_xxh64(0, buf + off, 1000) == C_EFI_U64_C(0x698399d62f9c1695));
+        }
+}
+
+int main(int argc, char **argv) {
+        test_xxhash();
+        return 0;
+}
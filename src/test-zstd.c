@@ -0,0 +1,896 @@
+/*
+ * Tests for Zstandard Streaming Decompression
+ *
+ * The vectors were produced by the reference implementation (libzstd 1.5.4,
+ * ZSTD_compress2() and ZSTD_compressStream2()) from the generators below.
+ * Between them, they cover raw, RLE and compressed blocks, raw and Huffman
+ * coded literals with 1 and 4 streams and treeless reuse, and predefined,
+ * RLE, FSE coded and repeated sequence tables. On top, the tests build frames
+ * of raw and RLE blocks and RLE literals by hand.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-efi.h"
+#include "c-efi-zstd.h"
+
+static const CEfiU8 test_zstd_text[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x64, 0xb0, 0x03, 0x1d, 0x0b, 0x00, 0x62, 0x08,
+        0x17, 0x16, 0xb0, 0x25, 0xe9, 0x00, 0xd8, 0x2d, 0xed, 0xd0, 0xd2, 0x26,
+        0xdb, 0x90, 0x84, 0x48, 0x49, 0xda, 0x4e, 0x92, 0xd4, 0x74, 0xa6, 0x3a,
+        0xc5, 0xf5, 0x30, 0x57, 0xc8, 0x64, 0x9d, 0xae, 0xd3, 0xa6, 0x15, 0xd1,
+        0x36, 0x4d, 0xd2, 0xc6, 0x21, 0x0f, 0x28, 0xae, 0xf5, 0xba, 0xa1, 0xc1,
+        0x27, 0xe5, 0x9d, 0x93, 0x61, 0xd7, 0xc3, 0x5c, 0x21, 0xe1, 0x1c, 0x40,
+        0xad, 0xa8, 0x47, 0x8e, 0x8b, 0x86, 0xd6, 0xeb, 0xbd, 0x5f, 0x20, 0x54,
+        0x0c, 0x09, 0x4a, 0x84, 0x0d, 0xf3, 0x60, 0xce, 0x8a, 0xb1, 0x5e, 0xc2,
+        0xaa, 0x3c, 0x50, 0xb7, 0xdc, 0xce, 0xce, 0x78, 0x10, 0x80, 0x89, 0xa8,
+        0x11, 0xdf, 0x24, 0x05, 0x85, 0x4a, 0x73, 0x20, 0x02, 0x62, 0x90, 0x82,
+        0x67, 0x1b, 0x11, 0x80, 0x18, 0x49, 0x5a, 0x64, 0x92, 0xa6, 0xd2, 0x18,
+        0x05, 0x34, 0x08, 0xb1, 0x0f, 0x03, 0xc0, 0xae, 0x94, 0x7d, 0xfa, 0x94,
+        0x40, 0xa6, 0x47, 0x97, 0x14, 0x99, 0x30, 0x3b, 0xdd, 0x4b, 0x3f, 0x07,
+        0x1b, 0x07, 0x6c, 0x46, 0x69, 0x1b, 0x18, 0x8d, 0x20, 0x82, 0x07, 0x71,
+        0xba, 0x92, 0x6f, 0x17, 0x7a, 0x59, 0xb8, 0x8c, 0x4f, 0x33, 0x0c, 0x34,
+        0xec, 0x91, 0x5b, 0x30, 0x3b, 0x7d, 0x80, 0x0c, 0xa9, 0x5d, 0xd1, 0x78,
+        0x1f, 0x41, 0xdb, 0xf8, 0xbe, 0x0a, 0x79, 0x48, 0xea, 0x07, 0x4f, 0xd6,
+        0xaf, 0xa4, 0x38, 0x70, 0x89, 0x03, 0x11, 0x4f, 0x0e, 0x68, 0xef, 0xf5,
+        0x97, 0x13, 0x2a, 0x01, 0x42, 0x07, 0x0f, 0xfb, 0xa6, 0x08, 0x76, 0x65,
+        0x71, 0x87, 0x10, 0x94, 0x70, 0x2c, 0x28, 0x85, 0x2c, 0x07, 0x1b, 0xcd,
+        0x2a, 0xd1, 0x87, 0x1d, 0x16, 0x50, 0x7d, 0x29, 0x11, 0xd4, 0x5e, 0xf1,
+        0x0f, 0xc4, 0x7a, 0x02, 0xdb, 0xf0, 0x14, 0x81, 0x92, 0xb3, 0x17, 0x7a,
+        0x58, 0x8d, 0x4a, 0x45, 0x83, 0x50, 0xf7, 0xca, 0x12, 0x84, 0xb1, 0x2e,
+        0xef, 0xaf, 0x50, 0xaa, 0x5b, 0xdf, 0xe9, 0xe0, 0x13, 0x0d, 0x75, 0xf9,
+        0x88, 0x33, 0xb6, 0x16, 0x92, 0xd0, 0xeb, 0xba, 0x40, 0xe5, 0x9c, 0xa1,
+        0x57, 0x63, 0x13, 0x22, 0x76, 0xf7, 0xe6, 0x12, 0x2b, 0x3d, 0x41, 0x2a,
+        0xb5, 0x58, 0x2c, 0xd1, 0x72, 0x2e, 0x46, 0x1a, 0x35, 0xf2, 0xad, 0x70,
+        0x24, 0x98, 0x32, 0x8d, 0xa7, 0xd6, 0x3b, 0x2b, 0xd8, 0xb3, 0x69, 0x67,
+        0xae, 0x7b, 0x3f, 0xcb, 0xfb, 0xb5, 0xec, 0x29, 0xb3, 0xe3, 0xc6, 0xcd,
+        0x90, 0xa0, 0xd6, 0xb8, 0x4a, 0xb4, 0xb4, 0xfb, 0x2f, 0x23, 0xd5, 0xb3,
+        0xed, 0x52, 0x4d, 0x9a, 0x55, 0x4c, 0x80, 0x6f, 0xb4,
+};
+
+static const CEfiU8 test_zstd_small_window[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x44, 0x00, 0x70, 0x16, 0x64, 0x09, 0x00, 0x42,
+        0x88, 0x16, 0x12, 0xa0, 0xbb, 0x01, 0x00, 0x51, 0x76, 0x8e, 0xab, 0x2a,
+        0xb5, 0x64, 0xb3, 0xff, 0xff, 0xd7, 0x1f, 0xdc, 0x51, 0x09, 0x5a, 0x33,
+        0x3e, 0x22, 0xa2, 0x2a, 0x1f, 0xb1, 0xf0, 0x2a, 0x1f, 0x0b, 0x2f, 0x2a,
+        0xaa, 0xa2, 0x26, 0x1f, 0x35, 0xbd, 0x74, 0xe9, 0xa5, 0x0a, 0x49, 0x67,
+        0xb7, 0x2f, 0x2a, 0xcd, 0xcf, 0x45, 0xed, 0xdc, 0xe5, 0x28, 0x9c, 0x1e,
+        0xd6, 0x0a, 0xfd, 0x29, 0xbc, 0x79, 0x36, 0xad, 0x35, 0xb9, 0x43, 0x51,
+        0xc9, 0x25, 0x0d, 0x5a, 0x33, 0xb1, 0xba, 0xa4, 0x92, 0x7d, 0x9a, 0xf2,
+        0x0a, 0x7e, 0xbe, 0xd5, 0x69, 0xb3, 0x7f, 0x10, 0x6c, 0xa8, 0xd1, 0x5e,
+        0x69, 0x41, 0x41, 0x41, 0x25, 0xc3, 0x18, 0x20, 0x44, 0x60, 0x94, 0xc2,
+        0xec, 0x11, 0x50, 0x0c, 0x53, 0x89, 0x01, 0x06, 0x64, 0x61, 0xa1, 0x35,
+        0xd1, 0x59, 0x21, 0x8b, 0xf6, 0x47, 0x94, 0xb7, 0xc7, 0x47, 0xb5, 0x58,
+        0x09, 0x33, 0x1c, 0x8c, 0xaa, 0xdf, 0x24, 0xb6, 0xa5, 0x88, 0x96, 0x37,
+        0x2d, 0xf9, 0x86, 0xa6, 0xa3, 0x5a, 0x2b, 0x41, 0x2c, 0x6b, 0x3a, 0xc0,
+        0x6d, 0xfa, 0x04, 0xab, 0xd3, 0x5a, 0x6c, 0x84, 0xc8, 0x87, 0x44, 0x0c,
+        0x87, 0x0d, 0x5f, 0x05, 0x13, 0xb7, 0xa9, 0x04, 0xdb, 0x9d, 0x4f, 0x55,
+        0xaa, 0x3e, 0x1b, 0x9e, 0xd6, 0xe7, 0xc4, 0xc1, 0xd2, 0x2a, 0x04, 0x9a,
+        0xe9, 0x1e, 0xac, 0xd5, 0x15, 0xec, 0xef, 0x89, 0x63, 0x37, 0xa1, 0xf1,
+        0x2a, 0x8f, 0xe8, 0x4c, 0x93, 0xbf, 0x6b, 0xa6, 0x2c, 0x74, 0x7b, 0x03,
+        0x81, 0x31, 0x1b, 0xe4, 0x65, 0x6a, 0x4a, 0x93, 0x64, 0xf8, 0xf8, 0xd2,
+        0x72, 0xed, 0x15, 0x84, 0x29, 0x68, 0xb6, 0x52, 0xeb, 0x67, 0xf5, 0x1b,
+        0xa1, 0xca, 0xde, 0x00, 0x15, 0x1e, 0x54, 0x56, 0xe8, 0x20, 0x7f, 0x62,
+        0xeb, 0x8f, 0x41, 0xa1, 0x80, 0x3b, 0x7f, 0x70, 0xf2, 0x40, 0x5d, 0x25,
+        0x0f, 0x18, 0x37, 0xe3, 0x7b, 0x23, 0x40, 0x88, 0xb9, 0x54, 0xa3, 0x11,
+        0x22, 0xd9, 0xa3, 0xfd, 0xc7, 0x64, 0x15, 0xf1, 0x70, 0x9f, 0xaf, 0x36,
+        0xdc, 0x84, 0x88, 0xf5, 0x34, 0xa8, 0x5c, 0x7f, 0x22, 0x85, 0x0a, 0x14,
+        0x07, 0x00, 0x83, 0x42, 0x05, 0xa0, 0x35, 0xd3, 0xe4, 0xab, 0x22, 0x3f,
+        0x95, 0xbf, 0xa4, 0x11, 0x51, 0x93, 0x8f, 0x58, 0x98, 0xaf, 0xfc, 0xc2,
+        0x8b, 0x01, 0x6e, 0xb8, 0xa0, 0x29, 0x1d, 0x11, 0x50, 0x08, 0xd0, 0xa8,
+        0x82, 0x11, 0x3b, 0x31, 0xb4, 0x18, 0xc6, 0x51, 0x4d, 0x46, 0x79, 0xc6,
+        0x19, 0x31, 0x03, 0x5b, 0x21, 0x32, 0xe0, 0xe2, 0x48, 0x19, 0xa3, 0x86,
+        0x54, 0x34, 0x54, 0x49, 0x04, 0xef, 0xd7, 0x2e, 0xf7, 0x32, 0xbc, 0xc8,
+        0x24, 0x40, 0x66, 0x22, 0xe7, 0x6f, 0x0f, 0xe9, 0x0f, 0x41, 0x67, 0xec,
+        0x4d, 0x7b, 0x52, 0xc7, 0x88, 0xbc, 0x50, 0xa4, 0xf3, 0x4e, 0xc2, 0x31,
+        0x2d, 0x0d, 0xc7, 0xb3, 0xda, 0x97, 0x76, 0x73, 0xb7, 0xbf, 0x37, 0x9e,
+        0xe4, 0xf1, 0x50, 0x98, 0x6a, 0x7c, 0xfd, 0xa2, 0x8c, 0x32, 0x48, 0xda,
+        0xa5, 0x03, 0xa5, 0x40, 0x33, 0x61, 0x03, 0x19, 0x4f, 0x1c, 0x81, 0x37,
+        0xad, 0x96, 0x2a, 0x24, 0xbe, 0x8d, 0xac, 0x3b, 0xef, 0x37, 0x88, 0x6d,
+        0x23, 0xc5, 0xfa, 0x96, 0xe3, 0xd3, 0xc6, 0xbf, 0xcb, 0xb8, 0x12, 0xd9,
+        0x00, 0x6c, 0xd9, 0x45, 0xf6, 0xc1, 0x51, 0x18, 0x6b, 0x78, 0x81, 0xf4,
+        0xd8, 0xb8, 0xf0, 0xde, 0x8c, 0x2f, 0x78, 0xf3, 0xca, 0x97, 0x66, 0xd2,
+        0xd1, 0x70, 0x69, 0xd9, 0xd7, 0xad, 0xb4, 0xa4, 0x18, 0x52, 0x67, 0xda,
+        0x24, 0x97, 0xa9, 0x20, 0x7c, 0xbb, 0x68, 0x89, 0x68, 0x74, 0x71, 0xb1,
+        0x0f, 0xdc, 0xd0, 0x52, 0xcf, 0xd4, 0x62, 0xe9, 0x2a, 0xcc, 0x8a, 0xec,
+        0x72, 0x83, 0x33, 0xd2, 0x6b, 0xa1, 0x6d, 0x14, 0x31, 0xa7, 0xb6, 0x02,
+        0x74, 0x06, 0x00, 0x43, 0xc1, 0x02, 0xed, 0xdc, 0x21, 0x92, 0x46, 0x54,
+        0x54, 0x45, 0x55, 0x54, 0x0d, 0x73, 0xbc, 0xc0, 0xeb, 0xac, 0x04, 0xc6,
+        0xbb, 0xa2, 0x8d, 0xf6, 0x51, 0x49, 0xb1, 0x1a, 0x81, 0x52, 0xc6, 0x13,
+        0x5b, 0xe2, 0x64, 0x61, 0x68, 0x4c, 0x7a, 0x9d, 0x6c, 0x52, 0x3a, 0x57,
+        0x4f, 0x05, 0x46, 0x06, 0xdd, 0xc6, 0x10, 0x22, 0x4b, 0xb8, 0xae, 0x4d,
+        0x1f, 0x37, 0xd2, 0x05, 0xe3, 0x7b, 0x93, 0x50, 0x9a, 0x6c, 0x31, 0x3e,
+        0xd4, 0xd3, 0x8e, 0xaf, 0x57, 0xde, 0xbc, 0x5f, 0x4d, 0x54, 0x56, 0x03,
+        0x41, 0x71, 0x43, 0x8c, 0xb8, 0xb9, 0x60, 0x11, 0x9b, 0x4e, 0x8e, 0xda,
+        0x8a, 0x79, 0xc5, 0x73, 0xf8, 0xb0, 0x9f, 0xd8, 0x1a, 0x89, 0xe7, 0x29,
+        0x5f, 0x53, 0xdc, 0x11, 0xf0, 0x7a, 0xae, 0xc1, 0xcb, 0x41, 0xa5, 0x74,
+        0x6f, 0x4a, 0xe3, 0xd5, 0xf2, 0x21, 0x80, 0x70, 0x6c, 0xe9, 0x84, 0x46,
+        0x35, 0xbc, 0x26, 0xdb, 0x43, 0x18, 0x83, 0x0b, 0x54, 0xed, 0x34, 0xae,
+        0xcd, 0x80, 0x9c, 0xc2, 0xb9, 0x77, 0x2c, 0x34, 0xf2, 0x3b, 0xc1, 0x42,
+        0xb4, 0xd3, 0xcd, 0xc6, 0xb5, 0x4e, 0xf3, 0x25, 0x35, 0x07, 0x90, 0x8b,
+        0xb8, 0x53, 0xba, 0x35, 0xf0, 0xdf, 0xc2, 0x83, 0x1e, 0x79, 0x90, 0x3c,
+        0xa9, 0x5b, 0xc1, 0x77, 0x11, 0x8a, 0xee, 0x4a, 0xc9, 0x56, 0x7f, 0x91,
+        0x05, 0xba, 0x3d, 0x50, 0xc7, 0xb8, 0x69, 0x5a, 0x28, 0x6e, 0xcc, 0x15,
+        0x35, 0xb1, 0x8b, 0x63, 0x80, 0x14, 0x07, 0x00, 0x83, 0x41, 0x03, 0xb9,
+        0xa4, 0x0b, 0x23, 0xe1, 0x23, 0x2a, 0x9f, 0x9f, 0xaa, 0x9a, 0x8a, 0x01,
+        0x72, 0xa8, 0xc0, 0xa7, 0x03, 0x20, 0x02, 0x42, 0x8c, 0x72, 0xee, 0x0e,
+        0x11, 0x60, 0x04, 0x2c, 0xf1, 0x02, 0x0b, 0x2c, 0xb5, 0x30, 0x8c, 0x01,
+        0x07, 0x51, 0xbd, 0xec, 0x4f, 0x95, 0x50, 0xc2, 0xd5, 0x88, 0xc4, 0xa3,
+        0x15, 0x33, 0xdf, 0x1a, 0xb2, 0x28, 0xc9, 0x00, 0xe5, 0xa2, 0x70, 0xc1,
+        0x17, 0x98, 0xbb, 0x4f, 0x2b, 0xf3, 0x11, 0x31, 0xb1, 0xe6, 0xe2, 0x75,
+        0x1e, 0x8b, 0x4d, 0x40, 0x49, 0xb0, 0x0c, 0xe3, 0x8b, 0xc6, 0x0d, 0x80,
+        0x08, 0x1b, 0x09, 0x16, 0x4d, 0x4e, 0x80, 0x48, 0x00, 0x2f, 0x65, 0x2e,
+        0x80, 0xfc, 0xc6, 0xdb, 0x57, 0x19, 0x21, 0x2c, 0x17, 0x15, 0xf9, 0x83,
+        0x10, 0x93, 0x2c, 0x11, 0x01, 0x7a, 0x68, 0xce, 0x8d, 0x50, 0x79, 0xae,
+        0xf8, 0x76, 0xb9, 0x1a, 0xa7, 0x27, 0x8a, 0x88, 0xd1, 0x3b, 0xfb, 0xfa,
+        0x58, 0x44, 0x42, 0x50, 0x58, 0x09, 0x6e, 0x0e, 0xf7, 0x3f, 0x67, 0x2d,
+        0x97, 0xd7, 0xe7, 0xee, 0x89, 0x8c, 0xa3, 0x39, 0x8e, 0x96, 0x12, 0xea,
+        0xbc, 0x0d, 0xa3, 0xa8, 0x81, 0x62, 0x49, 0x4d, 0x7c, 0xd9, 0x27, 0x41,
+        0xf8, 0xe0, 0x9f, 0xb0, 0x20, 0x48, 0x0b, 0x44, 0xdf, 0x49, 0xd1, 0x70,
+        0x50, 0x44, 0x08, 0x76, 0xde, 0x17, 0xc4, 0x19, 0x6e, 0xb6, 0x0d, 0x44,
+        0x79, 0x93, 0x99, 0x0f, 0xc7, 0x33, 0x30, 0xfa, 0x45, 0x83, 0x78, 0xeb,
+        0xba, 0x16, 0xdc, 0x5e, 0x89, 0x46, 0x70, 0xbe, 0xc7, 0xc4, 0x90, 0x84,
+        0xd1, 0x58, 0xd0, 0xa3, 0xdf, 0x05, 0xa4, 0x06, 0x00, 0x03, 0x41, 0x02,
+        0x40, 0xf9, 0x88, 0x88, 0x88, 0x8a, 0xa4, 0x51, 0x03, 0x6c, 0xe8, 0x20,
+        0x44, 0x40, 0x10, 0x62, 0x77, 0x07, 0x11, 0x50, 0x08, 0x14, 0x61, 0x41,
+        0x0a, 0xe6, 0xd4, 0x61, 0x0e, 0x02, 0x2b, 0xb4, 0xcc, 0x02, 0x5b, 0x4d,
+        0xb6, 0x41, 0xe8, 0x90, 0x76, 0x99, 0xa7, 0xca, 0xce, 0xd8, 0xa2, 0x8d,
+        0xd4, 0x72, 0x75, 0xd8, 0x3f, 0x32, 0xd0, 0xef, 0x01, 0x57, 0x6d, 0x3a,
+        0xd8, 0xd4, 0xaf, 0x4b, 0x05, 0x58, 0x63, 0x6c, 0x74, 0x1a, 0xe2, 0x90,
+        0x1a, 0x73, 0x54, 0x60, 0xd7, 0x35, 0x62, 0xf5, 0xab, 0x29, 0xe4, 0x0a,
+        0x59, 0x7c, 0x38, 0x28, 0x3f, 0xb9, 0xa5, 0xec, 0x7b, 0x02, 0xb9, 0xba,
+        0x37, 0xca, 0x78, 0xe2, 0x56, 0xe0, 0xa2, 0x21, 0xa5, 0xae, 0x3a, 0xde,
+        0xee, 0xfa, 0x2a, 0x94, 0xfe, 0x98, 0x6e, 0x3b, 0xc4, 0xe7, 0xe2, 0x5d,
+        0xda, 0xea, 0xea, 0x92, 0xd5, 0xe1, 0x70, 0xbb, 0xd0, 0xe6, 0x42, 0x3e,
+        0xcf, 0x4b, 0x30, 0x3c, 0x06, 0x01, 0x06, 0x7d, 0x03, 0x4b, 0x0f, 0xc9,
+        0x3b, 0x0b, 0x1c, 0x90, 0x4c, 0x90, 0xef, 0xff, 0x81, 0x26, 0xdc, 0x16,
+        0x7a, 0x3a, 0xc0, 0x33, 0x4c, 0x11, 0x25, 0xd8, 0xe3, 0xc6, 0x86, 0xce,
+        0x98, 0xe9, 0x7c, 0x9b, 0x6d, 0xf6, 0x5c, 0x2e, 0x51, 0xed, 0x8e, 0xba,
+        0xdd, 0x51, 0x1d, 0xd0, 0xd7, 0x30, 0xa0, 0x32, 0xf0, 0x08, 0x78, 0xbc,
+        0xcd, 0x75, 0xab, 0xed, 0x6a, 0x35, 0xc5, 0x2f, 0x13, 0x39, 0x52, 0x87,
+        0x81, 0x22, 0xd5, 0x69, 0x41, 0x1d, 0x06, 0x00, 0x83, 0x01, 0x03, 0x09,
+        0x5a, 0x33, 0x7e, 0x2a, 0x26, 0x5f, 0x15, 0x55, 0x8f, 0x7c, 0xd4, 0x61,
+        0xe8, 0x10, 0x12, 0x63, 0x14, 0x3b, 0x3d, 0x11, 0x90, 0x04, 0x1a, 0x61,
+        0x89, 0x49, 0x91, 0x18, 0x0a, 0x63, 0xb7, 0x03, 0x24, 0x4d, 0xef, 0xba,
+        0x40, 0xea, 0xe2, 0xe4, 0x31, 0xf2, 0x3b, 0x5a, 0x6b, 0x09, 0xad, 0x41,
+        0xbb, 0xc9, 0x5b, 0x70, 0xb8, 0x21, 0xcd, 0x7e, 0xff, 0x4c, 0xff, 0x57,
+        0xa2, 0xcd, 0x5c, 0xe9, 0xfa, 0x0a, 0x34, 0xed, 0x01, 0xb8, 0x76, 0x7b,
+        0xe4, 0xc2, 0x53, 0x08, 0xc2, 0xcd, 0x0f, 0xa2, 0xd7, 0x89, 0xe3, 0x1b,
+        0x5f, 0x51, 0x5c, 0xa3, 0xee, 0xa4, 0x62, 0x51, 0x78, 0x6d, 0x6f, 0x4d,
+        0x3b, 0x57, 0x6a, 0x41, 0x1f, 0x9a, 0x0f, 0xf8, 0x9a, 0x50, 0xb3, 0x8d,
+        0xc0, 0x4d, 0xc7, 0xd9, 0x6f, 0x1c, 0xfd, 0xae, 0x73, 0xed, 0x3e, 0x97,
+        0x96, 0x77, 0xcb, 0x84, 0x75, 0x67, 0xd2, 0x8b, 0xb8, 0xd6, 0x2e, 0xcf,
+        0x1c, 0x64, 0x7b, 0x5c, 0x1a, 0x0f, 0xc5, 0xc9, 0x63, 0xbb, 0xf5, 0x30,
+        0x5b, 0xd9, 0x19, 0x20, 0x04, 0xfc, 0xbc, 0x3b, 0x07, 0xf6, 0xb0, 0xa8,
+        0x17, 0xec, 0x43, 0x55, 0x0b, 0x07, 0x54, 0x0a, 0x24, 0x35, 0xbf, 0xbb,
+        0x14, 0xe2, 0x29, 0xa4, 0xc8, 0xd9, 0x1d, 0x99, 0x9f, 0x85, 0xa2, 0x1b,
+        0x0c, 0xe7, 0x6e, 0x70, 0xf7, 0xb4, 0x45, 0xab, 0x2f, 0x65, 0x02, 0x53,
+        0xf2, 0x1b, 0x24,
+};
+
+static const CEfiU8 test_zstd_periodic[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0xa4, 0xf0, 0x49, 0x02, 0x00, 0x3c, 0x1d, 0x00,
+        0xb4, 0x2f, 0x9e, 0xea, 0xb0, 0x5d, 0x35, 0x70, 0x07, 0xc6, 0x32, 0xf3,
+        0xdb, 0xb4, 0x84, 0x89, 0x92, 0x4d, 0x55, 0x2b, 0x08, 0xfe, 0x0c, 0x35,
+        0x3a, 0x0d, 0x4a, 0x1f, 0x00, 0xac, 0xda, 0x2c, 0x46, 0x3a, 0xfb, 0xea,
+        0x67, 0xc5, 0xe8, 0xd2, 0x87, 0x7c, 0x5e, 0x3b, 0xc3, 0x97, 0xa6, 0x59,
+        0x94, 0x9e, 0xf8, 0x02, 0x1e, 0x95, 0x4e, 0x0a, 0x12, 0x27, 0x4e, 0xb6,
+        0x22, 0xb0, 0x8d, 0x73, 0x21, 0x1b, 0x49, 0xf8, 0x2d, 0x05, 0xc6, 0xaf,
+        0x4a, 0x39, 0x81, 0x96, 0x31, 0xd9, 0xd7, 0x39, 0x05, 0xd3, 0x92, 0x6c,
+        0x4b, 0xb7, 0x1a, 0x2b, 0x01, 0x23, 0xb6, 0x2e, 0xd4, 0xf5, 0xdb, 0x83,
+        0xb9, 0x12, 0xd6, 0x94, 0xf2, 0xf6, 0x8d, 0x7b, 0xf7, 0xd4, 0x40, 0x59,
+        0x04, 0x78, 0x59, 0x61, 0xa8, 0x9b, 0x14, 0x43, 0x4a, 0x69, 0xb3, 0xc8,
+        0xcd, 0x9f, 0x3d, 0xdb, 0x8d, 0x66, 0x70, 0xb8, 0x47, 0x72, 0x61, 0xfe,
+        0x24, 0xe7, 0xa9, 0x5b, 0xf5, 0xc1, 0xbf, 0x6e, 0xf1, 0x8d, 0xd6, 0x69,
+        0xf4, 0xd4, 0x83, 0x04, 0xc3, 0xe4, 0xc9, 0xa9, 0x48, 0xa5, 0xc2, 0x88,
+        0x2f, 0xf2, 0xcb, 0xcc, 0x65, 0x73, 0x88, 0xc6, 0x38, 0xd2, 0x0f, 0x74,
+        0x59, 0xe2, 0x31, 0xfa, 0xe6, 0x78, 0x32, 0xb5, 0x76, 0x8e, 0xa0, 0xf5,
+        0xe6, 0x8f, 0x47, 0x63, 0x74, 0xdd, 0xce, 0x8e, 0x03, 0xcc, 0x81, 0x12,
+        0x11, 0x61, 0x0c, 0x48, 0xf4, 0xef, 0x1d, 0x3b, 0x12, 0xf8, 0x6d, 0xd3,
+        0x89, 0x47, 0x3e, 0xc7, 0xdc, 0xc6, 0xde, 0xad, 0xf0, 0xd5, 0xa8, 0x8d,
+        0x99, 0x31, 0x6a, 0xb9, 0xa8, 0xc2, 0x95, 0x58, 0x64, 0xf0, 0x54, 0x02,
+        0x02, 0x8b, 0x21, 0xbc, 0x46, 0x73, 0xce, 0x67, 0x33, 0xe2, 0xa2, 0x64,
+        0xf4, 0x4d, 0x8f, 0xad, 0xb0, 0x84, 0x7f, 0xf8, 0xcf, 0x37, 0x3a, 0x53,
+        0x79, 0x3f, 0x85, 0xc6, 0xbe, 0x45, 0xe4, 0xe0, 0xcd, 0x80, 0xfa, 0x09,
+        0x0a, 0x1b, 0x44, 0x04, 0x76, 0x80, 0x9a, 0x61, 0xe3, 0x02, 0x4e, 0x53,
+        0x89, 0xc1, 0x36, 0x56, 0xf1, 0x41, 0xb1, 0x8e, 0x5b, 0x55, 0x45, 0x1c,
+        0x1e, 0xa0, 0x67, 0x75, 0x3e, 0xf3, 0x31, 0xb1, 0x30, 0x24, 0xb6, 0x85,
+        0x9e, 0x68, 0x44, 0x40, 0xc1, 0x85, 0xfc, 0x74, 0x2b, 0x8b, 0xa8, 0xe4,
+        0x7e, 0xe7, 0x50, 0xb8, 0xb1, 0x69, 0x52, 0x83, 0x66, 0x90, 0xa9, 0x97,
+        0xaf, 0xa2, 0x38, 0x99, 0x7e, 0x3c, 0xbc, 0xe1, 0x9c, 0x46, 0xb6, 0xf7,
+        0xf4, 0x62, 0x0b, 0xc6, 0xe8, 0x79, 0xe2, 0x61, 0x85, 0xa2, 0x31, 0x8d,
+        0xd9, 0x53, 0xe6, 0x88, 0x8a, 0x23, 0xe7, 0xdc, 0x2b, 0x8b, 0x87, 0xa8,
+        0x53, 0x8d, 0x54, 0x8f, 0x7d, 0x1b, 0xaa, 0xda, 0xf2, 0x0e, 0x6c, 0xb8,
+        0x95, 0x78, 0x24, 0xf7, 0x9a, 0x41, 0x32, 0xb3, 0xbd, 0x22, 0x8f, 0xc9,
+        0xf2, 0xca, 0xf0, 0x36, 0x29, 0xc3, 0xe1, 0x43, 0x9d, 0xce, 0x22, 0x5d,
+        0x98, 0x4c, 0x16, 0x04, 0x5e, 0x24, 0x0e, 0x34, 0xca, 0x3f, 0x40, 0xb7,
+        0xa7, 0x13, 0xdd, 0x63, 0xcf, 0x40, 0x7e, 0xa1, 0xc3, 0x63, 0xd0, 0x50,
+        0xd7, 0xe6, 0x5d, 0x05, 0xfe, 0x3a, 0xda, 0xf6, 0xc4, 0x6e, 0xed, 0x79,
+        0x0a, 0xe0, 0xbe, 0xa0, 0x87, 0xa2, 0x62, 0xe5, 0x84, 0x0f, 0x71, 0x46,
+        0x2c, 0x4f, 0x61, 0x3c, 0x6b, 0x7a, 0x2e, 0x1e, 0x7f, 0xe9, 0x99, 0xef,
+        0x23, 0xaf, 0x86, 0x69, 0x1d, 0xf9, 0x19, 0xe1, 0xf5, 0x35, 0x13, 0x8e,
+        0x9f, 0x00, 0x9e, 0x8f, 0x70, 0x75, 0x51, 0xd1, 0xdb, 0xc1, 0xe9, 0x7d,
+        0x67, 0xb5, 0xcf, 0xe3, 0xa3, 0xf5, 0x23, 0xe3, 0x68, 0x18, 0xb6, 0xc2,
+        0x41, 0x91, 0xd0, 0xf4, 0x3e, 0xa3, 0x24, 0x91, 0x85, 0xc6, 0xe4, 0xba,
+        0xaf, 0x42, 0xf3, 0x9f, 0x74, 0x51, 0xea, 0x98, 0x1c, 0x3b, 0x97, 0xe8,
+        0x16, 0x80, 0x05, 0x67, 0x6e, 0x03, 0xec, 0x2d, 0x69, 0x5d, 0x98, 0x62,
+        0xc5, 0x8e, 0xf7, 0x29, 0xc9, 0x68, 0x5c, 0xfe, 0x33, 0x34, 0x35, 0xd4,
+        0x46, 0x1f, 0x7d, 0x65, 0x83, 0x35, 0xcd, 0x2f, 0xd9, 0xfb, 0x79, 0x7e,
+        0xa0, 0x66, 0x38, 0x01, 0x66, 0x81, 0x71, 0x9a, 0x47, 0xfb, 0xd4, 0xd4,
+        0x1d, 0xfe, 0xdd, 0x6f, 0x7e, 0x1b, 0x4d, 0x0a, 0x74, 0xbf, 0xa1, 0x31,
+        0x7f, 0x60, 0x86, 0xbf, 0x3c, 0x3e, 0xbf, 0xba, 0x3e, 0x87, 0x92, 0xde,
+        0x45, 0x11, 0x3e, 0xd5, 0xe7, 0x4b, 0x31, 0x39, 0x86, 0x95, 0xbc, 0x7d,
+        0xdb, 0xf2, 0x88, 0x0b, 0x9a, 0x74, 0xa5, 0x44, 0xf9, 0x6c, 0xf1, 0x47,
+        0x90, 0x3f, 0x8b, 0xde, 0x5e, 0x68, 0x33, 0x14, 0x2e, 0x87, 0xd1, 0x7b,
+        0x52, 0x00, 0x51, 0x9c, 0x57, 0x26, 0x29, 0xd6, 0x8b, 0x8d, 0x80, 0x5b,
+        0x32, 0x6b, 0xd0, 0x40, 0xf8, 0xee, 0x60, 0x95, 0xc5, 0xb1, 0x9b, 0xdf,
+        0x0a, 0x41, 0x3b, 0x8e, 0x3a, 0x55, 0xdd, 0x4f, 0x05, 0xa3, 0x7c, 0xff,
+        0x6e, 0x56, 0x0e, 0x29, 0xbe, 0x7e, 0xde, 0x9a, 0x4f, 0x23, 0xf3, 0x33,
+        0xb3, 0x98, 0x37, 0xb3, 0x54, 0xbe, 0xcd, 0x8a, 0xac, 0x51, 0xc2, 0xf2,
+        0xd7, 0x24, 0xab, 0xcc, 0xdc, 0x74, 0x7a, 0xdc, 0x90, 0x4a, 0xb5, 0x84,
+        0xea, 0x7a, 0x49, 0xae, 0x17, 0xff, 0xc4, 0xa8, 0xf2, 0xdf, 0x85, 0x5e,
+        0x04, 0xec, 0xb6, 0xb5, 0xef, 0xe3, 0xb9, 0xde, 0x84, 0x6b, 0x31, 0xcb,
+        0x91, 0xc7, 0x9d, 0x2f, 0x75, 0xdb, 0x81, 0x79, 0x23, 0x86, 0xdc, 0x84,
+        0xde, 0x79, 0x23, 0x90, 0xca, 0x01, 0x5b, 0x39, 0x63, 0xc8, 0x92, 0x0b,
+        0x51, 0x66, 0x3c, 0x27, 0x7d, 0x68, 0x32, 0x9b, 0xc1, 0x2c, 0x76, 0xcc,
+        0x96, 0x6d, 0x37, 0xe5, 0xbf, 0x2a, 0x70, 0xe2, 0xb8, 0x3f, 0x20, 0xe0,
+        0xf7, 0x0d, 0xe3, 0xf4, 0x05, 0x57, 0x75, 0x43, 0xf5, 0x19, 0xae, 0x4a,
+        0x86, 0xea, 0x1f, 0xae, 0x8a, 0x0d, 0xd5, 0x17, 0x5c, 0xd5, 0x0d, 0xd5,
+        0x67, 0xb8, 0x2a, 0x19, 0xaa, 0x7f, 0xb8, 0x2a, 0x36, 0x54, 0x5f, 0x70,
+        0x55, 0x37, 0x54, 0x9f, 0xe1, 0xaa, 0x64, 0xa8, 0xfe, 0xe1, 0xaa, 0xd8,
+        0x50, 0x7d, 0xc1, 0xa5, 0xba, 0xa1, 0xfa, 0x0c, 0x57, 0x25, 0x43, 0xf5,
+        0x0f, 0x57, 0xc5, 0x86, 0xea, 0x0b, 0xae, 0xea, 0x86, 0xea, 0x33, 0x5c,
+        0x95, 0x0c, 0xd5, 0x3f, 0x5c, 0x15, 0x1b, 0xaa, 0x2f, 0xb8, 0xaa, 0x1b,
+        0xaa, 0xcf, 0x70, 0x55, 0x32, 0x54, 0xff, 0x70, 0x55, 0x6c, 0xa8, 0xbe,
+        0xe0, 0xaa, 0x6e, 0xa8, 0x3e, 0xc3, 0xa5, 0x92, 0xa1, 0xfa, 0x87, 0xab,
+        0x62, 0x43, 0xf5, 0x05, 0x57, 0x75, 0x43, 0xf5, 0x19, 0xae, 0x4a, 0x86,
+        0xea, 0x1f, 0xae, 0x8a, 0x0d, 0xd5, 0x17, 0x5c, 0xd5, 0x0d, 0xd5, 0x67,
+        0xb8, 0x2a, 0x19, 0xaa, 0x7f, 0xb8, 0x2a, 0x36, 0x54, 0x5f, 0x70, 0x55,
+        0x37, 0x54, 0x9f, 0xe1, 0xaa, 0x64, 0xa8, 0xfe, 0xe1, 0x52, 0xb1, 0xa1,
+        0xfa, 0x82, 0x2b, 0x54, 0x57, 0xaf, 0xa1, 0xfe, 0xf2, 0x53, 0x1a, 0x35,
+        0x01, 0x00, 0x58, 0x32, 0xc0, 0x9a, 0xb8, 0xe2, 0x77, 0x2d, 0xc0, 0x9a,
+        0x87, 0xdd, 0x0b, 0x50, 0x01, 0x00, 0xc4, 0xfe, 0xb8, 0xaa, 0xa1, 0xfa,
+        0xb8, 0xaa, 0xa1, 0xfa, 0xb8, 0xaa, 0xa1, 0xfa, 0xb8, 0xaa, 0xa1, 0xfa,
+        0xb8, 0x2a, 0x9e, 0x02, 0x3e, 0x60, 0x3f, 0xce,
+};
+
+static const CEfiU8 test_zstd_runs[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x20, 0x4d, 0x1d, 0x1f, 0x00, 0x86, 0x69,
+        0x2c, 0x82, 0x11, 0x10, 0x2a, 0x00, 0x2a, 0x00, 0x2a, 0x00, 0x3e, 0x78,
+        0xd1, 0xe1, 0x2b, 0x0f, 0x50, 0xb1, 0xda, 0x29, 0x2c, 0xa5, 0x92, 0x7e,
+        0x1d, 0x76, 0x69, 0xba, 0x7f, 0x5a, 0x52, 0xbc, 0x5a, 0xb6, 0x1a, 0x09,
+        0xd1, 0xf1, 0xdc, 0xf2, 0xfc, 0x85, 0x5c, 0xae, 0xe7, 0x67, 0x5d, 0x62,
+        0x25, 0x6c, 0x34, 0x1e, 0xd6, 0x46, 0x5f, 0xcb, 0xb5, 0x63, 0x9f, 0xd4,
+        0x6a, 0x1c, 0xec, 0x4a, 0x51, 0xf1, 0x88, 0x66, 0x8b, 0xd6, 0x36, 0x2c,
+        0x74, 0x29, 0x5f, 0x9e, 0x55, 0xaf, 0x2f, 0x5a, 0xa8, 0x66, 0xea, 0x5d,
+        0x68, 0x22, 0x59, 0xad, 0x5b, 0xa5, 0xa7, 0x14, 0x96, 0x1e, 0xc5, 0x92,
+        0xa2, 0x25, 0x38, 0x23, 0xa8, 0xd9, 0xd6, 0xe4, 0x51, 0xa6, 0x29, 0xad,
+        0x1b, 0x57, 0x89, 0x92, 0x56, 0x86, 0xf5, 0xac, 0x0e, 0x1e, 0x94, 0xd2,
+        0x8c, 0x52, 0x98, 0x8d, 0xe5, 0xbc, 0xe5, 0x09, 0x16, 0xa5, 0x45, 0x1d,
+        0x5d, 0xea, 0x7b, 0x12, 0xaa, 0xca, 0x48, 0x59, 0x73, 0x2f, 0x41, 0x50,
+        0x61, 0xad, 0xb4, 0x12, 0xd7, 0x01, 0xea, 0xd7, 0x6d, 0x83, 0xea, 0x95,
+        0x59, 0x2a, 0x97, 0xaf, 0x07, 0x5a, 0x09, 0xf1, 0x14, 0xf4, 0x5d, 0xa2,
+        0x1f, 0x14, 0x1e, 0x3a, 0x20, 0x58, 0xf8, 0x95, 0x9b, 0x1a, 0x82, 0x2b,
+        0xa8, 0xe2, 0xf8, 0xf2, 0x3a, 0xb2, 0xec, 0x24, 0x12, 0x32, 0xac, 0xe9,
+        0x12, 0x40, 0x30, 0x08, 0x40, 0x08, 0x18, 0x02, 0x88, 0x80, 0x42, 0x10,
+        0x88, 0x80, 0xc1, 0x08, 0x30, 0x02, 0x8c, 0x80, 0x23, 0x00, 0x09, 0x18,
+        0x92, 0x80, 0xa2, 0x09, 0x28, 0x07, 0x91, 0x71, 0xea, 0x6c, 0x0e, 0x40,
+        0xd4, 0xdf, 0x31, 0xd0, 0x08, 0x84, 0xd5, 0x29, 0x5d, 0x25, 0x88, 0x21,
+        0xe8, 0x61, 0x08, 0xe8, 0x61, 0x41, 0xed, 0xc5, 0x65, 0x8c, 0x0b, 0xbf,
+        0xe5, 0x0f, 0x9e, 0xa5, 0x5f, 0xca, 0x8a, 0x43, 0x31, 0xa6, 0xf2, 0xfd,
+        0xb2, 0x9f, 0x80, 0x2e, 0x90, 0x5d, 0xbb, 0xab, 0x1f, 0x50, 0x04, 0x79,
+        0xea, 0x2e, 0xbd, 0x90, 0x11, 0x20, 0xf8, 0xfd, 0x74, 0xf4, 0x0a, 0xd8,
+        0x4f, 0x48, 0xb1, 0x92, 0x76, 0x26, 0xa2, 0xd4, 0x0e, 0xc1, 0x77, 0x0d,
+        0x54, 0xb8, 0x2a, 0xf5, 0x10, 0x4d, 0xae, 0xa5, 0x30, 0xe7, 0x20, 0x90,
+        0xf8, 0xa3, 0x7d, 0x40, 0x58, 0xb2, 0xf9, 0x08, 0x9f, 0x90, 0xcf, 0x05,
+        0xdd, 0xea, 0x13, 0xb4, 0x13, 0xec, 0xa4, 0x77, 0xd5, 0x4c, 0x8e, 0xf1,
+        0xb6, 0x05, 0xf0, 0xbd, 0x1a, 0x54, 0xb2, 0x6b, 0x52, 0xfe, 0x0f, 0x96,
+        0x48, 0xfd, 0xc1, 0x24, 0x41, 0x64, 0x46, 0x41, 0x43, 0xfa, 0xb2, 0xf8,
+        0xfe, 0x47, 0x64, 0xad, 0xaa, 0xa2, 0xd1, 0x50, 0x49, 0x1e, 0x71, 0x70,
+        0x42, 0x22, 0x78, 0x92, 0xbb, 0x10, 0xcc, 0xf9, 0x1a, 0x13, 0xe6, 0xe1,
+        0xb9, 0xc4, 0x52, 0x5a, 0xc6, 0x84, 0x31, 0x74, 0x34, 0xe5, 0x60, 0x4b,
+        0xab, 0xab, 0x0c, 0xc8, 0x46, 0x40, 0x93, 0xaa, 0x83, 0x87, 0x00, 0x42,
+        0x23, 0xe3, 0x92, 0xbb, 0xbf, 0x51, 0xd6, 0x5f, 0x19, 0x02, 0x17, 0x14,
+        0x95, 0xef, 0xbb, 0x1a, 0x20, 0xea, 0xed, 0xa5, 0xdc, 0x03, 0xc8, 0x6e,
+        0x8a, 0x15, 0x86, 0x1c, 0xbc, 0x78, 0x98, 0xb1, 0x87, 0x23, 0x0b, 0x11,
+        0x8b, 0x8c, 0xf0, 0xf1, 0x82, 0x26, 0x49, 0x33, 0x44, 0x1e, 0x7e, 0xd2,
+        0x29, 0x85, 0x67, 0xcf, 0xcb, 0xba, 0x02, 0x09, 0xbb, 0x53, 0x54, 0x66,
+        0x3a, 0xf0, 0x99, 0xd3, 0x91, 0xc0, 0xd8, 0x30, 0x85, 0x3b, 0xda, 0x4e,
+        0xda, 0xcf, 0xcc, 0xc3, 0x94, 0x11, 0x7c, 0x28, 0x3d, 0x82, 0xde, 0x9b,
+        0x27, 0x54, 0x43, 0x14, 0x3f, 0xe9, 0x17, 0x38, 0x12, 0xbb, 0x24, 0x14,
+        0xc2, 0x39, 0x16, 0x24, 0x74, 0x07, 0x29, 0xc3, 0x22, 0x02, 0xcd, 0x3a,
+        0x80, 0x95, 0xa4, 0x4e, 0x93, 0xa9, 0xe1, 0xca, 0xe2, 0xa5, 0x49, 0x9b,
+        0xdc, 0x3c, 0x43, 0x3b, 0xf2, 0xe0, 0x73, 0xf3, 0xcb, 0xaa, 0x05, 0x2e,
+        0x08, 0x24, 0x30, 0xff, 0x3a, 0x36, 0xa2, 0x45, 0xac, 0xe3, 0xb5, 0x5e,
+        0xe5, 0xca, 0x0d, 0x6f, 0x13, 0x04, 0xf4, 0x89, 0x61, 0xce, 0x21, 0x1d,
+        0xa8, 0x44, 0x1a, 0x80, 0x3a, 0xf5, 0x84, 0x47, 0x1b, 0xf3, 0x48, 0x91,
+        0xd4, 0x98, 0x30, 0x4e, 0xaf, 0xe0, 0x7d, 0x4c, 0x1a, 0x13, 0xcf, 0x03,
+        0x29, 0x6a, 0x12, 0xde, 0x65, 0x90, 0x69, 0xdc, 0x71, 0xb8, 0xbe, 0xd0,
+        0xe1, 0xce, 0x46, 0xd9, 0x87, 0x79, 0x63, 0x25, 0xcc, 0x0e, 0x19, 0x7c,
+        0x4a, 0x9a, 0x10, 0x38, 0x07, 0x25, 0x3f, 0x39, 0x55, 0xc0, 0xa3, 0xbc,
+        0x91, 0x7d, 0x32, 0x2e, 0x2f, 0xd1, 0x0a, 0xfc, 0xb7, 0xe6, 0x55, 0x93,
+        0x91, 0xe1, 0xbc, 0x20, 0x5c, 0xad, 0x58, 0xd0, 0xb6, 0xca, 0x90, 0xd5,
+        0x30, 0x26, 0x41, 0xf2, 0x5b, 0x95, 0x76, 0x35, 0xe6, 0x95, 0x51, 0x4d,
+        0x20, 0xe5, 0xb2, 0xe3, 0x5e, 0xa5, 0x02, 0xab, 0xe6, 0x54, 0xd1, 0x71,
+        0x2e, 0x5f, 0xc8, 0x63, 0x17, 0x30, 0xe8, 0x04, 0xe3, 0xbc, 0x40, 0x2c,
+        0x28, 0xdb, 0x5c, 0x64, 0x8e, 0xaf, 0x5b, 0xc0, 0x3e, 0x70, 0xf2, 0x28,
+        0x9f, 0x55, 0xa6, 0x2e, 0x3a, 0xe6, 0x26, 0x53, 0x0b, 0x6b, 0x01, 0x43,
+        0xfe, 0x4f, 0xe2, 0x14, 0xe4, 0x60, 0x48, 0x24, 0x07, 0x93, 0xc4, 0x06,
+        0x86, 0x60, 0x29, 0xd7, 0xe5, 0xa9, 0xc6, 0x4f, 0x8a, 0x23, 0x15, 0xc7,
+        0x77, 0xdc, 0xe5, 0x83, 0x8d, 0x9c, 0x98, 0x74, 0xf2, 0x76, 0x93, 0xeb,
+        0x39, 0x92, 0x67, 0x61, 0x44, 0x19, 0x05, 0x77, 0xad, 0x5b, 0xe4, 0xe5,
+        0x61, 0xa3, 0x24, 0x42, 0x24, 0xaa, 0x41, 0x8e, 0x0d, 0x1a, 0xd9, 0x60,
+        0xc6, 0xe9, 0x66, 0x11, 0x17, 0x84, 0x06, 0x68, 0xb3, 0x60, 0x3b, 0x96,
+        0xa7, 0x35, 0xe4, 0xc0, 0xc7, 0x38, 0x8c, 0xdf, 0x85, 0x70, 0x5a, 0x92,
+        0xd4, 0x22, 0x65, 0x37, 0xa9, 0x68, 0x03, 0x7b, 0x12, 0xf2, 0x17, 0xa8,
+        0x71, 0x40, 0x47, 0xfa, 0x3d, 0x36, 0x02, 0x02, 0x36, 0xf5, 0x27, 0x99,
+        0xd0, 0xed, 0xf2, 0x98, 0x03, 0x0e, 0xb1, 0x2b, 0x10, 0xa1, 0xa6, 0x5d,
+        0xc8, 0x72, 0xe8, 0x8a, 0x0c, 0xb4, 0xc9, 0x17, 0xf1, 0x76, 0x43, 0xda,
+        0xf6, 0xfa, 0xfc, 0x81, 0xa7, 0x33, 0x6b, 0x3f, 0xfe, 0x26, 0x57, 0x61,
+        0x7b, 0x3c, 0x31, 0xe6, 0x19, 0xe1, 0x27, 0x63, 0xe9, 0xcd, 0x63, 0x93,
+        0x5f, 0x27, 0xe9, 0x83, 0xc9, 0x69, 0xcc, 0x30, 0xcc, 0x4a, 0xd0, 0x76,
+        0x1a, 0x4d, 0xb0, 0x8a, 0xc5, 0xb8, 0xab, 0x25, 0x96, 0x0f, 0x51, 0xf0,
+        0x57, 0x8d, 0x05, 0x6e, 0x9e, 0xf0, 0xd0, 0x7e, 0xf6, 0xc8, 0xc5, 0x56,
+        0x4e, 0x71, 0xd8, 0x91, 0x4d, 0xcb, 0xbf, 0x0e, 0x9e, 0xca, 0xd0, 0xf4,
+        0x08, 0x63, 0xbf, 0x02, 0x47, 0x16, 0xd3, 0x62, 0xd5, 0x6c, 0x05, 0xe1,
+        0xe0, 0x05, 0x55, 0x19, 0xe4, 0xbe, 0x2b, 0x6b, 0x9b, 0x09, 0x5b, 0x1e,
+        0xc5, 0x40, 0xe9, 0x57, 0x70, 0xde, 0x3b, 0x1c, 0x0f, 0x81, 0x89, 0x58,
+        0xdb, 0x0d, 0xb0, 0x6a, 0xb1, 0x79, 0x3a, 0x26, 0xa8, 0xa4, 0xf2, 0x9c,
+        0xa2, 0x58, 0x84, 0x06, 0xe4, 0xb1, 0xb1, 0x68, 0xc4, 0xeb, 0xe1, 0x04,
+        0xa8, 0x2f, 0xde, 0x3c, 0x42, 0x0e, 0x85, 0x34, 0x1b, 0x48, 0x34, 0x9c,
+        0x72, 0x77, 0xc8, 0x7a, 0x1c, 0x73, 0x96, 0x64, 0x9d, 0x85, 0x62, 0xc3,
+        0x51,
+};
+
+static const CEfiU8 test_zstd_noise[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x2c, 0x00, 0x61, 0x09, 0x00, 0x1c, 0x53,
+        0xbc, 0x58, 0x9e, 0x61, 0x80, 0x7b, 0x8d, 0xb3, 0xf8, 0xe0, 0x40, 0xc1,
+        0xe7, 0xda, 0x3f, 0xc4, 0x71, 0xc9, 0x3b, 0x70, 0xe8, 0x7c, 0x31, 0x75,
+        0x6a, 0x4b, 0xbe, 0x75, 0x44, 0xd0, 0xa4, 0x48, 0x45, 0x4a, 0x03, 0x75,
+        0x09, 0xa9, 0x83, 0xd3, 0x8a, 0xd3, 0xb7, 0x69, 0xfa, 0xae, 0xec, 0xd6,
+        0xc7, 0xe1, 0xfa, 0x13, 0x8b, 0x56, 0x41, 0x7d, 0x6e, 0x4d, 0xd3, 0x43,
+        0x05, 0x5f, 0xea, 0xd9, 0xd2, 0xd1, 0xa3, 0x40, 0x14, 0x3e, 0xab, 0x31,
+        0x98, 0xbc, 0xa6, 0x16, 0x6d, 0x14, 0xac, 0xbf, 0x27, 0x5b, 0x12, 0x14,
+        0x57, 0x41, 0x56, 0xd1, 0xfb, 0xe0, 0xd0, 0x2c, 0xc2, 0x9f, 0x50, 0x4c,
+        0x31, 0x78, 0x89, 0xc4, 0x36, 0xab, 0x49, 0x0c, 0xa1, 0xa4, 0x61, 0x79,
+        0x1d, 0x5b, 0x68, 0x9f, 0x4c, 0x65, 0x08, 0xa5, 0xba, 0xa0, 0xe1, 0x92,
+        0x67, 0x64, 0x34, 0xde, 0x54, 0xfc, 0x9b, 0xa1, 0x6e, 0x38, 0xc0, 0xf6,
+        0x5b, 0xa6, 0x3a, 0xf0, 0x1f, 0xb0, 0x0d, 0x8d, 0x89, 0x9b, 0x7c, 0xe9,
+        0xf5, 0xb0, 0xdf, 0xdb, 0xcb, 0xfe, 0x53, 0xb1, 0x6c, 0x76, 0x62, 0x33,
+        0x21, 0xa7, 0xae, 0x64, 0x0f, 0x47, 0xe8, 0x40, 0xcc, 0x77, 0x21, 0x2b,
+        0x70, 0x48, 0xe6, 0x63, 0x3d, 0xde, 0x75, 0x75, 0x23, 0xab, 0x89, 0x8d,
+        0x6d, 0x39, 0xa9, 0xa5, 0x03, 0x79, 0x1d, 0xe1, 0xa7, 0xa2, 0x95, 0xef,
+        0x27, 0x93, 0x44, 0x9f, 0xbe, 0x1b, 0x64, 0xfb, 0xa2, 0x3e, 0xcd, 0xce,
+        0xae, 0x93, 0x90, 0xcf, 0x9b, 0xbf, 0x91, 0x62, 0xd8, 0x68, 0xba, 0x2b,
+        0x6b, 0x6c, 0xd4, 0xb7, 0x07, 0xfd, 0xd6, 0xb6, 0x43, 0x5b, 0x3c, 0x5c,
+        0x0c, 0xef, 0xf6, 0x37, 0x52, 0x06, 0x08, 0xb4, 0x9f, 0xc4, 0x3d, 0x05,
+        0x00, 0x14, 0x2f, 0xf0, 0x6f, 0x94, 0xce, 0x5b, 0x55, 0x21, 0x48, 0x8c,
+        0x79, 0x47, 0xa5, 0xfa, 0x2a, 0xad, 0x02, 0xad, 0x28, 0xdc, 0xbd, 0x0b,
+        0x83, 0x15, 0xee, 0xd8, 0x92, 0xf4, 0x56, 0x58, 0x88, 0xf3, 0x48, 0x0a,
+        0xaf, 0xf3, 0x9b, 0x06, 0x4f, 0xc5, 0x8c, 0xd0, 0x7a, 0x8f, 0x96, 0x5b,
+        0x66, 0x00, 0x4c, 0x31, 0x4c, 0xe8, 0x10, 0xf9, 0xf7, 0x55, 0x89, 0xd8,
+        0x27, 0x00,
+};
+
+static const CEfiU8 test_zstd_zeros[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0xa4, 0x50, 0xab, 0x04, 0x00, 0x94, 0x17, 0x00,
+        0x52, 0x4d, 0x20, 0x16, 0xa0, 0xa5, 0xe9, 0x00, 0x3e, 0x49, 0x73, 0x9f,
+        0x4d, 0xbe, 0x93, 0xdb, 0xa6, 0xa4, 0x4f, 0xff, 0xff, 0xbb, 0x5f, 0x5b,
+        0xd5, 0x0f, 0x00, 0x48, 0xcb, 0xea, 0xcf, 0xe7, 0x94, 0x9a, 0x4f, 0xf2,
+        0x8c, 0x3c, 0x65, 0xbb, 0x95, 0x2b, 0xe5, 0x6f, 0x7e, 0xa9, 0x6e, 0x4a,
+        0x75, 0xa5, 0xbf, 0xfa, 0x6b, 0xc9, 0x33, 0xf2, 0xac, 0x9d, 0xdf, 0x91,
+        0x3c, 0xa5, 0xc8, 0xb3, 0x52, 0x6b, 0x91, 0x10, 0x27, 0x98, 0x52, 0xa5,
+        0xe8, 0x93, 0x3c, 0xbe, 0x90, 0x14, 0x72, 0xcc, 0xd0, 0x13, 0x24, 0xcf,
+        0xea, 0x17, 0x2a, 0xf9, 0x14, 0x54, 0x2c, 0x38, 0xca, 0x18, 0x21, 0x29,
+        0x84, 0xe4, 0x61, 0x11, 0x49, 0x3d, 0x03, 0x7d, 0x9f, 0xf5, 0x0b, 0xc4,
+        0x18, 0xc7, 0x08, 0x70, 0x06, 0x2d, 0x3a, 0x9f, 0xc3, 0x51, 0x64, 0xd0,
+        0x7c, 0x0e, 0xc8, 0xc6, 0x03, 0x58, 0x1a, 0xa7, 0xa2, 0x3a, 0x3a, 0x10,
+        0x81, 0x3d, 0xa8, 0x01, 0x1b, 0x49, 0x0a, 0x92, 0xc2, 0x30, 0x07, 0x21,
+        0x04, 0x08, 0x43, 0x71, 0x30, 0x4b, 0xb9, 0x1b, 0x12, 0xc8, 0x01, 0x99,
+        0x3c, 0x86, 0x95, 0x83, 0x37, 0x49, 0x86, 0xfd, 0xff, 0xbf, 0x03, 0x44,
+        0xf4, 0xac, 0x43, 0x72, 0x5f, 0xc4, 0xc9, 0x28, 0xb1, 0xa2, 0x4f, 0x33,
+        0x69, 0x33, 0xd0, 0x77, 0x2d, 0xa6, 0x60, 0x95, 0x84, 0x2d, 0x89, 0x59,
+        0x41, 0x8d, 0x6b, 0xf2, 0xfa, 0x39, 0xd5, 0x5a, 0x59, 0xc8, 0xb9, 0xcc,
+        0x39, 0xf8, 0x54, 0xae, 0x56, 0xe3, 0x61, 0x3a, 0xa8, 0x0a, 0x04, 0x94,
+        0x58, 0x0a, 0xec, 0x17, 0xe3, 0xc6, 0x61, 0x15, 0x94, 0xe2, 0x0d, 0xa8,
+        0x06, 0x9d, 0xf3, 0xe2, 0xe7, 0xa9, 0x2c, 0xb8, 0xcd, 0x25, 0xf5, 0xe3,
+        0x74, 0x8d, 0x08, 0x3b, 0x8d, 0xbb, 0x39, 0x64, 0x4a, 0x6e, 0xfd, 0xc2,
+        0x74, 0x4b, 0xd3, 0xa4, 0xde, 0x68, 0x6c, 0x76, 0x65, 0x6e, 0x84, 0x87,
+        0x43, 0x2d, 0x72, 0x7e, 0x1f, 0xd7, 0xcf, 0xab, 0x20, 0xc5, 0xcc, 0xef,
+        0x49, 0x85, 0xe6, 0x08, 0xda, 0x08, 0x3b, 0x1d, 0x64, 0x2e, 0xaf, 0xf3,
+        0x24, 0x15, 0x68, 0xd2, 0x23, 0x9f, 0x12, 0xa4, 0x49, 0x8c, 0x02, 0x5b,
+        0x76, 0xd8, 0xc1, 0x51, 0xd1, 0xd1, 0x4c, 0x07, 0xcb, 0x84, 0xce, 0xd6,
+        0xfc, 0x04, 0x87, 0x57, 0xd7, 0x9b, 0xff, 0xc8, 0x86, 0x8b, 0x28, 0x49,
+        0x68, 0x20, 0xdf, 0x30, 0x60, 0x8d, 0x1b, 0xe2, 0xe1, 0x59, 0x74, 0xba,
+        0x6e, 0xb8, 0x01, 0xa5, 0x05, 0x3a, 0x3c, 0x91, 0x47, 0x84, 0x37, 0x7a,
+        0x71, 0x35, 0x27, 0x2c, 0x88, 0x00, 0xb0, 0x0e, 0x57, 0xd6, 0x5f, 0x2e,
+        0x3f, 0x9f, 0xd8, 0x31, 0x57, 0x8b, 0x40, 0x74, 0x08, 0x8b, 0x01, 0x22,
+        0x8c, 0x16, 0x4f, 0xef, 0x30, 0x65, 0x4b, 0xbc, 0x53, 0xa3, 0x7f, 0x9c,
+        0x44, 0xdd, 0x29, 0xec, 0xfc, 0x40, 0x23, 0x78, 0x77, 0x34, 0x5d, 0x49,
+        0x59, 0xb3, 0xc9, 0x5a, 0x15, 0xe4, 0x6b, 0xdc, 0xd3, 0x10, 0xd9, 0xbf,
+        0xbf, 0x12, 0xb5, 0x4e, 0xd8, 0xb2, 0x89, 0xb1, 0xbc, 0xc9, 0x7a, 0xae,
+        0x7d, 0x82, 0x41, 0x5b, 0x03, 0x6c, 0x9e, 0xf4, 0x21, 0xc8, 0x5b, 0x4b,
+        0xab, 0x19, 0xdc, 0xc3, 0x86, 0x94, 0x22, 0x5d, 0x86, 0x79, 0x5d, 0x1e,
+        0xfe, 0xe0, 0x98, 0xf3, 0xb9, 0xb7, 0xc3, 0x41, 0x43, 0x98, 0x4e, 0xc4,
+        0x23, 0xd0, 0x7f, 0xb2, 0xb5, 0x8d, 0x10, 0x85, 0x6e, 0xd1, 0xa0, 0x0f,
+        0xac, 0x0a, 0x4d, 0x18, 0x7d, 0xec, 0x2a, 0x4e, 0x6b, 0x9e, 0x0b, 0xa2,
+        0xd5, 0xc5, 0xd5, 0x25, 0x98, 0xb5, 0x04, 0xfc, 0x00, 0xac, 0xf4, 0xf7,
+        0xae, 0xb1, 0x34, 0x41, 0x08, 0x6c, 0x2e, 0x52, 0xbd, 0x76, 0x22, 0x05,
+        0x17, 0x2c, 0xb3, 0x11, 0xae, 0xdf, 0xaf, 0xca, 0x3a, 0x7b, 0x47, 0x58,
+        0x1e, 0x90, 0x0e, 0x24, 0x2f, 0x61, 0xb3, 0x24, 0x86, 0x14, 0x19, 0x3c,
+        0xb6, 0x2d, 0x00, 0x09, 0x75, 0xfe, 0x81, 0x01, 0x4e, 0x51, 0xac, 0x87,
+        0x9c, 0x78, 0xc8, 0x20, 0xfa, 0x58, 0xa4, 0x63, 0xf9, 0xf4, 0x85, 0xbe,
+        0x3a, 0x30, 0x34, 0xe4, 0x33, 0xea, 0x6d, 0xbd, 0xe6, 0x40, 0x07, 0xc4,
+        0x01, 0xf7, 0xa9, 0x8a, 0xdb, 0x0a, 0x45, 0x2c, 0x40, 0xc6, 0x4c, 0x0f,
+        0x71, 0x44, 0xf0, 0xc8, 0x57, 0xd0, 0xdd, 0xe0, 0xe0, 0x19, 0x42, 0xf3,
+        0x0a, 0xc2, 0xfd, 0x1f, 0xd1, 0x06, 0x26, 0xc3, 0x20, 0x92, 0x7d, 0x4c,
+        0xc9, 0x0a, 0x8a, 0x71, 0x0e, 0x42, 0x22, 0x47, 0x24, 0x7d, 0x80, 0xae,
+        0x3d, 0xfb, 0x9a, 0x44, 0x9f, 0xf8, 0x10, 0x0f, 0x8f, 0xb1, 0x62, 0x82,
+        0xbf, 0x27, 0xa6, 0x81, 0xb0, 0x0e, 0xd8, 0x02, 0x08, 0xd9, 0x72, 0x8f,
+        0xe6, 0x97, 0x49, 0x87, 0xde, 0xc2, 0x72, 0x0a, 0x82, 0xd2, 0x4d, 0x02,
+        0x12, 0xa5, 0xcb, 0x6c, 0xf7, 0x50, 0x41, 0xe9, 0x34, 0x1d, 0x5b, 0x05,
+        0x3e, 0x2a, 0x19, 0xc2, 0xd1, 0xa3, 0x25, 0x3b, 0xc6, 0x9a, 0xf3, 0x9c,
+        0x35, 0xae, 0x56, 0x8b, 0x21, 0xa4, 0xd5, 0x20, 0x96, 0x2e, 0x22, 0x63,
+        0x0b, 0x4e, 0x2e, 0x58, 0xc9, 0x04, 0x97, 0x09, 0xec, 0x7c, 0xcd, 0x93,
+        0x94, 0xce, 0x07, 0x33, 0x57, 0xad, 0xc0, 0xc0, 0x2e, 0xcf, 0xac, 0x4b,
+        0xea, 0x49, 0x88, 0x16, 0x68, 0x64, 0xf4, 0xb2, 0x0a, 0x4d, 0x28, 0x39,
+        0x68, 0xf1, 0x4e, 0x65, 0xc0, 0x59, 0x6a, 0x4e, 0x6e, 0xf2, 0x94, 0x73,
+        0x0f, 0xf7, 0x19, 0x8c, 0xb6, 0x40, 0x96, 0x5a, 0x7f, 0x2a, 0xe1, 0xfc,
+        0x3e, 0x78, 0x16, 0x2f, 0x55, 0xa2, 0xb6, 0x9a, 0x50, 0x05, 0x02, 0x00,
+        0x10, 0x00, 0xc5, 0x00, 0x00, 0x08, 0x00, 0x05, 0x00, 0x98, 0xdb, 0xfc,
+        0x04, 0x79, 0xb0, 0x09, 0xe1, 0x7e, 0x12, 0xa4, 0x61, 0x84, 0x12, 0xb4,
+        0x01, 0xe5, 0x47, 0x07, 0x57, 0x08, 0x81, 0x2d, 0x95,
+};
+
+static const CEfiU8 test_zstd_stream[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x10, 0x55, 0x17, 0x00, 0x12, 0xca, 0x19,
+        0x16, 0xb0, 0x25, 0xe9, 0x00, 0xd8, 0x2d, 0xed, 0xd0, 0xd2, 0x26, 0xed,
+        0x90, 0x9b, 0x24, 0x49, 0xda, 0x4e, 0x92, 0x94, 0x04, 0xa7, 0x3a, 0x76,
+        0xa6, 0x83, 0xd6, 0xf0, 0xc9, 0x67, 0x59, 0x9f, 0x65, 0xe9, 0xfb, 0x3e,
+        0xcd, 0x35, 0xcc, 0xf5, 0x7d, 0xfa, 0xad, 0xe1, 0xb3, 0x3e, 0xa9, 0xac,
+        0x71, 0x35, 0xd7, 0x27, 0xc9, 0xe2, 0x90, 0x0b, 0x94, 0xe5, 0xfd, 0x82,
+        0x3f, 0x60, 0xae, 0x14, 0x91, 0x54, 0x31, 0x05, 0x40, 0x4e, 0x5d, 0xc3,
+        0x9d, 0x57, 0x61, 0x47, 0xa5, 0x72, 0x3b, 0x3b, 0xd3, 0x81, 0x70, 0x2e,
+        0x80, 0x30, 0x97, 0x0b, 0x06, 0x73, 0x56, 0x8c, 0xcc, 0x45, 0x35, 0x8e,
+        0x4c, 0x0d, 0x3d, 0xa1, 0x22, 0x5a, 0x58, 0x81, 0x4a, 0xa8, 0x21, 0x1b,
+        0x49, 0x92, 0xbd, 0xd6, 0x21, 0x04, 0x08, 0x04, 0x61, 0xa8, 0xb7, 0xd6,
+        0x07, 0x11, 0x70, 0x18, 0x66, 0xa5, 0x62, 0xcc, 0x88, 0x92, 0xe5, 0x5d,
+        0x0c, 0xc4, 0x53, 0xad, 0x48, 0x2a, 0x56, 0x56, 0x05, 0xf2, 0x18, 0x2a,
+        0x91, 0xa2, 0xe7, 0xa4, 0x87, 0x97, 0xf0, 0xff, 0x65, 0x61, 0x32, 0x8f,
+        0xd8, 0x8e, 0x71, 0xf9, 0xb4, 0x7c, 0x26, 0x9e, 0x69, 0x60, 0x85, 0xde,
+        0x11, 0x57, 0xc0, 0xcd, 0x17, 0x98, 0x7b, 0x04, 0x5d, 0xd9, 0x13, 0xd3,
+        0x48, 0x3d, 0x6e, 0x2c, 0x70, 0x57, 0x41, 0xc9, 0x6b, 0x87, 0x34, 0x94,
+        0x46, 0x15, 0x1d, 0xc7, 0x89, 0x54, 0x12, 0xa0, 0xf6, 0x44, 0x70, 0x74,
+        0x0d, 0x98, 0xc4, 0x26, 0x28, 0xcb, 0x92, 0xb6, 0xc5, 0x0f, 0x82, 0xc2,
+        0x0f, 0xc3, 0xc6, 0x30, 0x31, 0x27, 0x02, 0x34, 0xce, 0x46, 0xa6, 0xa0,
+        0xd8, 0xc5, 0xda, 0xe7, 0xf9, 0x1d, 0xee, 0xce, 0x70, 0xf0, 0xdc, 0xd6,
+        0xba, 0x89, 0xb8, 0x33, 0xf9, 0x3d, 0x8a, 0x52, 0x73, 0x7c, 0x05, 0x88,
+        0xfb, 0x26, 0xbf, 0x86, 0xfc, 0xdc, 0x68, 0x64, 0x1a, 0x11, 0x11, 0x35,
+        0x44, 0xc0, 0x73, 0xae, 0x5d, 0x35, 0xbd, 0xbb, 0x00, 0xa9, 0xb0, 0xd7,
+        0x43, 0x11, 0x01, 0xc5, 0xa8, 0xd1, 0xbf, 0xa2, 0xfa, 0x1d, 0xbe, 0x2b,
+        0x8d, 0x15, 0x82, 0xc9, 0x5d, 0xc9, 0x64, 0xa3, 0xfc, 0xe1, 0xb9, 0xdd,
+        0x14, 0x80, 0xe5, 0x6b, 0x8c, 0xb8, 0x1b, 0x71, 0x38, 0xfc, 0x6a, 0xfe,
+        0x12, 0x40, 0x64, 0xb7, 0xf2, 0xd8, 0x0b, 0xe1, 0xfd, 0x5d, 0x08, 0x75,
+        0xb0, 0x09, 0xcf, 0x6a, 0xed, 0x4d, 0x08, 0x29, 0x83, 0x82, 0xb9, 0x57,
+        0x84, 0x1d, 0xed, 0x4a, 0x13, 0xfd, 0x9e, 0xaa, 0x50, 0xf6, 0xc2, 0x34,
+        0xe9, 0x8d, 0x97, 0x3a, 0x57, 0x35, 0xae, 0xfd, 0xdd, 0xb5, 0x94, 0x29,
+        0x45, 0x8a, 0x93, 0xc8, 0xa3, 0x7e, 0x7d, 0x98, 0xb3, 0x01, 0x0c, 0xcb,
+        0x20, 0x93, 0x06, 0x3f, 0x1c, 0x06, 0x5b, 0xf3, 0x46, 0x55, 0x6d, 0x81,
+        0x7c, 0x8a, 0x9a, 0xcb, 0x9c, 0x24, 0x1e, 0x2a, 0xe6, 0xa3, 0x13, 0xb7,
+        0xec, 0x6b, 0x13, 0x56, 0xa8, 0xfe, 0x30, 0x88, 0x74, 0x26, 0xdd, 0x2c,
+        0xe6, 0x19, 0xf8, 0x9d, 0xe5, 0xbb, 0x12, 0x97, 0x68, 0x48, 0x5c, 0xcc,
+        0xd3, 0x69, 0xe2, 0xe3, 0xe8, 0x8c, 0x12, 0x12, 0x20, 0xe5, 0x85, 0x81,
+        0x17, 0x2c, 0xa7, 0x1a, 0x16, 0xb8, 0x10, 0x28, 0xe8, 0xe2, 0x38, 0x67,
+        0x5c, 0x05, 0x40, 0x95, 0x29, 0xd0, 0xf5, 0x7c, 0x89, 0x92, 0x51, 0xc8,
+        0xa9, 0x4c, 0x97, 0xb5, 0x63, 0x16, 0x86, 0x2d, 0x9d, 0x13, 0xd6, 0x54,
+        0x39, 0x44, 0xa8, 0x22, 0xf1, 0x8e, 0x69, 0xa1, 0x63, 0xe4, 0x78, 0xd8,
+        0x50, 0x91, 0x74, 0xf6, 0x8d, 0x0e, 0xf7, 0x96, 0x6c, 0x4e, 0x9b, 0x92,
+        0xd6, 0x89, 0x60, 0x88, 0x05, 0xbb, 0x43, 0xcc, 0xb4, 0x4b, 0x79, 0x62,
+        0x16, 0x48, 0x64, 0x9d, 0xc5, 0x47, 0xfc, 0x0d, 0xad, 0x60, 0xb5, 0xf1,
+        0x52, 0x65, 0x2c, 0xc2, 0xcb, 0x41, 0x1f, 0x4b, 0x40, 0x3a, 0xc4, 0xcf,
+        0x14, 0x24, 0x3e, 0xc5, 0x4d, 0x68, 0xf8, 0x6e, 0x73, 0x5f, 0x59, 0x38,
+        0x7a, 0x36, 0x7f, 0xac, 0xe8, 0xd3, 0x72, 0x3c, 0x35, 0xb2, 0xf9, 0x1c,
+        0x5f, 0x22, 0xaf, 0x1f, 0xbf, 0x98, 0x0e, 0x88, 0xae, 0xc4, 0x20, 0xef,
+        0x8c, 0x48, 0x79, 0x39, 0xfd, 0x81, 0x67, 0x81, 0x3c, 0xb2, 0xa2, 0xf6,
+        0x12, 0x29, 0x40, 0x64, 0xc0, 0x3d, 0x4f, 0xb2, 0xe9, 0xbb, 0xae, 0xca,
+        0x21, 0x65, 0xeb, 0x0d, 0xe7, 0x35, 0x9b, 0x42, 0x3e, 0x54, 0x45, 0x0c,
+        0x56, 0x22, 0xa6, 0x6e, 0x43, 0x25, 0xab, 0xc2, 0x19, 0x5e, 0x19, 0x5a,
+        0xb8, 0xaa, 0x11, 0x40, 0x21, 0x86, 0x07, 0xe9, 0xb8, 0x4d, 0xd7, 0x9d,
+        0x73, 0x25, 0x69, 0x5f, 0xae, 0x0b, 0x49, 0x62, 0x34, 0x24, 0x06, 0x66,
+        0xbe, 0xb3, 0x97, 0xa8, 0xd6, 0x3e, 0x39, 0xa7, 0x88, 0xa0, 0xb0, 0xed,
+        0x2a, 0x51, 0x43, 0x45, 0xdb, 0xe2, 0x98, 0x40, 0x84, 0x03, 0x30, 0xbd,
+        0x72, 0x56, 0x92, 0xb9, 0xa6, 0xa9, 0x16, 0x1f, 0x34, 0xbc, 0xb1, 0x65,
+        0x08, 0x6f, 0xd0, 0x88, 0xda, 0xa6, 0x4f, 0x35, 0xa5, 0xfe, 0x9b, 0x5a,
+        0x45, 0x7d, 0xd9, 0x22, 0x65, 0xd1, 0x94, 0x9b, 0x78, 0xcb, 0x22, 0x12,
+        0xfa, 0x04, 0x50, 0x4b, 0x49, 0xbe, 0x1d, 0x05, 0x0a, 0x51, 0xb1, 0x65,
+        0x37, 0x92, 0x87, 0xdd, 0xe0, 0xdb, 0x70, 0x02, 0x0a, 0x79, 0x63, 0xe3,
+        0xd1, 0x48, 0x30, 0x0f, 0x1e, 0xc9, 0xd2, 0x1f, 0x9a, 0x3a, 0x63, 0x69,
+        0x40, 0xd8, 0x16, 0x1d, 0x3a, 0x71, 0xa1, 0x96, 0xc2, 0x56, 0x01, 0xff,
+        0x14, 0x1e, 0x12,
+};
+
+static const CEfiU8 test_zstd_empty[] = {
+        0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x00, 0x01, 0x00, 0x00, 0x99, 0xe9, 0xd8,
+        0x51,
+};
+
+static const char *const test_words[] = {
+        "boot", "loader", "kernel", "initrd", "efi", "stub", "partition", "volume",
+        "the", "a", "of", "image", "config", "entry", "timeout", "default",
+};
+
+static uint64_t test_next(uint64_t *x) {
+        *x = *x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return *x;
+}
+
+/* space separated words, with the occasional line break */
+static void test_text(uint8_t *p, size_t n, uint64_t x) {
+        size_t i = 0, l;
+        const char *w;
+
+        while (i < n) {
+                test_next(&x);
+                w = test_words[(x >> 33) % 16];
+                for (l = 0; w[l] && i < n; ++l)
+                        p[i++] = w[l];
+                if (i < n)
+                        p[i++] = (x >> 40) % 11 ? ' ' : '\n';
+        }
+}
+
+static void test_noise(uint8_t *p, size_t n, uint64_t x) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                p[i] = test_next(&x) >> 56;
+}
+
+/* 700 bytes of noise, repeated, with a flipped byte every 4099 bytes */
+static void test_periodic(uint8_t *p, size_t n, uint64_t x) {
+        uint8_t base[700];
+        size_t i;
+
+        test_noise(base, sizeof(base), x);
+        for (i = 0; i < n; ++i)
+                p[i] = base[i % 700] ^ (i % 4099 ? 0 : 0x5a);
+}
+
+/* runs of 1 to 40 bytes, of 4 different values */
+static void test_runs(uint8_t *p, size_t n, uint64_t x) {
+        size_t i = 0, l;
+
+        while (i < n) {
+                test_next(&x);
+                for (l = 1 + (x >> 40) % 40; l-- && i < n; )
+                        p[i++] = x >> 62;
+        }
+}
+
+static void test_put24(uint8_t *p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+}
+
+static void test_put32(uint8_t *p, uint32_t v) {
+        test_put24(p, v);
+        p[3] = v >> 24;
+}
+
+/* frame header with a window of 128KiB and the content size, if given */
+static uint8_t *test_header(uint8_t *d, CEfiBool checksum, size_t content_size) {
+        test_put32(d, C_EFI_ZSTD_MAGIC);
+        d[4] = (checksum ? 0x04 : 0) | (content_size != SIZE_MAX ? 2 << 6 : 0);
+        d[5] = (17 - 10) << 3;
+        if (content_size == SIZE_MAX)
+                return d + 6;
+        test_put32(d + 6, content_size);
+        return d + 10;
+}
+
+static uint8_t *test_raw(uint8_t *d, const uint8_t *src, size_t n, CEfiBool last) {
+        test_put24(d, n << 3 | C_EFI_ZSTD_BLOCK_RAW << 1 | last);
+        memcpy(d + 3, src, n);
+        return d + 3 + n;
+}
+
+static uint8_t *test_rle(uint8_t *d, uint8_t c, size_t n, CEfiBool last) {
+        test_put24(d, n << 3 | C_EFI_ZSTD_BLOCK_RLE << 1 | last);
+        d[3] = c;
+        return d + 4;
+}
+
+/* compressed block of RLE literals and no sequences, for up to 4095 bytes */
+static uint8_t *test_rle_literals(uint8_t *d, uint8_t c, size_t n, CEfiBool last) {
+        test_put24(d, 4 << 3 | C_EFI_ZSTD_BLOCK_COMPRESSED << 1 | last);
+        d[3] = (n << 4 | 1 << 2 | 1) & 0xff;
+        d[4] = n >> 4;
+        d[5] = c;
+        d[6] = 0;
+        return d + 7;
+}
+
+/*
+ * Decode @in, fed in chunks of @chunk bytes, through a window of @n_window
+ * bytes. Only half of the pending data is released at a time, so blocks
+ * regularly run out of space and are retried.
+ */
+static CEfiStatus test_stream(const uint8_t *in, size_t n_in, size_t chunk,
+                              size_t n_window, size_t n_workspace,
+                              uint8_t *out, size_t n_out_max, size_t *n_outp) {
+        size_t off = 0, n_out = 0, k, m;
+        uint8_t *window, *workspace;
+        CEfiUSize used;
+        const CEfiU8 *p;
+        CEfiStatus r;
+        CEfiZstd *dec;
+
+        dec = malloc(sizeof(*dec));
+        window = malloc(n_window);
+        workspace = malloc(n_workspace + 1);
+        assert(dec && window && workspace);
+        c_efi_zstd_init(dec, 0, window, n_window, workspace, n_workspace);
+
+        for (;;) {
+                k = n_in - off < chunk ? n_in - off : chunk;
+                r = c_efi_zstd_decode(dec, in + off, k, &used);
+                assert(used <= k);
+                off += used;
+
+                m = c_efi_zstd_pending(dec, &p);
+                m = r == C_EFI_BUFFER_TOO_SMALL ? (m + 1) / 2 : m;
+                assert(n_out + m <= n_out_max);
+                memcpy(out + n_out, p, m);
+                n_out += m;
+                c_efi_zstd_release(dec, m);
+
+                if (r == C_EFI_BUFFER_TOO_SMALL && (used || m))
+                        continue;
+                if (r)
+                        break;
+                if (off == n_in) {
+                        m = c_efi_zstd_pending(dec, &p);
+                        assert(n_out + m <= n_out_max);
+                        memcpy(out + n_out, p, m);
+                        n_out += m;
+                        r = c_efi_zstd_done(dec) ? C_EFI_SUCCESS : C_EFI_END_OF_FILE;
+                        break;
+                }
+        }
+
+        assert(dec->pos <= n_window);
+        *n_outp = n_out;
+        free(workspace);
+        free(window);
+        free(dec);
+        return r;
+}
+
+/*
+ * Decode @in in all supported ways and compare the results against @expect.
+ * @n_ring is the smallest window the frames can be decoded through.
+ */
+static void test_decode(const uint8_t *in, size_t n_in, const uint8_t *expect, size_t n_expect, size_t n_ring) {
+        static const size_t chunks[] = { 1, 7, 4096, SIZE_MAX };
+        uint8_t *out, *window, *workspace;
+        size_t i, n_out;
+        CEfiUSize used;
+        CEfiZstd *dec;
+
+        out = malloc(n_expect + 1);
+        dec = malloc(sizeof(*dec));
+        workspace = malloc(C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(out && dec && workspace);
+
+        /* in place, into a window of exactly the content size */
+        window = malloc(n_expect + 1);
+        assert(window);
+        c_efi_zstd_init(dec, 0, window, n_expect, workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(!c_efi_zstd_decode(dec, in, n_in, &used));
+        assert(used == n_in);
+        assert(c_efi_zstd_done(dec));
+        assert(dec->pos == n_expect && dec->tail == 0 && !dec->n_slides);
+        assert(!memcmp(window, expect, n_expect));
+        free(window);
+
+        /* split input needs staging, a small window slides */
+        for (i = 0; i < sizeof(chunks) / sizeof(*chunks); ++i) {
+                assert(!test_stream(in, n_in, chunks[i], n_expect + 1, C_EFI_ZSTD_WORKSPACE_SIZE,
+                                    out, n_expect, &n_out));
+                assert(n_out == n_expect && !memcmp(out, expect, n_expect));
+                assert(!test_stream(in, n_in, chunks[i], n_ring, C_EFI_ZSTD_WORKSPACE_SIZE,
+                                    out, n_expect, &n_out));
+                assert(n_out == n_expect && !memcmp(out, expect, n_expect));
+        }
+
+        free(workspace);
+        free(dec);
+        free(out);
+}
+
+static void test_vectors(void) {
+        uint8_t *buf;
+
+        buf = malloc(306000);
+        assert(buf);
+
+        test_text(buf, 1200, 1);
+        test_decode(test_zstd_text, sizeof(test_zstd_text), buf, 1200, 1201);
+        test_text(buf, 6000, 5);
+        test_decode(test_zstd_small_window, sizeof(test_zstd_small_window), buf, 6000, 2048);
+        test_periodic(buf, 150000, 2);
+        test_decode(test_zstd_periodic, sizeof(test_zstd_periodic), buf, 150000, 150001);
+        test_runs(buf, 20000, 11);
+        test_decode(test_zstd_runs, sizeof(test_zstd_runs), buf, 20000, 20001);
+        test_noise(buf, 300, 3);
+        test_decode(test_zstd_noise, sizeof(test_zstd_noise), buf, 300, 301);
+        test_text(buf, 3000, 1);
+        memset(buf + 3000, 0, 300000);
+        test_text(buf + 303000, 3000, 1);
+        test_decode(test_zstd_zeros, sizeof(test_zstd_zeros), buf, 306000, 306001);
+        test_text(buf, 3000, 9);
+        test_decode(test_zstd_stream, sizeof(test_zstd_stream), buf, 3000, 8192);
+        test_decode(test_zstd_empty, sizeof(test_zstd_empty), buf, 0, 1);
+
+        free(buf);
+}
+
+static void test_frames(void) {
+        uint8_t *src, *frame, *p, *h;
+        size_t n_frame;
+
+        src = malloc(20000);
+        frame = malloc(20000);
+        assert(src && frame);
+
+        /* raw and RLE blocks, and RLE literals, with and without checksum */
+        test_text(src, 1000, 2);
+        memset(src + 1000, 'z', 5000);
+        memset(src + 6000, 'q', 3000);
+        test_noise(src + 9000, 1000, 3);
+
+        p = test_header(frame, 1, 10000);
+        p = test_raw(p, src, 1000, 0);
+        p = test_rle(p, 'z', 5000, 0);
+        p = test_rle_literals(p, 'q', 3000, 0);
+        p = test_raw(p, src + 9000, 1000, 1);
+        test_put32(p, c_efi_xxh64(0, src, 10000));
+        n_frame = p + 4 - frame;
+        test_decode(frame, n_frame, src, 10000, 10001);
+
+        p = test_header(frame, 0, SIZE_MAX);
+        p = test_rle(p, 'z', 5000, 0);
+        p = test_raw(p, src, 0, 0);
+        p = test_rle_literals(p, 'q', 3000, 1);
+        n_frame = p - frame;
+        test_decode(frame, n_frame, src + 1000, 8000, 8001);
+
+        /* concatenated frames, with a skippable frame in between */
+        test_text(src, 1200, 1);
+        test_noise(src + 1200, 300, 3);
+        p = frame;
+        memcpy(p, test_zstd_text, sizeof(test_zstd_text));
+        p += sizeof(test_zstd_text);
+        test_put32(p, C_EFI_ZSTD_MAGIC_SKIPPABLE | 7);
+        test_put32(p + 4, 3);
+        p += 11;
+        memcpy(p, test_zstd_empty, sizeof(test_zstd_empty));
+        p += sizeof(test_zstd_empty);
+        memcpy(p, test_zstd_noise, sizeof(test_zstd_noise));
+        p += sizeof(test_zstd_noise);
+        h = p;
+        p = test_header(p, 1, 1);
+        p = test_rle(p, 'x', 1, 1);
+        test_put32(p, c_efi_xxh64(0, "x", 1));
+        p += 4;
+        src[1500] = 'x';
+        test_decode(frame, p - frame, src, 1501, 1502);
+
+        /* the content size must match */
+        test_put32(h + 6, 2);
+        assert(test_stream(frame, p - frame, SIZE_MAX, 2000, C_EFI_ZSTD_WORKSPACE_SIZE,
+                           src + 2000, 2000, &n_frame) == C_EFI_COMPROMISED_DATA);
+
+        free(frame);
+        free(src);
+}
+
+static void test_errors(void) {
+        uint8_t src[1200], window[1200], frame[sizeof(test_zstd_text)];
+        uint8_t *workspace;
+        size_t i, n_out;
+        CEfiUSize used;
+        CEfiStatus r;
+        CEfiZstd *dec;
+
+        dec = malloc(sizeof(*dec));
+        workspace = malloc(C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(dec && workspace);
+        test_text(src, sizeof(src), 1);
+        memcpy(frame, test_zstd_text, sizeof(frame));
+
+        /*
+         * Every single bit flip is caught, by the checksum or the parser,
+         * unless it hits a bit the format ignores, like the unused bit of the
+         * frame header descriptor or padding of table descriptions.
+         */
+        for (i = 0; i < sizeof(frame) * 8; ++i) {
+                frame[i / 8] ^= 1 << (i % 8);
+                r = test_stream(frame, sizeof(frame), SIZE_MAX, sizeof(window), C_EFI_ZSTD_WORKSPACE_SIZE,
+                                window, sizeof(window), &n_out);
+                assert(r == C_EFI_CRC_ERROR || r == C_EFI_COMPROMISED_DATA || r == C_EFI_UNSUPPORTED ||
+                       r == C_EFI_BUFFER_TOO_SMALL || r == C_EFI_END_OF_FILE ||
+                       (r == C_EFI_SUCCESS && n_out == sizeof(src) && !memcmp(window, src, n_out)));
+                frame[i / 8] ^= 1 << (i % 8);
+        }
+
+        /* without checksums, corrupt blocks still decode safely */
+        for (i = 0; i < sizeof(frame) * 8; ++i) {
+                frame[i / 8] ^= 1 << (i % 8);
+                c_efi_zstd_init(dec, C_EFI_ZSTD_FLAG_SKIP_CHECKSUM, window, sizeof(window),
+                                workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+                c_efi_zstd_decode(dec, frame, sizeof(frame), &used);
+                frame[i / 8] ^= 1 << (i % 8);
+        }
+
+        /* ... and the checksum can be skipped deliberately */
+        frame[sizeof(frame) - 1] ^= 1;
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(c_efi_zstd_decode(dec, frame, sizeof(frame), &used) == C_EFI_CRC_ERROR);
+        c_efi_zstd_init(dec, C_EFI_ZSTD_FLAG_SKIP_CHECKSUM, window, sizeof(window),
+                        workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(!c_efi_zstd_decode(dec, frame, sizeof(frame), &used));
+        assert(c_efi_zstd_done(dec) && !memcmp(window, src, sizeof(src)));
+        frame[sizeof(frame) - 1] ^= 1;
+
+        /* truncated input is not done */
+        for (i = 0; i < sizeof(frame); i += 7) {
+                assert(test_stream(frame, i, SIZE_MAX, sizeof(window), C_EFI_ZSTD_WORKSPACE_SIZE,
+                                   window, sizeof(window), &n_out) == C_EFI_END_OF_FILE);
+                assert(n_out <= sizeof(src) && !memcmp(window, src, n_out));
+        }
+
+        /* errors are sticky */
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(c_efi_zstd_decode(dec, "junk", 4, &used) == C_EFI_COMPROMISED_DATA);
+        assert(c_efi_zstd_decode(dec, frame, sizeof(frame), &used) == C_EFI_COMPROMISED_DATA);
+        assert(used == 0);
+
+        /* literals and split blocks need workspace */
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, 0);
+        assert(c_efi_zstd_decode(dec, frame, sizeof(frame), &used) == C_EFI_OUT_OF_RESOURCES);
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(!c_efi_zstd_decode(dec, frame, sizeof(frame) / 2, &used));
+        assert(!c_efi_zstd_decode(dec, frame + sizeof(frame) / 2, sizeof(frame) - sizeof(frame) / 2, &used));
+        assert(c_efi_zstd_done(dec) && !memcmp(window, src, sizeof(src)));
+        assert(dec->n_blocks == 1 && dec->n_direct == 0);
+
+        /* a window smaller than the content cannot be used in place */
+        c_efi_zstd_init(dec, 0, window, sizeof(src) - 1, workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(c_efi_zstd_decode(dec, frame, sizeof(frame), &used) == C_EFI_BUFFER_TOO_SMALL);
+        assert(c_efi_zstd_pending(dec, &(const CEfiU8 *){ NULL }) == 0);
+
+        /* reserved bits are rejected, dictionaries are not supported */
+        frame[4] ^= 0x08;
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(c_efi_zstd_decode(dec, frame, sizeof(frame), &used) == C_EFI_COMPROMISED_DATA);
+        frame[4] ^= 0x08;
+        test_header(frame, 0, 0);
+        frame[4] |= 1;
+        frame[6] = 1;
+        c_efi_zstd_init(dec, 0, window, sizeof(window), workspace, C_EFI_ZSTD_WORKSPACE_SIZE);
+        assert(c_efi_zstd_decode(dec, frame, 11, &used) == C_EFI_UNSUPPORTED);
+
+        free(workspace);
+        free(dec);
+}
+
+int main(int argc, char **argv) {
+        test_vectors();
+        test_frames();
+        test_errors();
+        return 0;
+}